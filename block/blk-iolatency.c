@@ -136,9 +136,29 @@ struct latency_stat {
 	};
 };
 
+/*
+ * Latency histogram of the bios issued by a cgroup, kept whether or not it
+ * has a latency target and shown in io.latency_hist. Bucket 0 counts the
+ * latencies below 1us, bucket i those in [2^(i-1), 2^i) us and the last one
+ * everything longer.
+ */
+#define IOLAT_HIST_NR_BUCKETS	24
+
+enum {
+	IOLAT_HIST_READ,
+	IOLAT_HIST_WRITE,
+	IOLAT_HIST_FLUSH,
+	IOLAT_HIST_NR_OPS,
+};
+
+struct latency_hist {
+	u64 buckets[IOLAT_HIST_NR_OPS][IOLAT_HIST_NR_BUCKETS];
+};
+
 struct iolatency_grp {
 	struct blkg_policy_data pd;
 	struct latency_stat __percpu *stats;
+	struct latency_hist __percpu *hist;
 	struct latency_stat cur_stat;
 	struct blk_iolatency *blkiolat;
 	struct rq_depth rq_depth;
@@ -518,6 +538,36 @@ static void iolatency_record_time(struct iolatency_grp *iolat,
 	latency_stat_record_time(iolat, req_time);
 }
 
+static void iolatency_record_hist(struct iolatency_grp *iolat,
+				  struct bio *bio, u64 now)
+{
+	u64 start = bio_issue_time(&bio->bi_issue);
+	unsigned int op, idx = 0;
+
+	if (bio->bi_status == BLK_STS_AGAIN)
+		return;
+
+	if (op_is_flush(bio->bi_opf) && !bio_sectors(bio))
+		op = IOLAT_HIST_FLUSH;
+	else if (bio_op(bio) == REQ_OP_READ)
+		op = IOLAT_HIST_READ;
+	else if (bio_op(bio) == REQ_OP_WRITE)
+		op = IOLAT_HIST_WRITE;
+	else
+		return;
+
+	now = __bio_issue_time(now);
+	if (now > start) {
+		u64 usecs = div_u64(now - start, NSEC_PER_USEC);
+
+		if (usecs)
+			idx = min_t(unsigned int, ilog2(usecs) + 1,
+				    IOLAT_HIST_NR_BUCKETS - 1);
+	}
+
+	this_cpu_inc(iolat->hist->buckets[op][idx]);
+}
+
 #define BLKIOLATENCY_MIN_ADJUST_TIME (500 * NSEC_PER_MSEC)
 #define BLKIOLATENCY_MIN_GOOD_SAMPLES 5
 
@@ -607,10 +657,12 @@ static void blkcg_iolatency_done_bio(struct rq_qos *rqos, struct bio *bio)
 	if (!iolat)
 		return;
 
+	now = ktime_to_ns(ktime_get());
+	iolatency_record_hist(iolat, bio, now);
+
 	if (!iolat->blkiolat->enabled)
 		return;
 
-	now = ktime_to_ns(ktime_get());
 	while (blkg && blkg->parent) {
 		iolat = blkg_to_lat(blkg);
 		if (!iolat) {
@@ -906,6 +958,54 @@ static int iolatency_print_limit(struct seq_file *sf, void *v)
 	return 0;
 }
 
+static u64 iolatency_prfill_hist(struct seq_file *sf,
+				 struct blkg_policy_data *pd, int off)
+{
+	static const char * const op_names[IOLAT_HIST_NR_OPS] = {
+		[IOLAT_HIST_READ]	= "read",
+		[IOLAT_HIST_WRITE]	= "write",
+		[IOLAT_HIST_FLUSH]	= "flush",
+	};
+	struct iolatency_grp *iolat = pd_to_lat(pd);
+	const char *dname = blkg_dev_name(pd->blkg);
+	u64 buckets[IOLAT_HIST_NR_BUCKETS];
+	int op, cpu, i;
+
+	if (!dname)
+		return 0;
+
+	for (op = 0; op < IOLAT_HIST_NR_OPS; op++) {
+		u64 total = 0;
+
+		memset(buckets, 0, sizeof(buckets));
+		for_each_possible_cpu(cpu) {
+			struct latency_hist *hist;
+
+			hist = per_cpu_ptr(iolat->hist, cpu);
+			for (i = 0; i < IOLAT_HIST_NR_BUCKETS; i++)
+				buckets[i] += READ_ONCE(hist->buckets[op][i]);
+		}
+		for (i = 0; i < IOLAT_HIST_NR_BUCKETS; i++)
+			total += buckets[i];
+		if (!total)
+			continue;
+
+		seq_printf(sf, "%s %s", dname, op_names[op]);
+		for (i = 0; i < IOLAT_HIST_NR_BUCKETS; i++)
+			seq_printf(sf, " %llu", (unsigned long long)buckets[i]);
+		seq_putc(sf, '\n');
+	}
+	return 0;
+}
+
+static int iolatency_print_hist(struct seq_file *sf, void *v)
+{
+	blkcg_print_blkgs(sf, css_to_blkcg(seq_css(sf)),
+			  iolatency_prfill_hist,
+			  &blkcg_policy_iolatency, seq_cft(sf)->private, false);
+	return 0;
+}
+
 static void iolatency_ssd_stat(struct iolatency_grp *iolat, struct seq_file *s)
 {
 	struct latency_stat stat;
@@ -964,11 +1064,19 @@ static struct blkg_policy_data *iolatency_pd_alloc(gfp_t gfp,
 		return NULL;
 	iolat->stats = __alloc_percpu_gfp(sizeof(struct latency_stat),
 				       __alignof__(struct latency_stat), gfp);
-	if (!iolat->stats) {
-		kfree(iolat);
-		return NULL;
-	}
+	if (!iolat->stats)
+		goto err_free;
+	iolat->hist = __alloc_percpu_gfp(sizeof(struct latency_hist),
+					 __alignof__(struct latency_hist), gfp);
+	if (!iolat->hist)
+		goto err_free_stats;
 	return &iolat->pd;
+
+err_free_stats:
+	free_percpu(iolat->stats);
+err_free:
+	kfree(iolat);
+	return NULL;
 }
 
 static void iolatency_pd_init(struct blkg_policy_data *pd)
@@ -1028,6 +1136,7 @@ static void iolatency_pd_offline(struct blkg_policy_data *pd)
 static void iolatency_pd_free(struct blkg_policy_data *pd)
 {
 	struct iolatency_grp *iolat = pd_to_lat(pd);
+	free_percpu(iolat->hist);
 	free_percpu(iolat->stats);
 	kfree(iolat);
 }
@@ -1039,6 +1148,10 @@ static struct cftype iolatency_files[] = {
 		.seq_show = iolatency_print_limit,
 		.write = iolatency_set_limit,
 	},
+	{
+		.name = "latency_hist",
+		.seq_show = iolatency_print_hist,
+	},
 	{}
 };
 
@@ -65,6 +65,21 @@ int ioprio_check_cap(int ioprio)
 	return 0;
 }
 
+/*
+ * Same as ioprio_check_cap(), for the priority of a single I/O rather than of
+ * a process: RT class I/O may also carry a deadline hint.
+ */
+int ioprio_check_io_cap(int ioprio)
+{
+	if (IOPRIO_PRIO_CLASS(ioprio) == IOPRIO_CLASS_RT)
+		ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_RT,
+					   IOPRIO_PRIO_DATA(ioprio) &
+					   ~(IOPRIO_DEADLINE_MAX <<
+					     IOPRIO_DEADLINE_SHIFT));
+
+	return ioprio_check_cap(ioprio);
+}
+
 SYSCALL_DEFINE3(ioprio_set, int, which, int, who, int, ioprio)
 {
 	struct task_struct *p, *g;
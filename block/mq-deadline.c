@@ -79,6 +79,8 @@ struct dd_per_prio {
 	/* Next request in FIFO order. Read, write or both are NULL. */
 	struct request *next_rq[DD_DIR_COUNT];
 	struct io_stats_per_prio stats;
+	/* Queued requests with a deadline hint, only for DD_RT_PRIO. */
+	u32 nr_deadline;
 };
 
 struct deadline_data {
@@ -103,6 +105,10 @@ struct deadline_data {
 	u32 async_depth;
 	int prio_aging_expire;
 
+	/* Completed requests with a deadline hint, in time or not */
+	atomic_t deadline_met;
+	atomic_t deadline_missed;
+
 	spinlock_t lock;
 	spinlock_t zone_lock;
 };
@@ -130,6 +136,21 @@ static u8 dd_rq_ioclass(struct request *rq)
 	return IOPRIO_PRIO_CLASS(req_get_ioprio(rq));
 }
 
+/*
+ * Returns the deadline hint of an RT class request, in milliseconds, or 0 if
+ * it has none. The absolute deadline, in jiffies, is kept in elv.priv[1]
+ * from the first insertion on, since fifo_time doesn't survive completion.
+ */
+static unsigned int dd_rq_deadline(struct request *rq)
+{
+	u16 ioprio = req_get_ioprio(rq);
+
+	if (IOPRIO_PRIO_CLASS(ioprio) != IOPRIO_CLASS_RT)
+		return 0;
+
+	return IOPRIO_PRIO_DEADLINE(ioprio);
+}
+
 /*
  * get the request before `rq' in sector-sorted order
  */
@@ -184,6 +205,10 @@ static void deadline_remove_request(struct request_queue *q,
 				    struct dd_per_prio *per_prio,
 				    struct request *rq)
 {
+	/* Not on the fifo either if we are doing an insert merge */
+	if (!list_empty(&rq->queuelist) && dd_rq_deadline(rq))
+		per_prio->nr_deadline--;
+
 	list_del_init(&rq->queuelist);
 
 	/*
@@ -237,6 +262,8 @@ static void dd_merged_requests(struct request_queue *q, struct request *req,
 				(unsigned long)req->fifo_time)) {
 			list_move(&req->queuelist, &next->queuelist);
 			req->fifo_time = next->fifo_time;
+			if (dd_rq_deadline(req))
+				req->elv.priv[1] = next->elv.priv[1];
 		}
 	}
 
@@ -410,12 +437,34 @@ static bool started_after(struct deadline_data *dd, struct request *rq,
 			  unsigned long latest_start)
 {
 	unsigned long start_time = (unsigned long)rq->fifo_time;
+	unsigned int deadline = dd_rq_deadline(rq);
 
-	start_time -= dd->fifo_expire[rq_data_dir(rq)];
+	if (deadline)
+		start_time -= msecs_to_jiffies(deadline);
+	else
+		start_time -= dd->fifo_expire[rq_data_dir(rq)];
 
 	return time_after(start_time, latest_start);
 }
 
+/*
+ * Returns the queued request of @per_prio with the earliest expiry time, over
+ * both data directions. The FIFOs of DD_RT_PRIO are sorted by expiry time.
+ */
+static struct request *deadline_edf_request(struct deadline_data *dd,
+					    struct dd_per_prio *per_prio)
+{
+	struct request *rq, *wrq;
+
+	rq = deadline_fifo_request(dd, per_prio, DD_READ);
+	wrq = deadline_fifo_request(dd, per_prio, DD_WRITE);
+	if (!rq || (wrq && time_before((unsigned long)wrq->fifo_time,
+				       (unsigned long)rq->fifo_time)))
+		rq = wrq;
+
+	return rq;
+}
+
 /*
  * deadline_dispatch_requests selects the best request according to
  * read/write expire, fifo_batch, etc and with a start time <= @latest_start.
@@ -440,6 +489,20 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 		goto done;
 	}
 
+	/*
+	 * Once a request with a deadline hint is queued, sector order and
+	 * batching no longer apply: dispatch by earliest deadline first, the
+	 * others counting with their read or write expiry time.
+	 */
+	if (per_prio->nr_deadline) {
+		rq = deadline_edf_request(dd, per_prio);
+		if (!rq)
+			return NULL;
+		dd->last_dir = rq_data_dir(rq);
+		dd->batching = 0;
+		goto dispatch_request;
+	}
+
 	/*
 	 * batches are currently reads XOR writes
 	 */
@@ -765,6 +828,26 @@ static bool dd_bio_merge(struct request_queue *q, struct bio *bio,
 	return ret;
 }
 
+/*
+ * Add rq to its fifo. The FIFOs of DD_RT_PRIO are kept sorted by expiry time,
+ * as deadline hints make it differ between requests. Nearly all requests
+ * still go at the tail.
+ */
+static void deadline_add_rq_fifo(struct dd_per_prio *per_prio,
+				 struct request *rq, enum dd_prio prio)
+{
+	struct list_head *fifo = &per_prio->fifo_list[rq_data_dir(rq)];
+	struct list_head *pos = fifo->prev;
+
+	if (prio == DD_RT_PRIO) {
+		while (pos != fifo &&
+		       time_after((unsigned long)rq_entry_fifo(pos)->fifo_time,
+				  (unsigned long)rq->fifo_time))
+			pos = pos->prev;
+	}
+	list_add(&rq->queuelist, pos);
+}
+
 /*
  * add rq to rbtree and fifo
  */
@@ -776,6 +859,7 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	const enum dd_data_dir data_dir = rq_data_dir(rq);
 	u16 ioprio = req_get_ioprio(rq);
 	u8 ioprio_class = IOPRIO_PRIO_CLASS(ioprio);
+	unsigned int deadline = dd_rq_deadline(rq);
 	struct dd_per_prio *per_prio;
 	enum dd_prio prio;
 	LIST_HEAD(free);
@@ -793,6 +877,9 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	if (!rq->elv.priv[0]) {
 		per_prio->stats.inserted++;
 		rq->elv.priv[0] = (void *)(uintptr_t)1;
+		if (deadline)
+			rq->elv.priv[1] = (void *)(jiffies +
+						   msecs_to_jiffies(deadline));
 	}
 
 	if (blk_mq_sched_try_insert_merge(q, rq, &free)) {
@@ -817,8 +904,13 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 		/*
 		 * set expire time and add to fifo list
 		 */
-		rq->fifo_time = jiffies + dd->fifo_expire[data_dir];
-		list_add_tail(&rq->queuelist, &per_prio->fifo_list[data_dir]);
+		if (deadline) {
+			rq->fifo_time = (unsigned long)rq->elv.priv[1];
+			per_prio->nr_deadline++;
+		} else {
+			rq->fifo_time = jiffies + dd->fifo_expire[data_dir];
+		}
+		deadline_add_rq_fifo(per_prio, rq, prio);
 	}
 }
 
@@ -894,6 +986,13 @@ static void dd_finish_request(struct request *rq)
 
 	atomic_inc(&per_prio->stats.completed);
 
+	if (dd_rq_deadline(rq)) {
+		if (time_after(jiffies, (unsigned long)rq->elv.priv[1]))
+			atomic_inc(&dd->deadline_missed);
+		else
+			atomic_inc(&dd->deadline_met);
+	}
+
 	if (blk_queue_is_zoned(q)) {
 		unsigned long flags;
 
@@ -1096,6 +1195,18 @@ static int dd_queued_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+/* Completed requests with a deadline hint: in time, then late. */
+static int dd_deadlines_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct deadline_data *dd = q->elevator->elevator_data;
+
+	seq_printf(m, "%u %u\n", atomic_read(&dd->deadline_met),
+		   atomic_read(&dd->deadline_missed));
+
+	return 0;
+}
+
 /* Number of requests owned by the block driver for a given priority. */
 static u32 dd_owned_by_driver(struct deadline_data *dd, enum dd_prio prio)
 {
@@ -1194,6 +1305,7 @@ static const struct blk_mq_debugfs_attr deadline_queue_debugfs_attrs[] = {
 	{"dispatch2", 0400, .seq_ops = &deadline_dispatch2_seq_ops},
 	{"owned_by_driver", 0400, dd_owned_by_driver_show},
 	{"queued", 0400, dd_queued_show},
+	{"deadlines", 0400, dd_deadlines_show},
 	{},
 };
 #undef DEADLINE_QUEUE_DDIR_ATTRS
@@ -77,6 +77,9 @@ struct driver_private {
  *	the device; typically because it depends on another driver getting
  *	probed first.
  * @async_driver - pointer to device driver awaiting probe via async_probe
+ * @deferred_probe_count - number of times probing the device was deferred.
+ * @deferred_on_supplier - the last probe was deferred because a supplier in
+ *	device links wasn't ready; only retried once one of them is bound.
  * @device - pointer back to the struct device that this structure is
  * associated with.
  * @dead - This device is currently either in the process of or has been
@@ -94,6 +97,8 @@ struct device_private {
 	struct list_head deferred_probe;
 	struct device_driver *async_driver;
 	char *deferred_probe_reason;
+	unsigned int deferred_probe_count;
+	bool deferred_on_supplier;
 	struct device *device;
 	u8 dead:1;
 };
@@ -159,6 +164,7 @@ extern void device_block_probing(void);
 extern void device_unblock_probing(void);
 extern void deferred_probe_extend_timeout(void);
 extern void driver_deferred_probe_trigger(void);
+extern void driver_deferred_probe_kick(struct device *dev);
 
 /* /sys/devices directory */
 extern struct kset *devices_kset;
@@ -1394,6 +1394,7 @@ void device_links_driver_bound(struct device *dev)
 
 		if (link->flags & DL_FLAG_AUTOPROBE_CONSUMER)
 			driver_deferred_probe_add(link->consumer);
+		driver_deferred_probe_kick(link->consumer);
 	}
 
 	if (defer_sync_state_count)
@@ -1687,6 +1688,9 @@ static void device_links_purge(struct device *dev)
 	list_for_each_entry_safe_reverse(link, ln, &dev->links.consumers, s_node) {
 		WARN_ON(link->status != DL_STATE_DORMANT &&
 			link->status != DL_STATE_NONE);
+		/* Don't leave the consumer waiting for a supplier that's gone */
+		if (link->flags & DL_FLAG_MANAGED)
+			driver_deferred_probe_kick(link->consumer);
 		__device_link_del(&link->kref);
 	}
 
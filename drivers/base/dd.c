@@ -25,6 +25,7 @@
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
+#include <linux/boot_timeline.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
 #include <linux/slab.h>
@@ -46,7 +47,9 @@
  * list.  A driver returning -EPROBE_DEFER causes the device to be added to the
  * pending list.  A successful driver probe will trigger moving all devices
  * from the pending to the active list so that the workqueue will eventually
- * retry them.
+ * retry them, except for those that were deferred because of a supplier
+ * known from device links: those are only moved once one of their suppliers
+ * gets bound, instead of being retried every time any other driver binds.
  *
  * The deferred_probe_mutex must be held any time the deferred_probe_*_list
  * of the (struct device*)->p->deferred_probe pointers are manipulated
@@ -100,6 +103,7 @@ static void deferred_probe_work_func(struct work_struct *work)
 					typeof(*dev->p), deferred_probe);
 		dev = private->device;
 		list_del_init(&private->deferred_probe);
+		private->deferred_on_supplier = false;
 
 		get_device(dev);
 
@@ -150,16 +154,60 @@ void driver_deferred_probe_del(struct device *dev)
 		list_del_init(&dev->p->deferred_probe);
 		__device_set_deferred_probe_reason(dev, NULL);
 	}
+	dev->p->deferred_on_supplier = false;
+	mutex_unlock(&deferred_probe_mutex);
+}
+
+static void driver_deferred_probe_wait_supplier(struct device *dev)
+{
+	mutex_lock(&deferred_probe_mutex);
+	dev->p->deferred_on_supplier = true;
 	mutex_unlock(&deferred_probe_mutex);
 }
 
 static bool driver_deferred_probe_enable;
+
+static void __driver_deferred_probe_trigger(bool all)
+{
+	struct device_private *p, *n;
+
+	if (!driver_deferred_probe_enable)
+		return;
+
+	/*
+	 * Move the deferred devices into the active list so they can be
+	 * retried by the workqueue, leaving out those still waiting for one of
+	 * their suppliers unless all were asked for.
+	 */
+	mutex_lock(&deferred_probe_mutex);
+	atomic_inc(&deferred_trigger_count);
+	if (all) {
+		list_splice_tail_init(&deferred_probe_pending_list,
+				      &deferred_probe_active_list);
+	} else {
+		list_for_each_entry_safe(p, n, &deferred_probe_pending_list,
+					 deferred_probe)
+			if (!p->deferred_on_supplier)
+				list_move_tail(&p->deferred_probe,
+					       &deferred_probe_active_list);
+	}
+	mutex_unlock(&deferred_probe_mutex);
+
+	/*
+	 * Kick the re-probe thread.  It may already be scheduled, but it is
+	 * safe to kick it again.
+	 */
+	queue_work(system_unbound_wq, &deferred_probe_work);
+}
+
 /**
  * driver_deferred_probe_trigger() - Kick off re-probing deferred devices
  *
  * This functions moves all devices from the pending list to the active
  * list and schedules the deferred probe workqueue to process them.  It
- * should be called anytime a driver is successfully bound to a device.
+ * should be called whenever something other than a driver binding may
+ * let deferred devices probe; a driver binding only retries the devices
+ * that aren't waiting for their suppliers, see driver_bound().
  *
  * Note, there is a race condition in multi-threaded probe. In the case where
  * more than one device is probing at the same time, it is possible for one
@@ -174,25 +222,31 @@ static bool driver_deferred_probe_enable;
  */
 void driver_deferred_probe_trigger(void)
 {
-	if (!driver_deferred_probe_enable)
-		return;
+	__driver_deferred_probe_trigger(true);
+}
 
-	/*
-	 * A successful probe means that all the devices in the pending list
-	 * should be triggered to be reprobed.  Move all the deferred devices
-	 * into the active list so they can be retried by the workqueue
-	 */
+/**
+ * driver_deferred_probe_kick() - Re-probe a consumer of a bound supplier
+ * @dev: consumer device
+ *
+ * Called by the device links code for each consumer of a device that has
+ * just been bound, or whose link to a supplier goes away, to retry it if
+ * it was deferred waiting for that supplier.
+ */
+void driver_deferred_probe_kick(struct device *dev)
+{
 	mutex_lock(&deferred_probe_mutex);
+	/* Also tells a concurrent probe of @dev to trigger again */
 	atomic_inc(&deferred_trigger_count);
-	list_splice_tail_init(&deferred_probe_pending_list,
-			      &deferred_probe_active_list);
+	dev->p->deferred_on_supplier = false;
+	if (driver_deferred_probe_enable &&
+	    !list_empty(&dev->p->deferred_probe))
+		list_move_tail(&dev->p->deferred_probe,
+			       &deferred_probe_active_list);
 	mutex_unlock(&deferred_probe_mutex);
 
-	/*
-	 * Kick the re-probe thread.  It may already be scheduled, but it is
-	 * safe to kick it again.
-	 */
-	queue_work(system_unbound_wq, &deferred_probe_work);
+	if (driver_deferred_probe_enable)
+		queue_work(system_unbound_wq, &deferred_probe_work);
 }
 
 /**
@@ -256,6 +310,41 @@ static int deferred_devs_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(deferred_devs);
 
+/*
+ * deferred_stats_show() - Show how many times each device was deferred.
+ */
+static int deferred_stats_show(struct seq_file *s, void *data)
+{
+	struct kobject *kobj;
+
+	spin_lock(&devices_kset->list_lock);
+
+	list_for_each_entry(kobj, &devices_kset->list, entry) {
+		struct device *dev = kobj_to_dev(kobj);
+		unsigned int count;
+		const char *state;
+
+		if (!dev->p)
+			continue;
+		count = READ_ONCE(dev->p->deferred_probe_count);
+		if (!count)
+			continue;
+
+		if (device_is_bound(dev))
+			state = "bound";
+		else if (READ_ONCE(dev->p->deferred_on_supplier))
+			state = "waiting for supplier";
+		else
+			state = "deferred";
+		seq_printf(s, "%s\t%u\t%s\n", dev_name(dev), count, state);
+	}
+
+	spin_unlock(&devices_kset->list_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(deferred_stats);
+
 #ifdef CONFIG_MODULES
 int driver_deferred_probe_timeout = 10;
 #else
@@ -345,6 +434,8 @@ static int deferred_probe_initcall(void)
 {
 	debugfs_create_file("devices_deferred", 0444, NULL, NULL,
 			    &deferred_devs_fops);
+	debugfs_create_file("devices_deferred_stats", 0444, NULL, NULL,
+			    &deferred_stats_fops);
 
 	driver_deferred_probe_enable = true;
 	driver_deferred_probe_trigger();
@@ -408,10 +499,11 @@ static void driver_bound(struct device *dev)
 
 	/*
 	 * Make sure the device is no longer in one of the deferred lists and
-	 * kick off retrying all pending devices
+	 * kick off retrying the pending devices. Its own consumers have been
+	 * kicked by device_links_driver_bound() already.
 	 */
 	driver_deferred_probe_del(dev);
-	driver_deferred_probe_trigger();
+	__driver_deferred_probe_trigger(false);
 
 	if (dev->bus)
 		blocking_notifier_call_chain(&dev->bus->p->bus_notifier,
@@ -598,8 +690,10 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	}
 
 	link_ret = device_links_check_suppliers(dev);
-	if (link_ret == -EPROBE_DEFER)
+	if (link_ret == -EPROBE_DEFER) {
+		driver_deferred_probe_wait_supplier(dev);
 		return link_ret;
+	}
 
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
 		 drv->bus->name, __func__, drv->name, dev_name(dev));
@@ -763,6 +857,7 @@ EXPORT_SYMBOL_GPL(wait_for_device_probe);
 
 static int __driver_probe_device(struct device_driver *drv, struct device *dev)
 {
+	u64 tl_start;
 	int ret = 0;
 
 	if (dev->p->dead || !device_is_registered(dev))
@@ -779,10 +874,14 @@ static int __driver_probe_device(struct device_driver *drv, struct device *dev)
 		pm_runtime_get_sync(dev->parent);
 
 	pm_runtime_barrier(dev);
+	tl_start = boot_timeline_begin();
 	if (initcall_debug)
 		ret = really_probe_debug(dev, drv);
 	else
 		ret = really_probe(dev, drv);
+	boot_timeline_end(tl_start,
+			  ret == -EPROBE_DEFER ? "probe-deferred" : "probe",
+			  "%s %s", drv->name, dev_name(dev));
 	pm_request_idle(dev);
 
 	if (dev->parent)
@@ -814,14 +913,19 @@ static int driver_probe_device(struct device_driver *drv, struct device *dev)
 	atomic_inc(&probe_count);
 	ret = __driver_probe_device(drv, dev);
 	if (ret == -EPROBE_DEFER || ret == EPROBE_DEFER) {
+		dev->p->deferred_probe_count++;
 		driver_deferred_probe_add(dev);
 
 		/*
-		 * Did a trigger occur while probing? Need to re-trigger if yes
+		 * Did a trigger occur while probing? Need to re-trigger if yes,
+		 * this device included even if it waits for a supplier, as
+		 * that supplier may be the one that has just been bound.
 		 */
 		if (trigger_count != atomic_read(&deferred_trigger_count) &&
-		    !defer_all_probes)
-			driver_deferred_probe_trigger();
+		    !defer_all_probes) {
+			driver_deferred_probe_kick(dev);
+			__driver_deferred_probe_trigger(false);
+		}
 	}
 	atomic_dec(&probe_count);
 	wake_up_all(&probe_waitqueue);
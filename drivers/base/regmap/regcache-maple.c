@@ -0,0 +1,410 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Register cache access API - maple tree based cache
+//
+// Each entry of the tree holds the values of a block of contiguous
+// registers, so a lookup only walks the tree to the block and then
+// indexes into it. Blocks grow and merge as neighbouring registers are
+// written, and a sync writes each run of registers that needs it as one
+// raw transfer when the bus can do so.
+
+#include <linux/device.h>
+#include <linux/maple_tree.h>
+#include <linux/slab.h>
+
+#include "internal.h"
+
+/* The tree is indexed by register index, so that strides leave no gaps */
+static inline unsigned long regcache_maple_index(const struct regmap *map,
+						 unsigned int reg)
+{
+	return regcache_get_index_by_order(map, reg);
+}
+
+static int regcache_maple_read(struct regmap *map,
+			       unsigned int reg, unsigned int *value)
+{
+	struct maple_tree *mt = map->cache;
+	unsigned long index = regcache_maple_index(map, reg);
+	MA_STATE(mas, mt, index, index);
+	unsigned long *entry;
+
+	rcu_read_lock();
+
+	entry = mas_walk(&mas);
+	if (!entry) {
+		rcu_read_unlock();
+		return -ENOENT;
+	}
+
+	*value = entry[index - mas.index];
+
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int regcache_maple_write(struct regmap *map, unsigned int reg,
+				unsigned int val)
+{
+	struct maple_tree *mt = map->cache;
+	unsigned long index = regcache_maple_index(map, reg);
+	MA_STATE(mas, mt, index, index);
+	unsigned long *entry, *upper = NULL, *lower = NULL;
+	size_t lower_sz = 0, upper_sz = 0;
+	unsigned long first, last;
+	int ret;
+
+	rcu_read_lock();
+
+	entry = mas_walk(&mas);
+	if (entry) {
+		entry[index - mas.index] = val;
+		rcu_read_unlock();
+		return 0;
+	}
+
+	/* Any adjacent entries to extend/merge? */
+	first = index;
+	last = index;
+
+	if (index) {
+		mas_set_range(&mas, index - 1, index + 1);
+		lower = mas_find(&mas, index - 1);
+		if (lower) {
+			first = mas.index;
+			lower_sz = (mas.last - mas.index + 1) * sizeof(*lower);
+		}
+	} else {
+		mas_set_range(&mas, index, index + 1);
+	}
+
+	upper = mas_find(&mas, index + 1);
+	if (upper) {
+		last = mas.last;
+		upper_sz = (mas.last - mas.index + 1) * sizeof(*upper);
+	}
+
+	rcu_read_unlock();
+
+	entry = kmalloc_array(last - first + 1, sizeof(*entry),
+			      map->alloc_flags);
+	if (!entry)
+		return -ENOMEM;
+
+	if (lower)
+		memcpy(entry, lower, lower_sz);
+	entry[index - first] = val;
+	if (upper)
+		memcpy(&entry[index - first + 1], upper, upper_sz);
+
+	/*
+	 * The regmap lock already serialises all cache accesses, the maple
+	 * tree lock is only taken for the sake of its lockdep assertions.
+	 */
+	mas_lock(&mas);
+
+	mas_set_range(&mas, first, last);
+	ret = mas_store_gfp(&mas, entry, map->alloc_flags);
+
+	mas_unlock(&mas);
+
+	if (ret == 0) {
+		kfree(lower);
+		kfree(upper);
+	} else {
+		kfree(entry);
+	}
+
+	return ret;
+}
+
+static int regcache_maple_drop(struct regmap *map, unsigned int min,
+			       unsigned int max)
+{
+	struct maple_tree *mt = map->cache;
+	unsigned long lmin = regcache_maple_index(map, min);
+	unsigned long lmax = regcache_maple_index(map, max);
+	MA_STATE(mas, mt, lmin, lmax);
+	unsigned long *entry, *lower = NULL, *upper = NULL;
+	unsigned long lower_index, lower_last;
+	unsigned long upper_index, upper_last;
+	int ret = 0;
+
+	mas_lock(&mas);
+
+	mas_for_each(&mas, entry, lmax) {
+		/* Allocations have to be done without the maple tree lock */
+		mas_unlock(&mas);
+
+		/* Do we need to save any of this entry? */
+		if (mas.index < lmin) {
+			lower_index = mas.index;
+			lower_last = lmin - 1;
+
+			lower = kmemdup(entry,
+					(lmin - mas.index) * sizeof(*entry),
+					map->alloc_flags);
+			if (!lower) {
+				ret = -ENOMEM;
+				goto out_unlocked;
+			}
+		}
+
+		if (mas.last > lmax) {
+			upper_index = lmax + 1;
+			upper_last = mas.last;
+
+			upper = kmemdup(&entry[lmax - mas.index + 1],
+					(mas.last - lmax) * sizeof(*entry),
+					map->alloc_flags);
+			if (!upper) {
+				ret = -ENOMEM;
+				goto out_unlocked;
+			}
+		}
+
+		kfree(entry);
+		mas_lock(&mas);
+		mas_erase(&mas);
+
+		/* Insert new nodes with the saved data */
+		if (lower) {
+			mas_set_range(&mas, lower_index, lower_last);
+			ret = mas_store_gfp(&mas, lower, map->alloc_flags);
+			if (ret != 0)
+				goto out;
+			lower = NULL;
+		}
+
+		if (upper) {
+			mas_set_range(&mas, upper_index, upper_last);
+			ret = mas_store_gfp(&mas, upper, map->alloc_flags);
+			if (ret != 0)
+				goto out;
+			upper = NULL;
+		}
+	}
+
+out:
+	mas_unlock(&mas);
+out_unlocked:
+	kfree(lower);
+	kfree(upper);
+
+	return ret;
+}
+
+static bool regcache_maple_needs_sync(struct regmap *map, unsigned long index,
+				      unsigned int val)
+{
+	unsigned int reg = regmap_get_offset(map, index);
+
+	if (regmap_volatile(map, reg) || !regmap_writeable(map, reg))
+		return false;
+
+	return regcache_reg_needs_sync(map, reg, val);
+}
+
+/* Writes the registers from index min up to, but not including, max */
+static int regcache_maple_sync_block(struct regmap *map, unsigned long *entry,
+				     unsigned long base, unsigned long min,
+				     unsigned long max)
+{
+	size_t val_bytes = map->format.val_bytes;
+	unsigned long r;
+	void *buf;
+	int ret;
+
+	/*
+	 * Use a raw write if writing more than one register to a device
+	 * that supports raw writes, to reduce the transaction overheads.
+	 */
+	if (max - min > 1 && regmap_can_raw_write(map)) {
+		buf = kmalloc_array(max - min, val_bytes, map->alloc_flags);
+		if (!buf)
+			return -ENOMEM;
+
+		for (r = min; r < max; r++)
+			regcache_set_val(map, buf, r - min, entry[r - base]);
+
+		ret = _regmap_raw_write(map, regmap_get_offset(map, min), buf,
+					(max - min) * val_bytes, false);
+
+		kfree(buf);
+	} else {
+		for (r = min; r < max; r++) {
+			ret = _regmap_write(map, regmap_get_offset(map, r),
+					    entry[r - base]);
+			if (ret != 0)
+				break;
+		}
+	}
+
+	if (ret != 0)
+		dev_err(map->dev, "Unable to sync registers %#x-%#x. %d\n",
+			regmap_get_offset(map, min),
+			regmap_get_offset(map, max - 1), ret);
+
+	return ret;
+}
+
+static int regcache_maple_sync(struct regmap *map, unsigned int min,
+			       unsigned int max)
+{
+	struct maple_tree *mt = map->cache;
+	unsigned long lmin = regcache_maple_index(map, min);
+	unsigned long lmax = regcache_maple_index(map, max);
+	MA_STATE(mas, mt, lmin, lmax);
+	unsigned long *entry;
+	int ret = 0;
+
+	map->cache_bypass = true;
+
+	rcu_read_lock();
+
+	mas_for_each(&mas, entry, lmax) {
+		unsigned long base = mas.index;
+		unsigned long first = max(mas.index, lmin);
+		unsigned long last = min(mas.last, lmax);
+		unsigned long r, start = first;
+
+		/* Write out each run of registers needing a sync at once */
+		for (r = first; r <= last + 1; r++) {
+			if (r <= last &&
+			    regcache_maple_needs_sync(map, r, entry[r - base]))
+				continue;
+
+			if (r > start) {
+				mas_pause(&mas);
+				rcu_read_unlock();
+
+				ret = regcache_maple_sync_block(map, entry,
+								base, start, r);
+				if (ret != 0)
+					goto out;
+
+				rcu_read_lock();
+			}
+
+			start = r + 1;
+		}
+	}
+
+	rcu_read_unlock();
+out:
+	map->cache_bypass = false;
+
+	return ret;
+}
+
+static int regcache_maple_exit(struct regmap *map)
+{
+	struct maple_tree *mt = map->cache;
+	MA_STATE(mas, mt, 0, ULONG_MAX);
+	unsigned long *entry;
+
+	/* if we've already been called then just return */
+	if (!mt)
+		return 0;
+
+	mas_lock(&mas);
+	mas_for_each(&mas, entry, ULONG_MAX)
+		kfree(entry);
+	__mt_destroy(mt);
+	mas_unlock(&mas);
+
+	kfree(mt);
+	map->cache = NULL;
+
+	return 0;
+}
+
+static int regcache_maple_insert_block(struct regmap *map, int first,
+				       int last)
+{
+	struct maple_tree *mt = map->cache;
+	MA_STATE(mas, mt, 0, 0);
+	unsigned long *entry;
+	int i, ret;
+
+	entry = kcalloc(last - first + 1, sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return -ENOMEM;
+
+	for (i = 0; i < last - first + 1; i++)
+		entry[i] = map->reg_defaults[first + i].def;
+
+	mas_lock(&mas);
+
+	mas_set_range(&mas,
+		      regcache_maple_index(map, map->reg_defaults[first].reg),
+		      regcache_maple_index(map, map->reg_defaults[last].reg));
+	ret = mas_store_gfp(&mas, entry, GFP_KERNEL);
+
+	mas_unlock(&mas);
+
+	if (ret)
+		kfree(entry);
+
+	return ret;
+}
+
+static int regcache_maple_init(struct regmap *map)
+{
+	struct maple_tree *mt;
+	int i, ret, range_start;
+
+	if (map->reg_stride_order < 0)
+		return -EINVAL;
+
+	mt = kmalloc(sizeof(*mt), GFP_KERNEL);
+	if (!mt)
+		return -ENOMEM;
+	map->cache = mt;
+
+	mt_init(mt);
+
+	if (!map->num_reg_defaults)
+		return 0;
+
+	/* The defaults are sorted, add each run of contiguous registers */
+	range_start = 0;
+	for (i = 1; i < map->num_reg_defaults; i++) {
+		unsigned long index, prev;
+
+		index = regcache_maple_index(map, map->reg_defaults[i].reg);
+		prev = regcache_maple_index(map, map->reg_defaults[i - 1].reg);
+		if (index == prev + 1)
+			continue;
+
+		ret = regcache_maple_insert_block(map, range_start, i - 1);
+		if (ret != 0)
+			goto err;
+
+		range_start = i;
+	}
+
+	/* Add the last block */
+	ret = regcache_maple_insert_block(map, range_start,
+					  map->num_reg_defaults - 1);
+	if (ret != 0)
+		goto err;
+
+	return 0;
+
+err:
+	regcache_maple_exit(map);
+	return ret;
+}
+
+struct regcache_ops regcache_maple_ops = {
+	.type = REGCACHE_MAPLE,
+	.name = "maple",
+	.init = regcache_maple_init,
+	.exit = regcache_maple_exit,
+	.read = regcache_maple_read,
+	.write = regcache_maple_write,
+	.drop = regcache_maple_drop,
+	.sync = regcache_maple_sync,
+};
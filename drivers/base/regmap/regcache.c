@@ -21,6 +21,7 @@ static const struct regcache_ops *cache_types[] = {
 	&regcache_lzo_ops,
 #endif
 	&regcache_flat_ops,
+	&regcache_maple_ops,
 };
 
 static int regcache_hw_init(struct regmap *map)
@@ -281,8 +282,8 @@ int regcache_write(struct regmap *map,
 	return 0;
 }
 
-static bool regcache_reg_needs_sync(struct regmap *map, unsigned int reg,
-				    unsigned int val)
+bool regcache_reg_needs_sync(struct regmap *map, unsigned int reg,
+			     unsigned int val)
 {
 	int ret;
 
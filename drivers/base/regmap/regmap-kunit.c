@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// regmap KUnit tests
+//
+// The register caches are run against a RAM backed map that counts the
+// transactions it sees. The benchmark case only reports its timings.
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+
+#define REGMAP_TEST_MAX_REG		0x7fff
+#define REGMAP_TEST_BANKS		8
+#define REGMAP_TEST_BANK_SIZE		128
+#define REGMAP_TEST_BANK_STRIDE		0x1000
+#define REGMAP_TEST_DEFAULTS		(REGMAP_TEST_BANKS * REGMAP_TEST_BANK_SIZE)
+#define REGMAP_TEST_BENCH_LOOPS		(1 << 16)
+
+struct regmap_test_ram {
+	unsigned int vals[REGMAP_TEST_MAX_REG + 1];
+	unsigned int reads;
+	unsigned int writes;
+};
+
+static int regmap_test_ram_write(void *context, const void *data,
+				 size_t count)
+{
+	struct regmap_test_ram *ram = context;
+	unsigned int reg, n;
+
+	memcpy(&reg, data, sizeof(reg));
+	n = count / sizeof(u32) - 1;
+	if (reg + n > REGMAP_TEST_MAX_REG + 1)
+		return -EINVAL;
+
+	memcpy(&ram->vals[reg], data + sizeof(reg), n * sizeof(u32));
+	ram->writes++;
+
+	return 0;
+}
+
+static int regmap_test_ram_read(void *context, const void *reg_buf,
+				size_t reg_size, void *val_buf,
+				size_t val_size)
+{
+	struct regmap_test_ram *ram = context;
+	unsigned int reg;
+
+	memcpy(&reg, reg_buf, sizeof(reg));
+	if (reg + val_size / sizeof(u32) > REGMAP_TEST_MAX_REG + 1)
+		return -EINVAL;
+
+	memcpy(val_buf, &ram->vals[reg], val_size);
+	ram->reads++;
+
+	return 0;
+}
+
+struct regmap_test_param {
+	enum regcache_type type;
+	const char *name;
+};
+
+static const struct regmap_test_param regmap_test_params[] = {
+	{ REGCACHE_FLAT, "flat" },
+	{ REGCACHE_RBTREE, "rbtree" },
+	{ REGCACHE_MAPLE, "maple" },
+};
+
+static void regmap_test_param_desc(const struct regmap_test_param *param,
+				   char *desc)
+{
+	strscpy(desc, param->name, KUNIT_PARAM_DESC_SIZE);
+}
+
+KUNIT_ARRAY_PARAM(regmap_test_cache, regmap_test_params,
+		  regmap_test_param_desc);
+
+/* Sparse banks of registers with defaults, as on a large codec */
+static struct regmap *regmap_test_init(struct kunit *test,
+				       struct regmap_test_ram **ramp)
+{
+	const struct regmap_test_param *param = test->param_value;
+	struct regmap_config config = {
+		.name = "kunit",
+		.reg_bits = 32,
+		.val_bits = 32,
+		.max_register = REGMAP_TEST_MAX_REG,
+		.cache_type = param->type,
+		.read = regmap_test_ram_read,
+		.write = regmap_test_ram_write,
+	};
+	struct regmap_test_ram *ram;
+	struct reg_default *defaults;
+	struct regmap *map;
+	int bank, i, n = 0;
+
+	ram = kunit_kzalloc(test, sizeof(*ram), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ram);
+
+	defaults = kunit_kcalloc(test, REGMAP_TEST_DEFAULTS,
+				 sizeof(*defaults), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, defaults);
+
+	for (bank = 0; bank < REGMAP_TEST_BANKS; bank++) {
+		for (i = 0; i < REGMAP_TEST_BANK_SIZE; i++, n++) {
+			defaults[n].reg = bank * REGMAP_TEST_BANK_STRIDE + i;
+			defaults[n].def = n;
+			ram->vals[defaults[n].reg] = n;
+		}
+	}
+	config.reg_defaults = defaults;
+	config.num_reg_defaults = n;
+
+	map = regmap_init(NULL, NULL, ram, &config);
+	KUNIT_ASSERT_FALSE(test, IS_ERR(map));
+	test->priv = map;
+
+	*ramp = ram;
+
+	return map;
+}
+
+static void regmap_test_write_read(struct kunit *test)
+{
+	struct regmap_test_ram *ram;
+	struct regmap *map = regmap_test_init(test, &ram);
+	unsigned int reg, val;
+
+	for (reg = 0; reg < 2 * REGMAP_TEST_BANK_STRIDE; reg += 3) {
+		KUNIT_ASSERT_EQ(test, 0, regmap_write(map, reg, reg ^ 0x5a5a));
+		KUNIT_EXPECT_EQ(test, reg ^ 0x5a5a, ram->vals[reg]);
+	}
+
+	/* Everything written is in the cache, so comes back from there */
+	ram->reads = 0;
+	for (reg = 0; reg < 2 * REGMAP_TEST_BANK_STRIDE; reg += 3) {
+		KUNIT_ASSERT_EQ(test, 0, regmap_read(map, reg, &val));
+		KUNIT_EXPECT_EQ(test, reg ^ 0x5a5a, val);
+	}
+	KUNIT_EXPECT_EQ(test, 0, ram->reads);
+}
+
+static void regmap_test_sync(struct kunit *test)
+{
+	const struct regmap_test_param *param = test->param_value;
+	struct regmap_test_ram *ram;
+	struct regmap *map = regmap_test_init(test, &ram);
+	unsigned int reg, base = 2 * REGMAP_TEST_BANK_STRIDE;
+
+	regcache_cache_only(map, true);
+	for (reg = base; reg < base + 16; reg++)
+		KUNIT_ASSERT_EQ(test, 0, regmap_write(map, reg, ~reg));
+	KUNIT_EXPECT_EQ(test, 0, ram->writes);
+
+	/* Only the registers changed from their defaults are written */
+	regcache_cache_only(map, false);
+	regcache_mark_dirty(map);
+	KUNIT_ASSERT_EQ(test, 0, regcache_sync(map));
+
+	for (reg = base; reg < base + 16; reg++)
+		KUNIT_EXPECT_EQ(test, ~reg, ram->vals[reg]);
+
+	/* in one transfer, except with the flat cache */
+	if (param->type != REGCACHE_FLAT)
+		KUNIT_EXPECT_EQ(test, 1, ram->writes);
+}
+
+static void regmap_test_drop(struct kunit *test)
+{
+	const struct regmap_test_param *param = test->param_value;
+	struct regmap_test_ram *ram;
+	struct regmap *map = regmap_test_init(test, &ram);
+	unsigned int reg, val;
+
+	if (param->type == REGCACHE_FLAT)
+		kunit_skip(test, "the flat cache can't drop registers");
+
+	for (reg = 0; reg < 16; reg++)
+		KUNIT_ASSERT_EQ(test, 0, regmap_write(map, reg, ~reg));
+
+	/* Dropped registers come from the hardware again, the others don't */
+	KUNIT_ASSERT_EQ(test, 0, regcache_drop_region(map, 4, 7));
+	ram->vals[5] = 0x1234;
+	ram->vals[8] = 0x1234;
+
+	KUNIT_ASSERT_EQ(test, 0, regmap_read(map, 5, &val));
+	KUNIT_EXPECT_EQ(test, 0x1234, val);
+	KUNIT_ASSERT_EQ(test, 0, regmap_read(map, 8, &val));
+	KUNIT_EXPECT_EQ(test, ~8U, val);
+	KUNIT_ASSERT_EQ(test, 0, regmap_read(map, 3, &val));
+	KUNIT_EXPECT_EQ(test, ~3U, val);
+	KUNIT_EXPECT_EQ(test, 1, ram->reads);
+}
+
+/* Accesses all over the banks, in the same order for every cache */
+static unsigned int regmap_test_bench_reg(unsigned int *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+
+	return (*seed >> 8) % REGMAP_TEST_BANKS * REGMAP_TEST_BANK_STRIDE +
+	       (*seed >> 20) % REGMAP_TEST_BANK_SIZE;
+}
+
+static void regmap_test_benchmark(struct kunit *test)
+{
+	const struct regmap_test_param *param = test->param_value;
+	struct regmap_test_ram *ram;
+	struct regmap *map = regmap_test_init(test, &ram);
+	unsigned int i, reg, val, seed = 1;
+	u64 start, read_ns, write_ns;
+
+	start = ktime_get_ns();
+	for (i = 0; i < REGMAP_TEST_BENCH_LOOPS; i++) {
+		reg = regmap_test_bench_reg(&seed);
+		regmap_read(map, reg, &val);
+	}
+	read_ns = ktime_get_ns() - start;
+
+	regcache_cache_only(map, true);
+	seed = 1;
+	start = ktime_get_ns();
+	for (i = 0; i < REGMAP_TEST_BENCH_LOOPS; i++) {
+		reg = regmap_test_bench_reg(&seed);
+		regmap_write(map, reg, i);
+	}
+	write_ns = ktime_get_ns() - start;
+	regcache_cache_only(map, false);
+
+	KUNIT_EXPECT_EQ(test, 0, ram->reads);
+	kunit_info(test, "%s: %llu ns per cached read, %llu ns per cached write\n",
+		   param->name, div_u64(read_ns, REGMAP_TEST_BENCH_LOOPS),
+		   div_u64(write_ns, REGMAP_TEST_BENCH_LOOPS));
+}
+
+static struct kunit_case regmap_test_cases[] = {
+	KUNIT_CASE_PARAM(regmap_test_write_read, regmap_test_cache_gen_params),
+	KUNIT_CASE_PARAM(regmap_test_sync, regmap_test_cache_gen_params),
+	KUNIT_CASE_PARAM(regmap_test_drop, regmap_test_cache_gen_params),
+	KUNIT_CASE_PARAM(regmap_test_benchmark, regmap_test_cache_gen_params),
+	{}
+};
+
+static void regmap_test_exit(struct kunit *test)
+{
+	if (test->priv)
+		regmap_exit(test->priv);
+}
+
+static struct kunit_suite regmap_test_suite = {
+	.name = "regmap",
+	.exit = regmap_test_exit,
+	.test_cases = regmap_test_cases,
+};
+kunit_test_suite(regmap_test_suite);
+
+MODULE_LICENSE("GPL v2");
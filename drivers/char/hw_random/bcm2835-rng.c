@@ -7,6 +7,7 @@
 #include <linux/hw_random.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/kfifo.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
 #include <linux/of_platform.h>
@@ -15,6 +16,8 @@
 #include <linux/clk.h>
 #include <linux/reset.h>
 #include <linux/delay.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #define RNG_CTRL	0x0
 #define RNG_STATUS	0x4
@@ -23,6 +26,8 @@
 
 /* enable rng */
 #define RNG_RBGEN	0x1
+/* double speed, less random mode */
+#define RNG_RBG2X	0x2
 
 /* the initial numbers generated are "less random" so will be discarded */
 #define RNG_WARMUP_COUNT 0x40000
@@ -32,12 +37,26 @@
 #define RNG_FIFO_WORDS	4
 #define RNG_US_PER_WORD	34 /* Tuned for throughput */
 
+/* words kept ready for the hwrng core, must be a power of two */
+#define RNG_POOL_WORDS	1024
+/* largest number of words moved from the FIFO to the pool at once */
+#define RNG_BURST_WORDS	16
+
+static bool double_speed;
+module_param(double_speed, bool, 0444);
+MODULE_PARM_DESC(double_speed,
+		 "Run the generator in its faster but less random mode");
+
 struct bcm2835_rng_priv {
 	struct hwrng rng;
 	void __iomem *base;
 	bool mask_interrupts;
 	struct clk *clk;
 	struct reset_control *reset;
+	/* filled by fill_work, drained by bcm2835_rng_read() */
+	DECLARE_KFIFO(pool, u32, RNG_POOL_WORDS);
+	struct work_struct fill_work;
+	wait_queue_head_t pool_wait;
 };
 
 static inline struct bcm2835_rng_priv *to_rng_priv(struct hwrng *rng)
@@ -65,29 +84,65 @@ static inline void rng_writel(struct bcm2835_rng_priv *priv, u32 val,
 		writel(val, priv->base + offset);
 }
 
+/*
+ * The hardware FIFO is drained in the background into a pool, so that
+ * readers get whole buffers at once instead of a few words per status
+ * poll. This work is the only reader of the hardware FIFO.
+ */
+static void bcm2835_rng_fill(struct work_struct *work)
+{
+	struct bcm2835_rng_priv *priv =
+		container_of(work, struct bcm2835_rng_priv, fill_work);
+	u32 retries = 1000000/(RNG_FIFO_WORDS * RNG_US_PER_WORD);
+	u32 burst[RNG_BURST_WORDS];
+	u32 num_words, count;
+
+	while (!kfifo_is_full(&priv->pool)) {
+		num_words = rng_readl(priv, RNG_STATUS) >> 24;
+		if (!num_words) {
+			/* stalled, the next read will try again */
+			if (!retries--)
+				return;
+			usleep_range((u32)RNG_US_PER_WORD,
+				     (u32)RNG_US_PER_WORD * RNG_FIFO_WORDS);
+			continue;
+		}
+
+		num_words = min3(num_words, kfifo_avail(&priv->pool),
+				 (u32)RNG_BURST_WORDS);
+
+		for (count = 0; count < num_words; count++)
+			burst[count] = rng_readl(priv, RNG_DATA);
+
+		kfifo_in(&priv->pool, burst, num_words);
+		wake_up(&priv->pool_wait);
+	}
+}
+
 static int bcm2835_rng_read(struct hwrng *rng, void *buf, size_t max,
 			       bool wait)
 {
-	u32 retries = 1000000/(RNG_FIFO_WORDS * RNG_US_PER_WORD);
 	struct bcm2835_rng_priv *priv = to_rng_priv(rng);
 	u32 max_words = max / sizeof(u32);
-	u32 num_words, count;
-
-	num_words = rng_readl(priv, RNG_STATUS) >> 24;
+	u32 num_words;
+	long ret;
 
-	while (!num_words) {
-		if (!wait || !retries)
+	if (kfifo_is_empty(&priv->pool)) {
+		queue_work(system_unbound_wq, &priv->fill_work);
+		if (!wait)
 			return 0;
-		retries--;
-		usleep_range((u32)RNG_US_PER_WORD,
-			     (u32)RNG_US_PER_WORD * RNG_FIFO_WORDS);
-		num_words = rng_readl(priv, RNG_STATUS) >> 24;
+
+		ret = wait_event_interruptible_timeout(priv->pool_wait,
+					!kfifo_is_empty(&priv->pool), HZ);
+		if (ret < 0)
+			return ret;
 	}
 
-	num_words = min(num_words, max_words);
+	/* the hwrng core serialises reads, so there is a single consumer */
+	num_words = kfifo_out(&priv->pool, (u32 *)buf, max_words);
 
-	for (count = 0; count < num_words; count++)
-		((u32 *)buf)[count] = rng_readl(priv, RNG_DATA);
+	if (kfifo_len(&priv->pool) < RNG_POOL_WORDS / 2)
+		queue_work(system_unbound_wq, &priv->fill_work);
 
 	return num_words * sizeof(u32);
 }
@@ -116,9 +171,13 @@ static int bcm2835_rng_init(struct hwrng *rng)
 	/* set warm-up count & enable */
 	if (!(rng_readl(priv, RNG_CTRL) & RNG_RBGEN)) {
 		rng_writel(priv, RNG_WARMUP_COUNT, RNG_STATUS);
-		rng_writel(priv, RNG_RBGEN, RNG_CTRL);
+		rng_writel(priv, RNG_RBGEN | (double_speed ? RNG_RBG2X : 0),
+			   RNG_CTRL);
 	}
 
+	/* start filling the pool before anybody asks for it */
+	queue_work(system_unbound_wq, &priv->fill_work);
+
 	return ret;
 }
 
@@ -126,6 +185,9 @@ static void bcm2835_rng_cleanup(struct hwrng *rng)
 {
 	struct bcm2835_rng_priv *priv = to_rng_priv(rng);
 
+	cancel_work_sync(&priv->fill_work);
+	kfifo_reset(&priv->pool);
+
 	/* disable rng hardware */
 	rng_writel(priv, 0, RNG_CTRL);
 
@@ -162,6 +224,10 @@ static int bcm2835_rng_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, priv);
 
+	INIT_KFIFO(priv->pool);
+	INIT_WORK(&priv->fill_work, bcm2835_rng_fill);
+	init_waitqueue_head(&priv->pool_wait);
+
 	/* map peripheral */
 	priv->base = devm_platform_ioremap_resource(pdev, 0);
 	if (IS_ERR(priv->base))
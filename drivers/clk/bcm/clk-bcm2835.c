@@ -710,6 +710,21 @@ static int bcm2835_pll_set_rate(struct clk_hw *hw,
 
 	was_using_prediv = ana[1] & prediv_mask;
 
+	/*
+	 * If only the fractional part of the multiplier changes on a
+	 * running PLL, the sigma-delta modulator follows the new value
+	 * without the PLL losing lock, so small rate trims can be made
+	 * on the fly and without touching the analog setup.
+	 */
+	a2w_ctl = cprman_read(cprman, data->a2w_ctrl_reg);
+	if (bcm2835_pll_is_on(hw) && was_using_prediv == use_fb_prediv &&
+	    (a2w_ctl & (A2W_PLL_CTRL_NDIV_MASK | A2W_PLL_CTRL_PDIV_MASK)) ==
+	    ((ndiv << A2W_PLL_CTRL_NDIV_SHIFT) |
+	     (1 << A2W_PLL_CTRL_PDIV_SHIFT))) {
+		cprman_write(cprman, data->frac_reg, fdiv);
+		return 0;
+	}
+
 	ana[0] &= ~data->ana->mask0;
 	ana[0] |= data->ana->set0;
 	ana[1] &= ~data->ana->mask1;
@@ -1142,6 +1157,20 @@ static int bcm2835_clock_set_rate_and_parent(struct clk_hw *hw,
 
 	ctl = cprman_read(cprman, data->ctl_reg);
 
+	/* A running fractional clock whose source and integer divisor stay
+	 * the same only needs its fraction updated, which the divider picks
+	 * up on the fly. This lets consumers trim their rate by a few ppm,
+	 * e.g. to track an external audio clock, without stopping it.
+	 */
+	if ((ctl & CM_ENABLE) && (ctl & CM_FRAC) && parent == 0xff &&
+	    (div & CM_DIV_FRAC_MASK) &&
+	    (div & ~CM_DIV_FRAC_MASK) ==
+	    (cprman_read(cprman, data->div_reg) & ~CM_DIV_FRAC_MASK)) {
+		cprman_write(cprman, data->div_reg, div);
+		spin_unlock(&cprman->regs_lock);
+		return 0;
+	}
+
 	/* If the clock is running, we have to pause clock generation while
 	 * updating the control and div regs.  This is glitchless (no clock
 	 * signals generated faster than the rate) but each reg access is two
@@ -13,8 +13,10 @@
 #include <linux/clkdev.h>
 #include <linux/clk-provider.h>
 #include <linux/io.h>
+#include <linux/jiffies.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
 
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
@@ -40,6 +42,15 @@ static char *rpi_firmware_clk_names[] = {
 #define RPI_FIRMWARE_STATE_ENABLE_BIT	BIT(0)
 #define RPI_FIRMWARE_STATE_WAIT_BIT	BIT(1)
 
+/* set by the firmware in req_resp_size of every tag it answered */
+#define RPI_FIRMWARE_TAG_RESPONSE_BIT	BIT(31)
+
+/*
+ * The firmware may change clock rates on its own, e.g. when throttling
+ * the ARM clock, so cached values are only trusted for a short while.
+ */
+#define RPI_FIRMWARE_CLK_CACHE_MS	100
+
 struct raspberrypi_clk_variant;
 
 struct raspberrypi_clk {
@@ -55,10 +66,20 @@ struct raspberrypi_clk_data {
 	struct raspberrypi_clk_variant *variant;
 
 	struct raspberrypi_clk *rpi;
+
+	/*
+	 * Last values read from or written to the firmware. All accesses
+	 * happen from clk_ops called with the clock framework's prepare
+	 * lock held, so no locking of our own is needed.
+	 */
+	unsigned long rate;
+	unsigned long rate_expires;
+	bool prepared;
+	unsigned long prepared_expires;
 };
 
 static inline
-const struct raspberrypi_clk_data *clk_hw_to_data(const struct clk_hw *hw)
+struct raspberrypi_clk_data *clk_hw_to_data(struct clk_hw *hw)
 {
 	return container_of(hw, struct raspberrypi_clk_data, hw);
 }
@@ -186,59 +207,96 @@ static int raspberrypi_clock_property(struct rpi_firmware *firmware,
 	return 0;
 }
 
+static unsigned long raspberrypi_clk_cache_expiry(void)
+{
+	return jiffies + msecs_to_jiffies(RPI_FIRMWARE_CLK_CACHE_MS);
+}
+
+static void raspberrypi_clk_cache_rate(struct raspberrypi_clk_data *data,
+				       unsigned long rate)
+{
+	data->rate = rate;
+	data->rate_expires = raspberrypi_clk_cache_expiry();
+}
+
+static void raspberrypi_clk_cache_state(struct raspberrypi_clk_data *data,
+					u32 state)
+{
+	data->prepared = !!(state & RPI_FIRMWARE_STATE_ENABLE_BIT);
+	data->prepared_expires = raspberrypi_clk_cache_expiry();
+}
+
 static int raspberrypi_fw_is_prepared(struct clk_hw *hw)
 {
-	const struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
+	struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
 	struct raspberrypi_clk *rpi = data->rpi;
 	u32 val = 0;
 	int ret;
 
+	if (time_before(jiffies, data->prepared_expires))
+		return data->prepared;
+
 	ret = raspberrypi_clock_property(rpi->firmware, data,
 					 RPI_FIRMWARE_GET_CLOCK_STATE, &val);
 	if (ret)
 		return 0;
 
-	return !!(val & RPI_FIRMWARE_STATE_ENABLE_BIT);
+	raspberrypi_clk_cache_state(data, val);
+
+	return data->prepared;
 }
 
 
 static unsigned long raspberrypi_fw_get_rate(struct clk_hw *hw,
 					     unsigned long parent_rate)
 {
-	const struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
+	struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
 	struct raspberrypi_clk *rpi = data->rpi;
 	u32 val = 0;
 	int ret;
 
+	if (time_before(jiffies, data->rate_expires))
+		return data->rate;
+
 	ret = raspberrypi_clock_property(rpi->firmware, data,
 					 RPI_FIRMWARE_GET_CLOCK_RATE, &val);
 	if (ret)
 		return 0;
 
+	raspberrypi_clk_cache_rate(data, val);
+
 	return val;
 }
 
 static int raspberrypi_fw_set_rate(struct clk_hw *hw, unsigned long rate,
 				   unsigned long parent_rate)
 {
-	const struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
+	struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
 	struct raspberrypi_clk *rpi = data->rpi;
 	u32 _rate = rate;
 	int ret;
 
+	/* whatever the outcome, the next read goes to the firmware */
+	data->rate_expires = jiffies;
+
 	ret = raspberrypi_clock_property(rpi->firmware, data,
 					 RPI_FIRMWARE_SET_CLOCK_RATE, &_rate);
-	if (ret)
+	if (ret) {
 		dev_err_ratelimited(rpi->dev, "Failed to change %s frequency: %d\n",
 				    clk_hw_get_name(hw), ret);
+		return ret;
+	}
 
-	return ret;
+	/* the firmware answers with the rate it actually programmed */
+	raspberrypi_clk_cache_rate(data, _rate);
+
+	return 0;
 }
 
 static int raspberrypi_fw_dumb_determine_rate(struct clk_hw *hw,
 					      struct clk_rate_request *req)
 {
-	const struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
+	struct raspberrypi_clk_data *data = clk_hw_to_data(hw);
 	struct raspberrypi_clk_variant *variant = data->variant;
 
 	/*
@@ -267,14 +325,59 @@ static const struct clk_ops raspberrypi_firmware_clk_ops = {
 	.set_rate	= raspberrypi_fw_set_rate,
 };
 
-static struct clk_hw *raspberrypi_clk_register(struct raspberrypi_clk *rpi,
-					       unsigned int parent,
-					       unsigned int id,
-					       struct raspberrypi_clk_variant *variant)
+/*
+ * Everything we need to know about a clock before registering it,
+ * fetched for all the clocks at once in a single property list.
+ */
+enum raspberrypi_clk_query_tag {
+	RPI_CLK_QUERY_MIN_RATE,
+	RPI_CLK_QUERY_MAX_RATE,
+	RPI_CLK_QUERY_RATE,
+	RPI_CLK_QUERY_STATE,
+	RPI_CLK_QUERY_NUM
+};
+
+static const u32 raspberrypi_clk_query_tags[RPI_CLK_QUERY_NUM] = {
+	[RPI_CLK_QUERY_MIN_RATE]	= RPI_FIRMWARE_GET_MIN_CLOCK_RATE,
+	[RPI_CLK_QUERY_MAX_RATE]	= RPI_FIRMWARE_GET_MAX_CLOCK_RATE,
+	[RPI_CLK_QUERY_RATE]		= RPI_FIRMWARE_GET_CLOCK_RATE,
+	[RPI_CLK_QUERY_STATE]		= RPI_FIRMWARE_GET_CLOCK_STATE,
+};
+
+struct raspberrypi_clk_query {
+	struct rpi_firmware_property_tag_header tag;
+	struct raspberrypi_firmware_prop prop;
+} __packed;
+
+static int raspberrypi_clk_query_get(struct raspberrypi_clk *rpi,
+				     const struct raspberrypi_clk_query *query,
+				     unsigned int id,
+				     enum raspberrypi_clk_query_tag tag,
+				     u32 *val)
+{
+	const struct raspberrypi_clk_query *q = &query[tag];
+
+	if (!(q->tag.req_resp_size & RPI_FIRMWARE_TAG_RESPONSE_BIT)) {
+		dev_err(rpi->dev, "No answer to tag 0x%08x for clock %u\n",
+			q->tag.tag, id);
+		return -EINVAL;
+	}
+
+	*val = le32_to_cpu(q->prop.val);
+
+	return 0;
+}
+
+static struct clk_hw *
+raspberrypi_clk_register(struct raspberrypi_clk *rpi,
+			 unsigned int parent,
+			 unsigned int id,
+			 struct raspberrypi_clk_variant *variant,
+			 const struct raspberrypi_clk_query *query)
 {
 	struct raspberrypi_clk_data *data;
 	struct clk_init_data init = {};
-	u32 min_rate, max_rate;
+	u32 min_rate, max_rate, rate, state;
 	int ret;
 
 	data = devm_kzalloc(rpi->dev, sizeof(*data), GFP_KERNEL);
@@ -292,23 +395,26 @@ static struct clk_hw *raspberrypi_clk_register(struct raspberrypi_clk *rpi,
 
 	data->hw.init = &init;
 
-	ret = raspberrypi_clock_property(rpi->firmware, data,
-					 RPI_FIRMWARE_GET_MIN_CLOCK_RATE,
-					 &min_rate);
-	if (ret) {
-		dev_err(rpi->dev, "Failed to get clock %d min freq: %d\n",
-			id, ret);
+	ret = raspberrypi_clk_query_get(rpi, query, id,
+					RPI_CLK_QUERY_MIN_RATE, &min_rate);
+	if (ret)
 		return ERR_PTR(ret);
-	}
 
-	ret = raspberrypi_clock_property(rpi->firmware, data,
-					 RPI_FIRMWARE_GET_MAX_CLOCK_RATE,
-					 &max_rate);
-	if (ret) {
-		dev_err(rpi->dev, "Failed to get clock %d max freq: %d\n",
-			id, ret);
+	ret = raspberrypi_clk_query_get(rpi, query, id,
+					RPI_CLK_QUERY_MAX_RATE, &max_rate);
+	if (ret)
 		return ERR_PTR(ret);
-	}
+
+	/*
+	 * The current rate and state are only a head start for the
+	 * cache, the firmware is asked again once they expire.
+	 */
+	if (!raspberrypi_clk_query_get(rpi, query, id,
+				       RPI_CLK_QUERY_RATE, &rate))
+		raspberrypi_clk_cache_rate(data, rate);
+	if (!raspberrypi_clk_query_get(rpi, query, id,
+				       RPI_CLK_QUERY_STATE, &state))
+		raspberrypi_clk_cache_state(data, state);
 
 	ret = devm_clk_hw_register(rpi->dev, &data->hw);
 	if (ret)
@@ -346,11 +452,61 @@ struct rpi_firmware_get_clocks_response {
 	u32 id;
 };
 
+/*
+ * Ask for the range, rate and state of every exported clock in one
+ * mailbox transaction rather than several per clock.
+ */
+static struct raspberrypi_clk_query *
+raspberrypi_clk_query_all(struct raspberrypi_clk *rpi,
+			  const struct rpi_firmware_get_clocks_response *clks)
+{
+	const struct rpi_firmware_get_clocks_response *clk;
+	struct raspberrypi_clk_query *query, *q;
+	unsigned int count = 0, i;
+	int ret;
+
+	for (clk = clks; clk->id; clk++)
+		if (raspberrypi_clk_variants[clk->id].export)
+			count++;
+
+	if (!count)
+		return NULL;
+
+	query = kcalloc(count * RPI_CLK_QUERY_NUM, sizeof(*query),
+			GFP_KERNEL);
+	if (!query)
+		return ERR_PTR(-ENOMEM);
+
+	q = query;
+	for (clk = clks; clk->id; clk++) {
+		if (!raspberrypi_clk_variants[clk->id].export)
+			continue;
+
+		for (i = 0; i < RPI_CLK_QUERY_NUM; i++, q++) {
+			q->tag.tag = raspberrypi_clk_query_tags[i];
+			q->tag.buf_size = sizeof(q->prop);
+			q->prop.id = cpu_to_le32(clk->id);
+		}
+	}
+
+	ret = rpi_firmware_property_list(rpi->firmware, query,
+					 count * RPI_CLK_QUERY_NUM *
+					 sizeof(*query));
+	if (ret) {
+		dev_err(rpi->dev, "Failed to query clocks: %d\n", ret);
+		kfree(query);
+		return ERR_PTR(ret);
+	}
+
+	return query;
+}
+
 static int raspberrypi_discover_clocks(struct raspberrypi_clk *rpi,
 				       struct clk_hw_onecell_data *data)
 {
-	struct rpi_firmware_get_clocks_response *clks;
-	int ret;
+	struct rpi_firmware_get_clocks_response *clks, *clk;
+	struct raspberrypi_clk_query *query, *q;
+	int ret = 0;
 
 	/*
 	 * The firmware doesn't guarantee that the last element of
@@ -369,32 +525,42 @@ static int raspberrypi_discover_clocks(struct raspberrypi_clk *rpi,
 	if (ret)
 		return ret;
 
-	while (clks->id) {
-		struct raspberrypi_clk_variant *variant;
-
-		if (clks->id >= RPI_FIRMWARE_NUM_CLK_ID) {
+	for (clk = clks; clk->id; clk++) {
+		if (clk->id >= RPI_FIRMWARE_NUM_CLK_ID) {
 			dev_err(rpi->dev, "Unknown clock id: %u (max: %u)\n",
-					   clks->id, RPI_FIRMWARE_NUM_CLK_ID - 1);
+					   clk->id, RPI_FIRMWARE_NUM_CLK_ID - 1);
 			return -EINVAL;
 		}
+	}
 
-		variant = &raspberrypi_clk_variants[clks->id];
-		if (variant->export) {
-			struct clk_hw *hw;
+	query = raspberrypi_clk_query_all(rpi, clks);
+	if (IS_ERR_OR_NULL(query))
+		return PTR_ERR(query);
 
-			hw = raspberrypi_clk_register(rpi, clks->parent,
-						      clks->id, variant);
-			if (IS_ERR(hw))
-				return PTR_ERR(hw);
+	q = query;
+	for (clk = clks; clk->id; clk++) {
+		struct raspberrypi_clk_variant *variant;
+		struct clk_hw *hw;
+
+		variant = &raspberrypi_clk_variants[clk->id];
+		if (!variant->export)
+			continue;
 
-			data->hws[clks->id] = hw;
-			data->num = clks->id + 1;
+		hw = raspberrypi_clk_register(rpi, clk->parent, clk->id,
+					      variant, q);
+		if (IS_ERR(hw)) {
+			ret = PTR_ERR(hw);
+			break;
 		}
 
-		clks++;
+		data->hws[clk->id] = hw;
+		data->num = clk->id + 1;
+		q += RPI_CLK_QUERY_NUM;
 	}
 
-	return 0;
+	kfree(query);
+
+	return ret;
 }
 
 static int raspberrypi_clk_probe(struct platform_device *pdev)
@@ -9,15 +9,175 @@
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
 #include <linux/module.h>
+#include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/pm_opp.h>
+#include <linux/spinlock.h>
+
+#include <soc/bcm2835/raspberrypi-firmware.h>
+#include <soc/bcm2835/raspberrypi-firmware-async.h>
 
 #define RASPBERRYPI_FREQ_INTERVAL	100000000
 
-static struct platform_device *cpufreq_dt;
+/*
+ * The firmware's SET_CLOCK_RATE tag, as used by clk-raspberrypi. It is
+ * sent from here for fast switching, which can't go through the clock
+ * framework.
+ */
+struct raspberrypi_cpufreq_prop {
+	__le32 id;
+	__le32 val;
+	__le32 disable_turbo;
+} __packed;
+
+struct raspberrypi_cpufreq_data {
+	struct device *dev;
+	struct rpi_firmware_request *req;
+
+	/* Protects the fields below */
+	spinlock_t lock;
+	/* A change is waiting for the firmware */
+	bool busy;
+	/* The rate to set once it is done, or 0 */
+	unsigned long next_rate;
+};
+
+static int raspberrypi_cpufreq_set_target(struct cpufreq_policy *policy,
+					  unsigned int index)
+{
+	unsigned long freq = policy->freq_table[index].frequency;
+
+	return clk_set_rate(policy->clk, freq * 1000);
+}
+
+/* Called with rcf->lock held, a failed change is retried by the next one */
+static int raspberrypi_cpufreq_send(struct raspberrypi_cpufreq_data *rcf)
+{
+	struct raspberrypi_cpufreq_prop *msg;
+	int ret;
+
+	msg = rpi_firmware_request_data(rcf->req);
+	msg->id = cpu_to_le32(RPI_FIRMWARE_ARM_CLK_ID);
+	msg->val = cpu_to_le32(rcf->next_rate);
+	msg->disable_turbo = cpu_to_le32(0);
+	rcf->next_rate = 0;
+
+	ret = rpi_firmware_request_submit(rcf->req);
+	rcf->busy = !ret;
+
+	return ret;
+}
+
+static void raspberrypi_cpufreq_fast_done(struct rpi_firmware_request *req,
+					  int status, void *ctx)
+{
+	struct raspberrypi_cpufreq_data *rcf = ctx;
+	unsigned long flags;
+	int ret = 0;
+
+	if (status)
+		dev_err_ratelimited(rcf->dev, "Failed to change frequency: %d\n",
+				    status);
+
+	spin_lock_irqsave(&rcf->lock, flags);
+	if (rcf->next_rate)
+		ret = raspberrypi_cpufreq_send(rcf);
+	else
+		rcf->busy = false;
+	spin_unlock_irqrestore(&rcf->lock, flags);
+
+	if (ret)
+		dev_err_ratelimited(rcf->dev,
+				    "Failed to queue frequency change: %d\n",
+				    ret);
+}
+
+/*
+ * Called from the scheduler, so don't wait for the firmware. While a
+ * change is in flight, only the latest rate asked for is kept, and sent
+ * when the firmware answers. This runs under the runqueue lock, where
+ * printing isn't safe, so a failure to queue is left to the next call.
+ */
+static unsigned int
+raspberrypi_cpufreq_fast_switch(struct cpufreq_policy *policy,
+				unsigned int target_freq)
+{
+	struct raspberrypi_cpufreq_data *rcf = cpufreq_get_driver_data();
+	unsigned long flags;
+
+	spin_lock_irqsave(&rcf->lock, flags);
+	rcf->next_rate = target_freq * 1000UL;
+	if (!rcf->busy)
+		raspberrypi_cpufreq_send(rcf);
+	spin_unlock_irqrestore(&rcf->lock, flags);
+
+	return target_freq;
+}
+
+static int raspberrypi_cpufreq_init(struct cpufreq_policy *policy)
+{
+	struct device *cpu_dev = get_cpu_device(policy->cpu);
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int transition_latency;
+	struct clk *clk;
+	int ret;
+
+	clk = clk_get(cpu_dev, NULL);
+	if (IS_ERR(clk)) {
+		dev_err(cpu_dev, "Cannot get clock for CPU%d\n", policy->cpu);
+		return PTR_ERR(clk);
+	}
+
+	ret = dev_pm_opp_init_cpufreq_table(cpu_dev, &freq_table);
+	if (ret) {
+		clk_put(clk);
+		return ret;
+	}
+
+	transition_latency = dev_pm_opp_get_max_transition_latency(cpu_dev);
+	if (!transition_latency)
+		transition_latency = CPUFREQ_ETERNAL;
+
+	/* All the cores run from the same firmware clock */
+	cpumask_setall(policy->cpus);
+	policy->clk = clk;
+	policy->freq_table = freq_table;
+	policy->cpuinfo.transition_latency = transition_latency;
+	policy->dvfs_possible_from_any_cpu = true;
+	policy->fast_switch_possible = true;
+
+	return 0;
+}
+
+static int raspberrypi_cpufreq_exit(struct cpufreq_policy *policy)
+{
+	struct device *cpu_dev = get_cpu_device(policy->cpu);
+
+	dev_pm_opp_free_cpufreq_table(cpu_dev, &policy->freq_table);
+	clk_put(policy->clk);
+
+	return 0;
+}
+
+static struct cpufreq_driver raspberrypi_cpufreq = {
+	.flags = CPUFREQ_NEED_INITIAL_FREQ_CHECK |
+		 CPUFREQ_IS_COOLING_DEV,
+	.verify = cpufreq_generic_frequency_table_verify,
+	.target_index = raspberrypi_cpufreq_set_target,
+	.fast_switch = raspberrypi_cpufreq_fast_switch,
+	.get = cpufreq_generic_get,
+	.init = raspberrypi_cpufreq_init,
+	.exit = raspberrypi_cpufreq_exit,
+	.register_em = cpufreq_register_em_with_opp,
+	.name = "raspberrypi",
+	.attr = cpufreq_generic_attr,
+};
 
 static int raspberrypi_cpufreq_probe(struct platform_device *pdev)
 {
+	struct raspberrypi_cpufreq_data *rcf;
+	struct rpi_firmware *fw;
+	struct device_node *np;
 	struct device *cpu_dev;
 	unsigned long min, max;
 	unsigned long rate;
@@ -30,10 +190,33 @@ static int raspberrypi_cpufreq_probe(struct platform_device *pdev)
 		return -ENODEV;
 	}
 
+	np = rpi_firmware_find_node();
+	if (!np)
+		return -ENODEV;
+
+	fw = devm_rpi_firmware_get(&pdev->dev, np);
+	of_node_put(np);
+	if (!fw)
+		return -EPROBE_DEFER;
+
+	rcf = devm_kzalloc(&pdev->dev, sizeof(*rcf), GFP_KERNEL);
+	if (!rcf)
+		return -ENOMEM;
+
+	rcf->dev = &pdev->dev;
+	spin_lock_init(&rcf->lock);
+	rcf->req = rpi_firmware_request_alloc(fw, RPI_FIRMWARE_SET_CLOCK_RATE,
+			sizeof(struct raspberrypi_cpufreq_prop),
+			raspberrypi_cpufreq_fast_done, rcf);
+	if (!rcf->req)
+		return -ENOMEM;
+	platform_set_drvdata(pdev, rcf);
+
 	clk = clk_get(cpu_dev, NULL);
 	if (IS_ERR(clk)) {
 		dev_err(cpu_dev, "Cannot get clock for CPU0\n");
-		return PTR_ERR(clk);
+		ret = PTR_ERR(clk);
+		goto free_req;
 	}
 
 	/*
@@ -50,10 +233,10 @@ static int raspberrypi_cpufreq_probe(struct platform_device *pdev)
 			goto remove_opp;
 	}
 
-	cpufreq_dt = platform_device_register_simple("cpufreq-dt", -1, NULL, 0);
-	ret = PTR_ERR_OR_ZERO(cpufreq_dt);
+	raspberrypi_cpufreq.driver_data = rcf;
+	ret = cpufreq_register_driver(&raspberrypi_cpufreq);
 	if (ret) {
-		dev_err(cpu_dev, "Failed to create platform device, %d\n", ret);
+		dev_err(cpu_dev, "Failed to register cpufreq driver, %d\n", ret);
 		goto remove_opp;
 	}
 
@@ -61,20 +244,30 @@ static int raspberrypi_cpufreq_probe(struct platform_device *pdev)
 
 remove_opp:
 	dev_pm_opp_remove_all_dynamic(cpu_dev);
+free_req:
+	rpi_firmware_request_free(rcf->req);
 
 	return ret;
 }
 
 static int raspberrypi_cpufreq_remove(struct platform_device *pdev)
 {
+	struct raspberrypi_cpufreq_data *rcf = platform_get_drvdata(pdev);
 	struct device *cpu_dev;
+	unsigned long flags;
+
+	cpufreq_unregister_driver(&raspberrypi_cpufreq);
+
+	/* Don't let a change still in flight send another one */
+	spin_lock_irqsave(&rcf->lock, flags);
+	rcf->next_rate = 0;
+	spin_unlock_irqrestore(&rcf->lock, flags);
+	rpi_firmware_request_free(rcf->req);
 
 	cpu_dev = get_cpu_device(0);
 	if (cpu_dev)
 		dev_pm_opp_remove_all_dynamic(cpu_dev);
 
-	platform_device_unregister(cpufreq_dt);
-
 	return 0;
 }
 
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * rtperiod.c - the periodic wakeup cpuidle governor
+ *
+ * Realtime audio wakes its CPU once per period, either from an hrtimer or
+ * from the period interrupt of the audio device. A state whose exit
+ * latency and target residency don't fit before the next of those wakeups
+ * costs the task part of its processing window, for no energy saving.
+ *
+ * This governor picks the deepest state that still fits before the next
+ * expected wakeup. The next timer comes from the tick code, as for the
+ * other governors. The wakeups that came before their timer are assumed to
+ * be interrupts; once they have arrived at a stable interval for a few
+ * periods, the next one is predicted from that interval, and the exit
+ * latency is also kept within latency_budget_us until the pattern breaks.
+ */
+
+#include <linux/cpuidle.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
+#include <linux/tick.h>
+
+/* The wakeup interval must stay within 1/8th of the period: */
+#define RTPERIOD_JITTER_SHIFT	3
+/* for this many periods before it is trusted: */
+#define RTPERIOD_STABLE		4
+/* A wakeup this much before its timer wasn't caused by it: */
+#define RTPERIOD_TIMER_SLACK_NS	(20 * NSEC_PER_USEC)
+
+static unsigned int latency_budget_us = 50;
+module_param(latency_budget_us, uint, 0644);
+MODULE_PARM_DESC(latency_budget_us,
+		 "Maximum exit latency while wakeups are periodic (us)");
+
+struct rtperiod_device {
+	/* When the next timer was due, as seen by the last select() */
+	u64 timer_expiry;
+	/* The last wakeup that wasn't caused by a timer */
+	u64 last_wake;
+	u64 period;
+	unsigned int stable;
+};
+
+static DEFINE_PER_CPU(struct rtperiod_device, rtperiod_devices);
+
+static bool rtperiod_periodic(struct rtperiod_device *data)
+{
+	return data->period && data->stable >= RTPERIOD_STABLE;
+}
+
+/* How long until the next periodic wakeup, after now */
+static u64 rtperiod_next_wake(struct rtperiod_device *data, u64 now)
+{
+	u64 elapsed = now - data->last_wake;
+
+	/* A missed wakeup doesn't break the pattern on its own */
+	if (elapsed >= data->period)
+		div64_u64_rem(elapsed, data->period, &elapsed);
+
+	return data->period - elapsed;
+}
+
+/**
+ * rtperiod_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ * @stop_tick: indication on whether or not to stop the tick
+ */
+static int rtperiod_select(struct cpuidle_driver *drv,
+			   struct cpuidle_device *dev, bool *stop_tick)
+{
+	struct rtperiod_device *data = this_cpu_ptr(&rtperiod_devices);
+	s64 latency_req = cpuidle_governor_latency_req(dev->cpu);
+	ktime_t delta_tick;
+	u64 now, expected;
+	int i, idx = 0;
+
+	expected = ktime_to_ns(tick_nohz_get_sleep_length(&delta_tick));
+	now = ktime_get_ns();
+	data->timer_expiry = now + expected;
+
+	if (rtperiod_periodic(data)) {
+		expected = min(expected, rtperiod_next_wake(data, now));
+		latency_req = min_t(s64, latency_req,
+				    latency_budget_us * NSEC_PER_USEC);
+	}
+
+	/* Nothing deep enough to be worth stopping the tick for */
+	if (expected < TICK_NSEC && !tick_nohz_tick_stopped()) {
+		*stop_tick = false;
+		expected = min_t(u64, expected, ktime_to_ns(delta_tick));
+	}
+
+	for (i = 0; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+
+		if (dev->states_usage[i].disable)
+			continue;
+		if (s->exit_latency_ns > latency_req)
+			continue;
+		/* Must be back out by the time we're needed */
+		if (i && s->target_residency_ns + s->exit_latency_ns > expected)
+			continue;
+
+		idx = i;
+	}
+
+	return idx;
+}
+
+/**
+ * rtperiod_reflect - records the wakeup interval
+ * @dev: the CPU
+ * @index: the index of actual state entered
+ */
+static void rtperiod_reflect(struct cpuidle_device *dev, int index)
+{
+	struct rtperiod_device *data = this_cpu_ptr(&rtperiod_devices);
+	u64 now = ktime_get_ns();
+	u64 interval, jitter;
+
+	dev->last_state_idx = index;
+
+	/* The timer did it, and we knew when it would */
+	if (now + RTPERIOD_TIMER_SLACK_NS >= data->timer_expiry)
+		return;
+
+	interval = now - data->last_wake;
+	data->last_wake = now;
+
+	jitter = data->period >> RTPERIOD_JITTER_SHIFT;
+	if (interval + jitter < data->period ||
+	    interval > data->period + jitter) {
+		data->period = interval;
+		data->stable = 0;
+		return;
+	}
+
+	/* Follow a slow drift, e.g. of the audio clock */
+	data->period = (data->period * 7 + interval) >> 3;
+	if (data->stable < RTPERIOD_STABLE)
+		data->stable++;
+}
+
+/**
+ * rtperiod_enable_device - scans a CPU's states and does setup
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static int rtperiod_enable_device(struct cpuidle_driver *drv,
+				  struct cpuidle_device *dev)
+{
+	struct rtperiod_device *data = &per_cpu(rtperiod_devices, dev->cpu);
+
+	memset(data, 0, sizeof(*data));
+
+	return 0;
+}
+
+static struct cpuidle_governor rtperiod_governor = {
+	.name =		"rtperiod",
+	.rating =	18,
+	.enable =	rtperiod_enable_device,
+	.select =	rtperiod_select,
+	.reflect =	rtperiod_reflect,
+};
+
+/**
+ * init_rtperiod - initializes the governor
+ */
+static int __init init_rtperiod(void)
+{
+	return cpuidle_register_governor(&rtperiod_governor);
+}
+
+postcore_initcall(init_rtperiod);
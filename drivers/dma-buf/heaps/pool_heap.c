@@ -0,0 +1,508 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * DMABUF pool heap exporter
+ *
+ * Each "linux,dma-heap-pool" reserved-memory region is split into buffers
+ * of its "buffer-size", and exported as a heap named after the region.
+ * Unlike CMA the memory is never lent to the page allocator, so allocating
+ * is only taking a buffer off a free list: it can't stall on migration or
+ * compaction, however long the system has been running. Buffers are
+ * cleared when they are freed rather than when they are allocated.
+ *
+ * The pool occupancy is in debugfs, under dma_heap_pool/.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/dma-mapping.h>
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/of_fdt.h>
+#include <linux/of_reserved_mem.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+
+#define POOL_HEAP_MAX_POOLS	8
+
+struct pool_heap {
+	struct dma_heap *heap;
+	struct reserved_mem *rmem;
+	size_t buffer_size;
+	unsigned int nr_buffers;
+
+	spinlock_t lock;
+	/* Stack of the free buffer indices */
+	unsigned int *free;
+	unsigned int nr_free;
+	unsigned int peak;
+	unsigned long failed;
+};
+
+struct pool_heap_buffer {
+	struct pool_heap *pool;
+	unsigned int index;
+	struct list_head attachments;
+	struct mutex lock;
+	unsigned long len;
+	struct page *page;
+	pgoff_t pagecount;
+	int vmap_cnt;
+	void *vaddr;
+};
+
+struct dma_heap_attachment {
+	struct device *dev;
+	struct sg_table table;
+	struct list_head list;
+	bool mapped;
+};
+
+static struct pool_heap pools[POOL_HEAP_MAX_POOLS];
+static unsigned int nr_pools;
+
+static struct page *pool_heap_page(struct pool_heap *pool, unsigned int index)
+{
+	return pfn_to_page(PHYS_PFN(pool->rmem->base) +
+			   index * (pool->buffer_size >> PAGE_SHIFT));
+}
+
+static void pool_heap_clear(struct page *page, pgoff_t pagecount)
+{
+	pgoff_t i;
+
+	for (i = 0; i < pagecount; i++) {
+		clear_highpage(nth_page(page, i));
+		cond_resched();
+	}
+}
+
+static int pool_heap_get(struct pool_heap *pool)
+{
+	int index = -ENOMEM;
+
+	spin_lock(&pool->lock);
+	if (pool->nr_free) {
+		index = pool->free[--pool->nr_free];
+		pool->peak = max(pool->peak, pool->nr_buffers - pool->nr_free);
+	} else {
+		pool->failed++;
+	}
+	spin_unlock(&pool->lock);
+
+	return index;
+}
+
+static void pool_heap_put(struct pool_heap *pool, unsigned int index)
+{
+	spin_lock(&pool->lock);
+	pool->free[pool->nr_free++] = index;
+	spin_unlock(&pool->lock);
+}
+
+static int pool_heap_attach(struct dma_buf *dmabuf,
+			    struct dma_buf_attachment *attachment)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a;
+	int ret;
+
+	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	if (!a)
+		return -ENOMEM;
+
+	ret = sg_alloc_table(&a->table, 1, GFP_KERNEL);
+	if (ret) {
+		kfree(a);
+		return ret;
+	}
+	sg_set_page(a->table.sgl, buffer->page, buffer->len, 0);
+
+	a->dev = attachment->dev;
+	INIT_LIST_HEAD(&a->list);
+	a->mapped = false;
+
+	attachment->priv = a;
+
+	mutex_lock(&buffer->lock);
+	list_add(&a->list, &buffer->attachments);
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+
+static void pool_heap_detach(struct dma_buf *dmabuf,
+			     struct dma_buf_attachment *attachment)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a = attachment->priv;
+
+	mutex_lock(&buffer->lock);
+	list_del(&a->list);
+	mutex_unlock(&buffer->lock);
+
+	sg_free_table(&a->table);
+	kfree(a);
+}
+
+static struct sg_table *pool_heap_map_dma_buf(struct dma_buf_attachment *attachment,
+					      enum dma_data_direction direction)
+{
+	struct dma_heap_attachment *a = attachment->priv;
+	struct sg_table *table = &a->table;
+	int ret;
+
+	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	if (ret)
+		return ERR_PTR(-ENOMEM);
+	a->mapped = true;
+
+	return table;
+}
+
+static void pool_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
+				    struct sg_table *table,
+				    enum dma_data_direction direction)
+{
+	struct dma_heap_attachment *a = attachment->priv;
+
+	a->mapped = false;
+	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+}
+
+static int pool_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
+					      enum dma_data_direction direction)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a;
+
+	mutex_lock(&buffer->lock);
+
+	if (buffer->vmap_cnt)
+		invalidate_kernel_vmap_range(buffer->vaddr, buffer->len);
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (!a->mapped)
+			continue;
+		dma_sync_sgtable_for_cpu(a->dev, &a->table, direction);
+	}
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+
+static int pool_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
+					    enum dma_data_direction direction)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+	struct dma_heap_attachment *a;
+
+	mutex_lock(&buffer->lock);
+
+	if (buffer->vmap_cnt)
+		flush_kernel_vmap_range(buffer->vaddr, buffer->len);
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (!a->mapped)
+			continue;
+		dma_sync_sgtable_for_device(a->dev, &a->table, direction);
+	}
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+
+static int pool_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+
+	/* The pages are reserved, so they are mapped as raw PFNs */
+	return remap_pfn_range(vma, vma->vm_start,
+			       page_to_pfn(buffer->page) + vma->vm_pgoff,
+			       vma->vm_end - vma->vm_start, vma->vm_page_prot);
+}
+
+static void *pool_heap_do_vmap(struct pool_heap_buffer *buffer)
+{
+	struct page **pages;
+	void *vaddr;
+	pgoff_t i;
+
+	pages = kvmalloc_array(buffer->pagecount, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < buffer->pagecount; i++)
+		pages[i] = nth_page(buffer->page, i);
+
+	vaddr = vmap(pages, buffer->pagecount, VM_MAP, PAGE_KERNEL);
+	kvfree(pages);
+	if (!vaddr)
+		return ERR_PTR(-ENOMEM);
+
+	return vaddr;
+}
+
+static int pool_heap_vmap(struct dma_buf *dmabuf, struct iosys_map *map)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+	void *vaddr;
+	int ret = 0;
+
+	mutex_lock(&buffer->lock);
+	if (buffer->vmap_cnt) {
+		buffer->vmap_cnt++;
+		iosys_map_set_vaddr(map, buffer->vaddr);
+		goto out;
+	}
+
+	vaddr = pool_heap_do_vmap(buffer);
+	if (IS_ERR(vaddr)) {
+		ret = PTR_ERR(vaddr);
+		goto out;
+	}
+	buffer->vaddr = vaddr;
+	buffer->vmap_cnt++;
+	iosys_map_set_vaddr(map, buffer->vaddr);
+out:
+	mutex_unlock(&buffer->lock);
+
+	return ret;
+}
+
+static void pool_heap_vunmap(struct dma_buf *dmabuf, struct iosys_map *map)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	if (!--buffer->vmap_cnt) {
+		vunmap(buffer->vaddr);
+		buffer->vaddr = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+	iosys_map_clear(map);
+}
+
+static void pool_heap_dma_buf_release(struct dma_buf *dmabuf)
+{
+	struct pool_heap_buffer *buffer = dmabuf->priv;
+
+	if (buffer->vmap_cnt > 0) {
+		WARN(1, "%s: buffer still mapped in the kernel\n", __func__);
+		vunmap(buffer->vaddr);
+		buffer->vaddr = NULL;
+	}
+
+	/* Ready for the next user, so that allocating needn't wait */
+	pool_heap_clear(buffer->page, buffer->pagecount);
+	pool_heap_put(buffer->pool, buffer->index);
+	kfree(buffer);
+}
+
+static const struct dma_buf_ops pool_heap_buf_ops = {
+	.attach = pool_heap_attach,
+	.detach = pool_heap_detach,
+	.map_dma_buf = pool_heap_map_dma_buf,
+	.unmap_dma_buf = pool_heap_unmap_dma_buf,
+	.begin_cpu_access = pool_heap_dma_buf_begin_cpu_access,
+	.end_cpu_access = pool_heap_dma_buf_end_cpu_access,
+	.mmap = pool_heap_mmap,
+	.vmap = pool_heap_vmap,
+	.vunmap = pool_heap_vunmap,
+	.release = pool_heap_dma_buf_release,
+};
+
+static struct dma_buf *pool_heap_allocate(struct dma_heap *heap,
+					  unsigned long len,
+					  unsigned long fd_flags,
+					  unsigned long heap_flags)
+{
+	struct pool_heap *pool = dma_heap_get_drvdata(heap);
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct pool_heap_buffer *buffer;
+	struct dma_buf *dmabuf;
+	int index;
+
+	if (len > pool->buffer_size)
+		return ERR_PTR(-EINVAL);
+
+	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
+	if (!buffer)
+		return ERR_PTR(-ENOMEM);
+
+	index = pool_heap_get(pool);
+	if (index < 0) {
+		kfree(buffer);
+		return ERR_PTR(index);
+	}
+
+	INIT_LIST_HEAD(&buffer->attachments);
+	mutex_init(&buffer->lock);
+	buffer->pool = pool;
+	buffer->index = index;
+	buffer->len = len;
+	buffer->pagecount = len >> PAGE_SHIFT;
+	buffer->page = pool_heap_page(pool, index);
+
+	exp_info.exp_name = dma_heap_get_name(heap);
+	exp_info.ops = &pool_heap_buf_ops;
+	exp_info.size = buffer->len;
+	exp_info.flags = fd_flags;
+	exp_info.priv = buffer;
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		/* Never handed out, so still clear */
+		pool_heap_put(pool, index);
+		kfree(buffer);
+	}
+
+	return dmabuf;
+}
+
+static const struct dma_heap_ops pool_heap_ops = {
+	.allocate = pool_heap_allocate,
+};
+
+static int pool_heap_stats_show(struct seq_file *s, void *data)
+{
+	struct pool_heap *pool = s->private;
+	unsigned int nr_free, peak;
+	unsigned long failed;
+
+	spin_lock(&pool->lock);
+	nr_free = pool->nr_free;
+	peak = pool->peak;
+	failed = pool->failed;
+	spin_unlock(&pool->lock);
+
+	seq_printf(s, "buffer_size: %zu\n", pool->buffer_size);
+	seq_printf(s, "buffers: %u\n", pool->nr_buffers);
+	seq_printf(s, "in_use: %u\n", pool->nr_buffers - nr_free);
+	seq_printf(s, "peak: %u\n", peak);
+	seq_printf(s, "failed: %lu\n", failed);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pool_heap_stats);
+
+static int __init pool_heap_create(struct pool_heap *pool,
+				   struct dentry *debugfs)
+{
+	struct dma_heap_export_info exp_info;
+	const char *name = pool->rmem->name;
+	unsigned int i;
+
+	pool->nr_buffers = div64_u64(pool->rmem->size, pool->buffer_size);
+	pool->free = kcalloc(pool->nr_buffers, sizeof(*pool->free),
+			     GFP_KERNEL);
+	if (!pool->free)
+		return -ENOMEM;
+
+	/* The lowest buffers go first */
+	for (i = 0; i < pool->nr_buffers; i++)
+		pool->free[i] = pool->nr_buffers - 1 - i;
+	pool->nr_free = pool->nr_buffers;
+	spin_lock_init(&pool->lock);
+
+	/* Whatever was left there by the firmware or the last boot */
+	pool_heap_clear(pool_heap_page(pool, 0), pool->nr_buffers *
+			(pool->buffer_size >> PAGE_SHIFT));
+
+	/* "camera-pool@30000000" is exported as "camera-pool" */
+	exp_info.name = kstrndup(name, strchrnul(name, '@') - name,
+				 GFP_KERNEL);
+	exp_info.ops = &pool_heap_ops;
+	exp_info.priv = pool;
+	if (!exp_info.name) {
+		kfree(pool->free);
+		return -ENOMEM;
+	}
+
+	pool->heap = dma_heap_add(&exp_info);
+	if (IS_ERR(pool->heap)) {
+		kfree(exp_info.name);
+		kfree(pool->free);
+		return PTR_ERR(pool->heap);
+	}
+
+	debugfs_create_file(exp_info.name, 0444, debugfs, pool,
+			    &pool_heap_stats_fops);
+
+	return 0;
+}
+
+static int __init pool_heap_init(void)
+{
+	struct dentry *debugfs;
+	unsigned int i;
+	int ret;
+
+	if (!nr_pools)
+		return 0;
+
+	debugfs = debugfs_create_dir("dma_heap_pool", NULL);
+
+	for (i = 0; i < nr_pools; i++) {
+		ret = pool_heap_create(&pools[i], debugfs);
+		if (ret)
+			pr_err("dma_heap_pool: %s: failed to add heap (%d)\n",
+			       pools[i].rmem->name, ret);
+	}
+
+	return 0;
+}
+module_init(pool_heap_init);
+
+static int __init pool_heap_rmem_setup(struct reserved_mem *rmem)
+{
+	unsigned long node = rmem->fdt_node;
+	const __be32 *prop;
+	u64 buffer_size;
+	int len;
+
+	/* Sharing the memory with the page allocator is what CMA does */
+	if (of_get_flat_dt_prop(node, "reusable", NULL) ||
+	    of_get_flat_dt_prop(node, "no-map", NULL)) {
+		pr_err("dma_heap_pool: %s: reusable and no-map are not supported\n",
+		       rmem->name);
+		return -EINVAL;
+	}
+
+	prop = of_get_flat_dt_prop(node, "buffer-size", &len);
+	if (!prop || (len != sizeof(u32) && len != sizeof(u64))) {
+		pr_err("dma_heap_pool: %s: no buffer-size\n", rmem->name);
+		return -EINVAL;
+	}
+	buffer_size = of_read_number(prop, len / sizeof(u32));
+
+	if (!buffer_size || !PAGE_ALIGNED(buffer_size) ||
+	    buffer_size > rmem->size || !PAGE_ALIGNED(rmem->base)) {
+		pr_err("dma_heap_pool: %s: bad buffer-size or alignment\n",
+		       rmem->name);
+		return -EINVAL;
+	}
+
+	if (nr_pools == POOL_HEAP_MAX_POOLS) {
+		pr_err("dma_heap_pool: %s: too many pools\n", rmem->name);
+		return -ENOSPC;
+	}
+
+	pools[nr_pools].rmem = rmem;
+	pools[nr_pools].buffer_size = buffer_size;
+	nr_pools++;
+
+	pr_info("dma_heap_pool: %s: %pa bytes in buffers of %llu\n",
+		rmem->name, &rmem->size, buffer_size);
+
+	return 0;
+}
+RESERVEDMEM_OF_DECLARE(dma_heap_pool, "linux,dma-heap-pool",
+		       pool_heap_rmem_setup);
+
+MODULE_LICENSE("GPL v2");
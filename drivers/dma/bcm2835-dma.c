@@ -17,6 +17,7 @@
  *	MARVELL MMP Peripheral DMA Driver
  *	Copyright 2012 Marvell International Ltd.
  */
+#include <linux/debugfs.h>
 #include <linux/dmaengine.h>
 #include <linux/dma-direct.h>
 #include <linux/dma-mapping.h>
@@ -24,7 +25,9 @@
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/platform_data/dma-bcm2708.h>
 #include <linux/platform_device.h>
@@ -33,6 +36,7 @@
 #include <linux/spinlock.h>
 #include <linux/of.h>
 #include <linux/of_dma.h>
+#include <linux/seq_file.h>
 
 #include "virt-dma.h"
 
@@ -52,12 +56,14 @@ struct bcm2835_dma_cfg_data {
  * @base: base address of register map
  * @zero_page: bus address of zero page (to detect transactions copying from
  *	zero page and avoid accessing memory if so)
+ * @stats_since: time the channel statistics started
  */
 struct bcm2835_dmadev {
 	struct dma_device ddev;
 	void __iomem *base;
 	dma_addr_t zero_page;
 	const struct bcm2835_dma_cfg_data *cfg_data;
+	ktime_t stats_since;
 };
 
 struct bcm2835_dma_cb {
@@ -86,6 +92,18 @@ struct bcm2835_cb_entry {
 	dma_addr_t paddr;
 };
 
+/* channel statistics for debugfs, protected by the vchan lock */
+struct bcm2835_chan_stats {
+	u64 descs;		/* descriptors started */
+	u64 periods;		/* cyclic period interrupts */
+	u64 bytes;		/* completed periods and descriptors */
+	u64 busy_ns;		/* time with a descriptor loaded */
+	ktime_t busy_since;	/* 0 while idle */
+	u64 callbacks;		/* client callbacks run */
+	u64 cb_latency_ns;	/* interrupt to client callback return */
+	u64 cb_latency_max_ns;
+};
+
 struct bcm2835_chan {
 	struct virt_dma_chan vc;
 
@@ -103,6 +121,12 @@ struct bcm2835_chan {
 	bool is_lite_channel;
 	bool is_40bit_channel;
 	bool is_2712;
+
+	/* Cyclic transfers are audio: give its interrupt that profile */
+	struct work_struct latency_work;
+	bool latency_set;
+
+	struct bcm2835_chan_stats stats;
 };
 
 struct bcm2835_desc {
@@ -114,6 +138,11 @@ struct bcm2835_desc {
 	size_t size;
 
 	bool cyclic;
+	size_t period_len;
+
+	/* for the callback latency statistics */
+	ktime_t irq_time;
+	struct dmaengine_desc_callback client_cb;
 
 	struct bcm2835_cb_entry cb_list[];
 };
@@ -746,6 +775,17 @@ static void bcm2835_dma_abort(struct bcm2835_chan *c)
 	}
 }
 
+/* call with the vchan lock held */
+static void bcm2835_dma_stats_idle(struct bcm2835_chan *c)
+{
+	if (!c->stats.busy_since)
+		return;
+
+	c->stats.busy_ns += ktime_to_ns(ktime_sub(ktime_get(),
+						  c->stats.busy_since));
+	c->stats.busy_since = 0;
+}
+
 static void bcm2835_dma_start_desc(struct bcm2835_chan *c)
 {
 	struct virt_dma_desc *vd = vchan_next_desc(&c->vc);
@@ -753,6 +793,7 @@ static void bcm2835_dma_start_desc(struct bcm2835_chan *c)
 
 	if (!vd) {
 		c->desc = NULL;
+		bcm2835_dma_stats_idle(c);
 		return;
 	}
 
@@ -760,6 +801,10 @@ static void bcm2835_dma_start_desc(struct bcm2835_chan *c)
 
 	c->desc = d = to_bcm2835_dma_desc(&vd->tx);
 
+	c->stats.descs++;
+	if (!c->stats.busy_since)
+		c->stats.busy_since = ktime_get();
+
 	if (c->is_40bit_channel) {
 		writel(to_40bit_cbaddr(d->cb_list[0].paddr),
 		       c->chan_base + BCM2711_DMA40_CB);
@@ -811,9 +856,14 @@ static irqreturn_t bcm2835_dma_callback(int irq, void *data)
 
 	if (d) {
 		if (d->cyclic) {
+			d->irq_time = ktime_get();
+			c->stats.periods++;
+			c->stats.bytes += d->period_len;
 			/* call the cyclic callback */
 			vchan_cyclic_callback(&d->vd);
 		} else if (!readl(c->chan_base + BCM2835_DMA_ADDR)) {
+			d->irq_time = ktime_get();
+			c->stats.bytes += d->size;
 			vchan_cookie_complete(&c->desc->vd);
 			bcm2835_dma_start_desc(c);
 		}
@@ -824,6 +874,14 @@ static irqreturn_t bcm2835_dma_callback(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+static void bcm2835_dma_latency_work(struct work_struct *work)
+{
+	struct bcm2835_chan *c = container_of(work, struct bcm2835_chan,
+					      latency_work);
+
+	irq_set_latency_class(c->irq_number, IRQ_LATENCY_AUDIO);
+}
+
 static int bcm2835_dma_alloc_chan_resources(struct dma_chan *chan)
 {
 	struct bcm2835_chan *c = to_bcm2835_dma_chan(chan);
@@ -851,6 +909,8 @@ static void bcm2835_dma_free_chan_resources(struct dma_chan *chan)
 	struct bcm2835_chan *c = to_bcm2835_dma_chan(chan);
 
 	vchan_free_chan_resources(&c->vc);
+	cancel_work_sync(&c->latency_work);
+	c->latency_set = false;
 	free_irq(c->irq_number, c);
 	dma_pool_destroy(c->cb_pool);
 
@@ -905,6 +965,77 @@ static size_t bcm2835_dma_desc_size_pos(struct bcm2835_desc *d, dma_addr_t addr)
 	return size;
 }
 
+static size_t bcm2835_dma_cb_len(struct bcm2835_chan *c,
+				 struct bcm2835_desc *d, unsigned int i)
+{
+	if (c->is_40bit_channel)
+		return ((struct bcm2711_dma40_scb *)d->cb_list[i].cb)->len;
+
+	return d->cb_list[i].cb->length;
+}
+
+/*
+ * Residue of a running cyclic descriptor. The control block address and
+ * the remaining transfer length are both taken from the live channel
+ * registers, so the position advances with every burst. The two reads
+ * are retried if the engine moved on to the next control block in
+ * between, as TXFR_LEN would then already belong to the new block.
+ *
+ * Returns false if the current control block is not part of @d, in
+ * which case the caller has to fall back to the address based lookup.
+ */
+static bool bcm2835_dma_cyclic_residue(struct bcm2835_chan *c,
+				       struct bcm2835_desc *d, size_t *residue)
+{
+	unsigned int cb_reg, len_reg;
+	u32 cb, cb_again, len;
+	unsigned int i, retries = 3;
+	size_t size;
+
+	if (c->is_40bit_channel) {
+		cb_reg = BCM2711_DMA40_CB;
+		len_reg = BCM2711_DMA40_LEN;
+	} else {
+		cb_reg = BCM2835_DMA_ADDR;
+		len_reg = BCM2835_DMA_LEN;
+	}
+
+	cb = readl(c->chan_base + cb_reg);
+	do {
+		len = readl(c->chan_base + len_reg);
+		cb_again = readl(c->chan_base + cb_reg);
+		if (cb_again == cb)
+			break;
+		cb = cb_again;
+	} while (--retries);
+
+	if (!retries)
+		return false;
+
+	for (i = 0; i < d->frames; i++) {
+		dma_addr_t paddr = d->cb_list[i].paddr;
+
+		if (c->is_40bit_channel || c->is_2712) {
+			if (cb == to_40bit_cbaddr(paddr))
+				break;
+		} else if (cb == paddr) {
+			break;
+		}
+	}
+
+	if (i == d->frames)
+		return false;
+
+	/* only part of the current block is left to transfer */
+	size = min_t(size_t, len, bcm2835_dma_cb_len(c, d, i));
+	for (i++; i < d->frames; i++)
+		size += bcm2835_dma_cb_len(c, d, i);
+
+	*residue = size;
+
+	return true;
+}
+
 static enum dma_status bcm2835_dma_tx_status(struct dma_chan *chan,
 	dma_cookie_t cookie, struct dma_tx_state *txstate)
 {
@@ -926,6 +1057,10 @@ static enum dma_status bcm2835_dma_tx_status(struct dma_chan *chan,
 		struct bcm2835_desc *d = c->desc;
 		dma_addr_t pos;
 
+		if (d->cyclic &&
+		    bcm2835_dma_cyclic_residue(c, d, &txstate->residue))
+			goto out;
+
 		if (d->dir == DMA_MEM_TO_DEV && c->is_40bit_channel) {
 			u64 lo_bits, hi_bits;
 
@@ -951,6 +1086,7 @@ static enum dma_status bcm2835_dma_tx_status(struct dma_chan *chan,
 		txstate->residue = 0;
 	}
 
+out:
 	spin_unlock_irqrestore(&c->vc.lock, flags);
 
 	return ret;
@@ -968,6 +1104,72 @@ static void bcm2835_dma_issue_pending(struct dma_chan *chan)
 	spin_unlock_irqrestore(&c->vc.lock, flags);
 }
 
+/*
+ * Runs the client callback in place of virt-dma, to measure how long
+ * after the interrupt the client is done with the completion.
+ */
+static void bcm2835_dma_client_callback(void *param,
+					const struct dmaengine_result *result)
+{
+	struct bcm2835_desc *d = param;
+	struct bcm2835_chan *c = d->c;
+	unsigned long flags;
+	ktime_t irq_time;
+	u64 latency;
+
+	spin_lock_irqsave(&c->vc.lock, flags);
+	irq_time = d->irq_time;
+	spin_unlock_irqrestore(&c->vc.lock, flags);
+
+	dmaengine_desc_callback_invoke(&d->client_cb, result);
+
+	latency = ktime_to_ns(ktime_sub(ktime_get(), irq_time));
+
+	spin_lock_irqsave(&c->vc.lock, flags);
+	c->stats.callbacks++;
+	c->stats.cb_latency_ns += latency;
+	c->stats.cb_latency_max_ns = max(c->stats.cb_latency_max_ns,
+					 latency);
+	spin_unlock_irqrestore(&c->vc.lock, flags);
+}
+
+static dma_cookie_t bcm2835_dma_tx_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct bcm2835_desc *d = to_bcm2835_dma_desc(tx);
+
+	/*
+	 * Reused descriptors are wrapped already, unless the client gave
+	 * them a new callback before submitting them again.
+	 */
+	if (tx->callback_result == bcm2835_dma_client_callback) {
+		if (!tx->callback)
+			return vchan_tx_submit(tx);
+		tx->callback_result = NULL;
+	}
+
+	dmaengine_desc_get_callback(tx, &d->client_cb);
+	if (dmaengine_desc_callback_valid(&d->client_cb)) {
+		tx->callback = NULL;
+		tx->callback_result = bcm2835_dma_client_callback;
+		tx->callback_param = d;
+	}
+
+	return vchan_tx_submit(tx);
+}
+
+static struct dma_async_tx_descriptor *
+bcm2835_dma_tx_prep(struct bcm2835_chan *c, struct bcm2835_desc *d,
+		    unsigned long flags)
+{
+	struct dma_async_tx_descriptor *tx = vchan_tx_prep(&c->vc, &d->vd,
+							   flags);
+
+	if (IS_ENABLED(CONFIG_DEBUG_FS))
+		tx->tx_submit = bcm2835_dma_tx_submit;
+
+	return tx;
+}
+
 static struct dma_async_tx_descriptor *bcm2835_dma_prep_dma_memcpy(
 	struct dma_chan *chan, dma_addr_t dst, dma_addr_t src,
 	size_t len, unsigned long flags)
@@ -995,7 +1197,7 @@ static struct dma_async_tx_descriptor *bcm2835_dma_prep_dma_memcpy(
 	if (!d)
 		return NULL;
 
-	return vchan_tx_prep(&c->vc, &d->vd, flags);
+	return bcm2835_dma_tx_prep(c, d, flags);
 }
 
 static struct dma_async_tx_descriptor *bcm2835_dma_prep_slave_sg(
@@ -1048,7 +1250,7 @@ static struct dma_async_tx_descriptor *bcm2835_dma_prep_slave_sg(
 	bcm2835_dma_fill_cb_chain_with_sg(c, direction, d->cb_list,
 					  sgl, sg_len);
 
-	return vchan_tx_prep(&c->vc, &d->vd, flags);
+	return bcm2835_dma_tx_prep(c, d, flags);
 }
 
 static struct dma_async_tx_descriptor *bcm2835_dma_prep_dma_cyclic(
@@ -1132,6 +1334,14 @@ static struct dma_async_tx_descriptor *bcm2835_dma_prep_dma_cyclic(
 	if (!d)
 		return NULL;
 
+	d->period_len = period_len;
+
+	/* Can't be done here, see above */
+	if (!c->latency_set) {
+		c->latency_set = true;
+		schedule_work(&c->latency_work);
+	}
+
 	/* wrap around into a loop */
 	if (c->is_40bit_channel)
 		((struct bcm2711_dma40_scb *)
@@ -1141,7 +1351,7 @@ static struct dma_async_tx_descriptor *bcm2835_dma_prep_dma_cyclic(
 		d->cb_list[d->frames - 1].cb->next = c->is_2712 ?
 		to_40bit_cbaddr(d->cb_list[0].paddr) : d->cb_list[0].paddr;
 
-	return vchan_tx_prep(&c->vc, &d->vd, flags);
+	return bcm2835_dma_tx_prep(c, d, flags);
 }
 
 static int bcm2835_dma_slave_config(struct dma_chan *chan,
@@ -1168,6 +1378,7 @@ static int bcm2835_dma_terminate_all(struct dma_chan *chan)
 		c->desc = NULL;
 		bcm2835_dma_abort(c);
 	}
+	bcm2835_dma_stats_idle(c);
 
 	vchan_get_all_descriptors(&c->vc, &head);
 	spin_unlock_irqrestore(&c->vc.lock, flags);
@@ -1199,6 +1410,7 @@ static int bcm2835_dma_chan_init(struct bcm2835_dmadev *d, int chan_id,
 	c->ch = chan_id;
 	c->irq_number = irq;
 	c->irq_flags = irq_flags;
+	INIT_WORK(&c->latency_work, bcm2835_dma_latency_work);
 
 	/* check for 40bit and lite channels */
 	if (d->cfg_data->chan_40bit_mask & BIT(chan_id))
@@ -1283,6 +1495,74 @@ static const struct of_device_id bcm2835_dma_of_match[] = {
 };
 MODULE_DEVICE_TABLE(of, bcm2835_dma_of_match);
 
+static const char *bcm2835_dma_chan_type(struct bcm2835_chan *c)
+{
+	if (c->is_40bit_channel)
+		return "40bit";
+
+	return c->is_lite_channel ? "lite" : "full";
+}
+
+#ifdef CONFIG_DEBUG_FS
+/* which client got which kind of channel, including the free ones */
+static void bcm2835_dma_dbg_summary_show(struct seq_file *s,
+					 struct dma_device *dma_dev)
+{
+	struct dma_chan *chan;
+
+	list_for_each_entry(chan, &dma_dev->channels, device_node) {
+		struct bcm2835_chan *c = to_bcm2835_dma_chan(chan);
+
+		seq_printf(s, " %-13s| %-5s dreq %2u | %s\n",
+			   dma_chan_name(chan), bcm2835_dma_chan_type(c),
+			   c->dreq, !chan->client_count ? "free" :
+			   chan->dbg_client_name ?: "in-use");
+	}
+}
+#endif
+
+static int bcm2835_dma_stats_show(struct seq_file *s, void *data)
+{
+	struct bcm2835_dmadev *od = s->private;
+	ktime_t now = ktime_get();
+	u64 elapsed = ktime_to_ns(ktime_sub(now, od->stats_since));
+	struct dma_chan *chan;
+
+	seq_puts(s, "chan type        descs     periods          bytes  busy%    callbacks avg_lat_us max_lat_us\n");
+
+	list_for_each_entry(chan, &od->ddev.channels, device_node) {
+		struct bcm2835_chan *c = to_bcm2835_dma_chan(chan);
+		struct bcm2835_chan_stats st;
+		unsigned long flags;
+		u64 busy, avg;
+		u32 busy_frac;
+
+		spin_lock_irqsave(&c->vc.lock, flags);
+		st = c->stats;
+		spin_unlock_irqrestore(&c->vc.lock, flags);
+
+		busy = st.busy_ns;
+		if (st.busy_since)
+			busy += ktime_to_ns(ktime_sub(now, st.busy_since));
+		/* in hundredths of a percent */
+		busy = elapsed ? div64_u64(busy * 10000, elapsed) : 0;
+		avg = st.callbacks ? div64_u64(st.cb_latency_ns,
+					       st.callbacks) : 0;
+
+		busy = div_u64_rem(busy, 100, &busy_frac);
+
+		seq_printf(s, "%4d %-5s %11llu %11llu %14llu %3llu.%02u %12llu %10llu %10llu\n",
+			   c->ch, bcm2835_dma_chan_type(c), st.descs,
+			   st.periods, st.bytes, busy, busy_frac,
+			   st.callbacks,
+			   div_u64(avg, NSEC_PER_USEC),
+			   div_u64(st.cb_latency_max_ns, NSEC_PER_USEC));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bcm2835_dma_stats);
+
 static struct dma_chan *bcm2835_dma_xlate(struct of_phandle_args *spec,
 					   struct of_dma *ofdma)
 {
@@ -1365,6 +1645,9 @@ static int bcm2835_dma_probe(struct platform_device *pdev)
 	od->ddev.device_config = bcm2835_dma_slave_config;
 	od->ddev.device_terminate_all = bcm2835_dma_terminate_all;
 	od->ddev.device_synchronize = bcm2835_dma_synchronize;
+#ifdef CONFIG_DEBUG_FS
+	od->ddev.dbg_summary_show = bcm2835_dma_dbg_summary_show;
+#endif
 	od->ddev.src_addr_widths = BIT(DMA_SLAVE_BUSWIDTH_4_BYTES);
 	od->ddev.dst_addr_widths = BIT(DMA_SLAVE_BUSWIDTH_4_BYTES);
 	od->ddev.directions = BIT(DMA_DEV_TO_MEM) | BIT(DMA_MEM_TO_DEV) |
@@ -1495,6 +1778,12 @@ static int bcm2835_dma_probe(struct platform_device *pdev)
 		goto err_no_dma;
 	}
 
+	od->stats_since = ktime_get();
+	if (dmaengine_get_debugfs_root(&od->ddev))
+		debugfs_create_file("stats", 0444,
+				    dmaengine_get_debugfs_root(&od->ddev), od,
+				    &bcm2835_dma_stats_fops);
+
 	dev_dbg(&pdev->dev, "Load BCM2835 DMA engine driver\n");
 
 	return 0;
@@ -15,63 +15,344 @@
 #include <linux/reboot.h>
 #include <linux/slab.h>
 #include <soc/bcm2835/raspberrypi-firmware.h>
+#include <soc/bcm2835/raspberrypi-firmware-async.h>
 
 #define MBOX_MSG(chan, data28)		(((data28) & ~0xf) | ((chan) & 0xf))
 #define MBOX_CHAN(msg)			((msg) & 0xf)
 #define MBOX_DATA28(msg)		((msg) & ~0xf)
 #define MBOX_CHAN_PROPERTY		8
 
+/* Room for the tags of the requests merged into one transaction */
+#define RPI_FIRMWARE_BATCH_SIZE		PAGE_SIZE
+
 static struct platform_device *rpi_hwmon;
 static struct platform_device *rpi_clk;
 
+struct rpi_firmware_request {
+	struct rpi_firmware *fw;
+	struct list_head list;
+	bool queued;
+	u32 message;
+
+	u32 *buf;
+	dma_addr_t bus_addr;
+	size_t size;
+
+	/* Completed whenever the request isn't queued */
+	struct completion done;
+	int status;
+
+	/* Sent with the tags of other requests, see rpi_firmware_batch() */
+	bool batched;
+	bool no_batch;
+
+	/* Only set for rpi_firmware_request_alloc()'ed requests */
+	u32 tag;
+	size_t buf_size;
+	rpi_firmware_complete_t complete;
+	void *ctx;
+};
+
 struct rpi_firmware {
 	struct mbox_client cl;
 	struct mbox_chan *chan; /* The property channel. */
-	struct completion c;
 	u32 enabled;
 
+	/*
+	 * The firmware handles one property transaction at a time, the
+	 * others wait on the queue.
+	 */
+	spinlock_t lock;
+	struct list_head queue;
+	struct rpi_firmware_request *active;
+
+	/*
+	 * When several requests are waiting, they are sent together in
+	 * batch, and are on the batched list until the answer comes.
+	 */
+	struct rpi_firmware_request batch;
+	struct list_head batched;
+
 	struct kref consumers;
 	u32 get_throttled;
 };
 
 static struct platform_device *g_pdev;
 
-static DEFINE_MUTEX(transaction_lock);
+static void rpi_firmware_finish(struct rpi_firmware_request *req, int ret)
+{
+	struct rpi_firmware *fw = req->fw;
+	unsigned long flags;
+
+	rmb();
+	req->status = ret;
+	if (req->complete) {
+		if (ret == 0 && req->buf[1] != RPI_FIRMWARE_STATUS_SUCCESS)
+			ret = -EINVAL;
+		req->complete(req, ret, req->ctx);
+	}
+
+	/* Unless the callback has submitted it again */
+	spin_lock_irqsave(&fw->lock, flags);
+	if (!req->queued)
+		complete_all(&req->done);
+	spin_unlock_irqrestore(&fw->lock, flags);
+}
+
+static void rpi_firmware_finish_list(struct list_head *list, int ret)
+{
+	struct rpi_firmware_request *req, *tmp;
+
+	list_for_each_entry_safe(req, tmp, list, list) {
+		list_del(&req->list);
+		rpi_firmware_finish(req, ret);
+	}
+}
+
+/*
+ * Takes the next request off the queue. If more are waiting, as many
+ * as fit are merged into fw->batch instead, so the firmware handles
+ * them in one transaction. Called with fw->lock held.
+ */
+static struct rpi_firmware_request *rpi_firmware_batch(struct rpi_firmware *fw)
+{
+	struct rpi_firmware_request *batch = &fw->batch;
+	struct rpi_firmware_request *req, *tmp;
+	unsigned int count = 0;
+	size_t size = 12;
+
+	if (!batch->buf || list_is_singular(&fw->queue))
+		goto single;
+
+	list_for_each_entry_safe(req, tmp, &fw->queue, list) {
+		size_t tag_size = req->size - 12;
+
+		if (req->no_batch || size + tag_size > RPI_FIRMWARE_BATCH_SIZE)
+			break;
+
+		memcpy((void *)batch->buf + size - 4, &req->buf[2], tag_size);
+		size += tag_size;
+		list_move_tail(&req->list, &fw->batched);
+		count++;
+	}
+
+	/* Nothing to share the transaction with */
+	if (count < 2) {
+		list_splice_init(&fw->batched, &fw->queue);
+		goto single;
+	}
+
+	list_for_each_entry(req, &fw->batched, list)
+		req->batched = true;
+
+	batch->buf[0] = size;
+	batch->buf[1] = RPI_FIRMWARE_STATUS_REQUEST;
+	batch->buf[size / 4 - 1] = RPI_FIRMWARE_PROPERTY_END;
+	batch->size = size;
+	wmb();
+
+	return batch;
+
+single:
+	req = list_first_entry(&fw->queue, struct rpi_firmware_request, list);
+	list_del(&req->list);
+	return req;
+}
+
+/*
+ * Copies the answer of the firmware back to the batched requests, and
+ * moves them to done. Called with fw->lock held.
+ */
+static void rpi_firmware_unbatch(struct rpi_firmware *fw,
+				 struct list_head *done)
+{
+	struct rpi_firmware_request *batch = &fw->batch;
+	struct rpi_firmware_request *req;
+	size_t offset = 8;
+	u32 status;
+
+	rmb();
+	status = batch->buf[1];
+
+	/*
+	 * The status covers all the tags: send them again one by one, so
+	 * that only the one the firmware rejects fails.
+	 */
+	if (status != RPI_FIRMWARE_STATUS_SUCCESS) {
+		list_for_each_entry(req, &fw->batched, list) {
+			req->batched = false;
+			req->no_batch = true;
+		}
+		list_splice_init(&fw->batched, &fw->queue);
+		return;
+	}
+
+	list_for_each_entry(req, &fw->batched, list) {
+		size_t tag_size = req->size - 12;
+
+		memcpy(&req->buf[2], (void *)batch->buf + offset, tag_size);
+		offset += tag_size;
+		req->buf[1] = status;
+		req->batched = false;
+		req->queued = false;
+	}
+	list_splice_init(&fw->batched, done);
+}
+
+/* Hands the next queued request to the firmware, if it is idle. */
+static void rpi_firmware_send_next(struct rpi_firmware *fw)
+{
+	struct rpi_firmware_request *req;
+	unsigned long flags;
+	LIST_HEAD(failed);
+	int ret;
+
+	spin_lock_irqsave(&fw->lock, flags);
+	while (!fw->active && !list_empty(&fw->queue)) {
+		req = rpi_firmware_batch(fw);
+		if (req == &fw->batch)
+			req->message = MBOX_MSG(MBOX_CHAN_PROPERTY,
+						req->bus_addr);
+
+		ret = mbox_send_message(fw->chan, &req->message);
+		if (ret >= 0) {
+			fw->active = req;
+			break;
+		}
+
+		if (req == &fw->batch) {
+			list_for_each_entry(req, &fw->batched, list) {
+				req->batched = false;
+				req->queued = false;
+			}
+			list_splice_init(&fw->batched, &failed);
+		} else {
+			req->queued = false;
+			list_add_tail(&req->list, &failed);
+		}
+		spin_unlock_irqrestore(&fw->lock, flags);
+		dev_err(fw->cl.dev, "mbox_send_message returned %d\n", ret);
+		rpi_firmware_finish_list(&failed, ret);
+		spin_lock_irqsave(&fw->lock, flags);
+	}
+	spin_unlock_irqrestore(&fw->lock, flags);
+}
 
 static void response_callback(struct mbox_client *cl, void *msg)
 {
 	struct rpi_firmware *fw = container_of(cl, struct rpi_firmware, cl);
-	complete(&fw->c);
+	struct rpi_firmware_request *req;
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	spin_lock_irqsave(&fw->lock, flags);
+	req = fw->active;
+	/* A late answer to a request that timed out */
+	if (!req || MBOX_DATA28(*(u32 *)msg) != MBOX_DATA28(req->message)) {
+		spin_unlock_irqrestore(&fw->lock, flags);
+		dev_warn_ratelimited(fw->cl.dev, "Unexpected response 0x%08x\n",
+				     *(u32 *)msg);
+		return;
+	}
+	fw->active = NULL;
+	if (req == &fw->batch) {
+		rpi_firmware_unbatch(fw, &done);
+	} else {
+		req->queued = false;
+		list_add_tail(&req->list, &done);
+	}
+	spin_unlock_irqrestore(&fw->lock, flags);
+
+	rpi_firmware_send_next(fw);
+	rpi_firmware_finish_list(&done, 0);
+}
+
+static int rpi_firmware_queue(struct rpi_firmware_request *req)
+{
+	struct rpi_firmware *fw = req->fw;
+	unsigned long flags;
+
+	WARN_ON(req->bus_addr & 0xf);
+
+	spin_lock_irqsave(&fw->lock, flags);
+	if (req->queued) {
+		spin_unlock_irqrestore(&fw->lock, flags);
+		return -EBUSY;
+	}
+	req->queued = true;
+	req->no_batch = false;
+	req->message = MBOX_MSG(MBOX_CHAN_PROPERTY, req->bus_addr);
+	reinit_completion(&req->done);
+	list_add_tail(&req->list, &fw->queue);
+	spin_unlock_irqrestore(&fw->lock, flags);
+
+	rpi_firmware_send_next(fw);
+
+	return 0;
+}
+
+/*
+ * Gives up on a request. Returns false if it was completing already, in
+ * which case the caller has to wait for it.
+ */
+static bool rpi_firmware_abort(struct rpi_firmware_request *req)
+{
+	struct rpi_firmware *fw = req->fw;
+	unsigned long flags;
+	bool aborted;
+
+	spin_lock_irqsave(&fw->lock, flags);
+	aborted = req->queued;
+	if (fw->active == req) {
+		fw->active = NULL;
+	} else if (req->batched) {
+		struct rpi_firmware_request *other;
+
+		/* Give up on the whole batch, the others are sent again */
+		list_del(&req->list);
+		list_for_each_entry(other, &fw->batched, list) {
+			other->batched = false;
+			other->no_batch = true;
+		}
+		list_splice_init(&fw->batched, &fw->queue);
+		fw->active = NULL;
+		req->batched = false;
+	} else if (req->queued) {
+		list_del(&req->list);
+	}
+	req->queued = false;
+	spin_unlock_irqrestore(&fw->lock, flags);
+
+	if (aborted) {
+		req->status = -ETIMEDOUT;
+		complete_all(&req->done);
+		rpi_firmware_send_next(fw);
+	}
+
+	return aborted;
 }
 
 /*
  * Sends a request to the firmware through the BCM2835 mailbox driver,
  * and synchronously waits for the reply.
  */
-static int
-rpi_firmware_transaction(struct rpi_firmware *fw, u32 chan, u32 data)
+static int rpi_firmware_transaction(struct rpi_firmware_request *req)
 {
-	u32 message = MBOX_MSG(chan, data);
 	int ret;
 
-	WARN_ON(data & 0xf);
+	ret = rpi_firmware_queue(req);
+	if (ret)
+		return ret;
 
-	mutex_lock(&transaction_lock);
-	reinit_completion(&fw->c);
-	ret = mbox_send_message(fw->chan, &message);
-	if (ret >= 0) {
-		if (wait_for_completion_timeout(&fw->c, HZ)) {
-			ret = 0;
-		} else {
-			ret = -ETIMEDOUT;
+	if (!wait_for_completion_timeout(&req->done, HZ)) {
+		if (rpi_firmware_abort(req)) {
 			WARN_ONCE(1, "Firmware transaction timeout");
+			return -ETIMEDOUT;
 		}
-	} else {
-		dev_err(fw->cl.dev, "mbox_send_message returned %d\n", ret);
+		wait_for_completion(&req->done);
 	}
-	mutex_unlock(&transaction_lock);
 
-	return ret;
+	return req->status;
 }
 
 /**
@@ -91,19 +372,24 @@ rpi_firmware_transaction(struct rpi_firmware *fw, u32 chan, u32 data)
 int rpi_firmware_property_list(struct rpi_firmware *fw,
 			       void *data, size_t tag_size)
 {
-	size_t size = tag_size + 12;
+	struct rpi_firmware_request req = {
+		.fw = fw,
+		.size = tag_size + 12,
+	};
+	size_t size = req.size;
 	u32 *buf;
-	dma_addr_t bus_addr;
 	int ret;
 
 	/* Packets are processed a dword at a time. */
 	if (size & 3)
 		return -EINVAL;
 
-	buf = dma_alloc_coherent(fw->cl.dev, PAGE_ALIGN(size), &bus_addr,
+	buf = dma_alloc_coherent(fw->cl.dev, PAGE_ALIGN(size), &req.bus_addr,
 				 GFP_ATOMIC);
 	if (!buf)
 		return -ENOMEM;
+	req.buf = buf;
+	init_completion(&req.done);
 
 	/* The firmware will error out without parsing in this case. */
 	WARN_ON(size >= 1024 * 1024);
@@ -114,7 +400,7 @@ int rpi_firmware_property_list(struct rpi_firmware *fw,
 	buf[size / 4 - 1] = RPI_FIRMWARE_PROPERTY_END;
 	wmb();
 
-	ret = rpi_firmware_transaction(fw, MBOX_CHAN_PROPERTY, bus_addr);
+	ret = rpi_firmware_transaction(&req);
 
 	rmb();
 	memcpy(data, &buf[2], tag_size);
@@ -129,7 +415,7 @@ int rpi_firmware_property_list(struct rpi_firmware *fw,
 		ret = -EINVAL;
 	}
 
-	dma_free_coherent(fw->cl.dev, PAGE_ALIGN(size), buf, bus_addr);
+	dma_free_coherent(fw->cl.dev, PAGE_ALIGN(size), buf, req.bus_addr);
 
 	return ret;
 }
@@ -187,6 +473,134 @@ int rpi_firmware_property(struct rpi_firmware *fw,
 }
 EXPORT_SYMBOL_GPL(rpi_firmware_property);
 
+/**
+ * rpi_firmware_request_alloc - Allocate a queued firmware property request
+ * @fw:		Pointer to firmware structure from rpi_firmware_get().
+ * @tag:	One of enum_mbox_property_tag.
+ * @buf_size:	Size of the tag data, a multiple of 4.
+ * @complete:	Called when the firmware has answered, may be NULL.
+ * @ctx:	Passed to @complete.
+ *
+ * Allocates everything a single tag request needs, so that
+ * rpi_firmware_request_submit() doesn't have to. The tag data is
+ * accessed with rpi_firmware_request_data(). May sleep.
+ */
+struct rpi_firmware_request *
+rpi_firmware_request_alloc(struct rpi_firmware *fw, u32 tag, size_t buf_size,
+			   rpi_firmware_complete_t complete, void *ctx)
+{
+	struct rpi_firmware_request *req;
+
+	if (buf_size & 3)
+		return NULL;
+
+	req = kzalloc(sizeof(*req), GFP_KERNEL);
+	if (!req)
+		return NULL;
+
+	req->fw = fw;
+	req->tag = tag;
+	req->buf_size = buf_size;
+	req->size = sizeof(struct rpi_firmware_property_tag_header) +
+		    buf_size + 12;
+	req->complete = complete;
+	req->ctx = ctx;
+	init_completion(&req->done);
+	complete_all(&req->done);
+
+	req->buf = dma_alloc_coherent(fw->cl.dev, PAGE_ALIGN(req->size),
+				      &req->bus_addr, GFP_KERNEL);
+	if (!req->buf) {
+		kfree(req);
+		return NULL;
+	}
+
+	return req;
+}
+EXPORT_SYMBOL_GPL(rpi_firmware_request_alloc);
+
+/**
+ * rpi_firmware_request_free - Free a queued firmware property request
+ * @req:	Request from rpi_firmware_request_alloc(), may be NULL.
+ *
+ * Takes the request off the queue, or waits for the firmware to answer
+ * it. It must not be submitted again meanwhile. May sleep.
+ */
+void rpi_firmware_request_free(struct rpi_firmware_request *req)
+{
+	struct rpi_firmware *fw;
+	unsigned long flags;
+
+	if (!req)
+		return;
+	fw = req->fw;
+
+	/*
+	 * A request still waiting on the queue can be dropped. One the
+	 * firmware works on, alone or in a batch, has to be waited for:
+	 * rpi_firmware_unbatch() finds each request's answer by its place
+	 * on the batched list, so it must not be unlinked from there.
+	 */
+	spin_lock_irqsave(&fw->lock, flags);
+	if (req->queued && !req->batched && fw->active != req) {
+		list_del(&req->list);
+		req->queued = false;
+		complete_all(&req->done);
+	}
+	spin_unlock_irqrestore(&fw->lock, flags);
+
+	if (!wait_for_completion_timeout(&req->done, HZ) &&
+	    !rpi_firmware_abort(req))
+		wait_for_completion(&req->done);
+
+	dma_free_coherent(fw->cl.dev, PAGE_ALIGN(req->size), req->buf,
+			  req->bus_addr);
+	kfree(req);
+}
+EXPORT_SYMBOL_GPL(rpi_firmware_request_free);
+
+/**
+ * rpi_firmware_request_data - Tag data of a queued firmware request
+ * @req:	Request from rpi_firmware_request_alloc().
+ *
+ * The buffer is shared with the firmware: it is only to be touched
+ * before rpi_firmware_request_submit() and from the completion callback.
+ */
+void *rpi_firmware_request_data(struct rpi_firmware_request *req)
+{
+	return (void *)&req->buf[2] +
+	       sizeof(struct rpi_firmware_property_tag_header);
+}
+EXPORT_SYMBOL_GPL(rpi_firmware_request_data);
+
+/**
+ * rpi_firmware_request_submit - Queue a firmware property request
+ * @req:	Request from rpi_firmware_request_alloc().
+ *
+ * Returns without waiting for the firmware, and can be called from any
+ * context. Returns -EBUSY if the request is still pending.
+ */
+int rpi_firmware_request_submit(struct rpi_firmware_request *req)
+{
+	struct rpi_firmware_property_tag_header *header;
+	u32 *buf = req->buf;
+
+	if (READ_ONCE(req->queued))
+		return -EBUSY;
+
+	buf[0] = req->size;
+	buf[1] = RPI_FIRMWARE_STATUS_REQUEST;
+	header = (void *)&buf[2];
+	header->tag = req->tag;
+	header->buf_size = req->buf_size;
+	header->req_resp_size = 0;
+	buf[req->size / 4 - 1] = RPI_FIRMWARE_PROPERTY_END;
+	wmb();
+
+	return rpi_firmware_queue(req);
+}
+EXPORT_SYMBOL_GPL(rpi_firmware_request_submit);
+
 static int rpi_firmware_notify_reboot(struct notifier_block *nb,
 				      unsigned long action,
 				      void *data)
@@ -368,6 +782,9 @@ static void rpi_firmware_delete(struct kref *kref)
 					       consumers);
 
 	mbox_free_channel(fw->chan);
+	if (fw->batch.buf)
+		dma_free_coherent(fw->cl.dev, RPI_FIRMWARE_BATCH_SIZE,
+				  fw->batch.buf, fw->batch.bus_addr);
 	kfree(fw);
 }
 
@@ -399,7 +816,8 @@ static int rpi_firmware_probe(struct platform_device *pdev)
 
 	fw->cl.dev = dev;
 	fw->cl.rx_callback = response_callback;
-	fw->cl.tx_block = true;
+	/* Transactions are waited for in rpi_firmware_transaction() */
+	fw->cl.tx_block = false;
 
 	fw->chan = mbox_request_channel(&fw->cl, 0);
 	if (IS_ERR(fw->chan)) {
@@ -410,7 +828,14 @@ static int rpi_firmware_probe(struct platform_device *pdev)
 		return ret;
 	}
 
-	init_completion(&fw->c);
+	spin_lock_init(&fw->lock);
+	INIT_LIST_HEAD(&fw->queue);
+	INIT_LIST_HEAD(&fw->batched);
+
+	/* Without it, requests are just sent one by one */
+	fw->batch.fw = fw;
+	fw->batch.buf = dma_alloc_coherent(dev, RPI_FIRMWARE_BATCH_SIZE,
+					   &fw->batch.bus_addr, GFP_KERNEL);
 	kref_init(&fw->consumers);
 
 	platform_set_drvdata(pdev, fw);
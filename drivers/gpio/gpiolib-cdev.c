@@ -12,10 +12,13 @@
 #include <linux/file.h>
 #include <linux/gpio.h>
 #include <linux/gpio/driver.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/irqreturn.h>
 #include <linux/kernel.h>
 #include <linux/kfifo.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/pinctrl/consumer.h>
@@ -23,6 +26,7 @@
 #include <linux/spinlock.h>
 #include <linux/timekeeping.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <linux/workqueue.h>
 #include <linux/hte.h>
 #include <uapi/linux/gpio.h>
@@ -48,6 +52,8 @@ static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_info), 8));
 static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_info_changed), 8));
 static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_event), 8));
 static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_values), 8));
+static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_event_batch), 8));
+static_assert(IS_ALIGNED(sizeof(struct gpio_v2_line_event_ring), 8));
 
 /* Character device interface to GPIO.
  *
@@ -561,6 +567,18 @@ struct line {
  * the line_seqno is then the same and is cheaper to calculate.
  * @config_mutex: mutex for serializing ioctl() calls to ensure consistency
  * of configuration, particularly multi-step accesses to desc flags.
+ * @ring: the mmap()ed event ring, replacing @events once allocated
+ * @ring_events: the events of @ring
+ * @ring_size: the size of the @ring allocation
+ * @ring_head: the kernel's copy of the @ring head, the shared page is
+ * writable by userspace and only ever written from here
+ * @ring_num_events: the kernel's copy of the @ring size in events
+ * @events_ready: the pending events are ready to be read
+ * @batch_count: the number of events a reader is woken up for
+ * @batch_latency_ns: the latency a batch of events is allowed
+ * @batch_pending: the number of events in the current batch
+ * @batch_timer: timer for the latency of the current batch
+ * @batch_work: wakes up readers when @batch_timer has expired
  * @lines: the lines held by this line request, with @num_lines elements.
  */
 struct linereq {
@@ -572,6 +590,21 @@ struct linereq {
 	DECLARE_KFIFO_PTR(events, struct gpio_v2_line_event);
 	atomic_t seqno;
 	struct mutex config_mutex;
+	/*
+	 * The ring and the batch state are protected by wait.lock, the
+	 * ring pointers are set once by linereq_mmap().
+	 */
+	struct gpio_v2_line_event_ring *ring;
+	struct gpio_v2_line_event *ring_events;
+	size_t ring_size;
+	u32 ring_head;
+	u32 ring_num_events;
+	bool events_ready;
+	u32 batch_count;
+	u64 batch_latency_ns;
+	u32 batch_pending;
+	struct hrtimer batch_timer;
+	struct work_struct batch_work;
 	struct line lines[];
 };
 
@@ -609,21 +642,113 @@ struct linereq {
 	 GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE | \
 	 GPIO_V2_LINE_EDGE_FLAGS)
 
+/* must be called with wait.lock held */
+static bool linereq_events_empty(struct linereq *lr)
+{
+	if (lr->ring)
+		return lr->ring_head == READ_ONCE(lr->ring->tail);
+
+	return kfifo_is_empty(&lr->events);
+}
+
+/*
+ * Account for a new event in the current batch, returns true if readers
+ * have to be woken up.  Must be called with wait.lock held.
+ */
+static bool linereq_batch_event(struct linereq *lr)
+{
+	if (lr->batch_count <= 1) {
+		lr->events_ready = true;
+		return true;
+	}
+
+	if (lr->events_ready)
+		return false;
+
+	if (++lr->batch_pending >= lr->batch_count) {
+		hrtimer_try_to_cancel(&lr->batch_timer);
+		lr->batch_pending = 0;
+		lr->events_ready = true;
+		return true;
+	}
+
+	if (lr->batch_pending == 1)
+		hrtimer_start(&lr->batch_timer,
+			      ns_to_ktime(lr->batch_latency_ns),
+			      HRTIMER_MODE_REL);
+
+	return false;
+}
+
+static enum hrtimer_restart linereq_batch_timer_func(struct hrtimer *timer)
+{
+	struct linereq *lr = container_of(timer, struct linereq, batch_timer);
+
+	/* wait.lock is not irq safe, leave the wakeup to process context */
+	queue_work(system_highpri_wq, &lr->batch_work);
+
+	return HRTIMER_NORESTART;
+}
+
+static void linereq_batch_work_func(struct work_struct *work)
+{
+	struct linereq *lr = container_of(work, struct linereq, batch_work);
+	bool wake = false;
+
+	spin_lock(&lr->wait.lock);
+	if (lr->batch_pending && !linereq_events_empty(lr)) {
+		lr->events_ready = true;
+		wake = true;
+	}
+	lr->batch_pending = 0;
+	spin_unlock(&lr->wait.lock);
+
+	if (wake)
+		wake_up_poll(&lr->wait, EPOLLIN);
+}
+
+/* must be called with wait.lock held */
+static bool linereq_ring_put(struct linereq *lr,
+			     struct gpio_v2_line_event *le)
+{
+	struct gpio_v2_line_event_ring *ring = lr->ring;
+	u32 head = lr->ring_head;
+
+	/* a bogus tail only confuses userspace, the index is masked here */
+	if (head - smp_load_acquire(&ring->tail) >= lr->ring_num_events) {
+		WRITE_ONCE(ring->overflows, READ_ONCE(ring->overflows) + 1);
+		return false;
+	}
+
+	lr->ring_events[head & (lr->ring_num_events - 1)] = *le;
+	lr->ring_head = head + 1;
+	smp_store_release(&ring->head, head + 1);
+
+	return true;
+}
+
 static void linereq_put_event(struct linereq *lr,
 			      struct gpio_v2_line_event *le)
 {
 	bool overflow = false;
+	bool wake = false;
 
 	spin_lock(&lr->wait.lock);
-	if (kfifo_is_full(&lr->events)) {
-		overflow = true;
-		kfifo_skip(&lr->events);
+	if (lr->ring) {
+		overflow = !linereq_ring_put(lr, le);
+	} else {
+		if (kfifo_is_full(&lr->events)) {
+			overflow = true;
+			kfifo_skip(&lr->events);
+		}
+		kfifo_in(&lr->events, le, 1);
 	}
-	kfifo_in(&lr->events, le, 1);
-	spin_unlock(&lr->wait.lock);
 	if (!overflow)
+		wake = linereq_batch_event(lr);
+	spin_unlock(&lr->wait.lock);
+	if (wake)
 		wake_up_poll(&lr->wait, EPOLLIN);
-	else
+	else if (overflow)
 		pr_debug_ratelimited("event FIFO is full - event dropped\n");
 }
 
@@ -1434,6 +1559,31 @@ static long linereq_set_config(struct linereq *lr, void __user *ip)
 	return ret;
 }
 
+static long linereq_set_event_batch(struct linereq *lr, void __user *ip)
+{
+	struct gpio_v2_line_event_batch eb;
+
+	if (copy_from_user(&eb, ip, sizeof(eb)))
+		return -EFAULT;
+
+	if (memchr_inv(eb.padding, 0, sizeof(eb.padding)))
+		return -EINVAL;
+
+	if (eb.count > 1 && !eb.latency_us)
+		return -EINVAL;
+
+	spin_lock(&lr->wait.lock);
+	lr->batch_count = eb.count;
+	lr->batch_latency_ns = (u64)eb.latency_us * NSEC_PER_USEC;
+	spin_unlock(&lr->wait.lock);
+
+	/* release whatever was held back by the previous settings */
+	hrtimer_cancel(&lr->batch_timer);
+	linereq_batch_work_func(&lr->batch_work);
+
+	return 0;
+}
+
 static long linereq_ioctl_unlocked(struct file *file, unsigned int cmd,
 				   unsigned long arg)
 {
@@ -1450,6 +1600,8 @@ static long linereq_ioctl_unlocked(struct file *file, unsigned int cmd,
 		return linereq_set_values(lr, ip);
 	case GPIO_V2_LINE_SET_CONFIG_IOCTL:
 		return linereq_set_config(lr, ip);
+	case GPIO_V2_LINE_SET_EVENT_BATCH_IOCTL:
+		return linereq_set_event_batch(lr, ip);
 	default:
 		return -EINVAL;
 	}
@@ -1483,9 +1635,13 @@ static __poll_t linereq_poll_unlocked(struct file *file,
 
 	poll_wait(file, &lr->wait, wait);
 
-	if (!kfifo_is_empty_spinlocked_noirqsave(&lr->events,
-						 &lr->wait.lock))
+	spin_lock(&lr->wait.lock);
+	/* the ring is consumed without the kernel noticing */
+	if (lr->events_ready && linereq_events_empty(lr))
+		lr->events_ready = false;
+	if (lr->events_ready)
 		events = EPOLLIN | EPOLLRDNORM;
+	spin_unlock(&lr->wait.lock);
 
 	return events;
 }
@@ -1512,9 +1668,18 @@ static ssize_t linereq_read_unlocked(struct file *file, char __user *buf,
 	if (count < sizeof(le))
 		return -EINVAL;
 
+	if (READ_ONCE(lr->ring))
+		return -EBUSY;
+
 	do {
 		spin_lock(&lr->wait.lock);
-		if (kfifo_is_empty(&lr->events)) {
+		/*
+		 * A blocking read waits for a batch of events to be ready,
+		 * a non-blocking one takes whatever is there.
+		 */
+		if (kfifo_is_empty(&lr->events) ||
+		    (!bytes_read && !lr->events_ready &&
+		     !(file->f_flags & O_NONBLOCK))) {
 			if (bytes_read) {
 				spin_unlock(&lr->wait.lock);
 				return bytes_read;
@@ -1526,7 +1691,9 @@ static ssize_t linereq_read_unlocked(struct file *file, char __user *buf,
 			}
 
 			ret = wait_event_interruptible_locked(lr->wait,
-					!kfifo_is_empty(&lr->events));
+					lr->events_ready || lr->ring);
+			if (!ret && lr->ring)
+				ret = -EBUSY;
 			if (ret) {
 				spin_unlock(&lr->wait.lock);
 				return ret;
@@ -1534,6 +1701,8 @@ static ssize_t linereq_read_unlocked(struct file *file, char __user *buf,
 		}
 
 		ret = kfifo_out(&lr->events, &le, 1);
+		if (kfifo_is_empty(&lr->events))
+			lr->events_ready = false;
 		spin_unlock(&lr->wait.lock);
 		if (ret != 1) {
 			/*
@@ -1562,6 +1731,63 @@ static ssize_t linereq_read(struct file *file, char __user *buf,
 				linereq_read_unlocked);
 }
 
+static int linereq_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct linereq *lr = file->private_data;
+	struct gpio_v2_line_event_ring *ring;
+	unsigned int num_events;
+	size_t offset, size;
+	int ret = 0;
+
+	if (!lr->gdev->chip)
+		return -ENODEV;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	mutex_lock(&lr->config_mutex);
+
+	if (!lr->ring) {
+		num_events = roundup_pow_of_two(lr->event_buffer_size);
+		offset = ALIGN(sizeof(*ring), SMP_CACHE_BYTES);
+		size = PAGE_ALIGN(offset +
+				  num_events * sizeof(*lr->ring_events));
+
+		ring = vmalloc_user(size);
+		if (!ring) {
+			ret = -ENOMEM;
+			goto out_unlock;
+		}
+		ring->num_events = num_events;
+		ring->offset = offset;
+
+		/* events still in the FIFO are dropped */
+		spin_lock(&lr->wait.lock);
+		kfifo_reset(&lr->events);
+		lr->ring_events = (void *)ring + offset;
+		lr->ring_size = size;
+		lr->ring_head = 0;
+		lr->ring_num_events = num_events;
+		lr->ring = ring;
+		lr->events_ready = false;
+		lr->batch_pending = 0;
+		spin_unlock(&lr->wait.lock);
+		wake_up_poll(&lr->wait, EPOLLIN);
+	}
+
+	if (vma->vm_end - vma->vm_start != lr->ring_size) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	ret = remap_vmalloc_range(vma, lr->ring, 0);
+
+out_unlock:
+	mutex_unlock(&lr->config_mutex);
+
+	return ret;
+}
+
 static void linereq_free(struct linereq *lr)
 {
 	unsigned int i;
@@ -1572,6 +1798,9 @@ static void linereq_free(struct linereq *lr)
 			gpiod_free(lr->lines[i].desc);
 		}
 	}
+	hrtimer_cancel(&lr->batch_timer);
+	cancel_work_sync(&lr->batch_work);
+	vfree(lr->ring);
 	kfifo_free(&lr->events);
 	kfree(lr->label);
 	put_device(&lr->gdev->dev);
@@ -1605,6 +1834,7 @@ static const struct file_operations line_fileops = {
 	.release = linereq_release,
 	.read = linereq_read,
 	.poll = linereq_poll,
+	.mmap = linereq_mmap,
 	.owner = THIS_MODULE,
 	.llseek = noop_llseek,
 	.unlocked_ioctl = linereq_ioctl,
@@ -1646,6 +1876,9 @@ static int linereq_create(struct gpio_device *gdev, void __user *ip)
 
 	lr->gdev = gdev;
 	get_device(&gdev->dev);
+	hrtimer_init(&lr->batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	lr->batch_timer.function = linereq_batch_timer_func;
+	INIT_WORK(&lr->batch_work, linereq_batch_work_func);
 
 	for (i = 0; i < ulr.num_lines; i++) {
 		lr->lines[i].req = lr;
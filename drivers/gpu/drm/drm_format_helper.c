@@ -20,6 +20,8 @@
 #include <drm/drm_print.h>
 #include <drm/drm_rect.h>
 
+#include "drm_format_helper_neon.h"
+
 static unsigned int clip_offset(const struct drm_rect *clip, unsigned int pitch, unsigned int cpp)
 {
 	return clip->y1 * pitch + clip->x1 * cpp;
@@ -328,7 +330,8 @@ static void drm_fb_xrgb8888_to_rgb565_line(void *dbuf, const void *sbuf, unsigne
 	u16 val16;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_xrgb8888_to_rgb565_line_neon(dbuf16, sbuf32, pixels, false);
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		val16 = ((pix & 0x00F80000) >> 8) |
 			((pix & 0x0000FC00) >> 5) |
@@ -346,7 +349,8 @@ static void drm_fb_xrgb8888_to_rgb565_swab_line(void *dbuf, const void *sbuf,
 	u16 val16;
 	u32 pix;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_xrgb8888_to_rgb565_line_neon(dbuf16, sbuf32, pixels, true);
+	for (; x < pixels; x++) {
 		pix = le32_to_cpu(sbuf32[x]);
 		val16 = ((pix & 0x00F80000) >> 8) |
 			((pix & 0x0000FC00) >> 5) |
@@ -561,7 +565,9 @@ static void drm_fb_xrgb8888_to_gray8_line(void *dbuf, const void *sbuf, unsigned
 	const __le32 *sbuf32 = sbuf;
 	unsigned int x;
 
-	for (x = 0; x < pixels; x++) {
+	x = drm_fb_xrgb8888_to_gray8_line_neon(dbuf8, sbuf32, pixels);
+	dbuf8 += x;
+	for (; x < pixels; x++) {
 		u32 pix = le32_to_cpu(sbuf32[x]);
 		u8 r = (pix & 0x00ff0000) >> 16;
 		u8 g = (pix & 0x0000ff00) >> 8;
@@ -691,6 +697,12 @@ static void drm_fb_gray8_to_mono_line(void *dbuf, const void *sbuf, unsigned int
 {
 	u8 *dbuf8 = dbuf;
 	const u8 *sbuf8 = sbuf;
+	unsigned int done;
+
+	done = drm_fb_gray8_to_mono_line_neon(dbuf8, sbuf8, pixels);
+	dbuf8 += done / 8;
+	sbuf8 += done;
+	pixels -= done;
 
 	while (pixels) {
 		unsigned int i, bits = min(pixels, 8U);
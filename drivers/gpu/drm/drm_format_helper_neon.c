@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * NEON versions of the drm_format_helper line conversions
+ *
+ * Each function converts the largest prefix of the line that fills whole
+ * vectors and returns the number of pixels it has done, or 0 if NEON
+ * can't be used in the current context. The caller converts the rest.
+ * The results are bit-exact with the scalar code.
+ */
+
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#include <arm_neon.h>
+
+#include "drm_format_helper_neon.h"
+
+/* Not worth saving and restoring the NEON state for less than this. */
+#define DRM_FB_NEON_MIN_PIXELS	32
+
+static bool drm_fb_neon_begin(unsigned int pixels)
+{
+	if (pixels < DRM_FB_NEON_MIN_PIXELS || !may_use_simd())
+		return false;
+
+	kernel_neon_begin();
+
+	return true;
+}
+
+unsigned int drm_fb_xrgb8888_to_rgb565_line_neon(u16 *dbuf, const __le32 *sbuf,
+						 unsigned int pixels, bool swab)
+{
+	unsigned int x;
+
+	if (!drm_fb_neon_begin(pixels))
+		return 0;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		/* val[0] = blue ... val[3] = filler, for 8 pixels */
+		uint8x8x4_t pix = vld4_u8((const u8 *)&sbuf[x]);
+		uint16x8_t val16;
+
+		val16 = vshll_n_u8(pix.val[2], 8);
+		val16 = vsriq_n_u16(val16, vshll_n_u8(pix.val[1], 8), 5);
+		val16 = vsriq_n_u16(val16, vshll_n_u8(pix.val[0], 8), 11);
+		if (swab)
+			val16 = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(val16)));
+		vst1q_u16(&dbuf[x], val16);
+	}
+
+	kernel_neon_end();
+
+	return x;
+}
+
+unsigned int drm_fb_xrgb8888_to_gray8_line_neon(u8 *dbuf, const __le32 *sbuf,
+						unsigned int pixels)
+{
+	const uint16x8_t div10 = vdupq_n_u16(52429);
+	unsigned int x;
+
+	if (!drm_fb_neon_begin(pixels))
+		return 0;
+
+	for (x = 0; x + 8 <= pixels; x += 8) {
+		uint8x8x4_t pix = vld4_u8((const u8 *)&sbuf[x]);
+		uint32x4_t lo, hi;
+		uint16x8_t sum;
+
+		/* 3 * r + 6 * g + b, at most 2550 */
+		sum = vmull_u8(pix.val[2], vdup_n_u8(3));
+		sum = vmlal_u8(sum, pix.val[1], vdup_n_u8(6));
+		sum = vaddw_u8(sum, pix.val[0]);
+
+		/* sum / 10 == (sum * 52429) >> 19, exact for sum < 43690 */
+		lo = vmull_u16(vget_low_u16(sum), vget_low_u16(div10));
+		hi = vmull_high_u16(sum, div10);
+		sum = vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+		vst1_u8(&dbuf[x], vshrn_n_u16(sum, 3));
+	}
+
+	kernel_neon_end();
+
+	return x;
+}
+
+unsigned int drm_fb_gray8_to_mono_line_neon(u8 *dbuf, const u8 *sbuf,
+					    unsigned int pixels)
+{
+	static const int8_t shifts[16] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7,
+	};
+	const int8x16_t shift = vld1q_s8(shifts);
+	unsigned int x;
+
+	if (!drm_fb_neon_begin(pixels))
+		return 0;
+
+	for (x = 0; x + 16 <= pixels; x += 16) {
+		/* the MSB of each pixel moved to its bit in the output byte */
+		uint8x16_t bits = vshlq_u8(vshrq_n_u8(vld1q_u8(&sbuf[x]), 7), shift);
+
+		dbuf[x / 8] = vaddv_u8(vget_low_u8(bits));
+		dbuf[x / 8 + 1] = vaddv_u8(vget_high_u8(bits));
+	}
+
+	kernel_neon_end();
+
+	return x;
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+
+#ifndef __DRM_FORMAT_HELPER_NEON_H__
+#define __DRM_FORMAT_HELPER_NEON_H__
+
+#include <linux/types.h>
+
+#if IS_ENABLED(CONFIG_DRM_FORMAT_HELPER_NEON)
+unsigned int drm_fb_xrgb8888_to_rgb565_line_neon(u16 *dbuf, const __le32 *sbuf,
+						 unsigned int pixels, bool swab);
+unsigned int drm_fb_xrgb8888_to_gray8_line_neon(u8 *dbuf, const __le32 *sbuf,
+						unsigned int pixels);
+unsigned int drm_fb_gray8_to_mono_line_neon(u8 *dbuf, const u8 *sbuf,
+					    unsigned int pixels);
+#else
+static inline unsigned int
+drm_fb_xrgb8888_to_rgb565_line_neon(u16 *dbuf, const __le32 *sbuf,
+				    unsigned int pixels, bool swab)
+{
+	return 0;
+}
+
+static inline unsigned int
+drm_fb_xrgb8888_to_gray8_line_neon(u8 *dbuf, const __le32 *sbuf,
+				   unsigned int pixels)
+{
+	return 0;
+}
+
+static inline unsigned int
+drm_fb_gray8_to_mono_line_neon(u8 *dbuf, const u8 *sbuf, unsigned int pixels)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -22,6 +22,7 @@
 #include <drm/drm_framebuffer.h>
 #include <drm/drm_gem.h>
 #include <drm/drm_gem_framebuffer_helper.h>
+#include <drm/drm_managed.h>
 #include <drm/drm_mipi_dbi.h>
 #include <drm/drm_modes.h>
 #include <drm/drm_probe_helper.h>
@@ -257,6 +258,53 @@ static void mipi_dbi_set_window_address(struct mipi_dbi_dev *dbidev,
 			 ys & 0xff, (ye >> 8) & 0xff, ye & 0xff);
 }
 
+static void mipi_dbi_flush_work(struct work_struct *work)
+{
+	struct mipi_dbi_dev *dbidev = container_of(work, struct mipi_dbi_dev, flush_work);
+	struct drm_rect *rect = &dbidev->flush_rect;
+	int idx, ret;
+
+	if (!drm_dev_enter(&dbidev->drm, &idx))
+		return;
+
+	mipi_dbi_set_window_address(dbidev, rect->x1, rect->x2 - 1, rect->y1,
+				    rect->y2 - 1);
+
+	ret = mipi_dbi_command_buf(&dbidev->dbi, MIPI_DCS_WRITE_MEMORY_START,
+				   dbidev->flush_buf,
+				   drm_rect_width(rect) * drm_rect_height(rect) * 2);
+	if (ret)
+		drm_err_once(&dbidev->drm, "Failed to update display %d\n", ret);
+
+	drm_dev_exit(idx);
+}
+
+/*
+ * Convert into the transmit buffer that is not on the wire, then wait for
+ * the other one to go out and queue this one. The conversion of an update
+ * thus overlaps the transfer of the previous one.
+ */
+static int mipi_dbi_fb_queue(struct mipi_dbi_dev *dbidev, struct drm_framebuffer *fb,
+			     struct drm_rect *rect)
+{
+	void *buf = dbidev->tx_bufs[dbidev->tx_buf_idx];
+	int ret;
+
+	ret = mipi_dbi_buf_copy(buf, fb, rect, dbidev->dbi.swap_bytes);
+	if (ret)
+		return ret;
+
+	flush_work(&dbidev->flush_work);
+
+	dbidev->flush_buf = buf;
+	dbidev->flush_rect = *rect;
+	queue_work(system_highpri_wq, &dbidev->flush_work);
+
+	dbidev->tx_buf_idx ^= 1;
+
+	return 0;
+}
+
 static void mipi_dbi_fb_dirty(struct drm_framebuffer *fb, struct drm_rect *rect)
 {
 	struct iosys_map map[DRM_FORMAT_MAX_PLANES];
@@ -276,14 +324,21 @@ static void mipi_dbi_fb_dirty(struct drm_framebuffer *fb, struct drm_rect *rect)
 	if (!drm_dev_enter(fb->dev, &idx))
 		return;
 
+	DRM_DEBUG_KMS("Flushing [FB:%d] " DRM_RECT_FMT "\n", fb->base.id, DRM_RECT_ARG(rect));
+
+	if (dbidev->pipelined_flush) {
+		ret = mipi_dbi_fb_queue(dbidev, fb, rect);
+		if (ret)
+			drm_err_once(fb->dev, "Failed to update display %d\n", ret);
+		goto err_drm_dev_exit;
+	}
+
 	ret = drm_gem_fb_vmap(fb, map, data);
 	if (ret)
 		goto err_drm_dev_exit;
 
 	full = width == fb->width && height == fb->height;
 
-	DRM_DEBUG_KMS("Flushing [FB:%d] " DRM_RECT_FMT "\n", fb->base.id, DRM_RECT_ARG(rect));
-
 	if (!dbi->dc || !full || swap ||
 	    fb->format->format == DRM_FORMAT_XRGB8888) {
 		tr = dbidev->tx_buf;
@@ -327,6 +382,102 @@ enum drm_mode_status mipi_dbi_pipe_mode_valid(struct drm_simple_display_pipe *pi
 }
 EXPORT_SYMBOL(mipi_dbi_pipe_mode_valid);
 
+/*
+ * Up to this many damage rectangles are flushed separately per update.
+ * A window costs its address commands plus the setup of the transfers,
+ * which is accounted for as this many bytes of pixel data.
+ */
+#define MIPI_DBI_MAX_DAMAGE_RECTS	8
+#define MIPI_DBI_WINDOW_COST		64
+
+static unsigned int mipi_dbi_rect_cost(const struct drm_rect *rect)
+{
+	return MIPI_DBI_WINDOW_COST + drm_rect_width(rect) * drm_rect_height(rect) * 2;
+}
+
+static void mipi_dbi_rect_union(struct drm_rect *dst, const struct drm_rect *a,
+				const struct drm_rect *b)
+{
+	dst->x1 = min(a->x1, b->x1);
+	dst->y1 = min(a->y1, b->y1);
+	dst->x2 = max(a->x2, b->x2);
+	dst->y2 = max(a->y2, b->y2);
+}
+
+/* Merge @clip into the rectangle it grows the least. */
+static void mipi_dbi_rect_absorb(struct drm_rect *rects, unsigned int num,
+				 const struct drm_rect *clip)
+{
+	unsigned int i, best = 0, best_cost = UINT_MAX;
+	struct drm_rect merged;
+
+	for (i = 0; i < num; i++) {
+		unsigned int cost;
+
+		mipi_dbi_rect_union(&merged, &rects[i], clip);
+		cost = mipi_dbi_rect_cost(&merged) - mipi_dbi_rect_cost(&rects[i]);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = i;
+		}
+	}
+
+	mipi_dbi_rect_union(&rects[best], &rects[best], clip);
+}
+
+/*
+ * Collect the damage clips and merge any two rectangles for as long as
+ * sending their bounding box is cheaper than sending both windows.
+ */
+static unsigned int mipi_dbi_damage_rects(const struct drm_plane_state *old_state,
+					  struct drm_plane_state *state,
+					  struct drm_rect *rects)
+{
+	struct drm_atomic_helper_damage_iter iter;
+	unsigned int i, j, num = 0;
+	struct drm_rect clip;
+	bool merged;
+
+	drm_atomic_helper_damage_iter_init(&iter, old_state, state);
+	drm_atomic_for_each_plane_damage(&iter, &clip) {
+		if (num < MIPI_DBI_MAX_DAMAGE_RECTS)
+			rects[num++] = clip;
+		else
+			mipi_dbi_rect_absorb(rects, num, &clip);
+	}
+
+	do {
+		unsigned int best_i = 0, best_j = 0;
+		int best_saving = -1;
+
+		merged = false;
+		for (i = 0; i < num; i++) {
+			for (j = i + 1; j < num; j++) {
+				struct drm_rect u;
+				int saving;
+
+				mipi_dbi_rect_union(&u, &rects[i], &rects[j]);
+				saving = mipi_dbi_rect_cost(&rects[i]) +
+					 mipi_dbi_rect_cost(&rects[j]) -
+					 mipi_dbi_rect_cost(&u);
+				if (saving > best_saving) {
+					best_saving = saving;
+					best_i = i;
+					best_j = j;
+				}
+			}
+		}
+
+		if (best_saving >= 0) {
+			mipi_dbi_rect_union(&rects[best_i], &rects[best_i], &rects[best_j]);
+			rects[best_j] = rects[--num];
+			merged = true;
+		}
+	} while (merged);
+
+	return num;
+}
+
 /**
  * mipi_dbi_pipe_update - Display pipe update helper
  * @pipe: Simple display pipe
@@ -334,18 +485,23 @@ EXPORT_SYMBOL(mipi_dbi_pipe_mode_valid);
  *
  * This function handles framebuffer flushing and vblank events. Drivers can use
  * this as their &drm_simple_display_pipe_funcs->update callback.
+ *
+ * Separate damaged areas are sent as separate windows, unless merging them
+ * puts fewer bytes on the bus.
  */
 void mipi_dbi_pipe_update(struct drm_simple_display_pipe *pipe,
 			  struct drm_plane_state *old_state)
 {
 	struct drm_plane_state *state = pipe->plane.state;
-	struct drm_rect rect;
+	struct drm_rect rects[MIPI_DBI_MAX_DAMAGE_RECTS];
+	unsigned int i, num;
 
 	if (!pipe->crtc.state->active)
 		return;
 
-	if (drm_atomic_helper_damage_merged(old_state, state, &rect))
-		mipi_dbi_fb_dirty(state->fb, &rect);
+	num = mipi_dbi_damage_rects(old_state, state, rects);
+	for (i = 0; i < num; i++)
+		mipi_dbi_fb_dirty(state->fb, &rects[i]);
 }
 EXPORT_SYMBOL(mipi_dbi_pipe_update);
 
@@ -420,6 +576,9 @@ void mipi_dbi_pipe_disable(struct drm_simple_display_pipe *pipe)
 
 	DRM_DEBUG_KMS("\n");
 
+	/* let a pipelined update finish before blanking or powering off */
+	flush_work(&dbidev->flush_work);
+
 	if (dbidev->backlight)
 		backlight_disable(dbidev->backlight);
 	else
@@ -477,6 +636,13 @@ static const uint32_t mipi_dbi_formats[] = {
 	DRM_FORMAT_XRGB8888,
 };
 
+static void mipi_dbi_flush_fini(struct drm_device *drm, void *ptr)
+{
+	struct mipi_dbi_dev *dbidev = ptr;
+
+	cancel_work_sync(&dbidev->flush_work);
+}
+
 /**
  * mipi_dbi_dev_init_with_formats - MIPI DBI device initialization with custom formats
  * @dbidev: MIPI DBI device structure to initialize
@@ -524,6 +690,18 @@ int mipi_dbi_dev_init_with_formats(struct mipi_dbi_dev *dbidev,
 	if (!dbidev->tx_buf)
 		return -ENOMEM;
 
+	INIT_WORK(&dbidev->flush_work, mipi_dbi_flush_work);
+	ret = drmm_add_action(drm, mipi_dbi_flush_fini, dbidev);
+	if (ret)
+		return ret;
+
+	if (dbidev->pipelined_flush) {
+		dbidev->tx_bufs[0] = dbidev->tx_buf;
+		dbidev->tx_bufs[1] = devm_kmalloc(drm->dev, tx_buf_size, GFP_KERNEL);
+		if (!dbidev->tx_bufs[1])
+			return -ENOMEM;
+	}
+
 	drm_mode_copy(&dbidev->mode, mode);
 	ret = mipi_dbi_rotate_mode(&dbidev->mode, rotation);
 	if (ret) {
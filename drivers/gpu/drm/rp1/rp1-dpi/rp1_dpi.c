@@ -37,6 +37,7 @@
 #include <drm/drm_managed.h>
 #include <drm/drm_crtc.h>
 #include <drm/drm_crtc_helper.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_encoder.h>
 #include <drm/drm_fb_helper.h>
 #include <drm/drm_framebuffer.h>
@@ -60,8 +61,31 @@
 static unsigned int default_bus_fmt = MEDIA_BUS_FMT_RGB666_1X18;
 module_param(default_bus_fmt, uint, 0644);
 
+/* Reduced refresh rate while the screen is static, see rp1_idle.h */
+static unsigned int idle_timeout_ms;
+module_param(idle_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(idle_timeout_ms, "Idle time before lowering the refresh rate (0 = never)");
+
+static unsigned int idle_fps = 10;
+module_param(idle_fps, uint, 0644);
+MODULE_PARM_DESC(idle_fps, "Refresh rate while idle");
+
 /* -------------------------------------------------------------- */
 
+static void rp1dpi_idle_set_vfp(struct rp1_idle *idle, u32 lines)
+{
+	rp1dpi_hw_set_vfp(container_of(idle, struct rp1_dpi, idle), lines);
+}
+
+static void rp1dpi_idle_work(struct work_struct *work)
+{
+	struct rp1_dpi *dpi = container_of(to_delayed_work(work),
+					   struct rp1_dpi, idle.work);
+
+	if (dpi->dpi_running)
+		rp1_idle_enter(&dpi->idle);
+}
+
 static void rp1dpi_pipe_update(struct drm_simple_display_pipe *pipe,
 			       struct drm_plane_state *old_state)
 {
@@ -78,6 +102,7 @@ static void rp1dpi_pipe_update(struct drm_simple_display_pipe *pipe,
 		if (!dpi->dpi_running || fb->format->format != dpi->cur_fmt) {
 			if (dpi->dpi_running &&
 			    fb->format->format != dpi->cur_fmt) {
+				rp1_idle_stop(&dpi->idle);
 				rp1dpi_hw_stop(dpi);
 				dpi->dpi_running = false;
 			}
@@ -87,12 +112,18 @@ static void rp1dpi_pipe_update(struct drm_simple_display_pipe *pipe,
 						dpi->bus_fmt,
 						dpi->de_inv,
 						&pipe->crtc.state->mode);
+				/* The front porch is a 12-bit field */
+				rp1_idle_setup(&dpi->idle,
+					       &pipe->crtc.state->mode,
+					       idle_timeout_ms, idle_fps, 4096);
 				dpi->dpi_running = true;
 			}
 			dpi->cur_fmt = fb->format->format;
 			drm_crtc_vblank_on(&pipe->crtc);
 		}
 		rp1dpi_hw_update(dpi, dma_obj->dma_addr, fb->offsets[0], fb->pitches[0]);
+		rp1_idle_update(&dpi->idle, old_state, pipe->plane.state,
+				idle_timeout_ms);
 	}
 
 	/* Arm VBLANK event (or call it immediately in some error cases) */
@@ -184,6 +215,7 @@ static void rp1dpi_pipe_disable(struct drm_simple_display_pipe *pipe)
 
 	dev_info(&dpi->pdev->dev, __func__);
 	drm_crtc_vblank_off(&pipe->crtc);
+	rp1_idle_stop(&dpi->idle);
 	if (dpi->dpi_running) {
 		rp1dpi_hw_stop(dpi);
 		dpi->dpi_running = false;
@@ -233,6 +265,7 @@ static void rp1dpi_stopall(struct drm_device *drm)
 	if (drm->dev_private) {
 		struct rp1_dpi *dpi = drm->dev_private;
 
+		rp1_idle_stop(&dpi->idle);
 		if (dpi->dpi_running || rp1dpi_hw_busy(dpi)) {
 			rp1dpi_hw_stop(dpi);
 			clk_disable_unprepare(dpi->clocks[RP1DPI_CLK_DPI]);
@@ -243,6 +276,19 @@ static void rp1dpi_stopall(struct drm_device *drm)
 	}
 }
 
+/*
+ * Align rows to 16 bytes, as the RP1 camera front end needs, so that frames
+ * it captures into dumb buffers can be scanned out without a copy.
+ */
+static int rp1dpi_dumb_create(struct drm_file *file_priv,
+			      struct drm_device *dev,
+			      struct drm_mode_create_dumb *args)
+{
+	args->pitch = ALIGN(DIV_ROUND_UP(args->width * args->bpp, 8), 16);
+
+	return drm_gem_dma_dumb_create_internal(file_priv, dev, args);
+}
+
 DEFINE_DRM_GEM_DMA_FOPS(rp1dpi_fops);
 
 static struct drm_driver rp1dpi_driver = {
@@ -253,7 +299,7 @@ static struct drm_driver rp1dpi_driver = {
 	.date			= "0",
 	.major			= 1,
 	.minor			= 0,
-	DRM_GEM_DMA_DRIVER_OPS,
+	DRM_GEM_DMA_DRIVER_OPS_WITH_DUMB_CREATE(rp1dpi_dumb_create),
 	.release		= rp1dpi_stopall,
 };
 
@@ -301,6 +347,8 @@ static int rp1dpi_platform_probe(struct platform_device *pdev)
 	}
 
 	init_completion(&dpi->finished);
+	INIT_DELAYED_WORK(&dpi->idle.work, rp1dpi_idle_work);
+	dpi->idle.set_vfp = rp1dpi_idle_set_vfp;
 	dpi->drm = drm;
 	dpi->pdev = pdev;
 	drm->dev_private = dpi;
@@ -366,6 +414,8 @@ static int rp1dpi_platform_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_free_drm;
 
+	drm_plane_enable_fb_damage_clips(&dpi->pipe.plane);
+
 	drm_mode_config_reset(drm);
 
 	ret = drm_dev_register(drm, 0);
@@ -8,9 +8,12 @@
 #include <linux/types.h>
 #include <linux/io.h>
 #include <linux/clk.h>
+#include <linux/workqueue.h>
 #include <drm/drm_device.h>
 #include <drm/drm_simple_kms_helper.h>
 
+#include "../rp1_idle.h"
+
 #define MODULE_NAME "drm-rp1-dpi"
 #define DRIVER_NAME "drm-rp1-dpi"
 
@@ -46,6 +49,9 @@ struct rp1_dpi {
 	bool de_inv, clk_inv;
 	bool dpi_running, pipe_enabled;
 	struct completion finished;
+
+	/* Reduced refresh rate while the screen is static */
+	struct rp1_idle idle;
 };
 
 /* ---------------------------------------------------------------------- */
@@ -57,6 +63,7 @@ void rp1dpi_hw_setup(struct rp1_dpi *dpi,
 		     bool de_inv,
 		     struct drm_display_mode const *mode);
 void rp1dpi_hw_update(struct rp1_dpi *dpi, dma_addr_t addr, u32 offset, u32 stride);
+void rp1dpi_hw_set_vfp(struct rp1_dpi *dpi, u32 lines);
 void rp1dpi_hw_stop(struct rp1_dpi *dpi);
 int rp1dpi_hw_busy(struct rp1_dpi *dpi);
 irqreturn_t rp1dpi_hw_isr(int irq, void *dev);
@@ -437,6 +437,19 @@ void rp1dpi_hw_update(struct rp1_dpi *dpi, dma_addr_t addr, u32 offset, u32 stri
 	rp1dpi_hw_write(dpi, DPI_DMA_DMA_ADDR_L, a & 0xFFFFFFFFu);
 }
 
+void rp1dpi_hw_set_vfp(struct rp1_dpi *dpi, u32 lines)
+{
+	u32 fp = rp1dpi_hw_read(dpi, DPI_DMA_FRONT_PORCH);
+
+	/*
+	 * Change the vertical front porch of a running display, to lower
+	 * the refresh rate (and the memory bandwidth) without a modeset.
+	 */
+	fp &= ~DPI_DMA_FRONT_PORCH_ROWSM1_MASK;
+	fp |= BITS(DPI_DMA_FRONT_PORCH_ROWSM1, lines - 1);
+	rp1dpi_hw_write(dpi, DPI_DMA_FRONT_PORCH, fp);
+}
+
 void rp1dpi_hw_stop(struct rp1_dpi *dpi)
 {
 	u32 ctrl;
@@ -22,6 +22,7 @@
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_crtc.h>
 #include <drm/drm_crtc_helper.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_encoder.h>
 #include <drm/drm_fourcc.h>
@@ -98,6 +99,38 @@ static const struct drm_bridge_funcs rp1_dsi_bridge_funcs = {
 	.attach = rp1_dsi_bridge_attach,
 };
 
+/* Reduced refresh rate while the screen is static, see rp1_idle.h */
+static unsigned int idle_timeout_ms;
+module_param(idle_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(idle_timeout_ms, "Idle time before lowering the refresh rate (0 = never)");
+
+static unsigned int idle_fps = 10;
+module_param(idle_fps, uint, 0644);
+MODULE_PARM_DESC(idle_fps, "Refresh rate while idle");
+
+static void rp1dsi_idle_set_vfp(struct rp1_idle *idle, u32 lines)
+{
+	struct rp1_dsi *dsi = container_of(idle, struct rp1_dsi, idle);
+
+	rp1dsi_dma_set_vfp(dsi, lines);
+	rp1dsi_dsi_set_vfp(dsi, lines);
+}
+
+static void rp1dsi_idle_work(struct work_struct *work)
+{
+	struct rp1_dsi *dsi = container_of(to_delayed_work(work),
+					   struct rp1_dsi, idle.work);
+
+	if (dsi->dma_running)
+		rp1_idle_enter(&dsi->idle);
+}
+
+static void rp1dsi_idle_stop(struct rp1_dsi *dsi)
+{
+	if (rp1_idle_stop(&dsi->idle) && dsi->dsi_running)
+		rp1dsi_dsi_set_vfp(dsi, dsi->idle.vfp_lines);
+}
+
 static void rp1dsi_pipe_update(struct drm_simple_display_pipe *pipe,
 			       struct drm_plane_state *old_state)
 {
@@ -113,6 +146,7 @@ static void rp1dsi_pipe_update(struct drm_simple_display_pipe *pipe,
 	if (can_update) {
 		if (!dsi->dma_running || fb->format->format != dsi->cur_fmt) {
 			if (dsi->dma_running && fb->format->format != dsi->cur_fmt) {
+				rp1dsi_idle_stop(dsi);
 				rp1dsi_dma_stop(dsi);
 				dsi->dma_running = false;
 			}
@@ -120,12 +154,18 @@ static void rp1dsi_pipe_update(struct drm_simple_display_pipe *pipe,
 				rp1dsi_dma_setup(dsi,
 						 fb->format->format, dsi->display_format,
 						&pipe->crtc.state->adjusted_mode);
+				/* The DSI Host VFP is a 10-bit field */
+				rp1_idle_setup(&dsi->idle,
+					       &pipe->crtc.state->adjusted_mode,
+					       idle_timeout_ms, idle_fps, 1023);
 				dsi->dma_running = true;
 			}
 			dsi->cur_fmt  = fb->format->format;
 			drm_crtc_vblank_on(&pipe->crtc);
 		}
 		rp1dsi_dma_update(dsi, dma_obj->dma_addr, fb->offsets[0], fb->pitches[0]);
+		rp1_idle_update(&dsi->idle, old_state, pipe->plane.state,
+				idle_timeout_ms);
 	}
 
 	/* Arm VBLANK event (or call it immediately in some error cases) */
@@ -167,6 +207,7 @@ static void rp1dsi_encoder_disable(struct drm_encoder *encoder)
 	struct rp1_dsi *dsi = encoder_to_rp1_dsi(encoder);
 
 	drm_crtc_vblank_off(&dsi->pipe.crtc);
+	rp1dsi_idle_stop(dsi);
 	if (dsi->dma_running) {
 		rp1dsi_dma_stop(dsi);
 		dsi->dma_running = false;
@@ -238,6 +279,7 @@ static void rp1dsi_stopall(struct drm_device *drm)
 	if (drm->dev_private) {
 		struct rp1_dsi *dsi = drm->dev_private;
 
+		rp1dsi_idle_stop(dsi);
 		if (dsi->dma_running || rp1dsi_dma_busy(dsi)) {
 			rp1dsi_dma_stop(dsi);
 			dsi->dma_running = false;
@@ -298,6 +340,8 @@ static int rp1dsi_bind(struct rp1_dsi *dsi)
 	if (ret)
 		goto rtn;
 
+	drm_plane_enable_fb_damage_clips(&dsi->pipe.plane);
+
 	/* We need slightly more complex encoder handling (enabling/disabling
 	 * video mode), so add encoder helper functions.
 	 */
@@ -428,6 +472,8 @@ static int rp1dsi_platform_probe(struct platform_device *pdev)
 		goto err_free_drm;
 	}
 	init_completion(&dsi->finished);
+	INIT_DELAYED_WORK(&dsi->idle.work, rp1dsi_idle_work);
+	dsi->idle.set_vfp = rp1dsi_idle_set_vfp;
 	dsi->drm = drm;
 	dsi->pdev = pdev;
 	drm->dev_private = dsi;
@@ -10,12 +10,15 @@
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 
 #include <drm/drm_bridge.h>
 #include <drm/drm_device.h>
 #include <drm/drm_mipi_dsi.h>
 #include <drm/drm_simple_kms_helper.h>
 
+#include "../rp1_idle.h"
+
 #define MODULE_NAME "drm-rp1-dsi"
 #define DRIVER_NAME "drm-rp1-dsi"
 
@@ -54,6 +57,9 @@ struct rp1_dsi {
 	bool dsi_running, dma_running, pipe_enabled;
 	struct completion finished;
 
+	/* Reduced refresh rate while the screen is static */
+	struct rp1_idle idle;
+
 	/* Attached display parameters (from mipi_dsi_device) */
 	unsigned long display_flags, display_hs_rate, display_lp_rate;
 	enum mipi_dsi_pixel_format display_format;
@@ -71,6 +77,7 @@ void rp1dsi_dma_setup(struct rp1_dsi *dsi,
 		      u32 in_format, enum mipi_dsi_pixel_format out_format,
 		      struct drm_display_mode const *mode);
 void rp1dsi_dma_update(struct rp1_dsi *dsi, dma_addr_t addr, u32 offset, u32 stride);
+void rp1dsi_dma_set_vfp(struct rp1_dsi *dsi, u32 lines);
 void rp1dsi_dma_stop(struct rp1_dsi *dsi);
 int rp1dsi_dma_busy(struct rp1_dsi *dsi);
 irqreturn_t rp1dsi_dma_isr(int irq, void *dev);
@@ -88,6 +95,7 @@ void rp1dsi_dsi_setup(struct rp1_dsi *dsi, struct drm_display_mode const *mode);
 void rp1dsi_dsi_send(struct rp1_dsi *dsi, u32 header, int len, const u8 *buf);
 int  rp1dsi_dsi_recv(struct rp1_dsi *dsi, int len, u8 *buf);
 void rp1dsi_dsi_set_cmdmode(struct rp1_dsi *dsi, int cmd_mode);
+void rp1dsi_dsi_set_vfp(struct rp1_dsi *dsi, u32 lines);
 void rp1dsi_dsi_stop(struct rp1_dsi *dsi);
 
 #endif
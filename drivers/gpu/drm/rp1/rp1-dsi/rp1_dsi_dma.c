@@ -394,6 +394,16 @@ void rp1dsi_dma_update(struct rp1_dsi *dsi, dma_addr_t addr, u32 offset, u32 str
 	rp1dsi_dma_write(dsi, DPI_DMA_DMA_ADDR_L, a & 0xFFFFFFFFu);
 }
 
+void rp1dsi_dma_set_vfp(struct rp1_dsi *dsi, u32 lines)
+{
+	u32 fp = rp1dsi_dma_read(dsi, DPI_DMA_FRONT_PORCH);
+
+	/* Change the vertical front porch of a running display */
+	fp &= ~DPI_DMA_FRONT_PORCH_ROWSM1_MASK;
+	fp |= BITS(DPI_DMA_FRONT_PORCH_ROWSM1, lines - 1);
+	rp1dsi_dma_write(dsi, DPI_DMA_FRONT_PORCH, fp);
+}
+
 void rp1dsi_dma_stop(struct rp1_dsi *dsi)
 {
 	/*
@@ -1502,3 +1502,9 @@ void rp1dsi_dsi_set_cmdmode(struct rp1_dsi *dsi, int mode)
 {
 	DSI_WRITE(DSI_MODE_CFG, mode);
 }
+
+/* The Host regenerates the video timing, so must follow DPI's VFP */
+void rp1dsi_dsi_set_vfp(struct rp1_dsi *dsi, u32 lines)
+{
+	DSI_WRITE(DSI_VID_VFP_LINES, lines);
+}
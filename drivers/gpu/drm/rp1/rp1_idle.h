@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Reduced refresh rate on static screens, for RP1 DPI and DSI
+ *
+ * Copyright (c) 2023 Raspberry Pi Limited.
+ */
+
+#ifndef _RP1_IDLE_H_
+#define _RP1_IDLE_H_
+
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/workqueue.h>
+
+#include <drm/drm_damage_helper.h>
+#include <drm/drm_modes.h>
+#include <drm/drm_plane.h>
+#include <drm/drm_rect.h>
+
+/*
+ * When the idle timeout is non-zero and nothing has been drawn for that
+ * long, lower the refresh rate to about idle_fps by lengthening the
+ * vertical front porch, to save memory bandwidth on static screens.
+ * The next update restores the full rate. Not every panel tolerates
+ * this, so the drivers leave it off by default. The idle rate is worked
+ * out when the display is enabled.
+ *
+ * The driver initialises work with its own handler, which should call
+ * rp1_idle_enter() while the output is running, and supplies set_vfp()
+ * to program the front porch.
+ */
+struct rp1_idle {
+	struct delayed_work work;
+	void (*set_vfp)(struct rp1_idle *idle, u32 lines);
+	u32 vfp_lines, idle_vfp_lines;
+	bool idle;
+};
+
+/* max_lines is the largest front porch the hardware can be given */
+static inline void rp1_idle_setup(struct rp1_idle *idle,
+				  struct drm_display_mode const *mode,
+				  unsigned int timeout_ms, unsigned int fps,
+				  u32 max_lines)
+{
+	int vrefresh = drm_mode_vrefresh(mode);
+	u32 lines;
+
+	idle->vfp_lines = mode->vsync_start - mode->vdisplay;
+	idle->idle_vfp_lines = 0;
+	idle->idle = false;
+
+	if (!timeout_ms || !fps || fps >= vrefresh || !idle->vfp_lines)
+		return;
+
+	lines = idle->vfp_lines + mode->vtotal * (vrefresh - fps) / fps;
+	idle->idle_vfp_lines = min_t(u32, lines, max_lines);
+}
+
+static inline void rp1_idle_enter(struct rp1_idle *idle)
+{
+	if (!idle->idle) {
+		idle->set_vfp(idle, idle->idle_vfp_lines);
+		idle->idle = true;
+	}
+}
+
+/* Leave the idle rate on any damage, and restart the idle timer */
+static inline void rp1_idle_update(struct rp1_idle *idle,
+				   struct drm_plane_state *old_state,
+				   struct drm_plane_state *state,
+				   unsigned int timeout_ms)
+{
+	struct drm_rect damage;
+
+	if (!idle->idle_vfp_lines)
+		return;
+
+	if (old_state &&
+	    !drm_atomic_helper_damage_merged(old_state, state, &damage))
+		return;
+
+	cancel_delayed_work_sync(&idle->work);
+	if (idle->idle) {
+		idle->set_vfp(idle, idle->vfp_lines);
+		idle->idle = false;
+	}
+	if (timeout_ms)
+		schedule_delayed_work(&idle->work,
+				      msecs_to_jiffies(timeout_ms));
+}
+
+/* Returns whether the idle front porch was still programmed */
+static inline bool rp1_idle_stop(struct rp1_idle *idle)
+{
+	bool was_idle;
+
+	cancel_delayed_work_sync(&idle->work);
+	was_idle = idle->idle;
+	idle->idle = false;
+	return was_idle;
+}
+
+#endif /* _RP1_IDLE_H_ */
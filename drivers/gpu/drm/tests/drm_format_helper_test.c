@@ -442,12 +442,101 @@ static void drm_test_fb_xrgb8888_to_xrgb2101010(struct kunit *test)
 	KUNIT_EXPECT_EQ(test, memcmp(buf, result->expected, dst_size), 0);
 }
 
+/*
+ * Lines long enough for the vectorized conversions, with a tail that is
+ * left to the scalar code. The expected values come from the reference
+ * formulas below.
+ */
+#define TEST_LONG_WIDTH 203
+#define TEST_LONG_HEIGHT 3
+
+static u16 ref_xrgb8888_to_rgb565(u32 pix)
+{
+	return ((pix & 0x00F80000) >> 8) |
+	       ((pix & 0x0000FC00) >> 5) |
+	       ((pix & 0x000000F8) >> 3);
+}
+
+static u8 ref_xrgb8888_to_gray8(u32 pix)
+{
+	u8 r = (pix & 0x00ff0000) >> 16;
+	u8 g = (pix & 0x0000ff00) >> 8;
+	u8 b =  pix & 0x000000ff;
+
+	return (3 * r + 6 * g + b) / 10;
+}
+
+static void drm_test_fb_xrgb8888_long_lines(struct kunit *test)
+{
+	const unsigned int npixels = TEST_LONG_WIDTH * TEST_LONG_HEIGHT;
+	const unsigned int mono_pitch = DIV_ROUND_UP(TEST_LONG_WIDTH, 8);
+	struct drm_rect clip = DRM_RECT_INIT(0, 0, TEST_LONG_WIDTH, TEST_LONG_HEIGHT);
+	struct drm_framebuffer fb = {
+		.format = drm_format_info(DRM_FORMAT_XRGB8888),
+		.pitches = { TEST_LONG_WIDTH * 4, 0, 0 },
+	};
+	struct iosys_map dst, src;
+	__le32 *xrgb8888;
+	u16 *rgb565;
+	u8 *gray8, *mono;
+	unsigned int i, x, y;
+	u32 seed = 1;
+
+	xrgb8888 = kunit_kcalloc(test, npixels, sizeof(*xrgb8888), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, xrgb8888);
+	rgb565 = kunit_kcalloc(test, npixels, sizeof(*rgb565), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, rgb565);
+	gray8 = kunit_kzalloc(test, npixels, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, gray8);
+	mono = kunit_kzalloc(test, mono_pitch * TEST_LONG_HEIGHT, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, mono);
+
+	for (i = 0; i < npixels; i++) {
+		seed = seed * 1103515245 + 12345;
+		xrgb8888[i] = cpu_to_le32(seed);
+	}
+	iosys_map_set_vaddr(&src, xrgb8888);
+
+	iosys_map_set_vaddr(&dst, rgb565);
+	drm_fb_xrgb8888_to_rgb565(&dst, NULL, &src, &fb, &clip, false);
+	for (i = 0; i < npixels; i++)
+		KUNIT_ASSERT_EQ_MSG(test, rgb565[i],
+				    ref_xrgb8888_to_rgb565(le32_to_cpu(xrgb8888[i])),
+				    "rgb565 pixel %u", i);
+
+	drm_fb_xrgb8888_to_rgb565(&dst, NULL, &src, &fb, &clip, true);
+	for (i = 0; i < npixels; i++)
+		KUNIT_ASSERT_EQ_MSG(test, rgb565[i],
+				    swab16(ref_xrgb8888_to_rgb565(le32_to_cpu(xrgb8888[i]))),
+				    "rgb565 swab pixel %u", i);
+
+	iosys_map_set_vaddr(&dst, gray8);
+	drm_fb_xrgb8888_to_gray8(&dst, NULL, &src, &fb, &clip);
+	for (i = 0; i < npixels; i++)
+		KUNIT_ASSERT_EQ_MSG(test, gray8[i],
+				    ref_xrgb8888_to_gray8(le32_to_cpu(xrgb8888[i])),
+				    "gray8 pixel %u", i);
+
+	iosys_map_set_vaddr(&dst, mono);
+	drm_fb_xrgb8888_to_mono(&dst, NULL, &src, &fb, &clip);
+	for (y = 0; y < TEST_LONG_HEIGHT; y++) {
+		for (x = 0; x < TEST_LONG_WIDTH; x++) {
+			bool set = mono[y * mono_pitch + x / 8] & BIT(x % 8);
+
+			KUNIT_ASSERT_EQ_MSG(test, set,
+					    gray8[y * TEST_LONG_WIDTH + x] >= 128,
+					    "mono pixel %u,%u", x, y);
+		}
+	}
+}
+
 static struct kunit_case drm_format_helper_test_cases[] = {
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_gray8, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_rgb332, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_rgb565, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_rgb888, convert_xrgb8888_gen_params),
 	KUNIT_CASE_PARAM(drm_test_fb_xrgb8888_to_xrgb2101010, convert_xrgb8888_gen_params),
+	KUNIT_CASE(drm_test_fb_xrgb8888_long_lines),
 	{}
 };
 
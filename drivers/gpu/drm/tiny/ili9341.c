@@ -209,6 +209,8 @@ static int ili9341_probe(struct spi_device *spi)
 	if (ret)
 		return ret;
 
+	dbidev->pipelined_flush = true;
+
 	ret = mipi_dbi_dev_init(dbidev, &ili9341_pipe_funcs, &yx240qv29_mode, rotation);
 	if (ret)
 		return ret;
@@ -12,6 +12,7 @@
  * shader dispatch).
  */
 
+#include <linux/capability.h>
 #include <linux/clk.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
@@ -20,10 +21,14 @@
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/reset.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
 
+#include <drm/drm_auth.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_fb_helper.h>
 #include <drm/drm_managed.h>
+#include <drm/drm_print.h>
 
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
@@ -92,6 +97,8 @@ static int v3d_get_param_ioctl(struct drm_device *dev, void *data,
 		args->value = (v3d->ver >= 40);
 		return 0;
 	case DRM_V3D_PARAM_SUPPORTS_MULTISYNC_EXT:
+	case DRM_V3D_PARAM_SUPPORTS_PRIORITY:
+	case DRM_V3D_PARAM_SUPPORTS_SUBMIT_CL_BATCH:
 		args->value = 1;
 		return 0;
 	default:
@@ -100,25 +107,38 @@ static int v3d_get_param_ioctl(struct drm_device *dev, void *data,
 	}
 }
 
+void v3d_file_stats_release(struct kref *ref)
+{
+	kfree(container_of(ref, struct v3d_file_stats, refcount));
+}
+
 static int
 v3d_open(struct drm_device *dev, struct drm_file *file)
 {
+	static atomic64_t client_ids = ATOMIC64_INIT(0);
 	struct v3d_dev *v3d = to_v3d_dev(dev);
 	struct v3d_file_priv *v3d_priv;
-	struct drm_gpu_scheduler *sched;
 	int i;
 
 	v3d_priv = kzalloc(sizeof(*v3d_priv), GFP_KERNEL);
 	if (!v3d_priv)
 		return -ENOMEM;
 
+	v3d_priv->stats = kzalloc(sizeof(*v3d_priv->stats), GFP_KERNEL);
+	if (!v3d_priv->stats) {
+		kfree(v3d_priv);
+		return -ENOMEM;
+	}
+	kref_init(&v3d_priv->stats->refcount);
+
 	v3d_priv->v3d = v3d;
+	v3d_priv->client_id = atomic64_inc_return(&client_ids);
 
 	for (i = 0; i < V3D_MAX_QUEUES; i++) {
-		sched = &v3d->queue[i].sched;
+		v3d_priv->sched[i] = &v3d->queue[i].sched;
 		drm_sched_entity_init(&v3d_priv->sched_entity[i],
-				      DRM_SCHED_PRIORITY_NORMAL, &sched,
-				      1, NULL);
+				      DRM_SCHED_PRIORITY_NORMAL,
+				      &v3d_priv->sched[i], 1, NULL);
 	}
 
 	v3d_perfmon_open_file(v3d_priv);
@@ -137,10 +157,99 @@ v3d_postclose(struct drm_device *dev, struct drm_file *file)
 		drm_sched_entity_destroy(&v3d_priv->sched_entity[q]);
 
 	v3d_perfmon_close_file(v3d_priv);
+	v3d_file_stats_put(v3d_priv->stats);
 	kfree(v3d_priv);
 }
 
-DEFINE_DRM_GEM_FOPS(v3d_drm_fops);
+static int
+v3d_set_priority_ioctl(struct drm_device *dev, void *data,
+		       struct drm_file *file_priv)
+{
+	struct v3d_file_priv *v3d_priv = file_priv->driver_priv;
+	struct drm_v3d_set_priority *args = data;
+	enum drm_sched_priority priority;
+	enum v3d_queue q;
+
+	if (args->pad)
+		return -EINVAL;
+
+	switch (args->priority) {
+	case DRM_V3D_PRIORITY_LOW:
+		priority = DRM_SCHED_PRIORITY_MIN;
+		break;
+	case DRM_V3D_PRIORITY_NORMAL:
+		priority = DRM_SCHED_PRIORITY_NORMAL;
+		break;
+	case DRM_V3D_PRIORITY_HIGH:
+		if (!capable(CAP_SYS_NICE) && !drm_is_current_master(file_priv))
+			return -EACCES;
+		priority = DRM_SCHED_PRIORITY_HIGH;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* The entity only picks a new run queue while it has a
+	 * scheduler list, which the scheduler drops after the first
+	 * job when there is a single scheduler, so hand it back.
+	 */
+	for (q = 0; q < V3D_MAX_QUEUES; q++) {
+		drm_sched_entity_set_priority(&v3d_priv->sched_entity[q], priority);
+		drm_sched_entity_modify_sched(&v3d_priv->sched_entity[q],
+					      &v3d_priv->sched[q], 1);
+	}
+
+	return 0;
+}
+
+static void v3d_show_fdinfo(struct seq_file *m, struct file *f)
+{
+	static const char * const engine_names[V3D_MAX_QUEUES] = {
+		[V3D_BIN] = "bin",
+		[V3D_RENDER] = "render",
+		[V3D_TFU] = "tfu",
+		[V3D_CSD] = "csd",
+		[V3D_CACHE_CLEAN] = "cache_clean",
+	};
+	struct drm_file *file = f->private_data;
+	struct v3d_file_priv *v3d_priv = file->driver_priv;
+	struct v3d_dev *v3d = v3d_priv->v3d;
+	struct drm_printer p = drm_seq_file_printer(m);
+	struct v3d_queue_stats *queue_stats;
+	enum v3d_queue queue;
+	u64 timestamp = local_clock();
+	u64 runtime, jobs;
+
+	drm_printf(&p, "drm-driver:\t%s\n", file->minor->dev->driver->name);
+	drm_printf(&p, "drm-client-id:\t%llu\n", v3d_priv->client_id);
+
+	for (queue = 0; queue < V3D_MAX_QUEUES; queue++) {
+		if (!v3d->queue[queue].sched.ready)
+			continue;
+
+		queue_stats = &v3d->gpu_queue_stats[queue];
+		mutex_lock(&queue_stats->lock);
+		v3d_sched_stats_update(queue_stats);
+		runtime = v3d_priv->stats->queue[queue].runtime;
+		jobs = v3d_priv->stats->queue[queue].jobs_sent;
+		/* Include the time spent so far by a job still running */
+		if (queue_stats->last_pid &&
+		    queue_stats->last_file == v3d_priv->stats)
+			runtime += timestamp - queue_stats->last_exec_start;
+		mutex_unlock(&queue_stats->lock);
+
+		drm_printf(&p, "drm-engine-%s:\t%llu ns\n",
+			   engine_names[queue], runtime);
+		drm_printf(&p, "v3d-jobs-%s:\t%llu jobs\n",
+			   engine_names[queue], jobs);
+	}
+}
+
+static const struct file_operations v3d_drm_fops = {
+	.owner = THIS_MODULE,
+	DRM_GEM_FOPS,
+	.show_fdinfo = v3d_show_fdinfo,
+};
 
 /* DRM_AUTH is required on SUBMIT_CL for now, while we don't have GMP
  * protection between clients.  Note that render nodes would be
@@ -160,6 +269,9 @@ static const struct drm_ioctl_desc v3d_drm_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(V3D_PERFMON_CREATE, v3d_perfmon_create_ioctl, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(V3D_PERFMON_DESTROY, v3d_perfmon_destroy_ioctl, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(V3D_PERFMON_GET_VALUES, v3d_perfmon_get_values_ioctl, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(V3D_SET_PRIORITY, v3d_set_priority_ioctl, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(V3D_SUBMIT_CL_BATCH, v3d_submit_cl_batch_ioctl,
+			  DRM_RENDER_ALLOW | DRM_AUTH),
 };
 
 static const struct drm_driver v3d_drm_driver = {
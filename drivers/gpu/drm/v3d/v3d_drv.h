@@ -2,6 +2,7 @@
 /* Copyright (C) 2015-2018 Broadcom */
 
 #include <linux/delay.h>
+#include <linux/kref.h>
 #include <linux/mutex.h>
 #include <linux/spinlock_types.h>
 #include <linux/workqueue.h>
@@ -54,8 +55,22 @@ struct v3d_queue_pid_stats {
 	pid_t	pid;
 };
 
+/* GPU usage of a DRM fd, reported through fdinfo. It is refcounted as
+ * the last job of a file may only be accounted after the file is closed.
+ * The counters of each queue are protected by that queue's
+ * v3d_queue_stats lock.
+ */
+struct v3d_file_stats {
+	struct kref refcount;
+	struct {
+		u64 runtime;
+		u64 jobs_sent;
+	} queue[V3D_MAX_QUEUES];
+};
+
 struct v3d_queue_stats {
 	struct mutex lock;
+	enum v3d_queue queue;
 	u64	last_exec_start;
 	u64	last_exec_end;
 	u64	runtime;
@@ -66,6 +81,8 @@ struct v3d_queue_stats {
 	 */
 	unsigned long gpu_pid_stats_timeout;
 	pid_t	last_pid;
+	/* File of the last job, holding a reference until it is accounted */
+	struct v3d_file_stats *last_file;
 	struct list_head pid_stats_list;
 };
 
@@ -226,6 +243,16 @@ struct v3d_file_priv {
 	} perfmon;
 
 	struct drm_sched_entity sched_entity[V3D_MAX_QUEUES];
+
+	/* Single entry scheduler lists for the entities, which
+	 * drm_sched_entity_modify_sched() needs to outlive the call
+	 * so that a priority change can move the entity's run queue.
+	 */
+	struct drm_gpu_scheduler *sched[V3D_MAX_QUEUES];
+
+	/* Identifies the file in fdinfo */
+	u64 client_id;
+	struct v3d_file_stats *stats;
 };
 
 struct v3d_bo {
@@ -302,6 +329,9 @@ struct v3d_job {
 	 */
 	pid_t client_pid;
 
+	/* GPU usage stats of the file that submitted the job. */
+	struct v3d_file_stats *file_stats;
+
 	/* Callback for the freeing of the job on refcount going to 0. */
 	void (*free)(struct kref *ref);
 };
@@ -429,6 +459,23 @@ struct drm_gem_object *v3d_prime_import_sg_table(struct drm_device *dev,
 /* v3d_debugfs.c */
 void v3d_debugfs_init(struct drm_minor *minor);
 
+/* v3d_drv.c */
+void v3d_file_stats_release(struct kref *ref);
+
+static inline struct v3d_file_stats *
+v3d_file_stats_get(struct v3d_file_stats *stats)
+{
+	kref_get(&stats->refcount);
+	return stats;
+}
+
+static inline void
+v3d_file_stats_put(struct v3d_file_stats *stats)
+{
+	if (stats)
+		kref_put(&stats->refcount, v3d_file_stats_release);
+}
+
 /* v3d_fence.c */
 extern const struct dma_fence_ops v3d_fence_ops;
 struct dma_fence *v3d_fence_create(struct v3d_dev *v3d, enum v3d_queue queue);
@@ -438,6 +485,8 @@ int v3d_gem_init(struct drm_device *dev);
 void v3d_gem_destroy(struct drm_device *dev);
 int v3d_submit_cl_ioctl(struct drm_device *dev, void *data,
 			struct drm_file *file_priv);
+int v3d_submit_cl_batch_ioctl(struct drm_device *dev, void *data,
+			      struct drm_file *file_priv);
 int v3d_submit_tfu_ioctl(struct drm_device *dev, void *data,
 			 struct drm_file *file_priv);
 int v3d_submit_csd_ioctl(struct drm_device *dev, void *data,
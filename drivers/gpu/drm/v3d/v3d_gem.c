@@ -422,6 +422,8 @@ v3d_job_free(struct kref *ref)
 	if (job->perfmon)
 		v3d_perfmon_put(job->perfmon);
 
+	v3d_file_stats_put(job->file_stats);
+
 	kfree(job);
 }
 
@@ -520,6 +522,7 @@ v3d_job_init(struct v3d_dev *v3d, struct drm_file *file_priv,
 	job->v3d = v3d;
 	job->free = free;
 	job->client_pid = current->pid;
+	job->file_stats = v3d_file_stats_get(v3d_priv->stats);
 
 	ret = drm_sched_job_init(&job->base, &v3d_priv->sched_entity[queue],
 				 v3d_priv);
@@ -904,6 +907,45 @@ v3d_submit_cl_ioctl(struct drm_device *dev, void *data,
 	return ret;
 }
 
+/**
+ * v3d_submit_cl_batch_ioctl() - Submits several jobs (frames) to the V3D.
+ * @dev: DRM device
+ * @data: ioctl argument
+ * @file_priv: DRM file for this fd
+ *
+ * Queues each of the CLs in turn as v3d_submit_cl_ioctl() would, saving
+ * userspace an ioctl round trip per frame when it has several ready.
+ * Stops at the first failing submit.
+ */
+int
+v3d_submit_cl_batch_ioctl(struct drm_device *dev, void *data,
+			  struct drm_file *file_priv)
+{
+	struct drm_v3d_submit_cl_batch *args = data;
+	struct drm_v3d_submit_cl __user *submits = u64_to_user_ptr(args->submits);
+	struct drm_v3d_submit_cl submit;
+	int ret = 0;
+
+	args->submitted = 0;
+
+	if (!args->count || args->count > DRM_V3D_MAX_CL_BATCH)
+		return -EINVAL;
+
+	while (args->submitted < args->count) {
+		if (copy_from_user(&submit, &submits[args->submitted],
+				   sizeof(submit)))
+			return -EFAULT;
+
+		ret = v3d_submit_cl_ioctl(dev, &submit, file_priv);
+		if (ret)
+			break;
+
+		args->submitted++;
+	}
+
+	return ret;
+}
+
 /**
  * v3d_submit_tfu_ioctl() - Submits a TFU (texture formatting) job to the V3D.
  * @dev: DRM device
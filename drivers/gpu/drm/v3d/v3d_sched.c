@@ -112,6 +112,13 @@ v3d_sched_stats_update(struct v3d_queue_stats *queue_stats)
 			  queue_stats->last_exec_start;
 		queue_stats->runtime += runtime;
 
+		if (queue_stats->last_file) {
+			queue_stats->last_file->queue[queue_stats->queue].runtime +=
+				runtime;
+			v3d_file_stats_put(queue_stats->last_file);
+			queue_stats->last_file = NULL;
+		}
+
 		if (store_pid_stats) {
 			struct v3d_queue_pid_stats *pid_stats;
 			/* Last job info is always at the head of the list */
@@ -151,6 +158,11 @@ v3d_sched_stats_add_job(struct v3d_queue_stats *queue_stats,
 	queue_stats->jobs_sent++;
 	queue_stats->last_pid = job->client_pid;
 
+	/* A job that never completed is not accounted to its file. */
+	v3d_file_stats_put(queue_stats->last_file);
+	queue_stats->last_file = v3d_file_stats_get(job->file_stats);
+	queue_stats->last_file->queue[queue_stats->queue].jobs_sent++;
+
 	/* gpu usage stats by process are being collected */
 	if (time_is_after_jiffies(queue_stats->gpu_pid_stats_timeout)) {
 		list_for_each_entry(cur, pid_stats_list, list) {
@@ -517,6 +529,7 @@ v3d_sched_init(struct v3d_dev *v3d)
 		 * pid_stats on scheduling init.
 		 */
 		v3d->gpu_queue_stats[q].gpu_pid_stats_timeout = jiffies - 1;
+		v3d->gpu_queue_stats[q].queue = q;
 		mutex_init(&v3d->gpu_queue_stats[q].lock);
 	}
 
@@ -585,6 +598,8 @@ v3d_sched_fini(struct v3d_dev *v3d)
 			 */
 			queue_stats->gpu_pid_stats_timeout = jiffies - 1;
 			v3d_sched_stats_update(queue_stats);
+			v3d_file_stats_put(queue_stats->last_file);
+			queue_stats->last_file = NULL;
 			mutex_unlock(&queue_stats->lock);
 			drm_sched_fini(&v3d->queue[q].sched);
 		}
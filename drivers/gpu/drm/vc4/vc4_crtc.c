@@ -31,12 +31,14 @@
 
 #include <linux/clk.h>
 #include <linux/component.h>
+#include <linux/crc32.h>
 #include <linux/of_device.h>
 #include <linux/pm_runtime.h>
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_atomic_uapi.h>
+#include <drm/drm_debugfs_crc.h>
 #include <drm/drm_fb_dma_helper.h>
 #include <drm/drm_framebuffer.h>
 #include <drm/drm_drv.h>
@@ -47,6 +49,7 @@
 #include "vc4_drv.h"
 #include "vc4_hdmi.h"
 #include "vc4_regs.h"
+#include "vc4_trace.h"
 
 #define HVS_FIFO_LATENCY_PIX	6
 
@@ -810,11 +813,17 @@ static int vc4_enable_vblank(struct drm_crtc *crtc)
 {
 	struct vc4_crtc *vc4_crtc = to_vc4_crtc(crtc);
 	struct drm_device *dev = crtc->dev;
+	unsigned long flags;
 	int idx;
 
 	if (!drm_dev_enter(dev, &idx))
 		return -ENODEV;
 
+	/* Don't count the time vblanks were off as missed */
+	spin_lock_irqsave(&vc4_crtc->irq_lock, flags);
+	vc4_crtc->stats.t_last_vblank = 0;
+	spin_unlock_irqrestore(&vc4_crtc->irq_lock, flags);
+
 	CRTC_WRITE(PV_INTEN, PV_INT_VFP_START);
 
 	drm_dev_exit(idx);
@@ -836,6 +845,177 @@ static void vc4_disable_vblank(struct drm_crtc *crtc)
 	drm_dev_exit(idx);
 }
 
+static unsigned int vc4_crtc_stats_bucket(u32 us)
+{
+	if (!us)
+		return 0;
+
+	return min_t(unsigned int, ilog2(us), VC4_CRTC_STATS_BUCKETS - 1);
+}
+
+static s64 vc4_crtc_frame_duration(struct vc4_crtc *vc4_crtc)
+{
+	struct drm_crtc *crtc = &vc4_crtc->base;
+
+	return crtc->dev->vblank[drm_crtc_index(crtc)].framedur_ns;
+}
+
+/* Must be called with irq_lock held */
+static void vc4_crtc_account_vblank(struct vc4_crtc *vc4_crtc)
+{
+	struct drm_crtc *crtc = &vc4_crtc->base;
+	struct vc4_crtc_stats *stats = &vc4_crtc->stats;
+	s64 framedur = vc4_crtc_frame_duration(vc4_crtc);
+	s64 interval;
+	u32 jitter;
+
+	stats->vblanks++;
+
+	if (!ktime_to_ns(stats->t_last_vblank) || !framedur)
+		goto out;
+
+	interval = ktime_to_ns(ktime_sub(vc4_crtc->t_vblank,
+					 stats->t_last_vblank));
+	trace_vc4_crtc_vblank(crtc->dev, drm_crtc_index(crtc), interval);
+
+	if (interval > framedur + framedur / 2) {
+		stats->missed_vblanks +=
+			div64_s64(interval + framedur / 2, framedur) - 1;
+		goto out;
+	}
+
+	jitter = div_u64(abs(interval - framedur), NSEC_PER_USEC);
+	stats->jitter[vc4_crtc_stats_bucket(jitter)]++;
+	stats->max_jitter_us = max(stats->max_jitter_us, jitter);
+
+out:
+	stats->t_last_vblank = vc4_crtc->t_vblank;
+}
+
+/* Must be called with irq_lock and the event_lock held */
+static void vc4_crtc_account_flip(struct vc4_crtc *vc4_crtc)
+{
+	struct drm_crtc *crtc = &vc4_crtc->base;
+	struct vc4_crtc_stats *stats = &vc4_crtc->stats;
+	s64 latency = ktime_to_ns(ktime_sub(vc4_crtc->t_vblank,
+					    vc4_crtc->t_event));
+	u32 latency_us;
+
+	if (latency < 0)
+		latency = 0;
+
+	trace_vc4_crtc_flip_done(crtc->dev, drm_crtc_index(crtc), latency);
+
+	latency_us = div_u64(latency, NSEC_PER_USEC);
+	stats->latency[vc4_crtc_stats_bucket(latency_us)]++;
+	stats->max_latency_us = max(stats->max_latency_us, latency_us);
+	stats->flips++;
+
+	/* The update didn't make it on the first vblank after the commit */
+	if (latency > vc4_crtc_frame_duration(vc4_crtc))
+		stats->late_flips++;
+}
+
+/*
+ * Neither the HVS nor the pixel valves can checksum their output, so
+ * CRCs are computed in software over the primary plane framebuffer of
+ * every display list that reached the screen, a stand-in good enough
+ * to match a presented frame against what was rendered.
+ */
+struct vc4_crtc_crc {
+	struct llist_node node;
+	struct drm_framebuffer *fb;
+	u64 frame;
+};
+
+static void vc4_crtc_crc_free(struct vc4_crtc_crc *crc)
+{
+	drm_framebuffer_put(crc->fb);
+	kfree(crc);
+}
+
+/* Must be called with irq_lock held */
+static void vc4_crtc_crc_presented(struct vc4_crtc *vc4_crtc)
+{
+	struct vc4_crtc_crc *crc = vc4_crtc->crc_next;
+
+	if (!crc)
+		return;
+
+	vc4_crtc->crc_next = NULL;
+	crc->frame = drm_crtc_vblank_count(&vc4_crtc->base);
+	/* Dropping the framebuffer can sleep, leave it to the worker */
+	llist_add(&crc->node, &vc4_crtc->crc_done);
+	queue_work(system_unbound_wq, &vc4_crtc->crc_work);
+}
+
+static void vc4_crtc_crc_work(struct work_struct *work)
+{
+	struct vc4_crtc *vc4_crtc = container_of(work, struct vc4_crtc,
+						 crc_work);
+	struct llist_node *list = llist_del_all(&vc4_crtc->crc_done);
+	struct vc4_crtc_crc *crc, *next;
+
+	llist_for_each_entry_safe(crc, next, llist_reverse_order(list), node) {
+		struct drm_framebuffer *fb = crc->fb;
+		struct drm_gem_dma_object *prev = NULL;
+		u32 value = ~0;
+		unsigned int i;
+
+		for (i = 0; i < fb->format->num_planes; i++) {
+			struct drm_gem_dma_object *bo;
+
+			bo = drm_fb_dma_get_gem_obj(fb, i);
+			/* Planes can share a BO, checksum it only once */
+			if (!bo->vaddr || bo == prev)
+				continue;
+
+			value = crc32_le(value, bo->vaddr, bo->base.size);
+			prev = bo;
+		}
+
+		if (prev)
+			drm_crtc_add_crc_entry(&vc4_crtc->base, true, crc->frame,
+					       &value);
+
+		vc4_crtc_crc_free(crc);
+	}
+}
+
+void vc4_crtc_queue_crc(struct drm_crtc *crtc)
+{
+	struct vc4_crtc *vc4_crtc = to_vc4_crtc(crtc);
+	struct drm_plane_state *plane_state = crtc->primary->state;
+	struct vc4_crtc_crc *crc, *old;
+	unsigned long flags;
+
+	if (!READ_ONCE(vc4_crtc->crc_enabled))
+		return;
+
+	if (!plane_state->fb || plane_state->crtc != crtc)
+		return;
+
+	crc = kzalloc(sizeof(*crc), GFP_KERNEL);
+	if (!crc)
+		return;
+
+	crc->fb = plane_state->fb;
+	drm_framebuffer_get(crc->fb);
+
+	spin_lock_irqsave(&vc4_crtc->irq_lock, flags);
+	old = vc4_crtc->crc_next;
+	if (vc4_crtc->crc_enabled) {
+		vc4_crtc->crc_next = crc;
+		crc = NULL;
+	}
+	spin_unlock_irqrestore(&vc4_crtc->irq_lock, flags);
+
+	if (crc)
+		vc4_crtc_crc_free(crc);
+	else if (old)
+		vc4_crtc_crc_free(old);
+}
+
 static void vc4_crtc_handle_page_flip(struct vc4_crtc *vc4_crtc)
 {
 	struct drm_crtc *crtc = &vc4_crtc->base;
@@ -849,6 +1029,8 @@ static void vc4_crtc_handle_page_flip(struct vc4_crtc *vc4_crtc)
 	spin_lock_irqsave(&dev->event_lock, flags);
 	spin_lock(&vc4_crtc->irq_lock);
 
+	vc4_crtc_account_vblank(vc4_crtc);
+
 	if (vc4->gen >= VC4_GEN_6)
 		current_dlist = VC4_GET_FIELD(HVS_READ(SCALER6_DISPX_DL(chan)),
 					      SCALER6_DISPX_DL_LACT);
@@ -857,6 +1039,18 @@ static void vc4_crtc_handle_page_flip(struct vc4_crtc *vc4_crtc)
 
 	if (vc4_crtc->event &&
 	    (vc4_crtc->current_dlist == current_dlist || vc4_crtc->feeds_txp)) {
+		ktime_t now;
+		u64 seq;
+
+		vc4_crtc_account_flip(vc4_crtc);
+
+		/* The same sequence and timestamp as the event carries */
+		seq = drm_crtc_vblank_count_and_time(crtc, &now);
+		trace_vc4_crtc_present(dev, drm_crtc_index(crtc), seq,
+				       vc4_hvs_get_fifo_frame_count(hvs, chan),
+				       now);
+		vc4_crtc_crc_presented(vc4_crtc);
+
 		drm_crtc_send_vblank_event(crtc, vc4_crtc->event);
 		vc4_crtc->event = NULL;
 		drm_crtc_vblank_put(crtc);
@@ -1166,6 +1360,92 @@ void vc4_crtc_reset(struct drm_crtc *crtc)
 	__drm_atomic_helper_crtc_reset(crtc, &vc4_crtc_state->base);
 }
 
+static int vc4_crtc_debugfs_timing(struct seq_file *m, void *unused)
+{
+	struct drm_info_node *node = m->private;
+	struct vc4_crtc *vc4_crtc = node->info_ent->data;
+	struct drm_printer p = drm_seq_file_printer(m);
+	struct vc4_crtc_stats stats;
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&vc4_crtc->irq_lock, flags);
+	stats = vc4_crtc->stats;
+	spin_unlock_irqrestore(&vc4_crtc->irq_lock, flags);
+
+	drm_printf(&p, "vblanks: %llu\n", stats.vblanks);
+	drm_printf(&p, "missed vblanks: %llu\n", stats.missed_vblanks);
+	drm_printf(&p, "max vblank jitter: %u us\n", stats.max_jitter_us);
+	drm_printf(&p, "flips: %llu\n", stats.flips);
+	drm_printf(&p, "late flips: %llu\n", stats.late_flips);
+	drm_printf(&p, "max commit to vblank latency: %u us\n",
+		   stats.max_latency_us);
+
+	drm_printf(&p, "\n%-16s %10s %10s\n", "us", "latency", "jitter");
+	for (i = 0; i < VC4_CRTC_STATS_BUCKETS; i++) {
+		if (i == VC4_CRTC_STATS_BUCKETS - 1)
+			drm_printf(&p, ">= %-13u", 1 << i);
+		else
+			drm_printf(&p, "%7u - %-6u", i ? 1 << i : 0,
+				   (2 << i) - 1);
+
+		drm_printf(&p, " %10u %10u\n",
+			   stats.latency[i], stats.jitter[i]);
+	}
+
+	return 0;
+}
+
+static const char * const vc4_crtc_crc_sources[] = { "auto" };
+
+static int vc4_crtc_verify_crc_source(struct drm_crtc *crtc,
+				      const char *source, size_t *values_cnt)
+{
+	if (source && strcmp(source, "auto"))
+		return -EINVAL;
+
+	*values_cnt = 1;
+	return 0;
+}
+
+static int vc4_crtc_set_crc_source(struct drm_crtc *crtc, const char *source)
+{
+	struct vc4_crtc *vc4_crtc = to_vc4_crtc(crtc);
+	struct vc4_crtc_crc *old = NULL;
+	bool enable = source != NULL;
+
+	if (vc4_crtc_verify_crc_source(crtc, source, &(size_t){ 0 }))
+		return -EINVAL;
+
+	spin_lock_irq(&vc4_crtc->irq_lock);
+	WRITE_ONCE(vc4_crtc->crc_enabled, enable);
+	if (!enable) {
+		old = vc4_crtc->crc_next;
+		vc4_crtc->crc_next = NULL;
+	}
+	spin_unlock_irq(&vc4_crtc->irq_lock);
+
+	if (old)
+		vc4_crtc_crc_free(old);
+
+	return 0;
+}
+
+static const char *const *vc4_crtc_get_crc_sources(struct drm_crtc *crtc,
+						   size_t *count)
+{
+	*count = ARRAY_SIZE(vc4_crtc_crc_sources);
+	return vc4_crtc_crc_sources;
+}
+
+static void vc4_crtc_crc_cleanup(struct drm_device *drm, void *ptr)
+{
+	struct vc4_crtc *vc4_crtc = ptr;
+
+	vc4_crtc_set_crc_source(&vc4_crtc->base, NULL);
+	flush_work(&vc4_crtc->crc_work);
+}
+
 int vc4_crtc_late_register(struct drm_crtc *crtc)
 {
 	struct drm_device *drm = crtc->dev;
@@ -1178,7 +1458,13 @@ int vc4_crtc_late_register(struct drm_crtc *crtc)
 	if (ret)
 		return ret;
 
-	return 0;
+	snprintf(vc4_crtc->timing_debugfs_name,
+		 sizeof(vc4_crtc->timing_debugfs_name),
+		 "crtc%u_timing", drm_crtc_index(crtc));
+
+	return vc4_debugfs_add_file(drm->primary,
+				    vc4_crtc->timing_debugfs_name,
+				    vc4_crtc_debugfs_timing, vc4_crtc);
 }
 
 static const struct drm_crtc_funcs vc4_crtc_funcs = {
@@ -1194,6 +1480,9 @@ static const struct drm_crtc_funcs vc4_crtc_funcs = {
 	.disable_vblank = vc4_disable_vblank,
 	.get_vblank_timestamp = drm_crtc_vblank_helper_get_vblank_timestamp,
 	.late_register = vc4_crtc_late_register,
+	.set_crc_source = vc4_crtc_set_crc_source,
+	.verify_crc_source = vc4_crtc_verify_crc_source,
+	.get_crc_sources = vc4_crtc_get_crc_sources,
 };
 
 static const struct drm_crtc_helper_funcs vc4_crtc_helper_funcs = {
@@ -1432,6 +1721,12 @@ int __vc4_crtc_init(struct drm_device *drm,
 
 	drm_crtc_helper_add(crtc, crtc_helper_funcs);
 
+	init_llist_head(&vc4_crtc->crc_done);
+	INIT_WORK(&vc4_crtc->crc_work, vc4_crtc_crc_work);
+	ret = drmm_add_action_or_reset(drm, vc4_crtc_crc_cleanup, vc4_crtc);
+	if (ret)
+		return ret;
+
 	if (vc4->gen == VC4_GEN_4) {
 		drm_mode_crtc_set_gamma_size(crtc, ARRAY_SIZE(vc4_crtc->lut_r));
 		drm_crtc_enable_color_mgmt(crtc, 0, false, crtc->gamma_size);
@@ -64,7 +64,11 @@ void __iomem *vc4_ioremap_regs(struct platform_device *pdev, int index)
 
 int vc4_dumb_fixup_args(struct drm_mode_create_dumb *args)
 {
-	int min_pitch = DIV_ROUND_UP(args->width * args->bpp, 8);
+	/*
+	 * 16 byte aligned rows can also be written by the TXP and by the
+	 * RP1 camera front end, so a buffer can be shared with them as is.
+	 */
+	int min_pitch = ALIGN(DIV_ROUND_UP(args->width * args->bpp, 8), 16);
 
 	if (args->pitch < min_pitch)
 		args->pitch = min_pitch;
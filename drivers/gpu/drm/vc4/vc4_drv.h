@@ -6,9 +6,11 @@
 #define _VC4_DRV_H_
 
 #include <linux/delay.h>
+#include <linux/llist.h>
 #include <linux/of.h>
 #include <linux/refcount.h>
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_debugfs.h>
@@ -370,6 +372,13 @@ struct vc4_hvs {
 	struct list_head stale_dlist_entries;
 	struct work_struct free_dlist_work;
 
+	/* DLIST allocator statistics, protected by mm_lock. */
+	struct {
+		unsigned long allocs;
+		unsigned long retries;
+		unsigned long failures;
+	} dlist_stats;
+
 	struct drm_mm_node mitchell_netravali_filter;
 
 	struct debugfs_regset32 regset;
@@ -607,6 +616,26 @@ struct vc5_gamma_entry {
 	.grad_term = (g)						\
 }
 
+#define VC4_CRTC_STATS_BUCKETS	16
+
+/*
+ * Frame timing statistics of a CRTC. The histograms use power of two
+ * buckets of microseconds: bucket n counts the samples in
+ * [2^n, 2^(n+1)) us, bucket 0 also has those under 1us and the last
+ * has everything above.
+ */
+struct vc4_crtc_stats {
+	ktime_t t_last_vblank;
+	u64 vblanks;
+	u64 missed_vblanks;
+	u64 flips;
+	u64 late_flips;
+	u32 max_latency_us;
+	u32 max_jitter_us;
+	u32 latency[VC4_CRTC_STATS_BUCKETS];
+	u32 jitter[VC4_CRTC_STATS_BUCKETS];
+};
+
 struct vc4_crtc {
 	struct drm_crtc base;
 	struct platform_device *pdev;
@@ -632,6 +661,12 @@ struct vc4_crtc {
 
 	struct drm_pending_vblank_event *event;
 
+	/**
+	 * @t_event: Time at which @event was queued along with its
+	 * display list. Protected by the DRM device event_lock.
+	 */
+	ktime_t t_event;
+
 	struct debugfs_regset32 regset;
 
 	/**
@@ -663,6 +698,34 @@ struct vc4_crtc {
 
 	/* @lbm: Our allocation in LBM for temporary storage during scaling. */
 	struct drm_mm_node lbm;
+
+	/**
+	 * @stats: Frame timing statistics, updated by the vblank handler.
+	 * Protected by @irq_lock.
+	 */
+	struct vc4_crtc_stats stats;
+
+	/* @timing_debugfs_name: Name of the debugfs file for @stats. */
+	char timing_debugfs_name[16];
+
+	/**
+	 * @crc_enabled: True while userspace captures CRCs of the
+	 * primary plane. Protected by @irq_lock.
+	 */
+	bool crc_enabled;
+
+	/**
+	 * @crc_next: Primary plane framebuffer of the last display list
+	 * committed, waiting for its page flip. Protected by @irq_lock.
+	 */
+	struct vc4_crtc_crc *crc_next;
+
+	/**
+	 * @crc_done: Framebuffers that reached the screen, queued by the
+	 * vblank handler for @crc_work to checksum.
+	 */
+	struct llist_head crc_done;
+	struct work_struct crc_work;
 };
 
 static inline struct vc4_crtc *
@@ -694,6 +757,8 @@ struct drm_encoder *vc4_get_crtc_encoder(struct drm_crtc *crtc,
 struct vc4_hvs_dlist_allocation {
 	struct list_head node;
 	struct drm_mm_node mm_node;
+	/* Dwords used, mm_node may be larger */
+	size_t dlist_count;
 	unsigned int channel;
 	u8 target_frame_count;
 };
@@ -1037,6 +1102,7 @@ void vc4_crtc_reset(struct drm_crtc *crtc);
 void vc4_crtc_handle_vblank(struct vc4_crtc *crtc);
 void vc4_crtc_send_vblank(struct drm_crtc *crtc);
 int vc4_crtc_late_register(struct drm_crtc *crtc);
+void vc4_crtc_queue_crc(struct drm_crtc *crtc);
 void vc4_crtc_get_margins(struct drm_crtc_state *state,
 			  unsigned int *left, unsigned int *right,
 			  unsigned int *top, unsigned int *bottom);
@@ -34,6 +34,7 @@
 #include <linux/module.h>
 
 #include <soc/bcm2835/raspberrypi-firmware.h>
+#include <soc/bcm2835/raspberrypi-firmware-async.h>
 
 #include "vc4_drv.h"
 #include "vc4_regs.h"
@@ -278,6 +279,8 @@ struct vc4_crtc {
 	void __iomem *regs;
 
 	struct drm_pending_vblank_event *event;
+	/* plane updates the firmware hasn't answered yet */
+	atomic_t flips_pending;
 	bool vblank_enabled;
 	u32 display_number;
 	u32 display_type;
@@ -376,6 +379,19 @@ struct vc4_fkms_plane {
 	dma_addr_t fbinfo_bus_addr;
 	u32 pitch;
 	struct mailbox_set_plane mb;
+
+	/*
+	 * Plane updates are queued to the firmware rather than waited
+	 * for. Updates made while one is in flight are coalesced into
+	 * flip_next, which is sent once the firmware has answered.
+	 */
+	struct rpi_firmware_request *flip_req;
+	spinlock_t flip_lock;		/* protects the fields below */
+	struct set_plane flip_next;
+	struct vc4_crtc *flip_crtc;
+	bool flip_busy;
+	bool flip_dirty;
+	bool flip_counted;		/* holds flip_crtc->flips_pending */
 };
 
 static inline struct vc4_fkms_plane *to_vc4_fkms_plane(struct drm_plane *plane)
@@ -383,6 +399,81 @@ static inline struct vc4_fkms_plane *to_vc4_fkms_plane(struct drm_plane *plane)
 	return (struct vc4_fkms_plane *)plane;
 }
 
+/* call with flip_lock held */
+static int vc4_plane_submit_update(struct vc4_fkms_plane *vc4_plane)
+{
+	memcpy(rpi_firmware_request_data(vc4_plane->flip_req),
+	       &vc4_plane->flip_next, sizeof(vc4_plane->flip_next));
+	vc4_plane->flip_dirty = false;
+
+	return rpi_firmware_request_submit(vc4_plane->flip_req);
+}
+
+static void vc4_plane_update_done(struct rpi_firmware_request *req,
+				  int status, void *ctx)
+{
+	struct vc4_fkms_plane *vc4_plane = ctx;
+	struct vc4_crtc *vc4_crtc = NULL;
+	unsigned long flags;
+
+	WARN_ONCE(status, "%s: firmware call failed. Please update your firmware",
+		  __func__);
+
+	spin_lock_irqsave(&vc4_plane->flip_lock, flags);
+	if (vc4_plane->flip_dirty && !vc4_plane_submit_update(vc4_plane)) {
+		spin_unlock_irqrestore(&vc4_plane->flip_lock, flags);
+		return;
+	}
+
+	vc4_plane->flip_busy = false;
+	if (vc4_plane->flip_counted) {
+		vc4_plane->flip_counted = false;
+		vc4_crtc = vc4_plane->flip_crtc;
+	}
+	spin_unlock_irqrestore(&vc4_plane->flip_lock, flags);
+
+	if (vc4_crtc)
+		atomic_dec(&vc4_crtc->flips_pending);
+}
+
+/*
+ * Sends the plane configuration without waiting for the firmware. A
+ * counted update holds back the CRTC's page flip event until the
+ * firmware has taken it, cursor moves don't need to.
+ */
+static int vc4_plane_queue_update(struct drm_plane *plane, bool counted)
+{
+	struct vc4_fkms_plane *vc4_plane = to_vc4_fkms_plane(plane);
+	struct vc4_crtc *vc4_crtc = to_vc4_crtc(plane->state->crtc);
+	unsigned long flags;
+	int ret = 0;
+
+	if (!vc4_plane->flip_req)
+		return -ENODEV;
+
+	spin_lock_irqsave(&vc4_plane->flip_lock, flags);
+
+	vc4_plane->flip_next = vc4_plane->mb.plane;
+	if (vc4_plane->flip_busy) {
+		vc4_plane->flip_dirty = true;
+	} else {
+		ret = vc4_plane_submit_update(vc4_plane);
+		if (!ret) {
+			vc4_plane->flip_busy = true;
+			vc4_plane->flip_crtc = vc4_crtc;
+		}
+	}
+
+	if (!ret && counted && !vc4_plane->flip_counted) {
+		vc4_plane->flip_counted = true;
+		atomic_inc(&vc4_plane->flip_crtc->flips_pending);
+	}
+
+	spin_unlock_irqrestore(&vc4_plane->flip_lock, flags);
+
+	return ret;
+}
+
 static int vc4_plane_set_blank(struct drm_plane *plane, bool blank)
 {
 	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
@@ -399,12 +490,24 @@ static int vc4_plane_set_blank(struct drm_plane *plane, bool blank)
 							"primary",
 							"cursor"
 						  };
+	unsigned long flags;
 	int ret;
 
 	DRM_DEBUG_ATOMIC("[PLANE:%d:%s] %s plane %s",
 			 plane->base.id, plane->name, plane_types[plane->type],
 			 blank ? "blank" : "unblank");
 
+	if (!blank && !vc4_plane_queue_update(plane, true))
+		return 0;
+
+	/*
+	 * Blanking supersedes any coalesced update, and is queued behind
+	 * the one in flight.
+	 */
+	spin_lock_irqsave(&vc4_plane->flip_lock, flags);
+	vc4_plane->flip_dirty = false;
+	spin_unlock_irqrestore(&vc4_plane->flip_lock, flags);
+
 	if (blank)
 		ret = rpi_firmware_property_list(vc4->firmware, &blank_mb,
 						 sizeof(blank_mb));
@@ -715,7 +818,8 @@ static void vc4_plane_atomic_async_update(struct drm_plane *plane,
 	plane->state->dst = new_plane_state->dst;
 	plane->state->visible = new_plane_state->visible;
 
-	vc4_plane_set_blank(plane, false);
+	if (vc4_plane_queue_update(plane, false))
+		vc4_plane_set_blank(plane, false);
 }
 
 static int vc4_plane_atomic_async_check(struct drm_plane *plane,
@@ -918,6 +1022,14 @@ static struct drm_plane *vc4_fkms_plane_init(struct drm_device *dev,
 	vc4_plane->mb.plane.plane_id = plane_id;
 	vc4_plane->mb.plane.layer = default_zpos ? default_zpos : -127;
 
+	/* Without it, plane updates wait for the firmware to answer */
+	spin_lock_init(&vc4_plane->flip_lock);
+	vc4_plane->flip_req =
+		rpi_firmware_request_alloc(to_vc4_dev(dev)->firmware,
+					   RPI_FIRMWARE_SET_PLANE,
+					   sizeof(struct set_plane),
+					   vc4_plane_update_done, vc4_plane);
+
 	return plane;
 fail:
 	if (plane)
@@ -1214,6 +1326,10 @@ static void vc4_crtc_handle_page_flip(struct vc4_crtc *vc4_crtc)
 	struct drm_device *dev = crtc->dev;
 	unsigned long flags;
 
+	/* the flip is only on screen after the firmware has taken it */
+	if (atomic_read(&vc4_crtc->flips_pending))
+		return;
+
 	spin_lock_irqsave(&dev->event_lock, flags);
 	if (vc4_crtc->event) {
 		drm_crtc_send_vblank_event(crtc, vc4_crtc->event);
@@ -2042,8 +2158,18 @@ static void vc4_fkms_unbind(struct device *dev, struct device *master,
 {
 	struct platform_device *pdev = to_platform_device(dev);
 	struct vc4_crtc **crtc_list = dev_get_drvdata(dev);
+	struct drm_device *drm = dev_get_drvdata(master);
+	struct drm_plane *plane;
 	int i;
 
+	/* before the firmware reference goes with this device */
+	drm_for_each_plane(plane, drm) {
+		struct vc4_fkms_plane *vc4_plane = to_vc4_fkms_plane(plane);
+
+		rpi_firmware_request_free(vc4_plane->flip_req);
+		vc4_plane->flip_req = NULL;
+	}
+
 	for (i = 0; crtc_list[i]; i++) {
 		vc4_fkms_connector_destroy(crtc_list[i]->connector);
 		vc4_fkms_encoder_destroy(crtc_list[i]->encoder);
@@ -1852,6 +1852,8 @@ static void vc4_hdmi_encoder_pre_crtc_enable(struct drm_encoder *encoder,
 	mutex_unlock(&vc4_hdmi->mutex);
 }
 
+static void vc4_hdmi_audio_configure(struct vc4_hdmi *vc4_hdmi);
+
 static void vc4_hdmi_encoder_post_crtc_enable(struct drm_encoder *encoder,
 					      struct drm_atomic_state *state)
 {
@@ -1925,6 +1927,17 @@ static void vc4_hdmi_encoder_post_crtc_enable(struct drm_encoder *encoder,
 		vc4_hdmi->packet_ram_enabled = true;
 
 		vc4_hdmi_set_infoframes(encoder);
+
+		/*
+		 * A modeset doesn't stop the audio stream, but the core
+		 * may have been reset and N/CTS follow the pixel clock,
+		 * so bring the MAI back up with the new mode.
+		 */
+		if (vc4_hdmi->audio.streaming && vc4_hdmi->audio.sample_rate) {
+			if (vc4_hdmi->variant->phy_rng_enable)
+				vc4_hdmi->variant->phy_rng_enable(vc4_hdmi);
+			vc4_hdmi_audio_configure(vc4_hdmi);
+		}
 	}
 
 	vc4_hdmi_recenter_fifo(vc4_hdmi);
@@ -2481,6 +2494,7 @@ static void vc4_hdmi_audio_reset(struct vc4_hdmi *vc4_hdmi)
 	lockdep_assert_held(&vc4_hdmi->mutex);
 
 	vc4_hdmi->audio.streaming = false;
+	vc4_hdmi->audio.sample_rate = 0;
 	ret = vc4_hdmi_stop_packet(encoder, HDMI_INFOFRAME_TYPE_AUDIO, false);
 	if (ret)
 		dev_err(dev, "Failed to stop audio infoframe: %d\n", ret);
@@ -2565,39 +2579,26 @@ static int sample_rate_to_mai_fmt(int samplerate)
 	}
 }
 
-/* HDMI audio codec callbacks */
-static int vc4_hdmi_audio_prepare(struct device *dev, void *data,
-				  struct hdmi_codec_daifmt *daifmt,
-				  struct hdmi_codec_params *params)
+/*
+ * Programs the MAI and the audio packet generation for the stream
+ * parameters saved by vc4_hdmi_audio_prepare(). This depends on the
+ * current mode through the N/CTS values and, on some variants, the
+ * HSM clock feeding the MAI, so it has to be reapplied after a modeset.
+ */
+static void vc4_hdmi_audio_configure(struct vc4_hdmi *vc4_hdmi)
 {
-	struct vc4_hdmi *vc4_hdmi = dev_get_drvdata(dev);
 	struct drm_device *drm = vc4_hdmi->connector.dev;
 	struct vc4_dev *vc4 = to_vc4_dev(drm);
-	struct drm_encoder *encoder = &vc4_hdmi->encoder.base;
-	unsigned int sample_rate = params->sample_rate;
-	unsigned int channels = params->channels;
+	unsigned int sample_rate = vc4_hdmi->audio.sample_rate;
+	unsigned int channels = vc4_hdmi->audio.channels;
 	unsigned long flags;
 	u32 audio_packet_config, channel_mask;
 	u32 channel_map;
 	u32 mai_audio_format;
 	u32 mai_sample_rate;
-	int ret = 0;
-	int idx;
+	u32 dreq_thr;
 
-	dev_dbg(dev, "%s: %u Hz, %d bit, %d channels\n", __func__,
-		sample_rate, params->sample_width, channels);
-
-	mutex_lock(&vc4_hdmi->mutex);
-
-	if (!drm_dev_enter(drm, &idx)) {
-		ret = -ENODEV;
-		goto out;
-	}
-
-	if (!vc4_hdmi_audio_can_stream(vc4_hdmi)) {
-		ret = -EINVAL;
-		goto out_dev_exit;
-	}
+	lockdep_assert_held(&vc4_hdmi->mutex);
 
 	vc4_hdmi_audio_set_mai_clock(vc4_hdmi, sample_rate);
 
@@ -2609,8 +2610,7 @@ static int vc4_hdmi_audio_prepare(struct device *dev, void *data,
 		   VC4_HD_MAI_CTL_ENABLE);
 
 	mai_sample_rate = sample_rate_to_mai_fmt(sample_rate);
-	if (params->iec.status[0] & IEC958_AES0_NONAUDIO &&
-	    params->channels == 8)
+	if (vc4_hdmi->audio.hbr)
 		mai_audio_format = VC4_HDMI_MAI_FORMAT_HBR;
 	else
 		mai_audio_format = VC4_HDMI_MAI_FORMAT_PCM;
@@ -2631,18 +2631,21 @@ static int vc4_hdmi_audio_prepare(struct device *dev, void *data,
 					     VC4_HDMI_AUDIO_PACKET_CEA_MASK);
 
 	/* Set the MAI threshold */
-	if (vc4->gen >= VC4_GEN_5)
+	if (vc4->gen >= VC4_GEN_5) {
 		HDMI_WRITE(HDMI_MAI_THR,
 			VC4_SET_FIELD(0x10, VC4_HD_MAI_THR_PANICHIGH) |
 			VC4_SET_FIELD(0x10, VC4_HD_MAI_THR_PANICLOW) |
 			VC4_SET_FIELD(0x1c, VC4_HD_MAI_THR_DREQHIGH) |
 			VC4_SET_FIELD(0x1c, VC4_HD_MAI_THR_DREQLOW));
-	else
+		dreq_thr = 0x1c;
+	} else {
 		HDMI_WRITE(HDMI_MAI_THR,
 			VC4_SET_FIELD(0x8, VC4_HD_MAI_THR_PANICHIGH) |
 			VC4_SET_FIELD(0x8, VC4_HD_MAI_THR_PANICLOW) |
 			VC4_SET_FIELD(0x6, VC4_HD_MAI_THR_DREQHIGH) |
 			VC4_SET_FIELD(0x8, VC4_HD_MAI_THR_DREQLOW));
+		dreq_thr = 0x8;
+	}
 
 	HDMI_WRITE(HDMI_MAI_CONFIG,
 		   VC4_HDMI_MAI_CONFIG_BIT_REVERSE |
@@ -2657,6 +2660,49 @@ static int vc4_hdmi_audio_prepare(struct device *dev, void *data,
 
 	spin_unlock_irqrestore(&vc4_hdmi->hw_lock, flags);
 
+	/*
+	 * The DMA controller tops the FIFO up as soon as it drains below
+	 * the DREQ threshold, so that much plus the burst in flight is
+	 * queued behind the DMA position while streaming.
+	 */
+	vc4_hdmi->audio.fifo_words = dreq_thr +
+				     vc4_hdmi->audio.dma_data.maxburst;
+}
+
+/* HDMI audio codec callbacks */
+static int vc4_hdmi_audio_prepare(struct device *dev, void *data,
+				  struct hdmi_codec_daifmt *daifmt,
+				  struct hdmi_codec_params *params)
+{
+	struct vc4_hdmi *vc4_hdmi = dev_get_drvdata(dev);
+	struct drm_device *drm = vc4_hdmi->connector.dev;
+	struct drm_encoder *encoder = &vc4_hdmi->encoder.base;
+	unsigned int sample_rate = params->sample_rate;
+	unsigned int channels = params->channels;
+	int ret = 0;
+	int idx;
+
+	dev_dbg(dev, "%s: %u Hz, %d bit, %d channels\n", __func__,
+		sample_rate, params->sample_width, channels);
+
+	mutex_lock(&vc4_hdmi->mutex);
+
+	if (!drm_dev_enter(drm, &idx)) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	if (!vc4_hdmi_audio_can_stream(vc4_hdmi)) {
+		ret = -EINVAL;
+		goto out_dev_exit;
+	}
+
+	vc4_hdmi->audio.sample_rate = sample_rate;
+	vc4_hdmi->audio.channels = channels;
+	vc4_hdmi->audio.hbr = params->iec.status[0] & IEC958_AES0_NONAUDIO &&
+			      channels == 8;
+	vc4_hdmi_audio_configure(vc4_hdmi);
+
 	memcpy(&vc4_hdmi->audio.infoframe, &params->cea, sizeof(params->cea));
 	vc4_hdmi_set_audio_infoframe(encoder);
 
@@ -2682,9 +2728,31 @@ static int vc4_hdmi_audio_cpu_dai_probe(struct snd_soc_dai *dai)
 	return 0;
 }
 
+/*
+ * The DMA residue only covers what the controller hasn't fetched yet,
+ * report the samples queued in the MAI FIFO on top of it.
+ */
+static snd_pcm_sframes_t
+vc4_hdmi_audio_delay(struct snd_pcm_substream *substream,
+		     struct snd_soc_dai *dai)
+{
+	struct vc4_hdmi *vc4_hdmi = dai_to_hdmi(dai);
+	unsigned int channels = substream->runtime->channels;
+
+	if (!READ_ONCE(vc4_hdmi->audio.streaming) || !channels)
+		return 0;
+
+	return READ_ONCE(vc4_hdmi->audio.fifo_words) / channels;
+}
+
+static const struct snd_soc_dai_ops vc4_hdmi_audio_cpu_dai_ops = {
+	.delay = vc4_hdmi_audio_delay,
+};
+
 static struct snd_soc_dai_driver vc4_hdmi_audio_cpu_dai_drv = {
 	.name = "vc4-hdmi-cpu-dai",
 	.probe  = vc4_hdmi_audio_cpu_dai_probe,
+	.ops = &vc4_hdmi_audio_cpu_dai_ops,
 	.playback = {
 		.stream_name = "Playback",
 		.channels_min = 1,
@@ -2791,6 +2859,12 @@ static int vc4_hdmi_audio_init(struct vc4_hdmi *vc4_hdmi)
 	vc4_hdmi->audio.dma_data.addr = iomem->start + mai_data->offset;
 	vc4_hdmi->audio.dma_data.addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;
 	vc4_hdmi->audio.dma_data.maxburst = 2;
+	/*
+	 * The DMA residue is burst accurate, so applications can run
+	 * small buffers off the pointer alone without period interrupts.
+	 */
+	vc4_hdmi->audio.dma_data.flags =
+		SND_DMAENGINE_PCM_DAI_FLAG_NO_PERIOD_WAKEUP;
 
 	/*
 	 * NOTE: Strictly speaking, we should probably use a DRM-managed
@@ -108,6 +108,13 @@ struct vc4_hdmi_audio {
 	struct hdmi_audio_infoframe infoframe;
 	struct platform_device *codec_pdev;
 	bool streaming;
+
+	/* Stream parameters, kept to reprogram the MAI after a modeset */
+	unsigned int sample_rate;
+	unsigned int channels;
+	bool hbr;
+	/* Samples sitting in the MAI FIFO while streaming */
+	unsigned int fifo_words;
 };
 
 enum vc4_hdmi_output_format {
@@ -22,6 +22,7 @@
 #include <linux/bitfield.h>
 #include <linux/clk.h>
 #include <linux/component.h>
+#include <linux/delay.h>
 #include <linux/platform_device.h>
 
 #include <drm/drm_atomic_helper.h>
@@ -32,6 +33,7 @@
 
 #include "vc4_drv.h"
 #include "vc4_regs.h"
+#include "vc4_trace.h"
 
 static const struct debugfs_reg32 vc4_hvs_regs[] = {
 	VC4_REG32(SCALER_DISPCTRL),
@@ -356,6 +358,9 @@ static int vc4_hvs_debugfs_dlist_allocs(struct seq_file *m, void *data)
 	struct drm_printer p = drm_seq_file_printer(m);
 	struct vc4_hvs_dlist_allocation *cur, *next;
 	struct drm_mm_node *mm_node;
+	u64 hole_start, hole_end;
+	u64 free = 0, largest = 0;
+	unsigned int holes = 0;
 	unsigned long flags;
 
 	spin_lock_irqsave(&hvs->mm_lock, flags);
@@ -372,6 +377,19 @@ static int vc4_hvs_debugfs_dlist_allocs(struct seq_file *m, void *data)
 			   cur->target_frame_count);
 	}
 
+	drm_mm_for_each_hole(mm_node, &hvs->dlist_mm, hole_start, hole_end) {
+		free += hole_end - hole_start;
+		largest = max(largest, hole_end - hole_start);
+		holes++;
+	}
+
+	drm_printf(&p, "Free: %llu dwords in %u holes, largest %llu, fragmentation %llu%%\n",
+		   free, holes, largest,
+		   free ? div64_u64((free - largest) * 100, free) : 0);
+	drm_printf(&p, "Allocations: %lu, reclaim retries: %lu, failures: %lu\n",
+		   hvs->dlist_stats.allocs, hvs->dlist_stats.retries,
+		   hvs->dlist_stats.failures);
+
 	spin_unlock_irqrestore(&hvs->mm_lock, flags);
 
 	return 0;
@@ -634,6 +652,67 @@ static void vc4_hvs_irq_clear_eof(struct vc4_hvs *hvs,
 	hvs->eof_irq[channel].enabled = false;
 }
 
+/*
+ * DLIST allocations are rounded up to a multiple of this, so that the
+ * hole left behind by a CRTC state fits the next allocation for a
+ * similar set of planes instead of slowly fragmenting the memory.
+ */
+#define VC4_HVS_DLIST_ALLOC_ALIGN		16
+
+/*
+ * How long an allocation may wait for the stale entries to be released
+ * by the hardware before it fails. This is a few frames.
+ */
+#define VC4_HVS_DLIST_RECLAIM_TIMEOUT_MS	100
+
+static void vc4_hvs_dlist_free_work(struct work_struct *work);
+
+/*
+ * The stale entries are only released once the hardware is done with
+ * them, so a commit coming right after a few others can fail to find
+ * space that is about to be freed. In that case, sweep the stale
+ * entries ourselves and retry until they are gone or we time out.
+ */
+static int vc4_hvs_insert_dlist_node(struct vc4_hvs *hvs,
+				     struct drm_mm_node *node,
+				     size_t size)
+{
+	unsigned long timeout =
+		jiffies + msecs_to_jiffies(VC4_HVS_DLIST_RECLAIM_TIMEOUT_MS);
+	bool retried = false;
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&hvs->mm_lock, flags);
+
+	while ((ret = drm_mm_insert_node(&hvs->dlist_mm, node, size)) == -ENOSPC) {
+		if (list_empty(&hvs->stale_dlist_entries) ||
+		    kunit_get_current_test() ||
+		    time_after(jiffies, timeout))
+			break;
+
+		hvs->dlist_stats.retries++;
+		spin_unlock_irqrestore(&hvs->mm_lock, flags);
+
+		/* The first sweep might be enough, or wait for a frame */
+		if (retried)
+			usleep_range(1000, 2000);
+		vc4_hvs_dlist_free_work(&hvs->free_dlist_work);
+		retried = true;
+
+		spin_lock_irqsave(&hvs->mm_lock, flags);
+	}
+
+	if (ret)
+		hvs->dlist_stats.failures++;
+	else
+		hvs->dlist_stats.allocs++;
+
+	spin_unlock_irqrestore(&hvs->mm_lock, flags);
+
+	return ret;
+}
+
 static struct vc4_hvs_dlist_allocation *
 vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
 			  unsigned int channel,
@@ -642,7 +721,6 @@ vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
 	struct vc4_dev *vc4 = hvs->vc4;
 	struct drm_device *dev = &vc4->base;
 	struct vc4_hvs_dlist_allocation *alloc;
-	unsigned long flags;
 	int ret;
 
 	if (channel == VC4_HVS_CHANNEL_DISABLED)
@@ -654,17 +732,18 @@ vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
 
 	INIT_LIST_HEAD(&alloc->node);
 
-	spin_lock_irqsave(&hvs->mm_lock, flags);
-	ret = drm_mm_insert_node(&hvs->dlist_mm, &alloc->mm_node,
-				 dlist_count);
-	spin_unlock_irqrestore(&hvs->mm_lock, flags);
+	ret = vc4_hvs_insert_dlist_node(hvs, &alloc->mm_node,
+					ALIGN(dlist_count,
+					      VC4_HVS_DLIST_ALLOC_ALIGN));
 	if (ret) {
 		drm_err(dev, "Failed to allocate DLIST entry. Requested size=%zu. ret=%d\n",
 			dlist_count, ret);
+		kfree(alloc);
 		return ERR_PTR(ret);
 	}
 
 	alloc->channel = channel;
+	alloc->dlist_count = dlist_count;
 
 	return alloc;
 }
@@ -1229,6 +1308,7 @@ static void vc4_hvs_update_dlist(struct drm_crtc *crtc)
 
 		if (!vc4_crtc->feeds_txp || vc4_state->txp_armed) {
 			vc4_crtc->event = crtc->state->event;
+			vc4_crtc->t_event = ktime_get();
 			crtc->state->event = NULL;
 		}
 
@@ -1237,6 +1317,9 @@ static void vc4_hvs_update_dlist(struct drm_crtc *crtc)
 
 	WARN_ON(!vc4_state->mm);
 
+	/* Before the vblank handler can see the new list as current */
+	vc4_crtc_queue_crc(crtc);
+
 	spin_lock_irqsave(&vc4_crtc->irq_lock, flags);
 	vc4_crtc->current_dlist = vc4_state->mm->mm_node.start;
 	spin_unlock_irqrestore(&vc4_crtc->irq_lock, flags);
@@ -1395,7 +1478,7 @@ void vc4_hvs_atomic_flush(struct drm_crtc *crtc,
 	dlist_next++;
 
 	WARN_ON(!vc4_state->mm);
-	WARN_ON_ONCE(dlist_next - dlist_start != vc4_state->mm->mm_node.size);
+	WARN_ON_ONCE(dlist_next - dlist_start != vc4_state->mm->dlist_count);
 
 	if (vc4->gen >= VC4_GEN_6) {
 		/* This sets a black background color fill, as is the case
@@ -1563,6 +1646,7 @@ static irqreturn_t vc4_hvs_irq_handler(int irq, void *data)
 		}
 
 		if (status & SCALER_DISPSTAT_EOF(channel)) {
+			trace_vc4_hvs_eof(dev, channel);
 			vc4_hvs_schedule_dlist_sweep(hvs, channel);
 			irqret = IRQ_HANDLED;
 		}
@@ -1592,6 +1676,7 @@ static irqreturn_t vc6_hvs_eof_irq_handler(int irq, void *data)
 		if (hvs->eof_irq[i].desc != irq)
 			continue;
 
+		trace_vc4_hvs_eof(dev, i);
 		vc4_hvs_schedule_dlist_sweep(hvs, i);
 		return IRQ_HANDLED;
 	}
@@ -2080,12 +2080,40 @@ void vc4_plane_async_set_fb(struct drm_plane *plane, struct drm_framebuffer *fb)
 	drm_dev_exit(idx);
 }
 
+/* Returns true if the dlist word at @offset holds the position or one of
+ * the framebuffer pointers, which are all an async update may change.
+ */
+static bool vc4_plane_async_word(struct vc4_plane_state *vc4_state,
+				 unsigned int offset)
+{
+	struct vc4_dev *vc4 = to_vc4_dev(vc4_state->base.plane->dev);
+	unsigned int num_planes = vc4_state->base.fb->format->num_planes;
+	unsigned int i;
+
+	if (offset == vc4_state->pos0_offset ||
+	    offset == vc4_state->pos2_offset)
+		return true;
+
+	for (i = 0; i < num_planes; i++) {
+		if (offset == vc4_state->ptr0_offset[i])
+			return true;
+
+		/* The low 32 bits of the address are in Pointer Word 1 */
+		if (vc4->gen >= VC4_GEN_6 &&
+		    offset == vc4_state->ptr0_offset[i] + 1)
+			return true;
+	}
+
+	return false;
+}
+
 static void vc4_plane_atomic_async_update(struct drm_plane *plane,
 					  struct drm_atomic_state *state)
 {
 	struct drm_plane_state *new_plane_state = drm_atomic_get_new_plane_state(state,
 										 plane);
 	struct vc4_plane_state *vc4_state, *new_vc4_state;
+	unsigned int i;
 	int idx;
 
 	if (!drm_dev_enter(plane->dev, &idx))
@@ -2132,24 +2160,21 @@ static void vc4_plane_atomic_async_update(struct drm_plane *plane,
 	vc4_state->is_yuv = new_vc4_state->is_yuv;
 	vc4_state->needs_bg_fill = new_vc4_state->needs_bg_fill;
 
-	/* Update the current vc4_state pos0, pos2 and ptr0 dlist entries. */
-	vc4_state->dlist[vc4_state->pos0_offset] =
-		new_vc4_state->dlist[vc4_state->pos0_offset];
-	vc4_state->dlist[vc4_state->pos2_offset] =
-		new_vc4_state->dlist[vc4_state->pos2_offset];
-	vc4_state->dlist[vc4_state->ptr0_offset[0]] =
-		new_vc4_state->dlist[vc4_state->ptr0_offset[0]];
-
-	/* Note that we can't just call vc4_plane_write_dlist()
-	 * because that would smash the context data that the HVS is
-	 * currently using.
+	/* Update the current vc4_state position and pointer dlist
+	 * entries, and only those in the hardware.  Note that we can't
+	 * just call vc4_plane_write_dlist() because that would smash the
+	 * context data that the HVS is currently using.
 	 */
-	writel(vc4_state->dlist[vc4_state->pos0_offset],
-	       &vc4_state->hw_dlist[vc4_state->pos0_offset]);
-	writel(vc4_state->dlist[vc4_state->pos2_offset],
-	       &vc4_state->hw_dlist[vc4_state->pos2_offset]);
-	writel(vc4_state->dlist[vc4_state->ptr0_offset[0]],
-	       &vc4_state->hw_dlist[vc4_state->ptr0_offset[0]]);
+	for (i = 0; i < vc4_state->dlist_count; i++) {
+		u32 val = new_vc4_state->dlist[i];
+
+		if (!vc4_plane_async_word(vc4_state, i) ||
+		    vc4_state->dlist[i] == val)
+			continue;
+
+		vc4_state->dlist[i] = val;
+		writel(val, &vc4_state->hw_dlist[i]);
+	}
 
 	drm_dev_exit(idx);
 }
@@ -2159,11 +2184,19 @@ static int vc4_plane_atomic_async_check(struct drm_plane *plane,
 {
 	struct drm_plane_state *new_plane_state = drm_atomic_get_new_plane_state(state,
 										 plane);
+	struct vc4_dev *vc4 = to_vc4_dev(plane->dev);
 	struct vc4_plane_state *old_vc4_state, *new_vc4_state;
 	int ret;
 	u32 i;
 
-	ret = vc4_plane_mode_set(plane, new_plane_state);
+	if (!plane->state->fb || !new_plane_state->fb ||
+	    plane->state->fb->format != new_plane_state->fb->format)
+		return -EINVAL;
+
+	if (vc4->gen >= VC4_GEN_6)
+		ret = vc6_plane_mode_set(plane, new_plane_state);
+	else
+		ret = vc4_plane_mode_set(plane, new_plane_state);
 	if (ret)
 		return ret;
 
@@ -2176,17 +2209,33 @@ static int vc4_plane_atomic_async_check(struct drm_plane *plane,
 	if (old_vc4_state->dlist_count != new_vc4_state->dlist_count ||
 	    old_vc4_state->pos0_offset != new_vc4_state->pos0_offset ||
 	    old_vc4_state->pos2_offset != new_vc4_state->pos2_offset ||
-	    old_vc4_state->ptr0_offset[0] != new_vc4_state->ptr0_offset[0] ||
+	    memcmp(old_vc4_state->ptr0_offset, new_vc4_state->ptr0_offset,
+		   sizeof(old_vc4_state->ptr0_offset)) ||
 	    vc4_lbm_size(plane->state) != vc4_lbm_size(new_plane_state))
 		return -EINVAL;
 
-	/* Only pos0, pos2 and ptr0 DWORDS can be updated in an async update
-	 * if anything else has changed, fallback to a sync update.
+	/* The UPM buffers are sized from the stride, which can't change
+	 * here, so the new pointers keep using the current ones.
+	 */
+	if (vc4->gen >= VC4_GEN_6) {
+		u32 upm_mask = SCALER6_PTR0_UPM_BASE_MASK |
+			       SCALER6_PTR0_UPM_HANDLE_MASK |
+			       SCALER6_PTR0_UPM_BUFF_SIZE_MASK;
+
+		for (i = 0; i < new_plane_state->fb->format->num_planes; i++) {
+			u32 offset = new_vc4_state->ptr0_offset[i];
+
+			new_vc4_state->dlist[offset] =
+				(new_vc4_state->dlist[offset] & ~upm_mask) |
+				(old_vc4_state->dlist[offset] & upm_mask);
+		}
+	}
+
+	/* Only the position and pointer DWORDS can be updated in an async
+	 * update if anything else has changed, fallback to a sync update.
 	 */
 	for (i = 0; i < new_vc4_state->dlist_count; i++) {
-		if (i == new_vc4_state->pos0_offset ||
-		    i == new_vc4_state->pos2_offset ||
-		    i == new_vc4_state->ptr0_offset[0] ||
+		if (vc4_plane_async_word(new_vc4_state, i) ||
 		    (new_vc4_state->lbm_offset &&
 		     i == new_vc4_state->lbm_offset))
 			continue;
@@ -2308,8 +2357,59 @@ static bool vc4_format_mod_supported(struct drm_plane *plane,
 	}
 }
 
+/* Same as drm_atomic_helper_update_plane(), but also lets legacy
+ * SetPlane moves of the overlay planes take the async path if they only
+ * change the position or the framebuffer, as cursor moves do.  If the
+ * async check fails, this is a normal blocking commit.
+ */
+static int vc4_plane_update_plane(struct drm_plane *plane,
+				  struct drm_crtc *crtc,
+				  struct drm_framebuffer *fb,
+				  int crtc_x, int crtc_y,
+				  unsigned int crtc_w, unsigned int crtc_h,
+				  uint32_t src_x, uint32_t src_y,
+				  uint32_t src_w, uint32_t src_h,
+				  struct drm_modeset_acquire_ctx *ctx)
+{
+	struct drm_atomic_state *state;
+	struct drm_plane_state *plane_state;
+	int ret = 0;
+
+	state = drm_atomic_state_alloc(plane->dev);
+	if (!state)
+		return -ENOMEM;
+
+	state->acquire_ctx = ctx;
+	plane_state = drm_atomic_get_plane_state(state, plane);
+	if (IS_ERR(plane_state)) {
+		ret = PTR_ERR(plane_state);
+		goto fail;
+	}
+
+	ret = drm_atomic_set_crtc_for_plane(plane_state, crtc);
+	if (ret != 0)
+		goto fail;
+	drm_atomic_set_fb_for_plane(plane_state, fb);
+	plane_state->crtc_x = crtc_x;
+	plane_state->crtc_y = crtc_y;
+	plane_state->crtc_w = crtc_w;
+	plane_state->crtc_h = crtc_h;
+	plane_state->src_x = src_x;
+	plane_state->src_y = src_y;
+	plane_state->src_w = src_w;
+	plane_state->src_h = src_h;
+
+	if (plane->type != DRM_PLANE_TYPE_PRIMARY)
+		state->legacy_cursor_update = true;
+
+	ret = drm_atomic_commit(state);
+fail:
+	drm_atomic_state_put(state);
+	return ret;
+}
+
 static const struct drm_plane_funcs vc4_plane_funcs = {
-	.update_plane = drm_atomic_helper_update_plane,
+	.update_plane = vc4_plane_update_plane,
 	.disable_plane = drm_atomic_helper_disable_plane,
 	.reset = vc4_plane_reset,
 	.atomic_duplicate_state = vc4_plane_duplicate_state,
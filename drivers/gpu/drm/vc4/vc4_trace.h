@@ -147,6 +147,98 @@ TRACE_EVENT(vc4_rcl_end_irq,
 		      __entry->seqno)
 );
 
+TRACE_EVENT(vc4_crtc_vblank,
+	    TP_PROTO(struct drm_device *dev, unsigned int crtc, s64 interval_ns),
+	    TP_ARGS(dev, crtc, interval_ns),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, crtc)
+			     __field(s64, interval_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = dev->primary->index;
+			   __entry->crtc = crtc;
+			   __entry->interval_ns = interval_ns;
+			   ),
+
+	    TP_printk("dev=%u, crtc=%u, interval_ns=%lld",
+		      __entry->dev,
+		      __entry->crtc,
+		      __entry->interval_ns)
+);
+
+TRACE_EVENT(vc4_crtc_flip_done,
+	    TP_PROTO(struct drm_device *dev, unsigned int crtc, s64 latency_ns),
+	    TP_ARGS(dev, crtc, latency_ns),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, crtc)
+			     __field(s64, latency_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = dev->primary->index;
+			   __entry->crtc = crtc;
+			   __entry->latency_ns = latency_ns;
+			   ),
+
+	    TP_printk("dev=%u, crtc=%u, latency_ns=%lld",
+		      __entry->dev,
+		      __entry->crtc,
+		      __entry->latency_ns)
+);
+
+TRACE_EVENT(vc4_crtc_present,
+	    TP_PROTO(struct drm_device *dev, unsigned int crtc, u64 seq,
+		     u8 frame_count, ktime_t timestamp),
+	    TP_ARGS(dev, crtc, seq, frame_count, timestamp),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, crtc)
+			     __field(u64, seq)
+			     __field(u8, frame_count)
+			     __field(s64, timestamp_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = dev->primary->index;
+			   __entry->crtc = crtc;
+			   __entry->seq = seq;
+			   __entry->frame_count = frame_count;
+			   __entry->timestamp_ns = ktime_to_ns(timestamp);
+			   ),
+
+	    TP_printk("dev=%u, crtc=%u, seq=%llu, frame_count=%u, ts=%lld",
+		      __entry->dev,
+		      __entry->crtc,
+		      __entry->seq,
+		      __entry->frame_count,
+		      __entry->timestamp_ns)
+);
+
+TRACE_EVENT(vc4_hvs_eof,
+	    TP_PROTO(struct drm_device *dev, unsigned int channel),
+	    TP_ARGS(dev, channel),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, channel)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = dev->primary->index;
+			   __entry->channel = channel;
+			   ),
+
+	    TP_printk("dev=%u, channel=%u",
+		      __entry->dev,
+		      __entry->channel)
+);
+
 #endif /* _VC4_TRACE_H_ */
 
 /* This part must be outside protection */
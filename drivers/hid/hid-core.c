@@ -340,6 +340,11 @@ static int hid_add_field(struct hid_parser *parser, unsigned report_type, unsign
 	field->unit_exponent = parser->global.unit_exponent;
 	field->unit = parser->global.unit;
 
+	/* These are read without going through the bit extraction */
+	field->aligned = !(offset % 8) &&
+			 (field->report_size == 8 || field->report_size == 16 ||
+			  field->report_size == 32);
+
 	return 0;
 }
 
@@ -1557,6 +1562,35 @@ static inline int hid_array_value_is_valid(struct hid_field *field,
 	       value - min < field->maxusage;
 }
 
+/*
+ * Fetch the values of a field made of whole bytes, most fields of high
+ * rate devices are.
+ */
+static void hid_input_fetch_aligned(struct hid_field *field, __u8 *data)
+{
+	unsigned int count = field->report_count;
+	bool sign = field->logical_minimum < 0;
+	__u8 *p = data + field->report_offset / 8;
+	__s32 *value = field->new_value;
+	unsigned int n;
+
+	switch (field->report_size) {
+	case 8:
+		for (n = 0; n < count; n++)
+			value[n] = sign ? (__s8)p[n] : p[n];
+		break;
+	case 16:
+		for (n = 0; n < count; n++, p += 2)
+			value[n] = sign ? (__s16)get_unaligned_le16(p) :
+					  get_unaligned_le16(p);
+		break;
+	case 32:
+		for (n = 0; n < count; n++, p += 4)
+			value[n] = get_unaligned_le32(p);
+		break;
+	}
+}
+
 /*
  * Fetch the field from the data. The field content is stored for next
  * report processing (we do differential reporting to the layer).
@@ -1573,19 +1607,25 @@ static void hid_input_fetch_field(struct hid_device *hid,
 	__s32 *value;
 
 	value = field->new_value;
-	memset(value, 0, count * sizeof(__s32));
 	field->ignored = false;
 
-	for (n = 0; n < count; n++) {
-
-		value[n] = min < 0 ?
-			snto32(hid_field_extract(hid, data, offset + n * size,
-			       size), size) :
-			hid_field_extract(hid, data, offset + n * size, size);
+	if (field->aligned)
+		hid_input_fetch_aligned(field, data);
+	else
+		for (n = 0; n < count; n++)
+			value[n] = min < 0 ?
+				snto32(hid_field_extract(hid, data,
+							 offset + n * size,
+							 size), size) :
+				hid_field_extract(hid, data, offset + n * size,
+						  size);
+
+	if (field->flags & HID_MAIN_ITEM_VARIABLE)
+		return;
 
-		/* Ignore report if ErrorRollOver */
-		if (!(field->flags & HID_MAIN_ITEM_VARIABLE) &&
-		    hid_array_value_is_valid(field, value[n]) &&
+	/* Ignore report if ErrorRollOver */
+	for (n = 0; n < count; n++) {
+		if (hid_array_value_is_valid(field, value[n]) &&
 		    field->usage[value[n] - min].hid == HID_UP_KEYBOARD + 1) {
 			field->ignored = true;
 			return;
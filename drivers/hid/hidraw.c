@@ -26,7 +26,9 @@
 #include <linux/hid.h>
 #include <linux/mutex.h>
 #include <linux/sched/signal.h>
+#include <linux/sizes.h>
 #include <linux/string.h>
+#include <linux/vmalloc.h>
 
 #include <linux/hidraw.h>
 
@@ -36,6 +38,8 @@ static struct class *hidraw_class;
 static struct hidraw *hidraw_table[HIDRAW_MAX_DEVICES];
 static DECLARE_RWSEM(minors_rwsem);
 
+#define HIDRAW_RING_MAX_SIZE	SZ_4M
+
 static ssize_t hidraw_read(struct file *file, char __user *buffer, size_t count, loff_t *ppos)
 {
 	struct hidraw_list *list = file->private_data;
@@ -44,6 +48,12 @@ static ssize_t hidraw_read(struct file *file, char __user *buffer, size_t count,
 
 	mutex_lock(&list->read_mutex);
 
+	/* The reports go to the ring */
+	if (list->ring) {
+		ret = -EINVAL;
+		goto out;
+	}
+
 	while (ret == 0) {
 		if (list->head == list->tail) {
 			add_wait_queue(&list->hidraw->wait, &wait);
@@ -252,7 +262,8 @@ static __poll_t hidraw_poll(struct file *file, poll_table *wait)
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM; /* hidraw is always writable */
 
 	poll_wait(file, &list->hidraw->wait, wait);
-	if (list->head != list->tail)
+	if (list->ring ? READ_ONCE(list->ring->tail) != list->ring_head :
+			 list->head != list->tail)
 		mask |= EPOLLIN | EPOLLRDNORM;
 	if (!list->hidraw->exist)
 		mask |= EPOLLERR | EPOLLHUP;
@@ -359,6 +370,7 @@ static int hidraw_release(struct inode * inode, struct file * file)
 		kfree(list->buffer[i].value);
 	list_del(&list->node);
 	spin_unlock_irqrestore(&hidraw_table[minor]->list_lock, flags);
+	vfree(list->ring);
 	kfree(list);
 
 	drop_ref(hidraw_table[minor], 0);
@@ -367,6 +379,78 @@ static int hidraw_release(struct inode * inode, struct file * file)
 	return 0;
 }
 
+static int hidraw_set_ring(struct hidraw_list *list, u32 slots)
+{
+	struct hidraw *dev = list->hidraw;
+	struct hid_device *hid = dev->hid;
+	struct hidraw_ring *ring;
+	struct hid_report *report;
+	unsigned long flags;
+	u32 max_len = 0;
+	size_t size;
+	int ret = 0;
+
+	if (!slots || !is_power_of_2(slots))
+		return -EINVAL;
+
+	list_for_each_entry(report,
+			    &hid->report_enum[HID_INPUT_REPORT].report_list,
+			    list)
+		max_len = max(max_len, hid_report_len(report));
+	if (!max_len)
+		return -EINVAL;
+
+	max_len = ALIGN(sizeof(struct hidraw_ring_report) + max_len, 8);
+	if (slots > (HIDRAW_RING_MAX_SIZE - sizeof(*ring)) / max_len)
+		return -EINVAL;
+	size = PAGE_ALIGN(sizeof(*ring) + slots * max_len);
+
+	mutex_lock(&list->read_mutex);
+
+	if (list->ring) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ring = vmalloc_user(size);
+	if (!ring) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	ring->slots = slots;
+	ring->slot_size = max_len;
+
+	spin_lock_irqsave(&dev->list_lock, flags);
+	for (; list->tail != list->head;
+	     list->tail = (list->tail + 1) & (HIDRAW_BUFFER_SIZE - 1)) {
+		kfree(list->buffer[list->tail].value);
+		list->buffer[list->tail].value = NULL;
+	}
+	list->ring_slots = slots;
+	list->ring_slot_size = max_len;
+	list->ring_size = size;
+	list->ring_head = 0;
+	smp_store_release(&list->ring, ring);
+	spin_unlock_irqrestore(&dev->list_lock, flags);
+
+	ret = size;
+out:
+	mutex_unlock(&list->read_mutex);
+	return ret;
+}
+
+static int hidraw_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct hidraw_list *list = file->private_data;
+	struct hidraw_ring *ring = smp_load_acquire(&list->ring);
+
+	/* The kernel has to see the reader moving its tail */
+	if (!ring || !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring, vma->vm_pgoff);
+}
+
 static long hidraw_ioctl(struct file *file, unsigned int cmd,
 							unsigned long arg)
 {
@@ -416,6 +500,17 @@ static long hidraw_ioctl(struct file *file, unsigned int cmd,
 					ret = -EFAULT;
 				break;
 			}
+		case HIDIOCSRING:
+			{
+				__u32 slots;
+
+				if (get_user(slots, (__u32 __user *)arg))
+					ret = -EFAULT;
+				else
+					ret = hidraw_set_ring(file->private_data,
+							      slots);
+				break;
+			}
 		default:
 			{
 				struct hid_device *hid = dev->hid;
@@ -507,10 +602,35 @@ static const struct file_operations hidraw_ops = {
 	.release =      hidraw_release,
 	.unlocked_ioctl = hidraw_ioctl,
 	.fasync =	hidraw_fasync,
+	.mmap =		hidraw_mmap,
 	.compat_ioctl   = compat_ptr_ioctl,
 	.llseek =	noop_llseek,
 };
 
+/* Called with the list_lock held */
+static void hidraw_ring_event(struct hidraw_list *list, u8 *data, int len)
+{
+	struct hidraw_ring *ring = list->ring;
+	struct hidraw_ring_report *slot;
+	u32 head = list->ring_head;
+
+	/* Don't overwrite what the reader may still be looking at */
+	if (head - smp_load_acquire(&ring->tail) >= list->ring_slots ||
+	    len > list->ring_slot_size - sizeof(*slot)) {
+		WRITE_ONCE(ring->dropped, READ_ONCE(ring->dropped) + 1);
+		return;
+	}
+
+	slot = (void *)(ring + 1) +
+	       (head & (list->ring_slots - 1)) * list->ring_slot_size;
+	slot->len = len;
+	memcpy(slot->data, data, len);
+
+	list->ring_head = ++head;
+	smp_store_release(&ring->head, head);
+	kill_fasync(&list->fasync, SIGIO, POLL_IN);
+}
+
 int hidraw_report_event(struct hid_device *hid, u8 *data, int len)
 {
 	struct hidraw *dev = hid->hidraw;
@@ -522,6 +642,11 @@ int hidraw_report_event(struct hid_device *hid, u8 *data, int len)
 	list_for_each_entry(list, &dev->list, node) {
 		int new_head = (list->head + 1) & (HIDRAW_BUFFER_SIZE - 1);
 
+		if (list->ring) {
+			hidraw_ring_event(list, data, len);
+			continue;
+		}
+
 		if (new_head == list->tail)
 			continue;
 
@@ -10,6 +10,7 @@
 #include <linux/devm-helpers.h>
 #include <linux/err.h>
 #include <linux/hwmon.h>
+#include <linux/minmax.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
@@ -17,17 +18,27 @@
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
 #define UNDERVOLTAGE_STICKY_BIT	BIT(16)
+#define THROTTLED_STICKY_BIT	BIT(18)
+#define SOFT_TEMP_LIMIT_STICKY_BIT	BIT(19)
+
+/*
+ * We can't run faster than the sticky shift (100ms) since we get
+ * flipping in the sticky bits that are cleared.
+ */
+#define POLL_INTERVAL_MIN_MS	100
+#define POLL_INTERVAL_MAX_MS	60000
 
 struct rpi_hwmon_data {
 	struct device *hwmon_dev;
 	struct rpi_firmware *fw;
 	u32 last_throttled;
+	unsigned long poll_interval_ms;
 	struct delayed_work get_values_poll_work;
 };
 
 static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
 {
-	u32 new_uv, old_uv, value;
+	u32 new_uv, old_uv, value, changed;
 	int ret;
 
 	/* Request firmware to clear sticky bits */
@@ -41,10 +52,29 @@ static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
 		return;
 	}
 
+	changed = value ^ data->last_throttled;
 	new_uv = value & UNDERVOLTAGE_STICKY_BIT;
 	old_uv = data->last_throttled & UNDERVOLTAGE_STICKY_BIT;
 	data->last_throttled = value;
 
+	/*
+	 * The firmware capping the ARM clock and throttling it are
+	 * reported as the temperature alarms, so they can be waited for.
+	 */
+	if (changed & SOFT_TEMP_LIMIT_STICKY_BIT)
+		hwmon_notify_event(data->hwmon_dev, hwmon_temp,
+				   hwmon_temp_max_alarm, 0);
+
+	if (changed & THROTTLED_STICKY_BIT) {
+		if (value & THROTTLED_STICKY_BIT)
+			dev_warn(data->hwmon_dev, "Throttling detected!\n");
+		else
+			dev_info(data->hwmon_dev, "Throttling ended\n");
+
+		hwmon_notify_event(data->hwmon_dev, hwmon_temp,
+				   hwmon_temp_crit_alarm, 0);
+	}
+
 	if (new_uv == old_uv)
 		return;
 
@@ -59,17 +89,16 @@ static void rpi_firmware_get_throttled(struct rpi_hwmon_data *data)
 static void get_values_poll(struct work_struct *work)
 {
 	struct rpi_hwmon_data *data;
+	unsigned long interval;
 
 	data = container_of(work, struct rpi_hwmon_data,
 			    get_values_poll_work.work);
 
 	rpi_firmware_get_throttled(data);
 
-	/*
-	 * We can't run faster than the sticky shift (100ms) since we get
-	 * flipping in the sticky bits that are cleared.
-	 */
-	schedule_delayed_work(&data->get_values_poll_work, 2 * HZ);
+	interval = READ_ONCE(data->poll_interval_ms);
+	schedule_delayed_work(&data->get_values_poll_work,
+			      msecs_to_jiffies(interval));
 }
 
 static int rpi_read(struct device *dev, enum hwmon_sensor_types type,
@@ -77,25 +106,61 @@ static int rpi_read(struct device *dev, enum hwmon_sensor_types type,
 {
 	struct rpi_hwmon_data *data = dev_get_drvdata(dev);
 
-	*val = !!(data->last_throttled & UNDERVOLTAGE_STICKY_BIT);
+	switch (type) {
+	case hwmon_chip:
+		*val = data->poll_interval_ms;
+		break;
+	case hwmon_temp:
+		if (attr == hwmon_temp_max_alarm)
+			*val = !!(data->last_throttled &
+				  SOFT_TEMP_LIMIT_STICKY_BIT);
+		else
+			*val = !!(data->last_throttled & THROTTLED_STICKY_BIT);
+		break;
+	default:
+		*val = !!(data->last_throttled & UNDERVOLTAGE_STICKY_BIT);
+		break;
+	}
+
+	return 0;
+}
+
+static int rpi_write(struct device *dev, enum hwmon_sensor_types type,
+		     u32 attr, int channel, long val)
+{
+	struct rpi_hwmon_data *data = dev_get_drvdata(dev);
+
+	WRITE_ONCE(data->poll_interval_ms,
+		   clamp_val(val, POLL_INTERVAL_MIN_MS, POLL_INTERVAL_MAX_MS));
+	mod_delayed_work(system_wq, &data->get_values_poll_work,
+			 msecs_to_jiffies(data->poll_interval_ms));
+
 	return 0;
 }
 
 static umode_t rpi_is_visible(const void *_data, enum hwmon_sensor_types type,
 			      u32 attr, int channel)
 {
+	if (type == hwmon_chip)
+		return 0644;
+
 	return 0444;
 }
 
 static const struct hwmon_channel_info *rpi_info[] = {
+	HWMON_CHANNEL_INFO(chip,
+			   HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(in,
 			   HWMON_I_LCRIT_ALARM),
+	HWMON_CHANNEL_INFO(temp,
+			   HWMON_T_MAX_ALARM | HWMON_T_CRIT_ALARM),
 	NULL
 };
 
 static const struct hwmon_ops rpi_hwmon_ops = {
 	.is_visible = rpi_is_visible,
 	.read = rpi_read,
+	.write = rpi_write,
 };
 
 static const struct hwmon_chip_info rpi_chip_info = {
@@ -115,6 +180,7 @@ static int rpi_hwmon_probe(struct platform_device *pdev)
 
 	/* Parent driver assure that firmware is correct */
 	data->fw = dev_get_drvdata(dev->parent);
+	data->poll_interval_ms = 2 * MSEC_PER_SEC;
 
 	data->hwmon_dev = devm_hwmon_device_register_with_info(dev, "rpi_volt",
 							       data,
@@ -129,7 +195,8 @@ static int rpi_hwmon_probe(struct platform_device *pdev)
 		return ret;
 	platform_set_drvdata(pdev, data);
 
-	schedule_delayed_work(&data->get_values_poll_work, 2 * HZ);
+	schedule_delayed_work(&data->get_values_poll_work,
+			      msecs_to_jiffies(data->poll_interval_ms));
 
 	return 0;
 }
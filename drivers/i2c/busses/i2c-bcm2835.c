@@ -56,6 +56,8 @@
 #define BCM2835_I2C_CDIV_MIN	0x0002
 #define BCM2835_I2C_CDIV_MAX	0xFFFE
 
+#define BCM2835_I2C_FIFO_DEPTH	16
+
 static unsigned int debug;
 module_param(debug, uint, 0644);
 MODULE_PARM_DESC(debug, "1=err, 2=isr, 3=xfer");
@@ -288,33 +290,52 @@ static struct clk *bcm2835_i2c_register_div(struct device *dev,
 	return devm_clk_register(dev, &priv->hw);
 }
 
+/*
+ * The FIFO is accessed a whole FIFO depth at a time whenever the status
+ * register says it is completely empty (TXE) or full (RXF), so that the
+ * status only has to be polled per byte for a partially filled FIFO.
+ */
 static void bcm2835_fill_txfifo(struct bcm2835_i2c_dev *i2c_dev)
 {
+	size_t count;
 	u32 val;
 
 	while (i2c_dev->msg_buf_remaining) {
 		val = bcm2835_i2c_readl(i2c_dev, BCM2835_I2C_S);
-		if (!(val & BCM2835_I2C_S_TXD))
+		if (val & BCM2835_I2C_S_TXE)
+			count = min_t(size_t, i2c_dev->msg_buf_remaining,
+				      BCM2835_I2C_FIFO_DEPTH);
+		else if (val & BCM2835_I2C_S_TXD)
+			count = 1;
+		else
 			break;
-		bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_FIFO,
-				   *i2c_dev->msg_buf);
-		i2c_dev->msg_buf++;
-		i2c_dev->msg_buf_remaining--;
+
+		i2c_dev->msg_buf_remaining -= count;
+		while (count--)
+			bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_FIFO,
+					   *i2c_dev->msg_buf++);
 	}
 }
 
 static void bcm2835_drain_rxfifo(struct bcm2835_i2c_dev *i2c_dev)
 {
+	size_t count;
 	u32 val;
 
 	while (i2c_dev->msg_buf_remaining) {
 		val = bcm2835_i2c_readl(i2c_dev, BCM2835_I2C_S);
-		if (!(val & BCM2835_I2C_S_RXD))
+		if (val & BCM2835_I2C_S_RXF)
+			count = min_t(size_t, i2c_dev->msg_buf_remaining,
+				      BCM2835_I2C_FIFO_DEPTH);
+		else if (val & BCM2835_I2C_S_RXD)
+			count = 1;
+		else
 			break;
-		*i2c_dev->msg_buf = bcm2835_i2c_readl(i2c_dev,
-						      BCM2835_I2C_FIFO);
-		i2c_dev->msg_buf++;
-		i2c_dev->msg_buf_remaining--;
+
+		i2c_dev->msg_buf_remaining -= count;
+		while (count--)
+			*i2c_dev->msg_buf++ = bcm2835_i2c_readl(i2c_dev,
+							BCM2835_I2C_FIFO);
 	}
 }
 
@@ -329,6 +350,10 @@ static void bcm2835_drain_rxfifo(struct bcm2835_i2c_dev *i2c_dev)
  * a problem in the state machine.
  * It turns out that it is possible to use the TXW interrupt to know when the
  * transfer is active, provided the FIFO has not been prefilled.
+ *
+ * The last message of a transfer doesn't need that, so when it is a write
+ * and the controller is idle the FIFO is prefilled before starting. Writes
+ * that fit in the FIFO then complete with a single DONE interrupt.
  */
 
 static void bcm2835_i2c_start_transfer(struct bcm2835_i2c_dev *i2c_dev)
@@ -344,16 +369,22 @@ static void bcm2835_i2c_start_transfer(struct bcm2835_i2c_dev *i2c_dev)
 	i2c_dev->msg_buf = msg->buf;
 	i2c_dev->msg_buf_remaining = msg->len;
 
-	if (msg->flags & I2C_M_RD)
+	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_A, msg->addr);
+	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_DLEN, msg->len);
+
+	if (msg->flags & I2C_M_RD) {
 		c |= BCM2835_I2C_C_READ | BCM2835_I2C_C_INTR;
-	else
-		c |= BCM2835_I2C_C_INTT;
+	} else {
+		if (last_msg && !(bcm2835_i2c_readl(i2c_dev, BCM2835_I2C_S) &
+				  BCM2835_I2C_S_TA))
+			bcm2835_fill_txfifo(i2c_dev);
+		if (!last_msg || i2c_dev->msg_buf_remaining)
+			c |= BCM2835_I2C_C_INTT;
+	}
 
 	if (last_msg)
 		c |= BCM2835_I2C_C_INTD;
 
-	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_A, msg->addr);
-	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_DLEN, msg->len);
 	bcm2835_i2c_writel(i2c_dev, BCM2835_I2C_C, c);
 	bcm2835_debug_add(i2c_dev, ~0);
 }
@@ -62,6 +62,7 @@ static DEFINE_MUTEX(core_lock);
 static DEFINE_IDR(i2c_adapter_idr);
 
 static int i2c_detect(struct i2c_adapter *adapter, struct i2c_driver *driver);
+static void i2c_async_work(struct work_struct *work);
 
 static DEFINE_STATIC_KEY_FALSE(i2c_trace_msg_key);
 static bool is_registered;
@@ -1452,6 +1453,9 @@ static int i2c_register_adapter(struct i2c_adapter *adap)
 	rt_mutex_init(&adap->mux_lock);
 	mutex_init(&adap->userspace_clients_lock);
 	INIT_LIST_HEAD(&adap->userspace_clients);
+	spin_lock_init(&adap->async_lock);
+	INIT_LIST_HEAD(&adap->async_queue);
+	INIT_WORK(&adap->async_work, i2c_async_work);
 
 	/* Set default timeout to 1 second if not already set */
 	if (adap->timeout == 0)
@@ -1714,6 +1718,8 @@ void i2c_del_adapter(struct i2c_adapter *adap)
 
 	i2c_host_notify_irq_teardown(adap);
 
+	flush_work(&adap->async_work);
+
 	/* wait until all references to the device are gone
 	 *
 	 * FIXME: This is old code and should ideally be replaced by an
@@ -2175,6 +2181,76 @@ int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 }
 EXPORT_SYMBOL(i2c_transfer);
 
+static void i2c_async_work(struct work_struct *work)
+{
+	struct i2c_adapter *adap = container_of(work, struct i2c_adapter,
+						async_work);
+	struct i2c_async_transfer *xfer, *next;
+	LIST_HEAD(batch);
+	int ret;
+
+	spin_lock_irq(&adap->async_lock);
+	list_splice_init(&adap->async_queue, &batch);
+	spin_unlock_irq(&adap->async_lock);
+
+	if (list_empty(&batch))
+		return;
+
+	/*
+	 * Run everything that was queued back-to-back under a single bus
+	 * lock, so the bus driver isn't idle between the transfers.
+	 */
+	ret = __i2c_lock_bus_helper(adap);
+	list_for_each_entry(xfer, &batch, queue)
+		xfer->status = ret ? ret :
+			       __i2c_transfer(adap, xfer->msgs, xfer->num);
+	if (!ret)
+		i2c_unlock_bus(adap, I2C_LOCK_SEGMENT);
+
+	list_for_each_entry_safe(xfer, next, &batch, queue) {
+		list_del_init(&xfer->queue);
+		if (xfer->complete)
+			xfer->complete(xfer);
+	}
+}
+
+/**
+ * i2c_transfer_async - queue a single or combined I2C message
+ * @adap: Handle to I2C bus
+ * @xfer: The transfer to queue
+ * Context: any
+ *
+ * Returns negative errno if the transfer could not be queued, else 0.
+ *
+ * The transfers queued on an adapter are executed in order from a
+ * workqueue, each of them as by i2c_transfer(). Transfers that are
+ * queued while others are pending are done in one go, without releasing
+ * the bus in between. @xfer->complete is then called, in process context,
+ * with @xfer->status set to what i2c_transfer() would have returned.
+ */
+int i2c_transfer_async(struct i2c_adapter *adap,
+		       struct i2c_async_transfer *xfer)
+{
+	unsigned long flags;
+
+	if (!adap->algo->master_xfer) {
+		dev_dbg(&adap->dev, "I2C level transfers not supported\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (!xfer->msgs || xfer->num < 1)
+		return -EINVAL;
+
+	spin_lock_irqsave(&adap->async_lock, flags);
+	list_add_tail(&xfer->queue, &adap->async_queue);
+	spin_unlock_irqrestore(&adap->async_lock, flags);
+
+	queue_work(system_highpri_wq, &adap->async_work);
+
+	return 0;
+}
+EXPORT_SYMBOL(i2c_transfer_async);
+
 /**
  * i2c_transfer_buffer_flags - issue a single I2C message transferring data
  *			       to/from a buffer
@@ -28,8 +28,10 @@
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/notifier.h>
+#include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/wait.h>
 
 /*
  * An i2c_dev represents an i2c_adapter ... an I2C or SMBus master, not a
@@ -46,6 +48,26 @@ struct i2c_dev {
 	struct cdev cdev;
 };
 
+/*
+ * Transfers queued with I2C_RDWR_SUBMIT on a file descriptor, referenced by
+ * the client data of its anonymous i2c_client.
+ */
+struct i2cdev_async {
+	spinlock_t lock;
+	struct list_head done;
+	unsigned int pending;
+	unsigned int num_done;
+	wait_queue_head_t wait;
+};
+
+struct i2cdev_async_xfer {
+	struct i2c_async_transfer xfer;
+	struct i2cdev_async *async;
+	struct list_head node;
+	u8 __user **data_ptrs;
+	u64 user_data;
+};
+
 #define I2C_MINORS	(MINORMASK + 1)
 static LIST_HEAD(i2c_dev_list);
 static DEFINE_SPINLOCK(i2c_dev_list_lock);
@@ -232,18 +254,11 @@ static int i2cdev_check_addr(struct i2c_adapter *adapter, unsigned int addr)
 	return result;
 }
 
-static noinline int i2cdev_ioctl_rdwr(struct i2c_client *client,
-		unsigned nmsgs, struct i2c_msg *msgs)
+static int i2cdev_rdwr_get_bufs(unsigned nmsgs, struct i2c_msg *msgs,
+		u8 __user **data_ptrs)
 {
-	u8 __user **data_ptrs;
 	int i, res;
 
-	data_ptrs = kmalloc_array(nmsgs, sizeof(u8 __user *), GFP_KERNEL);
-	if (data_ptrs == NULL) {
-		kfree(msgs);
-		return -ENOMEM;
-	}
-
 	res = 0;
 	for (i = 0; i < nmsgs; i++) {
 		/* Limit the size of the message to a sane amount */
@@ -289,12 +304,16 @@ static noinline int i2cdev_ioctl_rdwr(struct i2c_client *client,
 		int j;
 		for (j = 0; j < i; ++j)
 			kfree(msgs[j].buf);
-		kfree(data_ptrs);
-		kfree(msgs);
-		return res;
 	}
+	return res;
+}
+
+/* Copy back the data read if @res is a success, then free the buffers */
+static int i2cdev_rdwr_put_bufs(unsigned nmsgs, struct i2c_msg *msgs,
+		u8 __user **data_ptrs, int res)
+{
+	int i = nmsgs;
 
-	res = i2c_transfer(client->adapter, msgs, nmsgs);
 	while (i-- > 0) {
 		if (res >= 0 && (msgs[i].flags & I2C_M_RD)) {
 			if (copy_to_user(data_ptrs[i], msgs[i].buf,
@@ -303,11 +322,179 @@ static noinline int i2cdev_ioctl_rdwr(struct i2c_client *client,
 		}
 		kfree(msgs[i].buf);
 	}
+	return res;
+}
+
+static noinline int i2cdev_ioctl_rdwr(struct i2c_client *client,
+		unsigned nmsgs, struct i2c_msg *msgs)
+{
+	u8 __user **data_ptrs;
+	int res;
+
+	data_ptrs = kmalloc_array(nmsgs, sizeof(u8 __user *), GFP_KERNEL);
+	if (data_ptrs == NULL) {
+		kfree(msgs);
+		return -ENOMEM;
+	}
+
+	res = i2cdev_rdwr_get_bufs(nmsgs, msgs, data_ptrs);
+	if (res < 0) {
+		kfree(data_ptrs);
+		kfree(msgs);
+		return res;
+	}
+
+	res = i2c_transfer(client->adapter, msgs, nmsgs);
+	res = i2cdev_rdwr_put_bufs(nmsgs, msgs, data_ptrs, res);
 	kfree(data_ptrs);
 	kfree(msgs);
 	return res;
 }
 
+static void i2cdev_async_free(struct i2cdev_async_xfer *ax)
+{
+	kfree(ax->data_ptrs);
+	kfree(ax->xfer.msgs);
+	kfree(ax);
+}
+
+static void i2cdev_async_complete(struct i2c_async_transfer *xfer)
+{
+	struct i2cdev_async_xfer *ax = xfer->context;
+	struct i2cdev_async *async = ax->async;
+	unsigned long flags;
+
+	spin_lock_irqsave(&async->lock, flags);
+	list_add_tail(&ax->node, &async->done);
+	async->pending--;
+	async->num_done++;
+	/* under the lock, release() frees async as soon as it sees idle */
+	wake_up(&async->wait);
+	spin_unlock_irqrestore(&async->lock, flags);
+}
+
+static noinline int i2cdev_ioctl_rdwr_submit(struct i2c_client *client,
+		unsigned nmsgs, struct i2c_msg *msgs, u64 user_data)
+{
+	struct i2cdev_async *async = i2c_get_clientdata(client);
+	struct i2cdev_async_xfer *ax;
+	int res;
+
+	ax = kzalloc(sizeof(*ax), GFP_KERNEL);
+	if (ax == NULL) {
+		kfree(msgs);
+		return -ENOMEM;
+	}
+	ax->xfer.msgs = msgs;
+	ax->xfer.num = nmsgs;
+	ax->xfer.complete = i2cdev_async_complete;
+	ax->xfer.context = ax;
+	ax->async = async;
+	ax->user_data = user_data;
+
+	ax->data_ptrs = kmalloc_array(nmsgs, sizeof(u8 __user *), GFP_KERNEL);
+	if (ax->data_ptrs == NULL) {
+		i2cdev_async_free(ax);
+		return -ENOMEM;
+	}
+
+	res = i2cdev_rdwr_get_bufs(nmsgs, msgs, ax->data_ptrs);
+	if (res < 0) {
+		i2cdev_async_free(ax);
+		return res;
+	}
+
+	spin_lock_irq(&async->lock);
+	if (async->pending + async->num_done >= I2C_RDWR_ASYNC_MAX_PENDING)
+		res = -EBUSY;
+	else
+		async->pending++;
+	spin_unlock_irq(&async->lock);
+	if (res < 0)
+		goto err_put_bufs;
+
+	res = i2c_transfer_async(client->adapter, &ax->xfer);
+	if (res < 0) {
+		spin_lock_irq(&async->lock);
+		async->pending--;
+		spin_unlock_irq(&async->lock);
+		goto err_put_bufs;
+	}
+
+	return 0;
+
+err_put_bufs:
+	i2cdev_rdwr_put_bufs(nmsgs, msgs, ax->data_ptrs, res);
+	i2cdev_async_free(ax);
+	return res;
+}
+
+static struct i2cdev_async_xfer *i2cdev_async_next(struct i2cdev_async *async)
+{
+	struct i2cdev_async_xfer *ax;
+
+	spin_lock_irq(&async->lock);
+	ax = list_first_entry_or_null(&async->done, struct i2cdev_async_xfer,
+				      node);
+	if (ax) {
+		list_del(&ax->node);
+		async->num_done--;
+	}
+	spin_unlock_irq(&async->lock);
+
+	return ax;
+}
+
+static bool i2cdev_async_idle(struct i2cdev_async *async, bool reap)
+{
+	bool ret;
+
+	spin_lock_irq(&async->lock);
+	ret = !async->pending || (reap && async->num_done);
+	spin_unlock_irq(&async->lock);
+
+	return ret;
+}
+
+static noinline int i2cdev_ioctl_rdwr_reap(struct file *file,
+		struct i2c_client *client, struct i2c_rdwr_reap_data *reap)
+{
+	struct i2cdev_async *async = i2c_get_clientdata(client);
+	struct i2c_rdwr_result __user *results;
+	struct i2c_rdwr_result result = {};
+	struct i2cdev_async_xfer *ax;
+	int n, res;
+
+	if (!reap->results || !reap->nresults || reap->reserved)
+		return -EINVAL;
+	results = u64_to_user_ptr(reap->results);
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		res = wait_event_interruptible(async->wait,
+					       i2cdev_async_idle(async, true));
+		if (res)
+			return res;
+	}
+
+	for (n = 0; n < reap->nresults; n++) {
+		ax = i2cdev_async_next(async);
+		if (!ax)
+			break;
+
+		result.user_data = ax->user_data;
+		result.result = i2cdev_rdwr_put_bufs(ax->xfer.num,
+						     ax->xfer.msgs,
+						     ax->data_ptrs,
+						     ax->xfer.status);
+		i2cdev_async_free(ax);
+
+		if (copy_to_user(&results[n], &result, sizeof(result)))
+			return -EFAULT;
+	}
+
+	return n ? n : -EAGAIN;
+}
+
 static noinline int i2cdev_ioctl_smbus(struct i2c_client *client,
 		u8 read_write, u8 command, u32 size,
 		union i2c_smbus_data __user *data)
@@ -458,6 +645,42 @@ static long i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return i2cdev_ioctl_rdwr(client, rdwr_arg.nmsgs, rdwr_pa);
 	}
 
+	case I2C_RDWR_SUBMIT: {
+		struct i2c_rdwr_submit_data submit_arg;
+		struct i2c_msg *rdwr_pa;
+
+		if (copy_from_user(&submit_arg,
+				   (struct i2c_rdwr_submit_data __user *)arg,
+				   sizeof(submit_arg)))
+			return -EFAULT;
+
+		if (!submit_arg.msgs || submit_arg.nmsgs == 0 ||
+		    submit_arg.reserved)
+			return -EINVAL;
+
+		if (submit_arg.nmsgs > I2C_RDWR_IOCTL_MAX_MSGS)
+			return -EINVAL;
+
+		rdwr_pa = memdup_user(u64_to_user_ptr(submit_arg.msgs),
+				      submit_arg.nmsgs * sizeof(struct i2c_msg));
+		if (IS_ERR(rdwr_pa))
+			return PTR_ERR(rdwr_pa);
+
+		return i2cdev_ioctl_rdwr_submit(client, submit_arg.nmsgs,
+						rdwr_pa, submit_arg.user_data);
+	}
+
+	case I2C_RDWR_REAP: {
+		struct i2c_rdwr_reap_data reap_arg;
+
+		if (copy_from_user(&reap_arg,
+				   (struct i2c_rdwr_reap_data __user *)arg,
+				   sizeof(reap_arg)))
+			return -EFAULT;
+
+		return i2cdev_ioctl_rdwr_reap(file, client, &reap_arg);
+	}
+
 	case I2C_SMBUS: {
 		struct i2c_smbus_ioctl_data data_arg;
 		if (copy_from_user(&data_arg,
@@ -516,6 +739,33 @@ struct i2c_rdwr_ioctl_data32 {
 	u32 nmsgs;
 };
 
+static struct i2c_msg *compat_i2cdev_get_msgs(struct i2c_msg32 __user *p,
+		u32 nmsgs)
+{
+	struct i2c_msg *rdwr_pa;
+	int i;
+
+	rdwr_pa = kmalloc_array(nmsgs, sizeof(struct i2c_msg), GFP_KERNEL);
+	if (!rdwr_pa)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < nmsgs; i++) {
+		struct i2c_msg32 umsg;
+		if (copy_from_user(&umsg, p + i, sizeof(umsg))) {
+			kfree(rdwr_pa);
+			return ERR_PTR(-EFAULT);
+		}
+		rdwr_pa[i] = (struct i2c_msg) {
+			.addr = umsg.addr,
+			.flags = umsg.flags,
+			.len = umsg.len,
+			.buf = (__force __u8 *)compat_ptr(umsg.buf),
+		};
+	}
+
+	return rdwr_pa;
+}
+
 static long compat_i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct i2c_client *client = file->private_data;
@@ -526,9 +776,7 @@ static long compat_i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned lo
 		return put_user(funcs, (compat_ulong_t __user *)arg);
 	case I2C_RDWR: {
 		struct i2c_rdwr_ioctl_data32 rdwr_arg;
-		struct i2c_msg32 __user *p;
 		struct i2c_msg *rdwr_pa;
-		int i;
 
 		if (copy_from_user(&rdwr_arg,
 				   (struct i2c_rdwr_ioctl_data32 __user *)arg,
@@ -541,28 +789,36 @@ static long compat_i2cdev_ioctl(struct file *file, unsigned int cmd, unsigned lo
 		if (rdwr_arg.nmsgs > I2C_RDWR_IOCTL_MAX_MSGS)
 			return -EINVAL;
 
-		rdwr_pa = kmalloc_array(rdwr_arg.nmsgs, sizeof(struct i2c_msg),
-				      GFP_KERNEL);
-		if (!rdwr_pa)
-			return -ENOMEM;
-
-		p = compat_ptr(rdwr_arg.msgs);
-		for (i = 0; i < rdwr_arg.nmsgs; i++) {
-			struct i2c_msg32 umsg;
-			if (copy_from_user(&umsg, p + i, sizeof(umsg))) {
-				kfree(rdwr_pa);
-				return -EFAULT;
-			}
-			rdwr_pa[i] = (struct i2c_msg) {
-				.addr = umsg.addr,
-				.flags = umsg.flags,
-				.len = umsg.len,
-				.buf = (__force __u8 *)compat_ptr(umsg.buf),
-			};
-		}
+		rdwr_pa = compat_i2cdev_get_msgs(compat_ptr(rdwr_arg.msgs),
+						 rdwr_arg.nmsgs);
+		if (IS_ERR(rdwr_pa))
+			return PTR_ERR(rdwr_pa);
 
 		return i2cdev_ioctl_rdwr(client, rdwr_arg.nmsgs, rdwr_pa);
 	}
+	case I2C_RDWR_SUBMIT: {
+		struct i2c_rdwr_submit_data submit_arg;
+		struct i2c_msg *rdwr_pa;
+
+		if (copy_from_user(&submit_arg, (void __user *)arg,
+				   sizeof(submit_arg)))
+			return -EFAULT;
+
+		if (!submit_arg.msgs || submit_arg.nmsgs == 0 ||
+		    submit_arg.reserved)
+			return -EINVAL;
+
+		if (submit_arg.nmsgs > I2C_RDWR_IOCTL_MAX_MSGS)
+			return -EINVAL;
+
+		rdwr_pa = compat_i2cdev_get_msgs(u64_to_user_ptr(submit_arg.msgs),
+						 submit_arg.nmsgs);
+		if (IS_ERR(rdwr_pa))
+			return PTR_ERR(rdwr_pa);
+
+		return i2cdev_ioctl_rdwr_submit(client, submit_arg.nmsgs,
+						rdwr_pa, submit_arg.user_data);
+	}
 	case I2C_SMBUS: {
 		struct i2c_smbus_ioctl_data32	data32;
 		if (copy_from_user(&data32,
@@ -587,6 +843,7 @@ static int i2cdev_open(struct inode *inode, struct file *file)
 	unsigned int minor = iminor(inode);
 	struct i2c_client *client;
 	struct i2c_adapter *adap;
+	struct i2cdev_async *async;
 
 	adap = i2c_get_adapter(minor);
 	if (!adap)
@@ -606,6 +863,17 @@ static int i2cdev_open(struct inode *inode, struct file *file)
 	}
 	snprintf(client->name, I2C_NAME_SIZE, "i2c-dev %d", adap->nr);
 
+	async = kzalloc(sizeof(*async), GFP_KERNEL);
+	if (!async) {
+		kfree(client);
+		i2c_put_adapter(adap);
+		return -ENOMEM;
+	}
+	spin_lock_init(&async->lock);
+	INIT_LIST_HEAD(&async->done);
+	init_waitqueue_head(&async->wait);
+	i2c_set_clientdata(client, async);
+
 	client->adapter = adap;
 	file->private_data = client;
 
@@ -615,6 +883,17 @@ static int i2cdev_open(struct inode *inode, struct file *file)
 static int i2cdev_release(struct inode *inode, struct file *file)
 {
 	struct i2c_client *client = file->private_data;
+	struct i2cdev_async *async = i2c_get_clientdata(client);
+	struct i2cdev_async_xfer *ax;
+
+	/* Queued transfers still use their buffers, let them finish */
+	wait_event(async->wait, i2cdev_async_idle(async, false));
+	while ((ax = i2cdev_async_next(async))) {
+		i2cdev_rdwr_put_bufs(ax->xfer.num, ax->xfer.msgs,
+				     ax->data_ptrs, -ECANCELED);
+		i2cdev_async_free(ax);
+	}
+	kfree(async);
 
 	i2c_put_adapter(client->adapter);
 	kfree(client);
@@ -623,11 +902,28 @@ static int i2cdev_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static __poll_t i2cdev_poll(struct file *file, poll_table *wait)
+{
+	struct i2c_client *client = file->private_data;
+	struct i2cdev_async *async = i2c_get_clientdata(client);
+	__poll_t mask = 0;
+
+	poll_wait(file, &async->wait, wait);
+
+	spin_lock_irq(&async->lock);
+	if (async->num_done)
+		mask |= EPOLLIN | EPOLLRDNORM;
+	spin_unlock_irq(&async->lock);
+
+	return mask;
+}
+
 static const struct file_operations i2cdev_fops = {
 	.owner		= THIS_MODULE,
 	.llseek		= no_llseek,
 	.read		= i2cdev_read,
 	.write		= i2cdev_write,
+	.poll		= i2cdev_poll,
 	.unlocked_ioctl	= i2cdev_ioctl,
 	.compat_ioctl	= compat_i2cdev_ioctl,
 	.open		= i2cdev_open,
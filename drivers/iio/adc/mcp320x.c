@@ -43,8 +43,13 @@
 #include <linux/module.h>
 #include <linux/mod_devicetable.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/regulator/consumer.h>
 
+#define MCP320X_MAX_CHANNELS	16
+
 enum {
 	mcp3001,
 	mcp3002,
@@ -80,6 +85,11 @@ struct mcp320x_chip_info {
  * @chip_info: ADC properties
  * @tx_buf: buffer for @transfer[0] (not used on single-channel converters)
  * @rx_buf: buffer for @transfer[1]
+ * @scan_msg: SPI message converting all channels of the active scan mask
+ * @scan_xfer: SPI transfers used by @scan_msg, two per channel
+ * @scan: buffer pushed to the IIO buffer for each scan
+ * @scan_tx: per-channel buffers for the even @scan_xfer entries
+ * @scan_rx: per-channel buffers for the odd @scan_xfer entries
  */
 struct mcp320x {
 	struct spi_device *spi;
@@ -92,8 +102,17 @@ struct mcp320x {
 	struct mutex lock;
 	const struct mcp320x_chip_info *chip_info;
 
+	struct spi_message scan_msg;
+	struct spi_transfer scan_xfer[2 * MCP320X_MAX_CHANNELS];
+	struct {
+		u16 data[MCP320X_MAX_CHANNELS];
+		s64 ts __aligned(8);
+	} scan;
+
 	u8 tx_buf __aligned(IIO_DMA_MINALIGN);
 	u8 rx_buf[4];
+	u8 scan_tx[MCP320X_MAX_CHANNELS];
+	u8 scan_rx[MCP320X_MAX_CHANNELS][4];
 };
 
 static int mcp320x_channel_to_tx_data(int device_index,
@@ -117,55 +136,35 @@ static int mcp320x_channel_to_tx_data(int device_index,
 	}
 }
 
-static int mcp320x_adc_conversion(struct mcp320x *adc, u8 channel,
-				  bool differential, int device_index, int *val)
+static int mcp320x_decode(struct mcp320x *adc, const u8 *rx_buf,
+			  int device_index, int *val)
 {
-	int ret;
-
-	if (adc->chip_info->conv_time) {
-		ret = spi_sync(adc->spi, &adc->start_conv_msg);
-		if (ret < 0)
-			return ret;
-
-		usleep_range(adc->chip_info->conv_time,
-			     adc->chip_info->conv_time + 100);
-	}
-
-	memset(&adc->rx_buf, 0, sizeof(adc->rx_buf));
-	if (adc->chip_info->num_channels > 1)
-		adc->tx_buf = mcp320x_channel_to_tx_data(device_index, channel,
-							 differential);
-
-	ret = spi_sync(adc->spi, &adc->msg);
-	if (ret < 0)
-		return ret;
-
 	switch (device_index) {
 	case mcp3001:
-		*val = (adc->rx_buf[0] << 5 | adc->rx_buf[1] >> 3);
+		*val = (rx_buf[0] << 5 | rx_buf[1] >> 3);
 		return 0;
 	case mcp3002:
 	case mcp3004:
 	case mcp3008:
-		*val = (adc->rx_buf[0] << 2 | adc->rx_buf[1] >> 6);
+		*val = (rx_buf[0] << 2 | rx_buf[1] >> 6);
 		return 0;
 	case mcp3201:
-		*val = (adc->rx_buf[0] << 7 | adc->rx_buf[1] >> 1);
+		*val = (rx_buf[0] << 7 | rx_buf[1] >> 1);
 		return 0;
 	case mcp3202:
 	case mcp3204:
 	case mcp3208:
-		*val = (adc->rx_buf[0] << 4 | adc->rx_buf[1] >> 4);
+		*val = (rx_buf[0] << 4 | rx_buf[1] >> 4);
 		return 0;
 	case mcp3301:
-		*val = sign_extend32((adc->rx_buf[0] & 0x1f) << 8
-				    | adc->rx_buf[1], 12);
+		*val = sign_extend32((rx_buf[0] & 0x1f) << 8
+				    | rx_buf[1], 12);
 		return 0;
 	case mcp3550_50:
 	case mcp3550_60:
 	case mcp3551:
 	case mcp3553: {
-		u32 raw = be32_to_cpup((__be32 *)adc->rx_buf);
+		u32 raw = be32_to_cpup((__be32 *)rx_buf);
 
 		if (!(adc->spi->mode & SPI_CPOL))
 			raw <<= 1; /* strip Data Ready bit in SPI mode 0,0 */
@@ -191,6 +190,32 @@ static int mcp320x_adc_conversion(struct mcp320x *adc, u8 channel,
 	}
 }
 
+static int mcp320x_adc_conversion(struct mcp320x *adc, u8 channel,
+				  bool differential, int device_index, int *val)
+{
+	int ret;
+
+	if (adc->chip_info->conv_time) {
+		ret = spi_sync(adc->spi, &adc->start_conv_msg);
+		if (ret < 0)
+			return ret;
+
+		usleep_range(adc->chip_info->conv_time,
+			     adc->chip_info->conv_time + 100);
+	}
+
+	memset(&adc->rx_buf, 0, sizeof(adc->rx_buf));
+	if (adc->chip_info->num_channels > 1)
+		adc->tx_buf = mcp320x_channel_to_tx_data(device_index, channel,
+							 differential);
+
+	ret = spi_sync(adc->spi, &adc->msg);
+	if (ret < 0)
+		return ret;
+
+	return mcp320x_decode(adc, adc->rx_buf, device_index, val);
+}
+
 static int mcp320x_read_raw(struct iio_dev *indio_dev,
 			    struct iio_chan_spec const *channel, int *val,
 			    int *val2, long mask)
@@ -294,10 +319,132 @@ static const struct iio_chan_spec mcp3208_channels[] = {
 	MCP320X_VOLTAGE_CHANNEL_DIFF(7, 6),
 };
 
+/*
+ * Build the message converting all channels of @scan_mask in one go.  Each
+ * conversion is started by asserting CS, so CS is toggled between channels.
+ * The message is replayed for every scan and therefore optimized once.
+ */
+static int mcp320x_update_scan_mode(struct iio_dev *indio_dev,
+				    const unsigned long *scan_mask)
+{
+	struct mcp320x *adc = iio_priv(indio_dev);
+	int device_index = spi_get_device_id(adc->spi)->driver_data;
+	struct spi_transfer *xfer = NULL;
+	unsigned int n = 0;
+	int bit;
+
+	mutex_lock(&adc->lock);
+
+	spi_unoptimize_message(&adc->scan_msg);
+	spi_message_init(&adc->scan_msg);
+	memset(adc->scan_xfer, 0, sizeof(adc->scan_xfer));
+
+	for_each_set_bit(bit, scan_mask, adc->chip_info->num_channels) {
+		const struct iio_chan_spec *chan = &indio_dev->channels[bit];
+
+		xfer = &adc->scan_xfer[2 * n];
+		if (adc->chip_info->num_channels > 1) {
+			adc->scan_tx[n] = mcp320x_channel_to_tx_data(device_index,
+					chan->address, chan->differential);
+			xfer->tx_buf = &adc->scan_tx[n];
+			xfer->len = sizeof(adc->scan_tx[n]);
+			spi_message_add_tail(xfer, &adc->scan_msg);
+		}
+
+		xfer++;
+		xfer->rx_buf = adc->scan_rx[n];
+		xfer->len = adc->transfer[1].len;
+		xfer->cs_change = 1;
+		spi_message_add_tail(xfer, &adc->scan_msg);
+		n++;
+	}
+
+	/* deassert CS after the last conversion */
+	if (xfer)
+		xfer->cs_change = 0;
+
+	mutex_unlock(&adc->lock);
+
+	if (!xfer)
+		return -EINVAL;
+
+	return spi_optimize_message(adc->spi, &adc->scan_msg);
+}
+
+static irqreturn_t mcp320x_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct mcp320x *adc = iio_priv(indio_dev);
+	int device_index = spi_get_device_id(adc->spi)->driver_data;
+	unsigned int n = 0;
+	int bit, val, ret;
+
+	mutex_lock(&adc->lock);
+
+	ret = spi_sync(adc->spi, &adc->scan_msg);
+	if (ret < 0)
+		goto out;
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 adc->chip_info->num_channels) {
+		ret = mcp320x_decode(adc, adc->scan_rx[n], device_index, &val);
+		if (ret < 0)
+			goto out;
+		adc->scan.data[n++] = val;
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &adc->scan,
+					   iio_get_time_ns(indio_dev));
+out:
+	mutex_unlock(&adc->lock);
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static const struct iio_info mcp320x_info = {
 	.read_raw = mcp320x_read_raw,
+	.update_scan_mode = mcp320x_update_scan_mode,
 };
 
+/*
+ * Converters which sample on CS assertion can be scanned from a trigger,
+ * e.g. an hrtimer one, so that periodic sampling does not need a userspace
+ * loop.  The shared channel tables carry no scan type since it depends on
+ * the resolution, so add it to a copy.
+ */
+static int mcp320x_setup_buffer(struct iio_dev *indio_dev,
+				struct mcp320x *adc)
+{
+	const struct mcp320x_chip_info *chip_info = adc->chip_info;
+	struct device *dev = &adc->spi->dev;
+	struct iio_chan_spec *channels;
+	unsigned int i;
+
+	channels = devm_kcalloc(dev, chip_info->num_channels + 1,
+				sizeof(*channels), GFP_KERNEL);
+	if (!channels)
+		return -ENOMEM;
+
+	for (i = 0; i < chip_info->num_channels; i++) {
+		channels[i] = chip_info->channels[i];
+		channels[i].scan_index = i;
+		channels[i].scan_type.sign =
+			chip_info->resolution == 13 ? 's' : 'u';
+		channels[i].scan_type.realbits = chip_info->resolution;
+		channels[i].scan_type.storagebits = 16;
+		channels[i].scan_type.endianness = IIO_CPU;
+	}
+	channels[i] = (struct iio_chan_spec)IIO_CHAN_SOFT_TIMESTAMP(i);
+
+	indio_dev->channels = channels;
+	indio_dev->num_channels = chip_info->num_channels + 1;
+
+	return devm_iio_triggered_buffer_setup(dev, indio_dev, NULL,
+					       mcp320x_trigger_handler, NULL);
+}
+
 static const struct mcp320x_chip_info mcp320x_chip_infos[] = {
 	[mcp3001] = {
 		.channels = mcp3201_channels,
@@ -447,6 +594,12 @@ static int mcp320x_probe(struct spi_device *spi)
 
 	mutex_init(&adc->lock);
 
+	if (!chip_info->conv_time) {
+		ret = mcp320x_setup_buffer(indio_dev, adc);
+		if (ret < 0)
+			goto reg_disable;
+	}
+
 	ret = iio_device_register(indio_dev);
 	if (ret < 0)
 		goto reg_disable;
@@ -465,6 +618,7 @@ static void mcp320x_remove(struct spi_device *spi)
 	struct mcp320x *adc = iio_priv(indio_dev);
 
 	iio_device_unregister(indio_dev);
+	spi_unoptimize_message(&adc->scan_msg);
 	regulator_disable(adc->reg);
 }
 
@@ -0,0 +1,491 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * IIO driver for the RP1 ADC and temperature sensor
+ *
+ * Besides one-shot reads, this driver supports buffered capture: the
+ * ADC free-runs in round-robin mode over the enabled channels, the
+ * conversions are collected in the hardware FIFO and the FIFO level
+ * interrupt pushes complete scans, with timestamps, into the IIO buffer.
+ */
+
+#include <linux/bitops.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/module.h>
+#include <linux/mod_devicetable.h>
+#include <linux/platform_device.h>
+#include <linux/regulator/consumer.h>
+
+#include <linux/iio/buffer.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/kfifo_buf.h>
+
+#define MODULE_NAME	"rp1-adc-iio"
+
+#define RP1_ADC_CS		0x00
+#define RP1_ADC_RESULT		0x04
+#define RP1_ADC_FCS		0x08
+#define RP1_ADC_FIFO		0x0c
+#define RP1_ADC_DIV		0x10
+
+#define RP1_ADC_INTR		0x14
+#define RP1_ADC_INTE		0x18
+#define RP1_ADC_INTF		0x1c
+#define RP1_ADC_INTS		0x20
+
+#define RP1_ADC_RWTYPE_SET	0x2000
+#define RP1_ADC_RWTYPE_CLR	0x3000
+
+#define RP1_ADC_CS_RROBIN_MASK	0x1f
+#define RP1_ADC_CS_RROBIN_SHIFT	16
+#define RP1_ADC_CS_AINSEL_MASK	0x7
+#define RP1_ADC_CS_AINSEL_SHIFT	12
+#define RP1_ADC_CS_ERR_STICKY	0x400
+#define RP1_ADC_CS_ERR		0x200
+#define RP1_ADC_CS_READY	0x100
+#define RP1_ADC_CS_START_MANY	0x8
+#define RP1_ADC_CS_START_ONCE	0x4
+#define RP1_ADC_CS_TS_EN	0x2
+#define RP1_ADC_CS_EN		0x1
+
+#define RP1_ADC_FCS_THRESH_MASK	0xf
+#define RP1_ADC_FCS_THRESH_SHIFT	24
+#define RP1_ADC_FCS_LEVEL_MASK	0xf
+#define RP1_ADC_FCS_LEVEL_SHIFT	16
+#define RP1_ADC_FCS_OVER	0x800
+#define RP1_ADC_FCS_UNDER	0x400
+#define RP1_ADC_FCS_FULL	0x200
+#define RP1_ADC_FCS_EMPTY	0x100
+#define RP1_ADC_FCS_DREQ_EN	0x8
+#define RP1_ADC_FCS_ERR		0x4
+#define RP1_ADC_FCS_SHIFR	0x2
+#define RP1_ADC_FCS_EN		0x1
+
+#define RP1_ADC_FIFO_ERR	0x8000
+#define RP1_ADC_FIFO_VAL_MASK	0xfff
+
+#define RP1_ADC_DIV_INT_MASK	0xffff
+#define RP1_ADC_DIV_INT_SHIFT	8
+#define RP1_ADC_DIV_FRAC_MASK	0xff
+#define RP1_ADC_DIV_FRAC_SHIFT	0
+
+#define RP1_ADC_INT_FIFO	0x1
+
+#define RP1_ADC_CLK_RATE	50000000
+/* A conversion takes 96 ADC clock cycles */
+#define RP1_ADC_CONV_CYCLES	96
+#define RP1_ADC_NUM_CHANNELS	5
+#define RP1_ADC_TEMP_CHANNEL	4
+#define RP1_ADC_DEFAULT_FREQ	1000
+
+struct rp1_adc_data {
+	void __iomem *base;
+	spinlock_t lock;
+	unsigned long clk_rate;
+	int vref_mv;
+	unsigned int scan_freq;
+	unsigned int scan_len;
+	s64 scan_period_ns;
+	s64 timestamp;
+	u32 cs;
+	/* one scan plus the timestamp, aligned for iio_push_to_buffers */
+	struct {
+		u16 chans[RP1_ADC_NUM_CHANNELS];
+		s64 ts __aligned(8);
+	} scan;
+};
+
+#define RP1_ADC_CHANNEL(_index, _type, _info) {				\
+	.type = _type,							\
+	.indexed = 1,							\
+	.channel = _index,						\
+	.info_mask_separate = _info,					\
+	.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_SAMP_FREQ),	\
+	.scan_index = _index,						\
+	.scan_type = {							\
+		.sign = 'u',						\
+		.realbits = 12,						\
+		.storagebits = 16,					\
+		.endianness = IIO_CPU,					\
+	},								\
+}
+
+static const struct iio_chan_spec rp1_adc_channels[] = {
+	RP1_ADC_CHANNEL(0, IIO_VOLTAGE,
+			BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE)),
+	RP1_ADC_CHANNEL(1, IIO_VOLTAGE,
+			BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE)),
+	RP1_ADC_CHANNEL(2, IIO_VOLTAGE,
+			BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE)),
+	RP1_ADC_CHANNEL(3, IIO_VOLTAGE,
+			BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE)),
+	RP1_ADC_CHANNEL(RP1_ADC_TEMP_CHANNEL, IIO_TEMP,
+			BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_PROCESSED)),
+	IIO_CHAN_SOFT_TIMESTAMP(RP1_ADC_NUM_CHANNELS),
+};
+
+static int rp1_adc_ready_wait(struct rp1_adc_data *data)
+{
+	u32 cs;
+
+	return readl_poll_timeout_atomic(data->base + RP1_ADC_CS, cs,
+					 cs & RP1_ADC_CS_READY, 0, 100);
+}
+
+static int rp1_adc_read(struct rp1_adc_data *data, int channel,
+			unsigned int *val)
+{
+	int ret;
+
+	spin_lock(&data->lock);
+
+	if (channel == RP1_ADC_TEMP_CHANNEL)
+		writel(RP1_ADC_CS_TS_EN,
+		       data->base + RP1_ADC_RWTYPE_SET + RP1_ADC_CS);
+	writel(RP1_ADC_CS_AINSEL_MASK << RP1_ADC_CS_AINSEL_SHIFT,
+	       data->base + RP1_ADC_RWTYPE_CLR + RP1_ADC_CS);
+	writel(channel << RP1_ADC_CS_AINSEL_SHIFT,
+	       data->base + RP1_ADC_RWTYPE_SET + RP1_ADC_CS);
+	writel(RP1_ADC_CS_START_ONCE,
+	       data->base + RP1_ADC_RWTYPE_SET + RP1_ADC_CS);
+
+	ret = rp1_adc_ready_wait(data);
+	if (ret)
+		goto unlock;
+
+	/* Asserted if the completed conversion had a convergence error */
+	if (readl(data->base + RP1_ADC_CS) & RP1_ADC_CS_ERR) {
+		ret = -EIO;
+		goto unlock;
+	}
+
+	*val = readl(data->base + RP1_ADC_RESULT);
+
+unlock:
+	spin_unlock(&data->lock);
+
+	return ret;
+}
+
+static int rp1_adc_to_mv(struct rp1_adc_data *data, unsigned int val)
+{
+	return ((u64)data->vref_mv * val) / 0xfff;
+}
+
+static int rp1_adc_read_raw(struct iio_dev *indio_dev,
+			    struct iio_chan_spec const *chan,
+			    int *val, int *val2, long mask)
+{
+	struct rp1_adc_data *data = iio_priv(indio_dev);
+	unsigned int raw;
+	int ret, mv;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+	case IIO_CHAN_INFO_PROCESSED:
+		ret = iio_device_claim_direct_mode(indio_dev);
+		if (ret)
+			return ret;
+		ret = rp1_adc_read(data, chan->channel, &raw);
+		iio_device_release_direct_mode(indio_dev);
+		if (ret)
+			return ret;
+
+		if (mask == IIO_CHAN_INFO_RAW) {
+			*val = raw;
+			return IIO_VAL_INT;
+		}
+
+		/* T = 27 - (ADC_voltage - 0.706)/0.001721 */
+		mv = rp1_adc_to_mv(data, raw);
+		*val = 27000 - DIV_ROUND_CLOSEST((mv - 706) * (s64)1000000,
+						 1721);
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		*val = data->vref_mv;
+		*val2 = chan->scan_type.realbits;
+		return IIO_VAL_FRACTIONAL_LOG2;
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		*val = data->scan_freq;
+		return IIO_VAL_INT;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int rp1_adc_write_raw(struct iio_dev *indio_dev,
+			     struct iio_chan_spec const *chan,
+			     int val, int val2, long mask)
+{
+	struct rp1_adc_data *data = iio_priv(indio_dev);
+	int ret;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_SAMP_FREQ:
+		if (val <= 0 || val2 ||
+		    val > data->clk_rate / RP1_ADC_CONV_CYCLES)
+			return -EINVAL;
+
+		/* the rate is programmed when the buffer is enabled */
+		ret = iio_device_claim_direct_mode(indio_dev);
+		if (ret)
+			return ret;
+		data->scan_freq = val;
+		iio_device_release_direct_mode(indio_dev);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct iio_info rp1_adc_info = {
+	.read_raw = rp1_adc_read_raw,
+	.write_raw = rp1_adc_write_raw,
+};
+
+static void rp1_adc_drain_fifo(struct rp1_adc_data *data)
+{
+	while (!(readl(data->base + RP1_ADC_FCS) & RP1_ADC_FCS_EMPTY))
+		readl(data->base + RP1_ADC_FIFO);
+}
+
+static irqreturn_t rp1_adc_irq(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct rp1_adc_data *data = iio_priv(indio_dev);
+
+	if (!(readl(data->base + RP1_ADC_INTS) & RP1_ADC_INT_FIFO))
+		return IRQ_NONE;
+
+	data->timestamp = iio_get_time_ns(indio_dev);
+
+	/* the level interrupt is re-enabled once the FIFO has been read */
+	writel(0, data->base + RP1_ADC_INTE);
+
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t rp1_adc_irq_thread(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct rp1_adc_data *data = iio_priv(indio_dev);
+	unsigned int level, scans, i;
+	u32 fcs;
+	s64 ts;
+
+	fcs = readl(data->base + RP1_ADC_FCS);
+	if (fcs & (RP1_ADC_FCS_OVER | RP1_ADC_FCS_UNDER)) {
+		/*
+		 * Lost samples leave the FIFO out of step with the scan,
+		 * so drop its contents and restart from the first channel.
+		 */
+		dev_warn_ratelimited(&indio_dev->dev, "ADC FIFO overrun\n");
+		spin_lock(&data->lock);
+		writel(RP1_ADC_CS_START_MANY,
+		       data->base + RP1_ADC_RWTYPE_CLR + RP1_ADC_CS);
+		rp1_adc_ready_wait(data);
+		rp1_adc_drain_fifo(data);
+		writel(fcs, data->base + RP1_ADC_FCS);
+		writel(data->cs, data->base + RP1_ADC_CS);
+		spin_unlock(&data->lock);
+		goto out;
+	}
+
+	level = (fcs >> RP1_ADC_FCS_LEVEL_SHIFT) & RP1_ADC_FCS_LEVEL_MASK;
+	scans = level / data->scan_len;
+	if (!scans)
+		goto out;
+
+	/* The newest scan completed at the interrupt, the others before */
+	ts = data->timestamp - (s64)(scans - 1) * data->scan_period_ns;
+
+	while (scans--) {
+		for (i = 0; i < data->scan_len; i++)
+			data->scan.chans[i] = readl(data->base + RP1_ADC_FIFO) &
+					      RP1_ADC_FIFO_VAL_MASK;
+		iio_push_to_buffers_with_timestamp(indio_dev, &data->scan, ts);
+		ts += data->scan_period_ns;
+	}
+
+out:
+	writel(RP1_ADC_INT_FIFO, data->base + RP1_ADC_INTE);
+
+	return IRQ_HANDLED;
+}
+
+static int rp1_adc_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct rp1_adc_data *data = iio_priv(indio_dev);
+	unsigned long mask = *indio_dev->active_scan_mask;
+	u64 cycles;
+	u32 div;
+
+	data->scan_len = bitmap_weight(&mask, RP1_ADC_NUM_CHANNELS);
+	if (!data->scan_len)
+		return -EINVAL;
+
+	/*
+	 * Conversions start every (1 + INT + FRAC / 256) ADC clock cycles,
+	 * and each scan takes one conversion per enabled channel.
+	 */
+	cycles = div_u64((u64)data->clk_rate << 8,
+			 data->scan_freq * data->scan_len);
+	cycles = clamp_t(u64, cycles, RP1_ADC_CONV_CYCLES << 8,
+			 (u64)(RP1_ADC_DIV_INT_MASK + 1) << 8);
+	div = cycles - BIT(8);
+	data->scan_period_ns = div_u64(cycles * data->scan_len * NSEC_PER_SEC,
+				       data->clk_rate) >> 8;
+
+	spin_lock(&data->lock);
+
+	writel(div, data->base + RP1_ADC_DIV);
+
+	rp1_adc_drain_fifo(data);
+	writel(RP1_ADC_FCS_OVER | RP1_ADC_FCS_UNDER |
+	       (data->scan_len << RP1_ADC_FCS_THRESH_SHIFT) | RP1_ADC_FCS_EN,
+	       data->base + RP1_ADC_FCS);
+	writel(RP1_ADC_INT_FIFO, data->base + RP1_ADC_INTE);
+
+	/* Round-robin from the lowest channel keeps the IIO scan order */
+	data->cs = RP1_ADC_CS_EN | RP1_ADC_CS_START_MANY |
+		   (mask << RP1_ADC_CS_RROBIN_SHIFT) |
+		   (__ffs(mask) << RP1_ADC_CS_AINSEL_SHIFT);
+	if (mask & BIT(RP1_ADC_TEMP_CHANNEL))
+		data->cs |= RP1_ADC_CS_TS_EN;
+	writel(data->cs, data->base + RP1_ADC_CS);
+
+	spin_unlock(&data->lock);
+
+	return 0;
+}
+
+static int rp1_adc_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct rp1_adc_data *data = iio_priv(indio_dev);
+	int ret;
+
+	spin_lock(&data->lock);
+
+	writel(RP1_ADC_CS_START_MANY,
+	       data->base + RP1_ADC_RWTYPE_CLR + RP1_ADC_CS);
+	ret = rp1_adc_ready_wait(data);
+
+	writel(0, data->base + RP1_ADC_INTE);
+	writel(0, data->base + RP1_ADC_FCS);
+	rp1_adc_drain_fifo(data);
+	writel(RP1_ADC_CS_EN, data->base + RP1_ADC_CS);
+
+	spin_unlock(&data->lock);
+
+	return ret;
+}
+
+static const struct iio_buffer_setup_ops rp1_adc_buffer_setup_ops = {
+	.postenable = rp1_adc_buffer_postenable,
+	.predisable = rp1_adc_buffer_predisable,
+};
+
+static void rp1_adc_disable(void *data)
+{
+	struct rp1_adc_data *adc = data;
+
+	writel(0, adc->base + RP1_ADC_INTE);
+	writel(0, adc->base + RP1_ADC_CS);
+}
+
+static int rp1_adc_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct iio_dev *indio_dev;
+	struct rp1_adc_data *data;
+	struct regulator *reg;
+	struct clk *clk;
+	int vref_uv, irq, ret;
+
+	indio_dev = devm_iio_device_alloc(dev, sizeof(*data));
+	if (!indio_dev)
+		return -ENOMEM;
+
+	data = iio_priv(indio_dev);
+	spin_lock_init(&data->lock);
+	data->scan_freq = RP1_ADC_DEFAULT_FREQ;
+
+	data->base = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(data->base))
+		return PTR_ERR(data->base);
+
+	clk = devm_clk_get_enabled(dev, NULL);
+	if (IS_ERR(clk))
+		return dev_err_probe(dev, PTR_ERR(clk), "no clock\n");
+
+	clk_set_rate(clk, RP1_ADC_CLK_RATE);
+	data->clk_rate = clk_get_rate(clk);
+	if (!data->clk_rate)
+		return -EINVAL;
+
+	reg = devm_regulator_get(dev, "vref");
+	if (IS_ERR(reg))
+		return PTR_ERR(reg);
+
+	vref_uv = regulator_get_voltage(reg);
+	if (vref_uv < 0)
+		return vref_uv;
+	data->vref_mv = DIV_ROUND_CLOSEST(vref_uv, 1000);
+
+	/* Disable interrupts */
+	writel(0, data->base + RP1_ADC_INTE);
+
+	/* Enable the block, clearing any sticky error */
+	writel(RP1_ADC_CS_EN | RP1_ADC_CS_ERR_STICKY, data->base + RP1_ADC_CS);
+
+	ret = devm_add_action_or_reset(dev, rp1_adc_disable, data);
+	if (ret)
+		return ret;
+
+	indio_dev->name = "rp1_adc";
+	indio_dev->info = &rp1_adc_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	indio_dev->channels = rp1_adc_channels;
+	indio_dev->num_channels = ARRAY_SIZE(rp1_adc_channels);
+
+	/* Buffered capture needs the FIFO interrupt */
+	irq = platform_get_irq_optional(pdev, 0);
+	if (irq > 0) {
+		ret = devm_iio_kfifo_buffer_setup(dev, indio_dev,
+						  &rp1_adc_buffer_setup_ops);
+		if (ret)
+			return ret;
+
+		ret = devm_request_threaded_irq(dev, irq, rp1_adc_irq,
+						rp1_adc_irq_thread, 0,
+						indio_dev->name, indio_dev);
+		if (ret)
+			return ret;
+	} else if (irq != -ENXIO) {
+		return irq;
+	}
+
+	return devm_iio_device_register(dev, indio_dev);
+}
+
+static const struct of_device_id rp1_adc_dt_ids[] = {
+	{ .compatible = "raspberrypi,rp1-adc", },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, rp1_adc_dt_ids);
+
+static struct platform_driver rp1_adc_driver = {
+	.probe		= rp1_adc_probe,
+	.driver		= {
+		.name	= MODULE_NAME,
+		.of_match_table = rp1_adc_dt_ids,
+	},
+};
+
+module_platform_driver(rp1_adc_driver);
+
+MODULE_DESCRIPTION("RP1 ADC IIO driver");
+MODULE_LICENSE("GPL");
@@ -11,6 +11,8 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+/* The shared ring is that many times bigger than a client buffer */
+#define EVDEV_RING_SCALE	4
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -35,6 +37,10 @@ struct evdev {
 	struct device dev;
 	struct cdev cdev;
 	bool exist;
+	struct input_ring *ring;
+	unsigned int ring_pages;
+	unsigned int ring_clients; /* protected by the device event_lock */
+	wait_queue_head_t ring_wait;
 };
 
 struct evdev_client {
@@ -48,6 +54,7 @@ struct evdev_client {
 	struct list_head node;
 	enum input_clock_type clk_type;
 	bool revoked;
+	struct input_ring_reader *ring_reader; /* set if reading the ring */
 	unsigned long *evmasks[EV_CNT];
 	unsigned int bufsize;
 	struct input_event buffer[];
@@ -191,6 +198,10 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 		return -EINVAL;
 	}
 
+	/* The ring is stamped with the monotonic clock */
+	if (client->ring_reader && clk_type != INPUT_CLK_MONO)
+		return -EINVAL;
+
 	if (client->clk_type != clk_type) {
 		client->clk_type = clk_type;
 
@@ -285,6 +296,54 @@ static void evdev_pass_values(struct evdev_client *client,
 			EPOLLIN | EPOLLOUT | EPOLLRDNORM | EPOLLWRNORM);
 }
 
+/*
+ * Append events to the shared ring. Called with the device event_lock
+ * held, so there is a single writer.
+ *
+ * head moves before an event slot is overwritten, so that readers can
+ * tell whether what they copied was overwritten meanwhile, and
+ * packet_head moves once a whole packet has been written.
+ */
+static void evdev_pass_ring(struct evdev *evdev, struct input_ring *ring,
+			    const struct input_value *vals, unsigned int count,
+			    ktime_t *ev_time)
+{
+	u64 time = ktime_to_ns(ev_time[INPUT_CLK_MONO]);
+	u32 packet_head = ring->packet_head;
+	u32 head = ring->head;
+	const struct input_value *v;
+	struct input_ring_event *ev;
+	bool wakeup = false;
+
+	for (v = vals; v != vals + count; v++) {
+		if (v->type == EV_SYN && v->code == SYN_REPORT) {
+			/* drop empty SYN_REPORT */
+			if (packet_head == head)
+				continue;
+
+			wakeup = true;
+		}
+
+		WRITE_ONCE(ring->head, head + 1);
+		smp_wmb();
+
+		ev = &ring->events[head++ & (ring->size - 1)];
+		ev->time = time;
+		ev->type = v->type;
+		ev->code = v->code;
+		ev->value = v->value;
+
+		if (v->type == EV_SYN && v->code == SYN_REPORT) {
+			packet_head = head;
+			smp_store_release(&ring->packet_head, packet_head);
+		}
+	}
+
+	if (wakeup)
+		wake_up_interruptible_poll(&evdev->ring_wait,
+			EPOLLIN | EPOLLOUT | EPOLLRDNORM | EPOLLWRNORM);
+}
+
 /*
  * Pass incoming events to all connected clients.
  */
@@ -299,11 +358,17 @@ static void evdev_events(struct input_handle *handle,
 
 	client = rcu_dereference(evdev->grab);
 
-	if (client)
+	if (client) {
 		evdev_pass_values(client, vals, count, ev_time);
-	else
+	} else {
+		if (evdev->ring_clients)
+			evdev_pass_ring(evdev, evdev->ring, vals, count,
+					ev_time);
+
 		list_for_each_entry_rcu(client, &evdev->client_list, node)
-			evdev_pass_values(client, vals, count, ev_time);
+			if (!client->ring_reader)
+				evdev_pass_values(client, vals, count, ev_time);
+	}
 
 	rcu_read_unlock();
 }
@@ -331,6 +396,7 @@ static void evdev_free(struct device *dev)
 	struct evdev *evdev = container_of(dev, struct evdev, dev);
 
 	input_put_device(evdev->handle.dev);
+	vfree(evdev->ring);
 	kfree(evdev);
 }
 
@@ -430,6 +496,8 @@ static void evdev_hangup(struct evdev *evdev)
 		wake_up_interruptible_poll(&client->wait, EPOLLHUP | EPOLLERR);
 	}
 	spin_unlock(&evdev->client_lock);
+
+	wake_up_interruptible_poll(&evdev->ring_wait, EPOLLHUP | EPOLLERR);
 }
 
 static int evdev_release(struct inode *inode, struct file *file)
@@ -448,6 +516,13 @@ static int evdev_release(struct inode *inode, struct file *file)
 
 	evdev_detach_client(evdev, client);
 
+	if (client->ring_reader) {
+		spin_lock_irq(&evdev->handle.dev->event_lock);
+		evdev->ring_clients--;
+		spin_unlock_irq(&evdev->handle.dev->event_lock);
+		vfree(client->ring_reader);
+	}
+
 	for (i = 0; i < EV_CNT; ++i)
 		bitmap_free(client->evmasks[i]);
 
@@ -555,6 +630,105 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 	return have_event;
 }
 
+static bool evdev_ring_pending(struct evdev_client *client)
+{
+	struct input_ring *ring = client->evdev->ring;
+
+	return smp_load_acquire(&ring->packet_head) !=
+		READ_ONCE(client->ring_reader->tail);
+}
+
+static bool evdev_ring_is_filtered(struct evdev_client *client,
+				   const struct input_ring_event *ev)
+{
+	bool filtered;
+
+	spin_lock_irq(&client->buffer_lock);
+	filtered = __evdev_is_filtered(client, ev->type, ev->code);
+	spin_unlock_irq(&client->buffer_lock);
+
+	return filtered;
+}
+
+static ssize_t evdev_ring_read(struct file *file, char __user *buffer,
+			       size_t count)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	struct input_ring *ring = evdev->ring;
+	struct input_ring_reader *reader = client->ring_reader;
+	struct input_ring_event ev;
+	struct input_event event;
+	struct timespec64 ts;
+	u32 tail, packet_head;
+	size_t read = 0;
+	int error;
+
+	for (;;) {
+		if (!evdev->exist || client->revoked)
+			return -ENODEV;
+
+		tail = READ_ONCE(reader->tail);
+		packet_head = smp_load_acquire(&ring->packet_head);
+
+		if (packet_head == tail && (file->f_flags & O_NONBLOCK))
+			return -EAGAIN;
+
+		if (count == 0)
+			break;
+
+		while (read + input_event_size() <= count &&
+		       tail != packet_head) {
+			ev = ring->events[tail & (ring->size - 1)];
+
+			/* Was it overwritten before or while we copied it? */
+			smp_rmb();
+			if (READ_ONCE(ring->head) - tail > ring->size) {
+				ts = ktime_to_timespec64(ktime_get());
+				event.type = EV_SYN;
+				event.code = SYN_DROPPED;
+				event.value = 0;
+				tail = packet_head =
+					smp_load_acquire(&ring->packet_head);
+			} else {
+				tail++;
+				if (evdev_ring_is_filtered(client, &ev))
+					continue;
+
+				ts = ns_to_timespec64(ev.time);
+				event.type = ev.type;
+				event.code = ev.code;
+				event.value = ev.value;
+			}
+
+			event.input_event_sec = ts.tv_sec;
+			event.input_event_usec = ts.tv_nsec / NSEC_PER_USEC;
+
+			if (input_event_to_user(buffer + read, &event)) {
+				WRITE_ONCE(reader->tail, tail);
+				return -EFAULT;
+			}
+
+			read += input_event_size();
+		}
+
+		WRITE_ONCE(reader->tail, tail);
+
+		if (read)
+			break;
+
+		if (!(file->f_flags & O_NONBLOCK)) {
+			error = wait_event_interruptible(evdev->ring_wait,
+					evdev_ring_pending(client) ||
+					!evdev->exist || client->revoked);
+			if (error)
+				return error;
+		}
+	}
+
+	return read;
+}
+
 static ssize_t evdev_read(struct file *file, char __user *buffer,
 			  size_t count, loff_t *ppos)
 {
@@ -567,6 +741,9 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 	if (count != 0 && count < input_event_size())
 		return -EINVAL;
 
+	if (client->ring_reader)
+		return evdev_ring_read(file, buffer, count);
+
 	for (;;) {
 		if (!evdev->exist || client->revoked)
 			return -ENODEV;
@@ -614,18 +791,80 @@ static __poll_t evdev_poll(struct file *file, poll_table *wait)
 	__poll_t mask;
 
 	poll_wait(file, &client->wait, wait);
+	if (client->ring_reader)
+		poll_wait(file, &evdev->ring_wait, wait);
 
 	if (evdev->exist && !client->revoked)
 		mask = EPOLLOUT | EPOLLWRNORM;
 	else
 		mask = EPOLLHUP | EPOLLERR;
 
-	if (client->packet_head != client->tail)
+	if (client->ring_reader ? evdev_ring_pending(client) :
+				  client->packet_head != client->tail)
 		mask |= EPOLLIN | EPOLLRDNORM;
 
 	return mask;
 }
 
+static vm_fault_t evdev_ring_fault(struct vm_fault *vmf)
+{
+	struct evdev_client *client = vmf->vma->vm_file->private_data;
+	struct evdev *evdev = client->evdev;
+	void *addr;
+
+	/* Revoking the client zaps its mappings, so that it ends up here */
+	if (client->revoked)
+		return VM_FAULT_SIGBUS;
+
+	if (vmf->pgoff == 0)
+		addr = client->ring_reader;
+	else if (vmf->pgoff <= evdev->ring_pages)
+		addr = (void *)evdev->ring + ((vmf->pgoff - 1) << PAGE_SHIFT);
+	else
+		return VM_FAULT_SIGBUS;
+
+	vmf->page = vmalloc_to_page(addr);
+	get_page(vmf->page);
+
+	return 0;
+}
+
+static const struct vm_operations_struct evdev_ring_vm_ops = {
+	.fault = evdev_ring_fault,
+};
+
+/*
+ * Page 0 is the client's struct input_ring_reader, the following ones
+ * are the shared struct input_ring.
+ */
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	unsigned long pages = vma_pages(vma);
+
+	if (!client->ring_reader)
+		return -EINVAL;
+
+	if (vma->vm_pgoff == 0) {
+		/* The kernel must see the client moving its tail */
+		if (pages != 1 || !(vma->vm_flags & VM_SHARED))
+			return -EINVAL;
+	} else {
+		if (vma->vm_pgoff > evdev->ring_pages ||
+		    pages > evdev->ring_pages - (vma->vm_pgoff - 1))
+			return -EINVAL;
+		if (vma->vm_flags & VM_WRITE)
+			return -EPERM;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_ops = &evdev_ring_vm_ops;
+
+	return 0;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -948,9 +1187,70 @@ static int evdev_revoke(struct evdev *evdev, struct evdev_client *client,
 	input_flush_device(&evdev->handle, file);
 	wake_up_interruptible_poll(&client->wait, EPOLLHUP | EPOLLERR);
 
+	if (client->ring_reader) {
+		wake_up_interruptible_poll(&evdev->ring_wait,
+					   EPOLLHUP | EPOLLERR);
+		/*
+		 * This zaps the mappings of all the clients of the device
+		 * node, the others just fault their pages back in.
+		 */
+		unmap_mapping_range(file->f_mapping, 0, 0, 1);
+	}
+
 	return 0;
 }
 
+/* must be called with evdev->mutex held */
+static int evdev_attach_ring(struct evdev *evdev, struct evdev_client *client)
+{
+	struct input_dev *dev = evdev->handle.dev;
+	struct input_ring *ring = evdev->ring;
+	struct input_ring_reader *reader;
+	unsigned int size;
+	size_t bytes;
+
+	if (client->ring_reader)
+		return ring->size;
+
+	if (client->clk_type != INPUT_CLK_MONO ||
+	    rcu_access_pointer(evdev->grab) == client)
+		return -EINVAL;
+
+	if (!ring) {
+		size = evdev_compute_buffer_size(dev) * EVDEV_RING_SCALE;
+		bytes = PAGE_ALIGN(struct_size(ring, events, size));
+
+		ring = vmalloc_user(bytes);
+		if (!ring)
+			return -ENOMEM;
+
+		ring->size = size;
+		evdev->ring = ring;
+		evdev->ring_pages = bytes >> PAGE_SHIFT;
+	}
+
+	reader = vmalloc_user(PAGE_SIZE);
+	if (!reader)
+		return -ENOMEM;
+
+	spin_lock_irq(&dev->event_lock);
+
+	/* Drop a packet cut short while nobody was reading the ring */
+	if (!evdev->ring_clients++)
+		ring->head = ring->packet_head;
+
+	reader->tail = ring->packet_head;
+	client->ring_reader = reader;
+
+	spin_unlock_irq(&dev->event_lock);
+
+	spin_lock_irq(&client->buffer_lock);
+	client->packet_head = client->head = client->tail;
+	spin_unlock_irq(&client->buffer_lock);
+
+	return ring->size;
+}
+
 /* must be called with evdev-mutex held */
 static int evdev_set_mask(struct evdev_client *client,
 			  unsigned int type,
@@ -1084,6 +1384,8 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 		return 0;
 
 	case EVIOCGRAB:
+		if (client->ring_reader)
+			return -EINVAL;
 		if (p)
 			return evdev_grab(evdev, client);
 		else
@@ -1125,6 +1427,9 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 
 		return evdev_set_clk_type(client, i);
 
+	case EVIOCSRING:
+		return evdev_attach_ring(evdev, client);
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -1301,6 +1606,7 @@ static const struct file_operations evdev_fops = {
 	.compat_ioctl	= evdev_ioctl_compat,
 #endif
 	.fasync		= evdev_fasync,
+	.mmap		= evdev_mmap,
 	.llseek		= no_llseek,
 };
 
@@ -1358,6 +1664,7 @@ static int evdev_connect(struct input_handler *handler, struct input_dev *dev,
 	INIT_LIST_HEAD(&evdev->client_list);
 	spin_lock_init(&evdev->client_lock);
 	mutex_init(&evdev->mutex);
+	init_waitqueue_head(&evdev->ring_wait);
 	evdev->exist = true;
 
 	dev_no = minor;
@@ -43,6 +43,7 @@ struct gpio_button_data {
 	struct delayed_work work;
 	struct hrtimer debounce_timer;
 	unsigned int software_debounce;	/* in msecs, for GPIO-driven buttons */
+	ktime_t irq_time;		/* of the first edge being debounced */
 
 	unsigned int irq;
 	unsigned int wakeup_trigger_type;
@@ -389,6 +390,18 @@ static void gpio_keys_gpio_report_event(struct gpio_button_data *bdata)
 
 static void gpio_keys_debounce_event(struct gpio_button_data *bdata)
 {
+	unsigned long flags;
+	ktime_t irq_time;
+
+	spin_lock_irqsave(&bdata->lock, flags);
+	irq_time = bdata->irq_time;
+	bdata->irq_time = 0;
+	spin_unlock_irqrestore(&bdata->lock, flags);
+
+	/* The button changed at the edge, not after the debounce */
+	if (irq_time)
+		input_set_timestamp(bdata->input, irq_time);
+
 	gpio_keys_gpio_report_event(bdata);
 	input_sync(bdata->input);
 
@@ -417,9 +430,17 @@ static enum hrtimer_restart gpio_keys_debounce_timer(struct hrtimer *t)
 static irqreturn_t gpio_keys_gpio_isr(int irq, void *dev_id)
 {
 	struct gpio_button_data *bdata = dev_id;
+	ktime_t now = ktime_get();
+	unsigned long flags;
 
 	BUG_ON(irq != bdata->irq);
 
+	/* Bounces restart the debounce, but the press started here */
+	spin_lock_irqsave(&bdata->lock, flags);
+	if (!bdata->irq_time)
+		bdata->irq_time = now;
+	spin_unlock_irqrestore(&bdata->lock, flags);
+
 	if (bdata->button->wakeup) {
 		const struct gpio_keys_button *button = bdata->button;
 
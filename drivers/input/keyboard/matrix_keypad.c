@@ -23,12 +23,16 @@
 #include <linux/of_gpio.h>
 #include <linux/of_platform.h>
 
+#define MATRIX_KEYPAD_VELOCITY_MAX	127U
+#define MATRIX_KEYPAD_VELOCITY_SCAN_US	250
+
 struct matrix_keypad {
 	const struct matrix_keypad_platform_data *pdata;
 	struct input_dev *input_dev;
 	unsigned int row_shift;
 
 	DECLARE_BITMAP(disabled_gpios, MATRIX_MAX_ROWS);
+	struct gpio_desc *row_descs[MATRIX_MAX_ROWS];
 
 	uint32_t last_key_state[MATRIX_MAX_COLS];
 	struct delayed_work work;
@@ -36,6 +40,12 @@ struct matrix_keypad {
 	bool scan_pending;
 	bool stopped;
 	bool gpio_all_disabled;
+	ktime_t irq_time; /* of the interrupt that scheduled the scan */
+
+	/* velocity sensing pads, by scan code of their first contact */
+	ktime_t *contact_time;
+	uint32_t velocity_down[MATRIX_MAX_COLS];
+	unsigned int velocity_scan_us;
 };
 
 /*
@@ -83,6 +93,27 @@ static bool row_asserted(const struct matrix_keypad_platform_data *pdata,
 			!pdata->active_low : pdata->active_low;
 }
 
+/* Rows sharing a GPIO bank are read at once, if the controller can do it */
+static uint32_t read_rows(struct matrix_keypad *keypad)
+{
+	const struct matrix_keypad_platform_data *pdata = keypad->pdata;
+	DECLARE_BITMAP(values, MATRIX_MAX_ROWS);
+	uint32_t state = 0;
+	int row;
+
+	if (!gpiod_get_raw_array_value_cansleep(pdata->num_row_gpios,
+						keypad->row_descs, NULL,
+						values)) {
+		state = pdata->active_low ? ~values[0] : values[0];
+		return state & (uint32_t)(BIT_ULL(pdata->num_row_gpios) - 1);
+	}
+
+	for (row = 0; row < pdata->num_row_gpios; row++)
+		state |= row_asserted(pdata, row) ? (1 << row) : 0;
+
+	return state;
+}
+
 static void enable_row_irqs(struct matrix_keypad *keypad)
 {
 	const struct matrix_keypad_platform_data *pdata = keypad->pdata;
@@ -109,35 +140,37 @@ static void disable_row_irqs(struct matrix_keypad *keypad)
 	}
 }
 
-/*
- * This gets the keys from keyboard and reports it to input subsystem
- */
-static void matrix_keypad_scan(struct work_struct *work)
+static void matrix_keypad_read_state(struct matrix_keypad *keypad,
+				     uint32_t *new_state)
 {
-	struct matrix_keypad *keypad =
-		container_of(work, struct matrix_keypad, work.work);
-	struct input_dev *input_dev = keypad->input_dev;
-	const unsigned short *keycodes = input_dev->keycode;
 	const struct matrix_keypad_platform_data *pdata = keypad->pdata;
-	uint32_t new_state[MATRIX_MAX_COLS];
-	int row, col, code;
+	int col;
 
 	/* de-activate all columns for scanning */
 	activate_all_cols(pdata, false);
 
-	memset(new_state, 0, sizeof(new_state));
+	memset(new_state, 0, sizeof(uint32_t) * MATRIX_MAX_COLS);
 
 	/* assert each column and read the row status out */
 	for (col = 0; col < pdata->num_col_gpios; col++) {
 
 		activate_col(pdata, col, true);
-
-		for (row = 0; row < pdata->num_row_gpios; row++)
-			new_state[col] |=
-				row_asserted(pdata, row) ? (1 << row) : 0;
-
+		new_state[col] = read_rows(keypad);
 		activate_col(pdata, col, false);
 	}
+}
+
+static void matrix_keypad_report(struct matrix_keypad *keypad,
+				 const uint32_t *new_state, ktime_t irq_time)
+{
+	struct input_dev *input_dev = keypad->input_dev;
+	const unsigned short *keycodes = input_dev->keycode;
+	const struct matrix_keypad_platform_data *pdata = keypad->pdata;
+	int row, col, code;
+
+	/* The keys changed when the IRQ fired, not after the debounce */
+	if (irq_time)
+		input_set_timestamp(input_dev, irq_time);
 
 	for (col = 0; col < pdata->num_col_gpios; col++) {
 		uint32_t bits_changed;
@@ -158,8 +191,122 @@ static void matrix_keypad_scan(struct work_struct *work)
 		}
 	}
 	input_sync(input_dev);
+}
+
+static void matrix_keypad_report_velocity_key(struct matrix_keypad *keypad,
+					      int code, ktime_t now, int value,
+					      int velocity)
+{
+	struct input_dev *input_dev = keypad->input_dev;
+
+	input_set_timestamp(input_dev, now);
+	input_event(input_dev, EV_MSC, MSC_SCAN, code);
+	if (value) {
+		/* Make sure it is sent even if it didn't change */
+		input_abs_set_val(input_dev, ABS_PRESSURE, 0);
+		input_report_abs(input_dev, ABS_PRESSURE, velocity);
+	}
+	input_report_key(input_dev, input_dev->keycode[code], value);
+	input_sync(input_dev);
+}
+
+/*
+ * Each pad closes the contact on an even row first, then the one on the
+ * next row, and the time between the two gives the velocity. The pad is
+ * reported pressed once the second contact closes, or with the lowest
+ * velocity once velocity_max_us have passed without it, and released
+ * when the first contact opens. Returns true while pads are between
+ * their contacts, they need to be scanned again soon.
+ */
+static bool matrix_keypad_report_velocity(struct matrix_keypad *keypad,
+					  const uint32_t *new_state,
+					  ktime_t irq_time)
+{
+	const struct matrix_keypad_platform_data *pdata = keypad->pdata;
+	unsigned int max_us = pdata->velocity_max_us;
+	ktime_t now = ktime_get();
+	bool pending = false;
+	unsigned int left;
+	int row, col, code;
+	s64 delta;
+
+	for (col = 0; col < pdata->num_col_gpios; col++) {
+		for (row = 0; row + 1 < pdata->num_row_gpios; row += 2) {
+			bool first = new_state[col] & BIT(row);
+			bool second = new_state[col] & BIT(row + 1);
+			bool down = keypad->velocity_down[col] & BIT(row);
+			ktime_t *start;
+
+			code = MATRIX_SCAN_CODE(row, col, keypad->row_shift);
+			start = &keypad->contact_time[code];
+
+			if (!first) {
+				if (down)
+					matrix_keypad_report_velocity_key(
+						keypad, code, now, 0, 0);
+				keypad->velocity_down[col] &= ~BIT(row);
+				*start = 0;
+				continue;
+			}
+
+			if (down)
+				continue;
+
+			/* The first scan after the IRQ is as late as it got */
+			if (!*start)
+				*start = irq_time ?: now;
+
+			delta = ktime_us_delta(now, *start);
+			if (!second && delta < max_us) {
+				pending = true;
+				continue;
+			}
+
+			left = max_us - min_t(s64, delta, max_us);
+			matrix_keypad_report_velocity_key(keypad, code, now, 1,
+				max(1U, MATRIX_KEYPAD_VELOCITY_MAX * left /
+					max_us));
+			keypad->velocity_down[col] |= BIT(row);
+		}
+	}
+
+	return pending;
+}
+
+/*
+ * This gets the keys from keyboard and reports it to input subsystem
+ */
+static void matrix_keypad_scan(struct work_struct *work)
+{
+	struct matrix_keypad *keypad =
+		container_of(work, struct matrix_keypad, work.work);
+	const struct matrix_keypad_platform_data *pdata = keypad->pdata;
+	uint32_t new_state[MATRIX_MAX_COLS];
+	bool pending = false;
+	ktime_t irq_time;
+
+	spin_lock_irq(&keypad->lock);
+	irq_time = keypad->irq_time;
+	keypad->irq_time = 0;
+	spin_unlock_irq(&keypad->lock);
 
-	memcpy(keypad->last_key_state, new_state, sizeof(new_state));
+	do {
+		if (pending)
+			usleep_range(keypad->velocity_scan_us,
+				     keypad->velocity_scan_us + 50);
+
+		matrix_keypad_read_state(keypad, new_state);
+
+		if (keypad->contact_time)
+			pending = matrix_keypad_report_velocity(keypad,
+								new_state,
+								irq_time);
+		else
+			matrix_keypad_report(keypad, new_state, irq_time);
+
+		memcpy(keypad->last_key_state, new_state, sizeof(new_state));
+		irq_time = 0;
+	} while (pending && !READ_ONCE(keypad->stopped));
 
 	activate_all_cols(pdata, true);
 
@@ -187,6 +334,7 @@ static irqreturn_t matrix_keypad_interrupt(int irq, void *id)
 
 	disable_row_irqs(keypad);
 	keypad->scan_pending = true;
+	keypad->irq_time = ktime_get();
 	schedule_delayed_work(&keypad->work,
 		msecs_to_jiffies(keypad->pdata->debounce_ms));
 
@@ -330,6 +478,7 @@ static int matrix_keypad_init_gpio(struct platform_device *pdev,
 		}
 
 		gpio_direction_input(pdata->row_gpios[i]);
+		keypad->row_descs[i] = gpio_to_desc(pdata->row_gpios[i]);
 	}
 
 	if (pdata->clustered_irq > 0) {
@@ -439,6 +588,8 @@ matrix_keypad_parse_dt(struct device *dev)
 	of_property_read_u32(np, "debounce-delay-ms", &pdata->debounce_ms);
 	of_property_read_u32(np, "col-scan-delay-us",
 						&pdata->col_scan_delay_us);
+	of_property_read_u32(np, "velocity-max-us", &pdata->velocity_max_us);
+	of_property_read_u32(np, "velocity-scan-us", &pdata->velocity_scan_us);
 
 	gpios = devm_kcalloc(dev,
 			     pdata->num_row_gpios + pdata->num_col_gpios,
@@ -524,6 +675,28 @@ static int matrix_keypad_probe(struct platform_device *pdev)
 		goto err_free_mem;
 	}
 
+	if (pdata->velocity_max_us) {
+		if (pdata->num_row_gpios % 2) {
+			dev_err(&pdev->dev,
+				"velocity sensing needs pairs of rows\n");
+			err = -EINVAL;
+			goto err_free_mem;
+		}
+
+		keypad->contact_time = kcalloc(pdata->num_row_gpios <<
+					       keypad->row_shift,
+					       sizeof(ktime_t), GFP_KERNEL);
+		if (!keypad->contact_time) {
+			err = -ENOMEM;
+			goto err_free_mem;
+		}
+
+		keypad->velocity_scan_us = pdata->velocity_scan_us ?:
+					   MATRIX_KEYPAD_VELOCITY_SCAN_US;
+		input_set_abs_params(input_dev, ABS_PRESSURE, 0,
+				     MATRIX_KEYPAD_VELOCITY_MAX, 0, 0);
+	}
+
 	if (!pdata->no_autorepeat)
 		__set_bit(EV_REP, input_dev->evbit);
 	input_set_capability(input_dev, EV_MSC, MSC_SCAN);
@@ -546,6 +719,8 @@ static int matrix_keypad_probe(struct platform_device *pdev)
 	matrix_keypad_free_gpio(keypad);
 err_free_mem:
 	input_free_device(input_dev);
+	if (keypad)
+		kfree(keypad->contact_time);
 	kfree(keypad);
 	return err;
 }
@@ -556,6 +731,7 @@ static int matrix_keypad_remove(struct platform_device *pdev)
 
 	matrix_keypad_free_gpio(keypad);
 	input_unregister_device(keypad->input_dev);
+	kfree(keypad->contact_time);
 	kfree(keypad);
 
 	return 0;
@@ -16,6 +16,7 @@
 #include <linux/interrupt.h>
 #include <linux/input.h>
 #include <linux/device.h>
+#include <linux/devm-helpers.h>
 #include <linux/platform_device.h>
 #include <linux/gpio/consumer.h>
 #include <linux/slab.h>
@@ -44,6 +45,7 @@ struct rotary_encoder {
 	unsigned int pos;
 
 	struct gpio_descs *gpios;
+	unsigned long *values;
 
 	unsigned int *irq;
 
@@ -51,6 +53,11 @@ struct rotary_encoder {
 	signed char dir;	/* 1 - clockwise, -1 - CCW */
 
 	unsigned int last_stable;
+
+	/* relative motion accumulated for the next report */
+	unsigned int report_interval;	/* jiffies, 0 - report every step */
+	int delta;
+	struct delayed_work report_work;
 };
 
 static unsigned int rotary_encoder_get_state(struct rotary_encoder *encoder)
@@ -58,8 +65,17 @@ static unsigned int rotary_encoder_get_state(struct rotary_encoder *encoder)
 	int i;
 	unsigned int ret = 0;
 
+	/*
+	 * Sample all lines at once, which is a single register access for
+	 * controllers that can read multiple lines of a bank together.
+	 */
+	gpiod_get_array_value_cansleep(encoder->gpios->ndescs,
+				       encoder->gpios->desc,
+				       encoder->gpios->info,
+				       encoder->values);
+
 	for (i = 0; i < encoder->gpios->ndescs; ++i) {
-		int val = gpiod_get_value_cansleep(encoder->gpios->desc[i]);
+		int val = test_bit(i, encoder->values);
 
 		/* convert from gray encoding to normal */
 		if (encoder->encoding == ROTENC_GRAY && ret & 1)
@@ -71,8 +87,32 @@ static unsigned int rotary_encoder_get_state(struct rotary_encoder *encoder)
 	return ret & 3;
 }
 
+static void rotary_encoder_report_work(struct work_struct *work)
+{
+	struct rotary_encoder *encoder =
+		container_of(work, struct rotary_encoder, report_work.work);
+
+	mutex_lock(&encoder->access_mutex);
+
+	if (encoder->delta) {
+		input_report_rel(encoder->input, encoder->axis, encoder->delta);
+		input_sync(encoder->input);
+		encoder->delta = 0;
+	}
+
+	mutex_unlock(&encoder->access_mutex);
+}
+
 static void rotary_encoder_report_event(struct rotary_encoder *encoder)
 {
+	if (encoder->relative_axis && encoder->report_interval) {
+		/* report the accumulated motion once per interval */
+		encoder->delta += encoder->dir;
+		schedule_delayed_work(&encoder->report_work,
+				      encoder->report_interval);
+		return;
+	}
+
 	if (encoder->relative_axis) {
 		input_report_rel(encoder->input,
 				 encoder->axis, encoder->dir);
@@ -157,22 +197,30 @@ static irqreturn_t rotary_encoder_half_period_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/* direction of a quarter period step, indexed by [last state][state] */
+static const signed char rotary_encoder_quarter_steps[4][4] = {
+	{  0,  1,  0, -1 },
+	{ -1,  0,  1,  0 },
+	{  0, -1,  0,  1 },
+	{  1,  0, -1,  0 },
+};
+
 static irqreturn_t rotary_encoder_quarter_period_irq(int irq, void *dev_id)
 {
 	struct rotary_encoder *encoder = dev_id;
 	unsigned int state;
+	signed char dir;
 
 	mutex_lock(&encoder->access_mutex);
 
 	state = rotary_encoder_get_state(encoder);
 
-	if ((encoder->last_stable + 1) % 4 == state)
-		encoder->dir = 1;
-	else if (encoder->last_stable == (state + 1) % 4)
-		encoder->dir = -1;
-	else
+	/* no movement or a missed edge, which can't be resolved */
+	dir = rotary_encoder_quarter_steps[encoder->last_stable][state];
+	if (!dir)
 		goto out;
 
+	encoder->dir = dir;
 	rotary_encoder_report_event(encoder);
 
 out:
@@ -189,6 +237,7 @@ static int rotary_encoder_probe(struct platform_device *pdev)
 	struct input_dev *input;
 	irq_handler_t handler;
 	u32 steps_per_period;
+	u32 report_interval_ms = 0;
 	unsigned int i;
 	int err;
 
@@ -235,6 +284,9 @@ static int rotary_encoder_probe(struct platform_device *pdev)
 	encoder->relative_axis =
 		device_property_read_bool(dev, "rotary-encoder,relative-axis");
 
+	device_property_read_u32(dev, "rotary-encoder,report-interval-ms",
+				 &report_interval_ms);
+
 	encoder->gpios = devm_gpiod_get_array(dev, NULL, GPIOD_IN);
 	if (IS_ERR(encoder->gpios)) {
 		err = PTR_ERR(encoder->gpios);
@@ -247,12 +299,26 @@ static int rotary_encoder_probe(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	encoder->values = devm_bitmap_zalloc(dev, encoder->gpios->ndescs,
+					     GFP_KERNEL);
+	if (!encoder->values)
+		return -ENOMEM;
+
 	input = devm_input_allocate_device(dev);
 	if (!input)
 		return -ENOMEM;
 
 	encoder->input = input;
 
+	/* Registered after the input device, so it's cancelled before it goes */
+	if (encoder->relative_axis && report_interval_ms) {
+		encoder->report_interval = msecs_to_jiffies(report_interval_ms);
+		err = devm_delayed_work_autocancel(dev, &encoder->report_work,
+						   rotary_encoder_report_work);
+		if (err)
+			return err;
+	}
+
 	input->name = pdev->name;
 	input->id.bustype = BUS_HOST;
 	input->dev.parent = dev;
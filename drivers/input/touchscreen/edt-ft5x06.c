@@ -133,6 +133,9 @@ struct edt_ft5x06_ts_data {
 	int report_rate;
 	int max_support_points;
 	unsigned int known_ids;
+	/* touch points in the last report, read along with its header */
+	unsigned int last_points;
+	ktime_t irq_time;
 
 	char name[EDT_NAME_LEN];
 	char fw_version[EDT_NAME_LEN];
@@ -203,6 +206,15 @@ static bool edt_ft5x06_ts_check_crc(struct edt_ft5x06_ts_data *tsdata,
 	return true;
 }
 
+static irqreturn_t edt_ft5x06_ts_hardirq(int irq, void *dev_id)
+{
+	struct edt_ft5x06_ts_data *tsdata = dev_id;
+
+	tsdata->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 {
 	struct edt_ft5x06_ts_data *tsdata = dev_id;
@@ -234,7 +246,8 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 		offset = 3;
 		tplen = 6;
 		crclen = 0;
-		datalen = 3;
+		/* The points are likely the same as last time, save a read */
+		datalen = tplen * tsdata->last_points + offset + crclen;
 		break;
 
 	default:
@@ -286,12 +299,13 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 			tsdata->init_td_status = 0;
 		}
 
-		if (num_points) {
-			datalen = tplen * num_points + crclen;
-			cmd = offset;
+		if (num_points > tsdata->last_points) {
+			datalen = tplen * (num_points - tsdata->last_points) +
+				  crclen;
+			cmd = tplen * tsdata->last_points + offset;
 			error = edt_ft5x06_ts_readwrite(tsdata->client,
 							sizeof(cmd), &cmd,
-							datalen, &rdbuf[offset]);
+							datalen, &rdbuf[cmd]);
 			if (error) {
 				dev_err_ratelimited(dev,
 						    "Unable to fetch data, error: %d\n",
@@ -299,8 +313,12 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 				goto out;
 			}
 		}
+		tsdata->last_points = num_points;
 	}
 
+	/* When polling, the report is as old as the read */
+	input_set_timestamp(tsdata->input, irq ? tsdata->irq_time : ktime_get());
+
 	for (i = 0; i < num_points; i++) {
 		u8 *buf = &rdbuf[i * tplen + offset];
 
@@ -1400,7 +1418,8 @@ static int edt_ft5x06_ts_probe(struct i2c_client *client,
 		irq_flags |= IRQF_ONESHOT;
 
 		error = devm_request_threaded_irq(&client->dev, client->irq,
-						  NULL, edt_ft5x06_ts_isr,
+						  edt_ft5x06_ts_hardirq,
+						  edt_ft5x06_ts_isr,
 						  irq_flags, client->name,
 						  tsdata);
 		if (error) {
@@ -259,9 +259,13 @@ static int goodix_ts_read_input_report(struct goodix_ts_data *ts, u8 *data)
 	/*
 	 * We are going to read 1-byte header,
 	 * ts->contact_size * max(1, touch_num) bytes of coordinates
-	 * and 1-byte footer which contains the touch-key code.
+	 * and 1-byte footer which contains the touch-key code. The number
+	 * of contacts rarely changes between two reports, so the first read
+	 * is sized for the last one.
 	 */
-	const int header_contact_keycode_size = 1 + ts->contact_size + 1;
+	const unsigned int guess_num = max(1U, ts->last_touch_num);
+	const int header_contact_keycode_size =
+		1 + ts->contact_size * guess_num + 1;
 
 	/*
 	 * The 'buffer status' bit, which indicates that the data is valid, is
@@ -280,17 +284,18 @@ static int goodix_ts_read_input_report(struct goodix_ts_data *ts, u8 *data)
 			if (touch_num > ts->max_touch_num)
 				return -EPROTO;
 
-			if (touch_num > 1) {
+			if (touch_num > guess_num) {
 				addr += header_contact_keycode_size;
 				data += header_contact_keycode_size;
 				error = goodix_i2c_read(ts->client,
 						addr, data,
 						ts->contact_size *
-							(touch_num - 1));
+							(touch_num - guess_num));
 				if (error)
 					return error;
 			}
 
+			ts->last_touch_num = touch_num;
 			return touch_num;
 		}
 
@@ -475,6 +480,10 @@ static void goodix_process_events(struct goodix_ts_data *ts)
 	if (touch_num < 0)
 		return;
 
+	input_set_timestamp(ts->input_dev, ts->irq_time);
+	if (ts->input_pen)
+		input_set_timestamp(ts->input_pen, ts->irq_time);
+
 	/* The pen being down is always reported as a single touch */
 	if (touch_num == 1 && (point_data[1] & 0x80)) {
 		goodix_ts_report_pen_down(ts, point_data);
@@ -499,6 +508,21 @@ static void goodix_process_events(struct goodix_ts_data *ts)
 	input_sync(ts->input_dev);
 }
 
+/**
+ * goodix_ts_hardirq - The primary IRQ handler, timestamps the report
+ *
+ * @irq: interrupt number.
+ * @dev_id: private data pointer.
+ */
+static irqreturn_t goodix_ts_hardirq(int irq, void *dev_id)
+{
+	struct goodix_ts_data *ts = dev_id;
+
+	ts->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 /**
  * goodix_ts_irq_handler - The IRQ handler
  *
@@ -528,6 +552,7 @@ static void goodix_ts_work_i2c_poll(struct work_struct *work)
 	struct goodix_ts_data *ts = container_of(work,
 			struct goodix_ts_data, work_i2c_poll);
 
+	ts->irq_time = ktime_get();
 	goodix_process_events(ts);
 	goodix_i2c_write_u8(ts->client, GOODIX_READ_COOR_ADDR, 0);
 }
@@ -566,7 +591,8 @@ static int goodix_request_irq(struct goodix_ts_data *ts)
 {
 	if (ts->client->irq) {
 		return devm_request_threaded_irq(&ts->client->dev, ts->client->irq,
-						 NULL, goodix_ts_irq_handler,
+						 goodix_ts_hardirq,
+						 goodix_ts_irq_handler,
 						 ts->irq_flags, ts->client->name, ts);
 	} else {
 		INIT_WORK(&ts->work_i2c_poll,
@@ -6,6 +6,7 @@
  */
 
 #include <linux/cpu.h>
+#include <linux/moduleparam.h>
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/irqchip.h>
@@ -22,6 +23,13 @@ struct bcm2836_arm_irqchip_intc {
 
 static struct bcm2836_arm_irqchip_intc intc  __read_mostly;
 
+/*
+ * All the GPU peripheral interrupts are routed to one core together, so
+ * this is as close to per interrupt affinity as the hardware gets. -1
+ * leaves the routing to the default policy.
+ */
+static int gpu_irq_cpu __read_mostly = -1;
+
 void __iomem *arm_local_intc;
 EXPORT_SYMBOL_GPL(arm_local_intc);
 
@@ -87,14 +95,87 @@ static void bcm2836_arm_irqchip_unmask_gpu_irq(struct irq_data *d)
 {
 }
 
+#ifdef CONFIG_SMP
+/* Bits 1:0 pick the core taking the GPU IRQ, the FIQ routing is kept */
+static void bcm2836_arm_irqchip_route_gpu_irq(unsigned int cpu)
+{
+	void __iomem *gpurouting = intc.base + LOCAL_GPU_ROUTING;
+
+	writel((readl(gpurouting) & ~0x3) | cpu, gpurouting);
+}
+
+/*
+ * Pinning the GPU IRQ moves every interrupt of the bcm2835 controller
+ * chained behind it, and stops the round robin done on arm64.
+ */
+static int bcm2836_arm_irqchip_set_gpu_irq_affinity(struct irq_data *d,
+						    const struct cpumask *mask,
+						    bool force)
+{
+	unsigned int cpu;
+
+	if (force)
+		cpu = cpumask_first(mask);
+	else
+		cpu = cpumask_first_and(mask, cpu_online_mask);
+	if (cpu > 3 || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	WRITE_ONCE(gpu_irq_cpu, cpu);
+	bcm2836_arm_irqchip_route_gpu_irq(cpu);
+	irq_data_update_effective_affinity(d, cpumask_of(cpu));
+
+	return IRQ_SET_MASK_OK_DONE;
+}
+
+static int bcm2836_gpu_irq_cpu_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	int cpu, ret;
+
+	ret = kstrtoint(val, 0, &cpu);
+	if (ret)
+		return ret;
+	if (cpu < -1 || cpu > 3 || cpu >= (int)nr_cpu_ids)
+		return -EINVAL;
+
+	cpus_read_lock();
+	WRITE_ONCE(gpu_irq_cpu, cpu);
+	/* an offline core gets it from bcm2836_cpu_starting() */
+	if (cpu >= 0 && intc.base && cpu_online(cpu))
+		bcm2836_arm_irqchip_route_gpu_irq(cpu);
+	cpus_read_unlock();
+
+	return 0;
+}
+
+static const struct kernel_param_ops bcm2836_gpu_irq_cpu_ops = {
+	.set	= bcm2836_gpu_irq_cpu_set,
+	.get	= param_get_int,
+};
+
+/*
+ * Runtime counterpart of bcm2836_gpu_irq_cpu=, e.g. to move the audio
+ * and USB interrupt load off the core doing the housekeeping. -1 gives
+ * the routing back to the default policy.
+ */
+module_param_cb(gpu_irq_cpu, &bcm2836_gpu_irq_cpu_ops, &gpu_irq_cpu, 0644);
+MODULE_PARM_DESC(gpu_irq_cpu, "Core taking the GPU IRQs (-1 = default)");
+#endif
+
 #ifdef CONFIG_ARM64
 
 void bcm2836_arm_irqchip_spin_gpu_irq(void)
 {
 	u32 i;
 	void __iomem *gpurouting = (intc.base + LOCAL_GPU_ROUTING);
-	u32 routing_val = readl(gpurouting);
+	u32 routing_val;
+	int cpu = READ_ONCE(gpu_irq_cpu);
 
+	if (cpu >= 0 && cpu_active(cpu))
+		return;
+
+	routing_val = readl(gpurouting);
 	for (i = 1; i <= 3; i++) {
 		u32 new_routing_val = (routing_val + i) & 3;
 
@@ -112,6 +193,9 @@ static struct irq_chip bcm2836_arm_irqchip_gpu = {
 	.name		= "bcm2836-gpu",
 	.irq_mask	= bcm2836_arm_irqchip_mask_gpu_irq,
 	.irq_unmask	= bcm2836_arm_irqchip_unmask_gpu_irq,
+#ifdef CONFIG_SMP
+	.irq_set_affinity = bcm2836_arm_irqchip_set_gpu_irq_affinity,
+#endif
 };
 
 static void bcm2836_arm_irqchip_dummy_op(struct irq_data *d)
@@ -252,10 +336,27 @@ static const struct irq_domain_ops ipi_domain_ops = {
 	.free	= bcm2836_arm_irqchip_ipi_free,
 };
 
+static int __init bcm2836_gpu_irq_cpu_setup(char *str)
+{
+	int cpu, ret;
+
+	ret = kstrtoint(str, 0, &cpu);
+	if (ret)
+		return ret;
+	if (cpu < 0 || cpu > 3 || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	gpu_irq_cpu = cpu;
+	return 0;
+}
+early_param("bcm2836_gpu_irq_cpu", bcm2836_gpu_irq_cpu_setup);
+
 static int bcm2836_cpu_starting(unsigned int cpu)
 {
 	bcm2836_arm_irqchip_unmask_per_cpu_irq(LOCAL_MAILBOX_INT_CONTROL0, 0,
 					       cpu);
+	if (cpu == gpu_irq_cpu)
+		bcm2836_arm_irqchip_route_gpu_irq(cpu);
 	return 0;
 }
 
@@ -263,6 +364,9 @@ static int bcm2836_cpu_dying(unsigned int cpu)
 {
 	bcm2836_arm_irqchip_mask_per_cpu_irq(LOCAL_MAILBOX_INT_CONTROL0, 0,
 					     cpu);
+	if ((readl(intc.base + LOCAL_GPU_ROUTING) & 0x3) == cpu)
+		bcm2836_arm_irqchip_route_gpu_irq(
+			cpumask_any_but(cpu_online_mask, cpu));
 	return 0;
 }
 
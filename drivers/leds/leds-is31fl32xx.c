@@ -24,6 +24,9 @@
 #define IS31FL32XX_SHUTDOWN_SSD_ENABLE  0
 #define IS31FL32XX_SHUTDOWN_SSD_DISABLE BIT(0)
 
+/* Largest channel count of any supported chip */
+#define IS31FL32XX_MAX_CHANNELS 36
+
 /* IS31FL3216 has a number of unique registers */
 #define IS31FL3216_CONFIG_REG 0x00
 #define IS31FL3216_LIGHTING_EFFECT_REG 0x03
@@ -246,6 +249,85 @@ static int is31fl32xx_brightness_set(struct led_classdev *led_cdev,
 	return is31fl32xx_write(led_data->priv, cdef->pwm_update_reg, 0);
 }
 
+/*
+ * Write the brightness of every channel in one auto-incrementing I2C
+ * transfer starting at the first PWM register, followed by a single
+ * Update register write, so that a complete frame is latched at once.
+ * @frame holds one byte per channel, in channel order.
+ */
+static int is31fl32xx_frame_set(struct is31fl32xx_priv *priv, const u8 *frame)
+{
+	const struct is31fl32xx_chipdef *cdef = priv->cdef;
+	u8 buf[IS31FL32XX_MAX_CHANNELS + 1];
+	unsigned int i;
+	int ret;
+
+	buf[0] = cdef->pwm_register_base;
+	for (i = 0; i < cdef->channels; i++) {
+		if (cdef->pwm_registers_reversed)
+			buf[cdef->channels - i] = frame[i];
+		else
+			buf[i + 1] = frame[i];
+	}
+
+	ret = i2c_master_send(priv->client, buf, cdef->channels + 1);
+	if (ret < 0) {
+		dev_err(&priv->client->dev,
+			"frame write to 0x%02X failed (error %d)",
+			buf[0], ret);
+		return ret;
+	}
+
+	ret = is31fl32xx_write(priv, cdef->pwm_update_reg, 0);
+	if (ret)
+		return ret;
+
+	/* Keep the LED class view of each registered channel in sync */
+	for (i = 0; i < priv->num_leds; i++)
+		priv->leds[i].cdev.brightness =
+			frame[priv->leds[i].channel - 1];
+
+	return 0;
+}
+
+/*
+ * The "frame" attribute of the controller takes the brightness of all
+ * channels in a single write, for animations across the whole array
+ * that would otherwise cost two register writes per LED.
+ */
+static ssize_t frame_write(struct file *filp, struct kobject *kobj,
+			   struct bin_attribute *attr, char *buf,
+			   loff_t off, size_t count)
+{
+	struct device *dev = kobj_to_dev(kobj);
+	struct is31fl32xx_priv *priv = dev_get_drvdata(dev);
+	int ret;
+
+	if (off || count != priv->cdef->channels)
+		return -EINVAL;
+
+	ret = is31fl32xx_frame_set(priv, buf);
+	if (ret)
+		return ret;
+
+	return count;
+}
+static BIN_ATTR_WO(frame, 0);
+
+static struct bin_attribute *is31fl32xx_bin_attrs[] = {
+	&bin_attr_frame,
+	NULL,
+};
+
+static const struct attribute_group is31fl32xx_group = {
+	.bin_attrs = is31fl32xx_bin_attrs,
+};
+
+static const struct attribute_group *is31fl32xx_groups[] = {
+	&is31fl32xx_group,
+	NULL,
+};
+
 static int is31fl32xx_reset_regs(struct is31fl32xx_priv *priv)
 {
 	const struct is31fl32xx_chipdef *cdef = priv->cdef;
@@ -488,6 +570,7 @@ static struct i2c_driver is31fl32xx_driver = {
 	.driver = {
 		.name	= "is31fl32xx",
 		.of_match_table = of_is31fl32xx_match,
+		.dev_groups = is31fl32xx_groups,
 	},
 	.probe		= is31fl32xx_probe,
 	.remove		= is31fl32xx_remove,
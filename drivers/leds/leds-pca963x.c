@@ -47,6 +47,11 @@
 #define PCA963X_MODE2		0x01
 #define PCA963X_PWM_BASE	0x02
 
+/* Control register flag: auto-increment the register pointer */
+#define PCA963X_AUTO_INC	0x80
+
+#define PCA963X_MAX_LEDS	16
+
 enum pca963x_type {
 	pca9633,
 	pca9634,
@@ -111,6 +116,7 @@ struct pca963x {
 	struct mutex mutex;
 	struct i2c_client *client;
 	unsigned long leds_on;
+	int num_leds;
 	struct pca963x_led leds[];
 };
 
@@ -236,6 +242,103 @@ static int pca963x_led_set(struct led_classdev *led_cdev,
 	return ret;
 }
 
+/*
+ * Program the PWM and LED output registers of every channel from @frame,
+ * one byte per channel, using two auto-incrementing I2C transfers.
+ */
+static int pca963x_frame_set(struct pca963x *chip, const u8 *frame)
+{
+	struct pca963x_chipdef *chipdef = chip->chipdef;
+	struct i2c_client *client = chip->client;
+	u8 buf[PCA963X_MAX_LEDS + 1];
+	unsigned long cached_leds;
+	int i, ret;
+
+	mutex_lock(&chip->mutex);
+
+	cached_leds = chip->leds_on;
+
+	buf[0] = PCA963X_AUTO_INC | PCA963X_PWM_BASE;
+	memcpy(&buf[1], frame, chipdef->n_leds);
+	ret = i2c_master_send(client, buf, chipdef->n_leds + 1);
+	if (ret < 0)
+		goto unlock;
+
+	buf[0] = PCA963X_AUTO_INC | chipdef->ledout_base;
+	memset(&buf[1], 0, chipdef->n_leds / 4);
+	for (i = 0; i < chipdef->n_leds; i++) {
+		if (frame[i]) {
+			buf[1 + i / 4] |= PCA963X_LED_PWM << (2 * (i % 4));
+			set_bit(i, &chip->leds_on);
+		} else {
+			clear_bit(i, &chip->leds_on);
+		}
+	}
+
+	for (i = 0; i < chip->num_leds; i++) {
+		struct pca963x_led *led = &chip->leds[i];
+		int num = led->led_num;
+		int shift = 2 * (num % 4);
+
+		if (!frame[num])
+			led->blinking = false;
+		else if (led->blinking)
+			buf[1 + num / 4] |= PCA963X_LED_GRP_PWM << shift;
+		led->led_cdev.brightness = frame[num];
+	}
+
+	ret = i2c_master_send(client, buf, chipdef->n_leds / 4 + 1);
+	if (ret < 0)
+		goto unlock;
+
+	ret = 0;
+	if (!chip->leds_on != !cached_leds)
+		ret = i2c_smbus_write_byte_data(client, PCA963X_MODE1,
+						chip->leds_on ? 0 : BIT(4));
+
+unlock:
+	mutex_unlock(&chip->mutex);
+	return ret;
+}
+
+/*
+ * The "frame" attribute of the controller takes the brightness of all
+ * channels in a single write, so the whole chip is updated in one go
+ * instead of a read-modify-write sequence per LED.
+ */
+static ssize_t frame_write(struct file *filp, struct kobject *kobj,
+			   struct bin_attribute *attr, char *buf,
+			   loff_t off, size_t count)
+{
+	struct device *dev = kobj_to_dev(kobj);
+	struct pca963x *chip = dev_get_drvdata(dev);
+	int ret;
+
+	if (off || count != chip->chipdef->n_leds)
+		return -EINVAL;
+
+	ret = pca963x_frame_set(chip, buf);
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+static BIN_ATTR_WO(frame, 0);
+
+static struct bin_attribute *pca963x_bin_attrs[] = {
+	&bin_attr_frame,
+	NULL,
+};
+
+static const struct attribute_group pca963x_group = {
+	.bin_attrs = pca963x_bin_attrs,
+};
+
+static const struct attribute_group *pca963x_groups[] = {
+	&pca963x_group,
+	NULL,
+};
+
 static unsigned int pca963x_period_scale(struct pca963x_led *led,
 					 unsigned int val)
 {
@@ -372,6 +475,7 @@ static int pca963x_register_leds(struct i2c_client *client,
 		}
 
 		++led;
+		++chip->num_leds;
 	}
 
 	return 0;
@@ -430,6 +534,7 @@ static struct i2c_driver pca963x_driver = {
 	.driver = {
 		.name	= "leds-pca963x",
 		.of_match_table = of_pca963x_match,
+		.dev_groups = pca963x_groups,
 	},
 	.probe	= pca963x_probe,
 	.id_table = pca963x_id,
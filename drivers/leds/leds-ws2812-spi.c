@@ -0,0 +1,353 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * WS2812 addressable RGB LED strip driver using an SPI serialiser
+ *
+ * The single-wire WS2812 protocol is generated on MOSI at 2.4 MHz, three
+ * SPI bits per data bit (0b100 for a '0', 0b110 for a '1'), so the SPI
+ * controller's DMA engine clocks out the whole strip without any CPU
+ * bit timing. A strip frame is followed by enough low bits to latch it.
+ *
+ * The encoded frame is double buffered: LED updates are coalesced into
+ * the idle buffer while the previous frame is still on the wire, and
+ * the next frame is submitted from the completion of the previous one.
+ */
+
+#include <linux/leds.h>
+#include <linux/led-class-multicolor.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/property.h>
+#include <linux/slab.h>
+#include <linux/spi/spi.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#define WS2812_SPI_HZ		2400000
+#define WS2812_NUM_COLORS	3
+/* SPI bytes needed to encode one colour byte */
+#define WS2812_BYTES_PER_COLOR	3
+#define WS2812_BYTES_PER_LED	(WS2812_NUM_COLORS * WS2812_BYTES_PER_COLOR)
+/* at least 280us of low level latches the frame, 300us at 2.4 MHz */
+#define WS2812_RESET_BYTES	90
+#define WS2812_MAX_LEDS		1024
+
+#define WS2812_DEV_NAME		"ws2812"
+
+struct ws2812;
+
+struct ws2812_led {
+	struct ws2812		*priv;
+	struct led_classdev_mc	mc_cdev;
+	struct mc_subled	subled_info[WS2812_NUM_COLORS];
+	u32			reg;
+};
+
+struct ws2812 {
+	struct spi_device	*spi;
+	spinlock_t		lock;		/* protects the fields below */
+	struct work_struct	work;
+	wait_queue_head_t	idle;
+	struct spi_message	msg;
+	struct spi_transfer	xfer;
+	u8			*buf[2];
+	unsigned int		back;		/* buffer not on the wire */
+	size_t			len;
+	bool			dirty;		/* colours changed */
+	bool			pending;	/* back buffer is ready */
+	bool			busy;		/* a transfer is in flight */
+	unsigned int		chain_len;
+	u8			(*colors)[WS2812_NUM_COLORS];	/* R, G, B */
+	struct ws2812_led	leds[];
+};
+
+static void ws2812_encode_color(u8 *p, u8 val)
+{
+	u32 bits = 0;
+	int i;
+
+	for (i = 7; i >= 0; i--)
+		bits = (bits << 3) | ((val & BIT(i)) ? 0x6 : 0x4);
+
+	p[0] = bits >> 16;
+	p[1] = bits >> 8;
+	p[2] = bits;
+}
+
+static void ws2812_encode_frame(struct ws2812 *priv, u8 *buf)
+{
+	unsigned int i;
+
+	/* the strip expects the colours of each LED in G, R, B order */
+	for (i = 0; i < priv->chain_len; i++, buf += WS2812_BYTES_PER_LED) {
+		ws2812_encode_color(buf, priv->colors[i][1]);
+		ws2812_encode_color(buf + 3, priv->colors[i][0]);
+		ws2812_encode_color(buf + 6, priv->colors[i][2]);
+	}
+}
+
+static void ws2812_complete(void *context);
+
+/* call with priv->lock held */
+static void ws2812_submit(struct ws2812 *priv)
+{
+	int ret;
+
+	priv->xfer.tx_buf = priv->buf[priv->back];
+	priv->back ^= 1;
+	priv->pending = false;
+	priv->busy = true;
+
+	spi_message_init_with_transfers(&priv->msg, &priv->xfer, 1);
+	priv->msg.complete = ws2812_complete;
+	priv->msg.context = priv;
+
+	ret = spi_async(priv->spi, &priv->msg);
+	if (ret) {
+		dev_err_ratelimited(&priv->spi->dev,
+				    "frame transfer failed %d\n", ret);
+		priv->busy = false;
+		wake_up(&priv->idle);
+	}
+}
+
+static void ws2812_complete(void *context)
+{
+	struct ws2812 *priv = context;
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	priv->busy = false;
+	if (priv->pending)
+		ws2812_submit(priv);
+	if (!priv->busy)
+		wake_up(&priv->idle);
+	spin_unlock_irqrestore(&priv->lock, flags);
+}
+
+static void ws2812_work(struct work_struct *work)
+{
+	struct ws2812 *priv = container_of(work, struct ws2812, work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (priv->dirty) {
+		priv->dirty = false;
+		ws2812_encode_frame(priv, priv->buf[priv->back]);
+		priv->pending = true;
+		if (!priv->busy)
+			ws2812_submit(priv);
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+}
+
+static void ws2812_brightness_set(struct led_classdev *cdev,
+				  enum led_brightness brightness)
+{
+	struct led_classdev_mc *mc_cdev = lcdev_to_mccdev(cdev);
+	struct ws2812_led *led = container_of(mc_cdev, struct ws2812_led,
+					      mc_cdev);
+	struct ws2812 *priv = led->priv;
+	unsigned long flags;
+	int i;
+
+	led_mc_calc_color_components(mc_cdev, brightness);
+
+	spin_lock_irqsave(&priv->lock, flags);
+	for (i = 0; i < WS2812_NUM_COLORS; i++)
+		priv->colors[led->reg][i] = mc_cdev->subled_info[i].brightness;
+	priv->dirty = true;
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	schedule_work(&priv->work);
+}
+
+/*
+ * The "frame" attribute of the strip takes R, G, B bytes for every LED
+ * in chain order and sends them as a single frame, for animations that
+ * would otherwise cost one LED class write per LED.
+ */
+static ssize_t frame_write(struct file *filp, struct kobject *kobj,
+			   struct bin_attribute *attr, char *buf,
+			   loff_t off, size_t count)
+{
+	struct device *dev = kobj_to_dev(kobj);
+	struct ws2812 *priv = dev_get_drvdata(dev);
+	unsigned long flags;
+
+	if (off || count != priv->chain_len * WS2812_NUM_COLORS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	memcpy(priv->colors, buf, count);
+	priv->dirty = true;
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	schedule_work(&priv->work);
+
+	return count;
+}
+static BIN_ATTR_WO(frame, 0);
+
+static struct bin_attribute *ws2812_bin_attrs[] = {
+	&bin_attr_frame,
+	NULL,
+};
+
+static const struct attribute_group ws2812_group = {
+	.bin_attrs = ws2812_bin_attrs,
+};
+
+static const struct attribute_group *ws2812_groups[] = {
+	&ws2812_group,
+	NULL,
+};
+
+static int ws2812_register_led(struct ws2812 *priv, struct ws2812_led *led,
+			       struct fwnode_handle *child)
+{
+	struct led_init_data init_data = {};
+	struct led_classdev *cdev;
+	int ret;
+
+	led->priv = priv;
+	led->subled_info[0].color_index = LED_COLOR_ID_RED;
+	led->subled_info[0].channel = 0;
+	led->subled_info[1].color_index = LED_COLOR_ID_GREEN;
+	led->subled_info[1].channel = 1;
+	led->subled_info[2].color_index = LED_COLOR_ID_BLUE;
+	led->subled_info[2].channel = 2;
+
+	led->mc_cdev.subled_info = led->subled_info;
+	led->mc_cdev.num_colors = WS2812_NUM_COLORS;
+
+	cdev = &led->mc_cdev.led_cdev;
+	cdev->max_brightness = 255;
+	cdev->brightness_set = ws2812_brightness_set;
+
+	init_data.fwnode = child;
+	init_data.devicename = WS2812_DEV_NAME;
+	init_data.default_label = ":";
+
+	ret = devm_led_classdev_multicolor_register_ext(&priv->spi->dev,
+							&led->mc_cdev,
+							&init_data);
+	if (ret)
+		dev_err(&priv->spi->dev, "Cannot register LED %pfw: %d\n",
+			child, ret);
+
+	return ret;
+}
+
+static void ws2812_teardown(void *data)
+{
+	struct ws2812 *priv = data;
+
+	cancel_work_sync(&priv->work);
+	wait_event(priv->idle, !READ_ONCE(priv->busy));
+}
+
+static int ws2812_probe(struct spi_device *spi)
+{
+	struct device *dev = &spi->dev;
+	struct fwnode_handle *child;
+	struct ws2812 *priv;
+	unsigned int count, i = 0;
+	u32 reg, chain_len = 0;
+	int ret;
+
+	count = device_get_child_node_count(dev);
+	if (!count) {
+		dev_err(dev, "LEDs are not defined in device tree!\n");
+		return -ENODEV;
+	}
+
+	device_for_each_child_node(dev, child) {
+		ret = fwnode_property_read_u32(child, "reg", &reg);
+		if (ret || reg >= WS2812_MAX_LEDS) {
+			dev_err(dev, "Invalid 'reg' property for node %pfw\n",
+				child);
+			fwnode_handle_put(child);
+			return -EINVAL;
+		}
+		chain_len = max(chain_len, reg + 1);
+	}
+
+	priv = devm_kzalloc(dev, struct_size(priv, leds, count), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	priv->colors = devm_kcalloc(dev, chain_len, sizeof(*priv->colors),
+				    GFP_KERNEL);
+	if (!priv->colors)
+		return -ENOMEM;
+
+	priv->len = chain_len * WS2812_BYTES_PER_LED + WS2812_RESET_BYTES;
+	for (i = 0; i < ARRAY_SIZE(priv->buf); i++) {
+		/* zeroed, so the trailing latch bytes stay low */
+		priv->buf[i] = devm_kzalloc(dev, priv->len, GFP_KERNEL);
+		if (!priv->buf[i])
+			return -ENOMEM;
+	}
+
+	priv->spi = spi;
+	priv->chain_len = chain_len;
+	priv->xfer.len = priv->len;
+	priv->xfer.speed_hz = WS2812_SPI_HZ;
+	priv->xfer.bits_per_word = 8;
+	spin_lock_init(&priv->lock);
+	init_waitqueue_head(&priv->idle);
+	INIT_WORK(&priv->work, ws2812_work);
+	spi_set_drvdata(spi, priv);
+
+	/* registered first, so it runs after the LEDs are unregistered */
+	ret = devm_add_action_or_reset(dev, ws2812_teardown, priv);
+	if (ret)
+		return ret;
+
+	/* blank the whole strip, including LEDs without a node */
+	priv->dirty = true;
+	schedule_work(&priv->work);
+
+	i = 0;
+	device_for_each_child_node(dev, child) {
+		struct ws2812_led *led = &priv->leds[i++];
+
+		fwnode_property_read_u32(child, "reg", &led->reg);
+
+		ret = ws2812_register_led(priv, led, child);
+		if (ret) {
+			fwnode_handle_put(child);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static const struct of_device_id ws2812_dt_ids[] = {
+	{ .compatible = "worldsemi,ws2812b", },
+	{},
+};
+MODULE_DEVICE_TABLE(of, ws2812_dt_ids);
+
+static const struct spi_device_id ws2812_spi_ids[] = {
+	{ "ws2812b" },
+	{},
+};
+MODULE_DEVICE_TABLE(spi, ws2812_spi_ids);
+
+static struct spi_driver ws2812_driver = {
+	.probe		= ws2812_probe,
+	.id_table	= ws2812_spi_ids,
+	.driver = {
+		.name		= KBUILD_MODNAME,
+		.of_match_table	= ws2812_dt_ids,
+		.dev_groups	= ws2812_groups,
+	},
+};
+
+module_spi_driver(ws2812_driver);
+
+MODULE_DESCRIPTION("WS2812 addressable LED strip driver over SPI");
+MODULE_LICENSE("GPL");
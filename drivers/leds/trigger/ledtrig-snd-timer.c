@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LED step trigger clocked by an ALSA timer
+ *
+ * Each LED carries a list of brightness steps and advances by one step
+ * every "ticks" ticks of an ALSA timer, e.g. a PCM period timer. LEDs
+ * that use the same timer and tick count form a group: they share one
+ * timer instance and one step counter, so they always move in lock-step
+ * with each other and with the audio clock driving the timer.
+ */
+
+#include <linux/kernel.h>
+#include <linux/leds.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <sound/core.h>
+#include <sound/timer.h>
+
+#define MAX_STEPS		64
+
+struct snd_timer_trig_group {
+	struct list_head list;		/* in snd_timer_trig_group_list */
+	struct snd_timer_id tid;
+	unsigned int ticks;
+	struct snd_timer_instance *timeri;
+	spinlock_t lock;		/* protects members and step */
+	struct list_head members;
+	unsigned long step;
+	int users;
+};
+
+struct snd_timer_trig_data {
+	struct led_classdev *led_cdev;
+	struct snd_timer_trig_group *group;
+	struct list_head node;		/* in group->members */
+	struct mutex lock;
+	struct snd_timer_id tid;
+	bool has_clock;
+	unsigned int ticks;
+	unsigned int steps[MAX_STEPS];
+	unsigned int nsteps;
+};
+
+static LIST_HEAD(snd_timer_trig_group_list);
+static DEFINE_MUTEX(snd_timer_trig_group_mutex);
+
+static void snd_timer_trig_callback(struct snd_timer_instance *timeri,
+				    unsigned long ticks,
+				    unsigned long resolution)
+{
+	struct snd_timer_trig_group *group = timeri->callback_data;
+	struct snd_timer_trig_data *data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&group->lock, flags);
+	/* account for lost ticks so the pattern never falls behind */
+	group->step += max(ticks / group->ticks, 1UL);
+	list_for_each_entry(data, &group->members, node)
+		led_set_brightness_nosleep(data->led_cdev,
+				data->steps[group->step % data->nsteps]);
+	spin_unlock_irqrestore(&group->lock, flags);
+}
+
+static bool snd_timer_trig_same_id(const struct snd_timer_id *a,
+				   const struct snd_timer_id *b)
+{
+	return a->dev_class == b->dev_class &&
+	       a->dev_sclass == b->dev_sclass &&
+	       a->card == b->card &&
+	       a->device == b->device &&
+	       a->subdevice == b->subdevice;
+}
+
+static struct snd_timer_trig_group *
+snd_timer_trig_group_get(const struct snd_timer_id *tid, unsigned int ticks)
+{
+	struct snd_timer_trig_group *group;
+	struct snd_timer_id id = *tid;
+	int err;
+
+	list_for_each_entry(group, &snd_timer_trig_group_list, list) {
+		if (group->ticks == ticks &&
+		    snd_timer_trig_same_id(&group->tid, tid)) {
+			group->users++;
+			return group;
+		}
+	}
+
+	group = kzalloc(sizeof(*group), GFP_KERNEL);
+	if (!group)
+		return ERR_PTR(-ENOMEM);
+
+	group->tid = *tid;
+	group->ticks = ticks;
+	group->users = 1;
+	spin_lock_init(&group->lock);
+	INIT_LIST_HEAD(&group->members);
+
+	group->timeri = snd_timer_instance_new("ledtrig-snd-timer");
+	if (!group->timeri) {
+		err = -ENOMEM;
+		goto error;
+	}
+	group->timeri->flags |= SNDRV_TIMER_IFLG_AUTO;
+	group->timeri->callback = snd_timer_trig_callback;
+	group->timeri->callback_data = group;
+
+	err = snd_timer_open(group->timeri, &id, 0);
+	if (err < 0) {
+		snd_timer_instance_free(group->timeri);
+		goto error;
+	}
+
+	err = snd_timer_start(group->timeri, ticks);
+	if (err < 0) {
+		snd_timer_close(group->timeri);
+		snd_timer_instance_free(group->timeri);
+		goto error;
+	}
+
+	list_add_tail(&group->list, &snd_timer_trig_group_list);
+	return group;
+
+error:
+	kfree(group);
+	return ERR_PTR(err);
+}
+
+static void snd_timer_trig_group_put(struct snd_timer_trig_group *group)
+{
+	if (--group->users)
+		return;
+
+	list_del(&group->list);
+	snd_timer_close(group->timeri);
+	snd_timer_instance_free(group->timeri);
+	kfree(group);
+}
+
+/* call with data->lock held */
+static void snd_timer_trig_leave(struct snd_timer_trig_data *data)
+{
+	struct snd_timer_trig_group *group = data->group;
+	unsigned long flags;
+
+	if (!group)
+		return;
+
+	spin_lock_irqsave(&group->lock, flags);
+	list_del(&data->node);
+	spin_unlock_irqrestore(&group->lock, flags);
+
+	mutex_lock(&snd_timer_trig_group_mutex);
+	snd_timer_trig_group_put(group);
+	mutex_unlock(&snd_timer_trig_group_mutex);
+
+	data->group = NULL;
+}
+
+/* call with data->lock held */
+static int snd_timer_trig_join(struct snd_timer_trig_data *data)
+{
+	struct snd_timer_trig_group *group;
+	unsigned long flags;
+
+	if (!data->has_clock || !data->nsteps)
+		return 0;
+
+	mutex_lock(&snd_timer_trig_group_mutex);
+	group = snd_timer_trig_group_get(&data->tid, data->ticks);
+	mutex_unlock(&snd_timer_trig_group_mutex);
+	if (IS_ERR(group))
+		return PTR_ERR(group);
+
+	spin_lock_irqsave(&group->lock, flags);
+	list_add_tail(&data->node, &group->members);
+	spin_unlock_irqrestore(&group->lock, flags);
+
+	data->group = group;
+	return 0;
+}
+
+static ssize_t clock_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+	ssize_t count;
+
+	mutex_lock(&data->lock);
+
+	if (data->has_clock)
+		count = sprintf(buf, "%d.%d.%d.%d.%d\n",
+				data->tid.dev_class, data->tid.dev_sclass,
+				data->tid.card, data->tid.device,
+				data->tid.subdevice);
+	else
+		count = sprintf(buf, "none\n");
+
+	mutex_unlock(&data->lock);
+	return count;
+}
+
+static ssize_t clock_store(struct device *dev, struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+	struct snd_timer_id tid = {};
+	bool has_clock = false;
+	int err;
+
+	if (!sysfs_streq(buf, "none")) {
+		if (sscanf(buf, "%d.%d.%d.%d.%d", &tid.dev_class,
+			   &tid.dev_sclass, &tid.card, &tid.device,
+			   &tid.subdevice) != 5)
+			return -EINVAL;
+		has_clock = true;
+	}
+
+	mutex_lock(&data->lock);
+
+	snd_timer_trig_leave(data);
+	data->tid = tid;
+	data->has_clock = has_clock;
+	err = snd_timer_trig_join(data);
+
+	mutex_unlock(&data->lock);
+	return err < 0 ? err : count;
+}
+
+static DEVICE_ATTR_RW(clock);
+
+static ssize_t ticks_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+
+	return sprintf(buf, "%u\n", data->ticks);
+}
+
+static ssize_t ticks_store(struct device *dev, struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+	unsigned int ticks;
+	int err;
+
+	err = kstrtouint(buf, 10, &ticks);
+	if (err)
+		return err;
+	if (!ticks)
+		return -EINVAL;
+
+	mutex_lock(&data->lock);
+
+	snd_timer_trig_leave(data);
+	data->ticks = ticks;
+	err = snd_timer_trig_join(data);
+
+	mutex_unlock(&data->lock);
+	return err < 0 ? err : count;
+}
+
+static DEVICE_ATTR_RW(ticks);
+
+static ssize_t steps_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+	ssize_t count = 0;
+	unsigned int i;
+
+	mutex_lock(&data->lock);
+
+	for (i = 0; i < data->nsteps; i++)
+		count += scnprintf(buf + count, PAGE_SIZE - count, "%u ",
+				   data->steps[i]);
+	if (count)
+		buf[count - 1] = '\n';
+
+	mutex_unlock(&data->lock);
+	return count;
+}
+
+static ssize_t steps_store(struct device *dev, struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+	unsigned int steps[MAX_STEPS];
+	unsigned int nsteps = 0;
+	int cr, offset = 0;
+	int err;
+
+	while (offset < count - 1 && nsteps < MAX_STEPS) {
+		cr = 0;
+		if (sscanf(buf + offset, "%u %n", &steps[nsteps], &cr) != 1 ||
+		    steps[nsteps] > led_cdev->max_brightness)
+			return -EINVAL;
+		offset += cr;
+		nsteps++;
+	}
+
+	mutex_lock(&data->lock);
+
+	snd_timer_trig_leave(data);
+	memcpy(data->steps, steps, nsteps * sizeof(*steps));
+	data->nsteps = nsteps;
+	err = snd_timer_trig_join(data);
+
+	mutex_unlock(&data->lock);
+	return err < 0 ? err : count;
+}
+
+static DEVICE_ATTR_RW(steps);
+
+static struct attribute *snd_timer_trig_attrs[] = {
+	&dev_attr_clock.attr,
+	&dev_attr_ticks.attr,
+	&dev_attr_steps.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(snd_timer_trig);
+
+static int snd_timer_trig_activate(struct led_classdev *led_cdev)
+{
+	struct snd_timer_trig_data *data;
+
+	data = kzalloc(sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	mutex_init(&data->lock);
+	data->led_cdev = led_cdev;
+	data->ticks = 1;
+	led_set_trigger_data(led_cdev, data);
+
+	return 0;
+}
+
+static void snd_timer_trig_deactivate(struct led_classdev *led_cdev)
+{
+	struct snd_timer_trig_data *data = led_cdev->trigger_data;
+
+	mutex_lock(&data->lock);
+	snd_timer_trig_leave(data);
+	mutex_unlock(&data->lock);
+
+	led_set_brightness(led_cdev, LED_OFF);
+	kfree(data);
+}
+
+static struct led_trigger snd_timer_led_trigger = {
+	.name = "snd-timer",
+	.activate = snd_timer_trig_activate,
+	.deactivate = snd_timer_trig_deactivate,
+	.groups = snd_timer_trig_groups,
+};
+
+module_led_trigger(snd_timer_led_trigger);
+
+MODULE_DESCRIPTION("LED step trigger clocked by an ALSA timer");
+MODULE_LICENSE("GPL");
@@ -496,7 +496,11 @@ struct imx219 {
 	/* V4L2 Controls */
 	struct v4l2_ctrl *pixel_rate;
 	struct v4l2_ctrl *link_freq;
-	struct v4l2_ctrl *exposure;
+	struct {
+		struct v4l2_ctrl *exposure;
+		struct v4l2_ctrl *again;
+		struct v4l2_ctrl *dgain;
+	};
 	struct v4l2_ctrl *vflip;
 	struct v4l2_ctrl *hflip;
 	struct v4l2_ctrl *vblank;
@@ -570,6 +574,28 @@ static int imx219_write_reg(struct imx219 *imx219, u16 reg, u32 len, u32 val)
 	return 0;
 }
 
+/*
+ * The analogue gain, digital gain and exposure registers are consecutive, so
+ * a single write updates all of them and they take effect on the same frame.
+ */
+static int imx219_write_exposure_gain(struct imx219 *imx219, int rate_factor)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx219->sd);
+	u8 buf[7];
+
+	BUILD_BUG_ON(IMX219_REG_DIGITAL_GAIN != IMX219_REG_ANALOG_GAIN + 1);
+	BUILD_BUG_ON(IMX219_REG_EXPOSURE != IMX219_REG_DIGITAL_GAIN + 2);
+
+	put_unaligned_be16(IMX219_REG_ANALOG_GAIN, buf);
+	buf[2] = imx219->again->val;
+	put_unaligned_be16(imx219->dgain->val, buf + 3);
+	put_unaligned_be16(imx219->exposure->val / rate_factor, buf + 5);
+	if (i2c_master_send(client, buf, sizeof(buf)) != sizeof(buf))
+		return -EIO;
+
+	return 0;
+}
+
 /* Write a list of registers */
 static int imx219_write_regs(struct imx219 *imx219,
 			     const struct imx219_reg *regs, u32 len)
@@ -736,18 +762,9 @@ static int imx219_set_ctrl(struct v4l2_ctrl *ctrl)
 		return rate_factor;
 
 	switch (ctrl->id) {
-	case V4L2_CID_ANALOGUE_GAIN:
-		ret = imx219_write_reg(imx219, IMX219_REG_ANALOG_GAIN,
-				       IMX219_REG_VALUE_08BIT, ctrl->val);
-		break;
 	case V4L2_CID_EXPOSURE:
-		ret = imx219_write_reg(imx219, IMX219_REG_EXPOSURE,
-				       IMX219_REG_VALUE_16BIT,
-				       ctrl->val / rate_factor);
-		break;
-	case V4L2_CID_DIGITAL_GAIN:
-		ret = imx219_write_reg(imx219, IMX219_REG_DIGITAL_GAIN,
-				       IMX219_REG_VALUE_16BIT, ctrl->val);
+		/* Cluster master, for the gains as well */
+		ret = imx219_write_exposure_gain(imx219, rate_factor);
 		break;
 	case V4L2_CID_TEST_PATTERN:
 		ret = imx219_write_reg(imx219, IMX219_REG_TEST_PATTERN,
@@ -1443,13 +1460,20 @@ static int imx219_init_controls(struct imx219 *imx219)
 					     IMX219_EXPOSURE_STEP,
 					     exposure_def);
 
-	v4l2_ctrl_new_std(ctrl_hdlr, &imx219_ctrl_ops, V4L2_CID_ANALOGUE_GAIN,
-			  IMX219_ANA_GAIN_MIN, IMX219_ANA_GAIN_MAX,
-			  IMX219_ANA_GAIN_STEP, IMX219_ANA_GAIN_DEFAULT);
-
-	v4l2_ctrl_new_std(ctrl_hdlr, &imx219_ctrl_ops, V4L2_CID_DIGITAL_GAIN,
-			  IMX219_DGTL_GAIN_MIN, IMX219_DGTL_GAIN_MAX,
-			  IMX219_DGTL_GAIN_STEP, IMX219_DGTL_GAIN_DEFAULT);
+	imx219->again = v4l2_ctrl_new_std(ctrl_hdlr, &imx219_ctrl_ops,
+					  V4L2_CID_ANALOGUE_GAIN,
+					  IMX219_ANA_GAIN_MIN,
+					  IMX219_ANA_GAIN_MAX,
+					  IMX219_ANA_GAIN_STEP,
+					  IMX219_ANA_GAIN_DEFAULT);
+
+	imx219->dgain = v4l2_ctrl_new_std(ctrl_hdlr, &imx219_ctrl_ops,
+					  V4L2_CID_DIGITAL_GAIN,
+					  IMX219_DGTL_GAIN_MIN,
+					  IMX219_DGTL_GAIN_MAX,
+					  IMX219_DGTL_GAIN_STEP,
+					  IMX219_DGTL_GAIN_DEFAULT);
+	v4l2_ctrl_cluster(3, &imx219->exposure);
 
 	imx219->hflip = v4l2_ctrl_new_std(ctrl_hdlr, &imx219_ctrl_ops,
 					  V4L2_CID_HFLIP, 0, 1, 1, 0);
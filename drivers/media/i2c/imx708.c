@@ -39,6 +39,8 @@ MODULE_PARM_DESC(qbc_adjust, "Quad Bayer broken line correction strength [0,2-5]
 #define IMX708_MODE_STANDBY		0x00
 #define IMX708_MODE_STREAMING		0x01
 
+#define IMX708_REG_HOLD			0x0104
+
 #define IMX708_REG_ORIENTATION		0x101
 
 #define IMX708_INCLK_FREQ		24000000
@@ -837,7 +839,11 @@ struct imx708 {
 	struct v4l2_ctrl_handler ctrl_handler;
 	/* V4L2 Controls */
 	struct v4l2_ctrl *pixel_rate;
-	struct v4l2_ctrl *exposure;
+	struct {
+		struct v4l2_ctrl *exposure;
+		struct v4l2_ctrl *again;
+		struct v4l2_ctrl *dgain;
+	};
 	struct v4l2_ctrl *vblank;
 	struct v4l2_ctrl *hblank;
 	struct v4l2_ctrl *hdr_mode;
@@ -1085,6 +1091,32 @@ static int imx708_set_analogue_gain(struct imx708 *imx708, unsigned int val)
 	return ret;
 }
 
+/*
+ * Write the per-frame exposure settings under the grouped parameter hold,
+ * so that the sensor applies them all on the same frame.
+ */
+static int imx708_set_exposure_gain(struct imx708 *imx708)
+{
+	int ret;
+
+	ret = imx708_write_reg(imx708, IMX708_REG_HOLD,
+			       IMX708_REG_VALUE_08BIT, 1);
+	if (ret)
+		return ret;
+
+	ret = imx708_set_exposure(imx708, imx708->exposure->val);
+	if (!ret)
+		ret = imx708_set_analogue_gain(imx708, imx708->again->val);
+	if (!ret)
+		ret = imx708_write_reg(imx708, IMX708_REG_DIGITAL_GAIN,
+				       IMX708_REG_VALUE_16BIT,
+				       imx708->dgain->val);
+
+	imx708_write_reg(imx708, IMX708_REG_HOLD, IMX708_REG_VALUE_08BIT, 0);
+
+	return ret;
+}
+
 static int imx708_set_frame_length(struct imx708 *imx708, unsigned int val)
 {
 	int ret;
@@ -1174,15 +1206,9 @@ static int imx708_set_ctrl(struct v4l2_ctrl *ctrl)
 		return 0;
 
 	switch (ctrl->id) {
-	case V4L2_CID_ANALOGUE_GAIN:
-		imx708_set_analogue_gain(imx708, ctrl->val);
-		break;
 	case V4L2_CID_EXPOSURE:
-		ret = imx708_set_exposure(imx708, ctrl->val);
-		break;
-	case V4L2_CID_DIGITAL_GAIN:
-		ret = imx708_write_reg(imx708, IMX708_REG_DIGITAL_GAIN,
-				       IMX708_REG_VALUE_16BIT, ctrl->val);
+		/* Cluster master, for the gains as well */
+		ret = imx708_set_exposure_gain(imx708);
 		break;
 	case V4L2_CID_TEST_PATTERN:
 		ret = imx708_write_reg(imx708, IMX708_REG_TEST_PATTERN,
@@ -1838,13 +1864,20 @@ static int imx708_init_controls(struct imx708 *imx708)
 					     IMX708_EXPOSURE_STEP,
 					     IMX708_EXPOSURE_DEFAULT);
 
-	v4l2_ctrl_new_std(ctrl_hdlr, &imx708_ctrl_ops, V4L2_CID_ANALOGUE_GAIN,
-			  IMX708_ANA_GAIN_MIN, IMX708_ANA_GAIN_MAX,
-			  IMX708_ANA_GAIN_STEP, IMX708_ANA_GAIN_DEFAULT);
-
-	v4l2_ctrl_new_std(ctrl_hdlr, &imx708_ctrl_ops, V4L2_CID_DIGITAL_GAIN,
-			  IMX708_DGTL_GAIN_MIN, IMX708_DGTL_GAIN_MAX,
-			  IMX708_DGTL_GAIN_STEP, IMX708_DGTL_GAIN_DEFAULT);
+	imx708->again = v4l2_ctrl_new_std(ctrl_hdlr, &imx708_ctrl_ops,
+					  V4L2_CID_ANALOGUE_GAIN,
+					  IMX708_ANA_GAIN_MIN,
+					  IMX708_ANA_GAIN_MAX,
+					  IMX708_ANA_GAIN_STEP,
+					  IMX708_ANA_GAIN_DEFAULT);
+
+	imx708->dgain = v4l2_ctrl_new_std(ctrl_hdlr, &imx708_ctrl_ops,
+					  V4L2_CID_DIGITAL_GAIN,
+					  IMX708_DGTL_GAIN_MIN,
+					  IMX708_DGTL_GAIN_MAX,
+					  IMX708_DGTL_GAIN_STEP,
+					  IMX708_DGTL_GAIN_DEFAULT);
+	v4l2_ctrl_cluster(3, &imx708->exposure);
 
 	imx708->hflip = v4l2_ctrl_new_std(ctrl_hdlr, &imx708_ctrl_ops,
 					  V4L2_CID_HFLIP, 0, 1, 1, 0);
@@ -11,7 +11,10 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-resv.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
@@ -23,6 +26,7 @@
 #include <linux/pinctrl/consumer.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/rp1_cfe.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
@@ -53,6 +57,11 @@ bool cfe_debug_verbose;
 module_param_named(verbose_debug, cfe_debug_verbose, bool, 0644);
 MODULE_PARM_DESC(verbose_debug, "verbose debugging messages");
 
+static bool stats_only;
+module_param(stats_only, bool, 0644);
+MODULE_PARM_DESC(stats_only,
+		 "Run the Frontend for statistics when its image outputs have no buffer");
+
 #define cfe_dbg_verbose(fmt, arg...)                          \
 	do {                                                  \
 		if (cfe_debug_verbose)                        \
@@ -218,6 +227,8 @@ static const struct node_description node_desc[NUM_NODES] = {
 struct cfe_buffer {
 	struct vb2_v4l2_buffer vb;
 	struct list_head list;
+	/* Signalled when the frame is complete, for imported dma-bufs */
+	struct dma_fence *fence;
 };
 
 struct cfe_config_buffer {
@@ -255,6 +266,10 @@ struct cfe_node {
 	/* Pointer to the parent handle */
 	struct cfe_device *cfe;
 	struct media_pad pad;
+	/* Timeline of the buffer fences */
+	spinlock_t fence_lock;
+	u64 fence_context;
+	unsigned int fence_seqno;
 };
 
 struct cfe_device {
@@ -546,7 +561,8 @@ static void cfe_schedule_next_pisp_job(struct cfe_device *cfe)
 	for (i = CSI2_NUM_CHANNELS; i < NUM_NODES; i++) {
 		struct cfe_node *node = &cfe->node[i];
 
-		if (!check_state(cfe, NODE_STREAMING, i))
+		if (!check_state(cfe, NODE_STREAMING, i) ||
+		    list_empty(&node->dma_queue))
 			continue;
 
 		buf = list_first_entry(&node->dma_queue, struct cfe_buffer,
@@ -564,6 +580,17 @@ static void cfe_schedule_next_pisp_job(struct cfe_device *cfe)
 	pisp_fe_submit_job(&cfe->fe, vb2_bufs, &config_buf->config);
 }
 
+/*
+ * With stats_only, a Frontend image output without a buffer is disabled for
+ * that frame rather than holding up the statistics, so 3A keeps going on
+ * every frame regardless of how many image buffers userspace has queued.
+ */
+static bool cfe_node_optional(struct cfe_device *cfe, unsigned int i)
+{
+	return stats_only && (i == FE_OUT0 || i == FE_OUT1) &&
+	       check_state(cfe, NODE_ENABLED, FE_STATS);
+}
+
 static bool cfe_check_job_ready(struct cfe_device *cfe)
 {
 	unsigned int i;
@@ -571,7 +598,8 @@ static bool cfe_check_job_ready(struct cfe_device *cfe)
 	for (i = 0; i < NUM_NODES; i++) {
 		struct cfe_node *node = &cfe->node[i];
 
-		if (!check_state(cfe, NODE_ENABLED, i))
+		if (!check_state(cfe, NODE_ENABLED, i) ||
+		    cfe_node_optional(cfe, i))
 			continue;
 
 		if (list_empty(&node->dma_queue)) {
@@ -597,6 +625,77 @@ static void cfe_prepare_next_job(struct cfe_device *cfe)
 	cfe_dbg_verbose("%s: end with scheduled job\n", __func__);
 }
 
+static const char *cfe_fence_get_driver_name(struct dma_fence *fence)
+{
+	return CFE_MODULE_NAME;
+}
+
+static const char *cfe_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "capture";
+}
+
+static const struct dma_fence_ops cfe_fence_ops = {
+	.get_driver_name = cfe_fence_get_driver_name,
+	.get_timeline_name = cfe_fence_get_timeline_name,
+};
+
+static bool cfe_buffer_is_imported(struct vb2_buffer *vb)
+{
+	return vb->memory == VB2_MEMORY_DMABUF &&
+	       V4L2_TYPE_IS_CAPTURE(vb->type);
+}
+
+/*
+ * Implicit synchronisation with the other users of an imported dma-buf,
+ * such as V3D: a write fence goes into its reservation object when the
+ * buffer is queued, and is signalled when the frame is complete. Work that
+ * reads the frame can then be submitted before the buffer is dequeued.
+ * Userspace can get the fence with DMA_BUF_IOCTL_EXPORT_SYNC_FILE.
+ */
+static void cfe_buffer_add_fence(struct cfe_node *node, struct cfe_buffer *buf)
+{
+	struct vb2_buffer *vb = &buf->vb.vb2_buf;
+	struct dma_fence *fence;
+	struct dma_resv *resv;
+
+	if (!cfe_buffer_is_imported(vb))
+		return;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return;
+
+	dma_fence_init(fence, &cfe_fence_ops, &node->fence_lock,
+		       node->fence_context, ++node->fence_seqno);
+
+	resv = vb->planes[0].dbuf->resv;
+	dma_resv_lock(resv, NULL);
+	if (dma_resv_reserve_fences(resv, 1)) {
+		dma_resv_unlock(resv);
+		dma_fence_put(fence);
+		return;
+	}
+	dma_resv_add_fence(resv, fence, DMA_RESV_USAGE_WRITE);
+	dma_resv_unlock(resv);
+
+	buf->fence = fence;
+}
+
+static void cfe_buffer_done(struct cfe_buffer *buf,
+			    enum vb2_buffer_state state)
+{
+	if (buf->fence) {
+		if (state != VB2_BUF_STATE_DONE)
+			dma_fence_set_error(buf->fence, -ECANCELED);
+		dma_fence_signal(buf->fence);
+		dma_fence_put(buf->fence);
+		buf->fence = NULL;
+	}
+
+	vb2_buffer_done(&buf->vb.vb2_buf, state);
+}
+
 static void cfe_process_buffer_complete(struct cfe_node *node,
 					unsigned int sequence)
 {
@@ -606,7 +705,7 @@ static void cfe_process_buffer_complete(struct cfe_node *node,
 			node_desc[node->id].name, &node->cur_frm->vb.vb2_buf);
 
 	node->cur_frm->vb.sequence = sequence;
-	vb2_buffer_done(&node->cur_frm->vb.vb2_buf, VB2_BUF_STATE_DONE);
+	cfe_buffer_done(node->cur_frm, VB2_BUF_STATE_DONE);
 }
 
 static void cfe_queue_event_sof(struct cfe_node *node)
@@ -619,7 +718,23 @@ static void cfe_queue_event_sof(struct cfe_node *node)
 	v4l2_event_queue(&node->video_dev, &event);
 }
 
-static void cfe_sof_isr_handler(struct cfe_node *node)
+static void cfe_queue_event_lines(struct cfe_node *node)
+{
+	struct cfe_device *cfe = node->cfe;
+	struct v4l2_event event = {
+		.type = V4L2_EVENT_RP1_CFE_LINES,
+	};
+	struct rp1_cfe_event_lines *lines = (void *)event.u.data;
+
+	lines->frame_sequence = cfe->sequence;
+	lines->lines = csi2_get_lines(&cfe->csi2, node->id);
+	if (!lines->lines)
+		return;
+
+	v4l2_event_queue(&node->video_dev, &event);
+}
+
+static void cfe_sof_isr_handler(struct cfe_node *node, u64 ts)
 {
 	struct cfe_device *cfe = node->cfe;
 
@@ -630,11 +745,11 @@ static void cfe_sof_isr_handler(struct cfe_node *node)
 	node->next_frm = NULL;
 
 	/*
-	 * If this is the first node to see a frame start,  sample the
-	 * timestamp to use for all frames across all channels.
+	 * If this is the first node to see a frame start, use the time of
+	 * its interrupt for all frames across all channels.
 	 */
 	if (!test_any_node(cfe, NODE_STREAMING | FS_INT))
-		cfe->ts = ktime_get_ns();
+		cfe->ts = ts;
 
 	set_state(cfe, FS_INT, node->id);
 
@@ -678,6 +793,12 @@ static irqreturn_t cfe_isr(int irq, void *dev)
 	unsigned int i;
 	bool sof[NUM_NODES] = {0}, eof[NUM_NODES] = {0}, lci[NUM_NODES] = {0};
 	u32 sts;
+	/*
+	 * Before the status registers are read over the bus, so that the
+	 * SOF timestamp only carries the interrupt latency. It is on the
+	 * same clock as DRM vblank and ALSA system timestamps.
+	 */
+	u64 ts = ktime_get_ns();
 
 	sts = cfg_reg_read(cfe, MIPICFG_INTS);
 
@@ -720,7 +841,7 @@ static irqreturn_t cfe_isr(int irq, void *dev)
 			 * frame.
 			 */
 			if (sof[i] && !check_state(cfe, FS_INT, i)) {
-				cfe_sof_isr_handler(node);
+				cfe_sof_isr_handler(node, ts);
 				sof[i] = false;
 			}
 
@@ -742,9 +863,18 @@ static irqreturn_t cfe_isr(int irq, void *dev)
 				cfe_eof_isr_handler(node);
 			}
 
-			cfe_sof_isr_handler(node);
+			cfe_sof_isr_handler(node, ts);
 		}
 
+		/*
+		 * LE_ACK means the lines are in memory, so a consumer can get
+		 * started on them. The one that comes with FE is for the
+		 * whole frame, which is reported by the buffer itself.
+		 */
+		if (lci[i] && !eof[i] && node->cur_frm &&
+		    is_image_output_node(node))
+			cfe_queue_event_lines(node);
+
 		if (!cfe->job_queued && cfe->job_ready)
 			cfe_prepare_next_job(cfe);
 	}
@@ -874,17 +1004,21 @@ static void cfe_return_buffers(struct cfe_node *node,
 
 	cfe_dbg("%s: [%s]\n", __func__, node_desc[node->id].name);
 
+	/*
+	 * Oldest first, so that the fences of the node's timeline signal in
+	 * the order of their seqnos.
+	 */
 	spin_lock_irqsave(&cfe->state_lock, flags);
+	if (node->cur_frm)
+		cfe_buffer_done(node->cur_frm, state);
+	if (node->next_frm && node->cur_frm != node->next_frm)
+		cfe_buffer_done(node->next_frm, state);
+
 	list_for_each_entry_safe(buf, tmp, &node->dma_queue, list) {
 		list_del(&buf->list);
-		vb2_buffer_done(&buf->vb.vb2_buf, state);
+		cfe_buffer_done(buf, state);
 	}
 
-	if (node->cur_frm)
-		vb2_buffer_done(&node->cur_frm->vb.vb2_buf, state);
-	if (node->next_frm && node->cur_frm != node->next_frm)
-		vb2_buffer_done(&node->next_frm->vb.vb2_buf, state);
-
 	node->cur_frm = NULL;
 	node->next_frm = NULL;
 	spin_unlock_irqrestore(&cfe->state_lock, flags);
@@ -943,6 +1077,15 @@ static int cfe_buffer_prepare(struct vb2_buffer *vb)
 
 	vb2_set_plane_payload(&buf->vb.vb2_buf, 0, size);
 
+	/* Don't overwrite a frame that is still being read elsewhere. */
+	if (cfe_buffer_is_imported(vb)) {
+		long ret = dma_resv_wait_timeout(vb->planes[0].dbuf->resv,
+						 DMA_RESV_USAGE_READ, true,
+						 MAX_SCHEDULE_TIMEOUT);
+		if (ret < 0)
+			return ret;
+	}
+
 	if (node->id == FE_CONFIG) {
 		struct cfe_config_buffer *b = to_cfe_config_buffer(buf);
 		void *addr = vb2_plane_vaddr(vb, 0);
@@ -966,6 +1109,8 @@ static void cfe_buffer_queue(struct vb2_buffer *vb)
 	cfe_dbg_verbose("%s: [%s] buffer:%p\n", __func__,
 			node_desc[node->id].name, vb);
 
+	cfe_buffer_add_fence(node, buf);
+
 	spin_lock_irqsave(&cfe->state_lock, flags);
 
 	list_add_tail(&buf->list, &node->dma_queue);
@@ -1456,6 +1601,11 @@ static int cfe_subscribe_event(struct v4l2_fh *fh,
 			break;
 
 		return v4l2_event_subscribe(fh, sub, 2, NULL);
+	case V4L2_EVENT_RP1_CFE_LINES:
+		if (!is_csi2_node(node) || !is_image_output_node(node))
+			break;
+
+		return v4l2_event_subscribe(fh, sub, 4, NULL);
 	case V4L2_EVENT_SOURCE_CHANGE:
 		if (is_meta_input_node(node))
 			break;
@@ -1759,6 +1909,8 @@ static int cfe_register_node(struct cfe_device *cfe, int id)
 	}
 
 	INIT_LIST_HEAD(&node->dma_queue);
+	spin_lock_init(&node->fence_lock);
+	node->fence_context = dma_fence_context_alloc(1);
 
 	vdev = &node->video_dev;
 	vdev->release = cfe_node_release;
@@ -20,6 +20,10 @@ static bool csi2_track_errors;
 module_param_named(track_csi2_errors, csi2_track_errors, bool, 0);
 MODULE_PARM_DESC(track_csi2_errors, "track csi-2 errors");
 
+static unsigned int csi2_line_int_lines;
+module_param_named(line_int_lines, csi2_line_int_lines, uint, 0644);
+MODULE_PARM_DESC(line_int_lines, "lines between line count interrupts (0: a quarter of the frame)");
+
 #define csi2_dbg_verbose(fmt, arg...)                             \
 	do {                                                      \
 		if (cfe_debug_verbose)                            \
@@ -312,6 +316,17 @@ void csi2_set_buffer(struct csi2_device *csi2, unsigned int channel,
 	csi2_reg_write(csi2, CSI2_CH_ADDR0(channel), addr & 0xffffffff);
 }
 
+/* Lines of the current frame written out, as of the last LE_ACK */
+unsigned int csi2_get_lines(struct csi2_device *csi2, unsigned int channel)
+{
+	u32 dbg = csi2_reg_read(csi2, CSI2_CH_DEBUG(channel));
+
+	if (!csi2->num_lines[channel])
+		return 0;
+
+	return (dbg & 0xffff) % csi2->num_lines[channel];
+}
+
 void csi2_set_compression(struct csi2_device *csi2, unsigned int channel,
 			  enum csi2_compression_mode mode, unsigned int shift,
 			  unsigned int offset)
@@ -354,6 +369,8 @@ void csi2_start_channel(struct csi2_device *csi2, unsigned int channel,
 		int line_int_freq = height >> 2;
 
 		line_int_freq = min(max(0x80, line_int_freq), 0x3ff);
+		if (csi2_line_int_lines)
+			line_int_freq = min(csi2_line_int_lines, 0x3ffU);
 		set_field(&ctrl, line_int_freq, LC_MASK);
 		set_field(&ctrl, mode, CH_MODE_MASK);
 		csi2_reg_write(csi2, CSI2_CH_FRAME_SIZE(channel),
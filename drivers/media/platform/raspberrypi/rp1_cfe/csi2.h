@@ -75,6 +75,7 @@ void csi2_isr(struct csi2_device *csi2, bool *sof, bool *eof, bool *lci);
 void csi2_set_buffer(struct csi2_device *csi2, unsigned int channel,
 		     dma_addr_t dmaaddr, unsigned int stride,
 		     unsigned int size);
+unsigned int csi2_get_lines(struct csi2_device *csi2, unsigned int channel);
 void csi2_set_compression(struct csi2_device *csi2, unsigned int channel,
 			  enum csi2_compression_mode mode, unsigned int shift,
 			  unsigned int offset);
@@ -318,6 +318,12 @@ void pisp_fe_submit_job(struct pisp_fe_device *fe, struct vb2_buffer **vb2_bufs,
 		if (!(cfg->global.enables & PISP_FE_ENABLE_OUTPUT(i)))
 			continue;
 
+		/* A statistics-only frame for this output */
+		if (!buf) {
+			cfg->global.enables &= ~PISP_FE_ENABLE_OUTPUT(i);
+			continue;
+		}
+
 		addr = vb2_dma_contig_plane_dma_addr(buf, 0);
 		cfg->output_buffer[i].addr_lo = addr & 0xffffffff;
 		cfg->output_buffer[i].addr_hi = addr >> 32;
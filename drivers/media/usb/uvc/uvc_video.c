@@ -1171,6 +1171,64 @@ static int uvc_submit_urb(struct uvc_urb *uvc_urb, gfp_t mem_flags)
 	return usb_submit_urb(uvc_urb->urb, mem_flags);
 }
 
+/*
+ * Return how much of the URB transfer buffer the device may have written to.
+ * Isochronous packets live at fixed offsets, so this is up to the end of the
+ * last packet that carried data.
+ */
+static unsigned int uvc_urb_received(struct uvc_urb *uvc_urb)
+{
+	struct urb *urb = uvc_urb->urb;
+	unsigned int end = 0;
+	unsigned int i;
+
+	if (uvc_stream_dir(uvc_urb->stream) != DMA_FROM_DEVICE)
+		return uvc_urb->stream->urb_size;
+
+	if (!usb_pipeisoc(urb->pipe))
+		return urb->actual_length;
+
+	for (i = 0; i < urb->number_of_packets; ++i) {
+		struct usb_iso_packet_descriptor *desc = &urb->iso_frame_desc[i];
+
+		if (desc->actual_length)
+			end = max(end, desc->offset + desc->actual_length);
+	}
+
+	return end;
+}
+
+/*
+ * Sync the part of the transfer buffer that holds data for the CPU. Cache
+ * maintenance over the whole buffer for every URB is a noticeable part of
+ * the decode cost on non-coherent systems, while MJPEG payloads often fill
+ * only a fraction of it.
+ */
+static void uvc_urb_sync_for_cpu(struct uvc_urb *uvc_urb)
+{
+	struct uvc_streaming *stream = uvc_urb->stream;
+	struct device *dma_dev = uvc_stream_to_dmadev(stream);
+	unsigned int len = uvc_urb_received(uvc_urb);
+	unsigned int total = len;
+	struct scatterlist *sg;
+	unsigned int i;
+
+	if (!len)
+		return;
+
+	for_each_sgtable_dma_sg(uvc_urb->sgt, sg, i) {
+		unsigned int n = min(len, sg_dma_len(sg));
+
+		dma_sync_single_for_cpu(dma_dev, sg_dma_address(sg), n,
+					uvc_stream_dir(stream));
+		len -= n;
+		if (!len)
+			break;
+	}
+
+	invalidate_kernel_vmap_range(uvc_urb->buffer, total);
+}
+
 /*
  * uvc_video_decode_data_work: Asynchronous memcpy processing
  *
@@ -1619,10 +1677,7 @@ static void uvc_video_complete(struct urb *urb)
 	uvc_urb->async_operations = 0;
 
 	/* Sync DMA and invalidate vmap range. */
-	dma_sync_sgtable_for_cpu(uvc_stream_to_dmadev(uvc_urb->stream),
-				 uvc_urb->sgt, uvc_stream_dir(stream));
-	invalidate_kernel_vmap_range(uvc_urb->buffer,
-				     uvc_urb->stream->urb_size);
+	uvc_urb_sync_for_cpu(uvc_urb);
 
 	/*
 	 * Process the URB headers, and optionally queue expensive memcpy tasks
@@ -10,6 +10,7 @@
 #include <linux/completion.h>
 #include <linux/etherdevice.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/irq.h>
@@ -18,6 +19,7 @@
 #include <linux/mfd/core.h>
 #include <linux/mmc/host.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/msi.h>
 #include <linux/of_platform.h>
 #include <linux/pci.h>
@@ -64,6 +66,12 @@
 #define INTSTATL		0x108
 #define INTSTATH		0x10c
 
+struct rp1_irq_holdoff {
+	struct hrtimer timer;
+	struct rp1_dev *rp1;
+	unsigned int hwirq;
+};
+
 struct rp1_dev {
 	struct pci_dev *pdev;
 	struct device *dev;
@@ -73,10 +81,21 @@ struct rp1_dev {
 	struct irq_domain *domain;
 	struct irq_data *pcie_irqds[64];
 	void __iomem *msix_cfg_regs;
+	struct rp1_irq_holdoff holdoff[RP1_IRQS];
 };
 
 static bool rp1_level_triggered_irq[RP1_ACTUAL_IRQS] = { 0 };
 
+/*
+ * A level-triggered source doesn't send another MSI-X message until it
+ * is acknowledged, so holding the acknowledge back rate-limits it to one
+ * interrupt per holdoff period, whatever the peripheral does meanwhile.
+ */
+static unsigned int irq_holdoff_us[RP1_IRQS];
+module_param_array(irq_holdoff_us, uint, NULL, 0644);
+MODULE_PARM_DESC(irq_holdoff_us,
+		 "Minimum interval between interrupts of each level-triggered source, by hwirq (0 = off)");
+
 static struct rp1_dev *g_rp1;
 static u32 g_chip_id, g_platform;
 
@@ -141,13 +160,54 @@ static int rp1_irq_set_type(struct irq_data *irqd, unsigned int type)
 	return ret;
 }
 
+/*
+ * Every source has its own MSI-X vector, so steering a source is a
+ * matter of steering its vector, if the MSI controller allows it. Going
+ * through the core keeps the vector's own affinity mask up to date, and
+ * copes with controllers that only move it on the next interrupt.
+ */
+static int rp1_irq_set_affinity(struct irq_data *irqd,
+				const struct cpumask *dest, bool force)
+{
+	struct rp1_dev *rp1 = irqd->domain->host_data;
+	struct irq_data *pcie_irqd = rp1->pcie_irqds[irqd->hwirq];
+	int ret;
+
+	if (force)
+		ret = irq_force_affinity(pcie_irqd->irq, dest);
+	else
+		ret = irq_set_affinity(pcie_irqd->irq, dest);
+	if (!ret)
+		irq_data_update_effective_affinity(irqd,
+			irq_data_get_effective_affinity_mask(pcie_irqd));
+
+	return ret;
+}
+
+/*
+ * The vector's descriptor is locked while ours is held, give ours its own
+ * lockdep class.
+ */
+static struct lock_class_key rp1_irq_lock_class;
+static struct lock_class_key rp1_irq_request_class;
+
 static struct irq_chip rp1_irq_chip = {
-	.name            = "rp1_irq_chip",
-	.irq_mask        = rp1_mask_irq,
-	.irq_unmask      = rp1_unmask_irq,
-	.irq_set_type    = rp1_irq_set_type,
+	.name             = "rp1_irq_chip",
+	.irq_mask         = rp1_mask_irq,
+	.irq_unmask       = rp1_unmask_irq,
+	.irq_set_type     = rp1_irq_set_type,
+	.irq_set_affinity = rp1_irq_set_affinity,
 };
 
+static enum hrtimer_restart rp1_irq_holdoff_expired(struct hrtimer *timer)
+{
+	struct rp1_irq_holdoff *holdoff =
+		container_of(timer, struct rp1_irq_holdoff, timer);
+
+	msix_cfg_set(holdoff->rp1, holdoff->hwirq, MSIX_CFG_IACK);
+	return HRTIMER_NORESTART;
+}
+
 static void rp1_chained_handle_irq(struct irq_desc *desc)
 {
 	struct irq_chip *chip = irq_desc_get_chip(desc);
@@ -161,8 +221,16 @@ static void rp1_chained_handle_irq(struct irq_desc *desc)
 
 	new_irq = irq_linear_revmap(rp1->domain, hwirq);
 	generic_handle_irq(new_irq);
-	if (rp1_level_triggered_irq[hwirq])
-		msix_cfg_set(rp1, hwirq, MSIX_CFG_IACK);
+	if (rp1_level_triggered_irq[hwirq]) {
+		unsigned int holdoff_us = READ_ONCE(irq_holdoff_us[hwirq]);
+
+		if (holdoff_us)
+			hrtimer_start(&rp1->holdoff[hwirq].timer,
+				      us_to_ktime(holdoff_us),
+				      HRTIMER_MODE_REL_HARD);
+		else
+			msix_cfg_set(rp1, hwirq, MSIX_CFG_IACK);
+	}
 
 	chained_irq_exit(chip, desc);
 }
@@ -317,7 +385,15 @@ static int rp1_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 	rp1->msix_cfg_regs = ioremap(rp1_io_to_phys(rp1, RP1_PCIE_APBS_BASE), 0x1000);
 
 	for (i = 0; i < RP1_IRQS; i++) {
-		int irq = irq_create_mapping(rp1->domain, i);
+		int irq;
+
+		rp1->holdoff[i].rp1 = rp1;
+		rp1->holdoff[i].hwirq = i;
+		hrtimer_init(&rp1->holdoff[i].timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL_HARD);
+		rp1->holdoff[i].timer.function = rp1_irq_holdoff_expired;
+
+		irq = irq_create_mapping(rp1->domain, i);
 
 		if (irq < 0) {
 			dev_err(&pdev->dev, "failed to create irq mapping\n");
@@ -326,6 +402,8 @@ static int rp1_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 
 		irq_set_chip_data(irq, rp1);
 		irq_set_chip_and_handler(irq, &rp1_irq_chip, handle_level_irq);
+		irq_set_lockdep_class(irq, &rp1_irq_lock_class,
+				      &rp1_irq_request_class);
 		irq_set_probe(irq);
 		irq_set_chained_handler(pci_irq_vector(pdev, i),
 					rp1_chained_handle_irq);
@@ -342,9 +420,13 @@ static int rp1_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 static void rp1_remove(struct pci_dev *pdev)
 {
 	struct rp1_dev *rp1 = pci_get_drvdata(pdev);
+	int i;
 
 	mfd_remove_devices(&pdev->dev);
 
+	for (i = 0; i < RP1_IRQS; i++)
+		hrtimer_cancel(&rp1->holdoff[i].timer);
+
 	clk_unregister(rp1->sys_clk);
 }
 
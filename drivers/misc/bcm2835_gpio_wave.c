@@ -0,0 +1,572 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * BCM2835 DMA paced GPIO waveform generator
+ *
+ * Plays tables of GPSET0/GPCLR0 writes out onto the GPIO pins, one sample
+ * per tick of the PWM block.  Each sample takes two DMA control blocks:
+ * the first writes a dummy word into the PWM FIFO and is held back by the
+ * PWM DREQ until the FIFO has room, the second writes the set and clear
+ * masks with a single 2D transfer.  The control blocks of the two sample
+ * buffers are chained into a loop, with an interrupt at the end of each
+ * buffer, so userspace only has to wake up once per buffer to refill it.
+ *
+ * The driver takes over the PWM block; it must not be enabled together
+ * with pwm-bcm2835.
+ */
+
+#include <linux/clk.h>
+#include <linux/dma-mapping.h>
+#include <linux/fs.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/platform_data/dma-bcm2708.h>
+#include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#include <linux/bcm2835-gpio-wave.h>
+
+#define DRIVER_NAME "gpio-wave-bcm2835"
+
+#define GPSET0			0x1c
+#define GPCLR0			0x28
+
+#define PWM_CTL			0x00
+#define PWM_STA			0x04
+#define PWM_DMAC		0x08
+#define PWM_RNG1		0x10
+#define PWM_FIF1		0x18
+
+#define PWM_CTL_PWEN1		BIT(0)
+#define PWM_CTL_MODE1		BIT(1)
+#define PWM_CTL_USEF1		BIT(5)
+#define PWM_CTL_CLRF1		BIT(6)
+
+#define PWM_STA_FULL1		BIT(0)
+
+#define PWM_DMAC_ENAB		BIT(31)
+#define PWM_DMAC_PANIC(x)	((x) << 8)
+#define PWM_DMAC_DREQ(x)	(x)
+
+#define PWM_FIFO_DEPTH		16
+
+/* PWM DREQ line of the DMA controller */
+#define BCM2835_DMA_DREQ_PWM	5
+
+#define CBS_PER_SAMPLE		2
+
+struct gpio_wave {
+	struct device *dev;
+	struct miscdevice misc;
+	void __iomem *pwm;
+	struct clk *clk;
+	u32 gpio_bus;
+	u32 pwm_bus;
+
+	void __iomem *dma_base;
+	int dma_chan;
+	int dma_irq;
+
+	/* protects everything below but the completion state */
+	struct mutex lock;
+	bool open;
+	bool running;
+	u32 range;
+	u32 num_samples;
+
+	struct gpio_wave_sample *samples;
+	dma_addr_t samples_handle;
+	size_t buffer_bytes;
+
+	struct bcm2708_dma_cb *cbs;
+	dma_addr_t cbs_handle;
+	size_t cbs_bytes;
+
+	spinlock_t irq_lock;
+	wait_queue_head_t wait;
+	u64 completed;
+	u64 reported;
+};
+
+static irqreturn_t gpio_wave_irq(int irq, void *data)
+{
+	struct gpio_wave *wave = data;
+	u32 cs = readl(wave->dma_base + BCM2708_DMA_CS);
+
+	if (!(cs & BCM2708_DMA_INT))
+		return IRQ_NONE;
+
+	/* keep ACTIVE set, the chain never ends while we are playing */
+	writel(BCM2708_DMA_INT | (cs & BCM2708_DMA_ACTIVE),
+	       wave->dma_base + BCM2708_DMA_CS);
+
+	if (cs & BCM2708_DMA_ERR)
+		dev_err_ratelimited(wave->dev, "DMA error, debug %08x\n",
+				    readl(wave->dma_base + BCM2708_DMA_DEBUG));
+
+	spin_lock(&wave->irq_lock);
+	wave->completed++;
+	spin_unlock(&wave->irq_lock);
+
+	wake_up_interruptible(&wave->wait);
+
+	return IRQ_HANDLED;
+}
+
+static void gpio_wave_free_buffers(struct gpio_wave *wave)
+{
+	if (wave->cbs)
+		dma_free_coherent(wave->dev, wave->cbs_bytes, wave->cbs,
+				  wave->cbs_handle);
+	if (wave->samples)
+		dma_free_coherent(wave->dev,
+				  GPIO_WAVE_NUM_BUFFERS * wave->buffer_bytes,
+				  wave->samples, wave->samples_handle);
+	wave->cbs = NULL;
+	wave->samples = NULL;
+	wave->num_samples = 0;
+}
+
+/*
+ * Build the looping control block chain.  The dummy word the pacing
+ * blocks write into the PWM FIFO lives right behind the last block.
+ */
+static void gpio_wave_build_chain(struct gpio_wave *wave)
+{
+	unsigned int total = GPIO_WAVE_NUM_BUFFERS * wave->num_samples;
+	unsigned int i, ncbs = total * CBS_PER_SAMPLE;
+	dma_addr_t dummy = wave->cbs_handle + ncbs * sizeof(*wave->cbs);
+	struct bcm2708_dma_cb *cb = wave->cbs;
+
+	for (i = 0; i < total; i++) {
+		unsigned int buf = i / wave->num_samples;
+		unsigned int idx = i % wave->num_samples;
+		dma_addr_t sample = wave->samples_handle +
+				    buf * wave->buffer_bytes +
+				    idx * sizeof(struct gpio_wave_sample);
+		dma_addr_t next = wave->cbs_handle +
+				  ((2 * i + 1) % ncbs) * sizeof(*cb);
+
+		/* wait for the PWM to ask for its next word */
+		cb->info = BCM2708_DMA_D_DREQ | BCM2708_DMA_WAIT_RESP |
+			   BCM2708_DMA_PER_MAP(BCM2835_DMA_DREQ_PWM);
+		cb->src = dummy;
+		cb->dst = wave->pwm_bus + PWM_FIF1;
+		cb->length = sizeof(u32);
+		cb->stride = 0;
+		cb->next = next;
+		cb->pad[0] = 0;
+		cb->pad[1] = 0;
+		cb++;
+
+		/*
+		 * Set then clear: two rows of one word, one to GPSET0 and
+		 * one to GPCLR0.  The Y length counts the rows after the
+		 * first.
+		 */
+		next = wave->cbs_handle + ((2 * i + 2) % ncbs) * sizeof(*cb);
+		cb->info = BCM2708_DMA_TDMODE | BCM2708_DMA_S_INC |
+			   BCM2708_DMA_D_INC | BCM2708_DMA_WAIT_RESP;
+		if (idx == wave->num_samples - 1)
+			cb->info |= BCM2708_DMA_INT_EN;
+		cb->src = sample;
+		cb->dst = wave->gpio_bus + GPSET0;
+		cb->length = BCM2708_DMA_TDMODE_LEN(sizeof(u32), 1);
+		cb->stride = (GPCLR0 - GPSET0 - sizeof(u32)) << 16;
+		cb->next = next;
+		cb->pad[0] = 0;
+		cb->pad[1] = 0;
+		cb++;
+	}
+
+	*(u32 *)cb = 0;
+}
+
+static int gpio_wave_config(struct gpio_wave *wave,
+			    const struct gpio_wave_config *cfg)
+{
+	unsigned long clk_rate = clk_get_rate(wave->clk);
+	size_t buffer_bytes, cbs_bytes;
+
+	if (wave->samples)
+		return -EBUSY;
+
+	if (!cfg->rate || !cfg->num_samples ||
+	    cfg->num_samples > GPIO_WAVE_MAX_SAMPLES ||
+	    cfg->padding[0] || cfg->padding[1])
+		return -EINVAL;
+
+	wave->range = DIV_ROUND_CLOSEST(clk_rate, cfg->rate);
+	if (wave->range < 2)
+		return -EINVAL;
+
+	buffer_bytes = PAGE_ALIGN(cfg->num_samples *
+				  sizeof(struct gpio_wave_sample));
+	cbs_bytes = GPIO_WAVE_NUM_BUFFERS * cfg->num_samples *
+		    CBS_PER_SAMPLE * sizeof(struct bcm2708_dma_cb) +
+		    sizeof(struct bcm2708_dma_cb);
+
+	wave->samples = dma_alloc_coherent(wave->dev,
+					   GPIO_WAVE_NUM_BUFFERS * buffer_bytes,
+					   &wave->samples_handle, GFP_KERNEL);
+	if (!wave->samples)
+		return -ENOMEM;
+	wave->buffer_bytes = buffer_bytes;
+
+	wave->cbs = dma_alloc_coherent(wave->dev, cbs_bytes, &wave->cbs_handle,
+				       GFP_KERNEL);
+	if (!wave->cbs) {
+		gpio_wave_free_buffers(wave);
+		return -ENOMEM;
+	}
+	wave->cbs_bytes = cbs_bytes;
+	wave->num_samples = cfg->num_samples;
+
+	gpio_wave_build_chain(wave);
+
+	dev_dbg(wave->dev, "%u samples per buffer at %lu/%u Hz\n",
+		wave->num_samples, clk_rate, wave->range);
+
+	return 0;
+}
+
+static int gpio_wave_start(struct gpio_wave *wave)
+{
+	int i, ret;
+
+	if (!wave->samples)
+		return -EINVAL;
+	if (wave->running)
+		return -EBUSY;
+
+	ret = clk_prepare_enable(wave->clk);
+	if (ret)
+		return ret;
+
+	writel(0, wave->pwm + PWM_CTL);
+	writel(PWM_CTL_CLRF1, wave->pwm + PWM_CTL);
+	writel(wave->range, wave->pwm + PWM_RNG1);
+
+	/*
+	 * Start with a full FIFO so the first samples are not played out
+	 * back to back while the DMA catches up with the DREQ threshold.
+	 */
+	for (i = 0; i < PWM_FIFO_DEPTH; i++) {
+		if (readl(wave->pwm + PWM_STA) & PWM_STA_FULL1)
+			break;
+		writel(0, wave->pwm + PWM_FIF1);
+	}
+
+	spin_lock_irq(&wave->irq_lock);
+	wave->completed = 0;
+	wave->reported = 0;
+	spin_unlock_irq(&wave->irq_lock);
+
+	writel(PWM_DMAC_ENAB | PWM_DMAC_PANIC(7) | PWM_DMAC_DREQ(3),
+	       wave->pwm + PWM_DMAC);
+	writel(BCM2708_DMA_RESET, wave->dma_base + BCM2708_DMA_CS);
+	bcm_dma_start(wave->dma_base, wave->cbs_handle);
+	writel(PWM_CTL_USEF1 | PWM_CTL_MODE1 | PWM_CTL_PWEN1,
+	       wave->pwm + PWM_CTL);
+
+	wave->running = true;
+
+	return 0;
+}
+
+static void gpio_wave_stop(struct gpio_wave *wave)
+{
+	if (!wave->running)
+		return;
+
+	/* stop the pacing first so the DMA cannot get stuck on the DREQ */
+	writel(0, wave->pwm + PWM_DMAC);
+	if (bcm_dma_abort(wave->dma_base))
+		dev_warn(wave->dev, "DMA did not stop, resetting\n");
+	writel(BCM2708_DMA_RESET, wave->dma_base + BCM2708_DMA_CS);
+	writel(0, wave->pwm + PWM_CTL);
+
+	clk_disable_unprepare(wave->clk);
+	wave->running = false;
+
+	wake_up_interruptible(&wave->wait);
+}
+
+static bool gpio_wave_pending(struct gpio_wave *wave, u64 *completed)
+{
+	bool pending;
+
+	spin_lock_irq(&wave->irq_lock);
+	*completed = wave->completed;
+	pending = wave->completed != wave->reported;
+	spin_unlock_irq(&wave->irq_lock);
+
+	return pending;
+}
+
+static int gpio_wave_wait(struct gpio_wave *wave, struct file *file,
+			  struct gpio_wave_status *status)
+{
+	u64 completed;
+	int ret;
+
+	if (!READ_ONCE(wave->running))
+		return -EINVAL;
+
+	if (!gpio_wave_pending(wave, &completed)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(wave->wait,
+				gpio_wave_pending(wave, &completed) ||
+				!READ_ONCE(wave->running));
+		if (ret)
+			return ret;
+		if (!READ_ONCE(wave->running))
+			return -EINVAL;
+	}
+
+	spin_lock_irq(&wave->irq_lock);
+	wave->reported = completed;
+	spin_unlock_irq(&wave->irq_lock);
+
+	memset(status, 0, sizeof(*status));
+	status->completed = completed;
+	status->buffer = completed % GPIO_WAVE_NUM_BUFFERS;
+
+	return 0;
+}
+
+static long gpio_wave_ioctl(struct file *file, unsigned int cmd,
+			    unsigned long arg)
+{
+	struct gpio_wave *wave = file->private_data;
+	void __user *argp = (void __user *)arg;
+	struct gpio_wave_status status;
+	struct gpio_wave_config cfg;
+	int ret;
+
+	switch (cmd) {
+	case GPIO_WAVE_IOC_CONFIG:
+		if (copy_from_user(&cfg, argp, sizeof(cfg)))
+			return -EFAULT;
+		mutex_lock(&wave->lock);
+		ret = gpio_wave_config(wave, &cfg);
+		mutex_unlock(&wave->lock);
+		return ret;
+	case GPIO_WAVE_IOC_START:
+		mutex_lock(&wave->lock);
+		ret = gpio_wave_start(wave);
+		mutex_unlock(&wave->lock);
+		return ret;
+	case GPIO_WAVE_IOC_STOP:
+		mutex_lock(&wave->lock);
+		gpio_wave_stop(wave);
+		mutex_unlock(&wave->lock);
+		return 0;
+	case GPIO_WAVE_IOC_WAIT:
+		/* not under the lock, STOP must be able to interrupt us */
+		ret = gpio_wave_wait(wave, file, &status);
+		if (ret)
+			return ret;
+		if (copy_to_user(argp, &status, sizeof(status)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static __poll_t gpio_wave_poll(struct file *file, poll_table *wait)
+{
+	struct gpio_wave *wave = file->private_data;
+	u64 completed;
+
+	poll_wait(file, &wave->wait, wait);
+
+	if (!READ_ONCE(wave->running))
+		return EPOLLERR;
+
+	return gpio_wave_pending(wave, &completed) ? EPOLLOUT : 0;
+}
+
+static int gpio_wave_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct gpio_wave *wave = file->private_data;
+	size_t size = vma->vm_end - vma->vm_start;
+	int ret = -EINVAL;
+
+	mutex_lock(&wave->lock);
+	if (wave->samples && !vma->vm_pgoff &&
+	    size <= GPIO_WAVE_NUM_BUFFERS * wave->buffer_bytes)
+		ret = dma_mmap_coherent(wave->dev, vma, wave->samples,
+					wave->samples_handle, size);
+	mutex_unlock(&wave->lock);
+
+	return ret;
+}
+
+static int gpio_wave_open(struct inode *inode, struct file *file)
+{
+	struct gpio_wave *wave = container_of(file->private_data,
+					      struct gpio_wave, misc);
+	int ret = 0;
+
+	mutex_lock(&wave->lock);
+	if (wave->open)
+		ret = -EBUSY;
+	else
+		wave->open = true;
+	mutex_unlock(&wave->lock);
+
+	file->private_data = wave;
+
+	return ret;
+}
+
+/* Only called once the last mapping is gone, as each one holds the file. */
+static int gpio_wave_release(struct inode *inode, struct file *file)
+{
+	struct gpio_wave *wave = file->private_data;
+
+	mutex_lock(&wave->lock);
+	gpio_wave_stop(wave);
+	gpio_wave_free_buffers(wave);
+	wave->open = false;
+	mutex_unlock(&wave->lock);
+
+	return 0;
+}
+
+static const struct file_operations gpio_wave_fops = {
+	.owner = THIS_MODULE,
+	.open = gpio_wave_open,
+	.release = gpio_wave_release,
+	.unlocked_ioctl = gpio_wave_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.poll = gpio_wave_poll,
+	.mmap = gpio_wave_mmap,
+	.llseek = noop_llseek,
+};
+
+/* The DMA controller sees the registers at their untranslated address. */
+static int gpio_wave_bus_addr(struct device *dev, int index, u32 *addr)
+{
+	const __be32 *reg = of_get_address(dev->of_node, index, NULL, NULL);
+
+	if (!reg)
+		return -EINVAL;
+	*addr = be32_to_cpup(reg);
+
+	return 0;
+}
+
+static int gpio_wave_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct gpio_wave *wave;
+	int ret;
+
+	wave = devm_kzalloc(dev, sizeof(*wave), GFP_KERNEL);
+	if (!wave)
+		return -ENOMEM;
+
+	wave->dev = dev;
+	mutex_init(&wave->lock);
+	spin_lock_init(&wave->irq_lock);
+	init_waitqueue_head(&wave->wait);
+
+	/* the GPIO block belongs to the pinctrl driver, only the PWM is ours */
+	ret = gpio_wave_bus_addr(dev, 0, &wave->gpio_bus);
+	if (ret)
+		return ret;
+	ret = gpio_wave_bus_addr(dev, 1, &wave->pwm_bus);
+	if (ret)
+		return ret;
+
+	wave->pwm = devm_platform_ioremap_resource(pdev, 1);
+	if (IS_ERR(wave->pwm))
+		return PTR_ERR(wave->pwm);
+
+	wave->clk = devm_clk_get(dev, NULL);
+	if (IS_ERR(wave->clk))
+		return dev_err_probe(dev, PTR_ERR(wave->clk),
+				     "could not get clk\n");
+
+	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32));
+	if (ret)
+		return ret;
+
+	/* 2D transfers are not available on the lite channels */
+	ret = bcm_dma_chan_alloc(BCM_DMA_FEATURE_NORMAL, &wave->dma_base,
+				 &wave->dma_irq);
+	if (ret == -ENODEV)
+		return -EPROBE_DEFER;
+	if (ret < 0)
+		return dev_err_probe(dev, ret, "could not get DMA channel\n");
+	wave->dma_chan = ret;
+
+	ret = request_irq(wave->dma_irq, gpio_wave_irq, IRQF_SHARED,
+			  DRIVER_NAME, wave);
+	if (ret)
+		goto err_free_chan;
+
+	wave->misc.minor = MISC_DYNAMIC_MINOR;
+	wave->misc.name = "gpio-wave";
+	wave->misc.fops = &gpio_wave_fops;
+	wave->misc.parent = dev;
+
+	ret = misc_register(&wave->misc);
+	if (ret)
+		goto err_free_irq;
+
+	platform_set_drvdata(pdev, wave);
+
+	dev_info(dev, "using DMA channel %d\n", wave->dma_chan);
+
+	return 0;
+
+err_free_irq:
+	free_irq(wave->dma_irq, wave);
+err_free_chan:
+	bcm_dma_chan_free(wave->dma_chan);
+	return ret;
+}
+
+static int gpio_wave_remove(struct platform_device *pdev)
+{
+	struct gpio_wave *wave = platform_get_drvdata(pdev);
+
+	misc_deregister(&wave->misc);
+	free_irq(wave->dma_irq, wave);
+	bcm_dma_chan_free(wave->dma_chan);
+
+	return 0;
+}
+
+static const struct of_device_id gpio_wave_of_match[] = {
+	{ .compatible = "brcm,bcm2835-gpio-wave", },
+	{ /* sentinel */ },
+};
+MODULE_DEVICE_TABLE(of, gpio_wave_of_match);
+
+static struct platform_driver gpio_wave_driver = {
+	.probe = gpio_wave_probe,
+	.remove = gpio_wave_remove,
+	.driver = {
+		.name = DRIVER_NAME,
+		.of_match_table = gpio_wave_of_match,
+	},
+};
+module_platform_driver(gpio_wave_driver);
+
+MODULE_ALIAS("platform:" DRIVER_NAME);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("DMA paced GPIO waveform generator for BCM2835");
@@ -52,6 +52,7 @@
 
 #define BCM2835_SMI_IMPLEMENTATION
 #include <linux/broadcom/bcm2835_smi.h>
+#include <linux/broadcom/bcm2835_smi_stream.h>
 
 #define DRIVER_NAME "smi-bcm2835"
 
@@ -60,6 +61,26 @@
 #define DMA_WRITE_TO_MEM true
 #define DMA_READ_FROM_MEM false
 
+struct bcm2835_smi_stream {
+	void *buf;
+	dma_addr_t phys;
+	size_t size;
+	size_t period_size;
+	enum dma_transfer_direction dir;
+	dma_cookie_t cookie;
+	bool running;
+
+	/* SMIL is finite, so the transfer is re-armed every chunk_transfers */
+	u32 chunk_transfers;
+	u64 chunk_bytes;
+	u64 chunk_left;
+	size_t pos;
+	atomic64_t periods;
+
+	void (*callback)(void *param);
+	void *callback_param;
+};
+
 struct bcm2835_smi_instance {
 	struct device *dev;
 	struct smi_settings settings;
@@ -78,6 +99,8 @@ struct bcm2835_smi_instance {
 	/* Sometimes we are called into in an atomic context (e.g. by
 	   JFFS2 + MTD) so we can't use a mutex */
 	spinlock_t transaction_lock;
+
+	struct bcm2835_smi_stream stream;
 };
 
 /****************************************************************************
@@ -618,6 +641,10 @@ ssize_t bcm2835_smi_user_dma(
 	void (*init_trans_func)(struct bcm2835_smi_instance *, int);
 
 	spin_lock(&inst->transaction_lock);
+	if (inst->stream.running) {
+		spin_unlock(&inst->transaction_lock);
+		return -EBUSY;
+	}
 
 	if (dma_dir == DMA_DEV_TO_MEM)
 		init_trans_func = smi_init_programmed_read;
@@ -683,6 +710,10 @@ void bcm2835_smi_write_buf(
 	n_bytes -= odd_bytes;
 
 	spin_lock(&inst->transaction_lock);
+	if (inst->stream.running) {
+		dev_err(inst->dev, "write refused while streaming");
+		goto out;
+	}
 
 	if (n_bytes > DMA_THRESHOLD_BYTES) {
 		dma_addr_t phy_addr = dma_map_single(
@@ -744,6 +775,10 @@ void bcm2835_smi_read_buf(struct bcm2835_smi_instance *inst,
 	int odd_bytes = n_bytes & 0x3;
 
 	spin_lock(&inst->transaction_lock);
+	if (inst->stream.running) {
+		dev_err(inst->dev, "read refused while streaming");
+		goto out;
+	}
 	n_bytes -= odd_bytes;
 	if (n_bytes > DMA_THRESHOLD_BYTES) {
 		dma_addr_t phy_addr = dma_map_single(inst->dev,
@@ -786,6 +821,242 @@ void bcm2835_smi_read_buf(struct bcm2835_smi_instance *inst,
 }
 EXPORT_SYMBOL(bcm2835_smi_read_buf);
 
+/****************************************************************************
+*
+*   Continuous streaming - cyclic DMA into a ring buffer
+*
+***************************************************************************/
+
+static inline unsigned int smi_transfer_bytes(struct bcm2835_smi_instance *inst)
+{
+	if (inst->settings.data_width == SMI_WIDTH_8BIT)
+		return 1;
+	if (inst->settings.data_width == SMI_WIDTH_16BIT)
+		return 2;
+	return 0;
+}
+
+/* Called once the programmed transfer count has run out, which is at a
+ * ring boundary. The SMI waits there until re-armed, so the data stays
+ * aligned to the ring even when the callback runs late. */
+static void smi_stream_rearm(struct bcm2835_smi_instance *inst)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+	int timeout = 0;
+
+	while (!(read_smi_reg(inst, SMICS) & SMICS_DONE) && ++timeout < 10000)
+		cpu_relax();
+	if (timeout >= 10000)
+		smi_dump_context_labelled(inst,
+			"stream: transfer did not finish before re-arm");
+
+	if (stream->dir == DMA_DEV_TO_MEM)
+		smi_init_programmed_read(inst, stream->chunk_transfers);
+	else
+		smi_init_programmed_write(inst, stream->chunk_transfers);
+}
+
+/* virt-dma runs the callback once for any number of periods done since
+ * the last run, so the progress is taken from the residue instead. */
+static void smi_stream_callback(void *param)
+{
+	struct bcm2835_smi_instance *inst = param;
+	struct bcm2835_smi_stream *stream = &inst->stream;
+	struct dma_tx_state state;
+	size_t pos, done;
+
+	if (dmaengine_tx_status(inst->dma_chan, stream->cookie, &state) ==
+	    DMA_ERROR)
+		return;
+
+	pos = (stream->size - state.residue) % stream->size;
+	pos = rounddown(pos, stream->period_size);
+	done = (pos + stream->size - stream->pos) % stream->size;
+	stream->pos = pos;
+	if (!done)
+		return;
+
+	atomic64_add(done / stream->period_size, &stream->periods);
+
+	if (done >= stream->chunk_left) {
+		stream->chunk_left += stream->chunk_bytes - done;
+		smi_stream_rearm(inst);
+	} else {
+		stream->chunk_left -= done;
+	}
+
+	if (stream->callback)
+		stream->callback(stream->callback_param);
+}
+
+int bcm2835_smi_stream_alloc(struct bcm2835_smi_instance *inst, size_t size)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+
+	if (!size || !PAGE_ALIGNED(size))
+		return -EINVAL;
+	if (stream->buf)
+		return -EBUSY;
+
+	stream->buf = dma_alloc_coherent(inst->dev, size, &stream->phys,
+					 GFP_KERNEL);
+	if (!stream->buf)
+		return -ENOMEM;
+	stream->size = size;
+
+	return 0;
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_alloc);
+
+/* The caller must make sure the buffer is no longer mapped. */
+void bcm2835_smi_stream_free(struct bcm2835_smi_instance *inst)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+
+	bcm2835_smi_stream_stop(inst);
+
+	if (stream->buf)
+		dma_free_coherent(inst->dev, stream->size, stream->buf,
+				  stream->phys);
+	stream->buf = NULL;
+	stream->size = 0;
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_free);
+
+void *bcm2835_smi_stream_buffer(struct bcm2835_smi_instance *inst)
+{
+	return inst->stream.buf;
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_buffer);
+
+int bcm2835_smi_stream_mmap(struct bcm2835_smi_instance *inst,
+			    struct vm_area_struct *vma)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+	size_t size = vma->vm_end - vma->vm_start;
+
+	if (!stream->buf || vma->vm_pgoff || size > stream->size)
+		return -EINVAL;
+
+	return dma_mmap_coherent(inst->dev, vma, stream->buf, stream->phys,
+				 size);
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_mmap);
+
+/* Start moving data between the SMI and the whole ring buffer, in a loop.
+ * callback, if given, is called in atomic context after each period. */
+int bcm2835_smi_stream_start(struct bcm2835_smi_instance *inst,
+			     enum dma_transfer_direction dir,
+			     size_t period_size,
+			     void (*callback)(void *param), void *param)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+	struct dma_async_tx_descriptor *desc;
+	unsigned int width = smi_transfer_bytes(inst);
+	u32 ring_transfers;
+	int ret = 0;
+
+	if (!stream->buf || !width || !period_size || period_size & 0x3 ||
+	    stream->size % period_size)
+		return -EINVAL;
+	if (dir != DMA_DEV_TO_MEM && dir != DMA_MEM_TO_DEV)
+		return -EINVAL;
+
+	spin_lock(&inst->transaction_lock);
+	if (stream->running) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	smi_disable(inst, dir);
+
+	desc = dmaengine_prep_dma_cyclic(inst->dma_chan, stream->phys,
+					 stream->size, period_size, dir,
+					 DMA_PREP_INTERRUPT);
+	if (!desc) {
+		dev_err(inst->dev, "stream: cyclic dma preparation failed!");
+		ret = -ENOMEM;
+		goto out;
+	}
+	desc->callback = smi_stream_callback;
+	desc->callback_param = inst;
+
+	ring_transfers = stream->size / width;
+	stream->chunk_transfers = (U32_MAX / ring_transfers) * ring_transfers;
+	stream->chunk_bytes = (u64)stream->chunk_transfers * width;
+	stream->chunk_left = stream->chunk_bytes;
+	stream->pos = 0;
+	stream->period_size = period_size;
+	stream->dir = dir;
+	stream->callback = callback;
+	stream->callback_param = param;
+	atomic64_set(&stream->periods, 0);
+
+	stream->cookie = dmaengine_submit(desc);
+	if (dma_submit_error(stream->cookie)) {
+		ret = -EIO;
+		goto out;
+	}
+	dma_async_issue_pending(inst->dma_chan);
+	stream->running = true;
+
+	if (dir == DMA_DEV_TO_MEM)
+		smi_init_programmed_read(inst, stream->chunk_transfers);
+	else
+		smi_init_programmed_write(inst, stream->chunk_transfers);
+out:
+	spin_unlock(&inst->transaction_lock);
+	return ret;
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_start);
+
+/* May sleep */
+void bcm2835_smi_stream_stop(struct bcm2835_smi_instance *inst)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+	int smics_temp, timeout = 0;
+
+	if (!stream->running)
+		return;
+
+	/* With the DMA gone the SMI stalls on its FIFO, then stop it */
+	dmaengine_terminate_sync(inst->dma_chan);
+
+	spin_lock(&inst->transaction_lock);
+	smics_temp = read_smi_reg(inst, SMICS) & ~SMICS_ENABLE;
+	write_smi_reg(inst, smics_temp, SMICS);
+	while ((read_smi_reg(inst, SMICS) & SMICS_ACTIVE) && ++timeout < 10000)
+		cpu_relax();
+	if (timeout >= 10000)
+		smi_dump_context_labelled(inst, "stream: SMI did not stop");
+	write_smi_reg(inst, smics_temp | SMICS_CLEAR, SMICS);
+	stream->running = false;
+	spin_unlock(&inst->transaction_lock);
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_stop);
+
+/* Returns the byte offset in the ring the DMA is working on, and
+ * optionally the number of periods completed since the stream started. */
+ssize_t bcm2835_smi_stream_pointer(struct bcm2835_smi_instance *inst,
+				   u64 *periods)
+{
+	struct bcm2835_smi_stream *stream = &inst->stream;
+	struct dma_tx_state state;
+
+	if (!stream->running)
+		return -EINVAL;
+
+	if (periods)
+		*periods = atomic64_read(&stream->periods);
+
+	if (dmaengine_tx_status(inst->dma_chan, stream->cookie, &state) ==
+	    DMA_ERROR)
+		return -EIO;
+
+	return (stream->size - state.residue) % stream->size;
+}
+EXPORT_SYMBOL(bcm2835_smi_stream_pointer);
+
 void bcm2835_smi_set_address(struct bcm2835_smi_instance *inst,
 	unsigned int address)
 {
@@ -913,6 +1184,7 @@ static int bcm2835_smi_remove(struct platform_device *pdev)
 	struct bcm2835_smi_instance *inst = platform_get_drvdata(pdev);
 	struct device *dev = inst->dev;
 
+	bcm2835_smi_stream_free(inst);
 	dmaengine_terminate_all(inst->dma_chan);
 	dma_release_channel(inst->dma_chan);
 
@@ -49,6 +49,8 @@
 
 #include <linux/uaccess.h>
 
+#include <trace/events/mmc.h>
+
 #include "queue.h"
 #include "block.h"
 #include "core.h"
@@ -140,6 +142,7 @@ struct mmc_blk_data {
 	/* debugfs files (only in main mmc_blk_data) */
 	struct dentry *status_dentry;
 	struct dentry *ext_csd_dentry;
+	struct dentry *stats_dentry;
 };
 
 /* Device type for RPMB character devices */
@@ -1482,6 +1485,15 @@ static void mmc_blk_data_prep(struct mmc_queue *mq, struct mmc_queue_req *mqrq,
 
 #define MMC_CQE_RETRIES 2
 
+static void mmc_blk_account_retry(struct mmc_queue *mq)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mq->lock, flags);
+	mq->retries++;
+	spin_unlock_irqrestore(&mq->lock, flags);
+}
+
 static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
@@ -1494,6 +1506,7 @@ static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 	int err;
 
 	mmc_cqe_post_req(host, mrq);
+	mmc_queue_account_rq(mq, mmc_rq_stats_type(req), mqrq->start_ns);
 
 	if (mrq->cmd && mrq->cmd->error)
 		err = mrq->cmd->error;
@@ -1503,9 +1516,10 @@ static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 		err = 0;
 
 	if (err) {
-		if (mqrq->retries++ < MMC_CQE_RETRIES)
+		if (mqrq->retries++ < MMC_CQE_RETRIES) {
+			mmc_blk_account_retry(mq);
 			blk_mq_requeue_request(req, true);
-		else
+		} else
 			blk_mq_end_request(req, BLK_STS_IOERR);
 	} else if (mrq->data) {
 		if (blk_update_request(req, BLK_STS_OK, mrq->data->bytes_xfered))
@@ -1984,10 +1998,23 @@ static int mmc_blk_busy_cb(void *cb_data, bool *busy)
 	return 0;
 }
 
+static void mmc_blk_account_busy(struct mmc_queue *mq, u64 start_ns)
+{
+	u64 ns = ktime_get_ns() - start_ns;
+	unsigned long flags;
+
+	trace_mmc_blk_busy(mq->card->host, ns);
+
+	spin_lock_irqsave(&mq->lock, flags);
+	mmc_rq_stats_add(&mq->busy_stats, ns);
+	spin_unlock_irqrestore(&mq->lock, flags);
+}
+
 static int mmc_blk_card_busy(struct mmc_card *card, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	struct mmc_blk_busy_data cb_data;
+	u64 start_ns;
 	int err;
 
 	if (rq_data_dir(req) == READ)
@@ -2002,8 +2029,10 @@ static int mmc_blk_card_busy(struct mmc_card *card, struct request *req)
 
 	cb_data.card = card;
 	cb_data.status = 0;
+	start_ns = ktime_get_ns();
 	err = __mmc_poll_for_busy(card->host, 0, MMC_BLK_TIMEOUT_MS,
 				  &mmc_blk_busy_cb, &cb_data);
+	mmc_blk_account_busy(req->q->queuedata, start_ns);
 
 	/*
 	 * Do not assume data transferred correctly if there are any error bits
@@ -2034,6 +2063,8 @@ static void mmc_blk_mq_complete_rq(struct mmc_queue *mq, struct request *req)
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	unsigned int nr_bytes = mqrq->brq.data.bytes_xfered;
 
+	mmc_queue_account_rq(mq, mmc_rq_stats_type(req), mqrq->start_ns);
+
 	if (nr_bytes) {
 		if (blk_update_request(req, BLK_STS_OK, nr_bytes))
 			blk_mq_requeue_request(req, true);
@@ -2042,6 +2073,7 @@ static void mmc_blk_mq_complete_rq(struct mmc_queue *mq, struct request *req)
 	} else if (!blk_rq_bytes(req)) {
 		__blk_mq_end_request(req, BLK_STS_IOERR);
 	} else if (mqrq->retries++ < MMC_MAX_RETRIES) {
+		mmc_blk_account_retry(mq);
 		blk_mq_requeue_request(req, true);
 	} else {
 		if (mmc_card_removed(mq->card))
@@ -2937,6 +2969,55 @@ static const struct file_operations mmc_dbg_ext_csd_fops = {
 	.llseek		= default_llseek,
 };
 
+static void mmc_blk_show_rq_stats(struct seq_file *s, const char *name,
+				  struct mmc_rq_stats *stats)
+{
+	int i;
+
+	seq_printf(s, "%s: count %llu avg_us %llu max_us %u\n", name,
+		   stats->count,
+		   stats->count ? div64_u64(stats->total_us, stats->count) : 0,
+		   stats->max_us);
+	for (i = 0; i < MMC_RQ_STATS_BUCKETS; i++)
+		if (stats->hist[i])
+			seq_printf(s, "  <%lluus: %u\n", 1ULL << i,
+				   stats->hist[i]);
+}
+
+static int mmc_blk_stats_show(struct seq_file *s, void *data)
+{
+	static const char * const names[MMC_RQ_STATS_MAX] = {
+		[MMC_RQ_STATS_READ] = "read",
+		[MMC_RQ_STATS_WRITE] = "write",
+		[MMC_RQ_STATS_DISCARD] = "discard",
+		[MMC_RQ_STATS_FLUSH] = "flush",
+	};
+	struct mmc_queue *mq = s->private;
+	struct mmc_rq_stats *stats;
+	u64 retries;
+	int i;
+
+	stats = kmalloc_array(MMC_RQ_STATS_MAX + 1, sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return -ENOMEM;
+
+	spin_lock_irq(&mq->lock);
+	memcpy(stats, mq->rq_stats, sizeof(mq->rq_stats));
+	stats[MMC_RQ_STATS_MAX] = mq->busy_stats;
+	retries = mq->retries;
+	spin_unlock_irq(&mq->lock);
+
+	for (i = 0; i < MMC_RQ_STATS_MAX; i++)
+		mmc_blk_show_rq_stats(s, names[i], &stats[i]);
+	mmc_blk_show_rq_stats(s, "busy", &stats[MMC_RQ_STATS_MAX]);
+	seq_printf(s, "retries: %llu\n", retries);
+
+	kfree(stats);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mmc_blk_stats);
+
 static int mmc_blk_add_debugfs(struct mmc_card *card, struct mmc_blk_data *md)
 {
 	struct dentry *root;
@@ -2963,6 +3044,10 @@ static int mmc_blk_add_debugfs(struct mmc_card *card, struct mmc_blk_data *md)
 			return -EIO;
 	}
 
+	md->stats_dentry = debugfs_create_file("block_stats", 0400, root,
+					       &md->queue,
+					       &mmc_blk_stats_fops);
+
 	return 0;
 }
 
@@ -2981,6 +3066,9 @@ static void mmc_blk_remove_debugfs(struct mmc_card *card,
 		debugfs_remove(md->ext_csd_dentry);
 		md->ext_csd_dentry = NULL;
 	}
+
+	debugfs_remove(md->stats_dentry);
+	md->stats_dentry = NULL;
 }
 
 #else
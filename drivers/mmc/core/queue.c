@@ -14,6 +14,8 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 
+#include <trace/events/mmc.h>
+
 #include "queue.h"
 #include "block.h"
 #include "core.h"
@@ -23,6 +25,10 @@
 
 #define MMC_DMA_MAP_MERGE_SEGMENTS	512
 
+static bool sd_au_packing;
+module_param(sd_au_packing, bool, 0444);
+MODULE_PARM_DESC(sd_au_packing, "Split and size requests to the allocation unit of SD cards");
+
 static inline bool mmc_cqe_dcmd_busy(struct mmc_queue *mq)
 {
 	/* Allow only 1 DCMD at a time */
@@ -70,6 +76,51 @@ enum mmc_issue_type mmc_issue_type(struct mmc_queue *mq, struct request *req)
 	return MMC_ISSUE_SYNC;
 }
 
+enum mmc_rq_stats_type mmc_rq_stats_type(struct request *req)
+{
+	switch (req_op(req)) {
+	case REQ_OP_READ:
+		return MMC_RQ_STATS_READ;
+	case REQ_OP_WRITE:
+		return MMC_RQ_STATS_WRITE;
+	case REQ_OP_DISCARD:
+	case REQ_OP_SECURE_ERASE:
+	case REQ_OP_WRITE_ZEROES:
+		return MMC_RQ_STATS_DISCARD;
+	case REQ_OP_FLUSH:
+		return MMC_RQ_STATS_FLUSH;
+	default:
+		return MMC_RQ_STATS_MAX;
+	}
+}
+
+void mmc_rq_stats_add(struct mmc_rq_stats *stats, u64 ns)
+{
+	u32 us = min_t(u64, div_u64(ns, NSEC_PER_USEC), U32_MAX);
+
+	stats->count++;
+	stats->total_us += us;
+	stats->max_us = max(stats->max_us, us);
+	stats->hist[min(fls(us), MMC_RQ_STATS_BUCKETS - 1)]++;
+}
+
+/* Called when a request completes */
+void mmc_queue_account_rq(struct mmc_queue *mq, enum mmc_rq_stats_type type,
+			  u64 start_ns)
+{
+	u64 ns = ktime_get_ns() - start_ns;
+	unsigned long flags;
+
+	if (type == MMC_RQ_STATS_MAX)
+		return;
+
+	trace_mmc_blk_rq_done(mq->card->host, type, ns);
+
+	spin_lock_irqsave(&mq->lock, flags);
+	mmc_rq_stats_add(&mq->rq_stats[type], ns);
+	spin_unlock_irqrestore(&mq->lock, flags);
+}
+
 static void __mmc_cqe_recovery_notifier(struct mmc_queue *mq)
 {
 	if (!mq->recovery_needed) {
@@ -233,9 +284,11 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 	struct mmc_card *card = mq->card;
 	struct mmc_host *host = card->host;
 	enum mmc_issue_type issue_type;
+	enum mmc_rq_stats_type stats_type;
 	enum mmc_issued issued;
 	bool get_card, cqe_retune_ok;
 	blk_status_t ret;
+	u64 start_ns;
 
 	if (mmc_card_removed(mq->card)) {
 		req->rq_flags |= RQF_QUIET;
@@ -305,8 +358,16 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	blk_mq_start_request(req);
 
+	/* A synchronous request may be gone once it is issued */
+	stats_type = mmc_rq_stats_type(req);
+	start_ns = ktime_get_ns();
+	req_to_mmc_queue_req(req)->start_ns = start_ns;
+
 	issued = mmc_blk_mq_issue_rq(mq, req);
 
+	if (issued == MMC_REQ_FINISHED)
+		mmc_queue_account_rq(mq, stats_type, start_ns);
+
 	switch (issued) {
 	case MMC_REQ_BUSY:
 		ret = BLK_STS_RESOURCE;
@@ -345,6 +406,25 @@ static const struct blk_mq_ops mmc_mq_ops = {
 	.timeout	= mmc_mq_timed_out,
 };
 
+/*
+ * SD cards manage their flash in allocation units (AU), and a write that
+ * straddles two of them, or only part fills one, is the slow path that
+ * wears the card most. Never build a request across an AU boundary, and
+ * tell the upper layers the AU is the best size to write in, so that file
+ * systems and the I/O scheduler gather writes into whole-AU CMD25s.
+ */
+static void mmc_queue_setup_sd_au(struct request_queue *q,
+				  struct mmc_card *card)
+{
+	unsigned int au = card->ssr.au;
+
+	if (!au)
+		return;
+
+	blk_queue_chunk_sectors(q, au);
+	blk_queue_io_opt(q, au << SECTOR_SHIFT);
+}
+
 static void mmc_setup_queue(struct mmc_queue *mq, struct mmc_card *card)
 {
 	struct mmc_host *host = card->host;
@@ -365,6 +445,9 @@ static void mmc_setup_queue(struct mmc_queue *mq, struct mmc_card *card)
 		     "merging was advertised but not possible");
 	blk_queue_max_segments(mq->queue, mmc_get_max_segments(host));
 
+	if (sd_au_packing && mmc_card_sd(card))
+		mmc_queue_setup_sd_au(mq->queue, card);
+
 	if (mmc_card_mmc(card) && card->ext_csd.data_sector_size) {
 		block_size = card->ext_csd.data_sector_size;
 		WARN_ON(block_size != 512 && block_size != 4096);
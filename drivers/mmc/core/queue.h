@@ -22,6 +22,25 @@ enum mmc_issue_type {
 	MMC_ISSUE_MAX,
 };
 
+/* The kinds of request timed in the queue statistics */
+enum mmc_rq_stats_type {
+	MMC_RQ_STATS_READ,
+	MMC_RQ_STATS_WRITE,
+	MMC_RQ_STATS_DISCARD,
+	MMC_RQ_STATS_FLUSH,
+	MMC_RQ_STATS_MAX,
+};
+
+/* Bucket n of a latency histogram counts latencies under 2^n us */
+#define MMC_RQ_STATS_BUCKETS	24
+
+struct mmc_rq_stats {
+	u64	count;
+	u64	total_us;
+	u32	max_us;
+	u32	hist[MMC_RQ_STATS_BUCKETS];
+};
+
 static inline struct mmc_queue_req *req_to_mmc_queue_req(struct request *rq)
 {
 	return blk_mq_rq_to_pdu(rq);
@@ -69,6 +88,7 @@ struct mmc_queue_req {
 	void			*drv_op_data;
 	unsigned int		ioc_count;
 	int			retries;
+	u64			start_ns;	/* when the request was issued */
 };
 
 struct mmc_queue {
@@ -92,6 +112,11 @@ struct mmc_queue {
 	struct request		*complete_req;
 	struct mutex		complete_lock;
 	struct work_struct	complete_work;
+
+	/* Issue to completion times, protected by lock */
+	struct mmc_rq_stats	rq_stats[MMC_RQ_STATS_MAX];
+	struct mmc_rq_stats	busy_stats;	/* card busy after writes */
+	u64			retries;
 };
 
 struct gendisk *mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card);
@@ -106,6 +131,11 @@ void mmc_cqe_recovery_notifier(struct mmc_request *mrq);
 
 enum mmc_issue_type mmc_issue_type(struct mmc_queue *mq, struct request *req);
 
+enum mmc_rq_stats_type mmc_rq_stats_type(struct request *req);
+void mmc_rq_stats_add(struct mmc_rq_stats *stats, u64 ns);
+void mmc_queue_account_rq(struct mmc_queue *mq, enum mmc_rq_stats_type type,
+			  u64 start_ns);
+
 static inline int mmc_tot_in_flight(struct mmc_queue *mq)
 {
 	return mq->in_flight[MMC_ISSUE_SYNC] +
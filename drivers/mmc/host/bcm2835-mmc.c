@@ -1379,6 +1379,7 @@ static int bcm2835_mmc_add_host(struct bcm2835_host *host)
 		dev_err(dev, "Failed to request IRQ %d: %d\n", host->irq, ret);
 		goto untasklet;
 	}
+	irq_set_latency_class(host->irq, IRQ_LATENCY_STORAGE);
 
 	ret = mmc_add_host(mmc);
 	if (ret) {
@@ -32,6 +32,8 @@
 #define SDDATA_FIFO_PIO_BURST   8
 #define CMD_DALLY_US            1
 
+#include <linux/average.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/module.h>
 #include <linux/io.h>
@@ -53,10 +55,12 @@
 #include <linux/workqueue.h>
 #include <linux/interrupt.h>
 #include <linux/highmem.h>
+#include <linux/seq_file.h>
 #include <soc/bcm2835/raspberrypi-firmware.h>
 
 /* For mmc_card_blockaddr */
 #include "../core/card.h"
+#include "mmc_hsq.h"
 
 #define DRIVER_NAME "sdhost-bcm2835"
 
@@ -143,6 +147,24 @@
 
 #define MHZ 1000000
 
+/* data->host_cookie: how the sg list of a DMA request is mapped */
+#define COOKIE_UNMAPPED		0
+#define COOKIE_PRE_MAPPED	1	/* mapped by pre_req, until post_req */
+#define COOKIE_MAPPED		2	/* mapped at request time */
+
+/* Largest PIO transfer chosen from the measured costs, in blocks */
+#define AUTO_PIO_LIMIT_MAX	8
+
+/* Running averages of the time spent in the driver per transfer, in ns */
+DECLARE_EWMA(sdhost_ns, 4, 8)
+
+struct bcm2835_sdhost_xfer_stats {
+	u64		xfers;
+	u64		blocks;
+	u64		total_ns;	/* from request to end of data */
+	u64		max_ns;
+};
+
 
 struct bcm2835_host {
 	spinlock_t		lock;
@@ -218,8 +240,19 @@ struct bcm2835_host {
 	u32				overclock_50;	/* frequency to use when 50MHz is requested (in MHz) */
 	u32				overclock;	/* Current frequency if overclocked, else zero */
 	u32				pio_limit;	/* Maximum block count for PIO (0 = always DMA) */
+	bool				auto_pio_limit;	/* Set pio_limit from the measured times */
+
+	u64				xfer_start;	/* When the current request was issued */
+	u64				xfer_cpu_ns;	/* Time in the PIO loop, or in DMA setup and completion */
+	struct ewma_sdhost_ns		pio_block_ns;	/* Average xfer_cpu_ns per PIO block */
+	struct ewma_sdhost_ns		dma_cpu_ns;	/* Average xfer_cpu_ns per DMA transfer */
+	struct bcm2835_sdhost_xfer_stats pio_stats;
+	struct bcm2835_sdhost_xfer_stats dma_stats;
+	u32				fifo_waits;	/* PIO waits for the FIFO */
 
 	u32				sectors;	/* Cached card size in sectors */
+
+	struct mmc_hsq			hsq;		/* Host software queue */
 };
 
 #if ENABLE_LOG
@@ -532,6 +565,7 @@ static void bcm2835_sdhost_dma_complete(void *param)
 	struct bcm2835_host *host = param;
 	struct mmc_data *data = host->data;
 	unsigned long flags;
+	u64 start = ktime_get_ns();
 
 	spin_lock_irqsave(&host->lock, flags);
 	log_event("DMA<", host->data, bcm2835_sdhost_read(host, SDHSTS));
@@ -539,9 +573,9 @@ static void bcm2835_sdhost_dma_complete(void *param)
 		  bcm2835_sdhost_read(host, SDEDM));
 
 	if (host->dma_chan) {
-		dma_unmap_sg(host->dma_chan->device->dev,
-			     data->sg, data->sg_len,
-			     host->dma_dir);
+		/* A pre_req mapping is undone by post_req */
+		if (data->host_cookie == COOKIE_MAPPED)
+			bcm2835_sdhost_unmap_dma(host, data);
 
 		host->dma_chan = NULL;
 	}
@@ -569,6 +603,7 @@ static void bcm2835_sdhost_dma_complete(void *param)
 		kunmap_atomic(page);
 	}
 
+	host->xfer_cpu_ns += ktime_get_ns() - start;
 	bcm2835_sdhost_finish_data(host);
 
 	log_event("DMA>", host->data, 0);
@@ -641,6 +676,7 @@ static void bcm2835_sdhost_read_block_pio(struct bcm2835_host *host)
 					hsts = SDHSTS_REW_TIME_OUT;
 					break;
 				}
+				host->fifo_waits++;
 				ndelay((burst_words - words) *
 				       host->ns_per_fifo_word);
 				continue;
@@ -731,6 +767,7 @@ static void bcm2835_sdhost_write_block_pio(struct bcm2835_host *host)
 					hsts = SDHSTS_REW_TIME_OUT;
 					break;
 				}
+				host->fifo_waits++;
 				ndelay((burst_words - words) *
 				       host->ns_per_fifo_word);
 				continue;
@@ -759,6 +796,7 @@ static void bcm2835_sdhost_transfer_pio(struct bcm2835_host *host)
 {
 	u32 sdhsts;
 	bool is_read;
+	u64 start = ktime_get_ns();
 	BUG_ON(!host->data);
 	log_event("XFP<", host->data, host->blocks);
 
@@ -785,15 +823,105 @@ static void bcm2835_sdhost_transfer_pio(struct bcm2835_host *host)
 		       sdhsts);
 		host->data->error = -ETIMEDOUT;
 	}
+	host->xfer_cpu_ns += ktime_get_ns() - start;
 	log_event("XFP>", host->data, host->blocks);
 }
 
+static inline bool bcm2835_sdhost_use_dma(struct bcm2835_host *host,
+					  struct mmc_data *data)
+{
+	/* pio_limit may have moved since pre_req mapped the request */
+	return host->use_dma && data &&
+		((data->host_cookie == COOKIE_PRE_MAPPED) ||
+		 (data->blocks > host->pio_limit));
+}
+
+/* The block doesn't manage the FIFO DREQs properly for multi-block
+   reads, so the final few words are not DMAed but drained by the CPU. */
+static inline u32 bcm2835_sdhost_drain_len(struct mmc_data *data)
+{
+	if ((data->blocks > 1) && (data->flags & MMC_DATA_READ))
+		return min((u32)(FIFO_READ_THRESHOLD - 1) * 4,
+			   (u32)data->blocks * data->blksz);
+	return 0;
+}
+
+/* Map the sg list for DMA, unless pre_req already has. This doesn't touch
+   the host state, so it can be done for a request before the current one
+   has completed. */
+static int bcm2835_sdhost_map_dma(struct bcm2835_host *host,
+				  struct mmc_data *data, s32 cookie)
+{
+	struct dma_chan *dma_chan = host->dma_chan_rxtx;
+	u32 len = bcm2835_sdhost_drain_len(data);
+
+	if (data->host_cookie == COOKIE_PRE_MAPPED)
+		return data->sg_count;
+
+	BUG_ON(!dma_chan->device);
+	BUG_ON(!dma_chan->device->dev);
+	BUG_ON(!data->sg);
+
+	/* Unfortunately the drain requires the final sg entry to be trimmed.
+	   N.B. This code demands that the overspill is contained in
+	   a single sg entry.
+	*/
+	if (len) {
+		struct scatterlist *sg = sg_last(data->sg, data->sg_len);
+
+		BUG_ON(sg->length < len);
+		sg->length -= len;
+	}
+
+	data->sg_count = dma_map_sg(dma_chan->device->dev, data->sg,
+				    data->sg_len, mmc_get_dma_dir(data));
+	if (data->sg_count > 0)
+		data->host_cookie = cookie;
+	else if (len)
+		/* Left to PIO, which moves the whole request */
+		sg_last(data->sg, data->sg_len)->length += len;
+
+	return data->sg_count;
+}
+
+static void bcm2835_sdhost_unmap_dma(struct bcm2835_host *host,
+				     struct mmc_data *data)
+{
+	dma_unmap_sg(host->dma_chan_rxtx->device->dev, data->sg, data->sg_len,
+		     mmc_get_dma_dir(data));
+	data->host_cookie = COOKIE_UNMAPPED;
+}
+
+static void bcm2835_sdhost_pre_req(struct mmc_host *mmc,
+				   struct mmc_request *mrq)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!bcm2835_sdhost_use_dma(host, data))
+		return;
+
+	data->host_cookie = COOKIE_UNMAPPED;
+	bcm2835_sdhost_map_dma(host, data, COOKIE_PRE_MAPPED);
+}
+
+static void bcm2835_sdhost_post_req(struct mmc_host *mmc,
+				    struct mmc_request *mrq, int err)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (data && data->host_cookie != COOKIE_UNMAPPED)
+		bcm2835_sdhost_unmap_dma(host, data);
+}
+
 static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 	struct mmc_data *data)
 {
 	int len, dir_data, dir_slave;
 	struct dma_async_tx_descriptor *desc = NULL;
 	struct dma_chan *dma_chan;
+	u64 start = ktime_get_ns();
 
 	log_event("PRD<", data, 0);
 	pr_debug("bcm2835_sdhost_prepare_dma()\n");
@@ -808,35 +936,15 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 	}
 	log_event("PRD1", dma_chan, 0);
 
-	BUG_ON(!dma_chan->device);
-	BUG_ON(!dma_chan->device->dev);
-	BUG_ON(!data->sg);
+	len = bcm2835_sdhost_map_dma(host, data, COOKIE_MAPPED);
 
-	/* The block doesn't manage the FIFO DREQs properly for multi-block
-	   transfers, so don't attempt to DMA the final few words.
-	   Unfortunately this requires the final sg entry to be trimmed.
-	   N.B. This code demands that the overspill is contained in
-	   a single sg entry.
-	*/
+	/* The last sg entry has been trimmed by the drain length */
+	host->drain_words = bcm2835_sdhost_drain_len(data) / 4;
+	if (host->drain_words) {
+		struct scatterlist *sg = sg_last(data->sg, data->sg_len);
 
-	host->drain_words = 0;
-	if ((data->blocks > 1) && (dir_data == DMA_FROM_DEVICE)) {
-		struct scatterlist *sg;
-		u32 len;
-		int i;
-
-		len = min((u32)(FIFO_READ_THRESHOLD - 1) * 4,
-			  (u32)data->blocks * data->blksz);
-
-		for_each_sg(data->sg, sg, data->sg_len, i) {
-			if (sg_is_last(sg)) {
-				BUG_ON(sg->length < len);
-				sg->length -= len;
-				host->drain_page = sg_page(sg);
-				host->drain_offset = sg->offset + sg->length;
-			}
-		}
-		host->drain_words = len/4;
+		host->drain_page = sg_page(sg);
+		host->drain_offset = sg->offset + sg->length;
 	}
 
 	/* The parameters have already been validated, so this will not fail */
@@ -845,9 +953,6 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 				     &host->dma_cfg_rx :
 				     &host->dma_cfg_tx);
 
-	len = dma_map_sg(dma_chan->device->dev, data->sg, data->sg_len,
-			 dir_data);
-
 	log_event("PRD2", len, 0);
 	if (len > 0)
 		desc = dmaengine_prep_slave_sg(dma_chan, data->sg,
@@ -862,6 +967,7 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 		host->dma_chan = dma_chan;
 		host->dma_dir = dir_data;
 	}
+	host->xfer_cpu_ns += ktime_get_ns() - start;
 	log_event("PDM>", data, 0);
 }
 
@@ -1085,6 +1191,49 @@ static void bcm2835_sdhost_finish_command(struct bcm2835_host *host,
 					  unsigned long *irq_flags);
 static void bcm2835_sdhost_transfer_complete(struct bcm2835_host *host);
 
+/* The time a PIO transfer spends in the driver grows with its block
+   count, that of a DMA transfer (mapping, descriptor setup and completion)
+   barely depends on it. Set pio_limit to the block count at which both
+   take the same time, between 1 and AUTO_PIO_LIMIT_MAX. The times are
+   measured with ktime_get_ns(), so they include any interrupts taken
+   meanwhile. */
+static void bcm2835_sdhost_update_pio_limit(struct bcm2835_host *host)
+{
+	unsigned long pio_block_ns = ewma_sdhost_ns_read(&host->pio_block_ns);
+	unsigned long dma_cpu_ns = ewma_sdhost_ns_read(&host->dma_cpu_ns);
+
+	if (!pio_block_ns || !dma_cpu_ns)
+		return;
+
+	host->pio_limit = clamp_t(unsigned long, dma_cpu_ns / pio_block_ns,
+				  1, AUTO_PIO_LIMIT_MAX);
+}
+
+static void bcm2835_sdhost_account_data(struct bcm2835_host *host,
+					struct mmc_data *data)
+{
+	struct bcm2835_sdhost_xfer_stats *stats;
+	u64 ns = ktime_get_ns() - host->xfer_start;
+
+	stats = host->dma_desc ? &host->dma_stats : &host->pio_stats;
+	stats->xfers++;
+	stats->blocks += data->blocks;
+	stats->total_ns += ns;
+	stats->max_ns = max(stats->max_ns, ns);
+
+	if (data->error)
+		return;
+
+	if (host->dma_desc)
+		ewma_sdhost_ns_add(&host->dma_cpu_ns, host->xfer_cpu_ns);
+	else
+		ewma_sdhost_ns_add(&host->pio_block_ns,
+				   div_u64(host->xfer_cpu_ns, data->blocks));
+
+	if (host->auto_pio_limit)
+		bcm2835_sdhost_update_pio_limit(host);
+}
+
 static void bcm2835_sdhost_finish_data(struct bcm2835_host *host)
 {
 	struct mmc_data *data;
@@ -1092,6 +1241,8 @@ static void bcm2835_sdhost_finish_data(struct bcm2835_host *host)
 	data = host->data;
 	BUG_ON(!data);
 
+	bcm2835_sdhost_account_data(host, data);
+
 	log_event("FDA<", host->mrq, host->cmd);
 	pr_debug("finish_data(error %d, stop %d, sbc %d)\n",
 	       data->error, data->stop ? 1 : 0,
@@ -1646,6 +1797,14 @@ void bcm2835_sdhost_set_clock(struct bcm2835_host *host, unsigned int clock)
 	spin_unlock_irqrestore(&host->lock, flags);
 }
 
+static void bcm2835_sdhost_request_done(struct bcm2835_host *host,
+					struct mmc_request *mrq)
+{
+	/* Completing a queued request issues the next one */
+	if (!mmc_hsq_finalize_request(host->mmc, mrq))
+		mmc_request_done(host->mmc, mrq);
+}
+
 static void bcm2835_sdhost_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct bcm2835_host *host;
@@ -1684,12 +1843,14 @@ static void bcm2835_sdhost_request(struct mmc_host *mmc, struct mmc_request *mrq
 		pr_err("%s: unsupported block size (%d bytes)\n",
 		       mmc_hostname(mmc), mrq->data->blksz);
 		mrq->cmd->error = -EINVAL;
-		mmc_request_done(mmc, mrq);
+		bcm2835_sdhost_request_done(host, mrq);
 		return;
 	}
 
-	if (host->use_dma && mrq->data &&
-	    (mrq->data->blocks > host->pio_limit))
+	host->xfer_start = ktime_get_ns();
+	host->xfer_cpu_ns = 0;
+
+	if (bcm2835_sdhost_use_dma(host, mrq->data))
 		bcm2835_sdhost_prepare_dma(host, mrq->data);
 
 	if (host->reset_clock)
@@ -1744,6 +1905,22 @@ static void bcm2835_sdhost_request(struct mmc_host *mmc, struct mmc_request *mrq
 	spin_unlock_irqrestore(&host->lock, flags);
 }
 
+/* Called by the software queue from the completion of the previous
+   request, so the card doesn't sit idle waiting for the block layer. */
+static int bcm2835_sdhost_request_atomic(struct mmc_host *mmc,
+					 struct mmc_request *mrq)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+
+	/* Setting the clock goes through the firmware, which may sleep */
+	if (host->reset_clock)
+		return -EBUSY;
+
+	bcm2835_sdhost_request(mmc, mrq);
+
+	return 0;
+}
+
 static void bcm2835_sdhost_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 {
 
@@ -1781,6 +1958,9 @@ static void bcm2835_sdhost_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 
 static struct mmc_host_ops bcm2835_sdhost_ops = {
 	.request = bcm2835_sdhost_request,
+	.request_atomic = bcm2835_sdhost_request_atomic,
+	.pre_req = bcm2835_sdhost_pre_req,
+	.post_req = bcm2835_sdhost_post_req,
 	.set_ios = bcm2835_sdhost_set_ios,
 // todo:fix	.hw_reset = bcm2835_sdhost_reset,
 };
@@ -1888,10 +2068,44 @@ static void bcm2835_sdhost_tasklet_finish(unsigned long param)
 				mmc_hostname(host->mmc));
 	}
 
-	mmc_request_done(host->mmc, mrq);
+	bcm2835_sdhost_request_done(host, mrq);
 	log_event("TSK>", mrq, 0);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void bcm2835_sdhost_show_xfer_stats(struct seq_file *m,
+	const char *name, struct bcm2835_sdhost_xfer_stats *stats)
+{
+	u64 avg_ns = stats->xfers ? div64_u64(stats->total_ns, stats->xfers) : 0;
+
+	seq_printf(m, "%s: %llu transfers, %llu blocks, "
+		   "avg %llu us, max %llu us\n",
+		   name, stats->xfers, stats->blocks,
+		   div_u64(avg_ns, 1000), div_u64(stats->max_ns, 1000));
+}
+
+static int bcm2835_sdhost_stats_show(struct seq_file *m, void *unused)
+{
+	struct bcm2835_host *host = m->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+	bcm2835_sdhost_show_xfer_stats(m, "pio", &host->pio_stats);
+	bcm2835_sdhost_show_xfer_stats(m, "dma", &host->dma_stats);
+	seq_printf(m, "pio fifo waits: %u\n", host->fifo_waits);
+	seq_printf(m, "pio cpu per block: %lu ns\n",
+		   ewma_sdhost_ns_read(&host->pio_block_ns));
+	seq_printf(m, "dma cpu per transfer: %lu ns\n",
+		   ewma_sdhost_ns_read(&host->dma_cpu_ns));
+	seq_printf(m, "pio limit: %u blocks (%s)\n", host->pio_limit,
+		   host->auto_pio_limit ? "auto" : "fixed");
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bcm2835_sdhost_stats);
+#endif
+
 int bcm2835_sdhost_add_host(struct bcm2835_host *host)
 {
 	struct mmc_host *mmc;
@@ -1979,6 +2193,10 @@ int bcm2835_sdhost_add_host(struct bcm2835_host *host)
 
 	timer_setup(&host->timer, bcm2835_sdhost_timeout, 0);
 
+	ret = mmc_hsq_init(&host->hsq, mmc);
+	if (ret)
+		goto untasklet;
+
 	bcm2835_sdhost_init(host, 0);
 
 	ret = request_irq(host->irq, bcm2835_sdhost_irq, 0 /*IRQF_SHARED*/,
@@ -1988,9 +2206,15 @@ int bcm2835_sdhost_add_host(struct bcm2835_host *host)
 		       mmc_hostname(mmc), host->irq, ret);
 		goto untasklet;
 	}
+	irq_set_latency_class(host->irq, IRQ_LATENCY_STORAGE);
 
 	mmc_add_host(mmc);
 
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("sdhost_stats", 0444, mmc->debugfs_root, host,
+			    &bcm2835_sdhost_stats_fops);
+#endif
+
 	pio_limit_string[0] = '\0';
 	if (host->use_dma && (host->pio_limit > 0))
 		sprintf(pio_limit_string, " (>%d)", host->pio_limit);
@@ -2028,6 +2252,9 @@ static int bcm2835_sdhost_probe(struct platform_device *pdev)
 	host->mmc = mmc;
 	host->pio_timeout = msecs_to_jiffies(500);
 	host->pio_limit = 1;
+	host->auto_pio_limit = true;
+	ewma_sdhost_ns_init(&host->pio_block_ns);
+	ewma_sdhost_ns_init(&host->dma_cpu_ns);
 	host->max_delay = 1; /* Warn if over 1ms */
 	host->allow_dma = 1;
 	spin_lock_init(&host->lock);
@@ -2048,9 +2275,10 @@ static int bcm2835_sdhost_probe(struct platform_device *pdev)
 		of_property_read_u32(node,
 				     "brcm,overclock-50",
 				     &host->user_overclock_50);
-		of_property_read_u32(node,
-				     "brcm,pio-limit",
-				     &host->pio_limit);
+		if (!of_property_read_u32(node,
+					  "brcm,pio-limit",
+					  &host->pio_limit))
+			host->auto_pio_limit = false;
 		host->allow_dma =
 			!of_property_read_bool(node, "brcm,force-pio");
 		host->debug = of_property_read_bool(node, "brcm,debug");
@@ -1333,6 +1333,7 @@ static int bcm2835_add_host(struct bcm2835_host *host)
 		dev_err(dev, "failed to request IRQ %d: %d\n", host->irq, ret);
 		return ret;
 	}
+	irq_set_latency_class(host->irq, IRQ_LATENCY_STORAGE);
 
 	ret = mmc_add_host(mmc);
 	if (ret) {
@@ -8,6 +8,7 @@
 #include <linux/io.h>
 #include <linux/mmc/host.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/of.h>
 #include <linux/bitops.h>
 #include <linux/delay.h>
@@ -32,6 +33,11 @@
 
 #define SDHCI_ARASAN_CQE_BASE_ADDR		0x200
 
+static unsigned int cqe_qdepth;
+module_param(cqe_qdepth, uint, 0444);
+MODULE_PARM_DESC(cqe_qdepth,
+		 "Limit on the command queue depth (default: all task slots)");
+
 #define SDIO_CFG_CTRL				0x0
 #define  SDIO_CFG_CTRL_SDCD_N_TEST_EN		BIT(31)
 #define  SDIO_CFG_CTRL_SDCD_N_TEST_LEV		BIT(30)
@@ -436,7 +442,7 @@ static const struct cqhci_host_ops sdhci_brcmstb_cqhci_ops = {
 static struct sdhci_ops sdhci_brcmstb_ops = {
 	.set_clock = sdhci_set_clock,
 	.set_bus_width = sdhci_set_bus_width,
-	.reset = sdhci_reset,
+	.reset = brcmstb_reset,
 	.set_uhs_signaling = sdhci_set_uhs_signaling,
 };
 
@@ -450,7 +456,7 @@ static struct sdhci_ops sdhci_brcmstb_ops_2712 = {
 	.set_clock = sdhci_set_clock,
 	.set_power = sdhci_brcmstb_set_power,
 	.set_bus_width = sdhci_set_bus_width,
-	.reset = sdhci_reset,
+	.reset = brcmstb_reset,
 	.set_uhs_signaling = sdhci_set_uhs_signaling,
 	.init_sd_express = bcm2712_init_sd_express,
 };
@@ -541,6 +547,14 @@ static int sdhci_brcmstb_add_host(struct sdhci_host *host,
 	if (ret)
 		goto cleanup;
 
+	/*
+	 * A shallower queue bounds how long a read can wait behind queued
+	 * writes. The descriptors are only allocated on first enable, so
+	 * it's not too late to shrink them.
+	 */
+	if (cqe_qdepth && cqe_qdepth < host->mmc->cqe_qdepth)
+		host->mmc->cqe_qdepth = cqe_qdepth;
+
 	ret = __sdhci_add_host(host);
 	if (ret)
 		goto cleanup;
@@ -748,6 +762,13 @@ static int sdhci_brcmstb_suspend(struct device *dev)
 	struct sdhci_host *host = dev_get_drvdata(dev);
 	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
 	struct sdhci_brcmstb_priv *priv = sdhci_pltfm_priv(pltfm_host);
+	int ret;
+
+	if (priv->flags & BRCMSTB_PRIV_FLAGS_HAS_CQE) {
+		ret = cqhci_suspend(host->mmc);
+		if (ret)
+			return ret;
+	}
 
 	clk_disable_unprepare(priv->base_clk);
 	return sdhci_pltfm_suspend(dev);
@@ -774,6 +795,9 @@ static int sdhci_brcmstb_resume(struct device *dev)
 			ret = clk_set_rate(priv->base_clk, priv->base_freq_hz);
 	}
 
+	if (!ret && (priv->flags & BRCMSTB_PRIV_FLAGS_HAS_CQE))
+		ret = cqhci_resume(host->mmc);
+
 	return ret;
 }
 #endif
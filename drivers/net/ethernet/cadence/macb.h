@@ -13,6 +13,9 @@
 #include <linux/net_tstamp.h>
 #include <linux/interrupt.h>
 #include <linux/phy/phy.h>
+#include <linux/hrtimer.h>
+#include <net/page_pool.h>
+#include <net/xdp.h>
 
 #if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) || defined(CONFIG_MACB_USE_HWSTAMP)
 #define MACB_EXT_DESC
@@ -1238,12 +1241,22 @@ struct macb_queue {
 	bool			tx_pending;
 	struct napi_struct	napi_tx;
 
+	/* ETF offload: one frame at a time is held until its launch time,
+	 * its first descriptor owned by software, at txtime_head
+	 */
+	bool			txtime;
+	bool			txtime_held;
+	unsigned int		txtime_head;
+	struct hrtimer		txtime_timer;
+
 	dma_addr_t		rx_ring_dma;
 	dma_addr_t		rx_buffers_dma;
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	struct page		**rx_pages;
+	struct page_pool	*page_pool;
+	struct xdp_rxq_info	xdp_rxq;
 	void			*rx_buffers;
 	struct napi_struct	napi_rx;
 	struct queue_stats stats;
@@ -1274,6 +1287,8 @@ struct macb {
 	void	(*macb_reg_writel)(struct macb *bp, int offset, u32 value);
 
 	size_t			rx_buffer_size;
+	unsigned int		rx_page_order;
+	struct bpf_prog		*xdp_prog;
 
 	unsigned int		rx_ring_size;
 	unsigned int		tx_ring_size;
@@ -1337,6 +1352,10 @@ struct macb {
 	struct ptp_clock *ptp_clock;
 	struct ptp_clock_info ptp_clock_info;
 	struct tsu_incr tsu_incr;
+	/* Follows the PHC frequency, e.g. the PLL of the I2S clocks */
+	struct clk *audio_clk;
+	unsigned long audio_nominal_rate;
+	unsigned long audio_rate;
 	struct hwtstamp_config tstamp_config;
 
 	/* RX queue filer rule set*/
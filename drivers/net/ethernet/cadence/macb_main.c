@@ -39,6 +39,9 @@
 #include <linux/ptp_classify.h>
 #include <linux/reset.h>
 #include <linux/firmware/xlnx-zynqmp.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <net/pkt_sched.h>
 #include "macb.h"
 
 static unsigned int txdelay = 35;
@@ -1066,6 +1069,8 @@ static void macb_tx_error_task(struct work_struct *work)
 	 * network engine about the macb/gem being halted.
 	 */
 	napi_disable(&queue->napi_tx);
+	hrtimer_cancel(&queue->txtime_timer);
+	queue->txtime_held = false;
 	spin_lock_irqsave(&bp->lock, flags);
 
 	/* Make sure nobody is trying to queue up new packets */
@@ -1186,6 +1191,13 @@ static bool ptp_one_step_sync(struct sk_buff *skb)
 	return false;
 }
 
+/* A held frame still has TX_USED set, it mustn't look transmitted */
+static bool macb_tx_held(struct macb_queue *queue, unsigned int tail)
+{
+	return smp_load_acquire(&queue->txtime_held) &&
+	       tail == queue->txtime_head;
+}
+
 static int macb_tx_complete(struct macb_queue *queue, int budget)
 {
 	struct macb *bp = queue->bp;
@@ -1204,6 +1216,9 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 
 		desc = macb_tx_desc(queue, tail);
 
+		if (macb_tx_held(queue, tail))
+			break;
+
 		/* Make hw descriptor updates visible to CPU */
 		rmb();
 
@@ -1254,6 +1269,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 
 	queue->tx_tail = tail;
 	if (__netif_subqueue_stopped(bp->dev, queue_index) &&
+	    !READ_ONCE(queue->txtime_held) &&
 	    CIRC_CNT(queue->tx_head, queue->tx_tail,
 		     bp->tx_ring_size) <= MACB_TX_WAKEUP_THRESH(bp))
 		netif_wake_subqueue(bp->dev, queue_index);
@@ -1265,7 +1281,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 static void gem_rx_refill(struct macb_queue *queue)
 {
 	unsigned int		entry;
-	struct sk_buff		*skb;
+	struct page		*page;
 	dma_addr_t		paddr;
 	struct macb *bp = queue->bp;
 	struct macb_dma_desc *desc;
@@ -1279,25 +1295,19 @@ static void gem_rx_refill(struct macb_queue *queue)
 
 		desc = macb_rx_desc(queue, entry);
 
-		if (!queue->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		if (!queue->rx_pages[entry]) {
+			/* allocate a page for this free entry in ring */
+			page = page_pool_dev_alloc_pages(queue->page_pool);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
+					   "Unable to allocate RX page\n");
 				break;
 			}
 
 			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
-			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
-				break;
-			}
-
-			queue->rx_skbuff[entry] = skb;
+			paddr = page_pool_get_dma_addr(page) +
+				XDP_PACKET_HEADROOM;
+			queue->rx_pages[entry] = page;
 
 			if (entry == bp->rx_ring_size - 1)
 				paddr |= MACB_BIT(RX_WRAP);
@@ -1307,9 +1317,6 @@ static void gem_rx_refill(struct macb_queue *queue)
 			 */
 			dma_wmb();
 			macb_set_addr(bp, desc, paddr);
-
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
 		} else {
 			desc->ctrl = 0;
 			dma_wmb();
@@ -1346,19 +1353,63 @@ static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 	 */
 }
 
+/* The RX page holds the headroom, the buffer and the skb_shared_info */
+static unsigned int gem_rx_page_order(size_t rx_buffer_size)
+{
+	return get_order(XDP_PACKET_HEADROOM + rx_buffer_size +
+			 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
+}
+
+/* Returns true if the page was consumed by the program */
+static bool gem_run_xdp(struct macb_queue *queue, struct bpf_prog *prog,
+			struct xdp_buff *xdp, struct page *page,
+			bool *redirect)
+{
+	struct net_device *dev = queue->bp->dev;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return false;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(dev, xdp, prog))
+			break;
+		*redirect = true;
+		return true;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	page_pool_recycle_direct(queue->page_pool, page);
+	return true;
+}
+
 static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		  int budget)
 {
 	struct macb *bp = queue->bp;
-	unsigned int		len;
+	struct bpf_prog		*prog = READ_ONCE(bp->xdp_prog);
+	unsigned int		frame_size = PAGE_SIZE << bp->rx_page_order;
+	unsigned int		len, headroom;
 	unsigned int		entry;
 	struct sk_buff		*skb;
+	struct page		*page;
 	struct macb_dma_desc	*desc;
+	struct xdp_buff		xdp;
+	bool			redirect = false;
 	int			count = 0;
 
+	xdp_init_buff(&xdp, frame_size, &queue->xdp_rxq);
+
 	while (count < budget) {
 		u32 ctrl;
-		dma_addr_t addr;
 		bool rxused;
 
 		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
@@ -1368,7 +1419,6 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		rmb();
 
 		rxused = (desc->addr & MACB_BIT(RX_USED)) ? true : false;
-		addr = macb_get_addr(bp, desc);
 
 		if (!rxused)
 			break;
@@ -1388,8 +1438,8 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			queue->stats.rx_dropped++;
 			break;
 		}
-		skb = queue->rx_skbuff[entry];
-		if (unlikely(!skb)) {
+		page = queue->rx_pages[entry];
+		if (unlikely(!page)) {
 			netdev_err(bp->dev,
 				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
@@ -1397,14 +1447,37 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			break;
 		}
 		/* now everything is ready for receiving packet */
-		queue->rx_skbuff[entry] = NULL;
+		queue->rx_pages[entry] = NULL;
 		len = ctrl & bp->rx_frm_len_mask;
+		/* the MAC stores the frame RBOF bytes into the buffer */
+		headroom = XDP_PACKET_HEADROOM + NET_IP_ALIGN;
 
 		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
 
+		dma_sync_single_for_cpu(&bp->pdev->dev,
+					page_pool_get_dma_addr(page) + headroom,
+					len, DMA_FROM_DEVICE);
+
+		if (prog) {
+			xdp_prepare_buff(&xdp, page_address(page), headroom,
+					 len, false);
+			if (gem_run_xdp(queue, prog, &xdp, page, &redirect))
+				continue;
+			/* the program may have moved the frame */
+			headroom = xdp.data - xdp.data_hard_start;
+			len = xdp.data_end - xdp.data;
+		}
+
+		skb = napi_build_skb(page_address(page), frame_size);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(queue->page_pool, page);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			continue;
+		}
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, headroom);
 		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
 
 		skb->protocol = eth_type_trans(skb, bp->dev);
 		skb_checksum_none_assert(skb);
@@ -1432,6 +1505,9 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		napi_gro_receive(napi, skb);
 	}
 
+	if (redirect)
+		xdp_do_flush();
+
 	gem_rx_refill(queue);
 
 	return count;
@@ -1684,6 +1760,10 @@ static void macb_tx_restart(struct macb_queue *queue)
 	if (queue->tx_head == queue->tx_tail)
 		goto out_tx_ptr_unlock;
 
+	/* Stopped on the held frame, its launch will restart the queue */
+	if (READ_ONCE(queue->txtime_held))
+		goto out_tx_ptr_unlock;
+
 	tbqp = queue_readl(queue, TBQP) / macb_dma_desc_get_size(bp);
 	tbqp = macb_adj_dma_desc_idx(bp, macb_tx_ring_wrap(bp, tbqp));
 	head_idx = macb_adj_dma_desc_idx(bp, macb_tx_ring_wrap(bp, queue->tx_head));
@@ -1708,7 +1788,9 @@ static bool macb_tx_complete_pending(struct macb_queue *queue)
 		/* Make hw descriptor updates visible to CPU */
 		rmb();
 
-		if (macb_tx_desc(queue, queue->tx_tail)->ctrl & MACB_BIT(TX_USED))
+		if (!macb_tx_held(queue, queue->tx_tail) &&
+		    (macb_tx_desc(queue, queue->tx_tail)->ctrl &
+		     MACB_BIT(TX_USED)))
 			retval = true;
 	}
 	spin_unlock(&queue->tx_ptr_lock);
@@ -1996,7 +2078,7 @@ static void macb_poll_controller(struct net_device *dev)
 static unsigned int macb_tx_map(struct macb *bp,
 				struct macb_queue *queue,
 				struct sk_buff *skb,
-				unsigned int hdrlen)
+				unsigned int hdrlen, bool hold)
 {
 	dma_addr_t mapping;
 	unsigned int len, entry, i, tx_head = queue->tx_head;
@@ -2136,6 +2218,9 @@ static unsigned int macb_tx_map(struct macb *bp,
 			    skb->ip_summed != CHECKSUM_PARTIAL && !lso_ctrl &&
 			    !ptp_one_step_sync(skb))
 				ctrl |= MACB_BIT(TX_NOCRC);
+			/* Keep the MAC from going past this frame */
+			if (hold)
+				ctrl |= MACB_BIT(TX_USED);
 		} else
 			/* Only set MSS/MFS on payload descriptors
 			 * (second or later descriptor)
@@ -2271,13 +2356,45 @@ static int macb_pad_and_fcs(struct sk_buff **skb, struct net_device *ndev)
 	return 0;
 }
 
+/* bp->lock sleeps on PREEMPT_RT, there the launch runs from the softirq */
+#define MACB_TXTIME_MODE	(IS_ENABLED(CONFIG_PREEMPT_RT) ? \
+				 HRTIMER_MODE_ABS_SOFT : HRTIMER_MODE_ABS_HARD)
+
+static enum hrtimer_restart macb_txtime_launch(struct hrtimer *timer)
+{
+	struct macb_queue *queue = container_of(timer, struct macb_queue,
+						txtime_timer);
+	struct macb *bp = queue->bp;
+	struct macb_dma_desc *desc;
+	unsigned long flags;
+
+	/* Hand the frame to the MAC, and then to macb_tx_complete() */
+	desc = macb_tx_desc(queue, queue->txtime_head);
+	desc->ctrl &= ~MACB_BIT(TX_USED);
+	smp_store_release(&queue->txtime_held, false);
+
+	/* Make the descriptor visible to hardware */
+	wmb();
+
+	spin_lock_irqsave(&bp->lock, flags);
+	if (macb_readl(bp, TSR) & MACB_BIT(TGO))
+		queue->tx_pending = 1;
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	spin_unlock_irqrestore(&bp->lock, flags);
+
+	netif_wake_subqueue(bp->dev, queue - bp->queues);
+
+	return HRTIMER_NORESTART;
+}
+
 static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	u16 queue_index = skb_get_queue_mapping(skb);
 	struct macb *bp = netdev_priv(dev);
 	struct macb_queue *queue = &bp->queues[queue_index];
 	unsigned int desc_cnt, nr_frags, frag_size, f;
-	unsigned int hdrlen;
+	unsigned int hdrlen, head;
+	ktime_t launch = 0;
 	bool is_lso;
 	netdev_tx_t ret = NETDEV_TX_OK;
 
@@ -2334,6 +2451,17 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	spin_lock_bh(&queue->tx_ptr_lock);
 
+	/* With ETF offload, frames due in the future wait for their time */
+	if (READ_ONCE(queue->txtime) && skb->tstamp) {
+		if (queue->txtime_held) {
+			netif_stop_subqueue(dev, queue_index);
+			ret = NETDEV_TX_BUSY;
+			goto unlock;
+		}
+		if (ktime_after(skb->tstamp, ktime_get_clocktai()))
+			launch = skb->tstamp;
+	}
+
 	/* This is a hard error, log it. */
 	if (CIRC_SPACE(queue->tx_head, queue->tx_tail,
 		       bp->tx_ring_size) < desc_cnt) {
@@ -2345,7 +2473,8 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	}
 
 	/* Map socket buffer for DMA transfer */
-	if (!macb_tx_map(bp, queue, skb, hdrlen)) {
+	head = queue->tx_head;
+	if (!macb_tx_map(bp, queue, skb, hdrlen, launch != 0)) {
 		dev_kfree_skb_any(skb);
 		goto unlock;
 	}
@@ -2354,6 +2483,14 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	wmb();
 	skb_tx_timestamp(skb);
 
+	if (launch) {
+		queue->txtime_head = head;
+		queue->txtime_held = true;
+		netif_stop_subqueue(dev, queue_index);
+		hrtimer_start(&queue->txtime_timer, launch, MACB_TXTIME_MODE);
+		goto unlock;
+	}
+
 	spin_lock_irq(&bp->lock);
 
 	/* TSTART write might get dropped, so make the IRQ retrigger a buffer read */
@@ -2386,6 +2523,7 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 			bp->rx_buffer_size =
 				roundup(bp->rx_buffer_size, RX_BUFFER_MULTIPLE);
 		}
+		bp->rx_page_order = gem_rx_page_order(bp->rx_buffer_size);
 	}
 
 	netdev_dbg(bp->dev, "mtu [%u] rx_buffer_size [%zu]\n",
@@ -2394,34 +2532,28 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
 	struct macb_queue *queue;
-	dma_addr_t		addr;
+	struct page *page;
 	unsigned int q;
 	int i;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		if (!queue->rx_skbuff)
-			continue;
-
-		for (i = 0; i < bp->rx_ring_size; i++) {
-			skb = queue->rx_skbuff[i];
-
-			if (!skb)
-				continue;
-
-			desc = macb_rx_desc(queue, i);
-			addr = macb_get_addr(bp, desc);
+		if (queue->rx_pages) {
+			for (i = 0; i < bp->rx_ring_size; i++) {
+				page = queue->rx_pages[i];
+				if (page)
+					page_pool_put_full_page(queue->page_pool,
+								page, false);
+			}
 
-			dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-					DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			skb = NULL;
+			kfree(queue->rx_pages);
+			queue->rx_pages = NULL;
 		}
 
-		kfree(queue->rx_skbuff);
-		queue->rx_skbuff = NULL;
+		if (xdp_rxq_info_is_reg(&queue->xdp_rxq))
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+		page_pool_destroy(queue->page_pool);
+		queue->page_pool = NULL;
 	}
 }
 
@@ -2465,19 +2597,46 @@ static void macb_free_consistent(struct macb *bp)
 
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
+	struct page_pool_params pp_params = {
+		.order = bp->rx_page_order,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = bp->rx_ring_size,
+		.nid = NUMA_NO_NODE,
+		.dev = &bp->pdev->dev,
+		.dma_dir = DMA_FROM_DEVICE,
+		.offset = XDP_PACKET_HEADROOM,
+		.max_len = bp->rx_buffer_size,
+	};
 	struct macb_queue *queue;
 	unsigned int q;
-	int size;
+	int size, err;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		size = bp->rx_ring_size * sizeof(struct sk_buff *);
-		queue->rx_skbuff = kzalloc(size, GFP_KERNEL);
-		if (!queue->rx_skbuff)
+		queue->page_pool = page_pool_create(&pp_params);
+		if (IS_ERR(queue->page_pool)) {
+			err = PTR_ERR(queue->page_pool);
+			queue->page_pool = NULL;
+			return err;
+		}
+
+		err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q,
+				       queue->napi_rx.napi_id);
+		if (err)
+			return err;
+		err = xdp_rxq_info_reg_mem_model(&queue->xdp_rxq,
+						 MEM_TYPE_PAGE_POOL,
+						 queue->page_pool);
+		if (err)
+			return err;
+
+		size = bp->rx_ring_size * sizeof(struct page *);
+		queue->rx_pages = kzalloc(size, GFP_KERNEL);
+		if (!queue->rx_pages)
 			return -ENOMEM;
 		else
 			netdev_dbg(bp->dev,
-				   "Allocated %d RX struct sk_buff entries at %p\n",
-				   bp->rx_ring_size, queue->rx_skbuff);
+				   "Allocated %d RX page entries at %p\n",
+				   bp->rx_ring_size, queue->rx_pages);
 	}
 	return 0;
 }
@@ -2986,6 +3145,8 @@ static int macb_close(struct net_device *dev)
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
 		napi_disable(&queue->napi_rx);
 		napi_disable(&queue->napi_tx);
+		hrtimer_cancel(&queue->txtime_timer);
+		queue->txtime_held = false;
 	}
 
 	phylink_stop(bp->phylink);
@@ -3008,16 +3169,89 @@ static int macb_close(struct net_device *dev)
 	return 0;
 }
 
+static size_t gem_rx_buffer_size(unsigned int mtu)
+{
+	return roundup(mtu + ETH_HLEN + ETH_FCS_LEN + NET_IP_ALIGN,
+		       RX_BUFFER_MULTIPLE);
+}
+
 static int macb_change_mtu(struct net_device *dev, int new_mtu)
 {
+	struct macb *bp = netdev_priv(dev);
+
 	if (netif_running(dev))
 		return -EBUSY;
 
+	/* XDP frames must fit in one page */
+	if (bp->xdp_prog && gem_rx_page_order(gem_rx_buffer_size(new_mtu))) {
+		netdev_err(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	dev->mtu = new_mtu;
 
 	return 0;
 }
 
+static int macb_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			  struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+
+	if (!macb_is_gem(bp)) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP needs a GEM");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && gem_rx_page_order(gem_rx_buffer_size(dev->mtu))) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* The buffers always have XDP headroom, so nothing to reallocate */
+	old_prog = xchg(&bp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+/* The launch times are CLOCK_TAI, as for the ETF qdisc's default clock */
+static int macb_setup_etf(struct net_device *dev,
+			  struct tc_etf_qopt_offload *qopt)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	if (qopt->queue < 0 || qopt->queue >= bp->num_queues)
+		return -EINVAL;
+
+	WRITE_ONCE(bp->queues[qopt->queue].txtime, qopt->enable);
+
+	return 0;
+}
+
+static int macb_setup_tc(struct net_device *dev, enum tc_setup_type type,
+			 void *type_data)
+{
+	switch (type) {
+	case TC_SETUP_QDISC_ETF:
+		return macb_setup_etf(dev, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int macb_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return macb_xdp_setup(dev, bpf->prog, bpf->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
 static void gem_update_stats(struct macb *bp)
 {
 	struct macb_queue *queue;
@@ -3913,6 +4147,8 @@ static const struct net_device_ops macb_netdev_ops = {
 #endif
 	.ndo_set_features	= macb_set_features,
 	.ndo_features_check	= macb_features_check,
+	.ndo_bpf		= macb_bpf,
+	.ndo_setup_tc		= macb_setup_tc,
 };
 
 /* Configure peripheral capabilities according to device tree
@@ -4148,6 +4384,8 @@ static int macb_init(struct platform_device *pdev)
 		}
 
 		INIT_WORK(&queue->tx_error_task, macb_tx_error_task);
+		hrtimer_init(&queue->txtime_timer, CLOCK_TAI, MACB_TXTIME_MODE);
+		queue->txtime_timer.function = macb_txtime_launch;
 		q++;
 	}
 
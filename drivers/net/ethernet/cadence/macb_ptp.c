@@ -119,6 +119,45 @@ static int gem_tsu_incr_set(struct macb *bp, struct tsu_incr *incr_spec)
 	return 0;
 }
 
+/* The TSU and the audio clock share a crystal, so whatever adjustment
+ * locks the PHC to the grandmaster also locks the sample rate to it.
+ */
+static void gem_ptp_steer_audio(struct macb *bp, long scaled_ppm)
+{
+	unsigned long rate, nominal;
+	u64 adj;
+
+	if (!bp->audio_clk)
+		return;
+
+	/* A new rate set by the audio driver becomes the nominal one */
+	rate = clk_get_rate(bp->audio_clk);
+	if (rate != bp->audio_rate)
+		bp->audio_nominal_rate = rate;
+	nominal = bp->audio_nominal_rate;
+
+	adj = (u64)nominal * abs(scaled_ppm);
+	adj = div_u64(adj >> PPM_FRACTION, USEC_PER_SEC);
+	rate = scaled_ppm < 0 ? nominal - adj : nominal + adj;
+
+	if (clk_set_rate(bp->audio_clk, rate))
+		dev_warn_ratelimited(&bp->pdev->dev,
+				     "cannot steer audio clock to %lu Hz\n",
+				     rate);
+	bp->audio_rate = clk_get_rate(bp->audio_clk);
+}
+
+/* Stop steering, back to the nominal rate, and release the clock */
+static void gem_ptp_put_audio_clk(struct macb *bp)
+{
+	if (!bp->audio_clk)
+		return;
+
+	gem_ptp_steer_audio(bp, 0);
+	clk_put(bp->audio_clk);
+	bp->audio_clk = NULL;
+}
+
 static int gem_ptp_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
 {
 	struct macb *bp = container_of(ptp, struct macb, ptp_clock_info);
@@ -151,6 +190,8 @@ static int gem_ptp_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
 			& ((1 << GEM_NSINCR_SIZE) - 1);
 	incr_spec.sub_ns = adj & ((1 << GEM_SUBNSINCR_SIZE) - 1);
 	gem_tsu_incr_set(bp, &incr_spec);
+
+	gem_ptp_steer_audio(bp, neg_adj ? -scaled_ppm : scaled_ppm);
 	return 0;
 }
 
@@ -372,14 +413,28 @@ void gem_ptp_init(struct net_device *dev)
 	bp->tsu_rate = bp->ptp_info->get_tsu_rate(bp);
 	bp->ptp_clock_info.max_adj = bp->ptp_info->get_ptp_max_adj();
 	gem_ptp_init_timer(bp);
+
+	bp->audio_clk = clk_get_optional(&bp->pdev->dev, "audio");
+	if (IS_ERR(bp->audio_clk)) {
+		dev_warn(&bp->pdev->dev, "audio clock not available: %ld\n",
+			 PTR_ERR(bp->audio_clk));
+		bp->audio_clk = NULL;
+	}
+	if (bp->audio_clk) {
+		bp->audio_rate = clk_get_rate(bp->audio_clk);
+		bp->audio_nominal_rate = bp->audio_rate;
+	}
+
 	bp->ptp_clock = ptp_clock_register(&bp->ptp_clock_info, &dev->dev);
 	if (IS_ERR(bp->ptp_clock)) {
 		pr_err("ptp clock register failed: %ld\n",
 			PTR_ERR(bp->ptp_clock));
 		bp->ptp_clock = NULL;
+		gem_ptp_put_audio_clk(bp);
 		return;
 	} else if (bp->ptp_clock == NULL) {
 		pr_err("ptp clock register failed\n");
+		gem_ptp_put_audio_clk(bp);
 		return;
 	}
 
@@ -405,6 +460,8 @@ void gem_ptp_remove(struct net_device *ndev)
 
 	gem_ptp_clear_timer(bp);
 
+	gem_ptp_put_audio_clk(bp);
+
 	dev_info(&bp->pdev->dev, "%s ptp clock unregistered.\n",
 		 GEM_PTP_TIMER_NAME);
 }
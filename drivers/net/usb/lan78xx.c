@@ -117,6 +117,15 @@
 #define FS_BURST_CAP_SIZE		RX_FS_URB_SIZE
 #define FS_BULK_IN_DELAY		0x2000
 
+/* Below RX_AGGR_PPS_LOW frames per second the device completes bulk-in
+ * transfers without waiting to aggregate more frames, above
+ * RX_AGGR_PPS_HIGH it waits for the bulk_in_delay of the bus speed.
+ */
+#define RX_MIN_BULK_IN_DELAY		0x0040
+#define RX_AGGR_PPS_LOW			2000
+#define RX_AGGR_PPS_HIGH		4000
+#define RX_TUNE_INTERVAL		(HZ / 10)
+
 #define TX_CMD_LEN			8
 #define TX_SKB_MIN_LEN			(TX_CMD_LEN + ETH_HLEN)
 #define LAN78XX_TSO_SIZE(dev)		((dev)->tx_urb_size - TX_SKB_MIN_LEN)
@@ -221,6 +230,10 @@ static const char lan78xx_gstrings[][ETH_GSTRING_LEN] = {
 	"TX Greater 1518 Byte Frames",
 	"EEE TX LPI Transitions",
 	"EEE TX LPI Time",
+	/* driver statistics, after the hardware ones */
+	"RX URBs",
+	"RX Frames",
+	"RX Bulk-In Delay",
 };
 
 struct lan78xx_statstage {
@@ -396,6 +409,7 @@ struct usb_context {
 #define EVENT_DEV_OPEN			8
 #define EVENT_STAT_UPDATE		9
 #define EVENT_DEV_DISCONNECT		10
+#define EVENT_RX_TUNE			11
 
 struct statstage {
 	struct mutex			access_lock;	/* for stats access */
@@ -450,6 +464,13 @@ struct lan78xx_net {
 	unsigned int		bulk_in_delay;
 	unsigned int		burst_cap;
 
+	/* RX aggregation, adapted to the frame rate by lan78xx_rx_tune() */
+	unsigned int		rx_delay;
+	unsigned long		rx_urbs;
+	unsigned long		rx_frames;
+	unsigned long		rx_tune_frames;
+	unsigned long		rx_tune_time;
+
 	unsigned long		flags;
 
 	wait_queue_head_t	*wait;
@@ -623,6 +644,11 @@ static int int_urb_interval_ms = 8;
 module_param(int_urb_interval_ms, int, 0);
 MODULE_PARM_DESC(int_urb_interval_ms, "Override usb interrupt urb interval");
 
+static bool rx_adaptive_delay = true;
+module_param(rx_adaptive_delay, bool, 0644);
+MODULE_PARM_DESC(rx_adaptive_delay,
+		 "Only aggregate received frames when the frame rate needs it");
+
 static int lan78xx_read_reg(struct lan78xx_net *dev, u32 index, u32 *data)
 {
 	u32 *buf;
@@ -1635,6 +1661,11 @@ static void lan78xx_get_stats(struct net_device *netdev,
 	mutex_lock(&dev->stats.access_lock);
 	memcpy(data, &dev->stats.curr_stat, sizeof(dev->stats.curr_stat));
 	mutex_unlock(&dev->stats.access_lock);
+
+	data += sizeof(dev->stats.curr_stat) / sizeof(*data);
+	*data++ = READ_ONCE(dev->rx_urbs);
+	*data++ = READ_ONCE(dev->rx_frames);
+	*data++ = READ_ONCE(dev->rx_delay);
 }
 
 static void lan78xx_get_wol(struct net_device *netdev,
@@ -2974,7 +3005,9 @@ static int lan78xx_reset(struct lan78xx_net *dev)
 	if (ret < 0)
 		return ret;
 
-	ret = lan78xx_write_reg(dev, BULK_IN_DLY, dev->bulk_in_delay);
+	dev->rx_delay = rx_adaptive_delay ? RX_MIN_BULK_IN_DELAY :
+					    dev->bulk_in_delay;
+	ret = lan78xx_write_reg(dev, BULK_IN_DLY, dev->rx_delay);
 	if (ret < 0)
 		return ret;
 
@@ -3661,6 +3694,7 @@ static int lan78xx_rx(struct lan78xx_net *dev, struct sk_buff *skb,
 			memcpy(skb2->data, packet, frame_len);
 
 			skb_put(skb2, frame_len);
+			dev->rx_frames++;
 
 			lan78xx_rx_csum_offload(dev, skb2, rx_cmd_a, rx_cmd_b);
 			lan78xx_rx_vlan_offload(dev, skb2, rx_cmd_a, rx_cmd_b);
@@ -3691,6 +3725,8 @@ static int lan78xx_rx(struct lan78xx_net *dev, struct sk_buff *skb,
 static inline void rx_process(struct lan78xx_net *dev, struct sk_buff *skb,
 			      int budget, int *work_done)
 {
+	dev->rx_urbs++;
+
 	if (!lan78xx_rx(dev, skb, budget, work_done)) {
 		netif_dbg(dev, rx_err, dev->net, "drop\n");
 		dev->net->stats.rx_errors++;
@@ -4021,6 +4057,36 @@ static void lan78xx_tx_bh(struct lan78xx_net *dev)
 	} while (ret == 0);
 }
 
+/* Waiting for more frames to share a transfer saves completions when
+ * frames come in fast, but delays every frame when they don't. Pick the
+ * bulk-in delay from the recent frame rate.
+ */
+static void lan78xx_rx_tune(struct lan78xx_net *dev)
+{
+	unsigned long elapsed = jiffies - dev->rx_tune_time;
+	unsigned long pps, frames;
+	unsigned int delay;
+
+	if (elapsed < RX_TUNE_INTERVAL)
+		return;
+
+	frames = dev->rx_frames - dev->rx_tune_frames;
+	dev->rx_tune_frames = dev->rx_frames;
+	dev->rx_tune_time = jiffies;
+	pps = frames * HZ / elapsed;
+
+	delay = dev->rx_delay;
+	if (!rx_adaptive_delay || pps > RX_AGGR_PPS_HIGH)
+		delay = dev->bulk_in_delay;
+	else if (pps < RX_AGGR_PPS_LOW)
+		delay = RX_MIN_BULK_IN_DELAY;
+
+	if (delay != dev->rx_delay) {
+		WRITE_ONCE(dev->rx_delay, delay);
+		lan78xx_defer_kevent(dev, EVENT_RX_TUNE);
+	}
+}
+
 static int lan78xx_bh(struct lan78xx_net *dev, int budget)
 {
 	struct sk_buff_head done;
@@ -4084,6 +4150,8 @@ static int lan78xx_bh(struct lan78xx_net *dev, int budget)
 				  jiffies + STAT_UPDATE_TIMER);
 		}
 
+		lan78xx_rx_tune(dev);
+
 		/* Submit all free Rx URBs */
 
 		if (!test_bit(EVENT_RX_HALT, &dev->flags))
@@ -4198,6 +4266,14 @@ static void lan78xx_delayedwork(struct work_struct *work)
 		}
 	}
 
+	if (test_and_clear_bit(EVENT_RX_TUNE, &dev->flags)) {
+		status = lan78xx_write_reg(dev, BULK_IN_DLY,
+					   READ_ONCE(dev->rx_delay));
+		if (status < 0)
+			netdev_dbg(dev->net, "can't set bulk-in delay, %d\n",
+				   status);
+	}
+
 	if (test_bit(EVENT_STAT_UPDATE, &dev->flags)) {
 		lan78xx_update_stats(dev);
 
@@ -33,6 +33,9 @@
 #define DEFAULT_HS_BURST_CAP_SIZE	(16 * 1024 + 5 * HS_USB_PKT_SIZE)
 #define DEFAULT_FS_BURST_CAP_SIZE	(6 * 1024 + 33 * FS_USB_PKT_SIZE)
 #define DEFAULT_BULK_IN_DELAY		(0x00002000)
+/* BULK_IN_DLY counts 60 MHz clock cycles */
+#define BULK_IN_DLY_PER_USEC		60
+#define BULK_IN_DLY_MAX			0xFFFF
 #define MAX_SINGLE_PACKET_SIZE		(2048)
 #define LAN95XX_EEPROM_MAGIC		(0x9500)
 #define EEPROM_MAC_OFFSET		(0x01)
@@ -73,6 +76,9 @@ struct smsc95xx_priv {
 	struct mii_bus *mdiobus;
 	struct phy_device *phydev;
 	struct task_struct *pm_task;
+	/* RX coalescing, set through ethtool */
+	u32 bulk_in_delay;
+	bool multi_frame;
 };
 
 static bool turbo_mode = true;
@@ -784,7 +790,82 @@ static int smsc95xx_ethtool_get_sset_count(struct net_device *ndev, int sset)
 	}
 }
 
+static int smsc95xx_set_multi_frame(struct usbnet *dev, bool on)
+{
+	u32 val;
+	int ret;
+
+	ret = smsc95xx_read_reg(dev, HW_CFG, &val);
+	if (ret < 0)
+		return ret;
+
+	if (on)
+		val |= HW_CFG_MEF_ | HW_CFG_BCE_;
+	else
+		val &= ~(HW_CFG_MEF_ | HW_CFG_BCE_);
+
+	return smsc95xx_write_reg(dev, HW_CFG, val);
+}
+
+static int smsc95xx_get_coalesce(struct net_device *netdev,
+				 struct ethtool_coalesce *coal,
+				 struct kernel_ethtool_coalesce *kernel_coal,
+				 struct netlink_ext_ack *extack)
+{
+	struct usbnet *dev = netdev_priv(netdev);
+	struct smsc95xx_priv *pdata = dev->driver_priv;
+
+	coal->rx_coalesce_usecs = DIV_ROUND_CLOSEST(pdata->bulk_in_delay,
+						    BULK_IN_DLY_PER_USEC);
+	/* Without multiple frames per transfer, every frame completes one */
+	coal->rx_max_coalesced_frames = pdata->multi_frame ? 0 : 1;
+
+	return 0;
+}
+
+/* rx-usecs is how long the device waits for more frames before it ends
+ * a bulk-in transfer. rx-frames 1 sends each frame in its own transfer,
+ * which together with rx-usecs 0 gives the lowest receive latency.
+ */
+static int smsc95xx_set_coalesce(struct net_device *netdev,
+				 struct ethtool_coalesce *coal,
+				 struct kernel_ethtool_coalesce *kernel_coal,
+				 struct netlink_ext_ack *extack)
+{
+	struct usbnet *dev = netdev_priv(netdev);
+	struct smsc95xx_priv *pdata = dev->driver_priv;
+	bool multi_frame = coal->rx_max_coalesced_frames != 1;
+	u32 delay;
+	int ret;
+
+	if (coal->rx_coalesce_usecs > BULK_IN_DLY_MAX / BULK_IN_DLY_PER_USEC) {
+		NL_SET_ERR_MSG_MOD(extack, "rx-usecs out of range");
+		return -EINVAL;
+	}
+	if (multi_frame && !turbo_mode) {
+		NL_SET_ERR_MSG_MOD(extack, "rx-frames > 1 needs turbo_mode");
+		return -EINVAL;
+	}
+
+	delay = coal->rx_coalesce_usecs * BULK_IN_DLY_PER_USEC;
+	ret = smsc95xx_write_reg(dev, BULK_IN_DLY, delay);
+	if (ret < 0)
+		return ret;
+	pdata->bulk_in_delay = delay;
+
+	if (multi_frame != pdata->multi_frame) {
+		ret = smsc95xx_set_multi_frame(dev, multi_frame);
+		if (ret < 0)
+			return ret;
+		pdata->multi_frame = multi_frame;
+	}
+
+	return 0;
+}
+
 static const struct ethtool_ops smsc95xx_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_RX_USECS |
+				     ETHTOOL_COALESCE_RX_MAX_FRAMES,
 	.get_link	= smsc95xx_get_link,
 	.nway_reset	= phy_ethtool_nway_reset,
 	.get_drvinfo	= usbnet_get_drvinfo,
@@ -803,6 +884,8 @@ static const struct ethtool_ops smsc95xx_ethtool_ops = {
 	.self_test	= net_selftest,
 	.get_strings	= smsc95xx_ethtool_get_strings,
 	.get_sset_count	= smsc95xx_ethtool_get_sset_count,
+	.get_coalesce	= smsc95xx_get_coalesce,
+	.set_coalesce	= smsc95xx_set_coalesce,
 };
 
 static int smsc95xx_ioctl(struct net_device *netdev, struct ifreq *rq, int cmd)
@@ -991,7 +1074,7 @@ static int smsc95xx_reset(struct usbnet *dev)
 		  "Read Value from BURST_CAP after writing: 0x%08x\n",
 		  read_buf);
 
-	ret = smsc95xx_write_reg(dev, BULK_IN_DLY, DEFAULT_BULK_IN_DELAY);
+	ret = smsc95xx_write_reg(dev, BULK_IN_DLY, pdata->bulk_in_delay);
 	if (ret < 0)
 		return ret;
 
@@ -1010,7 +1093,7 @@ static int smsc95xx_reset(struct usbnet *dev)
 	netif_dbg(dev, ifup, dev->net, "Read Value from HW_CFG: 0x%08x\n",
 		  read_buf);
 
-	if (turbo_mode)
+	if (pdata->multi_frame)
 		read_buf |= (HW_CFG_MEF_ | HW_CFG_BCE_);
 
 	read_buf &= ~HW_CFG_RXDOFF_;
@@ -1146,6 +1229,8 @@ static int smsc95xx_bind(struct usbnet *dev, struct usb_interface *intf)
 	dev->driver_priv = pdata;
 
 	spin_lock_init(&pdata->mac_cr_lock);
+	pdata->bulk_in_delay = DEFAULT_BULK_IN_DELAY;
+	pdata->multi_frame = turbo_mode;
 
 	/* LAN95xx devices do not alter the computed checksum of 0 to 0xffff.
 	 * RFC 2460, ipv6 UDP calculated checksum yields a result of zero must
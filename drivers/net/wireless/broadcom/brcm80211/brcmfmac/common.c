@@ -37,6 +37,10 @@ static int brcmf_sdiod_txglomsz = BRCMF_DEFAULT_TXGLOM_SIZE;
 module_param_named(txglomsz, brcmf_sdiod_txglomsz, int, 0);
 MODULE_PARM_DESC(txglomsz, "Maximum tx packet chain size [SDIO]");
 
+static int brcmf_sdiod_lowlat;
+module_param_named(sdio_lowlat, brcmf_sdiod_lowlat, int, 0);
+MODULE_PARM_DESC(sdio_lowlat, "Don't glom WMM voice frames, and time them [SDIO]");
+
 /* Debug level configuration. See debug.h for bits, sysfs modifiable */
 int brcmf_msg_level;
 module_param_named(debug, brcmf_msg_level, int, 0600);
@@ -458,8 +462,10 @@ struct brcmf_mp_device *brcmf_get_module_param(struct device *dev,
 	settings->ignore_probe_fail = !!brcmf_ignore_probe_fail;
 #endif
 
-	if (bus_type == BRCMF_BUSTYPE_SDIO)
+	if (bus_type == BRCMF_BUSTYPE_SDIO) {
 		settings->bus.sdio.txglomsz = brcmf_sdiod_txglomsz;
+		settings->sdio_lowlat = !!brcmf_sdiod_lowlat;
+	}
 
 	/* See if there is any device specific platform data configured */
 	found = false;
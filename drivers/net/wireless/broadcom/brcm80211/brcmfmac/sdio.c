@@ -434,6 +434,18 @@ struct brcmf_sdio_count {
 	ulong rx_readahead_cnt;	/* packets where header read-ahead was used */
 };
 
+/* Lowest precedence sent without glomming in low latency mode: WMM voice */
+#define BRCMF_SDIO_LOWLAT_PREC	6
+
+/*
+ * latency of the voice frames in low latency mode
+ */
+struct brcmf_sdio_lat {
+	u64 count;		/* Samples taken */
+	u64 total_ns;		/* Sum of the samples */
+	u64 max_ns;		/* Largest sample */
+};
+
 /* misc chip info needed by some of the routines */
 /* Private data for SDIO bus interaction */
 struct brcmf_sdio {
@@ -516,6 +528,7 @@ struct brcmf_sdio {
 	struct work_struct datawork;
 	bool dpc_triggered;
 	bool dpc_running;
+	ktime_t dpc_kick;	/* When the tx path queued the DPC */
 
 	bool txoff;		/* Transmit flow-controlled */
 	struct brcmf_sdio_count sdcnt;
@@ -524,6 +537,10 @@ struct brcmf_sdio {
 
 	u8 tx_hdrlen;		/* sdio bus header length for tx packet */
 	bool txglom;		/* host tx glomming enable flag */
+	bool lowlat;		/* voice frames aren't glommed */
+	uint tx_unglommed;	/* Voice frames sent on their own */
+	struct brcmf_sdio_lat dpc_lat;	/* DPC queued by tx path to running */
+	struct brcmf_sdio_lat tx_lat;	/* voice frame queued to sent */
 	u16 head_align;		/* buffer pointer alignment */
 	u16 sgentry_align;	/* scatter-gather buffer alignment */
 };
@@ -2295,6 +2312,21 @@ brcmf_sdio_txpkt_postp(struct brcmf_sdio *bus, struct sk_buff_head *pktq)
 	}
 }
 
+static bool brcmf_sdio_lowlat(struct brcmf_sdio *bus, int prec)
+{
+	return bus->lowlat && prec >= BRCMF_SDIO_LOWLAT_PREC;
+}
+
+static void brcmf_sdio_lat_add(struct brcmf_sdio_lat *lat, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	lat->count++;
+	lat->total_ns += ns;
+	if (ns > lat->max_ns)
+		lat->max_ns = ns;
+}
+
 /* Writes a HW/SW header into the packet and sends it. */
 /* Assumes: (a) header space already there, (b) caller holds lock */
 static int brcmf_sdio_txpkt(struct brcmf_sdio *bus, struct sk_buff_head *pktq,
@@ -2324,6 +2356,13 @@ static int brcmf_sdio_txpkt(struct brcmf_sdio *bus, struct sk_buff_head *pktq,
 		bus->tx_seq = (bus->tx_seq + pktq->qlen) % SDPCM_SEQ_WRAP;
 	skb_queue_walk_safe(pktq, pkt_next, tmp) {
 		__skb_unlink(pkt_next, pktq);
+		/* In low latency mode voice frames carry their queue time */
+		if (bus->lowlat) {
+			if (ret == 0 && pkt_next->tstamp)
+				brcmf_sdio_lat_add(&bus->tx_lat,
+						   pkt_next->tstamp);
+			pkt_next->tstamp = 0;
+		}
 		brcmf_proto_bcdc_txcomplete(bus->sdiodev->dev, pkt_next,
 					    ret == 0);
 	}
@@ -2360,6 +2399,12 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 			if (pkt == NULL)
 				break;
 			__skb_queue_tail(&pktq, pkt);
+			/* A voice frame doesn't wait for a glom to be sent */
+			if (bus->txglom && brcmf_sdio_lowlat(bus, prec_out)) {
+				bus->tx_unglommed++;
+				i++;
+				break;
+			}
 		}
 		spin_unlock_bh(&bus->txq_lock);
 		if (i == 0)
@@ -2829,6 +2874,8 @@ static int brcmf_sdio_bus_txdata(struct device *dev, struct sk_buff *pkt)
 	spin_lock_bh(&bus->txq_lock);
 	/* reset bus_flags in packet cb */
 	*(u16 *)(pkt->cb) = 0;
+	if (bus->lowlat)
+		pkt->tstamp = brcmf_sdio_lowlat(bus, prec) ? ktime_get() : 0;
 	if (!brcmf_sdio_prec_enq(&bus->txq, pkt, prec)) {
 		skb_pull(pkt, bus->tx_hdrlen);
 		brcmf_err("out of bus->txq !!!\n");
@@ -3212,6 +3259,28 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 	return 0;
 }
 
+static void brcmf_sdio_lat_show(struct seq_file *seq, const char *name,
+				struct brcmf_sdio_lat *lat)
+{
+	u64 avg = lat->count ? div64_u64(lat->total_ns, lat->count) : 0;
+
+	seq_printf(seq, "%s: count %llu avg_ns %llu max_ns %llu\n", name,
+		   lat->count, avg, lat->max_ns);
+}
+
+static int brcmf_debugfs_sdio_latency_read(struct seq_file *seq, void *data)
+{
+	struct brcmf_bus *bus_if = dev_get_drvdata(seq->private);
+	struct brcmf_sdio *bus = bus_if->bus_priv.sdio->bus;
+
+	seq_printf(seq, "lowlat:       %u\ntx_unglommed: %u\n",
+		   bus->lowlat, bus->tx_unglommed);
+	brcmf_sdio_lat_show(seq, "dpc_sched", &bus->dpc_lat);
+	brcmf_sdio_lat_show(seq, "tx_voice", &bus->tx_lat);
+
+	return 0;
+}
+
 static void brcmf_sdio_debugfs_create(struct device *dev)
 {
 	struct brcmf_bus *bus_if = dev_get_drvdata(dev);
@@ -3228,6 +3297,8 @@ static void brcmf_sdio_debugfs_create(struct device *dev)
 	brcmf_debugfs_add_entry(drvr, "forensics", brcmf_sdio_forensic_read);
 	brcmf_debugfs_add_entry(drvr, "counters",
 				brcmf_debugfs_sdio_count_read);
+	brcmf_debugfs_add_entry(drvr, "latency",
+				brcmf_debugfs_sdio_latency_read);
 	debugfs_create_u32("console_interval", 0644, dentry,
 			   &bus->console_interval);
 }
@@ -3638,6 +3709,8 @@ void brcmf_sdio_trigger_dpc(struct brcmf_sdio *bus)
 {
 	if (!bus->dpc_triggered) {
 		bus->dpc_triggered = true;
+		if (bus->lowlat && !bus->dpc_kick)
+			bus->dpc_kick = ktime_get();
 		queue_work(bus->brcmf_wq, &bus->datawork);
 	}
 }
@@ -3758,6 +3831,11 @@ static void brcmf_sdio_dataworker(struct work_struct *work)
 	struct brcmf_sdio *bus = container_of(work, struct brcmf_sdio,
 					      datawork);
 
+	if (bus->dpc_kick) {
+		brcmf_sdio_lat_add(&bus->dpc_lat, bus->dpc_kick);
+		bus->dpc_kick = 0;
+	}
+
 	bus->dpc_running = true;
 	wmb();
 	while (READ_ONCE(bus->dpc_triggered)) {
@@ -4013,6 +4091,7 @@ brcmf_sdio_probe_attach(struct brcmf_sdio *bus)
 	 */
 	bus->head_align = ALIGNMENT;
 	bus->sgentry_align = ALIGNMENT;
+	bus->lowlat = sdiodev->settings->sdio_lowlat;
 	if (sdiodev->settings->bus.sdio.sd_head_align > ALIGNMENT)
 		bus->head_align = sdiodev->settings->bus.sdio.sd_head_align;
 	if (sdiodev->settings->bus.sdio.sd_sgentry_align > ALIGNMENT)
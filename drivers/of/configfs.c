@@ -24,6 +24,7 @@
 #include <linux/vmalloc.h>
 #include <linux/firmware.h>
 #include <linux/sizes.h>
+#include <linux/ktime.h>
 
 #include "of_private.h"
 
@@ -38,8 +39,25 @@ struct cfs_overlay_item {
 
 	void			*dtbo;
 	int			dtbo_size;
+
+	/* how long applying the overlay took, devices probing included */
+	u64			apply_us;
 };
 
+static int cfs_overlay_apply(struct cfs_overlay_item *overlay,
+			     const void *fdt, u32 size)
+{
+	ktime_t start = ktime_get();
+	int err;
+
+	err = of_overlay_fdt_apply(fdt, size, &overlay->ov_id);
+	overlay->apply_us = ktime_us_delta(ktime_get(), start);
+	pr_debug("%s: applied in %llu us (%d)\n", __func__, overlay->apply_us,
+		 err);
+
+	return err;
+}
+
 static inline struct cfs_overlay_item *to_cfs_overlay_item(
 		struct config_item *item)
 {
@@ -80,8 +98,8 @@ static ssize_t cfs_overlay_item_path_store(struct config_item *item,
 	if (err != 0)
 		goto out_err;
 
-	err = of_overlay_fdt_apply((void *)overlay->fw->data,
-				   (u32)overlay->fw->size, &overlay->ov_id);
+	err = cfs_overlay_apply(overlay, overlay->fw->data,
+				(u32)overlay->fw->size);
 	if (err != 0)
 		goto out_err;
 
@@ -105,12 +123,22 @@ static ssize_t cfs_overlay_item_status_show(struct config_item *item,
 			overlay->ov_id > 0 ? "applied" : "unapplied");
 }
 
+static ssize_t cfs_overlay_item_apply_us_show(struct config_item *item,
+		char *page)
+{
+	struct cfs_overlay_item *overlay = to_cfs_overlay_item(item);
+
+	return sprintf(page, "%llu\n", overlay->apply_us);
+}
+
 CONFIGFS_ATTR(cfs_overlay_item_, path);
 CONFIGFS_ATTR_RO(cfs_overlay_item_, status);
+CONFIGFS_ATTR_RO(cfs_overlay_item_, apply_us);
 
 static struct configfs_attribute *cfs_overlay_attrs[] = {
 	&cfs_overlay_item_attr_path,
 	&cfs_overlay_item_attr_status,
+	&cfs_overlay_item_attr_apply_us,
 	NULL,
 };
 
@@ -154,8 +182,7 @@ ssize_t cfs_overlay_item_dtbo_write(struct config_item *item,
 
 	overlay->dtbo_size = count;
 
-	err = of_overlay_fdt_apply(overlay->dtbo, overlay->dtbo_size,
-				   &overlay->ov_id);
+	err = cfs_overlay_apply(overlay, overlay->dtbo, overlay->dtbo_size);
 	if (err != 0)
 		goto out_err;
 
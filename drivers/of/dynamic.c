@@ -716,6 +716,30 @@ int __of_changeset_apply_entries(struct of_changeset *ocs, int *ret_revert)
 	return 0;
 }
 
+/*
+ * The properties of a node attached by the changeset itself don't need a
+ * notification each: the attach (or on revert, detach) notification of the
+ * node covers them, the listeners only act on property changes of nodes
+ * that were already in the tree. An overlay adding a device would
+ * otherwise run the whole notifier chain once per property.
+ */
+static bool __of_changeset_entry_covered(struct of_changeset *ocs,
+					 struct of_changeset_entry *ce)
+{
+	struct of_changeset_entry *other;
+
+	if (ce->action == OF_RECONFIG_ATTACH_NODE ||
+	    ce->action == OF_RECONFIG_DETACH_NODE)
+		return false;
+
+	list_for_each_entry(other, &ocs->entries, node)
+		if (other->action == OF_RECONFIG_ATTACH_NODE &&
+		    other->np == ce->np)
+			return true;
+
+	return false;
+}
+
 /*
  * Returns 0 on success, a negative error value in case of an error.
  *
@@ -732,6 +756,8 @@ int __of_changeset_apply_notify(struct of_changeset *ocs)
 	/* drop the global lock while emitting notifiers */
 	mutex_unlock(&of_mutex);
 	list_for_each_entry(ce, &ocs->entries, node) {
+		if (__of_changeset_entry_covered(ocs, ce))
+			continue;
 		ret_tmp = __of_changeset_entry_notify(ce, 0);
 		if (ret_tmp)
 			ret = ret_tmp;
@@ -833,6 +859,8 @@ int __of_changeset_revert_notify(struct of_changeset *ocs)
 	/* drop the global lock while emitting notifiers */
 	mutex_unlock(&of_mutex);
 	list_for_each_entry_reverse(ce, &ocs->entries, node) {
+		if (__of_changeset_entry_covered(ocs, ce))
+			continue;
 		ret_tmp = __of_changeset_entry_notify(ce, 1);
 		if (ret_tmp)
 			ret = ret_tmp;
@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Always-on background CPU profiler on top of the ARM PMU
+ *
+ * A pinned kernel cycle counter per CPU overflows at a low, fixed rate
+ * and each overflow records the interrupted PC in a per-CPU ring. The
+ * rings wrap, so memory and CPU cost stay bounded however long the unit
+ * runs, and nothing leaves RAM until the profile is read from debugfs:
+ *
+ *   /sys/kernel/debug/pmu_sampler/profile	hot functions, hottest first
+ *   /sys/kernel/debug/pmu_sampler/enable	start/stop sampling
+ *
+ * Kernel samples are aggregated by function via kallsyms. User samples
+ * are aggregated by task name, symbolising user addresses needs the
+ * binaries and is left to perf.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/kallsyms.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#define PMU_SAMPLER_RING	1024	/* samples kept per CPU */
+#define PMU_SAMPLER_TOP		64	/* entries in the profile */
+
+static unsigned int sample_hz = 10;
+module_param(sample_hz, uint, 0444);
+MODULE_PARM_DESC(sample_hz, "Samples per second and CPU (default 10)");
+
+struct pmu_sample {
+	unsigned long ip;
+	char comm[TASK_COMM_LEN];
+	bool user;
+};
+
+struct pmu_sampler_cpu {
+	struct perf_event *event;
+	struct pmu_sample *ring;
+	unsigned long head;
+};
+
+struct pmu_sampler_entry {
+	struct pmu_sample sample;
+	unsigned int count;
+};
+
+static DEFINE_PER_CPU(struct pmu_sampler_cpu, pmu_sampler_cpus);
+/* protects enabled and the events against concurrent snapshots */
+static DEFINE_MUTEX(pmu_sampler_lock);
+static bool pmu_sampler_enabled = true;
+
+static void pmu_sampler_overflow(struct perf_event *event,
+				 struct perf_sample_data *data,
+				 struct pt_regs *regs)
+{
+	struct pmu_sampler_cpu *pc = this_cpu_ptr(&pmu_sampler_cpus);
+	struct pmu_sample *s = &pc->ring[pc->head++ % PMU_SAMPLER_RING];
+
+	s->ip = instruction_pointer(regs);
+	s->user = user_mode(regs);
+	memcpy(s->comm, current->comm, sizeof(s->comm));
+}
+
+static struct perf_event_attr pmu_sampler_attr = {
+	.type		= PERF_TYPE_HARDWARE,
+	.config		= PERF_COUNT_HW_CPU_CYCLES,
+	.size		= sizeof(struct perf_event_attr),
+	.pinned		= 1,
+	.freq		= 1,
+};
+
+static int pmu_sampler_cpu_online(unsigned int cpu)
+{
+	struct pmu_sampler_cpu *pc = per_cpu_ptr(&pmu_sampler_cpus, cpu);
+	struct perf_event *event;
+
+	if (!pc->ring) {
+		pc->ring = kvzalloc_node(array_size(PMU_SAMPLER_RING,
+						    sizeof(*pc->ring)),
+					 GFP_KERNEL, cpu_to_node(cpu));
+		if (!pc->ring)
+			return -ENOMEM;
+	}
+
+	event = perf_event_create_kernel_counter(&pmu_sampler_attr, cpu, NULL,
+						 pmu_sampler_overflow, NULL);
+	if (IS_ERR(event)) {
+		pr_warn_once("cannot create cycle counter on CPU%u: %ld\n",
+			     cpu, PTR_ERR(event));
+		/* keep the CPU usable, it just isn't profiled */
+		return 0;
+	}
+
+	mutex_lock(&pmu_sampler_lock);
+	if (!pmu_sampler_enabled)
+		perf_event_disable(event);
+	pc->event = event;
+	mutex_unlock(&pmu_sampler_lock);
+
+	return 0;
+}
+
+static int pmu_sampler_cpu_offline(unsigned int cpu)
+{
+	struct pmu_sampler_cpu *pc = per_cpu_ptr(&pmu_sampler_cpus, cpu);
+	struct perf_event *event;
+
+	mutex_lock(&pmu_sampler_lock);
+	event = pc->event;
+	pc->event = NULL;
+	mutex_unlock(&pmu_sampler_lock);
+
+	if (event)
+		perf_event_release_kernel(event);
+
+	/* the ring is kept, the samples of an offline CPU still count */
+	return 0;
+}
+
+/* call with pmu_sampler_lock held */
+static void pmu_sampler_set_enabled(bool enable)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct perf_event *event = per_cpu(pmu_sampler_cpus, cpu).event;
+
+		if (!event)
+			continue;
+		if (enable)
+			perf_event_enable(event);
+		else
+			perf_event_disable(event);
+	}
+}
+
+static int pmu_sampler_cmp(const void *a, const void *b)
+{
+	const struct pmu_sample *x = a, *y = b;
+
+	if (x->user != y->user)
+		return x->user ? 1 : -1;
+	if (x->user)
+		return strncmp(x->comm, y->comm, sizeof(x->comm));
+	if (x->ip != y->ip)
+		return x->ip < y->ip ? -1 : 1;
+	return 0;
+}
+
+static int pmu_sampler_cmp_count(const void *a, const void *b)
+{
+	const struct pmu_sampler_entry *x = a, *y = b;
+
+	return y->count - x->count;
+}
+
+/* Fold a kernel PC to the start of its function, so samples aggregate */
+static unsigned long pmu_sampler_func(unsigned long ip)
+{
+	unsigned long size, offset;
+
+	if (kallsyms_lookup_size_offset(ip, &size, &offset))
+		return ip - offset;
+	return ip;
+}
+
+static void pmu_sampler_show_entry(struct seq_file *m,
+				   struct pmu_sampler_entry *e,
+				   unsigned int total)
+{
+	unsigned int permille = e->count * 1000 / total;
+
+	seq_printf(m, "%8u %3u.%u%% ", e->count, permille / 10, permille % 10);
+	if (e->sample.user)
+		seq_printf(m, "[user] %.*s\n", (int)sizeof(e->sample.comm),
+			   e->sample.comm);
+	else
+		seq_printf(m, "%ps\n", (void *)e->sample.ip);
+}
+
+static int pmu_sampler_profile_show(struct seq_file *m, void *v)
+{
+	struct pmu_sampler_entry *entries;
+	struct pmu_sample *samples;
+	unsigned int n = 0, nr_entries = 0, i;
+	bool enabled;
+	int cpu;
+
+	samples = vmalloc(array_size(num_possible_cpus() * PMU_SAMPLER_RING,
+				     sizeof(*samples)));
+	if (!samples)
+		return -ENOMEM;
+
+	/* stop sampling while the rings are copied out */
+	mutex_lock(&pmu_sampler_lock);
+	enabled = pmu_sampler_enabled;
+	if (enabled)
+		pmu_sampler_set_enabled(false);
+
+	for_each_possible_cpu(cpu) {
+		struct pmu_sampler_cpu *pc;
+		unsigned int len;
+
+		pc = per_cpu_ptr(&pmu_sampler_cpus, cpu);
+		if (!pc->ring)
+			continue;
+		len = min_t(unsigned long, pc->head, PMU_SAMPLER_RING);
+		memcpy(&samples[n], pc->ring, len * sizeof(*samples));
+		n += len;
+	}
+
+	if (enabled)
+		pmu_sampler_set_enabled(true);
+	mutex_unlock(&pmu_sampler_lock);
+
+	if (!n) {
+		seq_puts(m, "no samples\n");
+		goto out;
+	}
+
+	for (i = 0; i < n; i++)
+		if (!samples[i].user)
+			samples[i].ip = pmu_sampler_func(samples[i].ip);
+	sort(samples, n, sizeof(*samples), pmu_sampler_cmp, NULL);
+
+	entries = vmalloc(array_size(n, sizeof(*entries)));
+	if (!entries) {
+		vfree(samples);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (nr_entries &&
+		    !pmu_sampler_cmp(&entries[nr_entries - 1].sample,
+				     &samples[i])) {
+			entries[nr_entries - 1].count++;
+			continue;
+		}
+		entries[nr_entries].sample = samples[i];
+		entries[nr_entries++].count = 1;
+	}
+	sort(entries, nr_entries, sizeof(*entries), pmu_sampler_cmp_count,
+	     NULL);
+
+	seq_printf(m, "%u samples at %u Hz per CPU%s\n", n, sample_hz,
+		   enabled ? "" : ", stopped");
+	for (i = 0; i < min_t(unsigned int, nr_entries, PMU_SAMPLER_TOP); i++)
+		pmu_sampler_show_entry(m, &entries[i], n);
+
+	vfree(entries);
+out:
+	vfree(samples);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pmu_sampler_profile);
+
+static ssize_t pmu_sampler_enable_read(struct file *file, char __user *ubuf,
+				       size_t count, loff_t *ppos)
+{
+	char buf[2] = { READ_ONCE(pmu_sampler_enabled) ? '1' : '0', '\n' };
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, sizeof(buf));
+}
+
+static ssize_t pmu_sampler_enable_write(struct file *file,
+					const char __user *ubuf,
+					size_t count, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, count, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&pmu_sampler_lock);
+	if (enable != pmu_sampler_enabled) {
+		pmu_sampler_enabled = enable;
+		pmu_sampler_set_enabled(enable);
+	}
+	mutex_unlock(&pmu_sampler_lock);
+
+	return count;
+}
+
+static const struct file_operations pmu_sampler_enable_fops = {
+	.read	= pmu_sampler_enable_read,
+	.write	= pmu_sampler_enable_write,
+	.open	= simple_open,
+	.llseek	= default_llseek,
+};
+
+static void __init pmu_sampler_free_rings(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		kvfree(per_cpu(pmu_sampler_cpus, cpu).ring);
+		per_cpu(pmu_sampler_cpus, cpu).ring = NULL;
+	}
+}
+
+static int __init pmu_sampler_init(void)
+{
+	struct dentry *dir;
+	int ret;
+
+	if (!sample_hz)
+		return -EINVAL;
+	pmu_sampler_attr.sample_freq = sample_hz;
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "perf/pmu_sampler:online",
+				pmu_sampler_cpu_online,
+				pmu_sampler_cpu_offline);
+	if (ret < 0) {
+		pmu_sampler_free_rings();
+		return ret;
+	}
+
+	dir = debugfs_create_dir("pmu_sampler", NULL);
+	debugfs_create_file("profile", 0400, dir, NULL,
+			    &pmu_sampler_profile_fops);
+	debugfs_create_file("enable", 0600, dir, NULL,
+			    &pmu_sampler_enable_fops);
+
+	return 0;
+}
+/* after the CPU PMU drivers have probed */
+late_initcall(pmu_sampler_init);
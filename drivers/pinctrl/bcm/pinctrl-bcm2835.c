@@ -336,6 +336,33 @@ static int bcm2835_gpio_get(struct gpio_chip *chip, unsigned offset)
 	return bcm2835_gpio_get_bit(pc, GPLEV0, offset);
 }
 
+/*
+ * Each bank is one 32-bit register, which is a whole long of the bitmaps
+ * or one half of it on 64-bit.
+ */
+static int bcm2835_gpio_get_multiple(struct gpio_chip *chip,
+				     unsigned long *mask, unsigned long *bits)
+{
+	struct bcm2835_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int bank;
+
+	for (bank = 0; bank < BCM2835_NUM_BANKS; bank++) {
+		unsigned int word = BIT_WORD(bank * 32);
+		unsigned int shift = (bank * 32) % BITS_PER_LONG;
+		u32 m = mask[word] >> shift;
+		u32 val;
+
+		if (!m)
+			continue;
+
+		val = bcm2835_gpio_rd(pc, GPLEV0 + bank * 4) & m;
+		bits[word] &= ~((unsigned long)m << shift);
+		bits[word] |= (unsigned long)val << shift;
+	}
+
+	return 0;
+}
+
 static int bcm2835_gpio_get_direction(struct gpio_chip *chip, unsigned int offset)
 {
 	struct bcm2835_pinctrl *pc = gpiochip_get_data(chip);
@@ -358,6 +385,25 @@ static void bcm2835_gpio_set(struct gpio_chip *chip, unsigned offset, int value)
 	bcm2835_gpio_set_bit(pc, value ? GPSET0 : GPCLR0, offset);
 }
 
+static void bcm2835_gpio_set_multiple(struct gpio_chip *chip,
+				      unsigned long *mask, unsigned long *bits)
+{
+	struct bcm2835_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int bank;
+
+	for (bank = 0; bank < BCM2835_NUM_BANKS; bank++) {
+		unsigned int word = BIT_WORD(bank * 32);
+		unsigned int shift = (bank * 32) % BITS_PER_LONG;
+		u32 m = mask[word] >> shift;
+		u32 val = bits[word] >> shift;
+
+		if (val & m)
+			bcm2835_gpio_wr(pc, GPSET0 + bank * 4, val & m);
+		if (~val & m)
+			bcm2835_gpio_wr(pc, GPCLR0 + bank * 4, ~val & m);
+	}
+}
+
 static int bcm2835_gpio_direction_output(struct gpio_chip *chip,
 		unsigned offset, int value)
 {
@@ -389,7 +435,9 @@ static const struct gpio_chip bcm2835_gpio_chip = {
 	.direction_output = bcm2835_gpio_direction_output,
 	.get_direction = bcm2835_gpio_get_direction,
 	.get = bcm2835_gpio_get,
+	.get_multiple = bcm2835_gpio_get_multiple,
 	.set = bcm2835_gpio_set,
+	.set_multiple = bcm2835_gpio_set_multiple,
 	.set_config = gpiochip_generic_config,
 	.base = 0,
 	.ngpio = BCM2835_NUM_GPIOS,
@@ -406,7 +454,9 @@ static const struct gpio_chip bcm2711_gpio_chip = {
 	.direction_output = bcm2835_gpio_direction_output,
 	.get_direction = bcm2835_gpio_get_direction,
 	.get = bcm2835_gpio_get,
+	.get_multiple = bcm2835_gpio_get_multiple,
 	.set = bcm2835_gpio_set,
+	.set_multiple = bcm2835_gpio_set_multiple,
 	.set_config = gpiochip_generic_config,
 	.base = 0,
 	.ngpio = BCM2711_NUM_GPIOS,
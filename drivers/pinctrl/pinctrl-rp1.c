@@ -695,6 +695,67 @@ static void rp1_gpio_set(struct gpio_chip *chip, unsigned offset, int value)
 		rp1_set_value(pin, value);
 }
 
+/* extract the bits of a bank, which don't start on a word boundary */
+static u32 rp1_bank_bits(const unsigned long *bitmap,
+			 const struct rp1_iobank_desc *bank)
+{
+	DECLARE_BITMAP(tmp, RP1_NUM_GPIOS);
+
+	bitmap_shift_right(tmp, bitmap, bank->min_gpio, RP1_NUM_GPIOS);
+
+	return tmp[0] & GENMASK(bank->num_gpios - 1, 0);
+}
+
+static int rp1_gpio_get_multiple(struct gpio_chip *chip,
+				 unsigned long *mask, unsigned long *bits)
+{
+	struct rp1_pinctrl *pc = gpiochip_get_data(chip);
+	DECLARE_BITMAP(vals, RP1_NUM_GPIOS);
+	DECLARE_BITMAP(tmp, RP1_NUM_GPIOS);
+	unsigned int i;
+
+	bitmap_zero(vals, RP1_NUM_GPIOS);
+
+	for (i = 0; i < RP1_NUM_BANKS; i++) {
+		const struct rp1_iobank_desc *bank = &rp1_iobanks[i];
+		u32 m = rp1_bank_bits(mask, bank);
+
+		if (!m)
+			continue;
+
+		bitmap_zero(tmp, RP1_NUM_GPIOS);
+		tmp[0] = readl(pc->rio_base + bank->rio_offset +
+			       RP1_RIO_IN) & m;
+		bitmap_shift_left(tmp, tmp, bank->min_gpio, RP1_NUM_GPIOS);
+		bitmap_or(vals, vals, tmp, RP1_NUM_GPIOS);
+	}
+
+	bitmap_replace(bits, bits, vals, mask, RP1_NUM_GPIOS);
+
+	return 0;
+}
+
+static void rp1_gpio_set_multiple(struct gpio_chip *chip,
+				  unsigned long *mask, unsigned long *bits)
+{
+	struct rp1_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int i;
+
+	for (i = 0; i < RP1_NUM_BANKS; i++) {
+		const struct rp1_iobank_desc *bank = &rp1_iobanks[i];
+		void __iomem *out = pc->rio_base + bank->rio_offset +
+				    RP1_RIO_OUT;
+		u32 m = rp1_bank_bits(mask, bank);
+		u32 val = rp1_bank_bits(bits, bank);
+
+		/* Assume the pins are already outputs */
+		if (val & m)
+			writel(val & m, out + RP1_SET_OFFSET);
+		if (~val & m)
+			writel(~val & m, out + RP1_CLR_OFFSET);
+	}
+}
+
 static int rp1_gpio_get_direction(struct gpio_chip *chip, unsigned int offset)
 {
 	struct rp1_pin_info *pin = rp1_get_pin(chip, offset);
@@ -753,7 +814,9 @@ static const struct gpio_chip rp1_gpio_chip = {
 	.direction_output = rp1_gpio_direction_output,
 	.get_direction = rp1_gpio_get_direction,
 	.get = rp1_gpio_get,
+	.get_multiple = rp1_gpio_get_multiple,
 	.set = rp1_gpio_set,
+	.set_multiple = rp1_gpio_set_multiple,
 	.base = -1,
 	.set_config = rp1_gpio_set_config,
 	.ngpio = RP1_NUM_GPIOS,
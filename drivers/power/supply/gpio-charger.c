@@ -53,6 +53,20 @@ static inline struct gpio_charger *psy_to_gpio_charger(struct power_supply *psy)
 	return power_supply_get_drvdata(psy);
 }
 
+/* losing the supply is reported right away, everything else is not urgent */
+static irqreturn_t gpio_charger_online_irq(int irq, void *devid)
+{
+	struct power_supply *charger = devid;
+	struct gpio_charger *gpio_charger = psy_to_gpio_charger(charger);
+
+	if (gpiod_get_value_cansleep(gpio_charger->gpiod))
+		power_supply_changed(charger);
+	else
+		power_supply_power_fail(charger);
+
+	return IRQ_HANDLED;
+}
+
 static int set_charge_current_limit(struct gpio_charger *gpio_charger, int val)
 {
 	struct gpio_mapping mapping;
@@ -163,16 +177,17 @@ static enum power_supply_type gpio_charger_get_type(struct device *dev)
 }
 
 static int gpio_charger_get_irq(struct device *dev, void *dev_id,
-				struct gpio_desc *gpio)
+				struct gpio_desc *gpio, irq_handler_t handler)
 {
 	int ret, irq = gpiod_to_irq(gpio);
 
 	if (irq > 0) {
-		ret = devm_request_any_context_irq(dev, irq, gpio_charger_irq,
-						   IRQF_TRIGGER_RISING |
-						   IRQF_TRIGGER_FALLING,
-						   dev_name(dev),
-						   dev_id);
+		ret = devm_request_threaded_irq(dev, irq, NULL, handler,
+						IRQF_TRIGGER_RISING |
+						IRQF_TRIGGER_FALLING |
+						IRQF_ONESHOT,
+						dev_name(dev),
+						dev_id);
 		if (ret < 0) {
 			dev_warn(dev, "Failed to request irq: %d\n", ret);
 			irq = 0;
@@ -337,10 +352,12 @@ static int gpio_charger_probe(struct platform_device *pdev)
 	}
 
 	gpio_charger->irq = gpio_charger_get_irq(dev, gpio_charger->charger,
-						 gpio_charger->gpiod);
+						 gpio_charger->gpiod,
+						 gpio_charger_online_irq);
 
 	charge_status_irq = gpio_charger_get_irq(dev, gpio_charger->charger,
-						 gpio_charger->charge_status);
+						 gpio_charger->charge_status,
+						 gpio_charger_irq);
 	gpio_charger->charge_status_irq = charge_status_irq;
 
 	platform_set_drvdata(pdev, gpio_charger);
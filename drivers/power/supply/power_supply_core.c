@@ -127,6 +127,32 @@ void power_supply_changed(struct power_supply *psy)
 }
 EXPORT_SYMBOL_GPL(power_supply_changed);
 
+/**
+ * power_supply_power_fail() - Report the loss of a supply without delay
+ * @psy:	Power supply that went away
+ *
+ * Unlike power_supply_changed(), which defers to a work item and a
+ * uevent, this runs the PSY_EVENT_POWER_FAIL notifiers and wakes up
+ * pollers of the "online" attribute before returning, so that data can
+ * be saved in the short time left before the system loses power. The
+ * usual change notification follows.
+ *
+ * Context: Process context, e.g. a threaded interrupt handler.
+ */
+void power_supply_power_fail(struct power_supply *psy)
+{
+	might_sleep();
+
+	dev_dbg(&psy->dev, "%s\n", __func__);
+
+	blocking_notifier_call_chain(&power_supply_notifier,
+				     PSY_EVENT_POWER_FAIL, psy);
+	sysfs_notify(&psy->dev.kobj, NULL, "online");
+
+	power_supply_changed(psy);
+}
+EXPORT_SYMBOL_GPL(power_supply_power_fail);
+
 /*
  * Notify that power supply was registered after parent finished the probing.
  *
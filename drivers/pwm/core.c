@@ -615,6 +615,61 @@ int pwm_capture(struct pwm_device *pwm, struct pwm_capture *result,
 }
 EXPORT_SYMBOL_GPL(pwm_capture);
 
+/**
+ * pwm_stream_start() - feed a PWM from a looping stream of duty cycles
+ * @pwm: PWM device
+ * @stream: period and duty cycles to replay, one duty cycle per period
+ *
+ * The duty cycles are copied, so @stream need not outlive the call. While
+ * the stream runs, pwm_apply_state() may fail with -EBUSY.
+ *
+ * Returns: 0 on success or a negative error code on failure.
+ */
+int pwm_stream_start(struct pwm_device *pwm, const struct pwm_stream *stream)
+{
+	unsigned int i;
+	int err;
+
+	if (!pwm || !pwm->chip->ops || !stream || !stream->period ||
+	    !stream->count)
+		return -EINVAL;
+
+	if (!pwm->chip->ops->stream_start)
+		return -ENOSYS;
+
+	for (i = 0; i < stream->count; i++)
+		if (stream->duty_cycle[i] > stream->period)
+			return -EINVAL;
+
+	mutex_lock(&pwm_lock);
+	err = pwm->chip->ops->stream_start(pwm->chip, pwm, stream);
+	if (!err) {
+		pwm->state.period = stream->period;
+		pwm->state.duty_cycle = stream->duty_cycle[0];
+		pwm->state.enabled = true;
+	}
+	mutex_unlock(&pwm_lock);
+
+	return err;
+}
+
+/**
+ * pwm_stream_stop() - stop a duty cycle stream started by pwm_stream_start()
+ * @pwm: PWM device
+ *
+ * If a stream was running, the PWM is left disabled.
+ */
+void pwm_stream_stop(struct pwm_device *pwm)
+{
+	if (!pwm || !pwm->chip->ops || !pwm->chip->ops->stream_stop)
+		return;
+
+	mutex_lock(&pwm_lock);
+	if (pwm->chip->ops->stream_stop(pwm->chip, pwm))
+		pwm->state.enabled = false;
+	mutex_unlock(&pwm_lock);
+}
+
 /**
  * pwm_adjust_config() - adjust the current PWM config to the PWM arguments
  * @pwm: PWM device
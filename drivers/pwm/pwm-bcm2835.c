@@ -4,6 +4,8 @@
  */
 
 #include <linux/clk.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/err.h>
 #include <linux/io.h>
 #include <linux/module.h>
@@ -17,6 +19,15 @@
 #define PWM_MODE		0x80		/* set timer in PWM mode */
 #define PWM_ENABLE		(1 << 0)
 #define PWM_POLARITY		(1 << 4)
+#define PWM_USEFIFO		(1 << 5)	/* take data from the FIFO */
+#define PWM_CLRFIFO		(1 << 6)	/* channel 0 byte only */
+
+#define PWM_DMAC		0x008
+#define PWM_DMAC_ENAB		(1U << 31)
+#define PWM_DMAC_PANIC(x)	((x) << 8)
+#define PWM_DMAC_DREQ(x)	((x) << 0)
+
+#define PWM_FIFO		0x018
 
 #define PERIOD(x)		(((x) * 0x10) + 0x10)
 #define DUTY(x)			(((x) * 0x10) + 0x14)
@@ -27,7 +38,14 @@ struct bcm2835_pwm {
 	struct pwm_chip chip;
 	struct device *dev;
 	void __iomem *base;
+	phys_addr_t phys_base;
 	struct clk *clk;
+	/* duty cycle streaming, the FIFO can only feed one channel */
+	struct dma_chan *dma;
+	struct pwm_device *stream_pwm;
+	u32 *stream_buf;
+	dma_addr_t stream_buf_dma;
+	size_t stream_buf_len;
 };
 
 static inline struct bcm2835_pwm *to_bcm2835_pwm(struct pwm_chip *chip)
@@ -35,6 +53,9 @@ static inline struct bcm2835_pwm *to_bcm2835_pwm(struct pwm_chip *chip)
 	return container_of(chip, struct bcm2835_pwm, chip);
 }
 
+static bool bcm2835_pwm_stream_stop(struct pwm_chip *chip,
+				    struct pwm_device *pwm);
+
 static int bcm2835_pwm_request(struct pwm_chip *chip, struct pwm_device *pwm)
 {
 	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
@@ -53,27 +74,19 @@ static void bcm2835_pwm_free(struct pwm_chip *chip, struct pwm_device *pwm)
 	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
 	u32 value;
 
+	bcm2835_pwm_stream_stop(chip, pwm);
+
 	value = readl(pc->base + PWM_CONTROL);
 	value &= ~(PWM_CONTROL_MASK << PWM_CONTROL_SHIFT(pwm->hwpwm));
 	writel(value, pc->base + PWM_CONTROL);
 }
 
-static int bcm2835_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
-			     const struct pwm_state *state)
+static int bcm2835_pwm_period_cycles(struct bcm2835_pwm *pc, u64 period,
+				     unsigned long rate, u32 *cycles)
 {
-
-	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
-	unsigned long rate = clk_get_rate(pc->clk);
 	unsigned long long period_cycles;
 	u64 max_period;
 
-	u32 val;
-
-	if (!rate) {
-		dev_err(pc->dev, "failed to get clock rate\n");
-		return -EINVAL;
-	}
-
 	/*
 	 * period_cycles must be a 32 bit value, so period * rate / NSEC_PER_SEC
 	 * must be <= U32_MAX. As U32_MAX * NSEC_PER_SEC < U64_MAX the
@@ -90,16 +103,45 @@ static int bcm2835_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
 	 */
 	max_period = DIV_ROUND_UP_ULL((u64)U32_MAX * NSEC_PER_SEC + NSEC_PER_SEC / 2, rate) - 1;
 
-	if (state->period > max_period)
+	if (period > max_period)
 		return -EINVAL;
 
-	/* set period */
-	period_cycles = DIV_ROUND_CLOSEST_ULL(state->period * rate, NSEC_PER_SEC);
+	period_cycles = DIV_ROUND_CLOSEST_ULL(period * rate, NSEC_PER_SEC);
 
 	/* don't accept a period that is too small */
 	if (period_cycles < PERIOD_MIN)
 		return -EINVAL;
 
+	*cycles = period_cycles;
+
+	return 0;
+}
+
+static int bcm2835_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
+			     const struct pwm_state *state)
+{
+
+	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
+	unsigned long rate = clk_get_rate(pc->clk);
+	u32 period_cycles;
+	u32 val;
+	int ret;
+
+	/* the duty cycle is owned by the stream until it is stopped */
+	if (pc->stream_pwm == pwm)
+		return -EBUSY;
+
+	if (!rate) {
+		dev_err(pc->dev, "failed to get clock rate\n");
+		return -EINVAL;
+	}
+
+	/* set period */
+	ret = bcm2835_pwm_period_cycles(pc, state->period, rate,
+					&period_cycles);
+	if (ret)
+		return ret;
+
 	writel(period_cycles, pc->base + PERIOD(pwm->hwpwm));
 
 	/* set duty cycle */
@@ -125,16 +167,131 @@ static int bcm2835_pwm_apply(struct pwm_chip *chip, struct pwm_device *pwm,
 	return 0;
 }
 
+/*
+ * In FIFO mode the channel takes a new duty cycle from the FIFO at the
+ * start of every period. A cyclic DMA transfer keeps the FIFO topped up
+ * from a ring holding the whole stream, so it loops without CPU help.
+ */
+static int bcm2835_pwm_stream_start(struct pwm_chip *chip,
+				    struct pwm_device *pwm,
+				    const struct pwm_stream *stream)
+{
+	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
+	unsigned long rate = clk_get_rate(pc->clk);
+	struct dma_slave_config config = {
+		.direction = DMA_MEM_TO_DEV,
+		.dst_addr = pc->phys_base + PWM_FIFO,
+		.dst_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES,
+	};
+	struct dma_async_tx_descriptor *desc;
+	u32 period_cycles, val;
+	unsigned int i;
+	int ret;
+
+	if (!pc->dma)
+		return -EOPNOTSUPP;
+
+	if (pc->stream_pwm && pc->stream_pwm != pwm)
+		return -EBUSY;
+
+	if (!rate) {
+		dev_err(pc->dev, "failed to get clock rate\n");
+		return -EINVAL;
+	}
+
+	ret = bcm2835_pwm_period_cycles(pc, stream->period, rate,
+					&period_cycles);
+	if (ret)
+		return ret;
+
+	bcm2835_pwm_stream_stop(chip, pwm);
+
+	pc->stream_buf_len = stream->count * sizeof(u32);
+	pc->stream_buf = dma_alloc_coherent(pc->dma->device->dev,
+					    pc->stream_buf_len,
+					    &pc->stream_buf_dma, GFP_KERNEL);
+	if (!pc->stream_buf)
+		return -ENOMEM;
+
+	for (i = 0; i < stream->count; i++)
+		pc->stream_buf[i] = DIV_ROUND_CLOSEST_ULL(stream->duty_cycle[i] *
+							  rate, NSEC_PER_SEC);
+
+	ret = dmaengine_slave_config(pc->dma, &config);
+	if (ret)
+		goto err_free;
+
+	desc = dmaengine_prep_dma_cyclic(pc->dma, pc->stream_buf_dma,
+					 pc->stream_buf_len,
+					 pc->stream_buf_len,
+					 DMA_MEM_TO_DEV, 0);
+	if (!desc) {
+		ret = -EBUSY;
+		goto err_free;
+	}
+
+	writel(period_cycles, pc->base + PERIOD(pwm->hwpwm));
+
+	val = readl(pc->base + PWM_CONTROL);
+	writel(val | PWM_CLRFIFO, pc->base + PWM_CONTROL);
+
+	dmaengine_submit(desc);
+	dma_async_issue_pending(pc->dma);
+
+	writel(PWM_DMAC_ENAB | PWM_DMAC_PANIC(7) | PWM_DMAC_DREQ(7),
+	       pc->base + PWM_DMAC);
+
+	val |= (PWM_USEFIFO | PWM_ENABLE) << PWM_CONTROL_SHIFT(pwm->hwpwm);
+	writel(val, pc->base + PWM_CONTROL);
+
+	pc->stream_pwm = pwm;
+
+	return 0;
+
+err_free:
+	dma_free_coherent(pc->dma->device->dev, pc->stream_buf_len,
+			  pc->stream_buf, pc->stream_buf_dma);
+	pc->stream_buf = NULL;
+	return ret;
+}
+
+static bool bcm2835_pwm_stream_stop(struct pwm_chip *chip,
+				    struct pwm_device *pwm)
+{
+	struct bcm2835_pwm *pc = to_bcm2835_pwm(chip);
+	u32 val;
+
+	if (pc->stream_pwm != pwm)
+		return false;
+
+	val = readl(pc->base + PWM_CONTROL);
+	val &= ~((PWM_USEFIFO | PWM_ENABLE) << PWM_CONTROL_SHIFT(pwm->hwpwm));
+	writel(val, pc->base + PWM_CONTROL);
+
+	writel(0, pc->base + PWM_DMAC);
+	dmaengine_terminate_sync(pc->dma);
+
+	dma_free_coherent(pc->dma->device->dev, pc->stream_buf_len,
+			  pc->stream_buf, pc->stream_buf_dma);
+	pc->stream_buf = NULL;
+	pc->stream_pwm = NULL;
+
+	return true;
+}
+
 static const struct pwm_ops bcm2835_pwm_ops = {
 	.request = bcm2835_pwm_request,
 	.free = bcm2835_pwm_free,
 	.apply = bcm2835_pwm_apply,
+	.stream_start = bcm2835_pwm_stream_start,
+	.stream_stop = bcm2835_pwm_stream_stop,
 	.owner = THIS_MODULE,
 };
 
 static int bcm2835_pwm_probe(struct platform_device *pdev)
 {
 	struct bcm2835_pwm *pc;
+	struct resource *res;
 	int ret;
 
 	pc = devm_kzalloc(&pdev->dev, sizeof(*pc), GFP_KERNEL);
@@ -143,18 +300,27 @@ static int bcm2835_pwm_probe(struct platform_device *pdev)
 
 	pc->dev = &pdev->dev;
 
-	pc->base = devm_platform_ioremap_resource(pdev, 0);
+	pc->base = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 	if (IS_ERR(pc->base))
 		return PTR_ERR(pc->base);
+	pc->phys_base = res->start;
 
 	pc->clk = devm_clk_get(&pdev->dev, NULL);
 	if (IS_ERR(pc->clk))
 		return dev_err_probe(&pdev->dev, PTR_ERR(pc->clk),
 				     "clock not found\n");
 
+	/* streaming is optional and only offered with a DMA channel */
+	pc->dma = dma_request_chan(&pdev->dev, "tx");
+	if (IS_ERR(pc->dma)) {
+		if (PTR_ERR(pc->dma) == -EPROBE_DEFER)
+			return -EPROBE_DEFER;
+		pc->dma = NULL;
+	}
+
 	ret = clk_prepare_enable(pc->clk);
 	if (ret)
-		return ret;
+		goto clk_fail;
 
 	pc->chip.dev = &pdev->dev;
 	pc->chip.ops = &bcm2835_pwm_ops;
@@ -170,6 +336,9 @@ static int bcm2835_pwm_probe(struct platform_device *pdev)
 
 add_fail:
 	clk_disable_unprepare(pc->clk);
+clk_fail:
+	if (pc->dma)
+		dma_release_channel(pc->dma);
 	return ret;
 }
 
@@ -181,6 +350,9 @@ static int bcm2835_pwm_remove(struct platform_device *pdev)
 
 	clk_disable_unprepare(pc->clk);
 
+	if (pc->dma)
+		dma_release_channel(pc->dma);
+
 	return 0;
 }
 
@@ -215,11 +215,66 @@ static ssize_t capture_show(struct device *child,
 	return sysfs_emit(buf, "%u %u\n", result.period, result.duty_cycle);
 }
 
+/*
+ * Writing "<period> <duty cycle>..." starts a stream replaying the duty
+ * cycles, one per period. Writing "0" stops it.
+ */
+static ssize_t stream_store(struct device *child,
+			    struct device_attribute *attr,
+			    const char *buf, size_t size)
+{
+	struct pwm_export *export = child_to_pwm_export(child);
+	struct pwm_device *pwm = export->pwm;
+	struct pwm_stream stream = {};
+	unsigned int n = 0;
+	char *str, *p, *tok;
+	u64 *duty_cycle;
+	int ret = 0;
+
+	str = kstrndup(buf, size, GFP_KERNEL);
+	/* values are separated, so there can't be more than one per two bytes */
+	duty_cycle = kcalloc(size / 2 + 1, sizeof(*duty_cycle), GFP_KERNEL);
+	if (!str || !duty_cycle) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	p = strim(str);
+	while ((tok = strsep(&p, " \t"))) {
+		if (!*tok)
+			continue;
+		ret = kstrtou64(tok, 0, n ? &duty_cycle[n - 1] : &stream.period);
+		if (ret)
+			goto out;
+		n++;
+	}
+	if (!n) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	mutex_lock(&export->lock);
+	if (n == 1 && !stream.period) {
+		pwm_stream_stop(pwm);
+	} else {
+		stream.duty_cycle = duty_cycle;
+		stream.count = n - 1;
+		ret = pwm_stream_start(pwm, &stream);
+	}
+	mutex_unlock(&export->lock);
+
+out:
+	kfree(duty_cycle);
+	kfree(str);
+	return ret ? : size;
+}
+
 static DEVICE_ATTR_RW(period);
 static DEVICE_ATTR_RW(duty_cycle);
 static DEVICE_ATTR_RW(enable);
 static DEVICE_ATTR_RW(polarity);
 static DEVICE_ATTR_RO(capture);
+static DEVICE_ATTR_WO(stream);
 
 static struct attribute *pwm_attrs[] = {
 	&dev_attr_period.attr,
@@ -227,6 +282,7 @@ static struct attribute *pwm_attrs[] = {
 	&dev_attr_enable.attr,
 	&dev_attr_polarity.attr,
 	&dev_attr_capture.attr,
+	&dev_attr_stream.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(pwm);
@@ -21,6 +21,7 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
@@ -105,6 +106,11 @@ MODULE_PARM_DESC(polling_limit_us,
  *      These are counted as well in @count_transfer_polling and
  *      @count_transfer_irq
  * @count_transfer_dma: count how often dma mode is used
+ * @count_transfer_dma_prepared: count of how often a DMA transfer set up by
+ *	bcm2835_spi_optimize_message() is used.
+ *	These are counted as well in @count_transfer_dma
+ * @count_transfer_dma_chained: count of transfers which were performed as
+ *	part of a single DMA transfer together with their predecessor
  * @slv: SPI slave currently selected
  *	(used by bcm2835_spi_dma_tx_done() to write @clear_rx_cs)
  * @tx_dma_active: whether a TX DMA descriptor is in progress
@@ -113,6 +119,13 @@ MODULE_PARM_DESC(polling_limit_us,
  * @fill_tx_desc: preallocated TX DMA descriptor used for RX-only transfers
  *	(cyclically copies from zero page to TX FIFO)
  * @fill_tx_addr: bus address of zero page
+ * @prepared: prepared transfer currently processed, if any
+ * @chains: runs of transfers in the current message performed as one DMA
+ *	transfer, set up by bcm2835_spi_setup_chains()
+ * @num_chains: number of entries in @chains
+ * @chain: chain whose DMA transfer is being set up
+ * @chain_next: next transfer which was already performed as part of a chain
+ * @chain_remaining: number of transfers left starting with @chain_next
  */
 struct bcm2835_spi {
 	void __iomem *regs;
@@ -135,12 +148,64 @@ struct bcm2835_spi {
 	u64 count_transfer_irq;
 	u64 count_transfer_irq_after_polling;
 	u64 count_transfer_dma;
+	u64 count_transfer_dma_prepared;
+	u64 count_transfer_dma_chained;
 
 	struct bcm2835_spidev *slv;
 	unsigned int tx_dma_active;
 	unsigned int rx_dma_active;
 	struct dma_async_tx_descriptor *fill_tx_desc;
 	dma_addr_t fill_tx_addr;
+	struct bcm2835_spi_prepared_xfer *prepared;
+	struct bcm2835_spi_chain *chains;
+	unsigned int num_chains;
+	struct bcm2835_spi_chain *chain;
+	struct spi_transfer *chain_next;
+	unsigned int chain_remaining;
+};
+
+/**
+ * struct bcm2835_spi_chain - transfers performed as a single DMA transfer
+ * @first: first transfer of the chain
+ * @last: last transfer of the chain
+ * @count: number of transfers in the chain
+ * @len: total length of the transfers
+ * @tx_sgl: sglist gathering the mapped TX buffers (if they exist)
+ * @rx_sgl: sglist gathering the mapped RX buffers (if they exist)
+ */
+struct bcm2835_spi_chain {
+	struct spi_transfer *first;
+	struct spi_transfer *last;
+	unsigned int count;
+	unsigned int len;
+	struct scatterlist *tx_sgl;
+	struct scatterlist *rx_sgl;
+};
+
+/**
+ * struct bcm2835_spi_prepared_xfer - DMA setup of an optimized transfer
+ * @tfr: SPI transfer this was set up for
+ * @tx_addr: bus address of the TX buffer (if any)
+ * @rx_addr: bus address of the RX buffer (if any)
+ * @tx_desc: reusable TX DMA descriptor (if the transfer has a TX buffer)
+ * @rx_desc: reusable RX DMA descriptor (if the transfer has an RX buffer)
+ */
+struct bcm2835_spi_prepared_xfer {
+	struct spi_transfer *tfr;
+	dma_addr_t tx_addr;
+	dma_addr_t rx_addr;
+	struct dma_async_tx_descriptor *tx_desc;
+	struct dma_async_tx_descriptor *rx_desc;
+};
+
+/**
+ * struct bcm2835_spi_prepared_msg - DMA setup of an optimized message
+ * @count: number of entries in @xfers
+ * @xfers: transfers of the message which are run with prepared DMA
+ */
+struct bcm2835_spi_prepared_msg {
+	unsigned int count;
+	struct bcm2835_spi_prepared_xfer xfers[];
 };
 
 /**
@@ -183,6 +248,10 @@ static void bcm2835_debugfs_create(struct bcm2835_spi *bs,
 			   &bs->count_transfer_irq_after_polling);
 	debugfs_create_u64("count_transfer_dma", 0444, dir,
 			   &bs->count_transfer_dma);
+	debugfs_create_u64("count_transfer_dma_prepared", 0444, dir,
+			   &bs->count_transfer_dma_prepared);
+	debugfs_create_u64("count_transfer_dma_chained", 0444, dir,
+			   &bs->count_transfer_dma_chained);
 }
 
 static void bcm2835_debugfs_remove(struct bcm2835_spi *bs)
@@ -616,6 +685,14 @@ static void bcm2835_spi_dma_rx_done(void *data)
 	bs->rx_dma_active = false;
 	bcm2835_spi_undo_prologue(bs);
 
+	if (bs->prepared) {
+		dma_sync_single_for_cpu(ctlr->dma_rx->device->dev,
+					bs->prepared->rx_addr,
+					bs->prepared->tfr->len,
+					DMA_FROM_DEVICE);
+		bs->prepared = NULL;
+	}
+
 	/* reset fifo and HW */
 	bcm2835_spi_reset_hw(bs);
 
@@ -650,6 +727,7 @@ static void bcm2835_spi_dma_tx_done(void *data)
 		dmaengine_terminate_async(ctlr->dma_rx);
 
 	bcm2835_spi_undo_prologue(bs);
+	bs->prepared = NULL;
 	bcm2835_spi_reset_hw(bs);
 	spi_finalize_current_transfer(ctlr);
 }
@@ -693,6 +771,13 @@ static int bcm2835_spi_prepare_sg(struct spi_controller *ctlr,
 		sgl   = tfr->rx_sg.sgl;
 		flags = DMA_PREP_INTERRUPT;
 	}
+
+	/* a chain covers the buffers of all its transfers */
+	if (bs->chain) {
+		nents = bs->chain->count;
+		sgl   = is_tx ? bs->chain->tx_sgl : bs->chain->rx_sgl;
+	}
+
 	/* prepare the channel */
 	desc = dmaengine_prep_slave_sg(chan, sgl, nents, dir, flags);
 	if (!desc)
@@ -722,6 +807,7 @@ static int bcm2835_spi_prepare_sg(struct spi_controller *ctlr,
  * @ctlr: SPI master controller
  * @tfr: SPI transfer
  * @slv: BCM2835 SPI slave
+ * @px: DMA setup from bcm2835_spi_optimize_message() or %NULL
  * @cs: CS register
  *
  * For *bidirectional* transfers (both tx_buf and rx_buf are non-%NULL), set up
@@ -763,10 +849,16 @@ static int bcm2835_spi_prepare_sg(struct spi_controller *ctlr,
  * has finished, the DMA engine zero-fills the TX FIFO until it is half full.
  * (Tuneable with the DC register.)  So up to 9 gratuitous bus accesses are
  * performed at the end of an RX-only transfer.
+ *
+ * For transfers of an optimized message (@px is non-%NULL) the buffers are
+ * already mapped and the descriptors for them prepared, so only the caches
+ * need to be synced and the reusable descriptors submitted.  The buffers are
+ * contiguous, hence no prologue is needed.
  */
 static int bcm2835_spi_transfer_one_dma(struct spi_controller *ctlr,
 					struct spi_transfer *tfr,
 					struct bcm2835_spidev *slv,
+					struct bcm2835_spi_prepared_xfer *px,
 					u32 cs)
 {
 	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
@@ -776,14 +868,42 @@ static int bcm2835_spi_transfer_one_dma(struct spi_controller *ctlr,
 	/* update usage statistics */
 	bs->count_transfer_dma++;
 
-	/*
-	 * Transfer first few bytes without DMA if length of first TX or RX
-	 * sglist entry is not a multiple of 4 bytes (hardware limitation).
-	 */
-	bcm2835_spi_transfer_prologue(ctlr, tfr, bs, cs);
+	if (px) {
+		bs->count_transfer_dma_prepared++;
+
+		bs->tfr = tfr;
+		bs->tx_prologue = 0;
+		bs->rx_prologue = 0;
+		bs->slv = slv;
+		bs->prepared = bs->rx_buf ? px : NULL;
+
+		if (bs->tx_buf)
+			dma_sync_single_for_device(ctlr->dma_tx->device->dev,
+						   px->tx_addr, tfr->len,
+						   DMA_TO_DEVICE);
+		if (bs->rx_buf)
+			dma_sync_single_for_device(ctlr->dma_rx->device->dev,
+						   px->rx_addr, tfr->len,
+						   DMA_FROM_DEVICE);
+	} else if (bs->chain) {
+		/* all sglist entries but the last are a multiple of 4 bytes */
+		bs->tfr = tfr;
+		bs->tx_prologue = 0;
+		bs->rx_prologue = 0;
+	} else {
+		/*
+		 * Transfer first few bytes without DMA if length of first TX
+		 * or RX sglist entry is not a multiple of 4 bytes (hardware
+		 * limitation).
+		 */
+		bcm2835_spi_transfer_prologue(ctlr, tfr, bs, cs);
+	}
 
 	/* setup tx-DMA */
-	if (bs->tx_buf) {
+	if (px && bs->tx_buf) {
+		cookie = dmaengine_submit(px->tx_desc);
+		ret = dma_submit_error(cookie);
+	} else if (bs->tx_buf) {
 		ret = bcm2835_spi_prepare_sg(ctlr, tfr, bs, slv, true);
 	} else {
 		cookie = dmaengine_submit(bs->fill_tx_desc);
@@ -809,7 +929,10 @@ static int bcm2835_spi_transfer_one_dma(struct spi_controller *ctlr,
 	 * mapping of the rx buffers still takes place
 	 * this saves 10us or more.
 	 */
-	if (bs->rx_buf) {
+	if (px && bs->rx_buf) {
+		cookie = dmaengine_submit(px->rx_desc);
+		ret = dma_submit_error(cookie);
+	} else if (bs->rx_buf) {
 		ret = bcm2835_spi_prepare_sg(ctlr, tfr, bs, slv, false);
 	} else {
 		cookie = dmaengine_submit(slv->clear_rx_desc);
@@ -843,21 +966,239 @@ static int bcm2835_spi_transfer_one_dma(struct spi_controller *ctlr,
 err_reset_hw:
 	bcm2835_spi_reset_hw(bs);
 	bcm2835_spi_undo_prologue(bs);
+	bs->prepared = NULL;
 	return ret;
 }
 
+static struct bcm2835_spi_prepared_xfer *
+bcm2835_spi_find_prepared(struct spi_controller *ctlr,
+			  struct spi_transfer *tfr)
+{
+	struct spi_message *msg = ctlr->cur_msg;
+	struct bcm2835_spi_prepared_msg *pm;
+	unsigned int i;
+
+	if (!msg || !msg->optimized || !msg->opt_state)
+		return NULL;
+
+	pm = msg->opt_state;
+	for (i = 0; i < pm->count; i++)
+		if (pm->xfers[i].tfr == tfr)
+			return &pm->xfers[i];
+
+	return NULL;
+}
+
+static struct bcm2835_spi_chain *
+bcm2835_spi_find_chain(struct bcm2835_spi *bs, struct spi_transfer *tfr)
+{
+	struct spi_transfer *t;
+	unsigned int i;
+
+	for (i = 0; i < bs->num_chains; i++) {
+		for (t = bs->chains[i].first; ;
+		     t = list_next_entry(t, transfer_list)) {
+			if (t == tfr)
+				return &bs->chains[i];
+			if (t == bs->chains[i].last)
+				break;
+		}
+	}
+
+	return NULL;
+}
+
 static bool bcm2835_spi_can_dma(struct spi_controller *ctlr,
 				struct spi_device *spi,
 				struct spi_transfer *tfr)
 {
-	/* we start DMA efforts only on bigger transfers */
-	if (tfr->len < BCM2835_SPI_DMA_MIN_LENGTH)
+	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
+
+	/* prepared transfers are mapped already, keep the core off them */
+	if (bcm2835_spi_find_prepared(ctlr, tfr))
 		return false;
 
+	/* we start DMA efforts only on bigger transfers or chains of them */
+	if (tfr->len < BCM2835_SPI_DMA_MIN_LENGTH)
+		return !!bcm2835_spi_find_chain(bs, tfr);
+
 	/* return OK */
 	return true;
 }
 
+static bool bcm2835_spi_is_contiguous(struct spi_transfer *tfr)
+{
+	if (tfr->tx_buf && (is_vmalloc_addr(tfr->tx_buf) ||
+			    !virt_addr_valid(tfr->tx_buf)))
+		return false;
+	if (tfr->rx_buf && (is_vmalloc_addr(tfr->rx_buf) ||
+			    !virt_addr_valid(tfr->rx_buf)))
+		return false;
+
+	return true;
+}
+
+static bool bcm2835_spi_can_prepare(struct spi_transfer *tfr)
+{
+	/* the buffers are mapped as a whole, they must be contiguous */
+	if (!bcm2835_spi_is_contiguous(tfr))
+		return false;
+
+	/* longer transfers are split up by ->prepare_message() */
+	return tfr->len >= BCM2835_SPI_DMA_MIN_LENGTH && tfr->len <= 65532;
+}
+
+static void bcm2835_spi_release_prepared(struct spi_controller *ctlr,
+					 struct bcm2835_spi_prepared_xfer *px)
+{
+	if (px->tx_desc)
+		dmaengine_desc_free(px->tx_desc);
+	if (px->rx_desc)
+		dmaengine_desc_free(px->rx_desc);
+
+	if (px->tx_addr)
+		dma_unmap_single(ctlr->dma_tx->device->dev, px->tx_addr,
+				 px->tfr->len, DMA_TO_DEVICE);
+	if (px->rx_addr)
+		dma_unmap_single(ctlr->dma_rx->device->dev, px->rx_addr,
+				 px->tfr->len, DMA_FROM_DEVICE);
+}
+
+static struct dma_async_tx_descriptor *
+bcm2835_spi_prepare_single(struct spi_controller *ctlr, struct dma_chan *chan,
+			   dma_addr_t addr, size_t len,
+			   enum dma_transfer_direction dir,
+			   unsigned long flags)
+{
+	struct dma_async_tx_descriptor *desc;
+
+	desc = dmaengine_prep_slave_single(chan, addr, len, dir, flags);
+	if (!desc)
+		return NULL;
+
+	if (dmaengine_desc_set_reuse(desc)) {
+		dmaengine_desc_free(desc);
+		return NULL;
+	}
+
+	return desc;
+}
+
+static int bcm2835_spi_prepare_xfer(struct spi_controller *ctlr,
+				    struct bcm2835_spi_prepared_xfer *px)
+{
+	struct spi_transfer *tfr = px->tfr;
+	struct device *tx_dev = ctlr->dma_tx->device->dev;
+	struct device *rx_dev = ctlr->dma_rx->device->dev;
+
+	if (tfr->tx_buf) {
+		px->tx_addr = dma_map_single(tx_dev, (void *)tfr->tx_buf,
+					     tfr->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(tx_dev, px->tx_addr)) {
+			px->tx_addr = 0;
+			return -ENOMEM;
+		}
+
+		/* same completion scheme as bcm2835_spi_prepare_sg() */
+		px->tx_desc = bcm2835_spi_prepare_single(ctlr, ctlr->dma_tx,
+							 px->tx_addr, tfr->len,
+							 DMA_MEM_TO_DEV,
+							 tfr->rx_buf ? 0 :
+							 DMA_PREP_INTERRUPT);
+		if (!px->tx_desc)
+			return -EINVAL;
+
+		if (!tfr->rx_buf) {
+			px->tx_desc->callback = bcm2835_spi_dma_tx_done;
+			px->tx_desc->callback_param = ctlr;
+		}
+	}
+
+	if (tfr->rx_buf) {
+		px->rx_addr = dma_map_single(rx_dev, tfr->rx_buf, tfr->len,
+					     DMA_FROM_DEVICE);
+		if (dma_mapping_error(rx_dev, px->rx_addr)) {
+			px->rx_addr = 0;
+			return -ENOMEM;
+		}
+
+		px->rx_desc = bcm2835_spi_prepare_single(ctlr, ctlr->dma_rx,
+							 px->rx_addr, tfr->len,
+							 DMA_DEV_TO_MEM,
+							 DMA_PREP_INTERRUPT);
+		if (!px->rx_desc)
+			return -EINVAL;
+
+		px->rx_desc->callback = bcm2835_spi_dma_rx_done;
+		px->rx_desc->callback_param = ctlr;
+	}
+
+	return 0;
+}
+
+static int bcm2835_spi_unoptimize_message(struct spi_message *msg)
+{
+	struct spi_controller *ctlr = msg->spi->controller;
+	struct bcm2835_spi_prepared_msg *pm = msg->opt_state;
+	unsigned int i;
+
+	if (!pm)
+		return 0;
+
+	for (i = 0; i < pm->count; i++)
+		bcm2835_spi_release_prepared(ctlr, &pm->xfers[i]);
+
+	kfree(pm);
+	msg->opt_state = NULL;
+
+	return 0;
+}
+
+/*
+ * Map the buffers of all DMA-sized transfers of a message which is going to
+ * be submitted over and over again and prepare reusable DMA descriptors for
+ * them, so that bcm2835_spi_transfer_one_dma() only needs to submit them.
+ * Transfers which do not qualify take the regular path.
+ */
+static int bcm2835_spi_optimize_message(struct spi_message *msg)
+{
+	struct spi_controller *ctlr = msg->spi->controller;
+	struct bcm2835_spi_prepared_msg *pm;
+	struct spi_transfer *tfr;
+	unsigned int count = 0;
+	int ret;
+
+	if (!ctlr->can_dma || msg->is_dma_mapped)
+		return 0;
+
+	list_for_each_entry(tfr, &msg->transfers, transfer_list)
+		if (bcm2835_spi_can_prepare(tfr))
+			count++;
+
+	if (!count)
+		return 0;
+
+	pm = kzalloc(struct_size(pm, xfers, count), GFP_KERNEL);
+	if (!pm)
+		return -ENOMEM;
+
+	msg->opt_state = pm;
+
+	list_for_each_entry(tfr, &msg->transfers, transfer_list) {
+		if (!bcm2835_spi_can_prepare(tfr))
+			continue;
+
+		pm->xfers[pm->count].tfr = tfr;
+		ret = bcm2835_spi_prepare_xfer(ctlr, &pm->xfers[pm->count++]);
+		if (ret) {
+			bcm2835_spi_unoptimize_message(msg);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
 static void bcm2835_dma_release(struct spi_controller *ctlr,
 				struct bcm2835_spi *bs)
 {
@@ -980,6 +1321,207 @@ static int bcm2835_dma_init(struct spi_controller *ctlr, struct device *dev,
 	return ret;
 }
 
+static void bcm2835_spi_free_chains(struct bcm2835_spi *bs)
+{
+	unsigned int i;
+
+	for (i = 0; i < bs->num_chains; i++) {
+		kfree(bs->chains[i].tx_sgl);
+		kfree(bs->chains[i].rx_sgl);
+	}
+
+	kfree(bs->chains);
+	bs->chains = NULL;
+	bs->num_chains = 0;
+	bs->chain_next = NULL;
+	bs->chain_remaining = 0;
+}
+
+/* may @tfr be part of a chain at all ? */
+static bool bcm2835_spi_can_link(struct spi_controller *ctlr,
+				 struct spi_transfer *tfr)
+{
+	/* every transfer of a chain maps to exactly one sglist entry */
+	if (!tfr->len || tfr->ptp_sts || !bcm2835_spi_is_contiguous(tfr))
+		return false;
+
+	return !bcm2835_spi_find_prepared(ctlr, tfr);
+}
+
+/* may @next be performed in the same DMA transfer as @prev ? */
+static bool bcm2835_spi_can_chain(struct spi_controller *ctlr,
+				  struct spi_transfer *prev,
+				  struct spi_transfer *next)
+{
+	/* chip select stays asserted and the clock keeps running */
+	if (prev->cs_change || prev->delay.value || prev->word_delay.value)
+		return false;
+
+	if (prev->speed_hz != next->speed_hz ||
+	    prev->bits_per_word != next->bits_per_word)
+		return false;
+
+	/* the TX and RX side are either DMA'ed or filled/cleared throughout */
+	if (!prev->tx_buf != !next->tx_buf || !prev->rx_buf != !next->rx_buf)
+		return false;
+
+	/* the DMA engine pads every sglist entry to a multiple of 4 bytes */
+	if (prev->len & 3)
+		return false;
+
+	return bcm2835_spi_can_link(ctlr, next);
+}
+
+static int bcm2835_spi_add_chain(struct bcm2835_spi *bs,
+				 struct spi_transfer *first,
+				 struct spi_transfer *last,
+				 unsigned int count, unsigned int len)
+{
+	struct bcm2835_spi_chain *chains, *chain;
+
+	if (!first || count < 2 || len < BCM2835_SPI_DMA_MIN_LENGTH)
+		return 0;
+
+	chains = krealloc_array(bs->chains, bs->num_chains + 1,
+				sizeof(*chains), GFP_KERNEL);
+	if (!chains)
+		return -ENOMEM;
+	bs->chains = chains;
+
+	chain = &chains[bs->num_chains++];
+	memset(chain, 0, sizeof(*chain));
+	chain->first = first;
+	chain->last = last;
+	chain->count = count;
+	chain->len = len;
+
+	if (first->tx_buf) {
+		chain->tx_sgl = kcalloc(count, sizeof(*chain->tx_sgl),
+					GFP_KERNEL);
+		if (!chain->tx_sgl)
+			return -ENOMEM;
+		sg_init_table(chain->tx_sgl, count);
+	}
+
+	if (first->rx_buf) {
+		chain->rx_sgl = kcalloc(count, sizeof(*chain->rx_sgl),
+					GFP_KERNEL);
+		if (!chain->rx_sgl)
+			return -ENOMEM;
+		sg_init_table(chain->rx_sgl, count);
+	}
+
+	return 0;
+}
+
+/*
+ * Find runs of transfers in @msg which can be performed as one DMA transfer:
+ * Chip select stays asserted between them and the SPI controller does not
+ * care where one transfer ends and the next begins, as long as DLEN covers
+ * them all.  This saves the interrupt, the thread wakeup and the DMA setup
+ * for all but the first transfer of a run, e.g. when reading a daisy chain
+ * of ADCs.
+ */
+static int bcm2835_spi_setup_chains(struct spi_controller *ctlr,
+				    struct spi_message *msg)
+{
+	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
+	struct spi_transfer *tfr, *first = NULL, *prev = NULL;
+	unsigned int count = 0, len = 0;
+	int ret;
+
+	bcm2835_spi_free_chains(bs);
+
+	if (msg->is_dma_mapped)
+		return 0;
+
+	list_for_each_entry(tfr, &msg->transfers, transfer_list) {
+		if (first && bcm2835_spi_can_chain(ctlr, prev, tfr) &&
+		    len + tfr->len <= 65532) {
+			count++;
+			len += tfr->len;
+			prev = tfr;
+			continue;
+		}
+
+		ret = bcm2835_spi_add_chain(bs, first, prev, count, len);
+		if (ret)
+			goto err;
+
+		first = bcm2835_spi_can_link(ctlr, tfr) ? tfr : NULL;
+		prev = tfr;
+		count = 1;
+		len = tfr->len;
+	}
+
+	ret = bcm2835_spi_add_chain(bs, first, prev, count, len);
+	if (ret)
+		goto err;
+
+	return 0;
+
+err:
+	bcm2835_spi_free_chains(bs);
+	return ret;
+}
+
+/*
+ * Perform all transfers of @chain with a single DMA transfer.  The buffers
+ * have been mapped by the core, one sglist entry per transfer since they
+ * are contiguous; gather them into the chain's own sglists.
+ */
+static int bcm2835_spi_transfer_chain(struct spi_controller *ctlr,
+				      struct bcm2835_spi_chain *chain,
+				      struct bcm2835_spidev *slv,
+				      u32 cs)
+{
+	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
+	struct spi_transfer *tfr = chain->first, *t;
+	unsigned int i = 0;
+	int ret;
+
+	for (t = tfr; ; t = list_next_entry(t, transfer_list)) {
+		if ((t->tx_buf && t->tx_sg.nents != 1) ||
+		    (t->rx_buf && t->rx_sg.nents != 1))
+			return -EINVAL;
+
+		if (t->tx_buf) {
+			sg_dma_address(&chain->tx_sgl[i]) =
+				sg_dma_address(t->tx_sg.sgl);
+			sg_dma_len(&chain->tx_sgl[i]) =
+				sg_dma_len(t->tx_sg.sgl);
+		}
+		if (t->rx_buf) {
+			sg_dma_address(&chain->rx_sgl[i]) =
+				sg_dma_address(t->rx_sg.sgl);
+			sg_dma_len(&chain->rx_sgl[i]) =
+				sg_dma_len(t->rx_sg.sgl);
+		}
+
+		t->effective_speed_hz = tfr->effective_speed_hz;
+		i++;
+
+		if (t == chain->last)
+			break;
+	}
+
+	bs->tx_len = chain->len;
+	bs->rx_len = chain->len;
+
+	/* the following transfers are done once this one completes */
+	bs->chain_next = list_next_entry(tfr, transfer_list);
+	bs->chain_remaining = chain->count - 1;
+
+	bs->chain = chain;
+	ret = bcm2835_spi_transfer_one_dma(ctlr, tfr, slv, NULL, cs);
+	bs->chain = NULL;
+
+	if (ret < 0)
+		bs->chain_remaining = 0;
+
+	return ret;
+}
+
 static int bcm2835_spi_transfer_one_poll(struct spi_controller *ctlr,
 					 struct spi_device *spi,
 					 struct spi_transfer *tfr,
@@ -1041,6 +1583,8 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 {
 	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
 	struct bcm2835_spidev *slv = spi_get_ctldata(spi);
+	struct bcm2835_spi_prepared_xfer *px;
+	struct bcm2835_spi_chain *chain;
 	unsigned long spi_hz, cdiv;
 	unsigned long hz_per_byte, byte_limit;
 	u32 cs = slv->prepare_cs;
@@ -1055,6 +1599,14 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 		return 0;
 	}
 
+	/* already performed together with the previous transfers */
+	if (bs->chain_remaining && tfr == bs->chain_next) {
+		bs->count_transfer_dma_chained++;
+		bs->chain_next = list_next_entry(tfr, transfer_list);
+		bs->chain_remaining--;
+		return 0;
+	}
+
 	/* set clock */
 	spi_hz = tfr->speed_hz;
 
@@ -1092,6 +1644,19 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 	hz_per_byte = polling_limit_us ? (9 * 1000000) / polling_limit_us : 0;
 	byte_limit = hz_per_byte ? tfr->effective_speed_hz / hz_per_byte : 1;
 
+	/*
+	 * transfers of an optimized message have their DMA set up already;
+	 * the buffers are owned by the DMA mapping so always use it
+	 */
+	px = ctlr->can_dma ? bcm2835_spi_find_prepared(ctlr, tfr) : NULL;
+	if (px)
+		return bcm2835_spi_transfer_one_dma(ctlr, tfr, slv, px, cs);
+
+	/* perform a chain of transfers as a single DMA transfer */
+	chain = ctlr->can_dma ? bcm2835_spi_find_chain(bs, tfr) : NULL;
+	if (chain && chain->first == tfr)
+		return bcm2835_spi_transfer_chain(ctlr, chain, slv, cs);
+
 	/* run in polling mode for short transfers */
 	if (tfr->len < byte_limit)
 		return bcm2835_spi_transfer_one_poll(ctlr, spi, tfr, cs);
@@ -1101,7 +1666,7 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 	 * this 1 idle clock cycle pattern but runs the spi clock without gaps
 	 */
 	if (ctlr->can_dma && bcm2835_spi_can_dma(ctlr, spi, tfr))
-		return bcm2835_spi_transfer_one_dma(ctlr, tfr, slv, cs);
+		return bcm2835_spi_transfer_one_dma(ctlr, tfr, slv, NULL, cs);
 
 	/* run in interrupt-mode */
 	return bcm2835_spi_transfer_one_irq(ctlr, spi, tfr, cs, true);
@@ -1125,6 +1690,10 @@ static int bcm2835_spi_prepare_message(struct spi_controller *ctlr,
 						  GFP_KERNEL | GFP_DMA);
 		if (ret)
 			return ret;
+
+		ret = bcm2835_spi_setup_chains(ctlr, msg);
+		if (ret)
+			return ret;
 	}
 
 	/*
@@ -1136,6 +1705,16 @@ static int bcm2835_spi_prepare_message(struct spi_controller *ctlr,
 	return 0;
 }
 
+static int bcm2835_spi_unprepare_message(struct spi_controller *ctlr,
+					 struct spi_message *msg)
+{
+	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
+
+	bcm2835_spi_free_chains(bs);
+
+	return 0;
+}
+
 static void bcm2835_spi_handle_err(struct spi_controller *ctlr,
 				   struct spi_message *msg)
 {
@@ -1151,6 +1730,8 @@ static void bcm2835_spi_handle_err(struct spi_controller *ctlr,
 		bs->rx_dma_active = false;
 	}
 	bcm2835_spi_undo_prologue(bs);
+	bs->prepared = NULL;
+	bs->chain_remaining = 0;
 
 	/* and reset */
 	bcm2835_spi_reset_hw(bs);
@@ -1343,6 +1924,9 @@ static int bcm2835_spi_probe(struct platform_device *pdev)
 	ctlr->transfer_one = bcm2835_spi_transfer_one;
 	ctlr->handle_err = bcm2835_spi_handle_err;
 	ctlr->prepare_message = bcm2835_spi_prepare_message;
+	ctlr->unprepare_message = bcm2835_spi_unprepare_message;
+	ctlr->optimize_message = bcm2835_spi_optimize_message;
+	ctlr->unoptimize_message = bcm2835_spi_unoptimize_message;
 	ctlr->dev.of_node = pdev->dev.of_node;
 
 	bs = spi_controller_get_devdata(ctlr);
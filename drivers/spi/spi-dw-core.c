@@ -24,6 +24,11 @@
 #include <linux/debugfs.h>
 #endif
 
+static unsigned int polling_limit_us = 30;
+module_param(polling_limit_us, uint, 0664);
+MODULE_PARM_DESC(polling_limit_us,
+		 "time in us to run a transfer in polling mode\n");
+
 /* Slave spi_device related */
 struct dw_spi_chip_data {
 	u32 cr0;
@@ -71,6 +76,13 @@ static int dw_spi_debugfs_init(struct dw_spi *dws)
 	dws->regset.base = dws->regs;
 	debugfs_create_regset32("registers", 0400, dws->debugfs, &dws->regset);
 
+	debugfs_create_u64("count_transfer_polling", 0444, dws->debugfs,
+			   &dws->count_transfer_polling);
+	debugfs_create_u64("count_transfer_irq", 0444, dws->debugfs,
+			   &dws->count_transfer_irq);
+	debugfs_create_u64("count_transfer_dma", 0444, dws->debugfs,
+			   &dws->count_transfer_dma);
+
 	return 0;
 }
 
@@ -429,6 +441,7 @@ static int dw_spi_transfer_one(struct spi_controller *master,
 		.dfs = transfer->bits_per_word,
 		.freq = transfer->speed_hz,
 	};
+	unsigned long hz_per_byte, byte_limit;
 	int ret;
 
 	dws->dma_mapped = 0;
@@ -465,11 +478,25 @@ static int dw_spi_transfer_one(struct spi_controller *master,
 
 	dw_spi_enable_chip(dws, 1);
 
-	if (dws->dma_mapped)
+	if (dws->dma_mapped) {
+		dws->count_transfer_dma++;
 		return dws->dma_ops->dma_transfer(dws, transfer);
-	else if (dws->irq == IRQ_NOTCONNECTED)
+	}
+
+	/*
+	 * Polling is cheaper than taking an interrupt for transfers that
+	 * complete within polling_limit_us; 9 Hz of bus clock per byte
+	 * per microsecond leaves some margin for the inter-byte gaps.
+	 */
+	hz_per_byte = polling_limit_us ? (9 * 1000000) / polling_limit_us : 0;
+	byte_limit = hz_per_byte ? dws->current_freq / hz_per_byte : 1;
+
+	if (dws->irq == IRQ_NOTCONNECTED || transfer->len < byte_limit) {
+		dws->count_transfer_polling++;
 		return dw_spi_poll_transfer(dws, transfer);
+	}
 
+	dws->count_transfer_irq++;
 	dw_spi_irq_setup(dws);
 
 	return 1;
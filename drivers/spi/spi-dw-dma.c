@@ -286,6 +286,11 @@ static void dw_spi_dma_tx_done(void *arg)
 static int dw_spi_dma_config_tx(struct dw_spi *dws)
 {
 	struct dma_slave_config txconf;
+	int ret;
+
+	/* The channel keeps its config between the transfers of a message */
+	if (dws->dma_tx_n_bytes == dws->n_bytes)
+		return 0;
 
 	memset(&txconf, 0, sizeof(txconf));
 	txconf.direction = DMA_MEM_TO_DEV;
@@ -295,7 +300,10 @@ static int dw_spi_dma_config_tx(struct dw_spi *dws)
 	txconf.dst_addr_width = dw_spi_dma_convert_width(dws->n_bytes);
 	txconf.device_fc = false;
 
-	return dmaengine_slave_config(dws->txchan, &txconf);
+	ret = dmaengine_slave_config(dws->txchan, &txconf);
+	dws->dma_tx_n_bytes = ret ? 0 : dws->n_bytes;
+
+	return ret;
 }
 
 static int dw_spi_dma_submit_tx(struct dw_spi *dws, struct scatterlist *sgl,
@@ -387,6 +395,10 @@ static void dw_spi_dma_rx_done(void *arg)
 static int dw_spi_dma_config_rx(struct dw_spi *dws)
 {
 	struct dma_slave_config rxconf;
+	int ret;
+
+	if (dws->dma_rx_n_bytes == dws->n_bytes)
+		return 0;
 
 	memset(&rxconf, 0, sizeof(rxconf));
 	rxconf.direction = DMA_DEV_TO_MEM;
@@ -396,7 +408,10 @@ static int dw_spi_dma_config_rx(struct dw_spi *dws)
 	rxconf.src_addr_width = dw_spi_dma_convert_width(dws->n_bytes);
 	rxconf.device_fc = false;
 
-	return dmaengine_slave_config(dws->rxchan, &rxconf);
+	ret = dmaengine_slave_config(dws->rxchan, &rxconf);
+	dws->dma_rx_n_bytes = ret ? 0 : dws->n_bytes;
+
+	return ret;
 }
 
 static int dw_spi_dma_submit_rx(struct dw_spi *dws, struct scatterlist *sgl,
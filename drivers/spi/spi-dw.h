@@ -194,6 +194,13 @@ struct dw_spi {
 	dma_addr_t		dma_addr; /* phy address of the Data register */
 	const struct dw_spi_dma_ops *dma_ops;
 	struct completion	dma_completion;
+	u8			dma_tx_n_bytes;	/* Tx channel configured for */
+	u8			dma_rx_n_bytes;	/* Rx channel configured for */
+
+	/* Transfer mode statistics */
+	u64			count_transfer_polling;
+	u64			count_transfer_irq;
+	u64			count_transfer_dma;
 
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs;
@@ -3996,6 +3996,74 @@ int spi_async(struct spi_device *spi, struct spi_message *message)
 }
 EXPORT_SYMBOL_GPL(spi_async);
 
+/**
+ * spi_optimize_message - do one-time controller setup for a message
+ * @spi: device the message will be submitted to
+ * @msg: the message to optimize
+ * Context: can sleep
+ *
+ * Peripheral drivers that submit the same message over and over again,
+ * with only the contents of the buffers changing, may call this once so
+ * the controller driver can do its per-message preparation (e.g. DMA
+ * mapping and descriptor setup) up front instead of for every transfer.
+ *
+ * While the message is optimized the transfer list, the transfer lengths,
+ * modes and buffer pointers must not be changed, and the buffers must stay
+ * allocated.  Call spi_unoptimize_message() before doing any of this.  The
+ * message is submitted with spi_sync() or spi_async() as usual and is still
+ * validated on every submission.
+ *
+ * Return: zero on success, else a negative error code.
+ */
+int spi_optimize_message(struct spi_device *spi, struct spi_message *msg)
+{
+	struct spi_controller *ctlr = spi->controller;
+	int ret;
+
+	if (msg->optimized)
+		return -EBUSY;
+
+	if (list_empty(&msg->transfers))
+		return -EINVAL;
+
+	msg->spi = spi;
+	msg->opt_state = NULL;
+
+	if (ctlr->optimize_message) {
+		ret = ctlr->optimize_message(msg);
+		if (ret)
+			return ret;
+	}
+
+	msg->optimized = true;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(spi_optimize_message);
+
+/**
+ * spi_unoptimize_message - release the resources of an optimized message
+ * @msg: message passed to spi_optimize_message() before
+ * Context: can sleep
+ *
+ * The message must not be in flight.
+ */
+void spi_unoptimize_message(struct spi_message *msg)
+{
+	struct spi_controller *ctlr;
+
+	if (!msg->optimized)
+		return;
+
+	ctlr = msg->spi->controller;
+	if (ctlr->unoptimize_message)
+		ctlr->unoptimize_message(msg);
+
+	msg->optimized = false;
+	msg->opt_state = NULL;
+}
+EXPORT_SYMBOL_GPL(spi_unoptimize_message);
+
 /**
  * spi_async_locked - version of spi_async with exclusive bus usage
  * @spi: device with which data will be exchanged
@@ -228,6 +228,112 @@ static void fbtft_reset(struct fbtft_par *par)
 	gpiod_set_value_cansleep(par->gpio.cs, 1);  /* Activate chip */
 }
 
+/*
+ * The generic write_vmem() functions send exactly the part of video memory
+ * they are asked for, so only changed spans need to go out.
+ */
+static bool fbtft_can_diff(struct fbtft_par *par)
+{
+	int (*write_vmem)(struct fbtft_par *par, size_t offset, size_t len);
+
+	write_vmem = par->fbtftops.write_vmem;
+
+	return write_vmem == fbtft_write_vmem16_bus8 ||
+	       write_vmem == fbtft_write_vmem16_bus9 ||
+	       write_vmem == fbtft_write_vmem16_bus16 ||
+	       write_vmem == fbtft_write_vmem8_bus8;
+}
+
+/* Find the first and last changed pixel of a line */
+static bool fbtft_line_span(struct fbtft_par *par, unsigned int y,
+			    unsigned int *xs, unsigned int *xe)
+{
+	size_t line_length = par->info->fix.line_length;
+	unsigned int cpp = par->info->var.bits_per_pixel / 8;
+	const u8 *vmem = par->info->screen_buffer + y * line_length;
+	const u8 *shadow = par->shadow + y * line_length;
+	size_t first, last;
+
+	if (!memcmp(vmem, shadow, line_length))
+		return false;
+
+	for (first = 0; vmem[first] == shadow[first]; first++)
+		;
+	for (last = line_length - 1; vmem[last] == shadow[last]; last--)
+		;
+
+	*xs = first / cpp;
+	*xe = last / cpp;
+
+	return true;
+}
+
+/*
+ * Send the runs of changed lines between start_line and end_line, each as
+ * one window that spans the changed columns if the controller supports
+ * column windows. The shadow is updated before the data is sent, so a
+ * concurrent write to video memory is at worst sent twice, never lost.
+ */
+static int fbtft_update_diff(struct fbtft_par *par, unsigned int start_line,
+			     unsigned int end_line, size_t *sent)
+{
+	struct fb_info *info = par->info;
+	size_t line_length = info->fix.line_length;
+	unsigned int cpp = info->var.bits_per_pixel / 8;
+	unsigned int xres = info->var.xres;
+	bool columns = par->fbtftops.set_addr_win == fbtft_set_addr_win;
+	unsigned int y, ys, xs, xe, x1, x2;
+	size_t offset, len;
+	int ret;
+
+	for (y = start_line; y <= end_line; y++) {
+		if (!fbtft_line_span(par, y, &xs, &xe))
+			continue;
+
+		ys = y;
+		while (y < end_line && fbtft_line_span(par, y + 1, &x1, &x2)) {
+			xs = min(xs, x1);
+			xe = max(xe, x2);
+			y++;
+		}
+
+		/* a window of mostly full lines is cheaper as one transfer */
+		if (!columns || (xe - xs + 1) * 2 >= xres) {
+			xs = 0;
+			xe = xres - 1;
+		}
+
+		if (par->fbtftops.set_addr_win)
+			par->fbtftops.set_addr_win(par, xs, ys, xe, y);
+
+		if (xs == 0 && xe == xres - 1) {
+			offset = ys * line_length;
+			len = (y - ys + 1) * line_length;
+			memcpy(par->shadow + offset,
+			       info->screen_buffer + offset, len);
+			ret = par->fbtftops.write_vmem(par, offset, len);
+			if (ret < 0)
+				return ret;
+			*sent += len;
+			continue;
+		}
+
+		for (offset = ys * line_length + xs * cpp;
+		     offset <= y * line_length + xs * cpp;
+		     offset += line_length) {
+			len = (xe - xs + 1) * cpp;
+			memcpy(par->shadow + offset,
+			       info->screen_buffer + offset, len);
+			ret = par->fbtftops.write_vmem(par, offset, len);
+			if (ret < 0)
+				return ret;
+			*sent += len;
+		}
+	}
+
+	return 0;
+}
+
 static void fbtft_update_display(struct fbtft_par *par, unsigned int start_line,
 				 unsigned int end_line)
 {
@@ -268,13 +374,35 @@ static void fbtft_update_display(struct fbtft_par *par, unsigned int start_line,
 	fbtft_par_dbg(DEBUG_UPDATE_DISPLAY, par, "%s(start_line=%u, end_line=%u)\n",
 		      __func__, start_line, end_line);
 
+	if (!par->shadow && fbtft_can_diff(par))
+		par->shadow = vmalloc(par->info->fix.smem_len);
+
+	if (par->shadow && par->shadow_valid) {
+		len = 0;
+		ret = fbtft_update_diff(par, start_line, end_line, &len);
+		if (ret < 0)
+			par->shadow_valid = false;
+		goto out;
+	}
+
 	if (par->fbtftops.set_addr_win)
 		par->fbtftops.set_addr_win(par, 0, start_line,
 				par->info->var.xres - 1, end_line);
 
 	offset = start_line * par->info->fix.line_length;
 	len = (end_line - start_line + 1) * par->info->fix.line_length;
+
+	/* the first update goes out in full and fills the shadow */
+	if (par->shadow && start_line == 0 &&
+	    end_line == par->info->var.yres - 1) {
+		memcpy(par->shadow, par->info->screen_buffer, len);
+		par->shadow_valid = true;
+	}
+
 	ret = par->fbtftops.write_vmem(par, offset, len);
+	if (ret < 0)
+		par->shadow_valid = false;
+out:
 	if (ret < 0)
 		dev_err(par->info->device,
 			"%s: write_vmem failed to update display buffer\n",
@@ -763,7 +891,10 @@ EXPORT_SYMBOL(fbtft_framebuffer_alloc);
  */
 void fbtft_framebuffer_release(struct fb_info *info)
 {
+	struct fbtft_par *par = info->par;
+
 	fb_deferred_io_cleanup(info);
+	vfree(par->shadow);
 	vfree(info->screen_buffer);
 	framebuffer_release(info);
 }
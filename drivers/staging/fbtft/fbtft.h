@@ -167,6 +167,9 @@ struct fbtft_platform_data {
  * @dirty_lock: Protects dirty_lines_start and dirty_lines_end
  * @dirty_lines_start: Where to begin updating display
  * @dirty_lines_end: Where to end updating display
+ * @shadow: Copy of what has been sent to the display, used to only send
+ *          the changed parts of the dirty lines
+ * @shadow_valid: @shadow matches the display memory
  * @gpio.reset: GPIO used to reset display
  * @gpio.dc: Data/Command signal, also known as RS
  * @gpio.rd: Read latching signal
@@ -205,6 +208,8 @@ struct fbtft_par {
 	spinlock_t dirty_lock;
 	unsigned int dirty_lines_start;
 	unsigned int dirty_lines_end;
+	u8 *shadow;
+	bool shadow_valid;
 	struct {
 		struct gpio_desc *reset;
 		struct gpio_desc *dc;
@@ -136,9 +136,16 @@ struct bcm2835_isp_dev {
 	struct media_pad pad[BCM2835_ISP_NUM_NODES];
 	atomic_t num_streaming;
 
-	/* Image pipeline controls. */
-	int r_gain;
-	int b_gain;
+	/* Image pipeline controls, clustered to be sent in one message. */
+	struct v4l2_ctrl *r_gain;
+	struct v4l2_ctrl *b_gain;
+
+	/*
+	 * Lens shading table, kept imported to the VPU while it is in use.
+	 * Protected by the control handler lock.
+	 */
+	struct dma_buf *ls_dmabuf;
+	void *ls_vcsm_handle;
 };
 
 struct bcm2835_isp_buffer {
@@ -190,8 +197,8 @@ static int set_wb_gains(struct bcm2835_isp_node *node)
 {
 	struct bcm2835_isp_dev *dev = node_get_dev(node);
 	struct mmal_parameter_awbgains gains = {
-		.r_gain = { dev->r_gain, 1000 },
-		.b_gain = { dev->b_gain, 1000 }
+		.r_gain = { dev->r_gain->val, 1000 },
+		.b_gain = { dev->b_gain->val, 1000 }
 	};
 
 	return set_isp_param(node, MMAL_PARAMETER_CUSTOM_AWB_GAINS,
@@ -209,6 +216,17 @@ static int set_digital_gain(struct bcm2835_isp_node *node, uint32_t gain)
 			     &digital_gain, sizeof(digital_gain));
 }
 
+static void release_ls_table(struct bcm2835_isp_dev *dev)
+{
+	if (!dev->ls_dmabuf)
+		return;
+
+	vc_sm_cma_free(dev->ls_vcsm_handle);
+	dma_buf_put(dev->ls_dmabuf);
+	dev->ls_dmabuf = NULL;
+	dev->ls_vcsm_handle = NULL;
+}
+
 static const struct bcm2835_isp_fmt *get_fmt(u32 mmal_fmt)
 {
 	unsigned int i;
@@ -670,6 +688,10 @@ static void bcm2835_isp_node_stop_streaming(struct vb2_queue *q)
 			      MMAL_PARAMETER_LENS_SHADING_OVERRIDE,
 			      &ls, sizeof(ls));
 
+		mutex_lock(dev->ctrl_handler.lock);
+		release_ls_table(dev);
+		mutex_unlock(dev->ctrl_handler.lock);
+
 		ret = vchiq_mmal_component_disable(dev->mmal_instance,
 						   dev->component);
 		if (ret) {
@@ -736,11 +758,7 @@ static int bcm2835_isp_s_ctrl(struct v4l2_ctrl *ctrl)
 	 */
 	switch (ctrl->id) {
 	case V4L2_CID_RED_BALANCE:
-		dev->r_gain = ctrl->val;
-		ret = set_wb_gains(node);
-		break;
-	case V4L2_CID_BLUE_BALANCE:
-		dev->b_gain = ctrl->val;
+		/* Cluster master, for both gains */
 		ret = set_wb_gains(node);
 		break;
 	case V4L2_CID_DIGITAL_GAIN:
@@ -771,28 +789,33 @@ static int bcm2835_isp_s_ctrl(struct v4l2_ctrl *ctrl)
 		if (IS_ERR_OR_NULL(dmabuf))
 			return -EINVAL;
 
-		ret = vc_sm_cma_import_dmabuf(dmabuf, &vcsm_handle);
-		if (ret) {
+		/*
+		 * The table is usually rewritten in place each frame, so
+		 * only import it when it is a different dmabuf. Our
+		 * reference keeps the identity check valid.
+		 */
+		if (dmabuf != dev->ls_dmabuf) {
+			ret = vc_sm_cma_import_dmabuf(dmabuf, &vcsm_handle);
+			if (ret) {
+				dma_buf_put(dmabuf);
+				return -EINVAL;
+			}
+
+			release_ls_table(dev);
+			dev->ls_dmabuf = dmabuf;
+			dev->ls_vcsm_handle = vcsm_handle;
+		} else {
 			dma_buf_put(dmabuf);
-			return -EINVAL;
 		}
 
-		ls.mem_handle_table = vc_sm_cma_int_handle(vcsm_handle);
+		ls.mem_handle_table = vc_sm_cma_int_handle(dev->ls_vcsm_handle);
 		if (ls.mem_handle_table)
-			/* The VPU will take a reference on the vcsm handle,
-			 * which in turn will retain a reference on the dmabuf.
-			 * This code can therefore safely release all
-			 * references to the buffer.
-			 */
 			ret = set_isp_param(node,
 					    MMAL_PARAMETER_LENS_SHADING_OVERRIDE,
 					    &ls,
 					    sizeof(ls));
 		else
 			ret = -EINVAL;
-
-		vc_sm_cma_free(vcsm_handle);
-		dma_buf_put(dmabuf);
 		break;
 	}
 	case V4L2_CID_USER_BCM2835_ISP_BLACK_LEVEL:
@@ -1416,16 +1439,20 @@ static int register_node(struct bcm2835_isp_dev *dev,
 			goto queue_cleanup;
 		}
 
-		dev->r_gain = 1000;
-		dev->b_gain = 1000;
+		dev->r_gain =
+			v4l2_ctrl_new_std(&dev->ctrl_handler,
+					  &bcm2835_isp_ctrl_ops,
+					  V4L2_CID_RED_BALANCE, 1, 0xffff, 1,
+					  1000);
 
-		v4l2_ctrl_new_std(&dev->ctrl_handler,  &bcm2835_isp_ctrl_ops,
-				  V4L2_CID_RED_BALANCE, 1, 0xffff, 1,
-				  dev->r_gain);
+		dev->b_gain =
+			v4l2_ctrl_new_std(&dev->ctrl_handler,
+					  &bcm2835_isp_ctrl_ops,
+					  V4L2_CID_BLUE_BALANCE, 1, 0xffff, 1,
+					  1000);
 
-		v4l2_ctrl_new_std(&dev->ctrl_handler, &bcm2835_isp_ctrl_ops,
-				  V4L2_CID_BLUE_BALANCE, 1, 0xffff, 1,
-				  dev->b_gain);
+		/* Both gains go in one MMAL parameter, so one VCHIQ message */
+		v4l2_ctrl_cluster(2, &dev->r_gain);
 
 		v4l2_ctrl_new_std(&dev->ctrl_handler, &bcm2835_isp_ctrl_ops,
 				  V4L2_CID_DIGITAL_GAIN, 1, 0xffff, 1, 1000);
@@ -1689,6 +1716,7 @@ static void bcm2835_isp_remove_instance(struct bcm2835_isp_dev *dev)
 		vchiq_mmal_component_finalise(dev->mmal_instance,
 					      dev->component);
 
+	release_ls_table(dev);
 	vchiq_mmal_finalise(dev->mmal_instance);
 }
 
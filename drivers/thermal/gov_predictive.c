@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ *  gov_predictive.c - A thermal governor acting on the temperature trend
+ *
+ *  This works like step_wise, moving the cooling devices one step per
+ *  update, but on the temperature the zone is heading to rather than the
+ *  one it is at: the current temperature plus its slope over the
+ *  prediction horizon. So the cooling devices are stepped up gradually
+ *  before a trip point is reached, rather than suddenly once it is, and
+ *  the system slows down before the firmware has to cut the clocks.
+ *
+ *  A uevent is sent when a trip point is predicted to be crossed, and
+ *  when that prediction clears, so that user space can shed optional
+ *  load early:
+ *
+ *	EVENT=predicted|cleared TRIP=<n> TEMP=<mC> PREDICTED=<mC> SLOPE=<mC/s>
+ */
+
+#include <linux/kobject.h>
+#include <linux/minmax.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+#include <trace/events/thermal.h>
+
+#include "thermal_core.h"
+
+static unsigned int predictive_horizon_ms = 10000;
+module_param(predictive_horizon_ms, uint, 0644);
+MODULE_PARM_DESC(predictive_horizon_ms,
+		 "How far ahead the predictive governor looks, in ms");
+
+/* Updates closer than this are not used to estimate the slope */
+#define PREDICTIVE_MIN_INTERVAL_MS	100
+
+/**
+ * struct predictive_params - per thermal zone data
+ * @slope:	smoothed temperature slope, in millicelsius per second
+ * @temp:	temperature the slope was last updated with
+ * @time:	when the slope was last updated
+ * @last_trip:	trip handled last, to tell when a zone update starts
+ * @predicted:	bitmap of the trips predicted to be crossed
+ */
+struct predictive_params {
+	int slope;
+	int temp;
+	ktime_t time;
+	int last_trip;
+	unsigned long predicted;
+};
+
+static void predictive_update_slope(struct thermal_zone_device *tz)
+{
+	struct predictive_params *params = tz->governor_data;
+	ktime_t now = ktime_get();
+	s64 dt = ktime_ms_delta(now, params->time);
+	int raw;
+
+	if (dt < PREDICTIVE_MIN_INTERVAL_MS)
+		return;
+
+	if (params->time) {
+		raw = div64_s64((s64)(tz->temperature - params->temp) *
+				MSEC_PER_SEC, dt);
+		params->slope = (3 * params->slope + raw) / 4;
+	}
+
+	params->temp = tz->temperature;
+	params->time = now;
+}
+
+static int predictive_temp(struct thermal_zone_device *tz)
+{
+	struct predictive_params *params = tz->governor_data;
+	s64 rise = 0;
+
+	if (params->slope > 0)
+		rise = div_s64((s64)params->slope * predictive_horizon_ms,
+			       MSEC_PER_SEC);
+
+	return tz->temperature + min_t(s64, rise, INT_MAX / 2);
+}
+
+static void predictive_notify(struct thermal_zone_device *tz, int trip,
+			      bool predicted, int predicted_temp)
+{
+	struct predictive_params *params = tz->governor_data;
+	char event[24], trip_str[16], temp[24], pred[24], slope[24];
+	char *envp[] = { event, trip_str, temp, pred, slope, NULL };
+
+	snprintf(event, sizeof(event), "EVENT=%s",
+		 predicted ? "predicted" : "cleared");
+	snprintf(trip_str, sizeof(trip_str), "TRIP=%d", trip);
+	snprintf(temp, sizeof(temp), "TEMP=%d", tz->temperature);
+	snprintf(pred, sizeof(pred), "PREDICTED=%d", predicted_temp);
+	snprintf(slope, sizeof(slope), "SLOPE=%d", params->slope);
+
+	kobject_uevent_env(&tz->device.kobj, KOBJ_CHANGE, envp);
+}
+
+static unsigned long get_target_state(struct thermal_instance *instance,
+				      bool throttle, bool release)
+{
+	struct thermal_cooling_device *cdev = instance->cdev;
+	unsigned long cur_state;
+
+	cdev->ops->get_cur_state(cdev, &cur_state);
+
+	if (throttle)
+		return clamp(cur_state + 1, instance->lower, instance->upper);
+
+	if (!instance->initialized)
+		return THERMAL_NO_TARGET;
+
+	if (release) {
+		if (cur_state <= instance->lower)
+			return THERMAL_NO_TARGET;
+		return clamp(cur_state - 1, instance->lower, instance->upper);
+	}
+
+	return instance->target;
+}
+
+static void update_passive_instance(struct thermal_zone_device *tz,
+				    enum thermal_trip_type type, int value)
+{
+	if (type == THERMAL_TRIP_PASSIVE)
+		tz->passive += value;
+}
+
+static void predictive_trip_update(struct thermal_zone_device *tz, int trip)
+{
+	struct predictive_params *params = tz->governor_data;
+	struct thermal_instance *instance;
+	enum thermal_trip_type trip_type;
+	int trip_temp, hyst_temp, predicted;
+	bool early;
+
+	tz->ops->get_trip_temp(tz, trip, &trip_temp);
+	tz->ops->get_trip_type(tz, trip, &trip_type);
+
+	hyst_temp = trip_temp;
+	if (tz->ops->get_trip_hyst) {
+		tz->ops->get_trip_hyst(tz, trip, &hyst_temp);
+		hyst_temp = trip_temp - hyst_temp;
+	}
+
+	predicted = predictive_temp(tz);
+	early = predicted >= trip_temp;
+
+	dev_dbg(&tz->device,
+		"Trip%d[type=%d,temp=%d,hyst=%d]:predicted=%d,slope=%d\n",
+		trip, trip_type, trip_temp, hyst_temp, predicted,
+		params->slope);
+
+	/* Only the first trips can be notified, which is all there are */
+	if (trip < BITS_PER_LONG &&
+	    early != test_bit(trip, &params->predicted)) {
+		change_bit(trip, &params->predicted);
+		predictive_notify(tz, trip, early, predicted);
+	}
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		int old_target = instance->target;
+		bool throttle, release;
+
+		if (instance->trip != trip)
+			continue;
+
+		/* Keep the mitigation until below the hysteresis */
+		throttle = early || (tz->temperature >= hyst_temp &&
+				     old_target == instance->upper);
+		release = !throttle && tz->temperature < hyst_temp;
+		if (throttle)
+			trace_thermal_zone_trip(tz, trip, trip_type);
+
+		instance->target = get_target_state(instance, throttle,
+						    release);
+		dev_dbg(&instance->cdev->device, "old_target=%d, target=%d\n",
+			old_target, (int)instance->target);
+
+		if (instance->initialized && old_target == instance->target)
+			continue;
+
+		if (old_target == THERMAL_NO_TARGET &&
+		    instance->target != THERMAL_NO_TARGET)
+			update_passive_instance(tz, trip_type, 1);
+		else if (old_target != THERMAL_NO_TARGET &&
+			 instance->target == THERMAL_NO_TARGET)
+			update_passive_instance(tz, trip_type, -1);
+
+		instance->initialized = true;
+		mutex_lock(&instance->cdev->lock);
+		instance->cdev->updated = false; /* cdev needs update */
+		mutex_unlock(&instance->cdev->lock);
+	}
+}
+
+/**
+ * predictive_throttle - throttles devices associated with the given zone
+ * @tz: thermal_zone_device
+ * @trip: trip point index
+ *
+ * The zone's trips are handled in index order at each update, so a trip
+ * index not above the previous one starts a new update: that is where the
+ * slope gets updated. Critical trips never get here, any trip may be first.
+ */
+static int predictive_throttle(struct thermal_zone_device *tz, int trip)
+{
+	struct predictive_params *params = tz->governor_data;
+	struct thermal_instance *instance;
+
+	lockdep_assert_held(&tz->lock);
+
+	if (trip <= params->last_trip)
+		predictive_update_slope(tz);
+	params->last_trip = trip;
+
+	predictive_trip_update(tz, trip);
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node)
+		thermal_cdev_update(instance->cdev);
+
+	return 0;
+}
+
+static int predictive_bind(struct thermal_zone_device *tz)
+{
+	struct predictive_params *params;
+
+	params = kzalloc(sizeof(*params), GFP_KERNEL);
+	if (!params)
+		return -ENOMEM;
+
+	params->last_trip = INT_MAX;
+	tz->governor_data = params;
+
+	return 0;
+}
+
+static void predictive_unbind(struct thermal_zone_device *tz)
+{
+	kfree(tz->governor_data);
+	tz->governor_data = NULL;
+}
+
+static struct thermal_governor thermal_gov_predictive = {
+	.name		= "predictive",
+	.throttle	= predictive_throttle,
+	.bind_to_tz	= predictive_bind,
+	.unbind_from_tz	= predictive_unbind,
+};
+THERMAL_GOVERNOR_DECLARE(thermal_gov_predictive);
@@ -274,6 +274,7 @@ struct uart_amba_port {
 	unsigned int		fifosize;	/* vendor-specific */
 	unsigned int		fixed_baud;	/* vendor-set fixed baud rate */
 	char			type[12];
+	bool			low_latency;	/* FIFOs disabled */
 	bool			rs485_tx_started;
 	unsigned int		rs485_tx_drain_interval; /* usecs */
 #ifdef CONFIG_DMA_ENGINE
@@ -1480,7 +1481,7 @@ static void pl011_rs485_tx_start(struct uart_amba_port *uap)
 static bool pl011_tx_chars(struct uart_amba_port *uap, bool from_irq)
 {
 	struct circ_buf *xmit = &uap->port.state->xmit;
-	int count = uap->fifosize >> 1;
+	int count = uap->low_latency ? 1 : uap->fifosize >> 1;
 
 	if ((uap->port.rs485.flags & SER_RS485_ENABLED) &&
 	    !uap->rs485_tx_started)
@@ -2116,13 +2117,19 @@ pl011_set_termios(struct uart_port *port, struct ktermios *termios,
 		if (termios->c_cflag & CMSPAR)
 			lcr_h |= UART011_LCRH_SPS;
 	}
-	if (uap->fifosize > 1)
+	/*
+	 * Without the FIFOs every character raises its own interrupt, rather
+	 * than waiting for the RX trigger level or the receive timeout.
+	 */
+	if (uap->fifosize > 1 && !(port->flags & UPF_LOW_LATENCY))
 		lcr_h |= UART01x_LCRH_FEN;
 
 	bits = tty_get_frame_size(termios->c_cflag);
 
 	spin_lock_irqsave(&port->lock, flags);
 
+	uap->low_latency = !(lcr_h & UART01x_LCRH_FEN);
+
 	/*
 	 * Update the per-port timeout.
 	 */
@@ -2758,6 +2765,8 @@ static int pl011_setup_port(struct device *dev, struct uart_amba_port *uap,
 	uap->port.fifosize = uap->fifosize;
 	uap->port.has_sysrq = IS_ENABLED(CONFIG_SERIAL_AMBA_PL011_CONSOLE);
 	uap->port.flags = UPF_BOOT_AUTOCONF;
+	if (device_property_read_bool(dev, "low-latency"))
+		uap->port.flags |= UPF_LOW_LATENCY;
 	uap->port.line = index;
 
 	ret = pl011_get_rs485_mode(uap);
@@ -263,6 +263,8 @@ static int uart_port_startup(struct tty_struct *tty, struct uart_state *state,
 		free_page(page);
 	}
 
+	tty_port_set_low_latency(&state->port, uport->flags & UPF_LOW_LATENCY);
+
 	retval = uport->ops->startup(uport);
 	if (retval == 0) {
 		if (uart_console(uport) && uport->cons->cflag) {
@@ -980,7 +982,10 @@ static int uart_set_info(struct tty_struct *tty, struct tty_port *port,
 	if (uport->type == PORT_UNKNOWN)
 		goto exit;
 	if (tty_port_initialized(port)) {
-		if (((old_flags ^ uport->flags) & UPF_SPD_MASK) ||
+		tty_port_set_low_latency(port, uport->flags & UPF_LOW_LATENCY);
+		/* The driver may use its FIFO differently when low latency */
+		if (((old_flags ^ uport->flags) &
+		     (UPF_SPD_MASK | UPF_LOW_LATENCY)) ||
 		    old_custom_divisor != uport->custom_divisor) {
 			/*
 			 * If they're setting up a custom divisor or speed,
@@ -39,6 +39,16 @@
 
 #define TTY_BUFFER_PAGE	(((PAGE_SIZE - sizeof(struct tty_buffer)) / 2) & ~0xFF)
 
+/*
+ * Low latency ports don't wait for an unbound worker to get around to the
+ * flip buffer: their data goes to the ldisc from a high priority one.
+ */
+static struct workqueue_struct *tty_flip_wq(struct tty_port *port)
+{
+	return tty_port_low_latency(port) ? system_highpri_wq :
+					    system_unbound_wq;
+}
+
 /**
  * tty_buffer_lock_exclusive	-	gain exclusive access to buffer
  * @port: tty port owning the flip buffer
@@ -76,7 +86,7 @@ void tty_buffer_unlock_exclusive(struct tty_port *port)
 	atomic_dec(&buf->priority);
 	mutex_unlock(&buf->lock);
 	if (restart)
-		queue_work(system_unbound_wq, &buf->work);
+		queue_work(tty_flip_wq(port), &buf->work);
 }
 EXPORT_SYMBOL_GPL(tty_buffer_unlock_exclusive);
 
@@ -601,7 +611,7 @@ void tty_flip_buffer_push(struct tty_port *port)
 	struct tty_bufhead *buf = &port->buf;
 
 	tty_flip_buffer_commit(buf->tail);
-	queue_work(system_unbound_wq, &buf->work);
+	queue_work(tty_flip_wq(port), &buf->work);
 }
 EXPORT_SYMBOL(tty_flip_buffer_push);
 
@@ -631,7 +641,7 @@ int tty_insert_flip_string_and_push_buffer(struct tty_port *port,
 		tty_flip_buffer_commit(buf->tail);
 	spin_unlock_irqrestore(&port->lock, flags);
 
-	queue_work(system_unbound_wq, &buf->work);
+	queue_work(tty_flip_wq(port), &buf->work);
 
 	return size;
 }
@@ -684,7 +694,7 @@ void tty_buffer_set_lock_subclass(struct tty_port *port)
 
 bool tty_buffer_restart_work(struct tty_port *port)
 {
-	return queue_work(system_unbound_wq, &port->buf.work);
+	return queue_work(tty_flip_wq(port), &port->buf.work);
 }
 
 bool tty_buffer_cancel_work(struct tty_port *port)
@@ -234,6 +234,11 @@ enum dwc2_ep0_state {
  *                      specified.
  *                       0 - Address DMA
  *                       1 - Descriptor DMA in FS (default, if available)
+ * @host_iso_ioc_interval: In descriptor DMA mode, the minimum number of
+ *                      (micro)frames between two interrupts of a running
+ *                      isochronous endpoint. Completed URBs are then given
+ *                      back in batches, when the next one is due.
+ *                       0 - An interrupt for every URB (default)
  * @speed:              Specifies the maximum speed of operation in host and
  *                      device mode. The actual speed depends on the speed of
  *                      the attached device and the value of phy_type.
@@ -482,6 +487,7 @@ struct dwc2_core_params {
 	bool host_dma;
 	bool dma_desc_enable;
 	bool dma_desc_fs_enable;
+	u32 host_iso_ioc_interval;
 	bool host_support_fs_ls_low_power;
 	bool host_ls_low_power_phy_clk;
 	bool oc_disable;
@@ -13,6 +13,7 @@
 
 #include "core.h"
 #include "debug.h"
+#include "hcd.h"
 
 #if IS_ENABLED(CONFIG_USB_DWC2_PERIPHERAL) || \
 	IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
@@ -324,6 +325,39 @@ static inline void dwc2_hsotg_create_debug(struct dwc2_hsotg *hsotg) {}
 
 /* dwc2_hsotg_delete_debug is removed as cleanup in done in dwc2_debugfs_exit */
 
+#if IS_ENABLED(CONFIG_USB_DWC2_HOST) || \
+	IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
+
+/**
+ * periodic_schedule_show - show the periodic schedule of the host
+ * @seq: The seq_file to write data to.
+ * @v: Unused parameter.
+ *
+ * Show where each periodic transfer is placed in the high speed schedule
+ * and in the low/full speed schedule of its TT.
+ */
+static int periodic_schedule_show(struct seq_file *seq, void *v)
+{
+	struct dwc2_hsotg *hsotg = seq->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&hsotg->lock, flags);
+	dwc2_hcd_dump_periodic_schedule(hsotg, seq);
+	spin_unlock_irqrestore(&hsotg->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(periodic_schedule);
+
+static void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg)
+{
+	debugfs_create_file("periodic_schedule", 0444, hsotg->debug_root,
+			    hsotg, &periodic_schedule_fops);
+}
+#else
+static inline void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg) {}
+#endif
+
 #define dump_register(nm)	\
 {				\
 	.name	= #nm,		\
@@ -675,6 +709,7 @@ static int params_show(struct seq_file *seq, void *v)
 	print_param(seq, p, otg_caps.otg_rev);
 	print_param(seq, p, dma_desc_enable);
 	print_param(seq, p, dma_desc_fs_enable);
+	print_param(seq, p, host_iso_ioc_interval);
 	print_param(seq, p, speed);
 	print_param(seq, p, enable_dynamic_fifo);
 	print_param(seq, p, en_multiple_tx_fifo);
@@ -785,6 +820,9 @@ int dwc2_debugfs_init(struct dwc2_hsotg *hsotg)
 	/* Add gadget debugfs nodes */
 	dwc2_hsotg_create_debug(hsotg);
 
+	/* Add host debugfs nodes */
+	dwc2_hcd_create_debug(hsotg);
+
 	hsotg->regset = devm_kzalloc(hsotg->dev, sizeof(*hsotg->regset),
 								GFP_KERNEL);
 	if (!hsotg->regset) {
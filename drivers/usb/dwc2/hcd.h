@@ -278,6 +278,9 @@ struct dwc2_hs_transfer_time {
  *                           speed.  Note that this is in "schedule slice" which
  *                           is tightly packed.
  * @ntd:                Actual number of transfer descriptors in a list
+ * @iso_ioc_pending:    Number of active isochronous descriptors with IOC set
+ * @iso_since_ioc:      Number of isochronous descriptors activated since the
+ *                      last one with IOC set
  * @dw_align_buf:       Used instead of original buffer if its physical address
  *                      is not dword-aligned
  * @dw_align_buf_dma:   DMA address for dw_align_buf
@@ -330,6 +333,8 @@ struct dwc2_qh {
 	struct dwc2_hs_transfer_time hs_transfers[DWC2_HS_SCHEDULE_UFRAMES];
 	u32 ls_start_schedule_slice;
 	u16 ntd;
+	u16 iso_ioc_pending;
+	u16 iso_since_ioc;
 	u8 *dw_align_buf;
 	dma_addr_t dw_align_buf_dma;
 	struct list_head qtd_list;
@@ -539,6 +544,9 @@ struct dwc2_qh *dwc2_hcd_qh_create(struct dwc2_hsotg *hsotg,
 void dwc2_hcd_qh_free(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh);
 int dwc2_hcd_qh_add(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh);
 void dwc2_hcd_qh_unlink(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh);
+struct seq_file;
+void dwc2_hcd_dump_periodic_schedule(struct dwc2_hsotg *hsotg,
+				     struct seq_file *seq);
 void dwc2_hcd_qh_deactivate(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh,
 			    int sched_csplit);
 
@@ -290,6 +290,8 @@ static void dwc2_release_channel_ddma(struct dwc2_hsotg *hsotg,
 
 	qh->channel = NULL;
 	qh->ntd = 0;
+	qh->iso_ioc_pending = 0;
+	qh->iso_since_ioc = 0;
 
 	if (qh->desc_list)
 		memset(qh->desc_list, 0, sizeof(struct dwc2_dma_desc) *
@@ -508,6 +510,17 @@ static u16 dwc2_recalc_initial_desc_idx(struct dwc2_hsotg *hsotg,
 #define MAX_ISOC_XFER_SIZE_HS	3072
 #define DESCNUM_THRESHOLD	4
 
+static void dwc2_set_host_isoc_ioc(struct dwc2_qh *qh,
+				   struct dwc2_dma_desc *dma_desc)
+{
+	if (dma_desc->status & HOST_DMA_IOC)
+		return;
+
+	dma_desc->status |= HOST_DMA_IOC;
+	qh->iso_ioc_pending++;
+	qh->iso_since_ioc = 0;
+}
+
 static void dwc2_fill_host_isoc_dma_desc(struct dwc2_hsotg *hsotg,
 					 struct dwc2_qtd *qtd,
 					 struct dwc2_qh *qh, u32 max_xfer_size,
@@ -532,12 +545,21 @@ static void dwc2_fill_host_isoc_dma_desc(struct dwc2_hsotg *hsotg,
 	dma_desc->status |= HOST_DMA_A;
 
 	qh->ntd++;
+	qh->iso_since_ioc++;
 	qtd->isoc_frame_index_last++;
 
 #ifdef ISOC_URB_GIVEBACK_ASAP
-	/* Set IOC for each descriptor corresponding to last frame of URB */
-	if (qtd->isoc_frame_index_last == qtd->urb->packet_count)
-		dma_desc->status |= HOST_DMA_IOC;
+	/*
+	 * Set IOC for each descriptor corresponding to last frame of URB,
+	 * unless an earlier one is still to come and is less than
+	 * host_iso_ioc_interval (micro)frames away. The URBs in between are
+	 * given back with it.
+	 */
+	if (qtd->isoc_frame_index_last == qtd->urb->packet_count &&
+	    (!qh->iso_ioc_pending ||
+	     qh->iso_since_ioc * qh->host_interval >=
+	     hsotg->params.host_iso_ioc_interval))
+		dwc2_set_host_isoc_ioc(qh, dma_desc);
 #endif
 
 	dma_sync_single_for_device(hsotg->dev,
@@ -610,10 +632,15 @@ static void dwc2_init_isoc_dma_desc(struct dwc2_hsotg *hsotg,
 	qh->td_last = idx;
 
 #ifdef ISOC_URB_GIVEBACK_ASAP
-	/* Set IOC for last descriptor if descriptor list is full */
-	if (qh->ntd == ntd_max) {
+	/*
+	 * Set IOC for last descriptor if descriptor list is full, or if the
+	 * descriptors still active were left without one: their URBs were
+	 * waiting for an IOC that has completed since. This runs again after
+	 * each completion, so they are never left without a giveback.
+	 */
+	if (qh->ntd == ntd_max || (qh->ntd && !qh->iso_ioc_pending)) {
 		idx = dwc2_desclist_idx_dec(qh->td_last, inc, qh->dev_speed);
-		qh->desc_list[idx].status |= HOST_DMA_IOC;
+		dwc2_set_host_isoc_ioc(qh, &qh->desc_list[idx]);
 		dma_sync_single_for_device(hsotg->dev,
 					   qh->desc_list_dma + (idx *
 					   sizeof(struct dwc2_dma_desc)),
@@ -879,7 +906,8 @@ static int dwc2_cmpl_host_isoc_dma_desc(struct dwc2_hsotg *hsotg,
 
 	dma_desc = &qh->desc_list[idx];
 
-	frame_desc = &qtd->urb->iso_descs[qtd->isoc_frame_index_last];
+	/* isoc_frame_index_last is already past it, maybe past the URB */
+	frame_desc = &qtd->urb->iso_descs[qtd->isoc_frame_index];
 	dma_desc->buf = (u32)(qtd->urb->dma + frame_desc->offset);
 	if (chan->ep_is_in)
 		remain = (dma_desc->status & HOST_DMA_ISOC_NBYTES_MASK) >>
@@ -922,8 +950,11 @@ static int dwc2_cmpl_host_isoc_dma_desc(struct dwc2_hsotg *hsotg,
 	qh->ntd--;
 
 	/* Stop if IOC requested descriptor reached */
-	if (dma_desc->status & HOST_DMA_IOC)
+	if (dma_desc->status & HOST_DMA_IOC) {
+		if (qh->iso_ioc_pending)
+			qh->iso_ioc_pending--;
 		rc = DWC2_CMPL_STOP;
+	}
 
 	return rc;
 }
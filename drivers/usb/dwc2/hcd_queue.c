@@ -16,7 +16,9 @@
 #include <linux/interrupt.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/usb.h>
 
 #include <linux/usb/hcd.h>
@@ -358,7 +360,7 @@ static unsigned long *dwc2_get_ls_map(struct dwc2_hsotg *hsotg,
 	return map;
 }
 
-#ifdef DWC2_PRINT_SCHEDULE
+#if defined(DWC2_PRINT_SCHEDULE) || IS_ENABLED(CONFIG_DEBUG_FS)
 /*
  * cat_printf() - A printf() + strcat() helper
  *
@@ -457,7 +459,9 @@ static void pmap_print(unsigned long *map, int bits_per_period,
 			print_fn(tmp, print_data);
 	}
 }
+#endif
 
+#ifdef DWC2_PRINT_SCHEDULE
 struct dwc2_qh_print_data {
 	struct dwc2_hsotg *hsotg;
 	struct dwc2_qh *qh;
@@ -536,6 +540,119 @@ static inline void dwc2_qh_schedule_print(struct dwc2_hsotg *hsotg,
 					  struct dwc2_qh *qh) {};
 #endif
 
+#if IS_ENABLED(CONFIG_DEBUG_FS)
+static void dwc2_seq_print(const char *str, void *data)
+{
+	struct seq_file *seq = data;
+
+	seq_printf(seq, "  %s\n", str);
+}
+
+static void dwc2_qh_dump_schedule(struct dwc2_qh *qh, const char *state,
+				  struct seq_file *seq)
+{
+	struct dwc2_qtd *qtd;
+	int i;
+
+	qtd = list_first_entry_or_null(&qh->qtd_list, struct dwc2_qtd,
+				       qtd_list_entry);
+	if (qtd && qtd->urb)
+		seq_printf(seq, "dev %d ep %d",
+			   dwc2_hcd_get_dev_addr(&qtd->urb->pipe_info),
+			   dwc2_hcd_get_ep_num(&qtd->urb->pipe_info));
+	else
+		seq_puts(seq, "dev ? ep ?");
+
+	seq_printf(seq, "%s %s %s%s: interval %d, %d us\n",
+		   qh->ep_is_in ? "in" : "out",
+		   qh->ep_type == USB_ENDPOINT_XFER_ISOC ? "isoc" : "intr",
+		   state, qh->do_split ? " split" : "",
+		   qh->host_interval, qh->host_us);
+
+	if (qh->schedule_low_speed)
+		seq_printf(seq, "  LS/FS: %d us @ slice %u\n",
+			   qh->device_us, qh->ls_start_schedule_slice);
+
+	for (i = 0; i < qh->num_hs_transfers; i++) {
+		struct dwc2_hs_transfer_time *trans_time = qh->hs_transfers + i;
+
+		seq_printf(seq, "  HS #%d: %d us @ uFrame %d + %d us\n", i,
+			   trans_time->duration_us,
+			   trans_time->start_schedule_us /
+			   DWC2_HS_PERIODIC_US_PER_UFRAME,
+			   trans_time->start_schedule_us %
+			   DWC2_HS_PERIODIC_US_PER_UFRAME);
+	}
+}
+
+/**
+ * dwc2_hcd_dump_periodic_schedule() - Show the periodic schedule
+ *
+ * @hsotg: The HCD state structure for the DWC OTG controller.
+ * @seq:   Where to show it.
+ *
+ * Lists the high speed map, then each periodic QH with its placement and,
+ * the first time it's seen, the low speed map of its TT.  Only the QHs on
+ * the periodic schedule are listed: the ones waiting for their reservation
+ * to be released still hold time in the maps.
+ *
+ * Must be called with the hsotg lock held.
+ */
+void dwc2_hcd_dump_periodic_schedule(struct dwc2_hsotg *hsotg,
+				     struct seq_file *seq)
+{
+	struct {
+		struct list_head *list;
+		const char *name;
+	} lists[] = {
+		{ &hsotg->periodic_sched_inactive, "inactive" },
+		{ &hsotg->periodic_sched_ready, "ready" },
+		{ &hsotg->periodic_sched_assigned, "assigned" },
+		{ &hsotg->periodic_sched_queued, "queued" },
+	};
+	unsigned long *ls_maps[16];
+	int n_ls_maps = 0;
+	struct dwc2_qh *qh;
+	int i, j;
+
+	seq_printf(seq, "periodic_usecs: %d\n", hsotg->periodic_usecs);
+	if (!hsotg->params.uframe_sched)
+		return;
+
+	seq_puts(seq, "High speed map:\n");
+	pmap_print(hsotg->hs_periodic_bitmap, DWC2_HS_PERIODIC_US_PER_UFRAME,
+		   DWC2_HS_SCHEDULE_UFRAMES, "uFrame", "us", dwc2_seq_print,
+		   seq);
+
+	for (i = 0; i < ARRAY_SIZE(lists); i++) {
+		list_for_each_entry(qh, lists[i].list, qh_list_entry) {
+			unsigned long *map;
+
+			dwc2_qh_dump_schedule(qh, lists[i].name, seq);
+
+			if (!qh->schedule_low_speed || !qh->dwc_tt)
+				continue;
+
+			map = dwc2_get_ls_map(hsotg, qh);
+			for (j = 0; j < n_ls_maps; j++) {
+				if (ls_maps[j] == map)
+					break;
+			}
+			if (j < n_ls_maps)
+				continue;
+			if (n_ls_maps < ARRAY_SIZE(ls_maps))
+				ls_maps[n_ls_maps++] = map;
+
+			seq_printf(seq, "  Low/full speed map of its TT%s:\n",
+				   qh->dwc_tt->usb_tt->multi ? " port" : "");
+			pmap_print(map, DWC2_LS_PERIODIC_SLICES_PER_FRAME,
+				   DWC2_LS_SCHEDULE_FRAMES, "Frame ", "slices",
+				   dwc2_seq_print, seq);
+		}
+	}
+}
+#endif
+
 /**
  * dwc2_ls_pmap_schedule() - Schedule a low speed QH
  *
@@ -1157,6 +1274,147 @@ static void dwc2_pick_first_frame(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh)
 		      qh, frame_number, qh->next_active_frame);
 }
 
+/*
+ * Where a QH was placed in the periodic schedule, to put it back if
+ * dwc2_uframe_repack() fails.
+ */
+struct dwc2_qh_placement {
+	struct dwc2_qh *qh;
+	u32 ls_start_schedule_slice;
+	s16 num_hs_transfers;
+	struct dwc2_hs_transfer_time hs_transfers[DWC2_HS_SCHEDULE_UFRAMES];
+};
+
+/*
+ * Interrupt QHs that wait for their next (micro)frame, and aren't between
+ * the start and complete splits of a transfer, can start again anywhere.
+ */
+static bool dwc2_qh_can_move(struct dwc2_qh *qh)
+{
+	return qh->ep_type == USB_ENDPOINT_XFER_INT && !qh->channel &&
+	       qh->next_active_frame == qh->start_active_frame;
+}
+
+/* The shortest interval first, then the longest transfer */
+static int dwc2_qh_placement_cmp(const void *a, const void *b)
+{
+	const struct dwc2_qh *qh_a = ((const struct dwc2_qh_placement *)a)->qh;
+	const struct dwc2_qh *qh_b = ((const struct dwc2_qh_placement *)b)->qh;
+
+	if (qh_a->host_interval != qh_b->host_interval)
+		return qh_a->host_interval - qh_b->host_interval;
+
+	return qh_b->host_us - qh_a->host_us;
+}
+
+static void dwc2_uframe_restore(struct dwc2_hsotg *hsotg,
+				struct dwc2_qh_placement *placement)
+{
+	struct dwc2_qh *qh = placement->qh;
+	int i;
+
+	qh->ls_start_schedule_slice = placement->ls_start_schedule_slice;
+	qh->num_hs_transfers = placement->num_hs_transfers;
+	memcpy(qh->hs_transfers, placement->hs_transfers,
+	       sizeof(qh->hs_transfers));
+
+	/* That time is free again, so we'll land exactly where we were */
+	if (qh->schedule_low_speed)
+		WARN_ON(dwc2_ls_pmap_schedule(hsotg, qh,
+					      qh->ls_start_schedule_slice) ||
+			qh->ls_start_schedule_slice !=
+			placement->ls_start_schedule_slice);
+
+	for (i = 0; i < qh->num_hs_transfers; i++)
+		WARN_ON(dwc2_hs_pmap_schedule(hsotg, qh, true, i) ||
+			qh->hs_transfers[i].start_schedule_us !=
+			placement->hs_transfers[i].start_schedule_us);
+}
+
+/**
+ * dwc2_uframe_repack() - Schedule a QH by moving the others out of its way
+ *
+ * dwc2_uframe_schedule() places each QH at the first time that fits, so
+ * the schedule can get too fragmented for a QH that would fit in the
+ * total time left.  This takes the interrupt QHs that can be moved off the
+ * schedule and places them again together with the new one, the most
+ * constrained first.  If that doesn't fit either, they go back where they
+ * were.
+ *
+ * @hsotg: The HCD state structure for the DWC OTG controller.
+ * @qh:    QH that dwc2_uframe_schedule() couldn't fit.
+ *
+ * Returns: 0 for success or an error code.
+ */
+static int dwc2_uframe_repack(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh)
+{
+	struct dwc2_qh_placement *placements;
+	struct dwc2_qh *qh_moved;
+	int n = 0, placed, i;
+	int ret = -ENOSPC;
+
+	list_for_each_entry(qh_moved, &hsotg->periodic_sched_inactive,
+			    qh_list_entry) {
+		if (dwc2_qh_can_move(qh_moved))
+			n++;
+	}
+	if (!n)
+		return ret;
+
+	placements = kcalloc(n + 1, sizeof(*placements), GFP_ATOMIC);
+	if (!placements)
+		return -ENOMEM;
+
+	n = 0;
+	list_for_each_entry(qh_moved, &hsotg->periodic_sched_inactive,
+			    qh_list_entry) {
+		struct dwc2_qh_placement *placement;
+
+		if (!dwc2_qh_can_move(qh_moved))
+			continue;
+
+		placement = &placements[n++];
+		placement->qh = qh_moved;
+		placement->ls_start_schedule_slice =
+			qh_moved->ls_start_schedule_slice;
+		placement->num_hs_transfers = qh_moved->num_hs_transfers;
+		memcpy(placement->hs_transfers, qh_moved->hs_transfers,
+		       sizeof(placement->hs_transfers));
+		dwc2_uframe_unschedule(hsotg, qh_moved);
+	}
+	placements[n].qh = qh;
+
+	sort(placements, n + 1, sizeof(*placements), dwc2_qh_placement_cmp,
+	     NULL);
+
+	for (placed = 0; placed <= n; placed++) {
+		if (dwc2_uframe_schedule(hsotg, placements[placed].qh))
+			break;
+	}
+
+	if (placed > n) {
+		for (i = 0; i <= n; i++) {
+			if (placements[i].qh != qh)
+				dwc2_pick_first_frame(hsotg, placements[i].qh);
+		}
+		dwc2_sch_dbg(hsotg, "QH=%p Scheduled by moving %d QHs\n",
+			     qh, n);
+		ret = 0;
+		goto out;
+	}
+
+	for (i = 0; i < placed; i++)
+		dwc2_uframe_unschedule(hsotg, placements[i].qh);
+	for (i = 0; i <= n; i++) {
+		if (placements[i].qh != qh)
+			dwc2_uframe_restore(hsotg, &placements[i]);
+	}
+
+out:
+	kfree(placements);
+	return ret;
+}
+
 /**
  * dwc2_do_reserve() - Make a periodic reservation
  *
@@ -1174,6 +1432,8 @@ static int dwc2_do_reserve(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh)
 
 	if (hsotg->params.uframe_sched) {
 		status = dwc2_uframe_schedule(hsotg, qh);
+		if (status == -ENOSPC)
+			status = dwc2_uframe_repack(hsotg, qh);
 	} else {
 		status = dwc2_periodic_channel_available(hsotg);
 		if (status) {
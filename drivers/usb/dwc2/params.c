@@ -442,6 +442,7 @@ static void dwc2_set_default_params(struct dwc2_hsotg *hsotg)
 		p->host_dma = dma_capable;
 		p->dma_desc_enable = false;
 		p->dma_desc_fs_enable = false;
+		p->host_iso_ioc_interval = 0;
 		p->host_support_fs_ls_low_power = false;
 		p->host_ls_low_power_phy_clk = false;
 		p->host_channels = hw->host_channels;
@@ -504,6 +505,11 @@ static void dwc2_get_device_properties(struct dwc2_hsotg *hsotg)
 		of_usb_update_otg_caps(hsotg->dev->of_node, &p->otg_caps);
 	}
 
+	if ((hsotg->dr_mode == USB_DR_MODE_HOST) ||
+	    (hsotg->dr_mode == USB_DR_MODE_OTG))
+		device_property_read_u32(hsotg->dev, "host-iso-ioc-interval",
+					 &p->host_iso_ioc_interval);
+
 	if (of_find_property(hsotg->dev->of_node, "disable-over-current", NULL))
 		p->oc_disable = true;
 }
@@ -736,6 +742,8 @@ static void dwc2_check_params(struct dwc2_hsotg *hsotg)
 		CHECK_BOOL(host_dma, dma_capable);
 		CHECK_BOOL(dma_desc_enable, p->host_dma);
 		CHECK_BOOL(dma_desc_fs_enable, p->dma_desc_enable);
+		CHECK_RANGE(host_iso_ioc_interval,
+			    0, MAX_DMA_DESC_NUM_HS_ISOC / 2, 0);
 		CHECK_BOOL(host_ls_low_power_phy_clk,
 			   p->phy_type == DWC2_PHY_TYPE_PARAM_FS);
 		CHECK_RANGE(host_channels,
@@ -38,6 +38,11 @@ static unsigned long long quirks;
 module_param(quirks, ullong, S_IRUGO);
 MODULE_PARM_DESC(quirks, "Bit flags for quirks to be enabled as default");
 
+static unsigned int low_latency_imod;
+module_param(low_latency_imod, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(low_latency_imod,
+		 "Interrupt moderation (ns) while audio endpoints are enabled");
+
 static bool td_on_ring(struct xhci_td *td, struct xhci_ring *ring)
 {
 	struct xhci_segment *seg = ring->first_seg;
@@ -615,6 +620,44 @@ static int xhci_init(struct usb_hcd *hcd)
 /*-------------------------------------------------------------------------*/
 
 
+/*
+ * There is a single interrupter, so use the short moderation interval as
+ * long as any low latency endpoint is enabled, the default one otherwise.
+ * Called with the xhci lock held, and after the controller was reset.
+ */
+static void xhci_update_imod(struct xhci_hcd *xhci)
+{
+	u32 imod = xhci->imod_interval;
+	struct xhci_virt_device *vdev;
+	int i, j;
+	u32 temp;
+
+	if (xhci->xhc_state & XHCI_STATE_DYING)
+		return;
+
+	for (i = 1; i < MAX_HC_SLOTS; i++) {
+		vdev = xhci->devs[i];
+		if (!vdev)
+			continue;
+
+		for (j = 1; j < 31; j++) {
+			if (vdev->eps[j].ring && vdev->eps[j].low_latency) {
+				imod = min(imod, low_latency_imod);
+				goto out;
+			}
+		}
+	}
+out:
+	temp = readl(&xhci->ir_set->irq_control);
+	if ((temp & ER_IRQ_INTERVAL_MASK) == imod / 250)
+		return;
+
+	xhci_dbg(xhci, "Interrupt moderation set to %u ns\n", imod);
+	temp &= ~ER_IRQ_INTERVAL_MASK;
+	temp |= (imod / 250) & ER_IRQ_INTERVAL_MASK;
+	writel(temp, &xhci->ir_set->irq_control);
+}
+
 static int xhci_run_finished(struct xhci_hcd *xhci)
 {
 	unsigned long	flags;
@@ -665,7 +708,7 @@ static int xhci_run_finished(struct xhci_hcd *xhci)
  */
 int xhci_run(struct usb_hcd *hcd)
 {
-	u32 temp;
+	unsigned long flags;
 	u64 temp_64;
 	int ret;
 	struct xhci_hcd *xhci = hcd_to_xhci(hcd);
@@ -691,10 +734,9 @@ int xhci_run(struct usb_hcd *hcd)
 
 	xhci_dbg_trace(xhci, trace_xhci_dbg_init,
 			"// Set the interrupt modulation register");
-	temp = readl(&xhci->ir_set->irq_control);
-	temp &= ~ER_IRQ_INTERVAL_MASK;
-	temp |= (xhci->imod_interval / 250) & ER_IRQ_INTERVAL_MASK;
-	writel(temp, &xhci->ir_set->irq_control);
+	spin_lock_irqsave(&xhci->lock, flags);
+	xhci_update_imod(xhci);
+	spin_unlock_irqrestore(&xhci->lock, flags);
 
 	if (xhci->quirks & XHCI_NEC_HOST) {
 		struct xhci_command *command;
@@ -2094,6 +2136,41 @@ int xhci_drop_endpoint(struct usb_hcd *hcd, struct usb_device *udev,
 }
 EXPORT_SYMBOL_GPL(xhci_drop_endpoint);
 
+/*
+ * Isochronous endpoints, and the MIDI or other endpoints of audio class
+ * interfaces, can't wait for the interrupt moderation interval: an audio
+ * period may be as short as it is.
+ */
+static bool xhci_ep_is_low_latency(struct usb_device *udev,
+				   struct usb_host_endpoint *ep)
+{
+	struct usb_interface_cache *intfc;
+	struct usb_host_interface *alt;
+	struct usb_host_config *config;
+	int c, i, a;
+
+	if (usb_endpoint_xfer_isoc(&ep->desc))
+		return true;
+	if (!udev->config)
+		return false;
+
+	for (c = 0; c < udev->descriptor.bNumConfigurations; c++) {
+		config = &udev->config[c];
+		for (i = 0; i < config->desc.bNumInterfaces; i++) {
+			intfc = config->intf_cache[i];
+			for (a = 0; intfc && a < intfc->num_altsetting; a++) {
+				alt = &intfc->altsetting[a];
+				if (ep >= alt->endpoint &&
+				    ep < alt->endpoint + alt->desc.bNumEndpoints)
+					return alt->desc.bInterfaceClass ==
+						USB_CLASS_AUDIO;
+			}
+		}
+	}
+
+	return false;
+}
+
 /* Add an endpoint to a new possible bandwidth configuration for this device.
  * Only one call to this function is allowed per endpoint before
  * check_bandwidth() or reset_bandwidth() must be called.
@@ -2195,6 +2272,8 @@ int xhci_add_endpoint(struct usb_hcd *hcd, struct usb_device *udev,
 
 	/* Store the usb_device pointer for later use */
 	ep->hcpriv = udev;
+	virt_dev->eps[ep_index].new_low_latency =
+		xhci_ep_is_low_latency(udev, ep);
 
 	ep_ctx = xhci_get_ep_ctx(xhci, virt_dev->in_ctx, ep_index);
 	trace_xhci_add_endpoint(ep_ctx);
@@ -3152,6 +3231,7 @@ int xhci_check_bandwidth(struct usb_hcd *hcd, struct usb_device *udev)
 	struct xhci_input_control_ctx *ctrl_ctx;
 	struct xhci_slot_ctx *slot_ctx;
 	struct xhci_command *command;
+	unsigned long flags;
 
 	ret = xhci_check_args(hcd, udev, NULL, 0, true, __func__);
 	if (ret <= 0)
@@ -3232,8 +3312,13 @@ int xhci_check_bandwidth(struct usb_hcd *hcd, struct usb_device *udev)
 		xhci_check_bw_drop_ep_streams(xhci, virt_dev, i);
 		virt_dev->eps[i].ring = virt_dev->eps[i].new_ring;
 		virt_dev->eps[i].new_ring = NULL;
+		virt_dev->eps[i].low_latency = virt_dev->eps[i].new_low_latency;
 		xhci_debugfs_create_endpoint(xhci, virt_dev, i);
 	}
+
+	spin_lock_irqsave(&xhci->lock, flags);
+	xhci_update_imod(xhci);
+	spin_unlock_irqrestore(&xhci->lock, flags);
 command_cleanup:
 	kfree(command->completion);
 	kfree(command);
@@ -4111,6 +4196,7 @@ static void xhci_free_dev(struct usb_hcd *hcd, struct usb_device *udev)
 
 	spin_lock_irqsave(&xhci->lock, flags);
 	xhci_free_virt_device(xhci, udev->slot_id);
+	xhci_update_imod(xhci);
 	spin_unlock_irqrestore(&xhci->lock, flags);
 
 }
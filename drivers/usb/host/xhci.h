@@ -971,6 +971,9 @@ struct xhci_virt_ep {
 	int			next_frame_id;
 	/* Use new Isoch TRB layout needed for extended TBC support */
 	bool			use_extended_tbc;
+	/* Audio endpoint, wants its completions without moderation */
+	bool			low_latency;
+	bool			new_low_latency;
 };
 
 enum xhci_overhead_type {
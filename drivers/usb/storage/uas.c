@@ -9,6 +9,8 @@
  */
 
 #include <linux/blkdev.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/module.h>
@@ -31,6 +33,16 @@
 
 #define MAX_CMNDS 256
 
+/* Protected by uas_dev_info.lock */
+struct uas_stats {
+	u64 cmnds[2];		/* reads, writes */
+	u64 bytes[2];
+	u64 latency_ns[2];	/* total, queue to completion */
+	u64 max_latency_ns[2];
+	unsigned int inflight;
+	unsigned int max_inflight;
+};
+
 struct uas_dev_info {
 	struct usb_interface *intf;
 	struct usb_device *udev;
@@ -46,6 +58,7 @@ struct uas_dev_info {
 	spinlock_t lock;
 	struct work_struct work;
 	struct work_struct scan_work;      /* for async scanning */
+	struct uas_stats stats;
 };
 
 enum {
@@ -70,6 +83,7 @@ struct uas_cmd_info {
 	struct urb *cmd_urb;
 	struct urb *data_in_urb;
 	struct urb *data_out_urb;
+	ktime_t start;
 };
 
 /* I hate forward declarations, but I actually have a loop */
@@ -241,6 +255,35 @@ static void uas_free_unsubmitted_urbs(struct scsi_cmnd *cmnd)
 		usb_free_urb(cmdinfo->data_out_urb);
 }
 
+static void uas_account_cmnd(struct uas_dev_info *devinfo,
+			     struct scsi_cmnd *cmnd)
+{
+	struct uas_cmd_info *cmdinfo = scsi_cmd_priv(cmnd);
+	struct uas_stats *stats = &devinfo->stats;
+	u64 latency;
+	int dir;
+
+	stats->inflight--;
+
+	switch (cmnd->sc_data_direction) {
+	case DMA_FROM_DEVICE:
+		dir = READ;
+		break;
+	case DMA_TO_DEVICE:
+		dir = WRITE;
+		break;
+	default:
+		return;
+	}
+
+	latency = ktime_to_ns(ktime_sub(ktime_get(), cmdinfo->start));
+	stats->cmnds[dir]++;
+	stats->bytes[dir] += scsi_bufflen(cmnd) - scsi_get_resid(cmnd);
+	stats->latency_ns[dir] += latency;
+	if (latency > stats->max_latency_ns[dir])
+		stats->max_latency_ns[dir] = latency;
+}
+
 static int uas_try_complete(struct scsi_cmnd *cmnd, const char *caller)
 {
 	struct uas_cmd_info *cmdinfo = scsi_cmd_priv(cmnd);
@@ -253,6 +296,7 @@ static int uas_try_complete(struct scsi_cmnd *cmnd, const char *caller)
 			      COMMAND_ABORTED))
 		return -EBUSY;
 	devinfo->cmnd[cmdinfo->uas_tag - 1] = NULL;
+	uas_account_cmnd(devinfo, cmnd);
 	uas_free_unsubmitted_urbs(cmnd);
 	scsi_done(cmnd);
 	return 0;
@@ -671,6 +715,7 @@ static int uas_queuecommand_lck(struct scsi_cmnd *cmnd)
 	}
 
 	memset(cmdinfo, 0, sizeof(*cmdinfo));
+	cmdinfo->start = ktime_get();
 	cmdinfo->uas_tag = idx + 1; /* uas-tag == usb-stream-id, so 1 based */
 	cmdinfo->state = SUBMIT_STATUS_URB | ALLOC_CMD_URB | SUBMIT_CMD_URB;
 
@@ -712,6 +757,8 @@ static int uas_queuecommand_lck(struct scsi_cmnd *cmnd)
 	}
 
 	devinfo->cmnd[idx] = cmnd;
+	if (++devinfo->stats.inflight > devinfo->stats.max_inflight)
+		devinfo->stats.max_inflight = devinfo->stats.inflight;
 zombie:
 	spin_unlock_irqrestore(&devinfo->lock, flags);
 	return 0;
@@ -741,6 +788,7 @@ static int uas_eh_abort_handler(struct scsi_cmnd *cmnd)
 
 	/* Drop all refs to this cmnd, kill data urbs to break their ref */
 	devinfo->cmnd[cmdinfo->uas_tag - 1] = NULL;
+	devinfo->stats.inflight--;
 	if (cmdinfo->state & DATA_IN_URB_INFLIGHT)
 		data_in_urb = usb_get_urb(cmdinfo->data_in_urb);
 	if (cmdinfo->state & DATA_OUT_URB_INFLIGHT)
@@ -835,6 +883,18 @@ static int uas_slave_alloc(struct scsi_device *sdev)
 		blk_queue_max_hw_sectors(sdev->request_queue, 64);
 	else if (devinfo->flags & US_FL_MAX_SECTORS_240)
 		blk_queue_max_hw_sectors(sdev->request_queue, 240);
+	else if (devinfo->udev->speed >= USB_SPEED_SUPER)
+		/*
+		 * Same as usb-storage: large sequential reads, e.g. streaming
+		 * audio samples, need fewer round trips with 1M transfers.
+		 */
+		blk_queue_max_hw_sectors(sdev->request_queue, 2048);
+
+	/* Stay within what the DMA API can map in one go, e.g. swiotlb */
+	blk_queue_max_hw_sectors(sdev->request_queue,
+		min_t(size_t, queue_max_hw_sectors(sdev->request_queue),
+		      dma_max_mapping_size(devinfo->udev->bus->sysdev) >>
+		      SECTOR_SHIFT));
 
 	return 0;
 }
@@ -894,6 +954,99 @@ static int uas_slave_configure(struct scsi_device *sdev)
 	return 0;
 }
 
+static ssize_t max_sectors_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+
+	return sysfs_emit(buf, "%u\n",
+			  queue_max_hw_sectors(sdev->request_queue));
+}
+
+static ssize_t max_sectors_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+	struct uas_dev_info *devinfo = sdev->hostdata;
+	unsigned short ms;
+
+	if (kstrtou16(buf, 0, &ms) || !ms)
+		return -EINVAL;
+
+	/* The same DMA mapping limit as uas_slave_alloc() applies */
+	blk_queue_max_hw_sectors(sdev->request_queue,
+		min_t(size_t, ms,
+		      dma_max_mapping_size(devinfo->udev->bus->sysdev) >>
+		      SECTOR_SHIFT));
+	return count;
+}
+static DEVICE_ATTR_RW(max_sectors);
+
+/*
+ * The counters are shared by all LUNs of the device. Any write clears
+ * them, except for the commands currently in flight.
+ */
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+	struct uas_dev_info *devinfo = sdev->hostdata;
+	struct uas_stats stats;
+	unsigned long flags;
+	u64 avg[2];
+	int dir;
+
+	spin_lock_irqsave(&devinfo->lock, flags);
+	stats = devinfo->stats;
+	spin_unlock_irqrestore(&devinfo->lock, flags);
+
+	for (dir = READ; dir <= WRITE; dir++) {
+		avg[dir] = 0;
+		if (stats.cmnds[dir])
+			avg[dir] = div64_u64(stats.latency_ns[dir],
+					     stats.cmnds[dir]);
+	}
+
+	return sysfs_emit(buf,
+			  "read: %llu cmds %llu bytes %llu avg_us %llu max_us\n"
+			  "write: %llu cmds %llu bytes %llu avg_us %llu max_us\n"
+			  "inflight: %u max %u\n",
+			  stats.cmnds[READ], stats.bytes[READ],
+			  div_u64(avg[READ], NSEC_PER_USEC),
+			  div_u64(stats.max_latency_ns[READ], NSEC_PER_USEC),
+			  stats.cmnds[WRITE], stats.bytes[WRITE],
+			  div_u64(avg[WRITE], NSEC_PER_USEC),
+			  div_u64(stats.max_latency_ns[WRITE], NSEC_PER_USEC),
+			  stats.inflight, stats.max_inflight);
+}
+
+static ssize_t stats_store(struct device *dev, struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+	struct uas_dev_info *devinfo = sdev->hostdata;
+	unsigned long flags;
+	unsigned int inflight;
+
+	spin_lock_irqsave(&devinfo->lock, flags);
+	inflight = devinfo->stats.inflight;
+	memset(&devinfo->stats, 0, sizeof(devinfo->stats));
+	devinfo->stats.inflight = inflight;
+	devinfo->stats.max_inflight = inflight;
+	spin_unlock_irqrestore(&devinfo->lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(stats);
+
+static struct attribute *uas_sdev_attrs[] = {
+	&dev_attr_max_sectors.attr,
+	&dev_attr_stats.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(uas_sdev);
+
 static struct scsi_host_template uas_host_template = {
 	.module = THIS_MODULE,
 	.name = "uas",
@@ -907,6 +1060,7 @@ static struct scsi_host_template uas_host_template = {
 	.skip_settle_delay = 1,
 	.dma_boundary = PAGE_SIZE - 1,
 	.cmd_size = sizeof(struct uas_cmd_info),
+	.sdev_groups = uas_sdev_groups,
 };
 
 #define UNUSUAL_DEV(id_vendor, id_product, bcdDeviceMin, bcdDeviceMax, \
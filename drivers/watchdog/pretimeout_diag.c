@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Watchdog pretimeout governor capturing stall diagnostics
+ *
+ * A watchdog that is not fed is most often starved by a real-time task
+ * or an interrupt storm. Before the system goes down, log the stacks of
+ * the highest priority runnable RT tasks, the interrupt counts and the
+ * backtrace of every CPU, then panic so that the log ends up in pstore
+ * and the machine reboots even if the hardware reset never comes.
+ */
+
+#include <linux/interrupt.h>
+#include <linux/irqdesc.h>
+#include <linux/irqnr.h>
+#include <linux/kernel.h>
+#include <linux/kernel_stat.h>
+#include <linux/nmi.h>
+#include <linux/printk.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/debug.h>
+#include <linux/sched/rt.h>
+#include <linux/sched/signal.h>
+#include <linux/watchdog.h>
+
+#include "watchdog_pretimeout.h"
+
+#define PRETIMEOUT_DIAG_RT_TASKS	8
+
+static void pretimeout_diag_rt_tasks(void)
+{
+	struct task_struct *top[PRETIMEOUT_DIAG_RT_TASKS];
+	struct task_struct *g, *p;
+	int n = 0, i;
+
+	rcu_read_lock();
+
+	/* keep the runnable RT tasks with the highest priority, best first */
+	for_each_process_thread(g, p) {
+		if (!rt_task(p) || !task_is_running(p))
+			continue;
+
+		if (n == ARRAY_SIZE(top)) {
+			if (p->prio >= top[n - 1]->prio)
+				continue;
+			n--;
+		}
+
+		for (i = n++; i > 0 && top[i - 1]->prio > p->prio; i--)
+			top[i] = top[i - 1];
+		top[i] = p;
+	}
+
+	pr_emerg("%d runnable RT task(s) at highest priority:\n", n);
+	for (i = 0; i < n; i++)
+		sched_show_task(top[i]);
+
+	rcu_read_unlock();
+}
+
+static void pretimeout_diag_irqs(void)
+{
+	struct irq_desc *desc;
+	unsigned int count;
+	int irq;
+
+	pr_emerg("interrupt counts:\n");
+	for_each_irq_desc(irq, desc) {
+		struct irqaction *action = READ_ONCE(desc->action);
+
+		if (!action)
+			continue;
+
+		count = kstat_irqs_usr(irq);
+		if (count)
+			pr_emerg("%5d: %10u %s\n", irq, count, action->name);
+	}
+}
+
+/**
+ * pretimeout_diag - Log stall diagnostics and panic on pretimeout event
+ * @wdd - watchdog_device
+ *
+ * Watchdog has not been fed till pretimeout event, record what is
+ * hogging the CPUs before the watchdog resets the system.
+ */
+static void pretimeout_diag(struct watchdog_device *wdd)
+{
+	pr_emerg("watchdog%d: pretimeout event, capturing stall diagnostics\n",
+		 wdd->id);
+
+	pretimeout_diag_rt_tasks();
+	pretimeout_diag_irqs();
+	trigger_all_cpu_backtrace();
+
+	panic("watchdog pretimeout event\n");
+}
+
+static struct watchdog_governor watchdog_gov_diag = {
+	.name		= "diag",
+	.pretimeout	= pretimeout_diag,
+};
+
+static int __init watchdog_gov_diag_register(void)
+{
+	return watchdog_register_governor(&watchdog_gov_diag);
+}
+device_initcall(watchdog_gov_diag_register);
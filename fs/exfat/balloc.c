@@ -10,22 +10,6 @@
 #include "exfat_raw.h"
 #include "exfat_fs.h"
 
-static const unsigned char free_bit[] = {
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2,/*  0 ~  19*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3,/* 20 ~  39*/
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/* 40 ~  59*/
-	0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,/* 60 ~  79*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2,/* 80 ~  99*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3,/*100 ~ 119*/
-	0, 1, 0, 2, 0, 1, 0, 7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/*120 ~ 139*/
-	0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,/*140 ~ 159*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2,/*160 ~ 179*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3,/*180 ~ 199*/
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/*200 ~ 219*/
-	0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,/*220 ~ 239*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0                /*240 ~ 254*/
-};
-
 static const unsigned char used_bit[] = {
 	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3,/*  0 ~  19*/
 	2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2, 3, 3, 4,/* 20 ~  39*/
@@ -139,6 +123,46 @@ void exfat_free_bitmap(struct exfat_sb_info *sbi)
 		__brelse(sbi->vol_amap[i]);
 
 	kvfree(sbi->vol_amap);
+	kvfree(sbi->vol_amap_free);
+}
+
+/* The number of clusters tracked by bitmap sector i */
+static unsigned int exfat_bitmap_sector_bits(struct super_block *sb,
+		unsigned int i)
+{
+	unsigned int total_clus = EXFAT_DATA_CLUSTER_COUNT(EXFAT_SB(sb));
+
+	return min_t(unsigned int, BITS_PER_SECTOR(sb),
+		     total_clus - i * BITS_PER_SECTOR(sb));
+}
+
+/*
+ * Count the free clusters of each bitmap sector, so that searches can step
+ * over the full ones. This is done on the first search rather than at
+ * mount, and the counts are then kept up to date by set/clear_bitmap.
+ * Without them, searches simply look at every sector.
+ */
+static void exfat_build_free_index(struct super_block *sb)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int i, bits, used, rem;
+	unsigned char *data;
+
+	sbi->vol_amap_free = kvmalloc_array(sbi->map_sectors,
+			sizeof(*sbi->vol_amap_free), GFP_NOFS);
+	if (!sbi->vol_amap_free)
+		return;
+
+	for (i = 0; i < sbi->map_sectors; i++) {
+		data = sbi->vol_amap[i]->b_data;
+		bits = exfat_bitmap_sector_bits(sb, i);
+		rem = bits & BITS_PER_BYTE_MASK;
+		used = memweight(data, bits / BITS_PER_BYTE);
+		if (rem)
+			used += hweight8(data[bits / BITS_PER_BYTE] &
+					 ((1 << rem) - 1));
+		sbi->vol_amap_free[i] = bits - used;
+	}
 }
 
 int exfat_set_bitmap(struct inode *inode, unsigned int clu, bool sync)
@@ -155,7 +179,9 @@ int exfat_set_bitmap(struct inode *inode, unsigned int clu, bool sync)
 	i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
 	b = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent_idx);
 
-	set_bit_le(b, sbi->vol_amap[i]->b_data);
+	if (!test_and_set_bit_le(b, sbi->vol_amap[i]->b_data) &&
+	    sbi->vol_amap_free)
+		sbi->vol_amap_free[i]--;
 	exfat_update_bh(sbi->vol_amap[i], sync);
 	return 0;
 }
@@ -175,7 +201,9 @@ void exfat_clear_bitmap(struct inode *inode, unsigned int clu, bool sync)
 	i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
 	b = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent_idx);
 
-	clear_bit_le(b, sbi->vol_amap[i]->b_data);
+	if (test_and_clear_bit_le(b, sbi->vol_amap[i]->b_data) &&
+	    sbi->vol_amap_free)
+		sbi->vol_amap_free[i]++;
 	exfat_update_bh(sbi->vol_amap[i], sync);
 
 	if (opts->discard) {
@@ -198,41 +226,34 @@ void exfat_clear_bitmap(struct inode *inode, unsigned int clu, bool sync)
  */
 unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu)
 {
-	unsigned int i, map_i, map_b, ent_idx;
-	unsigned int clu_base, clu_free;
-	unsigned char k, clu_mask;
+	unsigned int i, map_i, start, bits, bit, ent_idx;
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
 
 	WARN_ON(clu < EXFAT_FIRST_CLUSTER);
-	ent_idx = CLUSTER_TO_BITMAP_ENT(clu);
-	clu_base = BITMAP_ENT_TO_CLUSTER(ent_idx & ~(BITS_PER_BYTE_MASK));
-	clu_mask = IGNORED_BITS_REMAINED(clu, clu_base);
+	if (clu >= sbi->num_clusters)
+		clu = EXFAT_FIRST_CLUSTER;
 
+	if (!sbi->vol_amap_free)
+		exfat_build_free_index(sb);
+
+	ent_idx = CLUSTER_TO_BITMAP_ENT(clu);
 	map_i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
-	map_b = BITMAP_OFFSET_BYTE_IN_SECTOR(sb, ent_idx);
-
-	for (i = EXFAT_FIRST_CLUSTER; i < sbi->num_clusters;
-	     i += BITS_PER_BYTE) {
-		k = *(sbi->vol_amap[map_i]->b_data + map_b);
-		if (clu_mask > 0) {
-			k |= clu_mask;
-			clu_mask = 0;
-		}
-		if (k < 0xFF) {
-			clu_free = clu_base + free_bit[k];
-			if (clu_free < sbi->num_clusters)
-				return clu_free;
+	start = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent_idx);
+
+	/* the first sector is looked at again last, for the bits before clu */
+	for (i = 0; i <= sbi->map_sectors; i++) {
+		if (!sbi->vol_amap_free || sbi->vol_amap_free[map_i]) {
+			bits = exfat_bitmap_sector_bits(sb, map_i);
+			bit = find_next_zero_bit_le(sbi->vol_amap[map_i]->b_data,
+						    bits, start);
+			if (bit < bits)
+				return BITMAP_ENT_TO_CLUSTER(map_i *
+						BITS_PER_SECTOR(sb) + bit);
 		}
-		clu_base += BITS_PER_BYTE;
 
-		if (++map_b >= sb->s_blocksize ||
-		    clu_base >= sbi->num_clusters) {
-			if (++map_i >= sbi->map_sectors) {
-				clu_base = EXFAT_FIRST_CLUSTER;
-				map_i = 0;
-			}
-			map_b = 0;
-		}
+		start = 0;
+		if (++map_i >= sbi->map_sectors)
+			map_i = 0;
 	}
 
 	return EXFAT_EOF_CLUSTER;
@@ -232,6 +232,7 @@ struct exfat_sb_info {
 	unsigned int map_clu; /* allocation bitmap start cluster */
 	unsigned int map_sectors; /* num of allocation bitmap sectors */
 	struct buffer_head **vol_amap; /* allocation bitmap */
+	unsigned short *vol_amap_free; /* free clusters per bitmap sector */
 
 	unsigned short *vol_utbl; /* upcase table */
 
@@ -249,6 +249,39 @@ static int exfat_map_cluster(struct inode *inode, unsigned int clu_offset,
 	return 0;
 }
 
+/*
+ * The number of clusters after clu, the cluster at clu_offset in the file,
+ * that are allocated to the file and follow on from it on disk, up to max.
+ * A NoFatChain file is one extent, a FAT chain has to be walked.
+ */
+static unsigned int exfat_contig_clusters(struct inode *inode,
+		unsigned int clu_offset, unsigned int clu, unsigned int max)
+{
+	struct exfat_inode_info *ei = EXFAT_I(inode);
+	struct exfat_sb_info *sbi = EXFAT_SB(inode->i_sb);
+	unsigned int num_clusters, next, count = 0;
+
+	if (ei->i_size_ondisk <= 0)
+		return 0;
+
+	num_clusters = EXFAT_B_TO_CLU_ROUND_UP(ei->i_size_ondisk, sbi);
+	if (clu_offset + 1 >= num_clusters)
+		return 0;
+	max = min(max, num_clusters - clu_offset - 1);
+
+	if (ei->flags == ALLOC_NO_FAT_CHAIN)
+		return max;
+
+	while (count < max) {
+		if (exfat_ent_get(inode->i_sb, clu, &next) || next != clu + 1)
+			break;
+		clu = next;
+		count++;
+	}
+
+	return count;
+}
+
 static int exfat_map_new_buffer(struct exfat_inode_info *ei,
 		struct buffer_head *bh, loff_t pos)
 {
@@ -302,12 +335,24 @@ static int exfat_get_block(struct inode *inode, sector_t iblock,
 
 	phys = exfat_cluster_to_sector(sbi, cluster) + sec_offset;
 	mapped_blocks = sbi->sect_per_clus - sec_offset;
-	max_blocks = min(mapped_blocks, max_blocks);
 
 	/* Treat newly added block / cluster */
 	if (iblock < last_block)
 		create = 0;
 
+	/*
+	 * Map as much of an existing extent as asked for, so that readahead
+	 * and direct I/O build their bios without coming back per cluster.
+	 */
+	if (!create && !buffer_delay(bh_result) && max_blocks > mapped_blocks)
+		mapped_blocks += (unsigned long)exfat_contig_clusters(inode,
+				iblock >> sbi->sect_per_clus_bits, cluster,
+				(max_blocks - mapped_blocks +
+				 sbi->sect_per_clus - 1) >>
+				sbi->sect_per_clus_bits) <<
+				sbi->sect_per_clus_bits;
+	max_blocks = min(mapped_blocks, max_blocks);
+
 	if (create || buffer_delay(bh_result)) {
 		pos = EXFAT_BLK_TO_B((iblock + 1), sb);
 		if (ei->i_size_ondisk < pos)
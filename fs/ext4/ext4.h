@@ -724,6 +724,7 @@ enum {
 #define EXT4_IOC_CHECKPOINT		_IOW('f', 43, __u32)
 #define EXT4_IOC_GETFSUUID		_IOR('f', 44, struct fsuuid)
 #define EXT4_IOC_SETFSUUID		_IOW('f', 44, struct fsuuid)
+#define EXT4_IOC_SET_STREAMING		_IOW('f', 45, struct ext4_streaming)
 
 #define EXT4_IOC_SHUTDOWN _IOR ('X', 125, __u32)
 
@@ -762,6 +763,19 @@ struct fsuuid {
 	__u8        fsu_uuid[];
 };
 
+/* flags for ioctl EXT4_IOC_SET_STREAMING */
+#define EXT4_STREAMING_ON		0x1	/* register a streaming writer */
+#define EXT4_STREAMING_VALID		EXT4_STREAMING_ON
+
+/*
+ * Structure for EXT4_IOC_SET_STREAMING
+ */
+struct ext4_streaming {
+	__u32       flags;
+	__u32       reserved;		/* must be zero */
+	__u64       prealloc_len;	/* bytes to allocate ahead */
+};
+
 #if defined(__KERNEL__) && defined(CONFIG_COMPAT)
 /*
  * ioctl commands in 32 bit emulation
@@ -1145,6 +1159,10 @@ struct ext4_inode_info {
 	/* pending cluster reservations for bigalloc file systems */
 	struct ext4_pending_tree i_pending_tree;
 
+	/* streaming writer, see ext4_stream_prealloc() */
+	ext4_lblk_t i_stream_prealloc;	/* # of blocks allocated ahead */
+	ext4_lblk_t i_stream_end;	/* end of the blocks allocated ahead */
+
 	/* on-disk additional length */
 	__u16 i_extra_isize;
 
@@ -1902,6 +1920,7 @@ enum {
 	EXT4_STATE_VERITY_IN_PROGRESS,	/* building fs-verity Merkle tree */
 	EXT4_STATE_FC_COMMITTING,	/* Fast commit ongoing */
 	EXT4_STATE_ORPHAN_FILE,		/* Inode orphaned in orphan file */
+	EXT4_STATE_STREAMING,		/* Inode has a streaming writer */
 };
 
 #define EXT4_INODE_BIT_FNS(name, field, offset)				\
@@ -3691,6 +3710,8 @@ extern void ext4_ext_init(struct super_block *);
 extern void ext4_ext_release(struct super_block *);
 extern long ext4_fallocate(struct file *file, int mode, loff_t offset,
 			  loff_t len);
+extern void ext4_stream_prealloc(struct file *file, loff_t end);
+extern void ext4_stop_streaming(struct inode *inode);
 extern int ext4_convert_unwritten_extents(handle_t *handle, struct inode *inode,
 					  loff_t offset, ssize_t len);
 extern int ext4_convert_unwritten_io_end_vec(handle_t *handle,
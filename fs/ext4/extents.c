@@ -4770,6 +4770,68 @@ long ext4_fallocate(struct file *file, int mode, loff_t offset, loff_t len)
 	return ret;
 }
 
+/*
+ * A streaming writer gets unwritten extents allocated i_stream_prealloc
+ * blocks ahead of it, so that its appends find their blocks mapped and
+ * only start a transaction of their own once per allocation. Reads of
+ * the blocks return zeroes until writeback has converted them.
+ *
+ * Called with the inode lock held, before a buffered write ending at @end.
+ */
+void ext4_stream_prealloc(struct file *file, loff_t end)
+{
+	struct inode *inode = file_inode(file);
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	unsigned int blkbits = inode->i_blkbits;
+	ext4_lblk_t lblk;
+	u64 last;
+
+	last = EXT4_BLOCK_ALIGN(end, blkbits) >> blkbits;
+	if (!ei->i_stream_prealloc || last <= ei->i_stream_end)
+		return;
+
+	lblk = max_t(ext4_lblk_t, ei->i_stream_end,
+		     i_size_read(inode) >> blkbits);
+	last = min_t(u64, last + ei->i_stream_prealloc,
+		     inode->i_sb->s_maxbytes >> blkbits);
+	if (last <= lblk)
+		return;
+
+	inode_dio_wait(inode);
+
+	/* the writes fall back to delalloc if this fails */
+	ext4_alloc_file_blocks(file, lblk, last - lblk, 0,
+			       EXT4_GET_BLOCKS_CREATE_UNWRIT_EXT);
+	ei->i_stream_end = last;
+}
+
+/*
+ * Unregisters a streaming writer and drops the blocks that were allocated
+ * ahead of it but never written. Called with the inode lock held.
+ */
+void ext4_stop_streaming(struct inode *inode)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	loff_t size = inode->i_size;
+
+	if (!ext4_test_inode_state(inode, EXT4_STATE_STREAMING))
+		return;
+
+	ext4_clear_inode_state(inode, EXT4_STATE_STREAMING);
+
+	if (ei->i_stream_end >
+	    EXT4_BLOCK_ALIGN(size, inode->i_blkbits) >> inode->i_blkbits) {
+		/* let writeback bring i_disksize up to i_size first */
+		inode_dio_wait(inode);
+		filemap_write_and_wait(inode->i_mapping);
+		filemap_invalidate_lock(inode->i_mapping);
+		ext4_truncate(inode);
+		filemap_invalidate_unlock(inode->i_mapping);
+	}
+	ei->i_stream_prealloc = 0;
+	ei->i_stream_end = 0;
+}
+
 /*
  * This function convert a range of blocks to written extents
  * The caller of this function will pass the start offset and the size.
@@ -166,6 +166,13 @@ static int ext4_release_file(struct inode *inode, struct file *filp)
 		ext4_discard_preallocations(inode, 0);
 		up_write(&EXT4_I(inode)->i_data_sem);
 	}
+	if ((filp->f_mode & FMODE_WRITE) &&
+			(atomic_read(&inode->i_writecount) == 1) &&
+			ext4_test_inode_state(inode, EXT4_STATE_STREAMING)) {
+		inode_lock(inode);
+		ext4_stop_streaming(inode);
+		inode_unlock(inode);
+	}
 	if (is_dx(inode) && filp->private_data)
 		ext4_htree_free_dir_info(filp->private_data);
 
@@ -281,6 +288,10 @@ static ssize_t ext4_buffered_write_iter(struct kiocb *iocb,
 	if (ret <= 0)
 		goto out;
 
+	if (ext4_test_inode_state(inode, EXT4_STATE_STREAMING))
+		ext4_stream_prealloc(iocb->ki_filp,
+				     iocb->ki_pos + iov_iter_count(from));
+
 	current->backing_dev_info = inode_to_bdi(inode);
 	ret = generic_perform_write(iocb, from);
 	current->backing_dev_info = NULL;
@@ -3046,6 +3046,33 @@ static int ext4_da_should_update_i_disksize(struct page *page,
 	return 1;
 }
 
+/*
+ * generic_write_end() without dirtying the inode, for the appends of a
+ * streaming writer that leave i_disksize alone. Writeback of the delayed
+ * or unwritten blocks pushes i_disksize up to i_size, in a transaction it
+ * needs anyway, so there is no need to start another one for each append.
+ */
+static int ext4_da_stream_write_end(struct file *file,
+				    struct address_space *mapping,
+				    loff_t pos, unsigned len, unsigned copied,
+				    struct page *page, void *fsdata)
+{
+	struct inode *inode = mapping->host;
+	loff_t old_size = inode->i_size;
+
+	copied = block_write_end(file, mapping, pos, len, copied, page, fsdata);
+	if (pos + copied > old_size)
+		i_size_write(inode, pos + copied);
+
+	unlock_page(page);
+	put_page(page);
+
+	if (old_size < pos)
+		pagecache_isize_extended(inode, old_size, pos);
+
+	return copied;
+}
+
 static int ext4_da_write_end(struct file *file,
 			     struct address_space *mapping,
 			     loff_t pos, unsigned len, unsigned copied,
@@ -3092,6 +3119,9 @@ static int ext4_da_write_end(struct file *file,
 	if (copied && new_i_size > inode->i_size &&
 	    ext4_da_should_update_i_disksize(page, end))
 		ext4_update_i_disksize(inode, new_i_size);
+	else if (ext4_test_inode_state(inode, EXT4_STATE_STREAMING))
+		return ext4_da_stream_write_end(file, mapping, pos, len,
+						copied, page, fsdata);
 
 	return generic_write_end(file, mapping, pos, len, copied, page, fsdata);
 }
@@ -1089,6 +1089,59 @@ static int ext4_ioctl_checkpoint(struct file *filp, unsigned long arg)
 	return err;
 }
 
+static int ext4_ioctl_set_streaming(struct file *filp, unsigned long arg)
+{
+	struct inode *inode = file_inode(filp);
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_streaming stream;
+	u64 prealloc;
+	int err;
+
+	if (!(filp->f_mode & FMODE_WRITE))
+		return -EBADF;
+
+	if (copy_from_user(&stream, (struct ext4_streaming __user *)arg,
+			   sizeof(stream)))
+		return -EFAULT;
+
+	if ((stream.flags & ~EXT4_STREAMING_VALID) || stream.reserved)
+		return -EINVAL;
+
+	if (!S_ISREG(inode->i_mode))
+		return -EINVAL;
+
+	prealloc = EXT4_BLOCK_ALIGN(stream.prealloc_len, inode->i_blkbits) >>
+		   inode->i_blkbits;
+	if (prealloc > EXT_MAX_BLOCKS)
+		return -EINVAL;
+
+	err = mnt_want_write_file(filp);
+	if (err)
+		return err;
+
+	inode_lock(inode);
+
+	if (!(stream.flags & EXT4_STREAMING_ON)) {
+		ext4_stop_streaming(inode);
+		goto out;
+	}
+
+	/* Unwritten extents and delalloc are what makes the appends cheap */
+	if (!ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS) ||
+	    ext4_should_journal_data(inode) ||
+	    !test_opt(inode->i_sb, DELALLOC)) {
+		err = -EOPNOTSUPP;
+		goto out;
+	}
+
+	ext4_set_inode_state(inode, EXT4_STATE_STREAMING);
+	ei->i_stream_prealloc = prealloc;
+out:
+	inode_unlock(inode);
+	mnt_drop_write_file(filp);
+	return err;
+}
+
 static int ext4_ioctl_setlabel(struct file *filp, const char __user *user_label)
 {
 	size_t len;
@@ -1604,6 +1657,8 @@ static long __ext4_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return ext4_ioctl_getuuid(EXT4_SB(sb), (void __user *)arg);
 	case EXT4_IOC_SETFSUUID:
 		return ext4_ioctl_setuuid(filp, (const void __user *)arg);
+	case EXT4_IOC_SET_STREAMING:
+		return ext4_ioctl_set_streaming(filp, arg);
 	default:
 		return -ENOTTY;
 	}
@@ -1683,6 +1738,7 @@ long ext4_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case FS_IOC_SETFSLABEL:
 	case EXT4_IOC_GETFSUUID:
 	case EXT4_IOC_SETFSUUID:
+	case EXT4_IOC_SET_STREAMING:
 		break;
 	default:
 		return -ENOIOCTLCMD;
@@ -240,6 +240,7 @@ enum {
 #define DEF_DISABLE_INTERVAL		5	/* 5 secs */
 #define DEF_DISABLE_QUICK_INTERVAL	1	/* 1 secs */
 #define DEF_UMOUNT_DISCARD_TIMEOUT	5	/* 5 secs */
+#define DEF_STREAM_INTERVAL		300	/* 300 secs */
 
 struct cp_control {
 	int reason;
@@ -785,6 +786,7 @@ enum {
 	FI_ALIGNED_WRITE,	/* enable aligned write */
 	FI_COW_FILE,		/* indicate COW file */
 	FI_ATOMIC_COMMITTED,	/* indicate atomic commit completed except disk sync */
+	FI_STREAMING,		/* indicate file has a streaming writer */
 	FI_MAX,			/* max flag, never be used */
 };
 
@@ -845,6 +847,10 @@ struct f2fs_inode_info {
 
 	unsigned int atomic_write_cnt;
 	loff_t original_i_size;		/* original i_size before atomic write */
+
+	/* for streaming writers */
+	pgoff_t stream_prealloc_end;	/* end of the blocks allocated ahead */
+	unsigned int stream_prealloc;	/* # of blocks to allocate ahead */
 };
 
 static inline void get_read_extent_info(struct extent_info *ext,
@@ -1292,6 +1298,7 @@ enum {
 	GC_TIME,
 	DISABLE_TIME,
 	UMOUNT_DISCARD_TIMEOUT,
+	STREAM_TIME,
 	MAX_TIME,
 };
 
@@ -1627,6 +1634,7 @@ struct f2fs_sb_info {
 	wait_queue_head_t cp_wait;
 	unsigned long last_time[MAX_TIME];	/* to store time in jiffies */
 	long interval_time[MAX_TIME];		/* to store thresholds */
+	atomic_t nr_streaming;			/* # of streaming writers */
 	struct ckpt_req_control cprc_info;	/* for checkpoint request control */
 
 	struct inode_management im[MAX_INO_ENTRY];	/* manage inode cache */
@@ -1904,6 +1912,17 @@ static inline bool f2fs_time_over(struct f2fs_sb_info *sbi, int type)
 	return time_after(jiffies, sbi->last_time[type] + interval);
 }
 
+/*
+ * Background GC, discard and periodic checkpoints are held back while
+ * streaming writers are registered, for at most STREAM_TIME since the
+ * last checkpoint.
+ */
+static inline bool f2fs_streaming_defer(struct f2fs_sb_info *sbi)
+{
+	return atomic_read(&sbi->nr_streaming) &&
+		!f2fs_time_over(sbi, STREAM_TIME);
+}
+
 static inline unsigned int f2fs_time_to_wait(struct f2fs_sb_info *sbi,
 						int type)
 {
@@ -2809,6 +2828,9 @@ static inline bool is_idle(struct f2fs_sb_info *sbi, int type)
 	if (sbi->gc_mode == GC_URGENT_HIGH)
 		return true;
 
+	if (f2fs_streaming_defer(sbi))
+		return false;
+
 	if (is_inflight_io(sbi, type))
 		return false;
 
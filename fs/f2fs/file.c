@@ -1859,6 +1859,29 @@ static long f2fs_fallocate(struct file *file, int mode,
 	return ret;
 }
 
+/* Called with the inode lock held */
+static void f2fs_stop_streaming(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	if (!is_inode_flag_set(inode, FI_STREAMING))
+		return;
+
+	clear_inode_flag(inode, FI_STREAMING);
+	atomic_dec(&F2FS_I_SB(inode)->nr_streaming);
+
+	/* drop what was allocated ahead and never written */
+	if (fi->stream_prealloc_end > F2FS_BLK_ALIGN(i_size_read(inode))) {
+		f2fs_down_write(&fi->i_gc_rwsem[WRITE]);
+		filemap_invalidate_lock(inode->i_mapping);
+		f2fs_truncate(inode);
+		filemap_invalidate_unlock(inode->i_mapping);
+		f2fs_up_write(&fi->i_gc_rwsem[WRITE]);
+	}
+	fi->stream_prealloc_end = 0;
+	fi->stream_prealloc = 0;
+}
+
 static int f2fs_release_file(struct inode *inode, struct file *filp)
 {
 	/*
@@ -1871,6 +1894,7 @@ static int f2fs_release_file(struct inode *inode, struct file *filp)
 
 	inode_lock(inode);
 	f2fs_abort_atomic_write(inode, true);
+	f2fs_stop_streaming(inode);
 	inode_unlock(inode);
 
 	return 0;
@@ -4175,6 +4199,58 @@ static int f2fs_ioc_compress_file(struct file *filp, unsigned long arg)
 	return ret;
 }
 
+static int f2fs_ioc_set_streaming(struct file *filp, unsigned long arg)
+{
+	struct inode *inode = file_inode(filp);
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct f2fs_streaming stream;
+	u64 prealloc;
+	int ret;
+
+	if (!(filp->f_mode & FMODE_WRITE))
+		return -EBADF;
+
+	if (copy_from_user(&stream, (struct f2fs_streaming __user *)arg,
+				sizeof(stream)))
+		return -EFAULT;
+
+	if (stream.flags & ~F2FS_STREAMING_MASK || stream.reserved)
+		return -EINVAL;
+
+	if (!S_ISREG(inode->i_mode))
+		return -EINVAL;
+
+	prealloc = DIV_ROUND_UP_ULL(stream.prealloc_len, F2FS_BLKSIZE);
+	if (prealloc > sbi->user_block_count)
+		return -EINVAL;
+
+	if (f2fs_readonly(sbi->sb))
+		return -EROFS;
+
+	ret = mnt_want_write_file(filp);
+	if (ret)
+		return ret;
+
+	inode_lock(inode);
+
+	if (!(stream.flags & F2FS_STREAMING_ON)) {
+		f2fs_stop_streaming(inode);
+		goto out;
+	}
+
+	if (!is_inode_flag_set(inode, FI_STREAMING)) {
+		set_inode_flag(inode, FI_STREAMING);
+		/* the deferral is bounded from the first writer on */
+		if (atomic_inc_return(&sbi->nr_streaming) == 1)
+			f2fs_update_time(sbi, STREAM_TIME);
+	}
+	F2FS_I(inode)->stream_prealloc = prealloc;
+out:
+	inode_unlock(inode);
+	mnt_drop_write_file(filp);
+	return 0;
+}
+
 static long __f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	switch (cmd) {
@@ -4259,6 +4335,8 @@ static long __f2fs_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return f2fs_ioc_decompress_file(filp, arg);
 	case F2FS_IOC_COMPRESS_FILE:
 		return f2fs_ioc_compress_file(filp, arg);
+	case F2FS_IOC_SET_STREAMING:
+		return f2fs_ioc_set_streaming(filp, arg);
 	default:
 		return -ENOTTY;
 	}
@@ -4436,6 +4514,25 @@ static ssize_t f2fs_write_checks(struct kiocb *iocb, struct iov_iter *from)
 	return count;
 }
 
+/*
+ * A streaming writer gets its blocks allocated stream_prealloc ahead at a
+ * time, so that most of its writes find them already there.  Returns the
+ * end of the extended request, to be recorded once it is allocated, or 0.
+ */
+static pgoff_t f2fs_stream_prealloc(struct inode *inode,
+				    struct f2fs_map_blocks *map)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	pgoff_t end = map->m_lblk + map->m_len;
+
+	if (!fi->stream_prealloc || end <= fi->stream_prealloc_end)
+		return 0;
+
+	end = min_t(loff_t, end + fi->stream_prealloc, max_file_blocks(inode));
+	map->m_len = end - map->m_lblk;
+	return end;
+}
+
 /*
  * Preallocate blocks for a write request, if it is possible and helpful to do
  * so.  Returns a positive number if blocks may have been preallocated, 0 if no
@@ -4451,6 +4548,7 @@ static int f2fs_preallocate_blocks(struct kiocb *iocb, struct iov_iter *iter,
 	const loff_t pos = iocb->ki_pos;
 	const size_t count = iov_iter_count(iter);
 	struct f2fs_map_blocks map = {};
+	pgoff_t stream_end = 0;
 	int flag;
 	int ret;
 
@@ -4490,6 +4588,8 @@ static int f2fs_preallocate_blocks(struct kiocb *iocb, struct iov_iter *iter,
 	else
 		map.m_len = 0;
 	map.m_may_create = true;
+	if (map.m_len && is_inode_flag_set(inode, FI_STREAMING))
+		stream_end = f2fs_stream_prealloc(inode, &map);
 	if (dio) {
 		map.m_seg_type = f2fs_rw_hint_to_seg_type(inode->i_write_hint);
 		flag = F2FS_GET_BLOCK_PRE_DIO;
@@ -4502,8 +4602,11 @@ static int f2fs_preallocate_blocks(struct kiocb *iocb, struct iov_iter *iter,
 	/* -ENOSPC|-EDQUOT are fine to report the number of allocated blocks. */
 	if (ret < 0 && !((ret == -ENOSPC || ret == -EDQUOT) && map.m_len > 0))
 		return ret;
-	if (ret == 0)
+	if (ret == 0) {
 		set_inode_flag(inode, FI_PREALLOCATED_ALL);
+		if (stream_end)
+			F2FS_I(inode)->stream_prealloc_end = stream_end;
+	}
 	return map.m_len;
 }
 
@@ -4892,6 +4995,7 @@ long f2fs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case F2FS_IOC_SET_COMPRESS_OPTION:
 	case F2FS_IOC_DECOMPRESS_FILE:
 	case F2FS_IOC_COMPRESS_FILE:
+	case F2FS_IOC_SET_STREAMING:
 		break;
 	default:
 		return -ENOIOCTLCMD;
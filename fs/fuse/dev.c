@@ -764,12 +764,18 @@ static int fuse_copy_do(struct fuse_copy_state *cs, void **val, unsigned *size)
 	return ncpy;
 }
 
+/*
+ * PG_arch_1 tracks the cache state of the page (e.g. PG_dcache_clean on
+ * arm), which is still right for the same data in another mapping. It is
+ * left set on page cache pages that were mapped at some point.
+ */
 static int fuse_check_page(struct page *page)
 {
 	if (page_mapcount(page) ||
 	    page->mapping != NULL ||
 	    (page->flags & PAGE_FLAGS_CHECK_AT_PREP &
 	     ~(1 << PG_locked |
+	       1 << PG_arch_1 |
 	       1 << PG_referenced |
 	       1 << PG_uptodate |
 	       1 << PG_lru |
@@ -784,7 +790,8 @@ static int fuse_check_page(struct page *page)
 	return 0;
 }
 
-static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
+static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep,
+			      unsigned int count)
 {
 	int err;
 	struct page *oldpage = *pagep;
@@ -808,7 +815,8 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 	cs->pipebufs++;
 	cs->nr_segs--;
 
-	if (cs->len != PAGE_SIZE)
+	/* The last page of a short read can be moved too, and zeroed */
+	if (buf->offset || cs->len != count)
 		goto out_fallback;
 
 	if (!pipe_buf_try_steal(cs->pipe, buf))
@@ -824,6 +832,9 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 	if (fuse_check_page(newpage) != 0)
 		goto out_fallback_unlock;
 
+	if (count < PAGE_SIZE)
+		zero_user_segment(newpage, count, PAGE_SIZE);
+
 	/*
 	 * This is a new and locked page, it shouldn't be mapped or
 	 * have any special flags on it
@@ -945,9 +956,9 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 				return fuse_ref_page(cs, page, offset, count);
 			}
 		} else if (!cs->len) {
-			if (cs->move_pages && page &&
-			    offset == 0 && count == PAGE_SIZE) {
-				err = fuse_try_move_page(cs, pagep);
+			if (cs->move_pages && page && offset == 0 &&
+			    (count == PAGE_SIZE || zeroing)) {
+				err = fuse_try_move_page(cs, pagep, count);
 				if (err <= 0)
 					return err;
 			} else {
@@ -193,31 +193,22 @@ static int ovl_copy_fileattr(struct inode *inode, const struct path *old,
 	return ovl_real_fileattr_set(new, &newfa);
 }
 
-static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
-			    struct file *new_file, loff_t len)
+static int ovl_copy_up_file_range(struct ovl_fs *ofs, struct file *old_file,
+				  struct file *new_file, loff_t pos, loff_t len)
 {
-	struct path datapath;
-	struct file *old_file;
-	loff_t old_pos = 0;
-	loff_t new_pos = 0;
+	loff_t old_pos = pos;
+	loff_t new_pos = pos;
+	loff_t end = pos + len;
 	loff_t cloned;
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
 	int error = 0;
 
-	ovl_path_lowerdata(dentry, &datapath);
-	if (WARN_ON(datapath.dentry == NULL))
-		return -EIO;
-
-	old_file = ovl_path_open(&datapath, O_LARGEFILE | O_RDONLY);
-	if (IS_ERR(old_file))
-		return PTR_ERR(old_file);
-
 	/* Try to use clone_file_range to clone up within the same fs */
-	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
+	cloned = do_clone_file_range(old_file, pos, new_file, pos, len, 0);
 	if (cloned == len)
-		goto out_fput;
+		return 0;
 	/* Couldn't clone, so now we try to copy the data */
 
 	/* Check if lower fs supports seek operation */
@@ -255,9 +246,9 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		if (skip_hole && data_pos < old_pos) {
 			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
 			if (data_pos > old_pos) {
-				hole_len = data_pos - old_pos;
+				hole_len = min(data_pos, end) - old_pos;
 				len -= hole_len;
-				old_pos = new_pos = data_pos;
+				old_pos = new_pos = old_pos + hole_len;
 				continue;
 			} else if (data_pos == -ENXIO) {
 				break;
@@ -278,8 +269,26 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		len -= bytes;
 	}
 	if (!error && ovl_should_sync(ofs))
-		error = vfs_fsync(new_file, 0);
-out_fput:
+		error = vfs_fsync_range(new_file, pos, end - 1, 0);
+	return error;
+}
+
+static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
+			    struct file *new_file, loff_t len)
+{
+	struct path datapath;
+	struct file *old_file;
+	int error;
+
+	ovl_path_lowerdata(dentry, &datapath);
+	if (WARN_ON(datapath.dentry == NULL))
+		return -EIO;
+
+	old_file = ovl_path_open(&datapath, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(old_file))
+		return PTR_ERR(old_file);
+
+	error = ovl_copy_up_file_range(ofs, old_file, new_file, 0, len);
 	fput(old_file);
 	return error;
 }
@@ -908,10 +917,314 @@ static ssize_t ovl_getxattr_value(const struct path *path, char *name, char **va
 	return res;
 }
 
+/*
+ * Partial copy up: with metacopy=partial, opening a file for write copies up
+ * its metadata only. Each write then copies up the chunks of lower data that
+ * it touches, and records them in the "partial" xattr of the upper file, so
+ * that a small rewrite of a large file doesn't copy up all of it. Reads are
+ * split between the layers along the same chunks.
+ */
+static size_t ovl_partial_xattr_size(struct ovl_partial *p)
+{
+	struct ovl_partial_xattr *px;
+
+	return struct_size(px, map, BITS_TO_U32(p->nchunks));
+}
+
+static struct ovl_partial *ovl_partial_alloc(struct dentry *dentry)
+{
+	struct ovl_partial *p;
+	struct path datapath;
+	struct file *lowerfile;
+	unsigned int shift = OVL_PARTIAL_CHUNK_SHIFT;
+	unsigned int nchunks;
+	loff_t size;
+
+	ovl_path_lowerdata(dentry, &datapath);
+	if (WARN_ON(datapath.dentry == NULL))
+		return ERR_PTR(-EIO);
+
+	size = i_size_read(d_inode(datapath.dentry));
+	while (DIV_ROUND_UP_ULL(size, 1ULL << shift) > OVL_PARTIAL_MAX_CHUNKS)
+		shift++;
+	nchunks = DIV_ROUND_UP_ULL(size, 1ULL << shift);
+
+	p = kzalloc(struct_size(p, map, BITS_TO_LONGS(nchunks)), GFP_KERNEL);
+	if (!p)
+		return ERR_PTR(-ENOMEM);
+
+	lowerfile = ovl_path_open(&datapath, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(lowerfile)) {
+		kfree(p);
+		return ERR_CAST(lowerfile);
+	}
+
+	p->lowerfile = lowerfile;
+	p->lowersize = size;
+	p->chunk_shift = shift;
+	p->nchunks = nchunks;
+
+	return p;
+}
+
+static void ovl_partial_free(struct ovl_partial *p)
+{
+	fput(p->lowerfile);
+	kfree(p);
+}
+
+static int ovl_partial_write(struct ovl_fs *ofs, struct dentry *upper,
+			     struct ovl_partial *p, const unsigned long *map)
+{
+	size_t size = ovl_partial_xattr_size(p);
+	struct ovl_partial_xattr *px;
+	int err;
+
+	px = kzalloc(size, GFP_KERNEL);
+	if (!px)
+		return -ENOMEM;
+
+	px->chunk_shift = p->chunk_shift;
+	px->nchunks = cpu_to_le32(p->nchunks);
+	bitmap_to_arr32((__force u32 *)px->map, map, p->nchunks);
+	cpu_to_le32_array((__force u32 *)px->map, BITS_TO_U32(p->nchunks));
+
+	err = ovl_setxattr(ofs, upper, OVL_XATTR_PARTIAL, px, size);
+	kfree(px);
+
+	return err;
+}
+
+static int ovl_partial_read_xattr(struct ovl_fs *ofs, struct dentry *dentry,
+				  struct ovl_partial *p)
+{
+	size_t size = ovl_partial_xattr_size(p);
+	struct ovl_partial_xattr *px;
+	ssize_t res;
+	int err = 0;
+
+	px = kzalloc(size, GFP_KERNEL);
+	if (!px)
+		return -ENOMEM;
+
+	res = ovl_getxattr_upper(ofs, ovl_dentry_upper(dentry),
+				 OVL_XATTR_PARTIAL, px, size);
+	if (res < 0 && res != -ERANGE && res != -ENODATA) {
+		err = res;
+		goto out;
+	}
+
+	/* Lower data must not have changed since the copy up started */
+	if (res != size || px->version != 0 ||
+	    px->chunk_shift != p->chunk_shift ||
+	    le32_to_cpu(px->nchunks) != p->nchunks) {
+		pr_warn_ratelimited("invalid partial copy up (%pd2)\n", dentry);
+		err = -EIO;
+		goto out;
+	}
+
+	le32_to_cpu_array((__force u32 *)px->map, BITS_TO_U32(p->nchunks));
+	bitmap_from_arr32(p->map, (__force u32 *)px->map, p->nchunks);
+out:
+	kfree(px);
+	return err;
+}
+
+/* Caller should hold ovl_inode->lock */
+static struct ovl_partial *ovl_partial_get(struct dentry *dentry)
+{
+	struct ovl_inode *oi = OVL_I(d_inode(dentry));
+	struct ovl_partial *p = oi->partial;
+	int err;
+
+	if (p)
+		return p;
+
+	p = ovl_partial_alloc(dentry);
+	if (IS_ERR(p))
+		return p;
+
+	err = ovl_partial_read_xattr(OVL_FS(dentry->d_sb), dentry, p);
+	if (err) {
+		ovl_partial_free(p);
+		return ERR_PTR(err);
+	}
+
+	smp_store_release(&oi->partial, p);
+
+	return p;
+}
+
+/*
+ * Turn a metacopy upper into a partial copy up.
+ * Caller should hold ovl_inode->lock.
+ */
+static int ovl_partial_start(struct dentry *dentry)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+	struct inode *inode = d_inode(dentry);
+	struct ovl_partial *p;
+	int err;
+
+	if (ovl_has_upperdata(inode) || ovl_is_partial(inode))
+		return 0;
+
+	/* Left behind by an earlier partial copy up on this inode */
+	if (WARN_ON(OVL_I(inode)->partial))
+		return -EIO;
+
+	p = ovl_partial_alloc(dentry);
+	if (IS_ERR(p))
+		return PTR_ERR(p);
+
+	err = ovl_partial_write(ofs, ovl_dentry_upper(dentry), p, p->map);
+	if (err) {
+		ovl_partial_free(p);
+		return err;
+	}
+
+	smp_store_release(&OVL_I(inode)->partial, p);
+	ovl_set_flag(OVL_PARTIAL, inode);
+
+	return 0;
+}
+
+/* Are any of the chunks in [pos, end) missing from upper? */
+static bool ovl_partial_need_fill(struct ovl_partial *p, loff_t pos,
+				  loff_t end)
+{
+	unsigned long last;
+
+	end = min(end, p->lowersize);
+	if (pos >= end)
+		return false;
+
+	last = ((end - 1) >> p->chunk_shift) + 1;
+	return find_next_zero_bit(p->map, last, pos >> p->chunk_shift) < last;
+}
+
+/*
+ * Copy up the chunks in [pos, end) that upper is missing.
+ * Caller should hold ovl_inode->lock.
+ */
+static int ovl_partial_fill(struct dentry *dentry, struct ovl_partial *p,
+			    loff_t pos, loff_t end)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+	unsigned long first, last, start, stop;
+	struct path upperpath;
+	struct file *new_file;
+	unsigned long *map;
+	int err = 0;
+
+	if (!ovl_partial_need_fill(p, pos, end))
+		return 0;
+
+	end = min(end, p->lowersize);
+	first = pos >> p->chunk_shift;
+	last = ((end - 1) >> p->chunk_shift) + 1;
+
+	map = bitmap_alloc(p->nchunks, GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+	bitmap_copy(map, p->map, p->nchunks);
+
+	ovl_path_upper(dentry, &upperpath);
+	new_file = ovl_path_open(&upperpath, O_LARGEFILE | O_WRONLY);
+	if (IS_ERR(new_file)) {
+		err = PTR_ERR(new_file);
+		goto out_free;
+	}
+
+	for (start = find_next_zero_bit(map, last, first); start < last;
+	     start = find_next_zero_bit(map, last, stop)) {
+		loff_t from = (loff_t)start << p->chunk_shift;
+		loff_t to;
+
+		stop = find_next_bit(map, last, start);
+		to = min((loff_t)stop << p->chunk_shift, p->lowersize);
+
+		err = ovl_copy_up_file_range(ofs, p->lowerfile, new_file,
+					     from, to - from);
+		if (err)
+			goto out_fput;
+
+		bitmap_set(map, start, stop - start);
+	}
+
+	/*
+	 * Record the chunks before anything else is written to them, or the
+	 * write could be lost to a read of the lower chunk after a crash.
+	 */
+	err = ovl_partial_write(ofs, upperpath.dentry, p, map);
+	if (err)
+		goto out_fput;
+
+	/* Pairs with smp_rmb() in ovl_partial_run() */
+	smp_wmb();
+	bitmap_or(p->map, p->map, map, p->nchunks);
+out_fput:
+	fput(new_file);
+out_free:
+	bitmap_free(map);
+	return err;
+}
+
+/**
+ * ovl_partial_run - find out which layer has the data at @pos
+ * @p: partial copy up
+ * @pos: position in the file
+ * @upper: set if the data is in upper
+ *
+ * Returns the number of bytes from @pos that are all in the same layer.
+ */
+loff_t ovl_partial_run(struct ovl_partial *p, loff_t pos, bool *upper)
+{
+	unsigned long chunk, next;
+
+	/* Anything past the lower data was written in upper */
+	if (pos >= p->lowersize) {
+		*upper = true;
+		return LLONG_MAX - pos;
+	}
+
+	chunk = pos >> p->chunk_shift;
+	*upper = test_bit(chunk, p->map);
+	/* Pairs with smp_wmb() in ovl_partial_fill() */
+	smp_rmb();
+	if (*upper) {
+		next = find_next_zero_bit(p->map, p->nchunks, chunk);
+		if (next >= p->nchunks)
+			return LLONG_MAX - pos;
+	} else {
+		next = find_next_bit(p->map, p->nchunks, chunk);
+	}
+
+	return min((loff_t)next << p->chunk_shift, p->lowersize) - pos;
+}
+
+/* Copy up the rest of a partial copy up. Caller holds ovl_inode->lock */
+static int ovl_copy_up_partial_data(struct ovl_copy_up_ctx *c)
+{
+	struct ovl_partial *p;
+
+	/* Truncated on open, so there's nothing left to copy up */
+	if (!c->stat.size)
+		return 0;
+
+	p = ovl_partial_get(c->dentry);
+	if (IS_ERR(p))
+		return PTR_ERR(p);
+
+	return ovl_partial_fill(c->dentry, p, 0, p->lowersize);
+}
+
 /* Copy up data of an inode which was copied up metadata only in the past. */
 static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 {
 	struct ovl_fs *ofs = OVL_FS(c->dentry->d_sb);
+	struct inode *inode = d_inode(c->dentry);
+	bool partial = ovl_is_partial(inode);
 	struct path upperpath;
 	int err;
 	char *capability = NULL;
@@ -928,7 +1241,10 @@ static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 			goto out;
 	}
 
-	err = ovl_copy_up_data(c, &upperpath);
+	if (partial)
+		err = ovl_copy_up_partial_data(c);
+	else
+		err = ovl_copy_up_data(c, &upperpath);
 	if (err)
 		goto out_free;
 
@@ -948,7 +1264,12 @@ static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 	if (err)
 		goto out_free;
 
-	ovl_set_upperdata(d_inode(c->dentry));
+	/* Ignored by lookup without the metacopy xattr, if left behind */
+	if (partial)
+		ovl_removexattr(ofs, upperpath.dentry, OVL_XATTR_PARTIAL);
+
+	ovl_set_upperdata(inode);
+	ovl_clear_flag(OVL_PARTIAL, inode);
 out_free:
 	kfree(capability);
 out:
@@ -1082,6 +1403,42 @@ static bool ovl_open_need_copy_up(struct dentry *dentry, int flags)
 	return true;
 }
 
+static bool ovl_need_partial_copy_up(struct dentry *dentry, int flags)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+
+	if (!ofs->config.metacopy || !ofs->config.metacopy_partial)
+		return false;
+
+	if (!d_is_reg(dentry) || (flags & O_TRUNC))
+		return false;
+
+	/* Nothing to gain for an empty file */
+	return i_size_read(d_inode(dentry)) > 0;
+}
+
+static int ovl_copy_up_partial(struct dentry *dentry)
+{
+	struct inode *inode = d_inode(dentry);
+	const struct cred *old_cred;
+	int err;
+
+	/* Metadata only, the data is copied up as it gets written */
+	err = ovl_copy_up_flags(dentry, 0);
+	if (err || ovl_is_partial(inode))
+		return err;
+
+	old_cred = ovl_override_creds(dentry->d_sb);
+	err = ovl_inode_lock_interruptible(inode);
+	if (!err) {
+		err = ovl_partial_start(dentry);
+		ovl_inode_unlock(inode);
+	}
+	revert_creds(old_cred);
+
+	return err;
+}
+
 int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 {
 	int err = 0;
@@ -1089,7 +1446,10 @@ int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 	if (ovl_open_need_copy_up(dentry, flags)) {
 		err = ovl_want_write(dentry);
 		if (!err) {
-			err = ovl_copy_up_flags(dentry, flags);
+			if (ovl_need_partial_copy_up(dentry, flags))
+				err = ovl_copy_up_partial(dentry);
+			else
+				err = ovl_copy_up_flags(dentry, flags);
 			ovl_drop_write(dentry);
 		}
 	}
@@ -1097,6 +1457,87 @@ int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 	return err;
 }
 
+/*
+ * Readers of a partial copy up get the rest of it copied up, as they might
+ * mmap it, if that can be done. Writers only need the map of chunks.
+ */
+int ovl_partial_open(struct dentry *dentry, bool write)
+{
+	struct inode *inode = d_inode(dentry);
+	const struct cred *old_cred;
+	struct ovl_partial *p;
+	int err;
+
+	if (!write && !ovl_partial_complete(dentry))
+		return 0;
+
+	old_cred = ovl_override_creds(dentry->d_sb);
+	err = ovl_inode_lock_interruptible(inode);
+	if (!err) {
+		if (ovl_is_partial(inode)) {
+			p = ovl_partial_get(dentry);
+			err = PTR_ERR_OR_ZERO(p);
+		}
+		ovl_inode_unlock(inode);
+	}
+	revert_creds(old_cred);
+
+	return err;
+}
+
+/* Copy up the chunks that a write to [pos, pos + len) is about to modify */
+int ovl_partial_copy_up(struct dentry *dentry, loff_t pos, loff_t len,
+			bool nowait)
+{
+	struct inode *inode = d_inode(dentry);
+	struct ovl_partial *p = ovl_partial(inode);
+	const struct cred *old_cred;
+	int err;
+
+	if (WARN_ON_ONCE(!p))
+		return -EIO;
+
+	if (!ovl_partial_need_fill(p, pos, pos + len))
+		return 0;
+
+	if (nowait)
+		return -EAGAIN;
+
+	err = ovl_want_write(dentry);
+	if (err)
+		return err;
+
+	old_cred = ovl_override_creds(dentry->d_sb);
+	err = ovl_inode_lock_interruptible(inode);
+	if (!err) {
+		/* Unless the rest got copied up in the meantime */
+		if (ovl_is_partial(inode))
+			err = ovl_partial_fill(dentry, p, pos, pos + len);
+		ovl_inode_unlock(inode);
+	}
+	revert_creds(old_cred);
+	ovl_drop_write(dentry);
+
+	return err;
+}
+
+/* Copy up the rest of a partial copy up, for operations that need it all */
+int ovl_partial_complete(struct dentry *dentry)
+{
+	int err;
+
+	if (!ovl_is_partial(d_inode(dentry)))
+		return 0;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_with_data(dentry);
+		ovl_drop_write(dentry);
+	}
+
+	return err;
+}
+
 int ovl_copy_up_with_data(struct dentry *dentry)
 {
 	return ovl_copy_up_flags(dentry, O_WRONLY);
@@ -153,6 +153,12 @@ static int ovl_open(struct inode *inode, struct file *file)
 	if (err)
 		return err;
 
+	if (ovl_is_partial(inode)) {
+		err = ovl_partial_open(dentry, file->f_mode & FMODE_WRITE);
+		if (err)
+			return err;
+	}
+
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
@@ -192,6 +198,11 @@ static loff_t ovl_llseek(struct file *file, loff_t offset, int whence)
 			return vfs_setpos(file, 0, 0);
 	}
 
+	/* Neither layer knows where the holes of a partial copy up are */
+	if ((whence == SEEK_DATA || whence == SEEK_HOLE) &&
+	    ovl_is_partial(inode))
+		return generic_file_llseek(file, offset, whence);
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		return ret;
@@ -293,9 +304,48 @@ static void ovl_aio_rw_complete(struct kiocb *iocb, long res)
 	orig_iocb->ki_complete(orig_iocb, res);
 }
 
+/* Read each run of a partial copy up from the layer that has it */
+static ssize_t ovl_partial_read_iter(struct kiocb *iocb, struct iov_iter *iter,
+				     struct file *upperfile)
+{
+	struct ovl_partial *p = ovl_partial(file_inode(iocb->ki_filp));
+	rwf_t flags = ovl_iocb_to_rwf(iocb->ki_flags);
+	ssize_t ret = 0, done = 0;
+
+	if (WARN_ON_ONCE(!p))
+		return -EIO;
+
+	while (iov_iter_count(iter)) {
+		size_t count = iov_iter_count(iter);
+		size_t rest = 0;
+		bool upper;
+		loff_t len;
+
+		len = ovl_partial_run(p, iocb->ki_pos, &upper);
+		if (len < count) {
+			rest = count - len;
+			iov_iter_truncate(iter, len);
+		}
+
+		ret = vfs_iter_read(upper ? upperfile : p->lowerfile, iter,
+				    &iocb->ki_pos, flags);
+		iov_iter_reexpand(iter, iov_iter_count(iter) + rest);
+		if (ret <= 0)
+			break;
+
+		done += ret;
+		/* End of file, or interrupted */
+		if (ret < count - rest)
+			break;
+	}
+
+	return done ?: ret;
+}
+
 static ssize_t ovl_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 {
 	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
 	struct fd real;
 	const struct cred *old_cred;
 	ssize_t ret;
@@ -313,7 +363,11 @@ static ssize_t ovl_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 		goto out_fdput;
 
 	old_cred = ovl_override_creds(file_inode(file)->i_sb);
-	if (is_sync_kiocb(iocb)) {
+	if (ovl_is_partial(inode) &&
+	    file_inode(real.file) == ovl_inode_upper(inode)) {
+		/* Done synchronously, even for async requests */
+		ret = ovl_partial_read_iter(iocb, iter, real.file);
+	} else if (is_sync_kiocb(iocb)) {
 		ret = vfs_iter_read(real.file, iter, &iocb->ki_pos,
 				    ovl_iocb_to_rwf(iocb->ki_flags));
 	} else {
@@ -371,6 +425,17 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	    !(real.file->f_mode & FMODE_CAN_ODIRECT))
 		goto out_fdput;
 
+	if (ovl_is_partial(inode)) {
+		loff_t pos = ifl & IOCB_APPEND ? i_size_read(inode) :
+						 iocb->ki_pos;
+
+		ret = ovl_partial_copy_up(file_dentry(file), pos,
+					  iov_iter_count(iter),
+					  ifl & IOCB_NOWAIT);
+		if (ret)
+			goto out_fdput;
+	}
+
 	if (!ovl_should_sync(OVL_FS(inode->i_sb)))
 		ifl &= ~(IOCB_DSYNC | IOCB_SYNC);
 
@@ -443,6 +508,14 @@ static ssize_t ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 	if (ret)
 		goto out_unlock;
 
+	if (ovl_is_partial(inode)) {
+		ret = ovl_partial_copy_up(file_dentry(out), *ppos, len, false);
+		if (ret) {
+			fdput(real);
+			goto out_unlock;
+		}
+	}
+
 	old_cred = ovl_override_creds(inode->i_sb);
 	file_start_write(real.file);
 
@@ -495,6 +568,13 @@ static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 	if (!realfile->f_op->mmap)
 		return -ENODEV;
 
+	/*
+	 * Neither layer has all of the data of a partial copy up, and it
+	 * can't be copied up with mmap_lock held.
+	 */
+	if (ovl_is_partial(file_inode(file)))
+		return -ENODEV;
+
 	if (WARN_ON(file != vma->vm_file))
 		return -EIO;
 
@@ -522,6 +602,10 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	if (ret)
 		goto out_unlock;
 
+	ret = ovl_partial_complete(file_dentry(file));
+	if (ret)
+		goto out_unlock;
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		goto out_unlock;
@@ -584,6 +668,12 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 			goto out_unlock;
 	}
 
+	ret = ovl_partial_complete(file_dentry(file_out));
+	if (!ret)
+		ret = ovl_partial_complete(file_dentry(file_in));
+	if (ret)
+		goto out_unlock;
+
 	ret = ovl_real_fdget(file_out, &real_out);
 	if (ret)
 		goto out_unlock;
@@ -572,7 +572,8 @@ static int ovl_fiemap(struct inode *inode, struct fiemap_extent_info *fieinfo,
 	struct inode *realinode = ovl_inode_realdata(inode);
 	const struct cred *old_cred;
 
-	if (!realinode->i_op->fiemap)
+	/* Extents are split between the layers */
+	if (!realinode->i_op->fiemap || ovl_is_partial(inode))
 		return -EOPNOTSUPP;
 
 	old_cred = ovl_override_creds(inode->i_sb);
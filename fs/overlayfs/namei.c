@@ -846,6 +846,7 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 	unsigned int i;
 	int err;
 	bool uppermetacopy = false;
+	bool upperpartial = false;
 	struct ovl_lookup_data d = {
 		.sb = dentry->d_sb,
 		.name = dentry->d_name,
@@ -1097,6 +1098,16 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		uppermetacopy = err;
 	}
 
+	if (upperdentry && uppermetacopy) {
+		struct path upperpath = {
+			.dentry = upperdentry,
+			.mnt = ovl_upper_mnt(ofs),
+		};
+
+		upperpartial = ovl_path_getxattr(ofs, &upperpath,
+						 OVL_XATTR_PARTIAL, NULL, 0) > 0;
+	}
+
 	if (upperdentry || ctr) {
 		struct ovl_inode_params oip = {
 			.upperdentry = upperdentry,
@@ -1114,6 +1125,8 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 			goto out_free_oe;
 		if (upperdentry && !uppermetacopy)
 			ovl_set_flag(OVL_UPPERDATA, inode);
+		else if (upperpartial)
+			ovl_set_flag(OVL_PARTIAL, inode);
 	}
 
 	ovl_dentry_init_reval(dentry, upperdentry);
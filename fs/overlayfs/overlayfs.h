@@ -36,6 +36,7 @@ enum ovl_xattr {
 	OVL_XATTR_UPPER,
 	OVL_XATTR_METACOPY,
 	OVL_XATTR_PROTATTR,
+	OVL_XATTR_PARTIAL,
 };
 
 enum ovl_inode_flag {
@@ -47,6 +48,8 @@ enum ovl_inode_flag {
 	OVL_UPPERDATA,
 	/* Inode number will remain constant over copy up. */
 	OVL_CONST_INO,
+	/* Some of the data is in upper, the rest only in lower */
+	OVL_PARTIAL,
 };
 
 enum ovl_entry_flag {
@@ -112,6 +115,22 @@ struct ovl_fh {
 	};
 } __packed;
 
+/*
+ * On-disk format for "partial" xattr: one bit per chunk of the lower data,
+ * set once the chunk has been copied up.
+ */
+struct ovl_partial_xattr {
+	u8 version;	/* 0 */
+	u8 chunk_shift;	/* log2 of chunk size */
+	u8 padding[2];
+	__le32 nchunks;	/* number of chunks in lower data */
+	__le32 map[];	/* bits of chunks in upper */
+} __packed;
+
+/* Chunks are at least 64K, and grow to keep the map under 2K */
+#define OVL_PARTIAL_CHUNK_SHIFT	16
+#define OVL_PARTIAL_MAX_CHUNKS	16384
+
 #define OVL_FH_WIRE_OFFSET	offsetof(struct ovl_fh, fb)
 #define OVL_FH_LEN(fh)		(OVL_FH_WIRE_OFFSET + (fh)->fb.len)
 #define OVL_FH_FID_OFFSET	(OVL_FH_WIRE_OFFSET + \
@@ -398,6 +417,8 @@ bool ovl_dentry_needs_data_copy_up(struct dentry *dentry, int flags);
 bool ovl_dentry_needs_data_copy_up_locked(struct dentry *dentry, int flags);
 bool ovl_has_upperdata(struct inode *inode);
 void ovl_set_upperdata(struct inode *inode);
+bool ovl_is_partial(struct inode *inode);
+struct ovl_partial *ovl_partial(struct inode *inode);
 bool ovl_redirect_dir(struct super_block *sb);
 const char *ovl_dentry_get_redirect(struct dentry *dentry);
 void ovl_dentry_set_redirect(struct dentry *dentry, const char *redirect);
@@ -687,6 +708,11 @@ int ovl_fileattr_set(struct user_namespace *mnt_userns,
 int ovl_copy_up(struct dentry *dentry);
 int ovl_copy_up_with_data(struct dentry *dentry);
 int ovl_maybe_copy_up(struct dentry *dentry, int flags);
+int ovl_partial_open(struct dentry *dentry, bool write);
+int ovl_partial_copy_up(struct dentry *dentry, loff_t pos, loff_t len,
+			bool nowait);
+int ovl_partial_complete(struct dentry *dentry);
+loff_t ovl_partial_run(struct ovl_partial *p, loff_t pos, bool *upper);
 int ovl_copy_xattr(struct super_block *sb, const struct path *path, struct dentry *new);
 int ovl_set_attr(struct ovl_fs *ofs, struct dentry *upper, struct kstat *stat);
 struct ovl_fh *ovl_encode_real_fh(struct ovl_fs *ofs, struct dentry *real,
@@ -18,6 +18,7 @@ struct ovl_config {
 	bool nfs_export;
 	int xino;
 	bool metacopy;
+	bool metacopy_partial;
 	bool userxattr;
 	bool ovl_volatile;
 };
@@ -133,11 +134,21 @@ static inline struct ovl_entry *OVL_E(struct dentry *dentry)
 	return (struct ovl_entry *) dentry->d_fsdata;
 }
 
+/* Chunks of the lower data already copied up, see OVL_PARTIAL */
+struct ovl_partial {
+	struct file *lowerfile;		/* reads of chunks not in upper */
+	loff_t lowersize;
+	unsigned int chunk_shift;
+	unsigned int nchunks;
+	unsigned long map[];
+};
+
 struct ovl_inode {
 	union {
 		struct ovl_dir_cache *cache;	/* directory */
 		struct inode *lowerdata;	/* regular file */
 	};
+	struct ovl_partial *partial;
 	const char *redirect;
 	u64 version;
 	unsigned long flags;
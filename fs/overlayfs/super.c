@@ -193,6 +193,7 @@ static struct inode *ovl_alloc_inode(struct super_block *sb)
 	oi->lowerpath.dentry = NULL;
 	oi->lowerpath.layer = NULL;
 	oi->lowerdata = NULL;
+	oi->partial = NULL;
 	mutex_init(&oi->lock);
 
 	return &oi->vfs_inode;
@@ -213,10 +214,15 @@ static void ovl_destroy_inode(struct inode *inode)
 
 	dput(oi->__upperdentry);
 	dput(oi->lowerpath.dentry);
-	if (S_ISDIR(inode->i_mode))
+	if (S_ISDIR(inode->i_mode)) {
 		ovl_dir_cache_free(inode);
-	else
+	} else {
 		iput(oi->lowerdata);
+		if (oi->partial) {
+			fput(oi->partial->lowerfile);
+			kfree(oi->partial);
+		}
+	}
 }
 
 static void ovl_free_fs(struct ovl_fs *ofs)
@@ -384,7 +390,9 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 						"on" : "off");
 	if (ofs->config.xino != ovl_xino_def() && !ovl_same_fs(sb))
 		seq_printf(m, ",xino=%s", ovl_xino_str[ofs->config.xino]);
-	if (ofs->config.metacopy != ovl_metacopy_def)
+	if (ofs->config.metacopy && ofs->config.metacopy_partial)
+		seq_puts(m, ",metacopy=partial");
+	else if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
 	if (ofs->config.ovl_volatile)
@@ -445,6 +453,7 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_METACOPY_PARTIAL,
 	OPT_VOLATILE,
 	OPT_ERR,
 };
@@ -467,6 +476,7 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_METACOPY_PARTIAL,		"metacopy=partial"},
 	{OPT_VOLATILE,			"volatile"},
 	{OPT_ERR,			NULL}
 };
@@ -612,11 +622,19 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 
 		case OPT_METACOPY_ON:
 			config->metacopy = true;
+			config->metacopy_partial = false;
 			metacopy_opt = true;
 			break;
 
 		case OPT_METACOPY_OFF:
 			config->metacopy = false;
+			config->metacopy_partial = false;
+			metacopy_opt = true;
+			break;
+
+		case OPT_METACOPY_PARTIAL:
+			config->metacopy = true;
+			config->metacopy_partial = true;
 			metacopy_opt = true;
 			break;
 
@@ -216,7 +216,9 @@ enum ovl_path_type ovl_path_realdata(struct dentry *dentry, struct path *path)
 
 	WARN_ON_ONCE(d_is_dir(dentry));
 
-	if (!OVL_TYPE_UPPER(type) || OVL_TYPE_MERGE(type))
+	/* Reads of a partial copy up are split between layers by the caller */
+	if (!OVL_TYPE_UPPER(type) ||
+	    (OVL_TYPE_MERGE(type) && !ovl_is_partial(d_inode(dentry))))
 		ovl_path_lowerdata(dentry, path);
 	else
 		ovl_path_upper(dentry, path);
@@ -414,6 +416,22 @@ void ovl_set_upperdata(struct inode *inode)
 	ovl_set_flag(OVL_UPPERDATA, inode);
 }
 
+/*
+ * A partial copy up, where upper has the chunks of data that were written
+ * to and lower still has the rest. Once all data is in upper, the inode
+ * has upperdata and the OVL_PARTIAL flag no longer counts.
+ */
+bool ovl_is_partial(struct inode *inode)
+{
+	return ovl_test_flag(OVL_PARTIAL, inode) && !ovl_has_upperdata(inode);
+}
+
+/* Pairs with smp_store_release() when the map is loaded */
+struct ovl_partial *ovl_partial(struct inode *inode)
+{
+	return smp_load_acquire(&OVL_I(inode)->partial);
+}
+
 /* Caller should hold ovl_inode->lock */
 bool ovl_dentry_needs_data_copy_up_locked(struct dentry *dentry, int flags)
 {
@@ -633,6 +651,7 @@ bool ovl_path_check_dir_xattr(struct ovl_fs *ofs, const struct path *path,
 #define OVL_XATTR_UPPER_POSTFIX		"upper"
 #define OVL_XATTR_METACOPY_POSTFIX	"metacopy"
 #define OVL_XATTR_PROTATTR_POSTFIX	"protattr"
+#define OVL_XATTR_PARTIAL_POSTFIX	"partial"
 
 #define OVL_XATTR_TAB_ENTRY(x) \
 	[x] = { [false] = OVL_XATTR_TRUSTED_PREFIX x ## _POSTFIX, \
@@ -647,6 +666,7 @@ const char *const ovl_xattr_table[][2] = {
 	OVL_XATTR_TAB_ENTRY(OVL_XATTR_UPPER),
 	OVL_XATTR_TAB_ENTRY(OVL_XATTR_METACOPY),
 	OVL_XATTR_TAB_ENTRY(OVL_XATTR_PROTATTR),
+	OVL_XATTR_TAB_ENTRY(OVL_XATTR_PARTIAL),
 };
 
 int ovl_check_setxattr(struct ovl_fs *ofs, struct dentry *upperdentry,
@@ -67,6 +67,7 @@
 #include <linux/sched/task_stack.h>
 #include <linux/sched/task.h>
 #include <linux/sched/cputime.h>
+#include <linux/sched/debug.h>
 #include <linux/proc_fs.h>
 #include <linux/ioport.h>
 #include <linux/io.h>
@@ -403,6 +404,10 @@ static inline void task_context_switch_counts(struct seq_file *m,
 	seq_put_decimal_ull(m, "voluntary_ctxt_switches:\t", p->nvcsw);
 	seq_put_decimal_ull(m, "\nnonvoluntary_ctxt_switches:\t", p->nivcsw);
 	seq_putc(m, '\n');
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+	seq_put_decimal_ull(m, "RtFaults:\t", task_rt_faults(p));
+	seq_putc(m, '\n');
+#endif
 }
 
 static void task_cpus_allowed(struct seq_file *m, struct task_struct *task)
@@ -487,6 +487,22 @@ static int proc_pid_schedstat(struct seq_file *m, struct pid_namespace *ns,
 }
 #endif
 
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+static int proc_pid_interruptions(struct seq_file *m, struct pid_namespace *ns,
+				  struct pid *pid, struct task_struct *task)
+{
+	proc_sched_interruptions_show(task, m);
+	return 0;
+}
+
+static int proc_pid_idle_states(struct seq_file *m, struct pid_namespace *ns,
+				struct pid *pid, struct task_struct *task)
+{
+	proc_sched_idle_states_show(task, m);
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_LATENCYTOP
 static int lstats_show_proc(struct seq_file *m, void *v)
 {
@@ -3294,6 +3310,10 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_SCHED_INFO
 	ONE("schedstat",  S_IRUGO, proc_pid_schedstat),
 #endif
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+	ONE("interruptions", S_IRUGO, proc_pid_interruptions),
+	ONE("idle_states", S_IRUGO, proc_pid_idle_states),
+#endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
 #endif
@@ -3643,6 +3663,10 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_SCHED_INFO
 	ONE("schedstat", S_IRUGO, proc_pid_schedstat),
 #endif
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+	ONE("interruptions", S_IRUGO, proc_pid_interruptions),
+	ONE("idle_states", S_IRUGO, proc_pid_idle_states),
+#endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
 #endif
@@ -126,13 +126,65 @@ static const struct seq_operations pstore_ftrace_seq_ops = {
 	.show	= pstore_ftrace_seq_show,
 };
 
+#define RTEVENT_SIZE sizeof(struct pstore_rtevent_record)
+
+static const char * const pstore_rtevent_names[PSTORE_RTEVENT_MAX] = {
+	[PSTORE_RTEVENT_DROPPED]	= "dropped",
+	[PSTORE_RTEVENT_PCM_XRUN]	= "pcm-xrun",
+};
+
+/* The zone wraps around at record boundaries, so records start at 0 */
+static void *pstore_rtevent_seq_start(struct seq_file *s, loff_t *pos)
+{
+	struct pstore_private *ps = s->private;
+
+	if ((*pos + 1) * RTEVENT_SIZE > ps->total_size)
+		return NULL;
+
+	return ps->record->buf + *pos * RTEVENT_SIZE;
+}
+
+static void pstore_rtevent_seq_stop(struct seq_file *s, void *v)
+{
+}
+
+static void *pstore_rtevent_seq_next(struct seq_file *s, void *v, loff_t *pos)
+{
+	(*pos)++;
+
+	return pstore_rtevent_seq_start(s, pos);
+}
+
+static int pstore_rtevent_seq_show(struct seq_file *s, void *v)
+{
+	struct pstore_rtevent_record *rec = v;
+
+	seq_printf(s, "CPU:%u ts:%llu seq:%u ", rec->cpu, rec->time,
+		   rec->seq);
+	if (rec->type < PSTORE_RTEVENT_MAX)
+		seq_puts(s, pstore_rtevent_names[rec->type]);
+	else
+		seq_printf(s, "type-%u", rec->type);
+	seq_printf(s, " %08x %08x\n", rec->arg[0], rec->arg[1]);
+
+	return 0;
+}
+
+static const struct seq_operations pstore_rtevent_seq_ops = {
+	.start	= pstore_rtevent_seq_start,
+	.next	= pstore_rtevent_seq_next,
+	.stop	= pstore_rtevent_seq_stop,
+	.show	= pstore_rtevent_seq_show,
+};
+
 static ssize_t pstore_file_read(struct file *file, char __user *userbuf,
 						size_t count, loff_t *ppos)
 {
 	struct seq_file *sf = file->private_data;
 	struct pstore_private *ps = sf->private;
 
-	if (ps->record->type == PSTORE_TYPE_FTRACE)
+	if (ps->record->type == PSTORE_TYPE_FTRACE ||
+	    ps->record->type == PSTORE_TYPE_RTEVENT)
 		return seq_read(file, userbuf, count, ppos);
 	return simple_read_from_buffer(userbuf, count, ppos,
 				       ps->record->buf, ps->total_size);
@@ -147,6 +199,8 @@ static int pstore_file_open(struct inode *inode, struct file *file)
 
 	if (ps->record->type == PSTORE_TYPE_FTRACE)
 		sops = &pstore_ftrace_seq_ops;
+	else if (ps->record->type == PSTORE_TYPE_RTEVENT)
+		sops = &pstore_rtevent_seq_ops;
 
 	err = seq_open(file, sops);
 	if (err < 0)
@@ -33,6 +33,14 @@ static inline void pstore_register_pmsg(void) {}
 static inline void pstore_unregister_pmsg(void) {}
 #endif
 
+#ifdef CONFIG_PSTORE_RTEVENT
+extern void pstore_register_rtevent(void);
+extern void pstore_unregister_rtevent(void);
+#else
+static inline void pstore_register_rtevent(void) {}
+static inline void pstore_unregister_rtevent(void) {}
+#endif
+
 extern struct pstore_info *psinfo;
 
 extern void	pstore_set_kmsg_bytes(int);
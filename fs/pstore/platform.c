@@ -58,6 +58,7 @@ static const char * const pstore_type_names[] = {
 	"powerpc-common",
 	"pmsg",
 	"powerpc-opal",
+	"rtevent",
 };
 
 static int pstore_new_entry;
@@ -609,6 +610,8 @@ int pstore_register(struct pstore_info *psi)
 		pstore_register_ftrace();
 	if (psi->flags & PSTORE_FLAGS_PMSG)
 		pstore_register_pmsg();
+	if (psi->flags & PSTORE_FLAGS_RTEVENT)
+		pstore_register_rtevent();
 
 	/* Start watching for new records, if desired. */
 	pstore_timer_kick();
@@ -641,6 +644,8 @@ void pstore_unregister(struct pstore_info *psi)
 	}
 
 	/* Unregister all callbacks. */
+	if (psi->flags & PSTORE_FLAGS_RTEVENT)
+		pstore_unregister_rtevent();
 	if (psi->flags & PSTORE_FLAGS_PMSG)
 		pstore_unregister_pmsg();
 	if (psi->flags & PSTORE_FLAGS_FTRACE)
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Persistent realtime event log
+ *
+ * Events are fixed-size records that are staged in RAM and handed to the
+ * backend in batches, so that a block backend sees few, large writes rather
+ * than one per event. Logging an event only takes a raw spinlock to copy a
+ * record into the staging ring, so it can be done from hard interrupts. Events
+ * still staged when the power goes are lost: rtevent_flush_interval bounds
+ * how old those can be.
+ */
+
+#define pr_fmt(fmt) "pstore: " fmt
+
+#include <linux/kernel.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/reboot.h>
+#include <linux/sizes.h>
+#include <linux/smp.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+#include <linux/workqueue.h>
+#include "internal.h"
+
+#define RTEVENT_STAGED	(SZ_16K / sizeof(struct pstore_rtevent_record))
+
+static unsigned int rtevent_flush_bytes = SZ_4K;
+module_param(rtevent_flush_bytes, uint, 0644);
+MODULE_PARM_DESC(rtevent_flush_bytes,
+		 "write the staged realtime events once they reach this size (default: 4096)");
+
+static unsigned int rtevent_flush_interval = 10;
+module_param(rtevent_flush_interval, uint, 0644);
+MODULE_PARM_DESC(rtevent_flush_interval,
+		 "longest time realtime events stay staged, in seconds (default: 10)");
+
+static DEFINE_RAW_SPINLOCK(rtevent_lock);
+static struct pstore_rtevent_record rtevent_stage[RTEVENT_STAGED];
+static unsigned int rtevent_head;
+static unsigned int rtevent_count;
+static unsigned int rtevent_dropped;
+static u32 rtevent_seq;
+static bool rtevent_enabled;
+
+/* One more for the record of dropped events */
+static struct pstore_rtevent_record rtevent_out[RTEVENT_STAGED + 1];
+static DEFINE_MUTEX(rtevent_flush_lock);
+
+static void pstore_rtevent_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(rtevent_flush_work, pstore_rtevent_work);
+
+/**
+ * pstore_rtevent() - log a realtime event to pstore
+ * @type: the event, one of &enum pstore_rtevent_type
+ * @arg0: first argument, depending on @type
+ * @arg1: second argument, depending on @type
+ *
+ * Can be called from any context but NMI. The event is dropped, and
+ * counted, if there is no room left to stage it.
+ */
+void pstore_rtevent(u16 type, u32 arg0, u32 arg1)
+{
+	struct pstore_rtevent_record *rec;
+	unsigned int staged, limit;
+	unsigned long flags;
+
+	if (!READ_ONCE(rtevent_enabled))
+		return;
+
+	raw_spin_lock_irqsave(&rtevent_lock, flags);
+
+	/* Checked again under the lock, to not schedule after unregistering */
+	if (!rtevent_enabled)
+		goto out;
+
+	if (rtevent_count == RTEVENT_STAGED) {
+		rtevent_dropped++;
+	} else {
+		rec = &rtevent_stage[(rtevent_head + rtevent_count) %
+				     RTEVENT_STAGED];
+		rec->time = ktime_get_real_fast_ns();
+		rec->seq = rtevent_seq++;
+		rec->cpu = raw_smp_processor_id();
+		rec->type = type;
+		rec->arg[0] = arg0;
+		rec->arg[1] = arg1;
+		staged = ++rtevent_count * sizeof(*rec);
+
+		/* Kick the flush once per batch, or start its timeout */
+		limit = READ_ONCE(rtevent_flush_bytes);
+		if (staged >= limit && staged - sizeof(*rec) < limit)
+			mod_delayed_work(system_wq, &rtevent_flush_work, 0);
+		else if (staged == sizeof(*rec))
+			schedule_delayed_work(&rtevent_flush_work,
+					READ_ONCE(rtevent_flush_interval) * HZ);
+	}
+out:
+	raw_spin_unlock_irqrestore(&rtevent_lock, flags);
+}
+EXPORT_SYMBOL_GPL(pstore_rtevent);
+
+static void pstore_rtevent_flush(void)
+{
+	struct pstore_record record;
+	unsigned int head, n, i;
+	unsigned long flags;
+	u32 dropped;
+
+	mutex_lock(&rtevent_flush_lock);
+
+	raw_spin_lock_irqsave(&rtevent_lock, flags);
+	head = rtevent_head;
+	n = rtevent_count;
+	dropped = rtevent_dropped;
+	rtevent_dropped = 0;
+	raw_spin_unlock_irqrestore(&rtevent_lock, flags);
+
+	/* New events are staged after these, so they can be copied unlocked */
+	for (i = 0; i < n; i++)
+		rtevent_out[i] = rtevent_stage[(head + i) % RTEVENT_STAGED];
+
+	raw_spin_lock_irqsave(&rtevent_lock, flags);
+	rtevent_head = (head + n) % RTEVENT_STAGED;
+	rtevent_count -= n;
+	/* Those staged meanwhile still have to go out in time */
+	if (rtevent_count && rtevent_enabled)
+		schedule_delayed_work(&rtevent_flush_work,
+				      READ_ONCE(rtevent_flush_interval) * HZ);
+	raw_spin_unlock_irqrestore(&rtevent_lock, flags);
+
+	if (dropped) {
+		struct pstore_rtevent_record *rec = &rtevent_out[n++];
+
+		memset(rec, 0, sizeof(*rec));
+		rec->time = ktime_get_real_fast_ns();
+		rec->cpu = raw_smp_processor_id();
+		rec->type = PSTORE_RTEVENT_DROPPED;
+		rec->arg[0] = dropped;
+	}
+
+	if (n) {
+		pstore_record_init(&record, psinfo);
+		record.type = PSTORE_TYPE_RTEVENT;
+		record.buf = (char *)rtevent_out;
+		record.size = n * sizeof(*rtevent_out);
+		psinfo->write(&record);
+	}
+
+	mutex_unlock(&rtevent_flush_lock);
+}
+
+static void pstore_rtevent_work(struct work_struct *work)
+{
+	pstore_rtevent_flush();
+}
+
+static int pstore_rtevent_reboot(struct notifier_block *nb,
+				 unsigned long action, void *data)
+{
+	pstore_rtevent_flush();
+
+	return NOTIFY_DONE;
+}
+
+/* Ahead of other reboot notifiers, which may sync and stop the backend */
+static struct notifier_block pstore_rtevent_reboot_nb = {
+	.notifier_call = pstore_rtevent_reboot,
+	.priority = INT_MAX,
+};
+
+static void pstore_rtevent_set_enabled(bool enabled)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&rtevent_lock, flags);
+	WRITE_ONCE(rtevent_enabled, enabled);
+	raw_spin_unlock_irqrestore(&rtevent_lock, flags);
+}
+
+void pstore_register_rtevent(void)
+{
+	pstore_rtevent_set_enabled(true);
+	register_reboot_notifier(&pstore_rtevent_reboot_nb);
+}
+
+/* Called before psinfo goes, nothing is scheduled once this returns */
+void pstore_unregister_rtevent(void)
+{
+	unregister_reboot_notifier(&pstore_rtevent_reboot_nb);
+	pstore_rtevent_set_enabled(false);
+	cancel_delayed_work_sync(&rtevent_flush_work);
+	pstore_rtevent_flush();
+}
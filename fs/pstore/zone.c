@@ -92,12 +92,14 @@ struct pstore_zone {
  * @kpszs: kmsg dump storage zones
  * @ppsz: pmsg storage zone
  * @cpsz: console storage zone
+ * @rpsz: realtime event storage zone
  * @fpszs: ftrace storage zones
  * @kmsg_max_cnt: max count of @kpszs
  * @kmsg_read_cnt: counter of total read kmsg dumps
  * @kmsg_write_cnt: counter of total kmsg dump writes
  * @pmsg_read_cnt: counter of total read pmsg zone
  * @console_read_cnt: counter of total read console zone
+ * @rtevent_read_cnt: counter of total read realtime event zone
  * @ftrace_max_cnt: max count of @fpszs
  * @ftrace_read_cnt: counter of max read ftrace zone
  * @oops_counter: counter of oops dumps
@@ -112,12 +114,14 @@ struct psz_context {
 	struct pstore_zone **kpszs;
 	struct pstore_zone *ppsz;
 	struct pstore_zone *cpsz;
+	struct pstore_zone *rpsz;
 	struct pstore_zone **fpszs;
 	unsigned int kmsg_max_cnt;
 	unsigned int kmsg_read_cnt;
 	unsigned int kmsg_write_cnt;
 	unsigned int pmsg_read_cnt;
 	unsigned int console_read_cnt;
+	unsigned int rtevent_read_cnt;
 	unsigned int ftrace_max_cnt;
 	unsigned int ftrace_read_cnt;
 	/*
@@ -321,6 +325,8 @@ static void psz_flush_all_dirty_zones(struct work_struct *work)
 		ret |= psz_flush_dirty_zone(cxt->ppsz);
 	if (cxt->cpsz)
 		ret |= psz_flush_dirty_zone(cxt->cpsz);
+	if (cxt->rpsz)
+		ret |= psz_flush_dirty_zone(cxt->rpsz);
 	if (cxt->kpszs)
 		ret |= psz_flush_dirty_zones(cxt->kpszs, cxt->kmsg_max_cnt);
 	if (cxt->fpszs)
@@ -617,6 +623,10 @@ static inline int psz_recovery(struct psz_context *cxt)
 	if (ret)
 		goto out;
 
+	ret = psz_recover_zone(cxt, cxt->rpsz);
+	if (ret)
+		goto out;
+
 	ret = psz_recover_zones(cxt, cxt->fpszs, cxt->ftrace_max_cnt);
 
 out:
@@ -636,6 +646,7 @@ static int psz_pstore_open(struct pstore_info *psi)
 	cxt->kmsg_read_cnt = 0;
 	cxt->pmsg_read_cnt = 0;
 	cxt->console_read_cnt = 0;
+	cxt->rtevent_read_cnt = 0;
 	cxt->ftrace_read_cnt = 0;
 	return 0;
 }
@@ -709,6 +720,8 @@ static int psz_pstore_erase(struct pstore_record *record)
 		return psz_record_erase(cxt, cxt->ppsz);
 	case PSTORE_TYPE_CONSOLE:
 		return psz_record_erase(cxt, cxt->cpsz);
+	case PSTORE_TYPE_RTEVENT:
+		return psz_record_erase(cxt, cxt->rpsz);
 	case PSTORE_TYPE_FTRACE:
 		if (record->id >= cxt->ftrace_max_cnt)
 			return -EINVAL;
@@ -820,10 +833,19 @@ static int notrace psz_kmsg_write(struct psz_context *cxt,
 	return 0;
 }
 
+/* Fixed-size records must not be split when the zone wraps around */
+static inline size_t psz_record_wrap(struct pstore_zone *zone)
+{
+	if (zone->type == PSTORE_TYPE_RTEVENT)
+		return rounddown(zone->buffer_size,
+				 sizeof(struct pstore_rtevent_record));
+	return zone->buffer_size;
+}
+
 static int notrace psz_record_write(struct pstore_zone *zone,
 		struct pstore_record *record)
 {
-	size_t start, rem;
+	size_t start, rem, size;
 	bool is_full_data = false;
 	char *buf;
 	int cnt;
@@ -831,18 +853,19 @@ static int notrace psz_record_write(struct pstore_zone *zone,
 	if (!zone || !record)
 		return -ENOSPC;
 
-	if (atomic_read(&zone->buffer->datalen) >= zone->buffer_size)
+	size = psz_record_wrap(zone);
+	if (atomic_read(&zone->buffer->datalen) >= size)
 		is_full_data = true;
 
 	cnt = record->size;
 	buf = record->buf;
-	if (unlikely(cnt > zone->buffer_size)) {
-		buf += cnt - zone->buffer_size;
-		cnt = zone->buffer_size;
+	if (unlikely(cnt > size)) {
+		buf += cnt - size;
+		cnt = size;
 	}
 
 	start = buffer_start(zone);
-	rem = zone->buffer_size - start;
+	rem = size - start;
 	if (unlikely(rem < cnt)) {
 		psz_zone_write(zone, FLUSH_PART, buf, rem, start);
 		buf += rem;
@@ -863,7 +886,7 @@ static int notrace psz_record_write(struct pstore_zone *zone,
 	 * greater than buffer size.
 	 */
 	if (is_full_data) {
-		atomic_set(&zone->buffer->datalen, zone->buffer_size);
+		atomic_set(&zone->buffer->datalen, size);
 		psz_zone_write(zone, FLUSH_META, NULL, 0, 0);
 	}
 	return 0;
@@ -891,6 +914,8 @@ static int notrace psz_pstore_write(struct pstore_record *record)
 		return psz_record_write(cxt->cpsz, record);
 	case PSTORE_TYPE_PMSG:
 		return psz_record_write(cxt->ppsz, record);
+	case PSTORE_TYPE_RTEVENT:
+		return psz_record_write(cxt->rpsz, record);
 	case PSTORE_TYPE_FTRACE: {
 		int zonenum = smp_processor_id();
 
@@ -935,6 +960,13 @@ static struct pstore_zone *psz_read_next_zone(struct psz_context *cxt)
 			return zone;
 	}
 
+	if (cxt->rtevent_read_cnt == 0) {
+		cxt->rtevent_read_cnt++;
+		zone = cxt->rpsz;
+		if (psz_old_ok(zone))
+			return zone;
+	}
+
 	return NULL;
 }
 
@@ -1082,6 +1114,7 @@ static ssize_t psz_pstore_read(struct pstore_record *record)
 		break;
 	case PSTORE_TYPE_CONSOLE:
 	case PSTORE_TYPE_PMSG:
+	case PSTORE_TYPE_RTEVENT:
 		readop = psz_record_read;
 		break;
 	default:
@@ -1143,6 +1176,8 @@ static void psz_free_all_zones(struct psz_context *cxt)
 		psz_free_zone(&cxt->ppsz);
 	if (cxt->cpsz)
 		psz_free_zone(&cxt->cpsz);
+	if (cxt->rpsz)
+		psz_free_zone(&cxt->rpsz);
 	if (cxt->fpszs)
 		psz_free_zones(&cxt->fpszs, &cxt->ftrace_max_cnt);
 }
@@ -1255,6 +1290,15 @@ static int psz_alloc_zones(struct psz_context *cxt)
 		goto free_out;
 	}
 
+	off_size += info->rtevent_size;
+	cxt->rpsz = psz_init_zone(PSTORE_TYPE_RTEVENT, &off,
+			info->rtevent_size);
+	if (IS_ERR(cxt->rpsz)) {
+		err = PTR_ERR(cxt->rpsz);
+		cxt->rpsz = NULL;
+		goto free_out;
+	}
+
 	off_size += info->ftrace_size;
 	cxt->fpszs = psz_init_zones(PSTORE_TYPE_FTRACE, &off,
 			info->ftrace_size,
@@ -1305,7 +1349,7 @@ int register_pstore_zone(struct pstore_zone_info *info)
 	}
 
 	if (!info->kmsg_size && !info->pmsg_size && !info->console_size &&
-	    !info->ftrace_size) {
+	    !info->ftrace_size && !info->rtevent_size) {
 		pr_warn("at least one record size must be non-zero\n");
 		return -EINVAL;
 	}
@@ -1330,6 +1374,7 @@ int register_pstore_zone(struct pstore_zone_info *info)
 	check_size(pmsg_size, SECTOR_SIZE);
 	check_size(console_size, SECTOR_SIZE);
 	check_size(ftrace_size, SECTOR_SIZE);
+	check_size(rtevent_size, SECTOR_SIZE);
 
 #undef check_size
 
@@ -1358,6 +1403,7 @@ int register_pstore_zone(struct pstore_zone_info *info)
 	pr_debug("\tpmsg size : %ld Bytes\n", info->pmsg_size);
 	pr_debug("\tconsole size : %ld Bytes\n", info->console_size);
 	pr_debug("\tftrace size : %ld Bytes\n", info->ftrace_size);
+	pr_debug("\trtevent size : %ld Bytes\n", info->rtevent_size);
 
 	err = psz_alloc_zones(cxt);
 	if (err) {
@@ -1399,6 +1445,10 @@ int register_pstore_zone(struct pstore_zone_info *info)
 		cxt->pstore.flags |= PSTORE_FLAGS_FTRACE;
 		pr_cont(" ftrace");
 	}
+	if (info->rtevent_size) {
+		cxt->pstore.flags |= PSTORE_FLAGS_RTEVENT;
+		pr_cont(" rtevent");
+	}
 	pr_cont("\n");
 
 	err = pstore_register(&cxt->pstore);
@@ -17,7 +17,9 @@
  * access the metadata and fragment caches.
  *
  * To avoid out of memory and fragmentation issues with vmalloc the cache
- * uses sequences of kmalloced PAGE_SIZE buffers.
+ * uses sequences of kmalloced PAGE_SIZE buffers.  The least recently used
+ * entry is reused first, and under memory pressure the shrinker frees the
+ * buffers of unused entries, which are allocated again when next needed.
  *
  * It should be noted that the cache is not used for file datablocks, these
  * are decompressed and cached in the page-cache in the normal way.  The
@@ -45,6 +47,33 @@
 #include "squashfs.h"
 #include "page_actor.h"
 
+static void squashfs_cache_free_buffers(struct squashfs_cache *cache,
+	struct squashfs_cache_entry *entry)
+{
+	int j;
+
+	for (j = 0; j < cache->pages; j++) {
+		kfree(entry->data[j]);
+		entry->data[j] = NULL;
+	}
+}
+
+static int squashfs_cache_alloc_buffers(struct squashfs_cache *cache,
+	struct squashfs_cache_entry *entry, gfp_t gfp)
+{
+	int j;
+
+	for (j = 0; j < cache->pages; j++) {
+		if (entry->data[j])
+			continue;
+		entry->data[j] = kmalloc(PAGE_SIZE, gfp);
+		if (entry->data[j] == NULL)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -81,19 +110,18 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			}
 
 			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
+			 * At least one unused cache entry.  The least recently
+			 * used one is evicted from the cache.
 			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
+			for (i = -1, n = 0; n < cache->entries; n++) {
+				if (cache->entry[n].refcount == 0 && (i < 0 ||
+				    cache->entry[n].last_used <
+				    cache->entry[i].last_used))
+					i = n;
 			}
 
-			cache->next_blk = (i + 1) % cache->entries;
 			entry = &cache->entry[i];
+			cache->misses++;
 
 			/*
 			 * Initialise chosen cache entry, and fill it in from
@@ -105,10 +133,16 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			entry->pending = 1;
 			entry->num_waiters = 0;
 			entry->error = 0;
+			entry->last_used = ++cache->clock;
 			spin_unlock(&cache->lock);
 
-			entry->length = squashfs_read_data(sb, block, length,
-				&entry->next_index, entry->actor);
+			/* The shrinker may have freed the buffers */
+			entry->length = squashfs_cache_alloc_buffers(cache,
+				entry, GFP_NOFS);
+			if (entry->length == 0)
+				entry->length = squashfs_read_data(sb, block,
+					length, &entry->next_index,
+					entry->actor);
 
 			spin_lock(&cache->lock);
 
@@ -141,6 +175,8 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		if (entry->refcount == 0)
 			cache->unused--;
 		entry->refcount++;
+		entry->last_used = ++cache->clock;
+		cache->hits++;
 
 		/*
 		 * If the entry is currently being filled in by another process
@@ -191,20 +227,70 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 	spin_unlock(&cache->lock);
 }
 
+/* The unused entries still holding their buffers */
+static bool squashfs_cache_reclaimable(struct squashfs_cache_entry *entry)
+{
+	return entry->refcount == 0 && entry->data[0];
+}
+
+static unsigned long squashfs_cache_count(struct shrinker *shrink,
+	struct shrink_control *sc)
+{
+	struct squashfs_cache *cache = container_of(shrink,
+		struct squashfs_cache, shrinker);
+	unsigned long count = 0;
+	int i;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < cache->entries; i++)
+		if (squashfs_cache_reclaimable(&cache->entry[i]))
+			count += cache->pages;
+	spin_unlock(&cache->lock);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
 /*
- * Delete cache reclaiming all kmalloced buffers.
+ * Free the buffers of the least recently used unused entries.  They are
+ * invalidated, so a later look-up reads and decompresses the block again.
  */
-void squashfs_cache_delete(struct squashfs_cache *cache)
+static unsigned long squashfs_cache_scan(struct shrinker *shrink,
+	struct shrink_control *sc)
 {
-	int i, j;
+	struct squashfs_cache *cache = container_of(shrink,
+		struct squashfs_cache, shrinker);
+	unsigned long freed = 0;
+	int i, n;
 
-	if (cache == NULL)
-		return;
+	spin_lock(&cache->lock);
+	while (freed < sc->nr_to_scan) {
+		for (i = -1, n = 0; n < cache->entries; n++) {
+			if (squashfs_cache_reclaimable(&cache->entry[n]) &&
+			    (i < 0 || cache->entry[n].last_used <
+			     cache->entry[i].last_used))
+				i = n;
+		}
+		if (i < 0)
+			break;
+
+		cache->entry[i].block = SQUASHFS_INVALID_BLK;
+		cache->entry[i].last_used = 0;
+		squashfs_cache_free_buffers(cache, &cache->entry[i]);
+		cache->shrunk++;
+		freed += cache->pages;
+	}
+	spin_unlock(&cache->lock);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static void squashfs_cache_free(struct squashfs_cache *cache)
+{
+	int i;
 
 	for (i = 0; i < cache->entries; i++) {
 		if (cache->entry[i].data) {
-			for (j = 0; j < cache->pages; j++)
-				kfree(cache->entry[i].data[j]);
+			squashfs_cache_free_buffers(cache, &cache->entry[i]);
 			kfree(cache->entry[i].data);
 		}
 		kfree(cache->entry[i].actor);
@@ -214,6 +300,18 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 	kfree(cache);
 }
 
+/*
+ * Delete cache reclaiming all kmalloced buffers.
+ */
+void squashfs_cache_delete(struct squashfs_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	unregister_shrinker(&cache->shrinker);
+	squashfs_cache_free(cache);
+}
+
 
 /*
  * Initialise cache allocating the specified number of entries, each of
@@ -223,7 +321,7 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	int block_size)
 {
-	int i, j;
+	int i;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -238,7 +336,6 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	}
 
 	cache->curr_blk = 0;
-	cache->next_blk = 0;
 	cache->unused = entries;
 	cache->entries = entries;
 	cache->block_size = block_size;
@@ -261,12 +358,9 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 			goto cleanup;
 		}
 
-		for (j = 0; j < cache->pages; j++) {
-			entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
-			if (entry->data[j] == NULL) {
-				ERROR("Failed to allocate %s buffer\n", name);
-				goto cleanup;
-			}
+		if (squashfs_cache_alloc_buffers(cache, entry, GFP_KERNEL)) {
+			ERROR("Failed to allocate %s buffer\n", name);
+			goto cleanup;
 		}
 
 		entry->actor = squashfs_page_actor_init(entry->data,
@@ -277,10 +371,18 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		}
 	}
 
+	cache->shrinker.count_objects = squashfs_cache_count;
+	cache->shrinker.scan_objects = squashfs_cache_scan;
+	cache->shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&cache->shrinker, "squashfs-%s", name)) {
+		ERROR("Failed to register %s cache shrinker\n", name);
+		goto cleanup;
+	}
+
 	return cache;
 
 cleanup:
-	squashfs_cache_delete(cache);
+	squashfs_cache_free(cache);
 	return NULL;
 }
 
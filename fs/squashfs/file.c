@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +534,89 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/* The blocks one readahead call reads and decompresses at the same time */
+#ifdef CONFIG_SQUASHFS_READAHEAD_PARALLEL
+#define SQUASHFS_READAHEAD_BLOCKS	8
+#else
+#define SQUASHFS_READAHEAD_BLOCKS	1
+#endif
+
+struct squashfs_readahead_block {
+	struct work_struct work;
+	struct super_block *sb;
+	struct page **pages;
+	unsigned int nr_pages;
+	unsigned int expected;
+	bool last;
+	u64 block;
+	int bsize;
+};
+
+static void squashfs_readahead_block(struct squashfs_readahead_block *rab)
+{
+	struct squashfs_sb_info *msblk = rab->sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int i, res;
+
+	actor = squashfs_page_actor_init_special(msblk, rab->pages,
+						 rab->nr_pages, rab->expected);
+	if (!actor)
+		goto out;
+
+	res = squashfs_read_data(rab->sb, rab->block, rab->bsize, NULL, actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == rab->expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (rab->last && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < rab->nr_pages; i++) {
+			flush_dcache_page(rab->pages[i]);
+			SetPageUptodate(rab->pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < rab->nr_pages; i++) {
+		unlock_page(rab->pages[i]);
+		put_page(rab->pages[i]);
+	}
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	squashfs_readahead_block(container_of(work,
+		struct squashfs_readahead_block, work));
+}
+
+/*
+ * Read and decompress the blocks, all but the first on the unbound
+ * workqueue, so the reads are in flight together and the blocks are
+ * decompressed on as many CPUs as there are blocks.
+ */
+static void squashfs_readahead_blocks(struct squashfs_readahead_block *rab,
+	unsigned int blocks)
+{
+	unsigned int n;
+
+	for (n = 1; n < blocks; n++) {
+		INIT_WORK(&rab[n].work, squashfs_readahead_work);
+		queue_work(system_unbound_wq, &rab[n].work);
+	}
+
+	if (blocks)
+		squashfs_readahead_block(&rab[0]);
+
+	for (n = 1; n < blocks; n++)
+		flush_work(&rab[n].work);
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,24 +625,30 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
-	unsigned int nr_pages = 0;
-	struct page **pages;
+	struct squashfs_readahead_block *rab;
+	unsigned int nr_pages = 0, blocks = 0, max_blocks;
+	struct page **pages, **batch;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
+	unsigned int block_pages = max_pages;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
-		return;
+	max_blocks = min_t(size_t, SQUASHFS_READAHEAD_BLOCKS,
+			   readahead_length(ractl) >> msblk->block_log);
+	max_blocks = max(max_blocks, 1U);
+
+	pages = kmalloc_array(max_blocks * block_pages, sizeof(void *),
+			      GFP_KERNEL);
+	rab = kmalloc_array(max_blocks, sizeof(*rab), GFP_KERNEL);
+	if (!pages || !rab)
+		goto out;
 
 	for (;;) {
 		pgoff_t index;
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -566,21 +656,22 @@ static void squashfs_readahead(struct readahead_control *ractl)
 
 		max_pages = (expected + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
-		nr_pages = __readahead_batch(ractl, pages, max_pages);
+		batch = pages + blocks * block_pages;
+		nr_pages = __readahead_batch(ractl, batch, max_pages);
 		if (!nr_pages)
 			break;
 
 		if (readahead_pos(ractl) >= i_size_read(inode))
 			goto skip_pages;
 
-		index = pages[0]->index >> shift;
+		index = batch[0]->index >> shift;
 
-		if ((pages[nr_pages - 1]->index >> shift) != index)
+		if ((batch[nr_pages - 1]->index >> shift) != index)
 			goto skip_pages;
 
 		if (index == file_end && squashfs_i(inode)->fragment_block !=
 						SQUASHFS_INVALID_BLK) {
-			res = squashfs_readahead_fragment(pages, nr_pages,
+			res = squashfs_readahead_fragment(batch, nr_pages,
 							  expected);
 			if (res)
 				goto skip_pages;
@@ -591,44 +682,32 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
-		}
-
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		rab[blocks] = (struct squashfs_readahead_block) {
+			.sb = inode->i_sb,
+			.pages = batch,
+			.nr_pages = nr_pages,
+			.expected = expected,
+			.last = index == file_end,
+			.block = block,
+			.bsize = bsize,
+		};
+
+		if (++blocks == max_blocks) {
+			squashfs_readahead_blocks(rab, blocks);
+			blocks = 0;
 		}
 	}
 
-	kfree(pages);
-	return;
+	goto out;
 
 skip_pages:
 	for (i = 0; i < nr_pages; i++) {
-		unlock_page(pages[i]);
-		put_page(pages[i]);
+		unlock_page(batch[i]);
+		put_page(batch[i]);
 	}
+out:
+	squashfs_readahead_blocks(rab, blocks);
+	kfree(rab);
 	kfree(pages);
 }
 
@@ -204,6 +204,9 @@ static inline int squashfs_block_size(__le32 raw)
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
 
+/* largest metadata and fragment caches the mount options may ask for */
+#define SQUASHFS_CACHE_MAX_ENTRIES	1024
+
 /* meta index cache */
 #define SQUASHFS_META_INDEXES	(SQUASHFS_METADATA_SIZE / sizeof(unsigned int))
 #define SQUASHFS_META_ENTRIES	127
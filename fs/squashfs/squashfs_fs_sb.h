@@ -10,19 +10,26 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/kobject.h>
+#include <linux/shrinker.h>
+
 #include "squashfs_fs.h"
 
 struct squashfs_cache {
 	char			*name;
 	int			entries;
 	int			curr_blk;
-	int			next_blk;
 	int			num_waiters;
 	int			unused;
 	int			block_size;
 	int			pages;
+	u64			clock;
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		shrunk;
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
+	struct shrinker		shrinker;
 	struct squashfs_cache_entry *entry;
 };
 
@@ -34,6 +41,7 @@ struct squashfs_cache_entry {
 	int			pending;
 	int			error;
 	int			num_waiters;
+	u64			last_used;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache	*cache;
 	void			**data;
@@ -66,5 +74,7 @@ struct squashfs_sb_info {
 	unsigned int				xattr_ids;
 	unsigned int				ids;
 	bool					panic_on_errors;
+	struct kobject				kobj;
+	struct completion			kobj_unregister;
 };
 #endif
@@ -47,10 +47,14 @@ enum Opt_errors {
 
 enum squashfs_param {
 	Opt_errors,
+	Opt_metadata_cache,
+	Opt_fragment_cache,
 };
 
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
+	unsigned int metadata_cache;
+	unsigned int fragment_cache;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -61,6 +65,8 @@ static const struct constant_table squashfs_param_errors[] = {
 
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
+	fsparam_u32("metadata_cache", Opt_metadata_cache),
+	fsparam_u32("fragment_cache", Opt_fragment_cache),
 	{}
 };
 
@@ -78,6 +84,17 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 	case Opt_errors:
 		opts->errors = result.uint_32;
 		break;
+	case Opt_metadata_cache:
+	case Opt_fragment_cache:
+		if (result.uint_32 == 0 ||
+		    result.uint_32 > SQUASHFS_CACHE_MAX_ENTRIES)
+			return invalfc(fc, "%s must be between 1 and %d",
+				       param->key, SQUASHFS_CACHE_MAX_ENTRIES);
+		if (opt == Opt_metadata_cache)
+			opts->metadata_cache = result.uint_32;
+		else
+			opts->fragment_cache = result.uint_32;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -246,7 +263,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			opts->metadata_cache, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -321,7 +338,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts->fragment_cache, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -351,18 +368,22 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto insanity;
 	}
 
+	err = squashfs_sysfs_register(sb);
+	if (err)
+		goto failed_mount;
+
 	/* allocate root */
 	root = new_inode(sb);
 	if (!root) {
 		err = -ENOMEM;
-		goto failed_mount;
+		goto failed_sysfs;
 	}
 
 	err = squashfs_read_inode(root, root_inode);
 	if (err) {
 		make_bad_inode(root);
 		iput(root);
-		goto failed_mount;
+		goto failed_sysfs;
 	}
 	insert_inode_hash(root);
 
@@ -370,7 +391,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	if (sb->s_root == NULL) {
 		ERROR("Root inode create failed\n");
 		err = -ENOMEM;
-		goto failed_mount;
+		goto failed_sysfs;
 	}
 
 	TRACE("Leaving squashfs_fill_super\n");
@@ -379,6 +400,9 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 
 insanity:
 	errorf(fc, "squashfs image failed sanity check");
+	goto failed_mount;
+failed_sysfs:
+	squashfs_sysfs_unregister(sb);
 failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
@@ -408,6 +432,12 @@ static int squashfs_reconfigure(struct fs_context *fc)
 	sync_filesystem(fc->root->d_sb);
 	fc->sb_flags |= SB_RDONLY;
 
+	if ((opts->metadata_cache &&
+	     opts->metadata_cache != msblk->block_cache->entries) ||
+	    (opts->fragment_cache && msblk->fragment_cache &&
+	     opts->fragment_cache != msblk->fragment_cache->entries))
+		return invalfc(fc, "cache sizes can't be changed on remount");
+
 	msblk->panic_on_errors = (opts->errors == Opt_errors_panic);
 
 	return 0;
@@ -435,6 +465,14 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 	else
 		seq_puts(s, ",errors=continue");
 
+	if (msblk->block_cache->entries != SQUASHFS_CACHED_BLKS)
+		seq_printf(s, ",metadata_cache=%d",
+			   msblk->block_cache->entries);
+	if (msblk->fragment_cache &&
+	    msblk->fragment_cache->entries != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache=%d",
+			   msblk->fragment_cache->entries);
+
 	return 0;
 }
 
@@ -446,6 +484,11 @@ static int squashfs_init_fs_context(struct fs_context *fc)
 	if (!opts)
 		return -ENOMEM;
 
+	if (fc->purpose != FS_CONTEXT_FOR_RECONFIGURE) {
+		opts->metadata_cache = SQUASHFS_CACHED_BLKS;
+		opts->fragment_cache = SQUASHFS_CACHED_FRAGMENTS;
+	}
+
 	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
@@ -475,6 +518,7 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_sysfs_unregister(sb);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -529,8 +573,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_sysfs_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_sysfs_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -544,6 +595,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_sysfs_exit();
 	destroy_inodecache();
 }
 
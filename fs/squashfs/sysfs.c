@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * sysfs.c
+ */
+
+/*
+ * This file implements /sys/fs/squashfs/<device>, which shows the use of
+ * the metadata and fragment caches of each mounted filesystem.
+ */
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+static struct kset *squashfs_kset;
+
+enum squashfs_cache_stat {
+	SQUASHFS_CACHE_ENTRIES,
+	SQUASHFS_CACHE_HITS,
+	SQUASHFS_CACHE_MISSES,
+	SQUASHFS_CACHE_SHRUNK,
+};
+
+struct squashfs_attr {
+	struct attribute attr;
+	enum squashfs_cache_stat stat;
+	bool fragment;
+};
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+	struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+		attr);
+	struct squashfs_cache *cache = a->fragment ? msblk->fragment_cache :
+		msblk->block_cache;
+	unsigned long val = 0;
+
+	/* A filesystem without fragments has no fragment cache */
+	if (cache == NULL)
+		return sysfs_emit(buf, "0\n");
+
+	spin_lock(&cache->lock);
+	switch (a->stat) {
+	case SQUASHFS_CACHE_ENTRIES:
+		val = cache->entries;
+		break;
+	case SQUASHFS_CACHE_HITS:
+		val = cache->hits;
+		break;
+	case SQUASHFS_CACHE_MISSES:
+		val = cache->misses;
+		break;
+	case SQUASHFS_CACHE_SHRUNK:
+		val = cache->shrunk;
+		break;
+	}
+	spin_unlock(&cache->lock);
+
+	return sysfs_emit(buf, "%lu\n", val);
+}
+
+#define SQUASHFS_CACHE_ATTR(_cache, _name, _stat, _fragment)		\
+static struct squashfs_attr squashfs_attr_##_cache##_##_name = {	\
+	.attr = { .name = __stringify(_cache##_cache_##_name),		\
+		  .mode = 0444 },					\
+	.stat = _stat,							\
+	.fragment = _fragment,						\
+}
+
+SQUASHFS_CACHE_ATTR(metadata, entries, SQUASHFS_CACHE_ENTRIES, false);
+SQUASHFS_CACHE_ATTR(metadata, hits, SQUASHFS_CACHE_HITS, false);
+SQUASHFS_CACHE_ATTR(metadata, misses, SQUASHFS_CACHE_MISSES, false);
+SQUASHFS_CACHE_ATTR(metadata, shrunk, SQUASHFS_CACHE_SHRUNK, false);
+SQUASHFS_CACHE_ATTR(fragment, entries, SQUASHFS_CACHE_ENTRIES, true);
+SQUASHFS_CACHE_ATTR(fragment, hits, SQUASHFS_CACHE_HITS, true);
+SQUASHFS_CACHE_ATTR(fragment, misses, SQUASHFS_CACHE_MISSES, true);
+SQUASHFS_CACHE_ATTR(fragment, shrunk, SQUASHFS_CACHE_SHRUNK, true);
+
+static struct attribute *squashfs_attrs[] = {
+	&squashfs_attr_metadata_entries.attr,
+	&squashfs_attr_metadata_hits.attr,
+	&squashfs_attr_metadata_misses.attr,
+	&squashfs_attr_metadata_shrunk.attr,
+	&squashfs_attr_fragment_entries.attr,
+	&squashfs_attr_fragment_hits.attr,
+	&squashfs_attr_fragment_misses.attr,
+	&squashfs_attr_fragment_shrunk.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(squashfs);
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+
+	complete(&msblk->kobj_unregister);
+}
+
+static const struct sysfs_ops squashfs_attr_ops = {
+	.show	= squashfs_attr_show,
+};
+
+static struct kobj_type squashfs_sb_ktype = {
+	.default_groups	= squashfs_groups,
+	.sysfs_ops	= &squashfs_attr_ops,
+	.release	= squashfs_sb_release,
+};
+
+int squashfs_sysfs_register(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	init_completion(&msblk->kobj_unregister);
+	msblk->kobj.kset = squashfs_kset;
+	err = kobject_init_and_add(&msblk->kobj, &squashfs_sb_ktype, NULL,
+		"%s", sb->s_id);
+	if (err) {
+		kobject_put(&msblk->kobj);
+		wait_for_completion(&msblk->kobj_unregister);
+	}
+
+	return err;
+}
+
+void squashfs_sysfs_unregister(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	kobject_del(&msblk->kobj);
+	kobject_put(&msblk->kobj);
+	wait_for_completion(&msblk->kobj_unregister);
+}
+
+int __init squashfs_sysfs_init(void)
+{
+	squashfs_kset = kset_create_and_add("squashfs", NULL, fs_kobj);
+
+	return squashfs_kset ? 0 : -ENOMEM;
+}
+
+void squashfs_sysfs_exit(void)
+{
+	kset_unregister(squashfs_kset);
+}
@@ -9,7 +9,9 @@
 #define __LINUX_MIPI_DBI_H
 
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <drm/drm_device.h>
+#include <drm/drm_rect.h>
 #include <drm/drm_simple_kms_helper.h>
 
 struct drm_rect;
@@ -99,6 +101,41 @@ struct mipi_dbi_dev {
 	 */
 	u16 *tx_buf;
 
+	/**
+	 * @pipelined_flush: Convert the next update while the previous one
+	 *                   is still being transferred. Set by the driver
+	 *                   before mipi_dbi_dev_init(); a second transmit
+	 *                   buffer is allocated and updates are sent from
+	 *                   @flush_work, so the commit returns as soon as the
+	 *                   transfer is queued.
+	 */
+	bool pipelined_flush;
+
+	/**
+	 * @tx_bufs: The two transmit buffers used with @pipelined_flush
+	 */
+	u16 *tx_bufs[2];
+
+	/**
+	 * @tx_buf_idx: Index of the transmit buffer the next update goes to
+	 */
+	unsigned int tx_buf_idx;
+
+	/**
+	 * @flush_work: Sends @flush_buf to the area given by @flush_rect
+	 */
+	struct work_struct flush_work;
+
+	/**
+	 * @flush_buf: Transmit buffer queued on @flush_work
+	 */
+	void *flush_buf;
+
+	/**
+	 * @flush_rect: Display area queued on @flush_work
+	 */
+	struct drm_rect flush_rect;
+
 	/**
 	 * @rotation: initial rotation in degrees Counter Clock Wise
 	 */
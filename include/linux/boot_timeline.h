@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Boot timeline: when each initcall, driver probe and the root mount ran,
+ * on which CPU, exported from debugfs in the Chrome trace event format.
+ */
+
+#ifndef _LINUX_BOOT_TIMELINE_H
+#define _LINUX_BOOT_TIMELINE_H
+
+#include <linux/compiler.h>
+#include <linux/types.h>
+
+#ifdef CONFIG_BOOT_TIMELINE
+u64 boot_timeline_begin(void);
+__printf(3, 4)
+void boot_timeline_end(u64 start, const char *cat, const char *fmt, ...);
+#else
+static inline u64 boot_timeline_begin(void)
+{
+	return 0;
+}
+
+static inline __printf(3, 4)
+void boot_timeline_end(u64 start, const char *cat, const char *fmt, ...)
+{
+}
+#endif
+
+#endif /* _LINUX_BOOT_TIMELINE_H */
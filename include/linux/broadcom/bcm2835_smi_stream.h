@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Broadcom Secondary Memory Interface - continuous streaming
+ *
+ * A stream keeps a cyclic DMA transfer running between the SMI data FIFO
+ * and a ring buffer owned by the SMI driver, so a client can move data
+ * without copying it and without gaps between blocks.  The ring can be
+ * mapped into user space with bcm2835_smi_stream_mmap() and its current
+ * position read with bcm2835_smi_stream_pointer().
+ *
+ * While a stream is running, the other SMI transfer functions are
+ * refused.
+ */
+
+#ifndef BCM2835_SMI_STREAM_H
+#define BCM2835_SMI_STREAM_H
+
+#include <linux/dmaengine.h>
+#include <linux/types.h>
+
+struct bcm2835_smi_instance;
+struct vm_area_struct;
+
+int bcm2835_smi_stream_alloc(struct bcm2835_smi_instance *inst, size_t size);
+void bcm2835_smi_stream_free(struct bcm2835_smi_instance *inst);
+void *bcm2835_smi_stream_buffer(struct bcm2835_smi_instance *inst);
+int bcm2835_smi_stream_mmap(struct bcm2835_smi_instance *inst,
+			    struct vm_area_struct *vma);
+
+int bcm2835_smi_stream_start(struct bcm2835_smi_instance *inst,
+			     enum dma_transfer_direction dir,
+			     size_t period_size,
+			     void (*callback)(void *param), void *param);
+void bcm2835_smi_stream_stop(struct bcm2835_smi_instance *inst);
+ssize_t bcm2835_smi_stream_pointer(struct bcm2835_smi_instance *inst,
+				   u64 *periods);
+
+#endif /* BCM2835_SMI_STREAM_H */
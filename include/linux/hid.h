@@ -480,6 +480,7 @@ struct hid_field {
 	__s32     unit_exponent;
 	unsigned  unit;
 	bool      ignored;		/* this field is ignored in this event */
+	bool      aligned;		/* byte aligned 8, 16 or 32 bit values */
 	struct hid_report *report;	/* associated report */
 	unsigned index;			/* index into report->field[] */
 	/* hidinput data */
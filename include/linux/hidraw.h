@@ -32,6 +32,12 @@ struct hidraw_list {
 	struct hidraw *hidraw;
 	struct list_head node;
 	struct mutex read_mutex;
+	/* the kernel's copy, the mapping may be scribbled on */
+	struct hidraw_ring *ring;
+	size_t ring_size;
+	u32 ring_slots;
+	u32 ring_slot_size;
+	u32 ring_head;
 };
 
 #ifdef CONFIG_HIDRAW
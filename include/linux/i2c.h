@@ -18,6 +18,7 @@
 #include <linux/mutex.h>
 #include <linux/regulator/consumer.h>
 #include <linux/rtmutex.h>
+#include <linux/workqueue.h>
 #include <linux/irqdomain.h>		/* for Host Notify IRQ */
 #include <linux/of.h>		/* for struct device_node */
 #include <linux/swab.h>		/* for swab16 */
@@ -132,6 +133,28 @@ int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
 /* Unlocked flavor */
 int __i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
 
+/**
+ * struct i2c_async_transfer - a combined I2C message queued for later
+ * @msgs: messages to execute, must stay valid until @complete is called
+ * @num: number of messages
+ * @complete: called in process context once the transfer has been done
+ * @context: for use by the owner of the transfer
+ * @status: negative errno, else the number of messages executed
+ * @queue: owned by the I2C core while the transfer is queued
+ */
+struct i2c_async_transfer {
+	struct i2c_msg *msgs;
+	int num;
+	void (*complete)(struct i2c_async_transfer *xfer);
+	void *context;
+	int status;
+	struct list_head queue;
+};
+
+/* Queue a transfer, @xfer->complete is called when it is done */
+int i2c_transfer_async(struct i2c_adapter *adap,
+		       struct i2c_async_transfer *xfer);
+
 /* This is the very generalized SMBus access routine. You probably do not
    want to use this, though; one of the functions below may be much easier,
    and probably just as fast.
@@ -748,6 +771,11 @@ struct i2c_adapter {
 
 	struct irq_domain *host_notify_domain;
 	struct regulator *bus_regulator;
+
+	/* queue of i2c_transfer_async() transfers, owned by the I2C core */
+	spinlock_t async_lock;
+	struct list_head async_queue;
+	struct work_struct async_work;
 };
 #define to_i2c_adapter(d) container_of(d, struct i2c_adapter, dev)
 
@@ -52,6 +52,11 @@ struct matrix_keymap_data {
  * @no_autorepeat: disable key autorepeat
  * @drive_inactive_cols: drive inactive columns during scan, rather than
  *	making them inputs.
+ * @velocity_max_us: if set, each key is a velocity sensing pad with a
+ *	contact on an even row and a second one on the next row. The time
+ *	between the two contacts is reported as ABS_PRESSURE, this one gets
+ *	the lowest velocity.
+ * @velocity_scan_us: scan interval while a pad is between its contacts
  *
  * This structure represents platform-specific data that use used by
  * matrix_keypad driver to perform proper initialization.
@@ -77,6 +82,9 @@ struct matrix_keypad_platform_data {
 	bool		wakeup;
 	bool		no_autorepeat;
 	bool		drive_inactive_cols;
+
+	unsigned int	velocity_max_us;
+	unsigned int	velocity_scan_us;
 };
 
 int matrix_keypad_build_keymap(const struct matrix_keymap_data *keymap_data,
@@ -427,6 +427,20 @@ irq_calc_affinity_vectors(unsigned int minvec, unsigned int maxvec,
 
 #endif /* CONFIG_SMP */
 
+/*
+ * Device classes for irq_set_latency_class(), most latency sensitive
+ * first. See kernel/irq/profile.c.
+ */
+enum irq_latency_class {
+	IRQ_LATENCY_AUDIO,
+	IRQ_LATENCY_USB,
+	IRQ_LATENCY_STORAGE,
+	IRQ_LATENCY_NR_CLASSES,
+};
+
+extern int irq_set_latency_class(unsigned int irq,
+				 enum irq_latency_class class);
+
 /*
  * Special lockdep variants of irq disabling/enabling.
  * These should be used for locking constructs that
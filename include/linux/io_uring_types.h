@@ -310,6 +310,8 @@ struct io_ring_ctx {
 		struct list_head	timeout_list;
 		struct list_head	ltimeout_list;
 		unsigned		cq_last_tm_flush;
+		/* for IORING_TIMEOUT_REFCLOCK, also under ->timeout_lock */
+		struct io_uring_ref_clock ref_clock;
 	} ____cacheline_aligned_in_smp;
 
 	/* Keep this last, we don't need it for the fast path */
@@ -353,6 +355,8 @@ struct io_ring_ctx {
 
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
+	unsigned			sq_thread_rt_prio;
+	unsigned			sq_thread_budget;
 	/* protected by ->completion_lock */
 	unsigned			evfd_last_cq_tail;
 };
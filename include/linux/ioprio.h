@@ -64,11 +64,17 @@ extern int set_task_ioprio(struct task_struct *task, int ioprio);
 
 #ifdef CONFIG_BLOCK
 extern int ioprio_check_cap(int ioprio);
+extern int ioprio_check_io_cap(int ioprio);
 #else
 static inline int ioprio_check_cap(int ioprio)
 {
 	return -ENOTBLK;
 }
+
+static inline int ioprio_check_io_cap(int ioprio)
+{
+	return -ENOTBLK;
+}
 #endif /* CONFIG_BLOCK */
 
 #endif
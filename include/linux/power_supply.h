@@ -213,6 +213,7 @@ enum power_supply_charge_behaviour {
 
 enum power_supply_notifier_events {
 	PSY_EVENT_PROP_CHANGED,
+	PSY_EVENT_POWER_FAIL,
 };
 
 union power_supply_propval {
@@ -812,6 +813,7 @@ power_supply_get_maintenance_charging_setting(struct power_supply_battery_info *
 extern bool power_supply_battery_bti_in_range(struct power_supply_battery_info *info,
 					      int resistance);
 extern void power_supply_changed(struct power_supply *psy);
+extern void power_supply_power_fail(struct power_supply *psy);
 extern int power_supply_am_i_supplied(struct power_supply *psy);
 int power_supply_get_property_from_supplier(struct power_supply *psy,
 					    enum power_supply_property psp,
@@ -44,6 +44,9 @@ enum psi_res {
 	PSI_CPU,
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
 	PSI_IRQ,
+#endif
+#ifdef CONFIG_PSI_RT
+	PSI_RT,
 #endif
 	NR_PSI_RESOURCES,
 };
@@ -63,6 +66,10 @@ enum psi_states {
 	PSI_CPU_FULL,
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
 	PSI_IRQ_FULL,
+#endif
+#ifdef CONFIG_PSI_RT
+	/* Realtime tasks waited to run for longer than the threshold */
+	PSI_RT_SOME,
 #endif
 	/* Only per-CPU, to weigh the CPU in the global average: */
 	PSI_NONIDLE,
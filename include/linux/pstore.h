@@ -38,6 +38,7 @@ enum pstore_type_id {
 	PSTORE_TYPE_PPC_COMMON	= 6,
 	PSTORE_TYPE_PMSG	= 7,
 	PSTORE_TYPE_PPC_OPAL	= 8,
+	PSTORE_TYPE_RTEVENT	= 9,
 
 	/* End of the list */
 	PSTORE_TYPE_MAX
@@ -206,6 +207,7 @@ struct pstore_info {
 #define PSTORE_FLAGS_CONSOLE	BIT(1)
 #define PSTORE_FLAGS_FTRACE	BIT(2)
 #define PSTORE_FLAGS_PMSG	BIT(3)
+#define PSTORE_FLAGS_RTEVENT	BIT(4)
 
 extern int pstore_register(struct pstore_info *);
 extern void pstore_unregister(struct pstore_info *);
@@ -286,4 +288,31 @@ pstore_ftrace_write_timestamp(struct pstore_ftrace_record *rec, u64 val)
 }
 #endif
 
+/*
+ * Realtime event records, written in batches by the rtevent front end. The
+ * layout is what backends store, so it is kind of an ABI too.
+ */
+enum pstore_rtevent_type {
+	PSTORE_RTEVENT_DROPPED	= 0,	/* arg[0]: events lost while staged */
+	PSTORE_RTEVENT_PCM_XRUN	= 1,	/* arg[0]: card, device, sub, stream */
+					/* arg[1]: enum snd_pcm_xrun_cause */
+	PSTORE_RTEVENT_MAX
+};
+
+struct pstore_rtevent_record {
+	u64 time;		/* CLOCK_REALTIME, in ns */
+	u32 seq;
+	u16 cpu;
+	u16 type;
+	u32 arg[2];
+};
+
+#if IS_ENABLED(CONFIG_PSTORE_RTEVENT) && IS_REACHABLE(CONFIG_PSTORE)
+void pstore_rtevent(u16 type, u32 arg0, u32 arg1);
+#else
+static inline void pstore_rtevent(u16 type, u32 arg0, u32 arg1)
+{
+}
+#endif
+
 #endif /*_LINUX_PSTORE_H*/
@@ -258,12 +258,30 @@ struct pwm_capture {
 	unsigned int duty_cycle;
 };
 
+/**
+ * struct pwm_stream - PWM duty cycle stream
+ * @period: period of each PWM cycle (in nanoseconds)
+ * @duty_cycle: duty cycles (in nanoseconds), one per PWM period
+ * @count: number of entries in @duty_cycle
+ *
+ * The duty cycles are replayed by the hardware in a loop, one entry per
+ * period, until the stream is stopped.
+ */
+struct pwm_stream {
+	u64 period;
+	const u64 *duty_cycle;
+	unsigned int count;
+};
+
 /**
  * struct pwm_ops - PWM controller operations
  * @request: optional hook for requesting a PWM
  * @free: optional hook for freeing a PWM
  * @capture: capture and report PWM signal
  * @apply: atomically apply a new PWM config
+ * @stream_start: optional hook for starting a duty cycle stream
+ * @stream_stop: optional hook for stopping a duty cycle stream, leaving
+ *		 the PWM disabled. Returns whether a stream was stopped
  * @get_state: get the current PWM state. This function is only
  *	       called once per PWM device when the PWM chip is
  *	       registered.
@@ -278,6 +296,9 @@ struct pwm_ops {
 		     const struct pwm_state *state);
 	int (*get_state)(struct pwm_chip *chip, struct pwm_device *pwm,
 			 struct pwm_state *state);
+	int (*stream_start)(struct pwm_chip *chip, struct pwm_device *pwm,
+			    const struct pwm_stream *stream);
+	bool (*stream_stop)(struct pwm_chip *chip, struct pwm_device *pwm);
 	struct module *owner;
 };
 
@@ -385,6 +406,8 @@ static inline void pwm_disable(struct pwm_device *pwm)
 /* PWM provider APIs */
 int pwm_capture(struct pwm_device *pwm, struct pwm_capture *result,
 		unsigned long timeout);
+int pwm_stream_start(struct pwm_device *pwm, const struct pwm_stream *stream);
+void pwm_stream_stop(struct pwm_device *pwm);
 int pwm_set_chip_data(struct pwm_device *pwm, void *data);
 void *pwm_get_chip_data(struct pwm_device *pwm);
 
@@ -447,6 +470,16 @@ static inline int pwm_capture(struct pwm_device *pwm,
 	return -EINVAL;
 }
 
+static inline int pwm_stream_start(struct pwm_device *pwm,
+				   const struct pwm_stream *stream)
+{
+	return -EINVAL;
+}
+
+static inline void pwm_stream_stop(struct pwm_device *pwm)
+{
+}
+
 static inline int pwm_enable(struct pwm_device *pwm)
 {
 	might_sleep();
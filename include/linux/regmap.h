@@ -43,6 +43,7 @@ enum regcache_type {
 	REGCACHE_RBTREE,
 	REGCACHE_COMPRESSED,
 	REGCACHE_FLAT,
+	REGCACHE_MAPLE,
 };
 
 /**
@@ -27,11 +27,22 @@ struct da_monitor {
 #define RV_PER_TASK_MONITORS		1
 #define RV_PER_TASK_MONITOR_INIT	(RV_PER_TASK_MONITORS)
 
+/*
+ * Deterministic automaton that also keeps the time of the last event
+ * that started a timed section, for monitors checking a time budget.
+ * Starts with a da_monitor, so the da_mon member aliases it.
+ */
+struct da_timed_monitor {
+	struct da_monitor	da_mon;
+	u64			timestamp;
+};
+
 /*
  * Futher monitor types are expected, so make this a union.
  */
 union rv_task_monitor {
-	struct da_monitor da_mon;
+	struct da_monitor	da_mon;
+	struct da_timed_monitor	da_timed_mon;
 };
 
 #ifdef CONFIG_RV_REACTORS
@@ -390,6 +390,50 @@ struct sched_info {
 #endif /* CONFIG_SCHED_INFO */
 };
 
+enum sched_interruption_type {
+	SCHED_INTR_IRQ,
+	SCHED_INTR_SOFTIRQ,
+	SCHED_INTR_PREEMPT,
+	SCHED_INTR_MIGRATE,
+};
+
+#define SCHED_INTERRUPTIONS_TOP		8
+#define SCHED_IDLE_STATES		4
+
+struct sched_idle_state {
+	/* How often, and after how long, a CPU left this state for us: */
+	u64				count;
+	u64				residency;
+};
+
+struct sched_interruption {
+	/* sched_clock_cpu() when it started, and its length, in ns: */
+	u64				start;
+	u64				duration;
+	enum sched_interruption_type	type;
+	int				cpu;
+};
+
+struct sched_interruptions {
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+	seqcount_t			seq;
+
+	/* When and where were we last preempted? */
+	u64				preempted_at;
+	int				preempted_cpu;
+
+	/* The longest ones, unsorted: */
+	struct sched_interruption	top[SCHED_INTERRUPTIONS_TOP];
+
+	/* By cpuidle state index, the deeper ones in the last: */
+	struct sched_idle_state		idle[SCHED_IDLE_STATES];
+
+	/* Page faults in a realtime policy, and the count when it began: */
+	unsigned long			rt_flt;
+	unsigned long			rt_flt_start;
+#endif /* CONFIG_SCHED_INTERRUPTION_STATS */
+};
+
 /*
  * Integer metrics need fixed point arithmetic, e.g., sched/fair
  * has a few: load, load_avg, util_avg, freq, and capacity.
@@ -587,6 +631,10 @@ struct sched_rt_entity {
 	unsigned int			time_slice;
 	unsigned short			on_rq;
 	unsigned short			on_list;
+#ifdef CONFIG_SMP
+	/* # of times kept on its CPU by SCHED_FLAG_RT_STICKY: */
+	unsigned long			nr_sticky_stays;
+#endif
 
 	struct sched_rt_entity		*back;
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -598,6 +646,10 @@ struct sched_rt_entity {
 #endif
 } __randomize_layout;
 
+struct sched_dl_entity;
+typedef bool (*dl_server_has_tasks_f)(struct sched_dl_entity *);
+typedef struct task_struct *(*dl_server_pick_f)(struct sched_dl_entity *);
+
 struct sched_dl_entity {
 	struct rb_node			rb_node;
 
@@ -646,6 +698,18 @@ struct sched_dl_entity {
 	unsigned int			dl_non_contending : 1;
 	unsigned int			dl_overrun	  : 1;
 
+	/*
+	 * A deadline server runs the tasks of a lower class instead of a
+	 * task of its own, see kernel/sched/deadline.c.
+	 *
+	 * @dl_server_active tells if it has tasks it may have to run, and
+	 * @dl_defer_running if they are starved and it now competes with
+	 * the other -deadline entities to run them.
+	 */
+	unsigned int			dl_server        : 1;
+	unsigned int			dl_server_active : 1;
+	unsigned int			dl_defer_running : 1;
+
 	/*
 	 * Bandwidth enforcement timer. Each -deadline task has its
 	 * own bandwidth to be enforced, thus we need one timer per task.
@@ -669,6 +733,11 @@ struct sched_dl_entity {
 	 */
 	struct sched_dl_entity *pi_se;
 #endif
+
+	/* For deadline servers only: */
+	struct rq			*rq;
+	dl_server_has_tasks_f		server_has_tasks;
+	dl_server_pick_f		server_pick;
 };
 
 #ifdef CONFIG_UCLAMP_TASK
@@ -860,6 +929,7 @@ struct task_struct {
 #endif /* #ifdef CONFIG_TASKS_TRACE_RCU */
 
 	struct sched_info		sched_info;
+	struct sched_interruptions	sched_interruptions;
 
 	struct list_head		tasks;
 #ifdef CONFIG_SMP
@@ -886,6 +956,8 @@ struct task_struct {
 
 	/* Scheduler bits, serialized by scheduler locks: */
 	unsigned			sched_reset_on_fork:1;
+	unsigned			sched_latency_critical:1;
+	unsigned			sched_rt_sticky:1;
 	unsigned			sched_contributes_to_load:1;
 	unsigned			sched_migrated:1;
 #ifdef CONFIG_PSI
@@ -42,6 +42,15 @@ extern void proc_sched_show_task(struct task_struct *p,
 extern void proc_sched_set_task(struct task_struct *p);
 #endif
 
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+struct seq_file;
+extern void proc_sched_interruptions_show(struct task_struct *p,
+					  struct seq_file *m);
+extern void proc_sched_idle_states_show(struct task_struct *p,
+					struct seq_file *m);
+extern unsigned long task_rt_faults(struct task_struct *p);
+#endif
+
 /* Attach to any functions which should be ignored in wchan output. */
 #define __sched		__section(".sched.text")
 
@@ -439,6 +439,10 @@ extern struct spi_device *spi_new_ancillary_device(struct spi_device *spi, u8 ch
  *	     controller has native support for memory like operations.
  * @mem_caps: controller capabilities for the handling of memory operations.
  * @unprepare_message: undo any work done by prepare_message().
+ * @optimize_message: optional hook to do one-time setup for a message that
+ *	a peripheral driver submits repeatedly, see spi_optimize_message().
+ *	May store its state in @opt_state of the message.
+ * @unoptimize_message: release any resources set up by optimize_message().
  * @slave_abort: abort the ongoing transfer request on an SPI slave controller
  * @cs_gpiods: Array of GPIO descs to use as chip select lines; one per CS
  *	number. Any individual value may be NULL for CS lines that
@@ -649,6 +653,8 @@ struct spi_controller {
 			       struct spi_message *message);
 	int (*unprepare_message)(struct spi_controller *ctlr,
 				 struct spi_message *message);
+	int (*optimize_message)(struct spi_message *msg);
+	int (*unoptimize_message)(struct spi_message *msg);
 	int (*slave_abort)(struct spi_controller *ctlr);
 
 	/*
@@ -1007,6 +1013,8 @@ struct spi_transfer {
  * @state: for use by whichever driver currently owns the message
  * @resources: for resource management when the spi message is processed
  * @prepared: spi_prepare_message was called for the this message
+ * @optimized: spi_optimize_message() was called for this message
+ * @opt_state: for use by the controller driver while the message is optimized
  *
  * A @spi_message is used to execute an atomic sequence of data transfers,
  * each represented by a struct spi_transfer.  The sequence is "atomic"
@@ -1059,6 +1067,10 @@ struct spi_message {
 
 	/* spi_prepare_message() was called for this message */
 	bool			prepared;
+
+	/* spi_optimize_message() was called for this message */
+	bool			optimized;
+	void			*opt_state;
 };
 
 static inline void spi_message_init_no_memset(struct spi_message *m)
@@ -1140,6 +1152,9 @@ static inline void spi_message_free(struct spi_message *m)
 
 extern int spi_setup(struct spi_device *spi);
 extern int spi_async(struct spi_device *spi, struct spi_message *message);
+extern int spi_optimize_message(struct spi_device *spi,
+				struct spi_message *msg);
+extern void spi_unoptimize_message(struct spi_message *msg);
 extern int spi_slave_abort(struct spi_device *spi);
 
 static inline size_t
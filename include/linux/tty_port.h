@@ -135,6 +135,8 @@ struct tty_port {
 #define TTY_PORT_CHECK_CD	4	/* carrier detect enabled */
 #define TTY_PORT_KOPENED	5	/* device exclusively opened by
 					   kernel */
+#define TTY_PORT_LOW_LATENCY	6	/* push to the ldisc from a high
+					   priority worker */
 
 void tty_port_init(struct tty_port *port);
 void tty_port_link_device(struct tty_port *port, struct tty_driver *driver,
@@ -228,6 +230,16 @@ static inline void tty_port_set_kopened(struct tty_port *port, bool val)
 	assign_bit(TTY_PORT_KOPENED, &port->iflags, val);
 }
 
+static inline bool tty_port_low_latency(const struct tty_port *port)
+{
+	return test_bit(TTY_PORT_LOW_LATENCY, &port->iflags);
+}
+
+static inline void tty_port_set_low_latency(struct tty_port *port, bool val)
+{
+	assign_bit(TTY_PORT_LOW_LATENCY, &port->iflags, val);
+}
+
 struct tty_struct *tty_port_tty_get(struct tty_port *port);
 void tty_port_tty_set(struct tty_port *port, struct tty_struct *tty);
 int tty_port_carrier_raised(struct tty_port *port);
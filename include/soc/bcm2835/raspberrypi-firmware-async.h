@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Queued Raspberry Pi firmware property requests
+ *
+ * A request is allocated once, with its DMA buffer, and can then be
+ * submitted from any context, including with interrupts disabled. The
+ * firmware driver queues it behind the other property transactions and
+ * calls its completion callback from the mailbox interrupt once the
+ * firmware has answered.
+ */
+
+#ifndef __SOC_RASPBERRY_FIRMWARE_ASYNC_H__
+#define __SOC_RASPBERRY_FIRMWARE_ASYNC_H__
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+struct rpi_firmware;
+struct rpi_firmware_request;
+
+/*
+ * Called in atomic context. status is 0 or a negative error code; the
+ * firmware's answer is in rpi_firmware_request_data(). The request may
+ * be submitted again from here.
+ */
+typedef void (*rpi_firmware_complete_t)(struct rpi_firmware_request *req,
+					int status, void *ctx);
+
+#if IS_ENABLED(CONFIG_RASPBERRYPI_FIRMWARE)
+struct rpi_firmware_request *
+rpi_firmware_request_alloc(struct rpi_firmware *fw, u32 tag, size_t buf_size,
+			   rpi_firmware_complete_t complete, void *ctx);
+void rpi_firmware_request_free(struct rpi_firmware_request *req);
+void *rpi_firmware_request_data(struct rpi_firmware_request *req);
+int rpi_firmware_request_submit(struct rpi_firmware_request *req);
+#else
+static inline struct rpi_firmware_request *
+rpi_firmware_request_alloc(struct rpi_firmware *fw, u32 tag, size_t buf_size,
+			   rpi_firmware_complete_t complete, void *ctx)
+{
+	return NULL;
+}
+
+static inline void rpi_firmware_request_free(struct rpi_firmware_request *req)
+{
+}
+
+static inline void *rpi_firmware_request_data(struct rpi_firmware_request *req)
+{
+	return NULL;
+}
+
+static inline int rpi_firmware_request_submit(struct rpi_firmware_request *req)
+{
+	return -ENOTSUPP;
+}
+#endif
+
+#endif /* __SOC_RASPBERRY_FIRMWARE_ASYNC_H__ */
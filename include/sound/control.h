@@ -9,7 +9,10 @@
 
 #include <linux/wait.h>
 #include <linux/nospec.h>
+#include <linux/hashtable.h>
+#include <linux/hrtimer.h>
 #include <sound/asound.h>
+#include <uapi/sound/control.h>
 
 #define snd_kcontrol_chip(kcontrol) ((kcontrol)->private_data)
 
@@ -88,6 +91,7 @@ struct snd_kcontrol {
 
 struct snd_kctl_event {
 	struct list_head list;	/* list of events */
+	struct hlist_node hnode;	/* in the numid hash of the file */
 	struct snd_ctl_elem_id id;
 	unsigned int mask;
 };
@@ -112,6 +116,9 @@ struct snd_ctl_file {
 	struct snd_fasync *fasync;
 	int subscribed;			/* read interface is activated */
 	struct list_head events;	/* waiting events for read */
+	DECLARE_HASHTABLE(events_hash, 6);	/* the same, by numid */
+	ktime_t last_wakeup;		/* of the reader, for the rate cap */
+	struct hrtimer wakeup_timer;	/* deferred wakeup of the reader */
 };
 
 struct snd_ctl_layer_ops {
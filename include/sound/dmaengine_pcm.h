@@ -55,6 +55,15 @@ struct dma_chan *snd_dmaengine_pcm_get_chan(struct snd_pcm_substream *substream)
  */
 #define SND_DMAENGINE_PCM_DAI_FLAG_PACK BIT(0)
 
+/*
+ * The PCM can run without period interrupts if this flag is set and the
+ * DMA channel reports its residue with burst granularity, so that the
+ * position is always accurate. SNDRV_PCM_INFO_NO_PERIOD_WAKEUP is then
+ * advertised and the cyclic transfer is prepared without interrupts when
+ * user space asks for it.
+ */
+#define SND_DMAENGINE_PCM_DAI_FLAG_NO_PERIOD_WAKEUP BIT(1)
+
 /**
  * struct snd_dmaengine_dai_dma_data - DAI DMA configuration data
  * @addr: Address of the DAI data source or destination register.
@@ -66,7 +75,7 @@ struct dma_chan *snd_dmaengine_pcm_get_chan(struct snd_pcm_substream *substream)
  * requesting the DMA channel.
  * @chan_name: Custom channel name to use when requesting DMA channel.
  * @fifo_size: FIFO size of the DAI controller in bytes
- * @flags: PCM_DAI flags, only SND_DMAENGINE_PCM_DAI_FLAG_PACK for now
+ * @flags: PCM_DAI flags, SND_DMAENGINE_PCM_DAI_FLAG_*
  * @peripheral_config: peripheral configuration for programming peripheral
  * for dmaengine transfer
  * @peripheral_size: peripheral configuration buffer size
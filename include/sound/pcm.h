@@ -9,6 +9,7 @@
  */
 
 #include <sound/asound.h>
+#include <uapi/sound/pcm.h>
 #include <sound/memalloc.h>
 #include <sound/minors.h>
 #include <linux/poll.h>
@@ -344,6 +345,39 @@ static inline void snd_pcm_pack_audio_tstamp_report(__u32 *data, __u32 *accuracy
 }
 
 
+/* causes of an xrun, for the latency statistics */
+enum {
+	SND_PCM_XRUN_AVAIL,		/* avail reached stop_threshold */
+	SND_PCM_XRUN_POINTER,		/* pointer callback reported an xrun */
+	SND_PCM_XRUN_ACK,		/* ack callback failed */
+	SND_PCM_XRUN_DRIVER,		/* snd_pcm_stop_xrun() */
+	SND_PCM_XRUN_USER,		/* SNDRV_PCM_IOCTL_XRUN */
+	SND_PCM_XRUN_CAUSES
+};
+
+#ifdef CONFIG_SND_PCM_LATENCY_STATS
+/* log2 histogram in usecs: <1, <2, <4, ... <16384, >=16384 */
+#define SND_PCM_LAT_BUCKETS	16
+
+struct snd_pcm_lat_hist {
+	u32 count[SND_PCM_LAT_BUCKETS];
+	u64 max_ns;
+};
+
+struct snd_pcm_latency_stats {
+	struct snd_pcm_lat_hist wakeup;	/* period irq -> appl_ptr update */
+	struct snd_pcm_lat_hist jitter;	/* period irq interval error */
+	struct snd_pcm_lat_hist poll;	/* time spent waiting in poll */
+	u32 xruns[SND_PCM_XRUN_CAUSES];
+	u64 xrun_appl_age_ns;		/* appl_ptr age at the last xrun */
+	/* bookkeeping */
+	u64 irq_ns;			/* time of the last period irq */
+	u64 poll_ns;			/* start of the current poll wait */
+	u64 appl_ns;			/* time of the last appl_ptr update */
+	bool wakeup_pending;		/* irq not yet followed by appl update */
+};
+#endif
+
 struct snd_pcm_runtime {
 	/* -- Status -- */
 	snd_pcm_state_t state;		/* stream state */
@@ -359,6 +393,8 @@ struct snd_pcm_runtime {
 	unsigned long hw_ptr_buffer_jiffies; /* buffer time in jiffies */
 	snd_pcm_sframes_t delay;	/* extra delay; typically FIFO size */
 	u64 hw_ptr_wrap;                /* offset for hw_ptr due to boundary wrap-around */
+	u64 drift_base_frames;		/* frames played at the last (re)start */
+	struct timespec64 drift_base_tstamp; /* trigger time of the last (re)start */
 
 	/* -- HW params -- */
 	snd_pcm_access_t access;	/* access mode */
@@ -396,6 +432,13 @@ struct snd_pcm_runtime {
 	/* -- mmap -- */
 	struct snd_pcm_mmap_status *status;
 	struct snd_pcm_mmap_control *control;
+	struct snd_pcm_mmap_status_ext *status_ext;
+	bool status_ext_mapped;		/* refresh status_ext */
+	u64 xrun_count;			/* xruns since open */
+	u64 period_irq_count;		/* period updates since open */
+#ifdef CONFIG_SND_PCM_LATENCY_STATS
+	struct snd_pcm_latency_stats lat;
+#endif
 
 	/* -- locking / scheduling -- */
 	snd_pcm_uframes_t twake; 	/* do transfer (!poll) wakeup if non-zero */
@@ -457,6 +500,7 @@ struct snd_pcm_substream {
 	size_t buffer_bytes_max;	/* limit ring buffer size */
 	struct snd_dma_buffer dma_buffer;
 	size_t dma_max;
+	unsigned long dma_alloc_misses;	/* buffers allocated at hw_params */
 	/* -- hardware operations -- */
 	const struct snd_pcm_ops *ops;
 	/* -- runtime information -- */
@@ -487,6 +531,7 @@ struct snd_pcm_substream {
 	/* misc flags */
 	unsigned int hw_opened: 1;
 	unsigned int managed_buffer_alloc:1;
+	unsigned int dma_buffer_kept:1;	/* dma_buffer kept from hw_params */
 };
 
 #define SUBSTREAM_BUSY(substream) ((substream)->ref_count > 0)
@@ -697,6 +742,7 @@ static inline void __snd_pcm_set_state(struct snd_pcm_runtime *runtime,
 {
 	runtime->state = state;
 	runtime->status->state = state; /* copy for mmap */
+	WRITE_ONCE(runtime->status_ext->state, state);
 }
 
 /**
@@ -1130,6 +1176,9 @@ int snd_pcm_format_physical_width(snd_pcm_format_t format);		/* in bits */
 ssize_t snd_pcm_format_size(snd_pcm_format_t format, size_t samples);
 const unsigned char *snd_pcm_format_silence_64(snd_pcm_format_t format);
 int snd_pcm_format_set_silence(snd_pcm_format_t format, void *buf, unsigned int frames);
+void snd_pcm_dsd_bitrev(u8 *dst, const u8 *src, size_t bytes);
+u8 snd_pcm_dsd_dop_encode(u8 *dst, const u8 *src, unsigned int frames,
+			  unsigned int channels, u8 marker, bool bitrev);
 
 void snd_pcm_set_ops(struct snd_pcm * pcm, int direction,
 		     const struct snd_pcm_ops *ops);
@@ -8,7 +8,9 @@
  */
 
 #include <sound/asound.h>
+#include <uapi/sound/rawmidi.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/mutex.h>
@@ -52,7 +54,8 @@ struct snd_rawmidi_global_ops {
 struct snd_rawmidi_runtime {
 	struct snd_rawmidi_substream *substream;
 	unsigned int drain: 1,	/* drain stage */
-		     oss: 1;	/* OSS compatible mode */
+		     oss: 1,	/* OSS compatible mode */
+		     mmap: 1;	/* buffer shared with user-space */
 	/* midi stream buffer */
 	unsigned char *buffer;	/* buffer for MIDI data */
 	size_t buffer_size;	/* size of buffer */
@@ -62,6 +65,17 @@ struct snd_rawmidi_runtime {
 	size_t avail;		/* max used buffer for wakeup */
 	size_t xruns;		/* over/underruns counter */
 	int buffer_ref;		/* buffer reference count */
+	/* mmap mode */
+	struct snd_rawmidi_mmap_status *mmap_status;
+	u32 mmap_hw_ptr;	/* free-running hw_ptr published to user-space */
+	u32 mmap_appl_ptr;	/* last appl_ptr consumed from user-space */
+	atomic_t mmap_count;	/* number of active mappings */
+	/* scheduled output (tstamp framing) */
+	struct snd_rawmidi_framing_tstamp *sched_queue;
+	unsigned int sched_size;	/* queue size in frames */
+	unsigned int sched_head;	/* next frame to release */
+	unsigned int sched_count;	/* number of queued frames */
+	struct hrtimer sched_timer;
 	/* misc */
 	wait_queue_head_t sleep;
 	/* event handler (new bytes, input only) */
@@ -150,6 +164,9 @@ void snd_rawmidi_set_ops(struct snd_rawmidi *rmidi, int stream,
 
 int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 			const unsigned char *buffer, int count);
+int snd_rawmidi_receive_tstamp(struct snd_rawmidi_substream *substream,
+			       const unsigned char *buffer, int count,
+			       ktime_t tstamp);
 int snd_rawmidi_transmit_empty(struct snd_rawmidi_substream *substream);
 int snd_rawmidi_transmit_peek(struct snd_rawmidi_substream *substream,
 			      unsigned char *buffer, int count);
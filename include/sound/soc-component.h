@@ -20,6 +20,9 @@
 #define SND_SOC_COMP_ORDER_LATE		 1
 #define SND_SOC_COMP_ORDER_LAST		 2
 
+/* pending registers before deferred control writes are flushed early */
+#define SND_SOC_COMPONENT_MAX_DEFERRED	16
+
 #define for_each_comp_order(order)		\
 	for (order  = SND_SOC_COMP_ORDER_FIRST;	\
 	     order <= SND_SOC_COMP_ORDER_LAST;	\
@@ -180,6 +183,12 @@ struct snd_soc_component_driver {
 	 */
 	unsigned int endianness:1;
 	unsigned int legacy_dai_naming:1;
+	/*
+	 * Batch register updates from user controls and write them out at a
+	 * bounded rate, see snd_soc_component_update_bits_deferred().  Only
+	 * used with regmap.
+	 */
+	unsigned int defer_control_writes:1;
 
 	/* this component uses topology and ignore machine driver FEs */
 	const char *ignore_machine;
@@ -219,6 +228,12 @@ struct snd_soc_component {
 
 	struct mutex io_mutex;
 
+	/* control updates waiting to be written, protected by io_mutex */
+	struct reg_sequence *deferred;
+	int num_deferred;
+	unsigned long deferred_flush_time;
+	struct delayed_work deferred_work;
+
 	/* attached dynamic objects */
 	struct list_head dobj_list;
 
@@ -365,6 +380,12 @@ int snd_soc_component_update_bits_async(struct snd_soc_component *component,
 					unsigned int reg, unsigned int mask,
 					unsigned int val);
 void snd_soc_component_async_complete(struct snd_soc_component *component);
+int snd_soc_component_update_bits_deferred(struct snd_soc_component *component,
+					   unsigned int reg, unsigned int mask,
+					   unsigned int val);
+int snd_soc_component_flush_deferred(struct snd_soc_component *component);
+void snd_soc_component_init_deferred(struct snd_soc_component *component);
+void snd_soc_component_cleanup_deferred(struct snd_soc_component *component);
 int snd_soc_component_test_bits(struct snd_soc_component *component,
 				unsigned int reg, unsigned int mask,
 				unsigned int value);
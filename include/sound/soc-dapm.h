@@ -703,6 +703,12 @@ struct snd_soc_dapm_context {
 	struct snd_soc_dapm_wcache path_sink_cache;
 	struct snd_soc_dapm_wcache path_source_cache;
 
+	/* sequence step waiting to be applied, see parallel_dapm */
+	struct list_head seq_pending;
+	const int *seq_order;
+	int seq_sort;
+	int seq_subseq;
+
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_dapm;
 #endif
@@ -105,6 +105,9 @@ struct snd_soc_dpcm_runtime {
 	int be_start; /* refcount protected by BE stream pcm lock */
 	int be_pause; /* refcount protected by BE stream pcm lock */
 	bool fe_pause; /* used to track STOP after PAUSE */
+
+	/* hw_params() skipped as the BE was already set up identically */
+	unsigned int hw_params_reused;
 };
 
 #define for_each_dpcm_fe(be, stream, _dpcm)				\
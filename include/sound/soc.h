@@ -1018,6 +1018,8 @@ struct snd_soc_card {
 	unsigned int disable_route_checks:1;
 	unsigned int probed:1;
 	unsigned int component_chaining:1;
+	/* power widgets of different components concurrently */
+	unsigned int parallel_dapm:1;
 
 	void *drvdata;
 };
@@ -187,6 +187,51 @@ TRACE_EVENT(mmc_request_done,
 		  __entry->hold_retune, __entry->retune_period)
 );
 
+TRACE_EVENT(mmc_blk_rq_done,
+
+	TP_PROTO(struct mmc_host *host, unsigned int type, u64 latency_ns),
+
+	TP_ARGS(host, type, latency_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned int,		type)
+		__field(u64,			latency_ns)
+		__string(name,			mmc_hostname(host))
+	),
+
+	TP_fast_assign(
+		__entry->type = type;
+		__entry->latency_ns = latency_ns;
+		__assign_str(name, mmc_hostname(host));
+	),
+
+	TP_printk("%s: %s request done in %llu ns", __get_str(name),
+		  __print_symbolic(__entry->type,
+				   { 0, "read" }, { 1, "write" },
+				   { 2, "discard" }, { 3, "flush" }),
+		  __entry->latency_ns)
+);
+
+TRACE_EVENT(mmc_blk_busy,
+
+	TP_PROTO(struct mmc_host *host, u64 busy_ns),
+
+	TP_ARGS(host, busy_ns),
+
+	TP_STRUCT__entry(
+		__field(u64,			busy_ns)
+		__string(name,			mmc_hostname(host))
+	),
+
+	TP_fast_assign(
+		__entry->busy_ns = busy_ns;
+		__assign_str(name, mmc_hostname(host));
+	),
+
+	TP_printk("%s: card busy for %llu ns", __get_str(name),
+		  __entry->busy_ns)
+);
+
 #endif /* _TRACE_MMC_H */
 
 /* This part must be outside protection */
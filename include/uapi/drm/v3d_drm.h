@@ -41,6 +41,8 @@ extern "C" {
 #define DRM_V3D_PERFMON_CREATE                    0x08
 #define DRM_V3D_PERFMON_DESTROY                   0x09
 #define DRM_V3D_PERFMON_GET_VALUES                0x0a
+#define DRM_V3D_SET_PRIORITY                      0x0b
+#define DRM_V3D_SUBMIT_CL_BATCH                   0x0c
 
 #define DRM_IOCTL_V3D_SUBMIT_CL           DRM_IOWR(DRM_COMMAND_BASE + DRM_V3D_SUBMIT_CL, struct drm_v3d_submit_cl)
 #define DRM_IOCTL_V3D_WAIT_BO             DRM_IOWR(DRM_COMMAND_BASE + DRM_V3D_WAIT_BO, struct drm_v3d_wait_bo)
@@ -56,6 +58,10 @@ extern "C" {
 						   struct drm_v3d_perfmon_destroy)
 #define DRM_IOCTL_V3D_PERFMON_GET_VALUES  DRM_IOWR(DRM_COMMAND_BASE + DRM_V3D_PERFMON_GET_VALUES, \
 						   struct drm_v3d_perfmon_get_values)
+#define DRM_IOCTL_V3D_SET_PRIORITY        DRM_IOW(DRM_COMMAND_BASE + DRM_V3D_SET_PRIORITY, \
+						  struct drm_v3d_set_priority)
+#define DRM_IOCTL_V3D_SUBMIT_CL_BATCH     DRM_IOWR(DRM_COMMAND_BASE + DRM_V3D_SUBMIT_CL_BATCH, \
+						   struct drm_v3d_submit_cl_batch)
 
 #define DRM_V3D_SUBMIT_CL_FLUSH_CACHE             0x01
 #define DRM_V3D_SUBMIT_EXTENSION		  0x02
@@ -276,6 +282,8 @@ enum drm_v3d_param {
 	DRM_V3D_PARAM_SUPPORTS_CACHE_FLUSH,
 	DRM_V3D_PARAM_SUPPORTS_PERFMON,
 	DRM_V3D_PARAM_SUPPORTS_MULTISYNC_EXT,
+	DRM_V3D_PARAM_SUPPORTS_PRIORITY,
+	DRM_V3D_PARAM_SUPPORTS_SUBMIT_CL_BATCH,
 };
 
 struct drm_v3d_get_param {
@@ -478,6 +486,42 @@ struct drm_v3d_perfmon_get_values {
 	__u64 values_ptr;
 };
 
+/**
+ * struct drm_v3d_set_priority - ioctl argument for setting the scheduling
+ * priority of the jobs submitted on this DRM fd.
+ *
+ * The priority applies to all the queues.  A job already queued keeps the
+ * priority it was queued at, so a change takes effect once the jobs
+ * pending on a queue have completed.  DRM_V3D_PRIORITY_HIGH requires
+ * CAP_SYS_NICE or DRM master.
+ */
+struct drm_v3d_set_priority {
+	__u32 priority;
+#define DRM_V3D_PRIORITY_LOW                      0
+#define DRM_V3D_PRIORITY_NORMAL                   1
+#define DRM_V3D_PRIORITY_HIGH                     2
+	__u32 pad;
+};
+
+/**
+ * struct drm_v3d_submit_cl_batch - ioctl argument for submitting several
+ * CLs at once.
+ *
+ * Each entry of the array pointed to by submits is handled exactly as if
+ * it had been passed to DRM_V3D_SUBMIT_CL, in order.  On return,
+ * submitted holds the number of entries that were queued, which is less
+ * than count if an error was returned.
+ */
+struct drm_v3d_submit_cl_batch {
+	/* Pointer to an array of struct drm_v3d_submit_cl */
+	__u64 submits;
+	/* Number of entries in submits, at most DRM_V3D_MAX_CL_BATCH */
+	__u32 count;
+	__u32 submitted;
+};
+
+#define DRM_V3D_MAX_CL_BATCH                      64
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0+ WITH Linux-syscall-note */
+/*
+ * bcm2835-gpio-wave.h
+ *
+ * BCM2835 DMA paced GPIO waveform generator - user space header file.
+ *
+ * The device plays a table of samples out onto GPIO 0-31.  Each sample
+ * holds the pins to drive high and the pins to drive low; the DMA
+ * controller writes them to GPSET0/GPCLR0 once per tick of the PWM
+ * block, so the output timing does not depend on the CPU at all.
+ *
+ * Two buffers of GPIO_WAVE_IOC_CONFIG num_samples each are mmap()ed at
+ * offset 0, buffer 1 starting at the page aligned end of buffer 0.  The
+ * hardware plays them alternately and in a loop until stopped.
+ * GPIO_WAVE_IOC_WAIT blocks until a buffer has been played completely
+ * and reports which buffer is playing now, so the other one can be
+ * refilled in the meantime.  poll() reports EPOLLOUT in the same case.
+ */
+
+#ifndef _UAPI_BCM2835_GPIO_WAVE_H
+#define _UAPI_BCM2835_GPIO_WAVE_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define GPIO_WAVE_NUM_BUFFERS		2
+#define GPIO_WAVE_MAX_SAMPLES		16384
+
+struct gpio_wave_sample {
+	__u32 set;		/* pins to drive high, GPIO n is bit n */
+	__u32 clr;		/* pins to drive low */
+};
+
+struct gpio_wave_config {
+	__u32 rate;		/* samples per second */
+	__u32 num_samples;	/* samples per buffer */
+	__u32 padding[2];
+};
+
+struct gpio_wave_status {
+	__u64 completed;	/* buffers played since GPIO_WAVE_IOC_START */
+	__u32 buffer;		/* buffer being played now */
+	__u32 padding;
+};
+
+#define GPIO_WAVE_IOC_MAGIC		0xb9
+
+#define GPIO_WAVE_IOC_CONFIG	_IOW(GPIO_WAVE_IOC_MAGIC, 0, \
+				     struct gpio_wave_config)
+#define GPIO_WAVE_IOC_START	_IO(GPIO_WAVE_IOC_MAGIC, 1)
+#define GPIO_WAVE_IOC_STOP	_IO(GPIO_WAVE_IOC_MAGIC, 2)
+#define GPIO_WAVE_IOC_WAIT	_IOR(GPIO_WAVE_IOC_MAGIC, 3, \
+				     struct gpio_wave_status)
+
+#endif /* _UAPI_BCM2835_GPIO_WAVE_H */
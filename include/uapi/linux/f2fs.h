@@ -42,6 +42,8 @@
 						struct f2fs_comp_option)
 #define F2FS_IOC_DECOMPRESS_FILE	_IO(F2FS_IOCTL_MAGIC, 23)
 #define F2FS_IOC_COMPRESS_FILE		_IO(F2FS_IOCTL_MAGIC, 24)
+#define F2FS_IOC_SET_STREAMING		_IOW(F2FS_IOCTL_MAGIC, 25,	\
+						struct f2fs_streaming)
 
 /*
  * should be same as XFS_IOC_GOINGDOWN.
@@ -61,6 +63,12 @@
 #define F2FS_TRIM_FILE_ZEROOUT		0x2	/* zero out */
 #define F2FS_TRIM_FILE_MASK		0x3
 
+/*
+ * Flags used by F2FS_IOC_SET_STREAMING
+ */
+#define F2FS_STREAMING_ON		0x1	/* register a streaming writer */
+#define F2FS_STREAMING_MASK		0x1
+
 struct f2fs_gc_range {
 	__u32 sync;
 	__u64 start;
@@ -95,4 +103,10 @@ struct f2fs_comp_option {
 	__u8 log_cluster_size;
 };
 
+struct f2fs_streaming {
+	__u32 flags;		/* F2FS_STREAMING_* */
+	__u32 reserved;		/* must be zero */
+	__u64 prealloc_len;	/* bytes to allocate ahead of the writes */
+};
+
 #endif /* _UAPI_LINUX_F2FS_H */
@@ -300,6 +300,59 @@ struct gpio_v2_line_event {
 	__u32 padding[6];
 };
 
+/**
+ * struct gpio_v2_line_event_batch - Batching of line event wakeups
+ * @count: the number of events after which a reader is woken up, zero or
+ * one to wake a reader for every event
+ * @latency_us: the maximum time, in microseconds, a reader is left
+ * asleep after the first event of a batch, must be non-zero if @count is
+ * greater than one
+ * @padding: reserved for future use and must be zero filled
+ *
+ * With batching enabled a line request only becomes readable, and pollers
+ * are only woken, once @count events are pending or @latency_us has
+ * elapsed since the first of them, whichever comes first.
+ */
+struct gpio_v2_line_event_batch {
+	__u32 count;
+	__u32 latency_us;
+	/* Space reserved for future use. */
+	__u32 padding[6];
+};
+
+/**
+ * struct gpio_v2_line_event_ring - Header of the mmap()ed event ring
+ * @head: free-running count of the events written by the kernel
+ * @overflows: the number of events dropped as the ring was full
+ * @num_events: the number of events the ring can hold, a power of two
+ * @offset: the offset of the ring of &struct gpio_v2_line_event from the
+ * start of the mapping, in bytes
+ * @padding0: reserved for future use
+ * @tail: free-running count of the events consumed, written by userspace
+ * @padding1: reserved for future use
+ *
+ * Mapping a line request file descriptor, from offset 0, switches the
+ * delivery of its events from read() to a ring shared with userspace.
+ * The size of the mapping must cover the header and the ring, i.e.
+ * @offset + @num_events * sizeof(struct gpio_v2_line_event) rounded up to
+ * a multiple of the page size, where @num_events is the event buffer size
+ * of the request rounded up to a power of two.  Event n is found at index
+ * (n & (@num_events - 1)) of the ring.  The kernel only writes @head and
+ * @overflows, and the reader only writes @tail, with release semantics
+ * after the event accesses.  When the ring is full new events are dropped.
+ * read() fails with -EBUSY once the ring is in use.
+ */
+struct gpio_v2_line_event_ring {
+	__u32 head;
+	__u32 overflows;
+	__u32 num_events;
+	__u32 offset;
+	/* Keep the kernel and userspace written fields on their own lines. */
+	__u32 padding0[12];
+	__u32 tail;
+	__u32 padding1[15];
+};
+
 /*
  * ABI v1
  *
@@ -514,6 +567,7 @@ struct gpioevent_data {
 #define GPIO_V2_LINE_SET_CONFIG_IOCTL _IOWR(0xB4, 0x0D, struct gpio_v2_line_config)
 #define GPIO_V2_LINE_GET_VALUES_IOCTL _IOWR(0xB4, 0x0E, struct gpio_v2_line_values)
 #define GPIO_V2_LINE_SET_VALUES_IOCTL _IOWR(0xB4, 0x0F, struct gpio_v2_line_values)
+#define GPIO_V2_LINE_SET_EVENT_BATCH_IOCTL _IOW(0xB4, 0x10, struct gpio_v2_line_event_batch)
 
 /*
  * v1 ioctl()s
@@ -30,6 +30,28 @@ struct hidraw_devinfo {
 	__s16 product;
 };
 
+/*
+ * Report ring mapped by HIDIOCSRING clients. Slot n starts at
+ * (char *)ring + sizeof(struct hidraw_ring) + (n & (slots - 1)) * slot_size
+ * and holds a struct hidraw_ring_report. The kernel fills the slot at
+ * head, then increments head with release semantics; the reader consumes
+ * the slots up to it and then stores its new tail. Reports that find the
+ * ring full or that don't fit in a slot are counted in dropped.
+ */
+struct hidraw_ring {
+	__u32 slots;
+	__u32 slot_size;
+	__u32 head;
+	__u32 tail;
+	__u32 dropped;
+	__u32 reserved[3];
+};
+
+struct hidraw_ring_report {
+	__u32 len;
+	__u8 data[];
+};
+
 /* ioctl interface */
 #define HIDIOCGRDESCSIZE	_IOR('H', 0x01, int)
 #define HIDIOCGRDESC		_IOR('H', 0x02, struct hidraw_report_descriptor)
@@ -46,6 +68,12 @@ struct hidraw_devinfo {
 /* The first byte of SOUTPUT and GOUTPUT is the report number */
 #define HIDIOCSOUTPUT(len)    _IOC(_IOC_WRITE|_IOC_READ, 'H', 0x0B, len)
 #define HIDIOCGOUTPUT(len)    _IOC(_IOC_WRITE|_IOC_READ, 'H', 0x0C, len)
+/*
+ * Queue the input reports of this client in a ring of the given number of
+ * slots, a power of 2, that it can mmap() shared. Returns the size of the
+ * mapping. read() is no longer available to the client after that.
+ */
+#define HIDIOCSRING		_IOW('H', 0x0D, __u32)
 
 #define HIDRAW_FIRST_MINOR 0
 #define HIDRAW_MAX_DEVICES 64
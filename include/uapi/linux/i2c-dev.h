@@ -17,6 +17,8 @@
  *	- I2C_FUNCS, takes pointer to an unsigned long
  *	- I2C_RDWR, takes pointer to struct i2c_rdwr_ioctl_data
  *	- I2C_SMBUS, takes pointer to struct i2c_smbus_ioctl_data
+ *	- I2C_RDWR_SUBMIT, takes pointer to struct i2c_rdwr_submit_data
+ *	- I2C_RDWR_REAP, takes pointer to struct i2c_rdwr_reap_data
  */
 #define I2C_RETRIES	0x0701	/* number of times a device address should
 				   be polled when not acknowledging */
@@ -35,6 +37,8 @@
 #define I2C_RDWR	0x0707	/* Combined R/W transfer (one STOP only) */
 
 #define I2C_PEC		0x0708	/* != 0 to use PEC with SMBus */
+#define I2C_RDWR_SUBMIT	0x0709	/* Queue a combined R/W transfer */
+#define I2C_RDWR_REAP	0x070a	/* Collect results of queued transfers */
 #define I2C_SMBUS	0x0720	/* SMBus transfer */
 
 
@@ -56,5 +60,36 @@ struct i2c_rdwr_ioctl_data {
 /* Originally defined with a typo, keep it for compatibility */
 #define  I2C_RDRW_IOCTL_MAX_MSGS	I2C_RDWR_IOCTL_MAX_MSGS
 
+/*
+ * Queued transfers: I2C_RDWR_SUBMIT returns as soon as the transfer is
+ * queued.  Transfers queued on the same adapter are executed in order,
+ * back-to-back.  Their results, and the data of read messages, are
+ * delivered by I2C_RDWR_REAP, which returns the number of results
+ * stored.  It blocks while transfers are pending unless the file is in
+ * non-blocking mode, and fails with EAGAIN when there is nothing to
+ * collect.  poll() reports POLLIN when results are available.  The
+ * message buffers must stay valid until the result has been collected.
+ */
+struct i2c_rdwr_submit_data {
+	__u64 msgs;			/* pointer to i2c_msgs */
+	__u32 nmsgs;			/* number of i2c_msgs */
+	__u32 reserved;			/* must be 0 */
+	__u64 user_data;		/* returned with the result */
+};
+
+struct i2c_rdwr_result {
+	__u64 user_data;		/* as passed to I2C_RDWR_SUBMIT */
+	__s32 result;			/* as returned by I2C_RDWR */
+	__u32 reserved;
+};
+
+struct i2c_rdwr_reap_data {
+	__u64 results;			/* pointer to i2c_rdwr_results */
+	__u32 nresults;			/* number of i2c_rdwr_results */
+	__u32 reserved;			/* must be 0 */
+};
+
+#define  I2C_RDWR_ASYNC_MAX_PENDING	64
+
 
 #endif /* _UAPI_LINUX_I2C_DEV_H */
@@ -128,6 +128,7 @@ struct tpacket_auxdata {
 
 /* Rx ring - feature request bits */
 #define TP_FT_REQ_FILL_RXHASH	0x1
+#define TP_FT_REQ_TSTAMP_RETIRE	0x2	/* tmo in packet timestamps */
 
 struct tpacket_hdr {
 	unsigned long	tp_status;
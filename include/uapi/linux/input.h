@@ -129,6 +129,47 @@ struct input_mask {
 	__u64 codes_ptr;
 };
 
+/**
+ * struct input_ring_event - an event in the shared ring, see EVIOCSRING
+ * @time: CLOCK_MONOTONIC timestamp, in nanoseconds
+ * @type: event type
+ * @code: event code
+ * @value: event value
+ */
+struct input_ring_event {
+	__u64 time;
+	__u16 type;
+	__u16 code;
+	__s32 value;
+};
+
+/**
+ * struct input_ring - the shared event ring of a device, see EVIOCSRING
+ * @size: number of events in @events, a power of 2
+ * @head: sequence number of the event being written; the kernel moves it
+ *	before it overwrites an event slot
+ * @packet_head: sequence number after the last complete packet; the kernel
+ *	moves it, with release semantics, once the SYN_REPORT is written
+ * @events: the ring, sequence number n is at events[n & (size - 1)]
+ *
+ * Sequence numbers wrap around at 2^32.
+ */
+struct input_ring {
+	__u32 size;
+	__u32 head;
+	__u32 packet_head;
+	__u32 reserved;
+	struct input_ring_event events[];
+};
+
+/**
+ * struct input_ring_reader - a client's position in the shared ring
+ * @tail: sequence number of the next event the client will read
+ */
+struct input_ring_reader {
+	__u32 tail;
+};
+
 #define EVIOCGVERSION		_IOR('E', 0x01, int)			/* get driver version */
 #define EVIOCGID		_IOR('E', 0x02, struct input_id)	/* get device ID */
 #define EVIOCGREP		_IOR('E', 0x03, unsigned int[2])	/* get repeat settings */
@@ -242,6 +283,36 @@ struct input_mask {
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
+/**
+ * EVIOCSRING - Read events from the shared ring of the device
+ *
+ * Without it, every event is copied into the queue of every client that
+ * has the device open. After this ioctl the client reads the ring that is
+ * shared by all the clients which asked for it instead, from its own
+ * position, so the cost of an event doesn't depend on how many of them
+ * there are. Events still pending in the client's own queue are dropped.
+ *
+ * read() and poll() keep working as before. The client may also mmap() the
+ * file: page 0 is its struct input_ring_reader, which must be mapped
+ * shared, and the following pages are the struct input_ring, read only.
+ * A client reading from the mapping must load packet_head with acquire
+ * semantics, copy the events up to it, then check that head has not moved
+ * more than size beyond the events it copied, else they were overwritten
+ * meanwhile. Then it stores its new tail. A client that fell behind by more
+ * than the ring size lost events; read() then reports SYN_DROPPED and
+ * continues from the last complete packet.
+ *
+ * The ring is only written while no client has grabbed the device, and
+ * its timestamps are CLOCK_MONOTONIC, so the ioctl fails with EINVAL for
+ * a client that has grabbed the device or changed its clock, and EVIOCGRAB
+ * and EVIOCSCLOCKID fail for a client reading the ring. Event masks set
+ * with EVIOCSMASK only apply to read(). Revoking the client also revokes
+ * its mappings, later accesses get SIGBUS.
+ *
+ * Returns the number of events in the ring.
+ */
+#define EVIOCSRING		_IO('E', 0xa1)				/* Read events from the shared ring */
+
 /*
  * IDs.
  */
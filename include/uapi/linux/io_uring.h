@@ -165,6 +165,14 @@ enum {
  */
 #define IORING_SETUP_DEFER_TASKRUN	(1U << 13)
 
+/*
+ * sq_thread_rt_prio and sq_thread_budget are valid. The SQPOLL thread runs
+ * SCHED_FIFO at sq_thread_rt_prio, if not 0, and spins idle for at most
+ * sq_thread_budget percent of the CPU, if not 0. A thread shared with
+ * IORING_SETUP_ATTACH_WQ takes the highest values of its rings.
+ */
+#define IORING_SETUP_SQ_SCHED		(1U << 14)
+
 enum io_uring_op {
 	IORING_OP_NOP,
 	IORING_OP_READV,
@@ -242,7 +250,10 @@ enum io_uring_op {
 #define IORING_TIMEOUT_REALTIME		(1U << 3)
 #define IORING_LINK_TIMEOUT_UPDATE	(1U << 4)
 #define IORING_TIMEOUT_ETIME_SUCCESS	(1U << 5)
-#define IORING_TIMEOUT_CLOCK_MASK	(IORING_TIMEOUT_BOOTTIME | IORING_TIMEOUT_REALTIME)
+#define IORING_TIMEOUT_REFCLOCK		(1U << 6)
+#define IORING_TIMEOUT_CLOCK_MASK	(IORING_TIMEOUT_BOOTTIME | \
+					 IORING_TIMEOUT_REALTIME | \
+					 IORING_TIMEOUT_REFCLOCK)
 #define IORING_TIMEOUT_UPDATE_MASK	(IORING_TIMEOUT_UPDATE | IORING_LINK_TIMEOUT_UPDATE)
 /*
  * sqe->splice_flags
@@ -441,7 +452,9 @@ struct io_uring_params {
 	__u32 sq_thread_idle;
 	__u32 features;
 	__u32 wq_fd;
-	__u32 resv[3];
+	__u16 sq_thread_rt_prio;
+	__u16 sq_thread_budget;
+	__u32 resv[2];
 	struct io_sqring_offsets sq_off;
 	struct io_cqring_offsets cq_off;
 };
@@ -508,6 +521,9 @@ enum {
 	/* register a range of fixed file slots for automatic slot allocation */
 	IORING_REGISTER_FILE_ALLOC_RANGE	= 25,
 
+	/* set the timebase of IORING_TIMEOUT_REFCLOCK timeouts */
+	IORING_REGISTER_REF_CLOCK		= 26,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -677,6 +693,23 @@ struct io_uring_file_index_range {
 	__u64	resv;
 };
 
+/*
+ * Argument for IORING_REGISTER_REF_CLOCK
+ *
+ * Maps the timebase of IORING_TIMEOUT_REFCLOCK timeouts, e.g. the audio time
+ * of a PCM device, to CLOCK_MONOTONIC: ref_ns in the reference timebase was
+ * mono_ns, and a reference nanosecond lasts mono_mul / mono_div monotonic
+ * ones. Timeouts are converted when they get armed, register it again to
+ * follow the drift of the reference clock.
+ */
+struct io_uring_ref_clock {
+	__u64	ref_ns;
+	__u64	mono_ns;
+	__u32	mono_mul;
+	__u32	mono_div;
+	__u64	resv[2];
+};
+
 struct io_uring_recvmsg_out {
 	__u32 namelen;
 	__u32 controllen;
@@ -37,6 +37,27 @@ enum {
 #define IOPRIO_NR_LEVELS	8
 #define IOPRIO_BE_NR		IOPRIO_NR_LEVELS
 
+/*
+ * The priority of a single RT class I/O, as given to io_uring, may also carry
+ * a deadline hint in the data bits above the level: the number of
+ * milliseconds, up to IOPRIO_DEADLINE_MAX, within which the I/O should
+ * complete. mq-deadline dispatches such requests earliest deadline first.
+ * Zero means no deadline. Process priorities can't have one.
+ */
+#define IOPRIO_LEVEL_NR_BITS		3
+#define IOPRIO_LEVEL_MASK		((1 << IOPRIO_LEVEL_NR_BITS) - 1)
+#define IOPRIO_PRIO_LEVEL(ioprio)	((ioprio) & IOPRIO_LEVEL_MASK)
+
+#define IOPRIO_DEADLINE_SHIFT		IOPRIO_LEVEL_NR_BITS
+#define IOPRIO_DEADLINE_NR_BITS		10
+#define IOPRIO_DEADLINE_MAX		((1 << IOPRIO_DEADLINE_NR_BITS) - 1)
+#define IOPRIO_PRIO_DEADLINE(ioprio)	\
+	(((ioprio) >> IOPRIO_DEADLINE_SHIFT) & IOPRIO_DEADLINE_MAX)
+#define IOPRIO_PRIO_VALUE_DEADLINE(class, level, deadline_ms)	\
+	IOPRIO_PRIO_VALUE(class, IOPRIO_PRIO_LEVEL(level) |	\
+			  (((deadline_ms) & IOPRIO_DEADLINE_MAX) <<	\
+			   IOPRIO_DEADLINE_SHIFT))
+
 enum {
 	IOPRIO_WHO_PROCESS = 1,
 	IOPRIO_WHO_PGRP,
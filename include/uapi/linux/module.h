@@ -6,5 +6,10 @@
 #define MODULE_INIT_IGNORE_MODVERSIONS	1
 #define MODULE_INIT_IGNORE_VERMAGIC	2
 #define MODULE_INIT_COMPRESSED_FILE	4
+/*
+ * Part of a set of modules loaded concurrently: wait for the others to
+ * export their symbols instead of failing on the ones they provide.
+ */
+#define MODULE_INIT_BATCH		8
 
 #endif /* _UAPI_LINUX_MODULE_H */
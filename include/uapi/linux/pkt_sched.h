@@ -842,6 +842,8 @@ enum {
 	TCA_FQ_CODEL_MEMORY_LIMIT,
 	TCA_FQ_CODEL_CE_THRESHOLD_SELECTOR,
 	TCA_FQ_CODEL_CE_THRESHOLD_MASK,
+	TCA_FQ_CODEL_PRIO_DSCP,		/* u64 bitmap of strict priority DSCPs */
+	TCA_FQ_CODEL_PAD,
 	__TCA_FQ_CODEL_MAX
 };
 
@@ -868,6 +870,11 @@ struct tc_fq_codel_qd_stats {
 	__u32	ce_mark;	/* packets above ce_threshold */
 	__u32	memory_usage;	/* in bytes */
 	__u32	drop_overmemory;
+	__u32	prio_packets;	/* packets sent from the priority band */
+	__u32	prio_ldelay;	/* in-queue delay of the last priority and */
+	__u32	bulk_ldelay;	/* flow packet dequeued */
+	__u32	prio_maxdelay;	/* largest in-queue delay seen by a */
+	__u32	bulk_maxdelay;	/* priority and a flow packet */
 };
 
 struct tc_fq_codel_cl_stats {
@@ -1061,6 +1068,7 @@ struct tc_etf_qopt {
 #define TC_ETF_DEADLINE_MODE_ON	_BITUL(0)
 #define TC_ETF_OFFLOAD_ON	_BITUL(1)
 #define TC_ETF_SKIP_SOCK_CHECK	_BITUL(2)
+#define TC_ETF_PACE_GSO		_BITUL(3)
 };
 
 enum {
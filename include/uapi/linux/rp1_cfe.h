@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * RP1 Camera Front End driver userspace API
+ */
+
+#ifndef _UAPI_LINUX_RP1_CFE_H
+#define _UAPI_LINUX_RP1_CFE_H
+
+#include <linux/types.h>
+#include <linux/videodev2.h>
+
+/*
+ * Events
+ *
+ * V4L2_EVENT_RP1_CFE_LINES: the top of the frame being captured has been
+ * written to its buffer. Queued on the CSI-2 image capture nodes at every
+ * line count interrupt, i.e. every quarter of the frame or every
+ * line_int_lines lines. The payload is a struct rp1_cfe_event_lines.
+ */
+
+#define V4L2_EVENT_RP1_CFE_CLASS	(V4L2_EVENT_PRIVATE_START | 0x200)
+#define V4L2_EVENT_RP1_CFE_LINES	(V4L2_EVENT_RP1_CFE_CLASS | 0x1)
+
+struct rp1_cfe_event_lines {
+	__u32 frame_sequence;	/* as the buffer's, once it is done */
+	__u32 lines;		/* lines written to the buffer so far */
+};
+
+#endif /* _UAPI_LINUX_RP1_CFE_H */
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0+ WITH Linux-syscall-note */
+/*
+ *  Control extensions to the ALSA user-space API
+ *
+ *  These definitions complement the SNDRV_CTL_* interface in
+ *  <sound/asound.h> and use the same 'U' ioctl space.
+ */
+#ifndef _UAPI__SOUND_CONTROL_H
+#define _UAPI__SOUND_CONTROL_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Vectored element access
+ *
+ * SNDRV_CTL_IOCTL_ELEM_READ_MULTI and SNDRV_CTL_IOCTL_ELEM_WRITE_MULTI
+ * work like ELEM_READ and ELEM_WRITE on an array of count
+ * struct snd_ctl_elem_value at the user address in values.  All elements
+ * are handled in one pass over the control list, so the cost per element
+ * is that of the driver callback only.  Value change events of a write
+ * are sent after the whole array has been written.
+ *
+ * The elements are processed in order and processing stops at the first
+ * error, which is returned; done tells how many elements were read or
+ * written successfully.  At most SNDRV_CTL_ELEM_MULTI_MAX elements can be
+ * passed at once.
+ */
+#define SNDRV_CTL_ELEM_MULTI_MAX		1024
+
+struct snd_ctl_elem_value_multi {
+	__u32 count;			/* W: number of elements */
+	__u32 done;			/* R: number of elements processed */
+	__u64 values;			/* W: struct snd_ctl_elem_value array */
+	unsigned char reserved[48];
+};
+
+#define SNDRV_CTL_IOCTL_ELEM_READ_MULTI	_IOWR('U', 0x50, struct snd_ctl_elem_value_multi)
+#define SNDRV_CTL_IOCTL_ELEM_WRITE_MULTI _IOWR('U', 0x51, struct snd_ctl_elem_value_multi)
+
+#endif /* _UAPI__SOUND_CONTROL_H */
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-2.0+ WITH Linux-syscall-note */
+/*
+ *  PCM extensions to the ALSA user-space API
+ *
+ *  These definitions complement the SNDRV_PCM_* interface in
+ *  <sound/asound.h>.
+ */
+#ifndef _UAPI__SOUND_PCM_H
+#define _UAPI__SOUND_PCM_H
+
+#include <linux/types.h>
+
+/*
+ * Extended status page
+ *
+ * A read-only page mapped at SNDRV_PCM_MMAP_OFFSET_STATUS_EXT that the
+ * kernel refreshes on each hw_ptr update, i.e. on every period interrupt
+ * and whenever the pointer is queried.  It allows an audio engine to
+ * compute the exact latency without SYNC_PTR or HWSYNC ioctls.
+ *
+ * The record is updated under a sequence counter: seq is odd while an
+ * update is in progress.  Readers copy the record between two reads of
+ * an even and unchanged seq (with read barriers in between).
+ *
+ * The timestamps use the clock selected with SNDRV_PCM_IOCTL_TTSTAMP.
+ */
+#define SNDRV_PCM_MMAP_OFFSET_STATUS_EXT	0x84000000
+
+struct snd_pcm_mmap_status_ext {
+	__u32 seq;			/* sequence counter */
+	__s32 state;			/* SNDRV_PCM_STATE_* */
+	__u64 hw_ptr;			/* frames since start, not wrapped */
+	__u64 dma_pos;			/* last driver position in the buffer */
+	__u64 xruns;			/* number of xruns since open */
+	__u64 period_irqs;		/* number of period updates since open */
+	__s64 delay;			/* extra delay in frames */
+	__s64 tstamp_sec;		/* system time of the pointer read */
+	__s64 tstamp_nsec;
+	__s64 audio_tstamp_sec;		/* matching audio time */
+	__s64 audio_tstamp_nsec;
+	__u64 reserved[6];
+};
+
+#endif /* _UAPI__SOUND_PCM_H */
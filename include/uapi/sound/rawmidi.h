@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0+ WITH Linux-syscall-note */
+/*
+ *  Raw MIDI extensions to the ALSA user-space API
+ *
+ *  These definitions complement the SNDRV_RAWMIDI_* interface in
+ *  <sound/asound.h> and use the same 'W' ioctl space.
+ */
+#ifndef _UAPI__SOUND_RAWMIDI_H
+#define _UAPI__SOUND_RAWMIDI_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * mmap mode
+ *
+ * Setting SNDRV_RAWMIDI_MODE_MMAP in snd_rawmidi_params.mode switches the
+ * stream into a single-producer/single-consumer ring that is shared with
+ * user-space.  The buffer size must then be a power of two and a multiple
+ * of the page size.  Both the data buffer and a status page are mapped
+ * with mmap() at the offsets below.
+ *
+ * hw_ptr and appl_ptr are free-running byte counters; the buffer offset
+ * is "ptr & (buffer_size - 1)".  The kernel only writes hw_ptr, xruns and
+ * state, user-space only writes appl_ptr.  For input, the kernel fills
+ * data up to hw_ptr and the application consumes it by advancing
+ * appl_ptr; for output the application fills data up to appl_ptr and the
+ * kernel transmits it, advancing hw_ptr.  Updates of the pointers must be
+ * ordered after the data accesses (store-release / load-acquire).
+ *
+ * read() and write() are refused while a stream is in mmap mode.
+ * SNDRV_RAWMIDI_IOCTL_MMAP_SYNC starts the input stream and kicks the
+ * output stream; it is only needed for output when state reports
+ * SNDRV_RAWMIDI_MMAP_STATE_IDLE, as a running output keeps picking up
+ * new data from appl_ptr by itself.
+ */
+#define SNDRV_RAWMIDI_MODE_MMAP			(1U << 6)
+
+#define SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_DATA	0x00000000
+#define SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_STATUS	0x10000000
+#define SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_DATA	0x20000000
+#define SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_STATUS	0x30000000
+
+#define SNDRV_RAWMIDI_MMAP_STATE_IDLE		0
+#define SNDRV_RAWMIDI_MMAP_STATE_RUNNING	1
+
+struct snd_rawmidi_mmap_status {
+	/* written by the kernel */
+	__u32 hw_ptr;			/* free-running hardware position */
+	__u32 xruns;			/* overrun counter (input) */
+	__u32 buffer_size;		/* size of the mapped data buffer */
+	__u32 state;			/* SNDRV_RAWMIDI_MMAP_STATE_* */
+	__u32 reserved0[12];
+	/* written by the application, kept on its own cache line */
+	__u32 appl_ptr;			/* free-running application position */
+	__u32 reserved1[15];
+};
+
+#define SNDRV_RAWMIDI_IOCTL_MMAP_SYNC	_IOW('W', 0x40, int)
+
+/*
+ * Scheduled output
+ *
+ * SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP can also be set for an output stream,
+ * together with SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC or
+ * SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW.  write() then takes whole
+ * struct snd_rawmidi_framing_tstamp frames, and the kernel passes the data
+ * of each frame to the device when the given time of the selected clock
+ * is reached.  Frames are released in the order they were written; a
+ * frame with an earlier time than its predecessor is sent right after it.
+ * The buffer size gives the size of the frame queue in bytes.
+ */
+
+#endif /* _UAPI__SOUND_RAWMIDI_H */
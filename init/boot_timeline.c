@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Boot timeline
+ *
+ * Each event is recorded once it has ended, into a fixed table so that
+ * nothing has to be allocated while the kernel is coming up. The slot is
+ * reserved with an atomic counter and published by writing its category
+ * last, so concurrent async probes need no lock. Once the table is full
+ * further events are only counted.
+ *
+ * /sys/kernel/debug/boot_timeline.json can be loaded as is into Perfetto
+ * or chrome://tracing, with one track per CPU.
+ */
+
+#include <linux/atomic.h>
+#include <linux/boot_timeline.h>
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/smp.h>
+#include <linux/timekeeping.h>
+
+#define BOOT_TIMELINE_NAME_LEN	48
+
+struct boot_timeline_event {
+	u64 start;
+	u64 end;
+	/* NULL until the event has been filled in */
+	const char *cat;
+	unsigned int cpu;
+	char name[BOOT_TIMELINE_NAME_LEN];
+};
+
+static struct boot_timeline_event boot_timeline[CONFIG_BOOT_TIMELINE_ENTRIES];
+static atomic_t boot_timeline_next = ATOMIC_INIT(0);
+static atomic_t boot_timeline_dropped = ATOMIC_INIT(0);
+
+/**
+ * boot_timeline_begin - returns the timestamp to pass to boot_timeline_end()
+ */
+u64 boot_timeline_begin(void)
+{
+	return ktime_get_ns();
+}
+
+/**
+ * boot_timeline_end - records an event that has just ended
+ * @start: the value returned by boot_timeline_begin() when it started
+ * @cat: the event category; must be a string constant
+ * @fmt: printf format of the event name
+ */
+void boot_timeline_end(u64 start, const char *cat, const char *fmt, ...)
+{
+	struct boot_timeline_event *ev;
+	unsigned int i;
+	va_list args;
+	char *p;
+
+	if (atomic_read(&boot_timeline_next) >= ARRAY_SIZE(boot_timeline)) {
+		atomic_inc(&boot_timeline_dropped);
+		return;
+	}
+
+	i = atomic_inc_return(&boot_timeline_next) - 1;
+	if (i >= ARRAY_SIZE(boot_timeline)) {
+		atomic_inc(&boot_timeline_dropped);
+		return;
+	}
+
+	ev = &boot_timeline[i];
+	ev->start = start;
+	ev->end = ktime_get_ns();
+	ev->cpu = raw_smp_processor_id();
+
+	va_start(args, fmt);
+	vsnprintf(ev->name, sizeof(ev->name), fmt, args);
+	va_end(args);
+
+	/* Keep the JSON string valid, whatever the device is called */
+	for (p = ev->name; *p; p++)
+		if (*p == '"' || *p == '\\' || *p < ' ')
+			*p = '_';
+
+	smp_store_release(&ev->cat, cat);
+}
+
+static int boot_timeline_show(struct seq_file *m, void *v)
+{
+	unsigned int n = atomic_read(&boot_timeline_next);
+	const char *sep = "";
+	unsigned int i;
+
+	n = min_t(unsigned int, n, ARRAY_SIZE(boot_timeline));
+
+	seq_puts(m, "{\"traceEvents\":[");
+	for (i = 0; i < n; i++) {
+		const struct boot_timeline_event *ev = &boot_timeline[i];
+		const char *cat = smp_load_acquire(&ev->cat);
+		u32 ts_rem, dur_rem;
+		u64 ts, dur;
+
+		if (!cat)
+			continue;
+
+		ts = div_u64_rem(ev->start, NSEC_PER_USEC, &ts_rem);
+		dur = div_u64_rem(ev->end - ev->start, NSEC_PER_USEC, &dur_rem);
+		seq_printf(m, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+			   "\"ts\":%llu.%03u,\"dur\":%llu.%03u,"
+			   "\"pid\":0,\"tid\":%u}",
+			   sep, ev->name, cat, ts, ts_rem, dur, dur_rem,
+			   ev->cpu);
+		sep = ",";
+	}
+	seq_printf(m, "\n],\"displayTimeUnit\":\"ms\","
+		   "\"otherData\":{\"dropped\":%d}}\n",
+		   atomic_read(&boot_timeline_dropped));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(boot_timeline);
+
+static int __init boot_timeline_debugfs_init(void)
+{
+	debugfs_create_file("boot_timeline.json", 0400, NULL, NULL,
+			    &boot_timeline_fops);
+
+	return 0;
+}
+late_initcall(boot_timeline_debugfs_init);
@@ -14,6 +14,7 @@
 #include <linux/fs.h>
 #include <linux/initrd.h>
 #include <linux/async.h>
+#include <linux/boot_timeline.h>
 #include <linux/fs_struct.h>
 #include <linux/slab.h>
 #include <linux/ramfs.h>
@@ -599,6 +600,8 @@ void __init mount_root(void)
  */
 void __init prepare_namespace(void)
 {
+	u64 tl_start;
+
 	if (root_delay) {
 		printk(KERN_INFO "Waiting %d sec before mounting root device...\n",
 		       root_delay);
@@ -612,7 +615,9 @@ void __init prepare_namespace(void)
 	 * For example, it is not atypical to wait 5 seconds here
 	 * for the touchpad of a laptop to initialize.
 	 */
+	tl_start = boot_timeline_begin();
 	wait_for_device_probe();
+	boot_timeline_end(tl_start, "wait", "wait_for_device_probe");
 
 	md_run_setup();
 
@@ -641,7 +646,10 @@ void __init prepare_namespace(void)
 		async_synchronize_full();
 	}
 
+	tl_start = boot_timeline_begin();
 	mount_root();
+	boot_timeline_end(tl_start, "mount", "mount_root %s",
+			  saved_root_name);
 out:
 	devtmpfs_mount();
 	init_mount(".", "/", NULL, MS_MOVE, NULL);
@@ -29,6 +29,7 @@
 #include <linux/memblock.h>
 #include <linux/acpi.h>
 #include <linux/bootconfig.h>
+#include <linux/boot_timeline.h>
 #include <linux/console.h>
 #include <linux/nmi.h>
 #include <linux/percpu.h>
@@ -1283,14 +1284,17 @@ int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
 	char msgbuf[64];
+	u64 tl_start;
 	int ret;
 
 	if (initcall_blacklisted(fn))
 		return -EPERM;
 
+	tl_start = boot_timeline_begin();
 	do_trace_initcall_start(fn);
 	ret = fn();
 	do_trace_initcall_finish(fn, ret);
+	boot_timeline_end(tl_start, "initcall", "%ps", fn);
 
 	msgbuf[0] = 0;
 
@@ -1350,6 +1354,40 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 	return 0;
 }
 
+/*
+ * The levels run one after the other, so the boot time is the sum of their
+ * times, and within a level the slowest initcall is the one to look at
+ * first: often a probe that waits on a bus or on firmware, which can be
+ * moved off the critical path with driver_async_probe=.
+ */
+static void __init do_initcall_level_timed(int level)
+{
+	ktime_t start = ktime_get(), slowest_delta = 0;
+	initcall_t slowest = NULL;
+	initcall_entry_t *fn;
+
+	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++) {
+		initcall_t call = initcall_from_entry(fn);
+		ktime_t calltime = ktime_get(), delta;
+
+		do_one_initcall(call);
+
+		delta = ktime_sub(ktime_get(), calltime);
+		if (delta > slowest_delta) {
+			slowest_delta = delta;
+			slowest = call;
+		}
+	}
+
+	if (!slowest)
+		return;
+
+	printk(KERN_DEBUG "initcall level %s took %lld usecs, slowest %pS after %lld usecs\n",
+	       initcall_level_names[level],
+	       (unsigned long long)ktime_us_delta(ktime_get(), start),
+	       slowest, (unsigned long long)ktime_to_us(slowest_delta));
+}
+
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
@@ -1361,6 +1399,11 @@ static void __init do_initcall_level(int level, char *command_line)
 		   NULL, ignore_unknown_bootoption);
 
 	trace_initcall_level(initcall_level_names[level]);
+	if (initcall_debug) {
+		do_initcall_level_timed(level);
+		return;
+	}
+
 	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
 		do_one_initcall(initcall_from_entry(fn));
 }
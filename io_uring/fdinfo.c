@@ -62,6 +62,8 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 	unsigned int sq_shift = 0;
 	unsigned int sq_entries, cq_entries;
 	int sq_pid = -1, sq_cpu = -1;
+	u64 sq_wake_lat_avg = 0, sq_wake_lat_max = 0;
+	unsigned long sq_wakes = 0, sq_throttled = 0;
 	bool has_lock;
 	unsigned int i;
 
@@ -146,12 +148,26 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 				sq_pid = task_pid_nr(sq->thread);
 				sq_cpu = task_cpu(sq->thread);
 			}
+			sq_wakes = sq->nr_wakes;
+			if (sq_wakes)
+				sq_wake_lat_avg = div_u64(sq->wake_lat_total,
+							  sq_wakes);
+			sq_wake_lat_max = sq->wake_lat_max;
+			sq_throttled = sq->nr_throttled;
 			mutex_unlock(&sq->lock);
 		}
 	}
 
 	seq_printf(m, "SqThread:\t%d\n", sq_pid);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		seq_printf(m, "SqThreadRtPrio:\t%u\n", ctx->sq_thread_rt_prio);
+		seq_printf(m, "SqThreadBudget:\t%u\n", ctx->sq_thread_budget);
+		seq_printf(m, "SqWakeups:\t%lu\n", sq_wakes);
+		seq_printf(m, "SqWakeLatAvg:\t%llu ns\n", sq_wake_lat_avg);
+		seq_printf(m, "SqWakeLatMax:\t%llu ns\n", sq_wake_lat_max);
+		seq_printf(m, "SqThrottled:\t%lu\n", sq_throttled);
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -3288,7 +3288,7 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 			goto out;
 		}
 		if (flags & IORING_ENTER_SQ_WAKEUP)
-			wake_up(&ctx->sq_data->wait);
+			io_sqpoll_wake(ctx->sq_data);
 		if (flags & IORING_ENTER_SQ_WAIT) {
 			ret = io_sqpoll_wait_sq(ctx);
 			if (ret)
@@ -3672,6 +3672,9 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 		if (p.resv[i])
 			return -EINVAL;
 	}
+	if (!(p.flags & IORING_SETUP_SQ_SCHED) &&
+	    (p.sq_thread_rt_prio || p.sq_thread_budget))
+		return -EINVAL;
 
 	if (p.flags & ~(IORING_SETUP_IOPOLL | IORING_SETUP_SQPOLL |
 			IORING_SETUP_SQ_AFF | IORING_SETUP_CQSIZE |
@@ -3679,7 +3682,8 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 			IORING_SETUP_R_DISABLED | IORING_SETUP_SUBMIT_ALL |
 			IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG |
 			IORING_SETUP_SQE128 | IORING_SETUP_CQE32 |
-			IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN))
+			IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN |
+			IORING_SETUP_SQ_SCHED))
 		return -EINVAL;
 
 	return io_uring_create(entries, &p, params);
@@ -4128,6 +4132,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_file_alloc_range(ctx, arg);
 		break;
+	case IORING_REGISTER_REF_CLOCK:
+		ret = -EINVAL;
+		if (!arg || nr_args)
+			break;
+		ret = io_register_ref_clock(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -97,7 +97,7 @@ int io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 
 	ioprio = READ_ONCE(sqe->ioprio);
 	if (ioprio) {
-		ret = ioprio_check_cap(ioprio);
+		ret = ioprio_check_io_cap(ioprio);
 		if (ret)
 			return ret;
 
@@ -11,6 +11,10 @@
 #include <linux/audit.h>
 #include <linux/security.h>
 #include <linux/io_uring.h>
+#include <linux/capability.h>
+#include <linux/hrtimer.h>
+#include <linux/sched/prio.h>
+#include <linux/sched/signal.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -18,6 +22,8 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+/* sq_thread_budget is a percentage of this */
+#define IORING_SQPOLL_BUDGET_PERIOD_NS	NSEC_PER_MSEC
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -74,14 +80,29 @@ void io_put_sq_data(struct io_sq_data *sqd)
 	}
 }
 
-static __cold void io_sqd_update_thread_idle(struct io_sq_data *sqd)
+void io_sqpoll_wake(struct io_sq_data *sqd)
+{
+	if (!READ_ONCE(sqd->wake_time))
+		WRITE_ONCE(sqd->wake_time, ktime_get_ns());
+	wake_up(&sqd->wait);
+}
+
+static __cold void io_sqd_update_thread_params(struct io_sq_data *sqd)
 {
 	struct io_ring_ctx *ctx;
 	unsigned sq_thread_idle = 0;
+	unsigned sq_thread_rt_prio = 0;
+	unsigned sq_thread_budget = 0;
 
-	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 		sq_thread_idle = max(sq_thread_idle, ctx->sq_thread_idle);
+		sq_thread_rt_prio = max(sq_thread_rt_prio,
+					ctx->sq_thread_rt_prio);
+		sq_thread_budget = max(sq_thread_budget, ctx->sq_thread_budget);
+	}
 	sqd->sq_thread_idle = sq_thread_idle;
+	sqd->sq_thread_rt_prio = sq_thread_rt_prio;
+	sqd->sq_thread_budget = sq_thread_budget;
 }
 
 void io_sq_thread_finish(struct io_ring_ctx *ctx)
@@ -91,7 +112,7 @@ void io_sq_thread_finish(struct io_ring_ctx *ctx)
 	if (sqd) {
 		io_sq_thread_park(sqd);
 		list_del_init(&ctx->sqd_list);
-		io_sqd_update_thread_idle(sqd);
+		io_sqd_update_thread_params(sqd);
 		io_sq_thread_unpark(sqd);
 
 		io_put_sq_data(sqd);
@@ -218,11 +239,85 @@ static bool io_sqd_handle_event(struct io_sq_data *sqd)
 	return did_sig || test_bit(IO_SQ_THREAD_SHOULD_STOP, &sqd->state);
 }
 
+/*
+ * Apply the RT priority asked for by the rings. Without one, the thread keeps
+ * the scheduling policy it inherited from its creator, until a ring that
+ * asked for one goes away.
+ */
+static void io_sq_thread_update_sched(struct io_sq_data *sqd,
+				      unsigned int *rt_prio)
+{
+	struct sched_param param = {
+		.sched_priority = sqd->sq_thread_rt_prio,
+	};
+
+	if (*rt_prio == param.sched_priority)
+		return;
+
+	*rt_prio = param.sched_priority;
+	if (param.sched_priority)
+		sched_setscheduler_nocheck(current, SCHED_FIFO, &param);
+	else
+		sched_setscheduler_nocheck(current, SCHED_NORMAL, &param);
+}
+
+/*
+ * Idle spinning before sq_thread_idle runs out is limited to
+ * sq_thread_budget percent of each IORING_SQPOLL_BUDGET_PERIOD_NS, the rest
+ * of the period is slept. Without IORING_SQ_NEED_WAKEUP set, so that the
+ * application doesn't have to enter the kernel: new SQEs wait for the end of
+ * the period instead.
+ */
+static void io_sq_thread_throttle(struct io_sq_data *sqd, u64 *spin_start)
+{
+	u64 now = ktime_get_ns();
+	u64 budget;
+	ktime_t rest;
+
+	if (!*spin_start) {
+		*spin_start = now;
+		return;
+	}
+
+	budget = div_u64(IORING_SQPOLL_BUDGET_PERIOD_NS * sqd->sq_thread_budget,
+			 100);
+	if (now - *spin_start < budget)
+		return;
+
+	if (now - *spin_start < IORING_SQPOLL_BUDGET_PERIOD_NS) {
+		rest = ns_to_ktime(*spin_start + IORING_SQPOLL_BUDGET_PERIOD_NS -
+				   now);
+		sqd->nr_throttled++;
+		mutex_unlock(&sqd->lock);
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule_hrtimeout(&rest, HRTIMER_MODE_REL);
+		mutex_lock(&sqd->lock);
+	}
+	*spin_start = 0;
+}
+
+static void io_sq_thread_account_wake(struct io_sq_data *sqd)
+{
+	u64 wake_time = READ_ONCE(sqd->wake_time);
+	u64 lat;
+
+	if (!wake_time)
+		return;
+
+	WRITE_ONCE(sqd->wake_time, 0);
+	lat = ktime_get_ns() - wake_time;
+	sqd->wake_lat_total += lat;
+	sqd->wake_lat_max = max(sqd->wake_lat_max, lat);
+	sqd->nr_wakes++;
+}
+
 static int io_sq_thread(void *data)
 {
 	struct io_sq_data *sqd = data;
 	struct io_ring_ctx *ctx;
 	unsigned long timeout = 0;
+	unsigned int rt_prio = 0;
+	u64 spin_start = 0;
 	char buf[TASK_COMM_LEN];
 	DEFINE_WAIT(wait);
 
@@ -236,12 +331,14 @@ static int io_sq_thread(void *data)
 	current->flags |= PF_NO_SETAFFINITY;
 
 	mutex_lock(&sqd->lock);
+	io_sq_thread_update_sched(sqd, &rt_prio);
 	while (1) {
 		bool cap_entries, sqt_spin = false;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
+			io_sq_thread_update_sched(sqd, &rt_prio);
 			timeout = jiffies + sqd->sq_thread_idle;
 		}
 
@@ -256,8 +353,12 @@ static int io_sq_thread(void *data)
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
-			if (sqt_spin)
+			if (sqt_spin) {
 				timeout = jiffies + sqd->sq_thread_idle;
+				spin_start = 0;
+			} else if (sqd->sq_thread_budget) {
+				io_sq_thread_throttle(sqd, &spin_start);
+			}
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -270,6 +371,9 @@ static int io_sq_thread(void *data)
 		if (!io_sqd_events_pending(sqd) && !task_work_pending(current)) {
 			bool needs_sched = true;
 
+			/* Only count wakeups asked for after this point */
+			WRITE_ONCE(sqd->wake_time, 0);
+
 			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 				atomic_or(IORING_SQ_NEED_WAKEUP,
 						&ctx->rings->sq_flags);
@@ -295,6 +399,7 @@ static int io_sq_thread(void *data)
 				mutex_unlock(&sqd->lock);
 				schedule();
 				mutex_lock(&sqd->lock);
+				io_sq_thread_account_wake(sqd);
 			}
 			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
 				atomic_andnot(IORING_SQ_NEED_WAKEUP,
@@ -303,6 +408,7 @@ static int io_sq_thread(void *data)
 
 		finish_wait(&sqd->wait, &wait);
 		timeout = jiffies + sqd->sq_thread_idle;
+		spin_start = 0;
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -362,6 +468,14 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		if (ret)
 			return ret;
 
+		/* Same rules as sched_setscheduler() for the thread's prio */
+		if (p->sq_thread_rt_prio >= MAX_RT_PRIO ||
+		    p->sq_thread_budget > 100)
+			return -EINVAL;
+		if (p->sq_thread_rt_prio && !capable(CAP_SYS_NICE) &&
+		    p->sq_thread_rt_prio > task_rlimit(current, RLIMIT_RTPRIO))
+			return -EPERM;
+
 		sqd = io_get_sq_data(p, &attached);
 		if (IS_ERR(sqd)) {
 			ret = PTR_ERR(sqd);
@@ -373,10 +487,12 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_thread_rt_prio = p->sq_thread_rt_prio;
+		ctx->sq_thread_budget = p->sq_thread_budget;
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
-		io_sqd_update_thread_idle(sqd);
+		io_sqd_update_thread_params(sqd);
 		/* don't attach to a dying SQPOLL thread, would be racy */
 		ret = (attached && !sqd->thread) ? -ENXIO : 0;
 		io_sq_thread_unpark(sqd);
@@ -410,8 +526,8 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		wake_up_new_task(tsk);
 		if (ret)
 			goto err;
-	} else if (p->flags & IORING_SETUP_SQ_AFF) {
-		/* Can't have SQ_AFF without SQPOLL */
+	} else if (p->flags & (IORING_SETUP_SQ_AFF | IORING_SETUP_SQ_SCHED)) {
+		/* Can't have SQ_AFF or SQ_SCHED without SQPOLL */
 		ret = -EINVAL;
 		goto err;
 	}
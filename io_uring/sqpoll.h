@@ -12,12 +12,22 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	unsigned		sq_thread_rt_prio;
+	unsigned		sq_thread_budget;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
 
 	unsigned long		state;
 	struct completion	exited;
+
+	/* wakeups requested with IORING_ENTER_SQ_WAKEUP, their latency in ns */
+	u64			wake_time;
+	u64			wake_lat_total;
+	u64			wake_lat_max;
+	unsigned long		nr_wakes;
+	/* times idle spinning went over sq_thread_budget */
+	unsigned long		nr_throttled;
 };
 
 int io_sq_offload_create(struct io_ring_ctx *ctx, struct io_uring_params *p);
@@ -26,5 +36,6 @@ void io_sq_thread_stop(struct io_sq_data *sqd);
 void io_sq_thread_park(struct io_sq_data *sqd);
 void io_sq_thread_unpark(struct io_sq_data *sqd);
 void io_put_sq_data(struct io_sq_data *sqd);
+void io_sqpoll_wake(struct io_sq_data *sqd);
 int io_sqpoll_wait_sq(struct io_ring_ctx *ctx);
 int io_sqpoll_wq_cpu_affinity(struct io_ring_ctx *ctx, cpumask_var_t mask);
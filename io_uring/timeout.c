@@ -330,6 +330,8 @@ static clockid_t io_timeout_get_clock(struct io_timeout_data *data)
 		return CLOCK_BOOTTIME;
 	case IORING_TIMEOUT_REALTIME:
 		return CLOCK_REALTIME;
+	case IORING_TIMEOUT_REFCLOCK:
+		return CLOCK_MONOTONIC;
 	default:
 		/* can't happen, vetted at prep time */
 		WARN_ON_ONCE(1);
@@ -339,6 +341,43 @@ static clockid_t io_timeout_get_clock(struct io_timeout_data *data)
 	}
 }
 
+/*
+ * Converts the time of an IORING_TIMEOUT_REFCLOCK timeout to CLOCK_MONOTONIC,
+ * with the clock registered at the time it gets armed.
+ */
+static ktime_t io_ref_clock_to_mono(struct io_ring_ctx *ctx,
+				    struct timespec64 *ts,
+				    enum hrtimer_mode mode)
+	__must_hold(&ctx->timeout_lock)
+{
+	const struct io_uring_ref_clock *clk = &ctx->ref_clock;
+	u64 t = timespec64_to_ns(ts);
+	u64 delta;
+
+	if (mode == HRTIMER_MODE_REL)
+		return mul_u64_u32_div(t, clk->mono_mul, clk->mono_div);
+
+	if (t < clk->ref_ns) {
+		delta = mul_u64_u32_div(clk->ref_ns - t, clk->mono_mul,
+					clk->mono_div);
+		/* already expired */
+		return delta < clk->mono_ns ? clk->mono_ns - delta : 0;
+	}
+
+	delta = mul_u64_u32_div(t - clk->ref_ns, clk->mono_mul, clk->mono_div);
+	return min_t(u64, clk->mono_ns + delta, KTIME_MAX);
+}
+
+static ktime_t io_timeout_expiry(struct io_ring_ctx *ctx,
+				 struct io_timeout_data *data,
+				 struct timespec64 *ts, enum hrtimer_mode mode)
+	__must_hold(&ctx->timeout_lock)
+{
+	if (data->flags & IORING_TIMEOUT_REFCLOCK)
+		return io_ref_clock_to_mono(ctx, ts, mode);
+	return timespec64_to_ktime(*ts);
+}
+
 static int io_linked_timeout_update(struct io_ring_ctx *ctx, __u64 user_data,
 				    struct timespec64 *ts, enum hrtimer_mode mode)
 	__must_hold(&ctx->timeout_lock)
@@ -363,7 +402,7 @@ static int io_linked_timeout_update(struct io_ring_ctx *ctx, __u64 user_data,
 		return -EALREADY;
 	hrtimer_init(&io->timer, io_timeout_get_clock(io), mode);
 	io->timer.function = io_link_timeout_fn;
-	hrtimer_start(&io->timer, timespec64_to_ktime(*ts), mode);
+	hrtimer_start(&io->timer, io_timeout_expiry(ctx, io, ts, mode), mode);
 	return 0;
 }
 
@@ -384,7 +423,8 @@ static int io_timeout_update(struct io_ring_ctx *ctx, __u64 user_data,
 	list_add_tail(&timeout->list, &ctx->timeout_list);
 	hrtimer_init(&data->timer, io_timeout_get_clock(data), mode);
 	data->timer.function = io_timeout_fn;
-	hrtimer_start(&data->timer, timespec64_to_ktime(*ts), mode);
+	hrtimer_start(&data->timer, io_timeout_expiry(ctx, data, ts, mode),
+		      mode);
 	return 0;
 }
 
@@ -477,6 +517,10 @@ static int __io_timeout_prep(struct io_kiocb *req,
 	/* more than one clock specified is invalid, obviously */
 	if (hweight32(flags & IORING_TIMEOUT_CLOCK_MASK) > 1)
 		return -EINVAL;
+	/* there's no unregistering it, once set */
+	if ((flags & IORING_TIMEOUT_REFCLOCK) &&
+	    !READ_ONCE(req->ctx->ref_clock.mono_div))
+		return -EINVAL;
 
 	INIT_LIST_HEAD(&timeout->list);
 	timeout->off = off;
@@ -571,7 +615,9 @@ int io_timeout(struct io_kiocb *req, unsigned int issue_flags)
 add:
 	list_add(&timeout->list, entry);
 	data->timer.function = io_timeout_fn;
-	hrtimer_start(&data->timer, timespec64_to_ktime(data->ts), data->mode);
+	hrtimer_start(&data->timer,
+		      io_timeout_expiry(ctx, data, &data->ts, data->mode),
+		      data->mode);
 	spin_unlock_irq(&ctx->timeout_lock);
 	return IOU_ISSUE_SKIP_COMPLETE;
 }
@@ -590,8 +636,10 @@ void io_queue_linked_timeout(struct io_kiocb *req)
 		struct io_timeout_data *data = req->async_data;
 
 		data->timer.function = io_link_timeout_fn;
-		hrtimer_start(&data->timer, timespec64_to_ktime(data->ts),
-				data->mode);
+		hrtimer_start(&data->timer,
+			      io_timeout_expiry(ctx, data, &data->ts,
+						data->mode),
+			      data->mode);
 		list_add_tail(&timeout->list, &ctx->ltimeout_list);
 	}
 	spin_unlock_irq(&ctx->timeout_lock);
@@ -637,3 +685,18 @@ __cold bool io_kill_timeouts(struct io_ring_ctx *ctx, struct task_struct *tsk,
 	io_cq_unlock_post(ctx);
 	return canceled != 0;
 }
+
+int io_register_ref_clock(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_ref_clock clk;
+
+	if (copy_from_user(&clk, arg, sizeof(clk)))
+		return -EFAULT;
+	if (!clk.mono_mul || !clk.mono_div || clk.resv[0] || clk.resv[1])
+		return -EINVAL;
+
+	spin_lock_irq(&ctx->timeout_lock);
+	ctx->ref_clock = clk;
+	spin_unlock_irq(&ctx->timeout_lock);
+	return 0;
+}
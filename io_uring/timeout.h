@@ -34,3 +34,4 @@ int io_link_timeout_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
 int io_timeout(struct io_kiocb *req, unsigned int issue_flags);
 int io_timeout_remove_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
 int io_timeout_remove(struct io_kiocb *req, unsigned int issue_flags);
+int io_register_ref_clock(struct io_ring_ctx *ctx, void __user *arg);
@@ -401,6 +401,44 @@ __local_list_pop_pending(struct bpf_lru *lru, struct bpf_lru_locallist *loc_l)
 	return NULL;
 }
 
+/*
+ * Move up to PERCPU_FREE_TARGET free nodes from the first other CPU that
+ * has some to @cpu's list @l, whose lock is held. The other CPUs' locks
+ * are only tried, and their free lists checked before that, so a full
+ * map costs a few reads of remote cachelines and no lock contention.
+ */
+static void bpf_percpu_lru_steal_free(struct bpf_lru *lru,
+				      struct bpf_lru_list *l, int cpu)
+{
+	struct list_head *free_list = &l->lists[BPF_LRU_LIST_T_FREE];
+	struct bpf_lru_node *node, *tmp_node;
+	unsigned int nfree = 0;
+	int steal;
+
+	for (steal = get_next_cpu(cpu); steal != cpu;
+	     steal = get_next_cpu(steal)) {
+		struct bpf_lru_list *steal_l;
+		struct list_head *steal_free;
+
+		steal_l = per_cpu_ptr(lru->percpu_lru, steal);
+		steal_free = &steal_l->lists[BPF_LRU_LIST_T_FREE];
+		if (list_empty(steal_free) || !raw_spin_trylock(&steal_l->lock))
+			continue;
+
+		list_for_each_entry_safe(node, tmp_node, steal_free, list) {
+			node->cpu = cpu;
+			list_move(&node->list, free_list);
+			if (++nfree == PERCPU_FREE_TARGET)
+				break;
+		}
+
+		raw_spin_unlock(&steal_l->lock);
+
+		if (nfree)
+			return;
+	}
+}
+
 static struct bpf_lru_node *bpf_percpu_lru_pop_free(struct bpf_lru *lru,
 						    u32 hash)
 {
@@ -417,6 +455,9 @@ static struct bpf_lru_node *bpf_percpu_lru_pop_free(struct bpf_lru *lru,
 	__bpf_lru_list_rotate(lru, l);
 
 	free_list = &l->lists[BPF_LRU_LIST_T_FREE];
+	if (list_empty(free_list) && lru->share_free)
+		bpf_percpu_lru_steal_free(lru, l, cpu);
+
 	if (list_empty(free_list))
 		__bpf_lru_list_shrink(lru, l, PERCPU_FREE_TARGET, free_list,
 				      BPF_LRU_LIST_T_FREE);
@@ -648,8 +689,9 @@ static void bpf_lru_list_init(struct bpf_lru_list *l)
 	raw_spin_lock_init(&l->lock);
 }
 
-int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
-		 del_from_htab_func del_from_htab, void *del_arg)
+int bpf_lru_init(struct bpf_lru *lru, bool percpu, bool share_free,
+		 u32 hash_offset, del_from_htab_func del_from_htab,
+		 void *del_arg)
 {
 	int cpu;
 
@@ -684,6 +726,7 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 	}
 
 	lru->percpu = percpu;
+	lru->share_free = percpu && share_free;
 	lru->del_from_htab = del_from_htab;
 	lru->del_arg = del_arg;
 	lru->hash_offset = hash_offset;
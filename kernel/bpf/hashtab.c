@@ -18,7 +18,7 @@
 
 #define HTAB_CREATE_FLAG_MASK						\
 	(BPF_F_NO_PREALLOC | BPF_F_NO_COMMON_LRU | BPF_F_NUMA_NODE |	\
-	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED)
+	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED | BPF_F_LRU_SHARE_FREE)
 
 #define BATCH_OPS(_name)			\
 	.map_lookup_batch =			\
@@ -335,6 +335,7 @@ static int prealloc_init(struct bpf_htab *htab)
 	if (htab_is_lru(htab))
 		err = bpf_lru_init(&htab->lru,
 				   htab->map.map_flags & BPF_F_NO_COMMON_LRU,
+				   htab->map.map_flags & BPF_F_LRU_SHARE_FREE,
 				   offsetof(struct htab_elem, hash) -
 				   offsetof(struct htab_elem, lru_node),
 				   htab_lru_map_delete_node,
@@ -431,6 +432,9 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	if (!lru && percpu_lru)
 		return -EINVAL;
 
+	if (!percpu_lru && (attr->map_flags & BPF_F_LRU_SHARE_FREE))
+		return -EINVAL;
+
 	if (lru && !prealloc)
 		return -ENOTSUPP;
 
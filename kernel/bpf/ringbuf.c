@@ -12,7 +12,7 @@
 #include <uapi/linux/btf.h>
 #include <linux/btf_ids.h>
 
-#define RINGBUF_CREATE_FLAG_MASK (BPF_F_NUMA_NODE)
+#define RINGBUF_CREATE_FLAG_MASK (BPF_F_NUMA_NODE | BPF_F_RB_OVERWRITE)
 
 /* non-mmap()'able part of bpf_ringbuf (everything up to consumer page) */
 #define RINGBUF_PGOFF \
@@ -37,6 +37,10 @@ struct bpf_ringbuf {
 	u64 mask;
 	struct page **pages;
 	int nr_pages;
+	/* BPF_F_RB_OVERWRITE */
+	bool overwrite;
+	/* map_extra: adaptive wakeups once more than this is pending */
+	u32 wakeup_thresh;
 	spinlock_t spinlock ____cacheline_aligned_in_smp;
 	/* For user-space producer ring buffers, an atomic_t busy bit is used
 	 * to synchronize access to the ring buffers in the kernel, rather than
@@ -75,9 +79,20 @@ struct bpf_ringbuf {
 	 * communicate to the kernel, but the kernel must carefully check and
 	 * validate each sample to ensure that they're correctly formatted, and
 	 * fully contained within the ring buffer.
+	 *
+	 * Overwriting kernel-producer
+	 * ---------------------------
+	 * With BPF_F_RB_OVERWRITE, producers overwrite the oldest records
+	 * rather than fail when the ring is full, and overwrite_pos is where
+	 * the oldest record left starts. consumer_pos is only written by
+	 * user-space to release a snapshot: while snapshot_pos is ahead of
+	 * it, the records from overwrite_pos to snapshot_pos are kept as they
+	 * are and new ones are dropped.
 	 */
 	unsigned long consumer_pos __aligned(PAGE_SIZE);
 	unsigned long producer_pos __aligned(PAGE_SIZE);
+	unsigned long overwrite_pos;
+	unsigned long snapshot_pos;
 	char data[] __aligned(PAGE_SIZE);
 };
 
@@ -160,7 +175,8 @@ static void bpf_ringbuf_notify(struct irq_work *work)
 	wake_up_all(&rb->waitq);
 }
 
-static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
+static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node,
+					     bool overwrite, u32 wakeup_thresh)
 {
 	struct bpf_ringbuf *rb;
 
@@ -176,6 +192,10 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	rb->mask = data_sz - 1;
 	rb->consumer_pos = 0;
 	rb->producer_pos = 0;
+	rb->overwrite_pos = 0;
+	rb->snapshot_pos = 0;
+	rb->overwrite = overwrite;
+	rb->wakeup_thresh = wakeup_thresh;
 
 	return rb;
 }
@@ -192,6 +212,13 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 	    !PAGE_ALIGNED(attr->max_entries))
 		return ERR_PTR(-EINVAL);
 
+	/* Only kernel producers overwrite, and wake up on snapshots only */
+	if ((attr->map_flags & BPF_F_RB_OVERWRITE) &&
+	    (attr->map_type != BPF_MAP_TYPE_RINGBUF || attr->map_extra))
+		return ERR_PTR(-EINVAL);
+	if (attr->map_extra >= attr->max_entries)
+		return ERR_PTR(-EINVAL);
+
 #ifdef CONFIG_64BIT
 	/* on 32-bit arch, it's impossible to overflow record's hdr->pgoff */
 	if (attr->max_entries > RINGBUF_MAX_DATA_SZ)
@@ -204,7 +231,9 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 
 	bpf_map_init_from_attr(&rb_map->map, attr);
 
-	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, rb_map->map.numa_node);
+	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, rb_map->map.numa_node,
+				       attr->map_flags & BPF_F_RB_OVERWRITE,
+				       attr->map_extra);
 	if (!rb_map->rb) {
 		bpf_map_area_free(rb_map);
 		return ERR_PTR(-ENOMEM);
@@ -310,15 +339,33 @@ static u32 ringbuf_total_data_sz(const struct bpf_ringbuf *rb)
 	return rb->mask + 1;
 }
 
+/* Is a snapshot of an overwriting ring buffer waiting to be released? */
+static bool ringbuf_snapshot_pending(struct bpf_ringbuf *rb,
+				     unsigned long cons_pos)
+{
+	return (long)(smp_load_acquire(&rb->snapshot_pos) - cons_pos) > 0;
+}
+
 static __poll_t ringbuf_map_poll_kern(struct bpf_map *map, struct file *filp,
 				      struct poll_table_struct *pts)
 {
 	struct bpf_ringbuf_map *rb_map;
+	struct bpf_ringbuf *rb;
+	unsigned long cons_pos;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	poll_wait(filp, &rb_map->rb->waitq, pts);
+	rb = rb_map->rb;
+	poll_wait(filp, &rb->waitq, pts);
 
-	if (ringbuf_avail_data_sz(rb_map->rb))
+	if (rb->overwrite) {
+		cons_pos = smp_load_acquire(&rb->consumer_pos);
+		if (ringbuf_snapshot_pending(rb, cons_pos))
+			return EPOLLIN | EPOLLRDNORM;
+		return 0;
+	}
+
+	/* with a threshold, more than it has to be there, as for wakeups */
+	if (ringbuf_avail_data_sz(rb) > rb->wakeup_thresh)
 		return EPOLLIN | EPOLLRDNORM;
 	return 0;
 }
@@ -413,10 +460,36 @@ static void *__bpf_ringbuf_reserve(struct bpf_ringbuf *rb, u64 size)
 	prod_pos = rb->producer_pos;
 	new_prod_pos = prod_pos + len;
 
-	/* check for out of ringbuf space by ensuring producer position
-	 * doesn't advance more than (ringbuf_size - 1) ahead
-	 */
-	if (new_prod_pos - cons_pos > rb->mask) {
+	if (unlikely(rb->overwrite)) {
+		unsigned long over_pos = rb->overwrite_pos;
+
+		/* a snapshot is being read, leave it alone */
+		if (ringbuf_snapshot_pending(rb, cons_pos)) {
+			spin_unlock_irqrestore(&rb->spinlock, flags);
+			return NULL;
+		}
+
+		/* make room by dropping the oldest records, but never one
+		 * that is still being written
+		 */
+		while (new_prod_pos - over_pos > rb->mask) {
+			u32 hdr_len;
+
+			hdr = (void *)rb->data + (over_pos & rb->mask);
+			hdr_len = READ_ONCE(hdr->len);
+			if (hdr_len & BPF_RINGBUF_BUSY_BIT) {
+				spin_unlock_irqrestore(&rb->spinlock, flags);
+				return NULL;
+			}
+			hdr_len &= ~BPF_RINGBUF_DISCARD_BIT;
+			over_pos += round_up(hdr_len + BPF_RINGBUF_HDR_SZ, 8);
+		}
+		/* pairs with user-space's smp_load_acquire() */
+		smp_store_release(&rb->overwrite_pos, over_pos);
+	} else if (new_prod_pos - cons_pos > rb->mask) {
+		/* check for out of ringbuf space by ensuring producer
+		 * position doesn't advance more than (ringbuf_size - 1) ahead
+		 */
 		spin_unlock_irqrestore(&rb->spinlock, flags);
 		return NULL;
 	}
@@ -453,12 +526,35 @@ const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
 	.arg3_type	= ARG_ANYTHING,
 };
 
+/* Keep the records of an overwriting ring buffer, up to the last reserved
+ * one, until user-space releases them. The first snapshot taken wins.
+ */
+static void bpf_ringbuf_snapshot(struct bpf_ringbuf *rb)
+{
+	unsigned long cons_pos, flags;
+
+	if (in_nmi()) {
+		if (!spin_trylock_irqsave(&rb->spinlock, flags))
+			return;
+	} else {
+		spin_lock_irqsave(&rb->spinlock, flags);
+	}
+
+	cons_pos = smp_load_acquire(&rb->consumer_pos);
+	if (!ringbuf_snapshot_pending(rb, cons_pos))
+		smp_store_release(&rb->snapshot_pos, rb->producer_pos);
+
+	spin_unlock_irqrestore(&rb->spinlock, flags);
+
+	irq_work_queue(&rb->work);
+}
+
 static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 {
-	unsigned long rec_pos, cons_pos;
+	unsigned long rec_pos, cons_pos, pending;
 	struct bpf_ringbuf_hdr *hdr;
 	struct bpf_ringbuf *rb;
-	u32 new_len;
+	u32 new_len, rec_len;
 
 	hdr = sample - BPF_RINGBUF_HDR_SZ;
 	rb = bpf_ringbuf_restore_from_rec(hdr);
@@ -469,15 +565,30 @@ static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 	/* update record header with correct final size prefix */
 	xchg(&hdr->len, new_len);
 
-	/* if consumer caught up and is waiting for our record, notify about
-	 * new data availability
+	if (unlikely(rb->overwrite)) {
+		/* nobody is reading until there's a snapshot */
+		if (flags & BPF_RB_SNAPSHOT)
+			bpf_ringbuf_snapshot(rb);
+		else if (flags & BPF_RB_FORCE_WAKEUP)
+			irq_work_queue(&rb->work);
+		return;
+	}
+
+	/* if consumer caught up and is waiting for our record, or with a
+	 * wakeup threshold, if our record takes the amount of data pending
+	 * over it, notify about new data availability
 	 */
 	rec_pos = (void *)hdr - (void *)rb->data;
 	cons_pos = smp_load_acquire(&rb->consumer_pos) & rb->mask;
+	pending = (rec_pos - cons_pos) & rb->mask;
+	rec_len = round_up((new_len & ~BPF_RINGBUF_DISCARD_BIT) +
+			   BPF_RINGBUF_HDR_SZ, 8);
 
 	if (flags & BPF_RB_FORCE_WAKEUP)
 		irq_work_queue(&rb->work);
-	else if (cons_pos == rec_pos && !(flags & BPF_RB_NO_WAKEUP))
+	else if (pending <= rb->wakeup_thresh &&
+		 pending + rec_len > rb->wakeup_thresh &&
+		 !(flags & BPF_RB_NO_WAKEUP))
 		irq_work_queue(&rb->work);
 }
 
@@ -513,7 +624,8 @@ BPF_CALL_4(bpf_ringbuf_output, struct bpf_map *, map, void *, data, u64, size,
 	struct bpf_ringbuf_map *rb_map;
 	void *rec;
 
-	if (unlikely(flags & ~(BPF_RB_NO_WAKEUP | BPF_RB_FORCE_WAKEUP)))
+	if (unlikely(flags & ~(BPF_RB_NO_WAKEUP | BPF_RB_FORCE_WAKEUP |
+			       BPF_RB_SNAPSHOT)))
 		return -EINVAL;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
@@ -550,6 +662,8 @@ BPF_CALL_2(bpf_ringbuf_query, struct bpf_map *, map, u64, flags)
 		return smp_load_acquire(&rb->consumer_pos);
 	case BPF_RB_PROD_POS:
 		return smp_load_acquire(&rb->producer_pos);
+	case BPF_RB_OVERWRITE_POS:
+		return smp_load_acquire(&rb->overwrite_pos);
 	default:
 		return 0;
 	}
@@ -3822,6 +3822,23 @@ static ssize_t cgroup_irq_pressure_write(struct kernfs_open_file *of,
 }
 #endif
 
+#ifdef CONFIG_PSI_RT
+static int cgroup_rt_pressure_show(struct seq_file *seq, void *v)
+{
+	struct cgroup *cgrp = seq_css(seq)->cgroup;
+	struct psi_group *psi = cgroup_psi(cgrp);
+
+	return psi_show(seq, psi, PSI_RT);
+}
+
+static ssize_t cgroup_rt_pressure_write(struct kernfs_open_file *of,
+					char *buf, size_t nbytes,
+					loff_t off)
+{
+	return pressure_write(of, buf, nbytes, PSI_RT);
+}
+#endif
+
 static int cgroup_pressure_show(struct seq_file *seq, void *v)
 {
 	struct cgroup *cgrp = seq_css(seq)->cgroup;
@@ -5307,6 +5324,16 @@ static struct cftype cgroup_psi_files[] = {
 		.poll = cgroup_pressure_poll,
 		.release = cgroup_pressure_release,
 	},
+#endif
+#ifdef CONFIG_PSI_RT
+	{
+		.name = "rt.pressure",
+		.file_offset = offsetof(struct cgroup, psi_files[PSI_RT]),
+		.seq_show = cgroup_rt_pressure_show,
+		.write = cgroup_rt_pressure_write,
+		.poll = cgroup_pressure_poll,
+		.release = cgroup_pressure_release,
+	},
 #endif
 	{
 		.name = "cgroup.pressure",
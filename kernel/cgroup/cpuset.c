@@ -31,6 +31,8 @@
 #include <linux/fs.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/irqdesc.h>
 #include <linux/kernel.h>
 #include <linux/kmod.h>
 #include <linux/kthread.h>
@@ -66,6 +68,8 @@
 #include <linux/mutex.h>
 #include <linux/cgroup.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <linux/xarray.h>
 
 DEFINE_STATIC_KEY_FALSE(cpusets_pre_enable_key);
 DEFINE_STATIC_KEY_FALSE(cpusets_enabled_key);
@@ -277,6 +281,7 @@ typedef enum {
 	CS_SCHED_LOAD_BALANCE,
 	CS_SPREAD_PAGE,
 	CS_SPREAD_SLAB,
+	CS_ISOLATE_KERNEL,
 } cpuset_flagbits_t;
 
 /* convenient tests for these bits */
@@ -320,6 +325,11 @@ static inline int is_spread_slab(const struct cpuset *cs)
 	return test_bit(CS_SPREAD_SLAB, &cs->flags);
 }
 
+static inline int is_isolate_kernel(const struct cpuset *cs)
+{
+	return test_bit(CS_ISOLATE_KERNEL, &cs->flags);
+}
+
 static inline int is_partition_valid(const struct cpuset *cs)
 {
 	return cs->partition_root_state > 0;
@@ -448,6 +458,9 @@ static struct workqueue_struct *cpuset_migrate_mm_wq;
 static void cpuset_hotplug_workfn(struct work_struct *work);
 static DECLARE_WORK(cpuset_hotplug_work, cpuset_hotplug_workfn);
 
+static void cpuset_isolation_workfn(struct work_struct *work);
+static DECLARE_WORK(cpuset_isolation_work, cpuset_isolation_workfn);
+
 static DECLARE_WAIT_QUEUE_HEAD(cpuset_attach_wq);
 
 static inline void check_insane_mems_config(nodemask_t *nodes)
@@ -1173,6 +1186,9 @@ static void rebuild_sched_domains_locked(void)
 	lockdep_assert_cpus_held();
 	lockdep_assert_held(&cpuset_mutex);
 
+	/* Partitions may have changed, move IRQs and workqueues if needed */
+	schedule_work(&cpuset_isolation_work);
+
 	/*
 	 * If we have raced with CPU hotplug, return early to avoid
 	 * passing doms with offlined cpu to partition_sched_domains().
@@ -1228,6 +1244,140 @@ void rebuild_sched_domains(void)
 	cpus_read_unlock();
 }
 
+#ifdef CONFIG_SMP
+/*
+ * The CPUs of the valid isolated partitions that have isolate_kernel set.
+ * Unmanaged IRQs, the default IRQ affinity and unbound workqueues are kept
+ * off them. The IRQ affinities from before are saved in isolated_irqs, by
+ * IRQ number, and restored once none of their CPUs are isolated anymore.
+ * All of these are only used by cpuset_isolation_work.
+ */
+static cpumask_var_t isolated_kernel_cpus;
+static cpumask_var_t isolation_tmp;
+static cpumask_var_t isolation_housekeeping;
+static DEFINE_XARRAY(isolated_irqs);
+static cpumask_var_t saved_irq_default_affinity;
+static bool irq_default_affinity_saved;
+
+static void cpuset_isolate_irq(unsigned int irq, const struct cpumask *isolated)
+{
+	struct irq_data *d = irq_get_irq_data(irq);
+	struct cpumask *saved = xa_load(&isolated_irqs, irq);
+	const struct cpumask *mask;
+
+	if (!d || irqd_affinity_is_managed(d) || !irqd_can_balance(d) ||
+	    !irq_can_set_affinity(irq))
+		mask = NULL;
+	else
+		mask = saved ?: irq_get_affinity_mask(irq);
+
+	if (!mask || !cpumask_intersects(mask, isolated)) {
+		if (saved) {
+			if (mask)
+				irq_set_affinity(irq, saved);
+			xa_erase(&isolated_irqs, irq);
+			kfree(saved);
+		}
+		return;
+	}
+
+	if (!saved) {
+		saved = kmalloc(cpumask_size(), GFP_KERNEL);
+		if (!saved)
+			return;
+		cpumask_copy(saved, mask);
+		if (xa_err(xa_store(&isolated_irqs, irq, saved, GFP_KERNEL))) {
+			kfree(saved);
+			return;
+		}
+	}
+
+	if (!cpumask_andnot(isolation_tmp, saved, isolated))
+		cpumask_copy(isolation_tmp, isolation_housekeeping);
+	irq_set_affinity(irq, isolation_tmp);
+}
+
+static void cpuset_isolate_irqs(const struct cpumask *isolated)
+{
+	struct cpumask *saved;
+	unsigned int irq;
+	unsigned long idx;
+
+	/* IRQs requested from now on */
+	if (!cpumask_empty(isolated)) {
+		if (!irq_default_affinity_saved) {
+			cpumask_copy(saved_irq_default_affinity,
+				     irq_default_affinity);
+			irq_default_affinity_saved = true;
+		}
+		if (!cpumask_andnot(irq_default_affinity,
+				    saved_irq_default_affinity, isolated))
+			cpumask_copy(irq_default_affinity,
+				     isolation_housekeeping);
+	} else if (irq_default_affinity_saved) {
+		cpumask_copy(irq_default_affinity, saved_irq_default_affinity);
+		irq_default_affinity_saved = false;
+	}
+
+	irq_lock_sparse();
+	for_each_active_irq(irq)
+		cpuset_isolate_irq(irq, isolated);
+	irq_unlock_sparse();
+
+	/* Those left over were freed while their CPUs were isolated */
+	if (cpumask_empty(isolated)) {
+		xa_for_each(&isolated_irqs, idx, saved) {
+			xa_erase(&isolated_irqs, idx);
+			kfree(saved);
+		}
+	}
+}
+
+/*
+ * Move what the kernel itself runs on any CPU off the isolated partitions
+ * that asked for it, or back once they are gone. Runs from a work item,
+ * as neither can be done under cpuset_mutex.
+ */
+static void cpuset_isolation_workfn(struct work_struct *work)
+{
+	struct cgroup_subsys_state *pos_css;
+	struct cpuset *cs;
+
+	cpumask_clear(isolation_tmp);
+	mutex_lock(&cpuset_mutex);
+	rcu_read_lock();
+	cpuset_for_each_descendant_pre(cs, pos_css, &top_cpuset) {
+		if (cs->partition_root_state == PRS_ISOLATED &&
+		    is_isolate_kernel(cs))
+			cpumask_or(isolation_tmp, isolation_tmp,
+				   cs->effective_cpus);
+	}
+	rcu_read_unlock();
+	mutex_unlock(&cpuset_mutex);
+
+	if (cpumask_equal(isolation_tmp, isolated_kernel_cpus))
+		return;
+	cpumask_copy(isolated_kernel_cpus, isolation_tmp);
+
+	cpumask_andnot(isolation_housekeeping, cpu_online_mask,
+		       isolated_kernel_cpus);
+	if (cpumask_empty(isolation_housekeeping))
+		cpumask_copy(isolation_housekeeping, cpu_online_mask);
+
+	cpuset_isolate_irqs(isolated_kernel_cpus);
+
+	/* The default unbound cpumask, without the isolated CPUs */
+	cpumask_and(isolation_tmp, housekeeping_cpumask(HK_TYPE_WQ),
+		    housekeeping_cpumask(HK_TYPE_DOMAIN));
+	if (cpumask_andnot(isolation_tmp, isolation_tmp, isolated_kernel_cpus))
+		workqueue_set_unbound_cpumask(isolation_tmp);
+}
+#else /* !CONFIG_SMP */
+static void cpuset_isolation_workfn(struct work_struct *work)
+{
+}
+#endif /* CONFIG_SMP */
+
 /**
  * update_tasks_cpumask - Update the cpumasks of tasks in the cpuset.
  * @cs: the cpuset in which each task's cpus_allowed mask needs to be changed
@@ -2711,6 +2861,7 @@ typedef enum {
 	FILE_MEMORY_PRESSURE,
 	FILE_SPREAD_PAGE,
 	FILE_SPREAD_SLAB,
+	FILE_ISOLATE_KERNEL,
 } cpuset_filetype_t;
 
 static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
@@ -2752,6 +2903,11 @@ static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
 	case FILE_SPREAD_SLAB:
 		retval = update_flag(CS_SPREAD_SLAB, cs, val);
 		break;
+	case FILE_ISOLATE_KERNEL:
+		retval = update_flag(CS_ISOLATE_KERNEL, cs, val);
+		if (!retval)
+			schedule_work(&cpuset_isolation_work);
+		break;
 	default:
 		retval = -EINVAL;
 		break;
@@ -2919,6 +3075,8 @@ static u64 cpuset_read_u64(struct cgroup_subsys_state *css, struct cftype *cft)
 		return is_spread_page(cs);
 	case FILE_SPREAD_SLAB:
 		return is_spread_slab(cs);
+	case FILE_ISOLATE_KERNEL:
+		return is_isolate_kernel(cs);
 	default:
 		BUG();
 	}
@@ -3158,6 +3316,14 @@ static struct cftype dfl_files[] = {
 		.file_offset = offsetof(struct cpuset, partition_file),
 	},
 
+	{
+		.name = "cpus.isolate_kernel",
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_ISOLATE_KERNEL,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+
 	{
 		.name = "cpus.subpartitions",
 		.seq_show = cpuset_common_seq_show,
@@ -3482,6 +3648,12 @@ int __init cpuset_init(void)
 	top_cpuset.relax_domain_level = -1;
 
 	BUG_ON(!alloc_cpumask_var(&cpus_attach, GFP_KERNEL));
+#ifdef CONFIG_SMP
+	BUG_ON(!zalloc_cpumask_var(&isolated_kernel_cpus, GFP_KERNEL));
+	BUG_ON(!alloc_cpumask_var(&isolation_tmp, GFP_KERNEL));
+	BUG_ON(!alloc_cpumask_var(&isolation_housekeeping, GFP_KERNEL));
+	BUG_ON(!alloc_cpumask_var(&saved_irq_default_affinity, GFP_KERNEL));
+#endif
 
 	return 0;
 }
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Latency profiles for interrupt threads
+ *
+ * Drivers tell which class of device an interrupt serves with
+ * irq_set_latency_class(). The irq_latency= boot parameter then gives
+ * each class a SCHED_FIFO priority for its interrupt threads, and
+ * optionally the CPUs it is to run on:
+ *
+ *	irq_latency=audio:90@2,usb:80@2,storage:40@3
+ *
+ * The interrupts of a class that isn't listed are left alone.
+ */
+
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/irqdesc.h>
+#include <linux/sched.h>
+#include <linux/sched/prio.h>
+#include <linux/string.h>
+
+#include <uapi/linux/sched/types.h>
+
+struct irq_latency_profile {
+	/* 0 keeps the default priority */
+	unsigned int prio;
+	/* Empty keeps the default affinity */
+	struct cpumask cpus;
+};
+
+static const char * const irq_latency_class_names[] = {
+	[IRQ_LATENCY_AUDIO]	= "audio",
+	[IRQ_LATENCY_USB]	= "usb",
+	[IRQ_LATENCY_STORAGE]	= "storage",
+};
+
+static struct irq_latency_profile irq_latency_profiles[IRQ_LATENCY_NR_CLASSES]
+	__ro_after_init;
+
+static int __init irq_latency_setup(char *str)
+{
+	char *entry;
+
+	while ((entry = strsep(&str, ",")) != NULL) {
+		struct irq_latency_profile *profile;
+		char *name = strsep(&entry, ":");
+		unsigned int prio;
+		char *cpus;
+		int class;
+
+		class = match_string(irq_latency_class_names,
+				     ARRAY_SIZE(irq_latency_class_names), name);
+		if (class < 0 || !entry)
+			goto bad;
+		profile = &irq_latency_profiles[class];
+
+		cpus = strchr(entry, '@');
+		if (cpus)
+			*cpus++ = '\0';
+
+		if (kstrtouint(entry, 10, &prio) || !prio ||
+		    prio >= MAX_RT_PRIO)
+			goto bad;
+		if (cpus && cpulist_parse(cpus, &profile->cpus)) {
+			cpumask_clear(&profile->cpus);
+			goto bad;
+		}
+
+		profile->prio = prio;
+		continue;
+bad:
+		pr_warn("irq_latency: ignoring profile for '%s'\n", name);
+	}
+
+	return 0;
+}
+early_param("irq_latency", irq_latency_setup);
+
+static void irq_latency_apply_thread(struct task_struct *t,
+				     const struct irq_latency_profile *profile,
+				     bool move)
+{
+	struct sched_param param = { .sched_priority = profile->prio };
+
+	if (!t)
+		return;
+
+	if (profile->prio)
+		sched_setscheduler_nocheck(t, SCHED_FIFO, &param);
+	if (move)
+		set_cpus_allowed_ptr(t, &profile->cpus);
+}
+
+/**
+ * irq_set_latency_class - Apply the latency profile of a device class
+ * @irq:	Interrupt line, already requested
+ * @class:	Class of the device behind it
+ *
+ * Sets the priority of the threads of @irq, and its affinity, as the
+ * irq_latency= boot parameter asks for @class. If the interrupt
+ * controller can't route the line on its own, only the threads are
+ * moved.
+ */
+int irq_set_latency_class(unsigned int irq, enum irq_latency_class class)
+{
+	const struct irq_latency_profile *profile;
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irqaction *action;
+	bool move = false;
+
+	if (!desc || class >= IRQ_LATENCY_NR_CLASSES)
+		return -EINVAL;
+
+	profile = &irq_latency_profiles[class];
+	if (!profile->prio && cpumask_empty(&profile->cpus))
+		return 0;
+
+	if (cpumask_intersects(&profile->cpus, cpu_online_mask))
+		move = irq_set_affinity(irq, &profile->cpus) != 0;
+
+	/* The threads follow the affinity of the line when it is set */
+	mutex_lock(&desc->request_mutex);
+	for (action = desc->action; action; action = action->next) {
+		irq_latency_apply_thread(action->thread, profile, move);
+		if (action->secondary)
+			irq_latency_apply_thread(action->secondary->thread,
+						 profile, move);
+	}
+	mutex_unlock(&desc->request_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_latency_class);
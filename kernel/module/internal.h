@@ -65,6 +65,8 @@ struct load_info {
 	unsigned long symoffs, stroffs, init_typeoffs, core_typeoffs;
 	struct _ddebug_info dyndbg;
 	bool sig_ok;
+	/* loaded with MODULE_INIT_BATCH and not yet fully formed */
+	bool batch;
 #ifdef CONFIG_KALLSYMS
 	unsigned long mod_kallsyms_init_off;
 #endif
@@ -126,6 +126,12 @@ core_param(nomodule, modules_disabled, bint, 0);
 /* Waiting for a module to finish initializing? */
 static DECLARE_WAIT_QUEUE_HEAD(module_wq);
 
+/*
+ * The MODULE_INIT_BATCH loads which may still export symbols: they are
+ * not fully formed yet, and are not waiting for a symbol themselves.
+ */
+static atomic_t module_batch_active = ATOMIC_INIT(0);
+
 static BLOCKING_NOTIFIER_HEAD(module_notify_list);
 
 int register_module_notifier(struct notifier_block *nb)
@@ -1127,6 +1133,56 @@ resolve_symbol_wait(struct module *mod,
 	return ksym;
 }
 
+/*
+ * A symbol a batch module needs may come from another module of the batch
+ * that is still being read or decompressed.  Wait until it is exported,
+ * or until no module of the batch is left that could export it.
+ */
+static const struct kernel_symbol *
+resolve_symbol_batch(struct module *mod,
+		     const struct load_info *info,
+		     const char *name)
+{
+	const struct kernel_symbol *ksym = NULL;
+	char owner[MODULE_NAME_LEN];
+
+	atomic_dec(&module_batch_active);
+	wake_up_all(&module_wq);
+
+	if (wait_event_interruptible_timeout(module_wq,
+			(ksym = resolve_symbol(mod, info, name, owner))
+			|| !atomic_read(&module_batch_active),
+					     30 * HZ) <= 0) {
+		pr_warn("%s: gave up waiting for the batch to export %s.\n",
+			mod->name, name);
+	}
+
+	atomic_inc(&module_batch_active);
+
+	/* The owner is found, but it has not finished its init yet */
+	if (IS_ERR(ksym) && PTR_ERR(ksym) == -EBUSY)
+		ksym = resolve_symbol_wait(mod, info, name);
+
+	return ksym;
+}
+
+static void module_batch_enter(struct load_info *info)
+{
+	info->batch = true;
+	atomic_inc(&module_batch_active);
+}
+
+/* The module has exported its symbols, or has failed to load. */
+static void module_batch_done(struct load_info *info)
+{
+	if (!info->batch)
+		return;
+
+	info->batch = false;
+	atomic_dec(&module_batch_active);
+	wake_up_all(&module_wq);
+}
+
 void __weak module_memfree(void *module_region)
 {
 	/*
@@ -1323,6 +1379,9 @@ static int simplify_symbols(struct module *mod, const struct load_info *info)
 
 		case SHN_UNDEF:
 			ksym = resolve_symbol_wait(mod, info, name);
+			if (!ksym && info->batch &&
+			    ELF_ST_BIND(sym[i].st_info) != STB_WEAK)
+				ksym = resolve_symbol_batch(mod, info, name);
 			/* Ok if resolved.  */
 			if (ksym && !IS_ERR(ksym)) {
 				sym[i].st_value = kernel_symbol_value(ksym);
@@ -2832,6 +2891,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 
 	/* Finally it's fully formed, ready to start executing. */
 	err = complete_formation(mod, info);
+	module_batch_done(info);
 	if (err)
 		goto ddebug_cleanup;
 
@@ -2952,25 +3012,35 @@ SYSCALL_DEFINE3(finit_module, int, fd, const char __user *, uargs, int, flags)
 
 	if (flags & ~(MODULE_INIT_IGNORE_MODVERSIONS
 		      |MODULE_INIT_IGNORE_VERMAGIC
-		      |MODULE_INIT_COMPRESSED_FILE))
+		      |MODULE_INIT_COMPRESSED_FILE
+		      |MODULE_INIT_BATCH))
 		return -EINVAL;
 
+	/* From here the other modules of the batch wait for this one */
+	if (flags & MODULE_INIT_BATCH)
+		module_batch_enter(&info);
+
 	len = kernel_read_file_from_fd(fd, 0, &buf, INT_MAX, NULL,
 				       READING_MODULE);
-	if (len < 0)
-		return len;
+	if (len < 0) {
+		err = len;
+		goto out;
+	}
 
 	if (flags & MODULE_INIT_COMPRESSED_FILE) {
 		err = module_decompress(&info, buf, len);
 		vfree(buf); /* compressed data is no longer needed */
 		if (err)
-			return err;
+			goto out;
 	} else {
 		info.hdr = buf;
 		info.len = len;
 	}
 
-	return load_module(&info, uargs, flags);
+	err = load_module(&info, uargs, flags);
+out:
+	module_batch_done(&info);
+	return err;
 }
 
 static inline int within(unsigned long addr, void *start, unsigned long size)
@@ -77,6 +77,10 @@
 # include "stats.c"
 #endif
 
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+# include "interruptions.c"
+#endif
+
 #include "loadavg.c"
 #include "completion.c"
 #include "swait.c"
@@ -2059,6 +2059,13 @@ static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 	uclamp_rq_inc(rq, p);
 	p->sched_class->enqueue_task(rq, p, flags);
 
+	/*
+	 * The task's clamp is now part of the rq one: let the governor
+	 * apply it right away rather than at its next rate limited update.
+	 */
+	if ((flags & ENQUEUE_WAKEUP) && p->sched_latency_critical)
+		cpufreq_update_util(rq, SCHED_CPUFREQ_LATENCY);
+
 	if (sched_core_enabled(rq))
 		sched_core_enqueue(rq, p);
 }
@@ -2178,7 +2185,10 @@ void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags)
 {
 	if (p->sched_class == rq->curr->sched_class)
 		rq->curr->sched_class->check_preempt_curr(rq, p, flags);
-	else if (sched_class_above(p->sched_class, rq->curr->sched_class))
+	else if (sched_class_above(p->sched_class, rq->curr->sched_class) &&
+		 !(rq->fair_server.dl_defer_running &&
+		   p->sched_class == &rt_sched_class &&
+		   rq->curr->sched_class == &fair_sched_class))
 		resched_curr(rq);
 
 	/*
@@ -3751,6 +3761,8 @@ void sched_ttwu_pending(void *arg)
 	if (!llist)
 		return;
 
+	sched_rtcore_account_wakeup(rq);
+
 	/*
 	 * rq::ttwu_pending racy indication of out-standing wakeups.
 	 * Races such that false-negatives are possible, since they
@@ -4390,6 +4402,7 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	/* Even if schedstat is disabled, there should not be garbage */
 	memset(&p->stats, 0, sizeof(p->stats));
 #endif
+	sched_interruptions_init(p);
 
 	RB_CLEAR_NODE(&p->dl.rb_node);
 	init_dl_task_timer(&p->dl);
@@ -4401,6 +4414,9 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	p->rt.time_slice	= sched_rr_timeslice;
 	p->rt.on_rq		= 0;
 	p->rt.on_list		= 0;
+#ifdef CONFIG_SMP
+	p->rt.nr_sticky_stays	= 0;
+#endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	INIT_HLIST_HEAD(&p->preempt_notifiers);
@@ -4622,6 +4638,9 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		p->prio = p->normal_prio = p->static_prio;
 		set_load_weight(p, false);
 
+		p->sched_latency_critical = 0;
+		p->sched_rt_sticky = 0;
+
 		/*
 		 * We don't need the reset flag anymore after the fork. It has
 		 * fulfilled its duty:
@@ -5509,6 +5528,7 @@ void scheduler_tick(void)
 	rq_lock(rq, &rf);
 
 	update_rq_clock(rq);
+	sched_rtcore_account_tick(rq);
 	thermal_pressure = arch_scale_thermal_pressure(cpu_of(rq));
 	update_thermal_load_avg(rq_clock_thermal(rq), rq, thermal_pressure);
 	curr->sched_class->task_tick(rq, curr, 0);
@@ -6547,6 +6567,8 @@ static void __sched notrace __schedule(unsigned int sched_mode)
 
 		migrate_disable_switch(rq, prev);
 		psi_sched_switch(prev, next, !task_on_rq_queued(prev));
+		sched_rtcore_account_switch(rq, prev, next);
+		sched_interruption_switch(rq, prev, next);
 
 		trace_sched_switch(sched_mode & SM_MASK_PREEMPT, prev, next, prev_state);
 
@@ -7367,6 +7389,7 @@ static void __setscheduler_params(struct task_struct *p,
 	if (policy == SETPARAM_POLICY)
 		policy = p->policy;
 
+	sched_rt_faults_policy(p, policy);
 	p->policy = policy;
 
 	if (dl_policy(policy))
@@ -7454,6 +7477,11 @@ static int user_check_sched_setscheduler(struct task_struct *p,
 	if (p->sched_reset_on_fork && !reset_on_fork)
 		goto req_priv;
 
+	/* Nor make a task latency critical: */
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_CRITICAL) &&
+	    !p->sched_latency_critical)
+		goto req_priv;
+
 	return 0;
 
 req_priv:
@@ -7472,7 +7500,7 @@ static int __sched_setscheduler(struct task_struct *p,
 	const struct sched_class *prev_class;
 	struct balance_callback *head;
 	struct rq_flags rf;
-	int reset_on_fork;
+	int reset_on_fork, latency_critical, rt_sticky;
 	int queue_flags = DEQUEUE_SAVE | DEQUEUE_MOVE | DEQUEUE_NOCLOCK;
 	struct rq *rq;
 	bool cpuset_locked = false;
@@ -7483,9 +7511,14 @@ static int __sched_setscheduler(struct task_struct *p,
 	/* Double check policy once rq lock held: */
 	if (policy < 0) {
 		reset_on_fork = p->sched_reset_on_fork;
+		latency_critical = p->sched_latency_critical;
+		rt_sticky = p->sched_rt_sticky;
 		policy = oldpolicy = p->policy;
 	} else {
 		reset_on_fork = !!(attr->sched_flags & SCHED_FLAG_RESET_ON_FORK);
+		latency_critical =
+			!!(attr->sched_flags & SCHED_FLAG_LATENCY_CRITICAL);
+		rt_sticky = !!(attr->sched_flags & SCHED_FLAG_RT_STICKY);
 
 		if (!valid_policy(policy))
 			return -EINVAL;
@@ -7554,7 +7587,8 @@ static int __sched_setscheduler(struct task_struct *p,
 
 	/*
 	 * If not changing anything there's no need to proceed further,
-	 * but store a possible modification of reset_on_fork.
+	 * but store a possible modification of reset_on_fork,
+	 * latency_critical and rt_sticky.
 	 */
 	if (unlikely(policy == p->policy)) {
 		if (fair_policy(policy) && attr->sched_nice != task_nice(p))
@@ -7567,6 +7601,8 @@ static int __sched_setscheduler(struct task_struct *p,
 			goto change;
 
 		p->sched_reset_on_fork = reset_on_fork;
+		p->sched_latency_critical = latency_critical;
+		p->sched_rt_sticky = rt_sticky;
 		retval = 0;
 		goto unlock;
 	}
@@ -7624,6 +7660,8 @@ static int __sched_setscheduler(struct task_struct *p,
 	}
 
 	p->sched_reset_on_fork = reset_on_fork;
+	p->sched_latency_critical = latency_critical;
+	p->sched_rt_sticky = rt_sticky;
 	oldprio = p->prio;
 
 	newprio = __normal_prio(policy, attr->sched_priority, attr->sched_nice);
@@ -8098,6 +8136,10 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	kattr.sched_policy = p->policy;
 	if (p->sched_reset_on_fork)
 		kattr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
+	if (p->sched_latency_critical)
+		kattr.sched_flags |= SCHED_FLAG_LATENCY_CRITICAL;
+	if (p->sched_rt_sticky)
+		kattr.sched_flags |= SCHED_FLAG_RT_STICKY;
 	get_params(p, &kattr);
 	kattr.sched_flags &= SCHED_FLAG_ALL;
 
@@ -9731,6 +9773,7 @@ void __init sched_init(void)
 		init_cfs_rq(&rq->cfs);
 		init_rt_rq(&rq->rt);
 		init_dl_rq(&rq->dl);
+		fair_server_init(rq);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
 		rq->tmp_alone_branch = &rq->leaf_cfs_rq_list;
@@ -9802,6 +9845,9 @@ void __init sched_init(void)
 		rq->core_forceidle_start = 0;
 
 		rq->core_cookie = 0UL;
+#endif
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+		rq->idle_exit_state = -1;
 #endif
 	}
 
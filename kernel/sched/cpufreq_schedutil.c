@@ -309,6 +309,17 @@ static inline void ignore_dl_rate_limit(struct sugov_cpu *sg_cpu)
 		sg_cpu->sg_policy->limits_changed = true;
 }
 
+/*
+ * Likewise when a latency critical task wakes up, so that its uclamp_min
+ * is honoured before it has run for a full rate limit period.
+ */
+static inline void ignore_latency_rate_limit(struct sugov_cpu *sg_cpu,
+					     unsigned int flags)
+{
+	if (flags & SCHED_CPUFREQ_LATENCY)
+		sg_cpu->sg_policy->limits_changed = true;
+}
+
 static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 					      u64 time, unsigned int flags)
 {
@@ -316,6 +327,7 @@ static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu);
+	ignore_latency_rate_limit(sg_cpu, flags);
 
 	if (!sugov_should_update_freq(sg_cpu->sg_policy, time))
 		return false;
@@ -443,6 +455,7 @@ sugov_update_shared(struct update_util_data *hook, u64 time, unsigned int flags)
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu);
+	ignore_latency_rate_limit(sg_cpu, flags);
 
 	if (sugov_should_update_freq(sg_policy, time)) {
 		next_f = sugov_next_freq_shared(sg_cpu, time);
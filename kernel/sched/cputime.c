@@ -51,13 +51,15 @@ void irqtime_account_irq(struct task_struct *curr, unsigned int offset)
 	struct irqtime *irqtime = this_cpu_ptr(&cpu_irqtime);
 	unsigned int pc;
 	s64 delta;
+	u64 start;
 	int cpu;
 
 	if (!sched_clock_irqtime)
 		return;
 
 	cpu = smp_processor_id();
-	delta = sched_clock_cpu(cpu) - irqtime->irq_start_time;
+	start = irqtime->irq_start_time;
+	delta = sched_clock_cpu(cpu) - start;
 	irqtime->irq_start_time += delta;
 	pc = irq_count() - offset;
 
@@ -67,10 +69,13 @@ void irqtime_account_irq(struct task_struct *curr, unsigned int offset)
 	 * in that case, so as not to confuse scheduler with a special task
 	 * that do not consume any time, but still wants to run.
 	 */
-	if (pc & HARDIRQ_MASK)
+	if (pc & HARDIRQ_MASK) {
 		irqtime_account_delta(irqtime, delta, CPUTIME_IRQ);
-	else if ((pc & SOFTIRQ_OFFSET) && curr != this_cpu_ksoftirqd())
+		sched_interruption(curr, SCHED_INTR_IRQ, cpu, start, delta);
+	} else if ((pc & SOFTIRQ_OFFSET) && curr != this_cpu_ksoftirqd()) {
 		irqtime_account_delta(irqtime, delta, CPUTIME_SOFTIRQ);
+		sched_interruption(curr, SCHED_INTR_SOFTIRQ, cpu, start, delta);
+	}
 }
 
 static u64 irqtime_tick_accounted(u64 maxtime)
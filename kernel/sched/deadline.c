@@ -1222,6 +1222,209 @@ void init_dl_task_timer(struct sched_dl_entity *dl_se)
 	timer->function = dl_task_timer;
 }
 
+/*
+ * Deadline servers
+ *
+ * A server is a -deadline entity with no task of its own: when picked, it
+ * runs a task of a lower class, given by ->server_pick(), within its
+ * dl_runtime every dl_period. It's how the fair tasks get some CPU time
+ * when the -rt ones would otherwise take it all.
+ *
+ * It is deferred, so that it changes nothing while the lower class isn't
+ * starved: the time that class gets anyway is charged to the server, and
+ * the server only competes with the -deadline tasks, ahead of the -rt
+ * ones, once it couldn't get its runtime by its deadline otherwise. That
+ * is at the zero-laxity time, deadline - runtime, when ->dl_timer fires.
+ * Once its runtime is used up, it waits for the next period, and defers
+ * again.
+ *
+ * The server is never in the dl_rq rbtree and doesn't count in
+ * dl_nr_running: pick_next_task_dl() looks at it directly. Its bandwidth
+ * isn't part of the -deadline admission control either.
+ */
+
+/* Arm ->dl_timer to fire at @expires, in rq_clock() time */
+static void dl_server_start_timer(struct sched_dl_entity *dl_se, u64 expires)
+{
+	struct hrtimer *timer = &dl_se->dl_timer;
+	struct rq *rq = dl_se->rq;
+	ktime_t now, act;
+	s64 delta;
+
+	lockdep_assert_rq_held(rq);
+
+	/* As in start_dl_timer() */
+	act = ns_to_ktime(expires);
+	now = hrtimer_cb_get_time(timer);
+	delta = ktime_to_ns(now) - rq_clock(rq);
+	act = ktime_add_ns(act, delta);
+
+	hrtimer_start(timer, act, HRTIMER_MODE_ABS_HARD);
+}
+
+static void dl_server_new_period(struct sched_dl_entity *dl_se, u64 now)
+{
+	dl_se->deadline = now + dl_se->dl_deadline;
+	dl_se->runtime = dl_se->dl_runtime;
+}
+
+/*
+ * Start running the lower class if it's out of laxity, or wait for that
+ * to happen.
+ */
+static void dl_server_defer(struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+	u64 now = rq_clock(rq);
+
+	if (dl_time_before(dl_se->deadline, now))
+		dl_server_new_period(dl_se, now);
+
+	if (dl_time_before(now, dl_se->deadline - dl_se->runtime)) {
+		dl_server_start_timer(dl_se, dl_se->deadline - dl_se->runtime);
+		return;
+	}
+
+	dl_se->dl_defer_running = 1;
+	/* Enforce the runtime, in case the tick doesn't come in time */
+	dl_server_start_timer(dl_se, now + dl_se->runtime);
+	resched_curr(rq);
+}
+
+static enum hrtimer_restart dl_server_timer(struct hrtimer *timer)
+{
+	struct sched_dl_entity *dl_se = container_of(timer,
+						     struct sched_dl_entity,
+						     dl_timer);
+	struct rq *rq = dl_se->rq;
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+	update_rq_clock(rq);
+
+	if (!dl_se->dl_server_active)
+		goto unlock;
+
+	if (!dl_se->server_has_tasks(dl_se)) {
+		dl_server_stop(dl_se);
+		goto unlock;
+	}
+
+	/* Charge what ran until now, which may end the current period */
+	rq->curr->sched_class->update_curr(rq);
+
+	if (!dl_se->dl_defer_running)
+		dl_server_defer(dl_se);
+	else
+		dl_server_start_timer(dl_se, rq_clock(rq) + dl_se->runtime);
+
+unlock:
+	rq_unlock(rq, &rf);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Charge the server with @delta_exec of its lower class' execution time,
+ * whether it ran it or not.
+ */
+void dl_server_update(struct sched_dl_entity *dl_se, s64 delta_exec)
+{
+	struct rq *rq = dl_se->rq;
+
+	if (!dl_se->dl_server_active)
+		return;
+
+	dl_se->runtime -= delta_exec;
+	if (dl_se->runtime > 0)
+		return;
+
+	if (dl_se->dl_defer_running) {
+		/* Done for this period, make way for the -rt tasks */
+		dl_se->dl_defer_running = 0;
+		dl_se->deadline += dl_se->dl_period;
+		dl_se->runtime = dl_se->dl_runtime;
+		resched_curr(rq);
+	} else {
+		/* It got its runtime without our help */
+		dl_server_new_period(dl_se, rq_clock(rq));
+	}
+
+	dl_server_start_timer(dl_se, dl_se->deadline - dl_se->runtime);
+}
+
+void dl_server_start(struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+	u64 now;
+
+	if (dl_se->dl_server_active || !dl_se->dl_runtime)
+		return;
+
+	/* Don't let it catch up on a period it wasn't running in */
+	now = rq_clock(rq);
+	if (!dl_time_before(now, dl_se->deadline - dl_se->runtime))
+		dl_server_new_period(dl_se, now);
+
+	dl_se->dl_server_active = 1;
+	dl_server_defer(dl_se);
+}
+
+void dl_server_stop(struct sched_dl_entity *dl_se)
+{
+	if (!dl_se->dl_server_active)
+		return;
+
+	/* Called with the rq locked: the callback would see !active */
+	hrtimer_try_to_cancel(&dl_se->dl_timer);
+	dl_se->dl_server_active = 0;
+	dl_se->dl_defer_running = 0;
+}
+
+void dl_server_init(struct sched_dl_entity *dl_se, struct rq *rq,
+		    dl_server_has_tasks_f has_tasks,
+		    dl_server_pick_f pick)
+{
+	struct hrtimer *timer = &dl_se->dl_timer;
+
+	RB_CLEAR_NODE(&dl_se->rb_node);
+	dl_se->dl_server = 1;
+	dl_se->rq = rq;
+	dl_se->server_has_tasks = has_tasks;
+	dl_se->server_pick = pick;
+#ifdef CONFIG_RT_MUTEXES
+	dl_se->pi_se = dl_se;
+#endif
+
+	hrtimer_init(timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	timer->function = dl_server_timer;
+}
+
+/*
+ * A @runtime of 0 disables the server. The new parameters take effect at
+ * its next period. Called with the rq locked, but before it's used.
+ */
+int dl_server_apply_params(struct sched_dl_entity *dl_se, u64 runtime,
+			   u64 period)
+{
+	u64 max = (u64)READ_ONCE(sysctl_sched_dl_period_max) * NSEC_PER_USEC;
+	u64 min = (u64)READ_ONCE(sysctl_sched_dl_period_min) * NSEC_PER_USEC;
+
+	if (period < min || period > max || runtime >= period)
+		return -EINVAL;
+
+	if (runtime && runtime < (1ULL << DL_SCALE))
+		return -EINVAL;
+
+	dl_se->dl_runtime = runtime;
+	dl_se->dl_deadline = period;
+	dl_se->dl_period = period;
+	dl_se->dl_bw = to_ratio(period, runtime);
+	dl_se->dl_density = to_ratio(period, runtime);
+
+	return 0;
+}
+
 /*
  * During the activation, CBS checks if it can reuse the current task's
  * runtime and period. If the deadline of the task is in the past, CBS
@@ -2032,8 +2235,19 @@ static struct task_struct *pick_task_dl(struct rq *rq)
 
 static struct task_struct *pick_next_task_dl(struct rq *rq)
 {
+	struct sched_dl_entity *server = &rq->fair_server;
 	struct task_struct *p;
 
+	if (unlikely(server->dl_defer_running)) {
+		struct sched_dl_entity *dl_se = pick_next_dl_entity(&rq->dl);
+
+		if (!dl_se || !dl_entity_preempt(dl_se, server)) {
+			p = server->server_pick(server);
+			if (p)
+				return p;
+		}
+	}
+
 	p = pick_task_dl(rq);
 	if (p)
 		set_next_task_dl(rq, p, true);
@@ -278,6 +278,134 @@ static const struct file_operations sched_dynamic_fops = {
 
 #endif /* CONFIG_PREEMPT_DYNAMIC */
 
+enum dl_param {
+	DL_RUNTIME = 0,
+	DL_PERIOD,
+};
+
+static ssize_t sched_fair_server_write(struct file *filp,
+				       const char __user *ubuf, size_t cnt,
+				       loff_t *ppos, enum dl_param param)
+{
+	struct seq_file *m = filp->private_data;
+	unsigned long cpu = (unsigned long)m->private;
+	struct sched_dl_entity *dl_se;
+	struct rq *rq = cpu_rq(cpu);
+	u64 runtime, period, value;
+	struct rq_flags rf;
+	int ret;
+
+	ret = kstrtoull_from_user(ubuf, cnt, 10, &value);
+	if (ret)
+		return ret;
+
+	rq_lock_irqsave(rq, &rf);
+	dl_se = &rq->fair_server;
+	runtime = param == DL_RUNTIME ? value : dl_se->dl_runtime;
+	period = param == DL_PERIOD ? value : dl_se->dl_period;
+
+	update_rq_clock(rq);
+	dl_server_stop(dl_se);
+	ret = dl_server_apply_params(dl_se, runtime, period);
+	if (rq->cfs.h_nr_running)
+		dl_server_start(dl_se);
+	rq_unlock_irqrestore(rq, &rf);
+
+	if (ret)
+		return ret;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static int sched_fair_server_show(struct seq_file *m, void *v,
+				  enum dl_param param)
+{
+	unsigned long cpu = (unsigned long)m->private;
+	struct sched_dl_entity *dl_se = &cpu_rq(cpu)->fair_server;
+
+	seq_printf(m, "%llu\n", param == DL_RUNTIME ? dl_se->dl_runtime :
+						     dl_se->dl_period);
+	return 0;
+}
+
+static ssize_t sched_fair_server_runtime_write(struct file *filp,
+					       const char __user *ubuf,
+					       size_t cnt, loff_t *ppos)
+{
+	return sched_fair_server_write(filp, ubuf, cnt, ppos, DL_RUNTIME);
+}
+
+static int sched_fair_server_runtime_show(struct seq_file *m, void *v)
+{
+	return sched_fair_server_show(m, v, DL_RUNTIME);
+}
+
+static int sched_fair_server_runtime_open(struct inode *inode,
+					  struct file *filp)
+{
+	return single_open(filp, sched_fair_server_runtime_show,
+			   inode->i_private);
+}
+
+static const struct file_operations fair_server_runtime_fops = {
+	.open		= sched_fair_server_runtime_open,
+	.write		= sched_fair_server_runtime_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t sched_fair_server_period_write(struct file *filp,
+					      const char __user *ubuf,
+					      size_t cnt, loff_t *ppos)
+{
+	return sched_fair_server_write(filp, ubuf, cnt, ppos, DL_PERIOD);
+}
+
+static int sched_fair_server_period_show(struct seq_file *m, void *v)
+{
+	return sched_fair_server_show(m, v, DL_PERIOD);
+}
+
+static int sched_fair_server_period_open(struct inode *inode,
+					 struct file *filp)
+{
+	return single_open(filp, sched_fair_server_period_show,
+			   inode->i_private);
+}
+
+static const struct file_operations fair_server_period_fops = {
+	.open		= sched_fair_server_period_open,
+	.write		= sched_fair_server_period_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *debugfs_sched;
+
+static __init void debugfs_fair_server_init(void)
+{
+	struct dentry *d_fair;
+	unsigned long cpu;
+
+	d_fair = debugfs_create_dir("fair_server", debugfs_sched);
+
+	for_each_possible_cpu(cpu) {
+		struct dentry *d_cpu;
+		char buf[32];
+
+		snprintf(buf, sizeof(buf), "cpu%lu", cpu);
+		d_cpu = debugfs_create_dir(buf, d_fair);
+
+		debugfs_create_file("runtime", 0644, d_cpu, (void *)cpu,
+				    &fair_server_runtime_fops);
+		debugfs_create_file("period", 0644, d_cpu, (void *)cpu,
+				    &fair_server_period_fops);
+	}
+}
+
 __read_mostly bool sched_debug_verbose;
 
 static const struct seq_operations sched_debug_sops;
@@ -294,8 +422,6 @@ static const struct file_operations sched_debug_fops = {
 	.release	= seq_release,
 };
 
-static struct dentry *debugfs_sched;
-
 static __init int sched_init_debug(void)
 {
 	struct dentry __maybe_unused *numa;
@@ -320,6 +446,7 @@ static __init int sched_init_debug(void)
 	debugfs_create_file("tunable_scaling", 0644, debugfs_sched, NULL, &sched_scaling_fops);
 	debugfs_create_u32("migration_cost_ns", 0644, debugfs_sched, &sysctl_sched_migration_cost);
 	debugfs_create_u32("nr_migrate", 0644, debugfs_sched, &sysctl_sched_nr_migrate);
+	debugfs_create_u32("rt_sticky_wait_ns", 0644, debugfs_sched, &sysctl_sched_rt_sticky_wait);
 
 	mutex_lock(&sched_domains_mutex);
 	update_sched_domain_debugfs();
@@ -338,6 +465,13 @@ static __init int sched_init_debug(void)
 
 	debugfs_create_file("debug", 0444, debugfs_sched, NULL, &sched_debug_fops);
 
+	debugfs_fair_server_init();
+
+#ifdef CONFIG_CPU_ISOLATION
+	if (housekeeping_enabled(HK_TYPE_SCHED))
+		debugfs_create_file("rtcore", 0444, debugfs_sched, NULL, &sched_rtcore_fops);
+#endif
+
 	return 0;
 }
 late_initcall(sched_init_debug);
@@ -680,6 +814,8 @@ void print_rt_rq(struct seq_file *m, int cpu, struct rt_rq *rt_rq)
 	PU(rt_nr_running);
 #ifdef CONFIG_SMP
 	PU(rt_nr_migratory);
+	PU(rt_nr_pushed);
+	PU(rt_nr_pulled);
 #endif
 	P(rt_throttled);
 	PN(rt_time);
@@ -1047,6 +1183,10 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 		P(dl.runtime);
 		P(dl.deadline);
 	}
+#ifdef CONFIG_SMP
+	if (task_has_rt_policy(p))
+		P(rt.nr_sticky_stays);
+#endif
 #undef PN_SCHEDSTAT
 #undef P_SCHEDSTAT
 
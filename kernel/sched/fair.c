@@ -914,6 +914,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 		trace_sched_stat_runtime(curtask, delta_exec, curr->vruntime);
 		cgroup_account_cputime(curtask, delta_exec);
 		account_group_exec_runtime(curtask, delta_exec);
+		dl_server_update(&rq_of(cfs_rq)->fair_server, delta_exec);
 	}
 
 	account_cfs_rq_runtime(cfs_rq, delta_exec);
@@ -5398,6 +5399,8 @@ static bool throttle_cfs_rq(struct cfs_rq *cfs_rq)
 
 	/* At this point se is NULL and we are at root level*/
 	sub_nr_running(rq, task_delta);
+	if (!rq->cfs.h_nr_running)
+		dl_server_stop(&rq->fair_server);
 
 done:
 	/*
@@ -5483,6 +5486,7 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, task_delta);
+	dl_server_start(&rq->fair_server);
 
 unthrottle_throttle:
 	assert_list_leaf_cfs_rq(rq);
@@ -6147,6 +6151,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, 1);
+	dl_server_start(&rq->fair_server);
 
 	/*
 	 * Since new tasks are assigned an initial util_avg equal to
@@ -6238,6 +6243,8 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	/* At this point se is NULL and we are at root level*/
 	sub_nr_running(rq, 1);
+	if (!rq->cfs.h_nr_running)
+		dl_server_stop(&rq->fair_server);
 
 	/* balance early to pull high priority tasks */
 	if (unlikely(!was_sched_idle && sched_idle_rq(rq)))
@@ -7928,6 +7935,28 @@ static struct task_struct *__pick_next_task_fair(struct rq *rq)
 	return pick_next_task_fair(rq, NULL, NULL);
 }
 
+static bool fair_server_has_tasks(struct sched_dl_entity *dl_se)
+{
+	return !!dl_se->rq->cfs.h_nr_running;
+}
+
+static struct task_struct *fair_server_pick(struct sched_dl_entity *dl_se)
+{
+	return pick_next_task_fair(dl_se->rq, NULL, NULL);
+}
+
+/*
+ * 50ms every second by default, what the -rt throttling used to leave
+ * to the rest of the system.
+ */
+void fair_server_init(struct rq *rq)
+{
+	struct sched_dl_entity *dl_se = &rq->fair_server;
+
+	dl_server_init(dl_se, rq, fair_server_has_tasks, fair_server_pick);
+	dl_server_apply_params(dl_se, 50 * NSEC_PER_MSEC, NSEC_PER_SEC);
+}
+
 /*
  * Account for a descheduled task:
  */
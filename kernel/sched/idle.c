@@ -238,6 +238,8 @@ static void cpuidle_idle_call(void)
 		 * Give the governor an opportunity to reflect on the outcome
 		 */
 		cpuidle_reflect(dev, entered_state);
+		sched_interruption_idle_exit(this_rq(), entered_state,
+					     dev->last_residency_ns);
 	}
 
 exit_idle:
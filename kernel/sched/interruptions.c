@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The longest interruptions of realtime tasks: /proc/<pid>/interruptions,
+ * the idle states their CPU was woken from: /proc/<pid>/idle_states, and
+ * the page faults they took: RtFaults in /proc/<pid>/status
+ */
+
+static const char * const sched_interruption_names[] = {
+	[SCHED_INTR_IRQ]	= "irq",
+	[SCHED_INTR_SOFTIRQ]	= "softirq",
+	[SCHED_INTR_PREEMPT]	= "preempt",
+	[SCHED_INTR_MIGRATE]	= "migrate",
+};
+
+void sched_interruptions_init(struct task_struct *p)
+{
+	struct sched_interruptions *si = &p->sched_interruptions;
+
+	memset(si, 0, sizeof(*si));
+	seqcount_init(&si->seq);
+}
+
+/*
+ * Called with interrupts disabled, either from the task's own CPU or while
+ * switching to it, so there's only ever one writer.
+ */
+void __sched_interruption(struct task_struct *p,
+			  enum sched_interruption_type type,
+			  int cpu, u64 start, u64 duration)
+{
+	struct sched_interruptions *si = &p->sched_interruptions;
+	struct sched_interruption *min = &si->top[0];
+	int i;
+
+	for (i = 1; i < SCHED_INTERRUPTIONS_TOP; i++) {
+		if (si->top[i].duration < min->duration)
+			min = &si->top[i];
+	}
+
+	if (duration <= min->duration)
+		return;
+
+	write_seqcount_begin(&si->seq);
+	min->start = start;
+	min->duration = duration;
+	min->type = type;
+	min->cpu = cpu;
+	write_seqcount_end(&si->seq);
+}
+
+void __sched_interruption_switch(struct rq *rq, struct task_struct *prev,
+				 struct task_struct *next)
+{
+	struct sched_interruptions *si;
+	u64 now = rq_clock(rq);
+
+	if (rq->idle_exit_state >= 0) {
+		if (prev == rq->idle && rt_task(next)) {
+			int state = min(rq->idle_exit_state,
+					SCHED_IDLE_STATES - 1);
+
+			si = &next->sched_interruptions;
+			write_seqcount_begin(&si->seq);
+			si->idle[state].count++;
+			si->idle[state].residency += rq->idle_exit_residency;
+			write_seqcount_end(&si->seq);
+		}
+		rq->idle_exit_state = -1;
+	}
+
+	/* Still queued: preempted, rather than gone to sleep */
+	if (rt_task(prev) && task_on_rq_queued(prev)) {
+		si = &prev->sched_interruptions;
+		si->preempted_at = now;
+		si->preempted_cpu = cpu_of(rq);
+	}
+
+	si = &next->sched_interruptions;
+	if (!si->preempted_at)
+		return;
+
+	/* The clocks of two CPUs aren't strictly in sync */
+	if (likely(now > si->preempted_at)) {
+		__sched_interruption(next, si->preempted_cpu == cpu_of(rq) ?
+				     SCHED_INTR_PREEMPT : SCHED_INTR_MIGRATE,
+				     si->preempted_cpu, si->preempted_at,
+				     now - si->preempted_at);
+	}
+	si->preempted_at = 0;
+}
+
+/*
+ * The page faults themselves are counted by the fault handler, into
+ * min_flt and maj_flt. Called with p->pi_lock held, as the policy changes.
+ */
+void __sched_rt_faults_policy(struct task_struct *p, bool rt)
+{
+	struct sched_interruptions *si = &p->sched_interruptions;
+	unsigned long flt = p->min_flt + p->maj_flt;
+
+	if (rt)
+		si->rt_flt_start = flt;
+	else
+		si->rt_flt += flt - si->rt_flt_start;
+}
+
+unsigned long task_rt_faults(struct task_struct *p)
+{
+	struct sched_interruptions *si = &p->sched_interruptions;
+	unsigned long flags, flt;
+
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	flt = si->rt_flt;
+	if (rt_policy(p->policy))
+		flt += p->min_flt + p->maj_flt - si->rt_flt_start;
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+
+	return flt;
+}
+
+void proc_sched_interruptions_show(struct task_struct *p, struct seq_file *m)
+{
+	struct sched_interruptions *si = &p->sched_interruptions;
+	struct sched_interruption top[SCHED_INTERRUPTIONS_TOP];
+	unsigned int seq;
+	int i, j;
+
+	do {
+		seq = read_seqcount_begin(&si->seq);
+		memcpy(top, si->top, sizeof(top));
+	} while (read_seqcount_retry(&si->seq, seq));
+
+	/* Longest first */
+	for (i = 1; i < SCHED_INTERRUPTIONS_TOP; i++) {
+		struct sched_interruption tmp = top[i];
+
+		for (j = i; j > 0 && top[j - 1].duration < tmp.duration; j--)
+			top[j] = top[j - 1];
+		top[j] = tmp;
+	}
+
+	seq_puts(m, "type duration_ns start_ns cpu\n");
+	for (i = 0; i < SCHED_INTERRUPTIONS_TOP && top[i].duration; i++) {
+		seq_printf(m, "%s %llu %llu %d\n",
+			   sched_interruption_names[top[i].type],
+			   top[i].duration, top[i].start, top[i].cpu);
+	}
+}
+
+void proc_sched_idle_states_show(struct task_struct *p, struct seq_file *m)
+{
+	struct sched_interruptions *si = &p->sched_interruptions;
+	struct sched_idle_state idle[SCHED_IDLE_STATES];
+	unsigned int seq;
+	int i;
+
+	do {
+		seq = read_seqcount_begin(&si->seq);
+		memcpy(idle, si->idle, sizeof(idle));
+	} while (read_seqcount_retry(&si->seq, seq));
+
+	seq_puts(m, "state count residency_ns\n");
+	for (i = 0; i < SCHED_IDLE_STATES; i++) {
+		seq_printf(m, "%d%s %llu %llu\n", i,
+			   i == SCHED_IDLE_STATES - 1 ? "+" : "",
+			   idle[i].count, idle[i].residency);
+	}
+}
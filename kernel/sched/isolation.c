@@ -23,6 +23,8 @@ enum hk_flags {
 DEFINE_STATIC_KEY_FALSE(housekeeping_overridden);
 EXPORT_SYMBOL_GPL(housekeeping_overridden);
 
+DEFINE_STATIC_KEY_FALSE(sched_rtcore_key);
+
 struct housekeeping {
 	cpumask_var_t cpumasks[HK_TYPE_MAX];
 	unsigned long flags;
@@ -91,6 +93,9 @@ void __init housekeeping_init(void)
 	if (housekeeping.flags & HK_FLAG_TICK)
 		sched_tick_offload_init();
 
+	if (housekeeping.flags & HK_FLAG_SCHED)
+		static_branch_enable(&sched_rtcore_key);
+
 	for_each_set_bit(type, &housekeeping.flags, HK_TYPE_MAX) {
 		/* We need at least one CPU to handle housekeeping work */
 		WARN_ON_ONCE(cpumask_empty(housekeeping.cpumasks[type]));
@@ -239,3 +244,96 @@ static int __init housekeeping_isolcpus_setup(char *str)
 	return housekeeping_setup(str, flags);
 }
 __setup("isolcpus=", housekeeping_isolcpus_setup);
+
+/*
+ * A CPU dedicated to one realtime task: nohz_full= and isolcpus=domain,
+ * managed_irq together, which also makes its RCU callbacks offloaded
+ * with CONFIG_RCU_NOCB_CPU, and out of the nohz idle balancing as well.
+ */
+static int __init housekeeping_rtcore_setup(char *str)
+{
+	unsigned long flags;
+
+	flags = HK_FLAG_TICK | HK_FLAG_WQ | HK_FLAG_TIMER | HK_FLAG_RCU |
+		HK_FLAG_MISC | HK_FLAG_KTHREAD | HK_FLAG_DOMAIN |
+		HK_FLAG_MANAGED_IRQ | HK_FLAG_SCHED;
+
+	return housekeeping_setup(str, flags);
+}
+__setup("rtcore=", housekeeping_rtcore_setup);
+
+struct rtcore_stats {
+	/* Ticks that could not be stopped */
+	unsigned long ticks;
+	/* Wakeups queued from other CPUs */
+	unsigned long wakeups;
+	/* Kernel threads that ran, and for how long at most */
+	unsigned long kthreads;
+	u64 kthread_max_ns;
+	u64 kthread_start;
+	char kthread_last[TASK_COMM_LEN];
+};
+
+static DEFINE_PER_CPU(struct rtcore_stats, rtcore_stats);
+
+void __sched_rtcore_account_tick(struct rq *rq)
+{
+	this_cpu_inc(rtcore_stats.ticks);
+}
+
+void __sched_rtcore_account_wakeup(struct rq *rq)
+{
+	this_cpu_inc(rtcore_stats.wakeups);
+}
+
+void __sched_rtcore_account_switch(struct rq *rq, struct task_struct *prev,
+				   struct task_struct *next)
+{
+	struct rtcore_stats *stats = this_cpu_ptr(&rtcore_stats);
+	u64 now = rq_clock(rq);
+
+	if (stats->kthread_start) {
+		stats->kthread_max_ns = max(stats->kthread_max_ns,
+					    now - stats->kthread_start);
+		stats->kthread_start = 0;
+	}
+
+	if ((next->flags & PF_KTHREAD) && !is_idle_task(next)) {
+		stats->kthreads++;
+		stats->kthread_start = now;
+		memcpy(stats->kthread_last, next->comm, TASK_COMM_LEN);
+	}
+}
+
+static int sched_rtcore_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	seq_puts(m, "cpu ticks wakeups kthreads kthread_max_ns kthread_last\n");
+	for_each_possible_cpu(cpu) {
+		struct rtcore_stats *stats = per_cpu_ptr(&rtcore_stats, cpu);
+
+		if (housekeeping_test_cpu(cpu, HK_TYPE_SCHED))
+			continue;
+
+		seq_printf(m, "%d %lu %lu %lu %llu %.*s\n", cpu,
+			   READ_ONCE(stats->ticks), READ_ONCE(stats->wakeups),
+			   READ_ONCE(stats->kthreads),
+			   READ_ONCE(stats->kthread_max_ns),
+			   TASK_COMM_LEN, stats->kthread_last);
+	}
+
+	return 0;
+}
+
+static int sched_rtcore_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sched_rtcore_show, NULL);
+}
+
+const struct file_operations sched_rtcore_fops = {
+	.open		= sched_rtcore_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
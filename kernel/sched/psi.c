@@ -164,6 +164,31 @@ __setup("psi=", setup_psi);
 #define WINDOW_MAX_US 10000000	/* Max window size is 10s */
 #define UPDATES_PER_WINDOW 10	/* 10 updates per window */
 
+#ifdef CONFIG_PSI_RT
+/* Realtime tasks may wait this long to run before it is a stall */
+static unsigned int psi_rt_threshold_us __read_mostly = 500;
+
+#ifdef CONFIG_SYSCTL
+static struct ctl_table psi_rt_sysctls[] = {
+	{
+		.procname	= "psi_rt_threshold_us",
+		.data		= &psi_rt_threshold_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+	{}
+};
+
+static int __init psi_rt_sysctl_init(void)
+{
+	register_sysctl_init("kernel", psi_rt_sysctls);
+	return 0;
+}
+late_initcall(psi_rt_sysctl_init);
+#endif
+#endif
+
 /* Sampling frequency in nanoseconds */
 static u64 psi_period __read_mostly;
 
@@ -1035,6 +1060,49 @@ void psi_account_irqtime(struct task_struct *task, u32 delta)
 }
 #endif
 
+#ifdef CONFIG_PSI_RT
+/*
+ * A realtime task is about to run after waiting @delay ns on the
+ * runqueue. Unlike the other stalls, this one is only known once it is
+ * over, so the part of it beyond the threshold is added to the pressure
+ * of the task's groups at once.
+ */
+void psi_account_rtdelay(struct task_struct *task, u64 delay)
+{
+	u64 threshold = (u64)READ_ONCE(psi_rt_threshold_us) * NSEC_PER_USEC;
+	int cpu = task_cpu(task);
+	struct psi_group *group;
+	struct psi_group_cpu *groupc;
+	u32 delta;
+	u64 now;
+
+	if (static_branch_likely(&psi_disabled) || delay <= threshold)
+		return;
+
+	/* The buckets are u32, and drained every few seconds at most */
+	delta = min_t(u64, delay - threshold, U32_MAX);
+	now = cpu_clock(cpu);
+
+	group = task_psi_group(task);
+	do {
+		if (!group->enabled)
+			continue;
+
+		groupc = per_cpu_ptr(group->pcpu, cpu);
+
+		write_seqcount_begin(&groupc->seq);
+
+		record_times(groupc, now);
+		groupc->times[PSI_RT_SOME] += delta;
+
+		write_seqcount_end(&groupc->seq);
+
+		if (group->rtpoll_states & (1 << PSI_RT_SOME))
+			psi_schedule_rtpoll_work(group, 1, false);
+	} while ((group = group->parent));
+}
+#endif
+
 /**
  * psi_memstall_enter - mark the beginning of a memory stall section
  * @flags: flags to handle nested sections
@@ -1231,10 +1299,23 @@ void psi_cgroup_restart(struct psi_group *group)
 }
 #endif /* CONFIG_CGROUPS */
 
+/* The state of @res that "some" or "full" pressure refers to */
+static int psi_res_state(enum psi_res res, bool full)
+{
+#ifdef CONFIG_IRQ_TIME_ACCOUNTING
+	if (res == PSI_IRQ)
+		return full ? PSI_IRQ_FULL : -EINVAL;
+#endif
+#ifdef CONFIG_PSI_RT
+	if (res == PSI_RT)
+		return full ? -EINVAL : PSI_RT_SOME;
+#endif
+	return PSI_IO_SOME + res * 2 + full;
+}
+
 int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 {
-	bool only_full = false;
-	int full;
+	int full, state;
 	u64 now;
 
 	if (static_branch_likely(&psi_disabled))
@@ -1248,25 +1329,25 @@ int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 		group->avg_next_update = update_averages(group, now);
 	mutex_unlock(&group->avgs_lock);
 
-#ifdef CONFIG_IRQ_TIME_ACCOUNTING
-	only_full = res == PSI_IRQ;
-#endif
-
-	for (full = 0; full < 2 - only_full; full++) {
+	for (full = 0; full < 2; full++) {
 		unsigned long avg[3] = { 0, };
 		u64 total = 0;
 		int w;
 
+		state = psi_res_state(res, full);
+		if (state < 0)
+			continue;
+
 		/* CPU FULL is undefined at the system level */
 		if (!(group == &psi_system && res == PSI_CPU && full)) {
 			for (w = 0; w < 3; w++)
-				avg[w] = group->avg[res * 2 + full][w];
-			total = div_u64(group->total[PSI_AVGS][res * 2 + full],
+				avg[w] = group->avg[state][w];
+			total = div_u64(group->total[PSI_AVGS][state],
 					NSEC_PER_USEC);
 		}
 
 		seq_printf(m, "%s avg10=%lu.%02lu avg60=%lu.%02lu avg300=%lu.%02lu total=%llu\n",
-			   full || only_full ? "full" : "some",
+			   full ? "full" : "some",
 			   LOAD_INT(avg[0]), LOAD_FRAC(avg[0]),
 			   LOAD_INT(avg[1]), LOAD_FRAC(avg[1]),
 			   LOAD_INT(avg[2]), LOAD_FRAC(avg[2]),
@@ -1281,7 +1362,7 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group, char *buf,
 				       struct kernfs_open_file *of)
 {
 	struct psi_trigger *t;
-	enum psi_states state;
+	int state;
 	u32 threshold_us;
 	bool privileged;
 	u32 window_us;
@@ -1296,16 +1377,14 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group, char *buf,
 	privileged = cap_raised(file->f_cred->cap_effective, CAP_SYS_RESOURCE);
 
 	if (sscanf(buf, "some %u %u", &threshold_us, &window_us) == 2)
-		state = PSI_IO_SOME + res * 2;
+		state = psi_res_state(res, false);
 	else if (sscanf(buf, "full %u %u", &threshold_us, &window_us) == 2)
-		state = PSI_IO_FULL + res * 2;
+		state = psi_res_state(res, true);
 	else
 		return ERR_PTR(-EINVAL);
 
-#ifdef CONFIG_IRQ_TIME_ACCOUNTING
-	if (res == PSI_IRQ && --state != PSI_IRQ_FULL)
-		return ERR_PTR(-EINVAL);
-#endif
+	if (state < 0)
+		return ERR_PTR(state);
 
 	if (state >= PSI_NONIDLE)
 		return ERR_PTR(-EINVAL);
@@ -1644,6 +1723,33 @@ static const struct proc_ops psi_irq_proc_ops = {
 };
 #endif
 
+#ifdef CONFIG_PSI_RT
+static int psi_rt_show(struct seq_file *m, void *v)
+{
+	return psi_show(m, &psi_system, PSI_RT);
+}
+
+static int psi_rt_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, psi_rt_show, NULL);
+}
+
+static ssize_t psi_rt_write(struct file *file, const char __user *user_buf,
+			    size_t nbytes, loff_t *ppos)
+{
+	return psi_write(file, user_buf, nbytes, PSI_RT);
+}
+
+static const struct proc_ops psi_rt_proc_ops = {
+	.proc_open	= psi_rt_open,
+	.proc_read	= seq_read,
+	.proc_lseek	= seq_lseek,
+	.proc_write	= psi_rt_write,
+	.proc_poll	= psi_fop_poll,
+	.proc_release	= psi_fop_release,
+};
+#endif
+
 static int __init psi_proc_init(void)
 {
 	if (psi_enable) {
@@ -1653,6 +1759,9 @@ static int __init psi_proc_init(void)
 		proc_create("pressure/cpu", 0666, NULL, &psi_cpu_proc_ops);
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
 		proc_create("pressure/irq", 0666, NULL, &psi_irq_proc_ops);
+#endif
+#ifdef CONFIG_PSI_RT
+		proc_create("pressure/rt", 0666, NULL, &psi_rt_proc_ops);
 #endif
 	}
 	return 0;
@@ -24,6 +24,15 @@ unsigned int sysctl_sched_rt_period = 1000000;
  */
 int sysctl_sched_rt_runtime = 950000;
 
+#ifdef CONFIG_SMP
+/*
+ * How long a SCHED_FLAG_RT_STICKY task waits for the RT task running on
+ * its CPU, before being moved to another one, in ns.
+ * default: 200us
+ */
+const_debug unsigned int sysctl_sched_rt_sticky_wait = 200000UL;
+#endif
+
 #ifdef CONFIG_SYSCTL
 static int sysctl_sched_rr_timeslice = (MSEC_PER_SEC * RR_TIMESLICE) / HZ;
 static int sched_rt_handler(struct ctl_table *table, int write, void *buffer,
@@ -1005,6 +1014,14 @@ static int sched_rt_runtime_exceeded(struct rt_rq *rt_rq)
 	if (runtime >= sched_rt_period(rt_rq))
 		return 0;
 
+	/*
+	 * The fair server already leaves the rest of the system its share
+	 * of the root rt_rq's CPU, only when it needs it.
+	 */
+	if (rt_rq == &rq_of_rt_rq(rt_rq)->rt &&
+	    rq_of_rt_rq(rt_rq)->fair_server.dl_runtime)
+		return 0;
+
 	balance_runtime(rt_rq);
 	runtime = sched_rt_runtime(rt_rq);
 	if (runtime == RUNTIME_INF)
@@ -1595,6 +1612,57 @@ static void yield_task_rt(struct rq *rq)
 #ifdef CONFIG_SMP
 static int find_lowest_rq(struct task_struct *task);
 
+/*
+ * Should the sticky task @p stay on @rq rather than move to another CPU?
+ *
+ * It does if it's not queued behind anything but the current task, and
+ * that one either gets preempted by @p or has not been running for long
+ * yet. We don't know how long it will still run, so the time it has
+ * already run is the guess. Called without @rq locked, for wakeups.
+ */
+static bool rt_sticky_stay(struct rq *rq, struct task_struct *p)
+{
+	struct task_struct *curr = READ_ONCE(rq->curr);
+	u64 ran;
+
+	if (!p->sched_rt_sticky || !sysctl_sched_rt_sticky_wait)
+		return false;
+
+	if (!rt_task(curr))
+		return true;
+
+	/* Deadline and stop tasks */
+	if (curr->sched_class != &rt_sched_class)
+		return false;
+
+	if (curr->prio > p->prio)
+		return true;
+
+	if (p->prio > READ_ONCE(rq->rt.highest_prio.next))
+		return false;
+
+	ran = READ_ONCE(rq->clock_task) - READ_ONCE(rq->rt.curr_start);
+
+	return (s64)ran < sysctl_sched_rt_sticky_wait;
+}
+
+static DEFINE_PER_CPU(struct hrtimer, rt_sticky_timer);
+
+/*
+ * Nothing else looks at a task rt_sticky_stay() kept queued once the
+ * current task has run past the wait, so try another push then. Called
+ * with @rq locked, from the push path.
+ */
+static void rt_sticky_arm(struct rq *rq)
+{
+	s64 left = sysctl_sched_rt_sticky_wait -
+		   (s64)(rq->clock_task - rq->rt.curr_start);
+
+	if (left > 0)
+		hrtimer_start(per_cpu_ptr(&rt_sticky_timer, cpu_of(rq)),
+			      ns_to_ktime(left), HRTIMER_MODE_REL_PINNED_HARD);
+}
+
 static int
 select_task_rq_rt(struct task_struct *p, int cpu, int flags)
 {
@@ -1641,6 +1709,15 @@ select_task_rq_rt(struct task_struct *p, int cpu, int flags)
 	       unlikely(rt_task(curr)) &&
 	       (curr->nr_cpus_allowed < 2 || curr->prio <= p->prio);
 
+	/*
+	 * Unless told it prefers keeping its cache over starting right
+	 * away, and it won't wait too long here.
+	 */
+	if (test && rt_sticky_stay(rq, p) && rt_task_fits_capacity(p, cpu)) {
+		p->rt.nr_sticky_stays++;
+		goto out_unlock;
+	}
+
 	if (test || !rt_task_fits_capacity(p, cpu)) {
 		int target = find_lowest_rq(p);
 
@@ -1755,6 +1832,10 @@ static inline void set_next_task_rt(struct rq *rq, struct task_struct *p, bool f
 	if (!first)
 		return;
 
+#ifdef CONFIG_SMP
+	rt_rq->curr_start = p->se.exec_start;
+#endif
+
 	/*
 	 * If prev task was rt, put_prev_task() has already updated the
 	 * utilization. We only care of the case where we start to schedule a
@@ -2078,6 +2159,12 @@ static int push_rt_task(struct rq *rq, bool pull)
 		return 0;
 	}
 
+	if (rt_sticky_stay(rq, next_task)) {
+		next_task->rt.nr_sticky_stays++;
+		rt_sticky_arm(rq);
+		return 0;
+	}
+
 	if (is_migration_disabled(next_task)) {
 		struct task_struct *push_task = NULL;
 		int cpu;
@@ -2162,6 +2249,7 @@ static int push_rt_task(struct rq *rq, bool pull)
 	deactivate_task(rq, next_task, 0);
 	set_task_cpu(next_task, lowest_rq->cpu);
 	activate_task(lowest_rq, next_task, 0);
+	rq->rt.rt_nr_pushed++;
 	resched_curr(lowest_rq);
 	ret = 1;
 
@@ -2179,6 +2267,21 @@ static void push_rt_tasks(struct rq *rq)
 		;
 }
 
+/* Called from hardirq context, on the CPU the timer was armed for */
+static enum hrtimer_restart rt_sticky_timer_fn(struct hrtimer *timer)
+{
+	struct rq *rq = this_rq();
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+	update_rq_clock(rq);
+	rq_unpin_lock(rq, &rf);
+	push_rt_tasks(rq);
+	raw_spin_rq_unlock(rq);
+
+	return HRTIMER_NORESTART;
+}
+
 #ifdef HAVE_RT_PUSH_IPI
 
 /*
@@ -2429,12 +2532,18 @@ static void pull_rt_task(struct rq *this_rq)
 			if (p->prio < src_rq->curr->prio)
 				goto skip;
 
+			if (rt_sticky_stay(src_rq, p)) {
+				p->rt.nr_sticky_stays++;
+				goto skip;
+			}
+
 			if (is_migration_disabled(p)) {
 				push_task = get_push_task(src_rq);
 			} else {
 				deactivate_task(src_rq, p, 0);
 				set_task_cpu(p, this_cpu);
 				activate_task(this_rq, p, 0);
+				this_rq->rt.rt_nr_pulled++;
 				resched = true;
 			}
 			/*
@@ -2524,6 +2633,9 @@ void __init init_sched_rt_class(void)
 	for_each_possible_cpu(i) {
 		zalloc_cpumask_var_node(&per_cpu(local_cpu_mask, i),
 					GFP_KERNEL, cpu_to_node(i));
+		hrtimer_init(&per_cpu(rt_sticky_timer, i), CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL_HARD);
+		per_cpu(rt_sticky_timer, i).function = rt_sticky_timer_fn;
 	}
 }
 #endif /* CONFIG_SMP */
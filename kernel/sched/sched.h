@@ -10,6 +10,7 @@
 #include <linux/sched/cpufreq.h>
 #include <linux/sched/deadline.h>
 #include <linux/sched.h>
+#include <linux/sched/isolation.h>
 #include <linux/sched/loadavg.h>
 #include <linux/sched/mm.h>
 #include <linux/sched/rseq_api.h>
@@ -678,6 +679,10 @@ struct rt_rq {
 	int			overloaded;
 	struct plist_head	pushable_tasks;
 
+	/* rq_clock_task() when the current RT task was picked */
+	u64			curr_start;
+	unsigned long		rt_nr_pushed;
+	unsigned long		rt_nr_pulled;
 #endif /* CONFIG_SMP */
 	int			rt_queued;
 
@@ -990,6 +995,8 @@ struct rq {
 	struct cfs_rq		cfs;
 	struct rt_rq		rt;
 	struct dl_rq		dl;
+	/* Runs the fair tasks when the -rt ones starve them */
+	struct sched_dl_entity	fair_server;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this CPU: */
@@ -1127,6 +1134,12 @@ struct rq {
 	struct cpuidle_state	*idle_state;
 #endif
 
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+	/* The cpuidle state last left, or -1, and how long it was in it */
+	int			idle_exit_state;
+	u64			idle_exit_residency;
+#endif
+
 #ifdef CONFIG_SMP
 	unsigned int		nr_pinned;
 #endif
@@ -2358,6 +2371,17 @@ extern void init_dl_bandwidth(struct dl_bandwidth *dl_b, u64 period, u64 runtime
 extern void init_dl_task_timer(struct sched_dl_entity *dl_se);
 extern void init_dl_inactive_task_timer(struct sched_dl_entity *dl_se);
 
+extern void dl_server_init(struct sched_dl_entity *dl_se, struct rq *rq,
+			   dl_server_has_tasks_f has_tasks,
+			   dl_server_pick_f pick);
+extern int dl_server_apply_params(struct sched_dl_entity *dl_se,
+				  u64 runtime, u64 period);
+extern void dl_server_start(struct sched_dl_entity *dl_se);
+extern void dl_server_stop(struct sched_dl_entity *dl_se);
+extern void dl_server_update(struct sched_dl_entity *dl_se, s64 delta_exec);
+
+extern void fair_server_init(struct rq *rq);
+
 #define BW_SHIFT		20
 #define BW_UNIT			(1 << BW_SHIFT)
 #define RATIO_SHIFT		8
@@ -2394,6 +2418,107 @@ static inline int sched_tick_offload_init(void) { return 0; }
 static inline void sched_update_tick_dependency(struct rq *rq) { }
 #endif
 
+/*
+ * Only "rtcore=" takes the CPUs out of HK_TYPE_SCHED: on those, count
+ * what still takes the CPU away from the running task.
+ */
+#ifdef CONFIG_CPU_ISOLATION
+DECLARE_STATIC_KEY_FALSE(sched_rtcore_key);
+extern const struct file_operations sched_rtcore_fops;
+
+extern void __sched_rtcore_account_tick(struct rq *rq);
+extern void __sched_rtcore_account_wakeup(struct rq *rq);
+extern void __sched_rtcore_account_switch(struct rq *rq,
+					  struct task_struct *prev,
+					  struct task_struct *next);
+
+static inline bool sched_rtcore_cpu(struct rq *rq)
+{
+	return static_branch_unlikely(&sched_rtcore_key) &&
+	       !housekeeping_test_cpu(cpu_of(rq), HK_TYPE_SCHED);
+}
+
+static inline void sched_rtcore_account_tick(struct rq *rq)
+{
+	if (sched_rtcore_cpu(rq))
+		__sched_rtcore_account_tick(rq);
+}
+
+static inline void sched_rtcore_account_wakeup(struct rq *rq)
+{
+	if (sched_rtcore_cpu(rq))
+		__sched_rtcore_account_wakeup(rq);
+}
+
+static inline void sched_rtcore_account_switch(struct rq *rq,
+					       struct task_struct *prev,
+					       struct task_struct *next)
+{
+	if (sched_rtcore_cpu(rq))
+		__sched_rtcore_account_switch(rq, prev, next);
+}
+#else
+static inline void sched_rtcore_account_tick(struct rq *rq) { }
+static inline void sched_rtcore_account_wakeup(struct rq *rq) { }
+static inline void sched_rtcore_account_switch(struct rq *rq,
+					       struct task_struct *prev,
+					       struct task_struct *next) { }
+#endif
+
+#ifdef CONFIG_SCHED_INTERRUPTION_STATS
+extern void sched_interruptions_init(struct task_struct *p);
+extern void __sched_interruption(struct task_struct *p,
+				 enum sched_interruption_type type,
+				 int cpu, u64 start, u64 duration);
+extern void __sched_interruption_switch(struct rq *rq,
+					struct task_struct *prev,
+					struct task_struct *next);
+extern void __sched_rt_faults_policy(struct task_struct *p, bool rt);
+
+static inline void sched_interruption(struct task_struct *p,
+				      enum sched_interruption_type type,
+				      int cpu, u64 start, u64 duration)
+{
+	if (unlikely(rt_task(p)))
+		__sched_interruption(p, type, cpu, start, duration);
+}
+
+static inline void sched_interruption_switch(struct rq *rq,
+					     struct task_struct *prev,
+					     struct task_struct *next)
+{
+	if (unlikely(rt_task(prev) || next->sched_interruptions.preempted_at ||
+		     rq->idle_exit_state >= 0))
+		__sched_interruption_switch(rq, prev, next);
+}
+
+static inline void sched_interruption_idle_exit(struct rq *rq, int state,
+						u64 residency)
+{
+	rq->idle_exit_state = state;
+	rq->idle_exit_residency = residency;
+}
+
+/* @p is about to switch to @policy */
+static inline void sched_rt_faults_policy(struct task_struct *p, int policy)
+{
+	if (unlikely(rt_policy(policy) != rt_policy(p->policy)))
+		__sched_rt_faults_policy(p, rt_policy(policy));
+}
+#else
+static inline void sched_rt_faults_policy(struct task_struct *p,
+					  int policy) { }
+static inline void sched_interruptions_init(struct task_struct *p) { }
+static inline void sched_interruption(struct task_struct *p,
+				      enum sched_interruption_type type,
+				      int cpu, u64 start, u64 duration) { }
+static inline void sched_interruption_switch(struct rq *rq,
+					     struct task_struct *prev,
+					     struct task_struct *next) { }
+static inline void sched_interruption_idle_exit(struct rq *rq, int state,
+						u64 residency) { }
+#endif
+
 static inline void add_nr_running(struct rq *rq, unsigned count)
 {
 	unsigned prev_nr = rq->nr_running;
@@ -2437,6 +2562,7 @@ extern void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags);
 
 extern const_debug unsigned int sysctl_sched_nr_migrate;
 extern const_debug unsigned int sysctl_sched_migration_cost;
+extern const_debug unsigned int sysctl_sched_rt_sticky_wait;
 
 #ifdef CONFIG_SCHED_DEBUG
 extern unsigned int sysctl_sched_latency;
@@ -111,6 +111,11 @@ void psi_task_change(struct task_struct *task, int clear, int set);
 void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 		     bool sleep);
 void psi_account_irqtime(struct task_struct *task, u32 delta);
+#ifdef CONFIG_PSI_RT
+void psi_account_rtdelay(struct task_struct *task, u64 delay);
+#else
+static inline void psi_account_rtdelay(struct task_struct *task, u64 delay) {}
+#endif
 
 /*
  * PSI tracks state that persists across sleeps, such as iowaits and
@@ -207,6 +212,7 @@ static inline void psi_sched_switch(struct task_struct *prev,
 				    struct task_struct *next,
 				    bool sleep) {}
 static inline void psi_account_irqtime(struct task_struct *task, u32 delta) {}
+static inline void psi_account_rtdelay(struct task_struct *task, u64 delay) {}
 #endif /* CONFIG_PSI */
 
 #ifdef CONFIG_SCHED_INFO
@@ -250,6 +256,9 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(rq, delta);
+
+	if (rt_task(t))
+		psi_account_rtdelay(t, delta);
 }
 
 /*
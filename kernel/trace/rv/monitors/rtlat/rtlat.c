@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/ftrace.h>
+#include <linux/tracepoint.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/rv.h>
+#include <linux/sched/rt.h>
+#include <linux/timekeeping.h>
+#include <rv/instrumentation.h>
+#include <rv/da_monitor.h>
+
+#define MODULE_NAME "rtlat"
+
+#include <trace/events/rv.h>
+#include <trace/events/sched.h>
+#include <trace/events/lock.h>
+
+#include "rtlat.h"
+
+/*
+ * The latency contract of a real-time task, typically an audio thread:
+ * once woken by an interrupt it must be running within budget_us, and
+ * until it goes back to sleep, the end of its period, it must not
+ * block on a sleeping lock.
+ */
+static unsigned int budget_us = 100;
+module_param(budget_us, uint, 0644);
+MODULE_PARM_DESC(budget_us, "Wakeup to running budget in us (default 100)");
+
+static unsigned int min_prio = 1;
+module_param(min_prio, uint, 0644);
+MODULE_PARM_DESC(min_prio, "Lowest RT priority monitored (default 1)");
+
+static struct rv_monitor rv_rtlat;
+DECLARE_DA_MON_PER_TASK(rtlat, unsigned char);
+
+static struct da_timed_monitor *rtlat_get_monitor(struct task_struct *p)
+{
+	return container_of(da_get_monitor_rtlat(p), struct da_timed_monitor,
+			    da_mon);
+}
+
+static bool rtlat_task(struct task_struct *p)
+{
+	return rt_task(p) && p->rt_priority >= READ_ONCE(min_prio);
+}
+
+static void handle_waking(void *data, struct task_struct *p)
+{
+	struct da_timed_monitor *mon;
+
+	/* a task already on its CPU has no wakeup latency */
+	if (in_task() || !rtlat_task(p) || task_curr(p))
+		return;
+
+	/* the period starts with the first interrupt that wakes the task */
+	mon = rtlat_get_monitor(p);
+	if (mon->da_mon.monitoring && mon->da_mon.curr_state == idle_rtlat)
+		mon->timestamp = ktime_get_mono_fast_ns();
+
+	da_handle_event_rtlat(p, irq_wakeup_rtlat);
+}
+
+static void handle_switch(void *data, bool preempt, struct task_struct *p,
+			  struct task_struct *n, unsigned int prev_state)
+{
+	if (rtlat_task(p)) {
+		/* start monitoring on the first suspension */
+		if (prev_state == TASK_RUNNING)
+			da_handle_event_rtlat(p, preempt_rtlat);
+		else
+			da_handle_start_event_rtlat(p, sleep_rtlat);
+	}
+
+	if (rtlat_task(n)) {
+		struct da_timed_monitor *mon = rtlat_get_monitor(n);
+		u64 budget = (u64)READ_ONCE(budget_us) * NSEC_PER_USEC;
+
+		if (mon->da_mon.monitoring &&
+		    mon->da_mon.curr_state == woken_rtlat &&
+		    ktime_get_mono_fast_ns() - mon->timestamp > budget)
+			da_handle_event_rtlat(n, budget_exceeded_rtlat);
+
+		da_handle_event_rtlat(n, switch_in_rtlat);
+	}
+}
+
+static void handle_contention_begin(void *data, void *lock, unsigned int flags)
+{
+	/* spinning isn't blocking, mutexes also report their spin phase */
+	if (flags & LCB_F_SPIN)
+		return;
+
+	if (rtlat_task(current))
+		da_handle_event_rtlat(current, lock_sleep_rtlat);
+}
+
+static int enable_rtlat(void)
+{
+	int retval;
+
+	retval = da_monitor_init_rtlat();
+	if (retval)
+		return retval;
+
+	rv_attach_trace_probe("rtlat", sched_switch, handle_switch);
+	rv_attach_trace_probe("rtlat", sched_waking, handle_waking);
+	rv_attach_trace_probe("rtlat", contention_begin, handle_contention_begin);
+
+	return 0;
+}
+
+static void disable_rtlat(void)
+{
+	rv_rtlat.enabled = 0;
+
+	rv_detach_trace_probe("rtlat", sched_switch, handle_switch);
+	rv_detach_trace_probe("rtlat", sched_waking, handle_waking);
+	rv_detach_trace_probe("rtlat", contention_begin, handle_contention_begin);
+
+	da_monitor_destroy_rtlat();
+}
+
+static struct rv_monitor rv_rtlat = {
+	.name = "rtlat",
+	.description = "RT task wakeup latency and lock blocking per-task monitor.",
+	.enable = enable_rtlat,
+	.disable = disable_rtlat,
+	.reset = da_monitor_reset_all_rtlat,
+	.enabled = 0,
+};
+
+static int __init register_rtlat(void)
+{
+	rv_register_monitor(&rv_rtlat);
+	return 0;
+}
+
+static void __exit unregister_rtlat(void)
+{
+	rv_unregister_monitor(&rv_rtlat);
+}
+
+module_init(register_rtlat);
+module_exit(unregister_rtlat);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("rtlat: RT task wakeup latency budget monitor");
@@ -0,0 +1,58 @@
+/*
+ * Automatically generated C representation of rtlat automaton
+ * For further information about this format, see kernel documentation:
+ *   Documentation/trace/rv/deterministic_automata.rst
+ */
+
+enum states_rtlat {
+	idle_rtlat = 0,
+	woken_rtlat,
+	period_rtlat,
+	preempted_rtlat,
+	state_max_rtlat
+};
+
+#define INVALID_STATE state_max_rtlat
+
+enum events_rtlat {
+	irq_wakeup_rtlat = 0,
+	switch_in_rtlat,
+	preempt_rtlat,
+	sleep_rtlat,
+	lock_sleep_rtlat,
+	budget_exceeded_rtlat,
+	event_max_rtlat
+};
+
+struct automaton_rtlat {
+	char *state_names[state_max_rtlat];
+	char *event_names[event_max_rtlat];
+	unsigned char function[state_max_rtlat][event_max_rtlat];
+	unsigned char initial_state;
+	bool final_states[state_max_rtlat];
+};
+
+static struct automaton_rtlat automaton_rtlat = {
+	.state_names = {
+		"idle",
+		"woken",
+		"period",
+		"preempted"
+	},
+	.event_names = {
+		"irq_wakeup",
+		"switch_in",
+		"preempt",
+		"sleep",
+		"lock_sleep",
+		"budget_exceeded"
+	},
+	.function = {
+		{        woken_rtlat,         idle_rtlat,         idle_rtlat,         idle_rtlat,         idle_rtlat,      INVALID_STATE },
+		{        woken_rtlat,       period_rtlat,        woken_rtlat,         idle_rtlat,        woken_rtlat,      INVALID_STATE },
+		{       period_rtlat,       period_rtlat,    preempted_rtlat,         idle_rtlat,      INVALID_STATE,      INVALID_STATE },
+		{    preempted_rtlat,       period_rtlat,    preempted_rtlat,         idle_rtlat,    preempted_rtlat,      INVALID_STATE },
+	},
+	.initial_state = idle_rtlat,
+	.final_states = { 1, 0, 0, 0 },
+};
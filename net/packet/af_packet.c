@@ -1051,11 +1051,52 @@ static void prb_fill_curr_block(char *curr,
 	prb_run_all_ft_ops(pkc, ppd);
 }
 
+/*
+ * With TP_FT_REQ_TSTAMP_RETIRE, the block timeout is also measured in the
+ * packets' own timestamps, which can come from a PHC. A block is retired
+ * when a packet arrives retire_blk_tov ms after its first one. Timestamps
+ * from different clocks aren't compared.
+ */
+static bool prb_tstamp_expired(struct tpacket_kbdq_core *pkc,
+			       struct tpacket_block_desc *pbd,
+			       const struct timespec64 *ts, __u32 ts_status)
+{
+	struct tpacket_hdr_v1 *h1 = &pbd->hdr.bh1;
+	struct timespec64 first;
+
+	if (!(pkc->feature_req_word & TP_FT_REQ_TSTAMP_RETIRE) ||
+	    !BLOCK_NUM_PKTS(pbd) || ts_status != pkc->blk_ts_status)
+		return false;
+
+	first.tv_sec = h1->ts_first_pkt.ts_sec;
+	first.tv_nsec = h1->ts_first_pkt.ts_nsec;
+
+	return timespec64_to_ns(ts) - timespec64_to_ns(&first) >=
+	       (s64)pkc->retire_blk_tov * NSEC_PER_MSEC;
+}
+
+static void prb_fill_tstamp(struct tpacket_kbdq_core *pkc,
+			    struct tpacket_block_desc *pbd,
+			    const struct timespec64 *ts, __u32 ts_status)
+{
+	struct tpacket_hdr_v1 *h1 = &pbd->hdr.bh1;
+
+	if (!(pkc->feature_req_word & TP_FT_REQ_TSTAMP_RETIRE) ||
+	    BLOCK_NUM_PKTS(pbd) != 1)
+		return;
+
+	/* The block starts in the same time base as its packets */
+	h1->ts_first_pkt.ts_sec = ts->tv_sec;
+	h1->ts_first_pkt.ts_nsec = ts->tv_nsec;
+	pkc->blk_ts_status = ts_status;
+}
+
 /* Assumes caller has the sk->rx_queue.lock */
 static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 					    struct sk_buff *skb,
-					    unsigned int len
-					    )
+					    unsigned int len,
+					    const struct timespec64 *ts,
+					    __u32 ts_status)
 {
 	struct tpacket_kbdq_core *pkc;
 	struct tpacket_block_desc *pbd;
@@ -1090,8 +1131,10 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 	end = (char *)pbd + pkc->kblk_size;
 
 	/* first try the current block */
-	if (curr+TOTAL_PKT_LEN_INCL_ALIGN(len) < end) {
+	if (curr+TOTAL_PKT_LEN_INCL_ALIGN(len) < end &&
+	    !prb_tstamp_expired(pkc, pbd, ts, ts_status)) {
 		prb_fill_curr_block(curr, pkc, pbd, len);
+		prb_fill_tstamp(pkc, pbd, ts, ts_status);
 		return (void *)curr;
 	}
 
@@ -1103,6 +1146,7 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 	if (curr) {
 		pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 		prb_fill_curr_block(curr, pkc, pbd, len);
+		prb_fill_tstamp(pkc, pbd, ts, ts_status);
 		return (void *)curr;
 	}
 
@@ -1115,7 +1159,9 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 
 static void *packet_current_rx_frame(struct packet_sock *po,
 					    struct sk_buff *skb,
-					    int status, unsigned int len)
+					    int status, unsigned int len,
+					    const struct timespec64 *ts,
+					    __u32 ts_status)
 {
 	char *curr = NULL;
 	switch (po->tp_version) {
@@ -1125,7 +1171,8 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 					po->rx_ring.head, status);
 		return curr;
 	case TPACKET_V3:
-		return __packet_lookup_frame_in_block(po, skb, len);
+		return __packet_lookup_frame_in_block(po, skb, len, ts,
+						      ts_status);
 	default:
 		WARN(1, "TPACKET version not supported\n");
 		BUG();
@@ -2356,9 +2403,20 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			do_vnet = false;
 		}
 	}
+
+	/* Always timestamp; prefer an existing software timestamp taken
+	 * closer to the time of capture.
+	 */
+	ts_status = tpacket_get_timestamp(skb, &ts,
+					  po->tp_tstamp | SOF_TIMESTAMPING_SOFTWARE);
+	if (!ts_status)
+		ktime_get_real_ts64(&ts);
+
+	status |= ts_status;
+
 	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_rx_frame(po, skb,
-					TP_STATUS_KERNEL, (macoff+snaplen));
+	h.raw = packet_current_rx_frame(po, skb, TP_STATUS_KERNEL,
+					(macoff+snaplen), &ts, ts_status);
 	if (!h.raw)
 		goto drop_n_account;
 
@@ -2400,16 +2458,6 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
-	/* Always timestamp; prefer an existing software timestamp taken
-	 * closer to the time of capture.
-	 */
-	ts_status = tpacket_get_timestamp(skb, &ts,
-					  po->tp_tstamp | SOF_TIMESTAMPING_SOFTWARE);
-	if (!ts_status)
-		ktime_get_real_ts64(&ts);
-
-	status |= ts_status;
-
 	switch (po->tp_version) {
 	case TPACKET_V1:
 		h.h1->tp_len = skb->len;
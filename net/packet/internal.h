@@ -48,6 +48,11 @@ struct tpacket_kbdq_core {
 	unsigned short  version;
 	unsigned long	tov_in_jiffies;
 
+	/* TP_STATUS_TS_* of the current block's first packet, for
+	 * TP_FT_REQ_TSTAMP_RETIRE
+	 */
+	__u32		blk_ts_status;
+
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
 };
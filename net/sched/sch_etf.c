@@ -14,6 +14,7 @@
 #include <linux/errqueue.h>
 #include <linux/rbtree.h>
 #include <linux/skbuff.h>
+#include <linux/math64.h>
 #include <linux/posix-timers.h>
 #include <net/netlink.h>
 #include <net/sch_generic.h>
@@ -23,11 +24,13 @@
 #define DEADLINE_MODE_IS_ON(x) ((x)->flags & TC_ETF_DEADLINE_MODE_ON)
 #define OFFLOAD_IS_ON(x) ((x)->flags & TC_ETF_OFFLOAD_ON)
 #define SKIP_SOCK_CHECK_IS_SET(x) ((x)->flags & TC_ETF_SKIP_SOCK_CHECK)
+#define PACE_GSO_IS_SET(x) ((x)->flags & TC_ETF_PACE_GSO)
 
 struct etf_sched_data {
 	bool offload;
 	bool deadline_mode;
 	bool skip_sock_check;
+	bool pace_gso;
 	int clockid;
 	int queue;
 	s32 delta; /* in ns */
@@ -159,8 +162,8 @@ static void report_sock_error(struct sk_buff *skb, u32 err, u8 code)
 		kfree_skb(clone);
 }
 
-static int etf_enqueue_timesortedlist(struct sk_buff *nskb, struct Qdisc *sch,
-				      struct sk_buff **to_free)
+static int etf_enqueue_one(struct sk_buff *nskb, struct Qdisc *sch,
+			   struct sk_buff **to_free)
 {
 	struct etf_sched_data *q = qdisc_priv(sch);
 	struct rb_node **p = &q->head.rb_root.rb_node, *parent = NULL;
@@ -197,6 +200,71 @@ static int etf_enqueue_timesortedlist(struct sk_buff *nskb, struct Qdisc *sch,
 	return NET_XMIT_SUCCESS;
 }
 
+/* A GSO skb is a train of packets, sent with a single sendmsg() and a
+ * single txtime. Split it, and give each segment its own txtime: the
+ * first one is sent at the skb's txtime, and the following ones are
+ * spaced by the socket's pacing rate (SO_MAX_PACING_RATE).
+ */
+static int etf_enqueue_segmented(struct sk_buff *skb, struct Qdisc *sch,
+				 struct sk_buff **to_free)
+{
+	unsigned int slen = 0, numsegs = 0, len = qdisc_pkt_len(skb);
+	unsigned int seglen;
+	netdev_features_t features = netif_skb_features(skb);
+	unsigned long rate = ~0UL;
+	struct sk_buff *segs, *nskb;
+	struct sock *sk = skb->sk;
+	u64 offset = 0;
+	int ret;
+
+	if (!is_packet_valid(sch, skb)) {
+		report_sock_error(skb, EINVAL,
+				  SO_EE_CODE_TXTIME_INVALID_PARAM);
+		return qdisc_drop(skb, sch, to_free);
+	}
+
+	if (sk && sk_fullsock(sk))
+		rate = READ_ONCE(sk->sk_pacing_rate);
+
+	segs = skb_gso_segment(skb, features & ~NETIF_F_GSO_MASK);
+	if (IS_ERR_OR_NULL(segs))
+		return qdisc_drop(skb, sch, to_free);
+
+	skb_list_walk_safe(segs, segs, nskb) {
+		skb_mark_not_on_list(segs);
+		qdisc_skb_cb(segs)->pkt_len = segs->len;
+		segs->tstamp = ktime_add_ns(skb->tstamp, offset);
+		if (rate && rate != ~0UL)
+			offset += div64_ul((u64)segs->len * NSEC_PER_SEC,
+					   rate);
+
+		/* A segment that is dropped was counted by qdisc_drop() */
+		seglen = segs->len;
+		ret = etf_enqueue_one(segs, sch, to_free);
+		if (ret == NET_XMIT_SUCCESS) {
+			slen += seglen;
+			numsegs++;
+		}
+	}
+
+	if (numsegs > 1)
+		qdisc_tree_reduce_backlog(sch, 1 - numsegs, len - slen);
+	consume_skb(skb);
+
+	return numsegs > 0 ? NET_XMIT_SUCCESS : NET_XMIT_DROP;
+}
+
+static int etf_enqueue_timesortedlist(struct sk_buff *skb, struct Qdisc *sch,
+				      struct sk_buff **to_free)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+
+	if (q->pace_gso && skb_is_gso(skb))
+		return etf_enqueue_segmented(skb, sch, to_free);
+
+	return etf_enqueue_one(skb, sch, to_free);
+}
+
 static void timesortedlist_drop(struct Qdisc *sch, struct sk_buff *skb,
 				ktime_t now)
 {
@@ -390,6 +458,7 @@ static int etf_init(struct Qdisc *sch, struct nlattr *opt,
 	q->offload = OFFLOAD_IS_ON(qopt);
 	q->deadline_mode = DEADLINE_MODE_IS_ON(qopt);
 	q->skip_sock_check = SKIP_SOCK_CHECK_IS_SET(qopt);
+	q->pace_gso = PACE_GSO_IS_SET(qopt);
 
 	switch (q->clockid) {
 	case CLOCK_REALTIME:
@@ -478,6 +547,9 @@ static int etf_dump(struct Qdisc *sch, struct sk_buff *skb)
 	if (q->skip_sock_check)
 		opt.flags |= TC_ETF_SKIP_SOCK_CHECK;
 
+	if (q->pace_gso)
+		opt.flags |= TC_ETF_PACE_GSO;
+
 	if (nla_put(skb, TCA_ETF_PARMS, sizeof(opt), &opt))
 		goto nla_put_failure;
 
@@ -16,6 +16,9 @@
 #include <linux/skbuff.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <net/dsfield.h>
 #include <net/netlink.h>
 #include <net/pkt_sched.h>
 #include <net/pkt_cls.h>
@@ -37,8 +40,21 @@
  * head drops only.
  * ECN capability is on by default.
  * Low memory footprint (64 bytes per flow)
+ *
+ * Packets whose DSCP is in prio_dscp go to an extra CoDel managed flow,
+ * the priority band, which is served ahead of all the other flows.
  */
 
+#define DSCP_BIT(dscp)	BIT_ULL(dscp)
+
+#ifdef CONFIG_NET_SCH_FQ_CODEL_PRIO
+/* EF, CS5, CS6 and CS7 */
+#define FQ_CODEL_PRIO_DSCP_DEFAULT	(DSCP_BIT(46) | DSCP_BIT(40) | \
+					 DSCP_BIT(48) | DSCP_BIT(56))
+#else
+#define FQ_CODEL_PRIO_DSCP_DEFAULT	0
+#endif
+
 struct fq_codel_flow {
 	struct sk_buff	  *head;
 	struct sk_buff	  *tail;
@@ -50,8 +66,8 @@ struct fq_codel_flow {
 struct fq_codel_sched_data {
 	struct tcf_proto __rcu *filter_list; /* optional external classifier */
 	struct tcf_block *block;
-	struct fq_codel_flow *flows;	/* Flows table [flows_cnt] */
-	u32		*backlogs;	/* backlog table [flows_cnt] */
+	struct fq_codel_flow *flows;	/* Flows table [flows_cnt + 1] */
+	u32		*backlogs;	/* backlog table [flows_cnt + 1] */
 	u32		flows_cnt;	/* number of flows */
 	u32		quantum;	/* psched_mtu(qdisc_dev(sch)); */
 	u32		drop_batch_size;
@@ -62,6 +78,11 @@ struct fq_codel_sched_data {
 	u32		drop_overmemory;
 	u32		drop_overlimit;
 	u32		new_flow_count;
+	u64		prio_dscp;	/* DSCPs sent to the priority band */
+	u32		prio_packets;
+	codel_time_t	prio_maxdelay;
+	codel_time_t	bulk_maxdelay;
+	codel_time_t	bulk_ldelay;
 
 	struct list_head new_flows;	/* list of new flows */
 	struct list_head old_flows;	/* list of old flows */
@@ -73,6 +94,30 @@ static unsigned int fq_codel_hash(const struct fq_codel_sched_data *q,
 	return reciprocal_scale(skb_get_hash(skb), q->flows_cnt);
 }
 
+static u8 fq_codel_get_dscp(struct sk_buff *skb)
+{
+	int offset = skb_network_offset(skb);
+
+	switch (skb_protocol(skb, true)) {
+	case htons(ETH_P_IP): {
+		const struct iphdr *iph;
+		struct iphdr _iph;
+
+		iph = skb_header_pointer(skb, offset, sizeof(_iph), &_iph);
+		return iph ? ipv4_get_dsfield(iph) >> 2 : 0;
+	}
+	case htons(ETH_P_IPV6): {
+		const struct ipv6hdr *ip6h;
+		struct ipv6hdr _ip6h;
+
+		ip6h = skb_header_pointer(skb, offset, sizeof(_ip6h), &_ip6h);
+		return ip6h ? ipv6_get_dsfield(ip6h) >> 2 : 0;
+	}
+	default:
+		return 0;
+	}
+}
+
 static unsigned int fq_codel_classify(struct sk_buff *skb, struct Qdisc *sch,
 				      int *qerr)
 {
@@ -86,6 +131,10 @@ static unsigned int fq_codel_classify(struct sk_buff *skb, struct Qdisc *sch,
 	    TC_H_MIN(skb->priority) <= q->flows_cnt)
 		return TC_H_MIN(skb->priority);
 
+	/* the priority band is the flow past the hashed ones */
+	if (q->prio_dscp && q->prio_dscp & DSCP_BIT(fq_codel_get_dscp(skb)))
+		return q->flows_cnt + 1;
+
 	filter = rcu_dereference_bh(q->filter_list);
 	if (!filter)
 		return fq_codel_hash(q, skb) + 1;
@@ -150,8 +199,9 @@ static unsigned int fq_codel_drop(struct Qdisc *sch, unsigned int max_packets,
 	 * in fast path (packet queue/enqueue) with many cache misses.
 	 * In stress mode, we'll try to drop 64 packets from the flow,
 	 * amortizing this linear lookup to one cache line per drop.
+	 * The priority band is included, it must not grow unbounded.
 	 */
-	for (i = 0; i < q->flows_cnt; i++) {
+	for (i = 0; i <= q->flows_cnt; i++) {
 		if (q->backlogs[i] > maxbacklog) {
 			maxbacklog = q->backlogs[i];
 			idx = i;
@@ -206,7 +256,7 @@ static int fq_codel_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	q->backlogs[idx] += qdisc_pkt_len(skb);
 	qdisc_qstats_backlog_inc(sch, skb);
 
-	if (list_empty(&flow->flowchain)) {
+	if (idx < q->flows_cnt && list_empty(&flow->flowchain)) {
 		list_add_tail(&flow->flowchain, &q->new_flows);
 		q->new_flow_count++;
 		flow->deficit = q->quantum;
@@ -278,6 +328,37 @@ static void drop_func(struct sk_buff *skb, void *ctx)
 	qdisc_qstats_drop(sch);
 }
 
+static void fq_codel_update_delay(codel_time_t *maxdelay,
+				  const struct sk_buff *skb)
+{
+	codel_time_t sojourn = codel_get_time() - codel_get_enqueue_time(skb);
+
+	if (codel_time_after(sojourn, *maxdelay))
+		*maxdelay = sojourn;
+}
+
+/* The priority band is strict, but still CoDel managed: a sender that
+ * floods it with EF marked bulk traffic is dropped like any other.
+ */
+static struct sk_buff *fq_codel_dequeue_prio(struct Qdisc *sch)
+{
+	struct fq_codel_sched_data *q = qdisc_priv(sch);
+	struct fq_codel_flow *flow = &q->flows[q->flows_cnt];
+	struct sk_buff *skb;
+
+	if (!flow->head)
+		return NULL;
+
+	skb = codel_dequeue(sch, &sch->qstats.backlog, &q->cparams,
+			    &flow->cvars, &q->cstats, qdisc_pkt_len,
+			    codel_get_enqueue_time, drop_func, dequeue_func);
+	if (skb) {
+		q->prio_packets++;
+		fq_codel_update_delay(&q->prio_maxdelay, skb);
+	}
+	return skb;
+}
+
 static struct sk_buff *fq_codel_dequeue(struct Qdisc *sch)
 {
 	struct fq_codel_sched_data *q = qdisc_priv(sch);
@@ -285,6 +366,10 @@ static struct sk_buff *fq_codel_dequeue(struct Qdisc *sch)
 	struct fq_codel_flow *flow;
 	struct list_head *head;
 
+	skb = fq_codel_dequeue_prio(sch);
+	if (skb)
+		goto out;
+
 begin:
 	head = &q->new_flows;
 	if (list_empty(head)) {
@@ -312,8 +397,11 @@ static struct sk_buff *fq_codel_dequeue(struct Qdisc *sch)
 			list_del_init(&flow->flowchain);
 		goto begin;
 	}
-	qdisc_bstats_update(sch, skb);
 	flow->deficit -= qdisc_pkt_len(skb);
+	q->bulk_ldelay = flow->cvars.ldelay;
+	fq_codel_update_delay(&q->bulk_maxdelay, skb);
+out:
+	qdisc_bstats_update(sch, skb);
 	/* We cant call qdisc_tree_reduce_backlog() if our qlen is 0,
 	 * or HTB crashes. Defer it for next round.
 	 */
@@ -339,14 +427,14 @@ static void fq_codel_reset(struct Qdisc *sch)
 
 	INIT_LIST_HEAD(&q->new_flows);
 	INIT_LIST_HEAD(&q->old_flows);
-	for (i = 0; i < q->flows_cnt; i++) {
+	for (i = 0; i <= q->flows_cnt; i++) {
 		struct fq_codel_flow *flow = q->flows + i;
 
 		fq_codel_flow_purge(flow);
 		INIT_LIST_HEAD(&flow->flowchain);
 		codel_vars_init(&flow->cvars);
 	}
-	memset(q->backlogs, 0, q->flows_cnt * sizeof(u32));
+	memset(q->backlogs, 0, (q->flows_cnt + 1) * sizeof(u32));
 	q->memory_usage = 0;
 }
 
@@ -362,6 +450,7 @@ static const struct nla_policy fq_codel_policy[TCA_FQ_CODEL_MAX + 1] = {
 	[TCA_FQ_CODEL_MEMORY_LIMIT] = { .type = NLA_U32 },
 	[TCA_FQ_CODEL_CE_THRESHOLD_SELECTOR] = { .type = NLA_U8 },
 	[TCA_FQ_CODEL_CE_THRESHOLD_MASK] = { .type = NLA_U8 },
+	[TCA_FQ_CODEL_PRIO_DSCP] = { .type = NLA_U64 },
 };
 
 static int fq_codel_change(struct Qdisc *sch, struct nlattr *opt,
@@ -425,6 +514,9 @@ static int fq_codel_change(struct Qdisc *sch, struct nlattr *opt,
 	if (quantum)
 		q->quantum = quantum;
 
+	if (tb[TCA_FQ_CODEL_PRIO_DSCP])
+		q->prio_dscp = nla_get_u64(tb[TCA_FQ_CODEL_PRIO_DSCP]);
+
 	if (tb[TCA_FQ_CODEL_DROP_BATCH_SIZE])
 		q->drop_batch_size = max(1U, nla_get_u32(tb[TCA_FQ_CODEL_DROP_BATCH_SIZE]));
 
@@ -468,6 +560,7 @@ static int fq_codel_init(struct Qdisc *sch, struct nlattr *opt,
 	q->memory_limit = 32 << 20; /* 32 MBytes */
 	q->drop_batch_size = 64;
 	q->quantum = psched_mtu(qdisc_dev(sch));
+	q->prio_dscp = FQ_CODEL_PRIO_DSCP_DEFAULT;
 	INIT_LIST_HEAD(&q->new_flows);
 	INIT_LIST_HEAD(&q->old_flows);
 	codel_params_init(&q->cparams);
@@ -486,19 +579,20 @@ static int fq_codel_init(struct Qdisc *sch, struct nlattr *opt,
 		goto init_failure;
 
 	if (!q->flows) {
-		q->flows = kvcalloc(q->flows_cnt,
+		q->flows = kvcalloc(q->flows_cnt + 1,
 				    sizeof(struct fq_codel_flow),
 				    GFP_KERNEL);
 		if (!q->flows) {
 			err = -ENOMEM;
 			goto init_failure;
 		}
-		q->backlogs = kvcalloc(q->flows_cnt, sizeof(u32), GFP_KERNEL);
+		q->backlogs = kvcalloc(q->flows_cnt + 1, sizeof(u32),
+				       GFP_KERNEL);
 		if (!q->backlogs) {
 			err = -ENOMEM;
 			goto alloc_failure;
 		}
-		for (i = 0; i < q->flows_cnt; i++) {
+		for (i = 0; i <= q->flows_cnt; i++) {
 			struct fq_codel_flow *flow = q->flows + i;
 
 			INIT_LIST_HEAD(&flow->flowchain);
@@ -543,7 +637,9 @@ static int fq_codel_dump(struct Qdisc *sch, struct sk_buff *skb)
 	    nla_put_u32(skb, TCA_FQ_CODEL_MEMORY_LIMIT,
 			q->memory_limit) ||
 	    nla_put_u32(skb, TCA_FQ_CODEL_FLOWS,
-			q->flows_cnt))
+			q->flows_cnt) ||
+	    nla_put_u64_64bit(skb, TCA_FQ_CODEL_PRIO_DSCP,
+			      q->prio_dscp, TCA_FQ_CODEL_PAD))
 		goto nla_put_failure;
 
 	if (q->cparams.ce_threshold != CODEL_DISABLED_THRESHOLD) {
@@ -577,8 +673,15 @@ static int fq_codel_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 	st.qdisc_stats.ce_mark = q->cstats.ce_mark;
 	st.qdisc_stats.memory_usage  = q->memory_usage;
 	st.qdisc_stats.drop_overmemory = q->drop_overmemory;
+	st.qdisc_stats.prio_packets = q->prio_packets;
+	st.qdisc_stats.bulk_ldelay = codel_time_to_us(q->bulk_ldelay);
+	st.qdisc_stats.prio_maxdelay = codel_time_to_us(q->prio_maxdelay);
+	st.qdisc_stats.bulk_maxdelay = codel_time_to_us(q->bulk_maxdelay);
 
 	sch_tree_lock(sch);
+	if (q->flows)
+		st.qdisc_stats.prio_ldelay =
+			codel_time_to_us(q->flows[q->flows_cnt].cvars.ldelay);
 	list_for_each(pos, &q->new_flows)
 		st.qdisc_stats.new_flows_len++;
 
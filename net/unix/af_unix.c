@@ -568,6 +568,8 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	/* MSG_ZEROCOPY completions, all in by now as they hold a reference */
+	skb_queue_purge(&sk->sk_error_queue);
 
 	DEBUG_NET_WARN_ON_ONCE(refcount_read(&sk->sk_wmem_alloc));
 	DEBUG_NET_WARN_ON_ONCE(!sk_unhashed(sk));
@@ -1893,8 +1895,11 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	DECLARE_SOCKADDR(struct sockaddr_un *, sunaddr, msg->msg_name);
 	struct sock *sk = sock->sk, *other = NULL;
 	struct unix_sock *u = unix_sk(sk);
+	struct ubuf_info *uarg = NULL;
+	struct sk_buff *skb = NULL;
+	bool extra_uref = true;
 	struct scm_cookie scm;
-	struct sk_buff *skb;
+	bool zc = false;
 	int data_len = 0;
 	int sk_locked;
 	long timeo;
@@ -1931,31 +1936,62 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (len > sk->sk_sndbuf - 32)
 		goto out;
 
-	if (len > SKB_MAX_ALLOC) {
-		data_len = min_t(size_t,
-				 len - SKB_MAX_ALLOC,
-				 MAX_SKB_FRAGS * PAGE_SIZE);
-		data_len = PAGE_ALIGN(data_len);
+	/* The receiver copies straight from the sender's pages, which stay
+	 * pinned until it has read the message. The completion is queued
+	 * on the sender's error queue, as for the other MSG_ZEROCOPY
+	 * sockets.
+	 */
+	if ((msg->msg_flags & MSG_ZEROCOPY) && len &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out;
+		}
 
-		BUILD_BUG_ON(SKB_MAX_ALLOC < PAGE_SIZE);
+		/* A message spread over more pages than frags is copied */
+		zc = iov_iter_npages(&msg->msg_iter, MAX_SKB_FRAGS + 1) <=
+		     MAX_SKB_FRAGS;
+		if (!zc)
+			uarg_to_msgzc(uarg)->zerocopy = 0;
 	}
 
-	skb = sock_alloc_send_pskb(sk, len - data_len, data_len,
-				   msg->msg_flags & MSG_DONTWAIT, &err,
-				   PAGE_ALLOC_COSTLY_ORDER);
+	if (zc) {
+		skb = sock_alloc_send_pskb(sk, 0, 0,
+					   msg->msg_flags & MSG_DONTWAIT, &err,
+					   0);
+	} else {
+		if (len > SKB_MAX_ALLOC) {
+			data_len = min_t(size_t,
+					 len - SKB_MAX_ALLOC,
+					 MAX_SKB_FRAGS * PAGE_SIZE);
+			data_len = PAGE_ALIGN(data_len);
+
+			BUILD_BUG_ON(SKB_MAX_ALLOC < PAGE_SIZE);
+		}
+
+		skb = sock_alloc_send_pskb(sk, len - data_len, data_len,
+					   msg->msg_flags & MSG_DONTWAIT, &err,
+					   PAGE_ALLOC_COSTLY_ORDER);
+	}
 	if (skb == NULL)
-		goto out;
+		goto out_free;
 
 	err = unix_scm_to_skb(&scm, skb, true);
 	if (err < 0)
 		goto out_free;
 
-	skb_put(skb, len - data_len);
-	skb->data_len = data_len;
-	skb->len = len;
-	err = skb_copy_datagram_from_iter(skb, 0, &msg->msg_iter, len);
+	if (zc) {
+		err = skb_zerocopy_iter_dgram(skb, msg, len);
+	} else {
+		skb_put(skb, len - data_len);
+		skb->data_len = data_len;
+		skb->len = len;
+		err = skb_copy_datagram_from_iter(skb, 0, &msg->msg_iter, len);
+	}
 	if (err)
 		goto out_free;
+	skb_zcopy_set(skb, uarg, &extra_uref);
 
 	timeo = sock_sndtimeo(sk, msg->msg_flags & MSG_DONTWAIT);
 
@@ -2090,6 +2126,9 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 		unix_state_unlock(sk);
 	unix_state_unlock(other);
 out_free:
+	/* Before the skb goes, so that no completion is reported */
+	if (err < 0)
+		net_zcopy_put_abort(uarg, extra_uref);
 	kfree_skb(skb);
 out:
 	if (other)
@@ -2441,6 +2480,10 @@ int __unix_dgram_recvmsg(struct sock *sk, struct msghdr *msg, size_t size,
 	if (flags&MSG_OOB)
 		goto out;
 
+	/* MSG_ZEROCOPY completions, reported the way RDS does */
+	if (flags & MSG_ERRQUEUE)
+		return sock_recv_errqueue(sk, msg, size, SOL_IP, IP_RECVERR);
+
 	timeo = sock_rcvtimeo(sk, flags & MSG_DONTWAIT);
 
 	do {
@@ -5,6 +5,7 @@
  */
 
 #include <linux/threads.h>
+#include <linux/bitmap.h>
 #include <linux/interrupt.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
@@ -24,6 +25,11 @@ static int max_user_ctl_alloc_size = 8 * 1024 * 1024;
 module_param_named(max_user_ctl_alloc_size, max_user_ctl_alloc_size, int, 0444);
 MODULE_PARM_DESC(max_user_ctl_alloc_size, "Max allocation size for user controls");
 
+// Min interval between the wakeups of an event reader, 0 for no limit.
+static unsigned int notify_interval_us;
+module_param(notify_interval_us, uint, 0644);
+MODULE_PARM_DESC(notify_interval_us, "Min interval between control event wakeups of a reader (us)");
+
 #define MAX_CONTROL_COUNT	1028
 
 struct snd_kctl_ioctl {
@@ -39,6 +45,21 @@ static LIST_HEAD(snd_control_compat_ioctls);
 #endif
 static struct snd_ctl_layer_ops *snd_ctl_layer;
 
+static enum hrtimer_restart snd_ctl_wakeup_timer(struct hrtimer *timer)
+{
+	struct snd_ctl_file *ctl = container_of(timer, struct snd_ctl_file,
+						wakeup_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctl->read_lock, flags);
+	ctl->last_wakeup = ktime_get();
+	wake_up(&ctl->change_sleep);
+	spin_unlock_irqrestore(&ctl->read_lock, flags);
+	snd_kill_fasync(ctl->fasync, SIGIO, POLL_IN);
+
+	return HRTIMER_NORESTART;
+}
+
 static int snd_ctl_open(struct inode *inode, struct file *file)
 {
 	unsigned long flags;
@@ -70,8 +91,11 @@ static int snd_ctl_open(struct inode *inode, struct file *file)
 		goto __error;
 	}
 	INIT_LIST_HEAD(&ctl->events);
+	hash_init(ctl->events_hash);
 	init_waitqueue_head(&ctl->change_sleep);
 	spin_lock_init(&ctl->read_lock);
+	hrtimer_init(&ctl->wakeup_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	ctl->wakeup_timer.function = snd_ctl_wakeup_timer;
 	ctl->card = card;
 	for (i = 0; i < SND_CTL_SUBDEV_ITEMS; i++)
 		ctl->preferred_subdevice[i] = -1;
@@ -101,6 +125,7 @@ static void snd_ctl_empty_read_queue(struct snd_ctl_file * ctl)
 	spin_lock_irqsave(&ctl->read_lock, flags);
 	while (!list_empty(&ctl->events)) {
 		cread = snd_kctl_event(ctl->events.next);
+		hash_del(&cread->hnode);
 		list_del(&cread->list);
 		kfree(cread);
 	}
@@ -121,6 +146,7 @@ static int snd_ctl_release(struct inode *inode, struct file *file)
 	write_lock_irqsave(&card->ctl_files_rwlock, flags);
 	list_del(&ctl->list);
 	write_unlock_irqrestore(&card->ctl_files_rwlock, flags);
+	hrtimer_cancel(&ctl->wakeup_timer);
 	down_write(&card->controls_rwsem);
 	list_for_each_entry(control, &card->controls, list)
 		for (idx = 0; idx < control->count; idx++)
@@ -136,6 +162,31 @@ static int snd_ctl_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/*
+ * Whether to wake up the reader now, or to leave it to the wakeup timer.
+ * The events queued in the meantime are merged per element as usual, so a
+ * busy control costs the reader one event per interval.
+ */
+static bool snd_ctl_wakeup_due(struct snd_ctl_file *ctl)
+{
+	unsigned int interval_us = READ_ONCE(notify_interval_us);
+	ktime_t now, next;
+
+	if (!interval_us)
+		return true;
+	if (hrtimer_is_queued(&ctl->wakeup_timer))
+		return false;
+
+	now = ktime_get();
+	next = ktime_add_us(ctl->last_wakeup, interval_us);
+	if (!ktime_before(now, next)) {
+		ctl->last_wakeup = now;
+		return true;
+	}
+	hrtimer_start(&ctl->wakeup_timer, next, HRTIMER_MODE_ABS);
+	return false;
+}
+
 /**
  * snd_ctl_notify - Send notification to user-space for a control change
  * @card: the card to send notification
@@ -143,8 +194,9 @@ static int snd_ctl_release(struct inode *inode, struct file *file)
  * @id: the ctl element id to send notification
  *
  * This function adds an event record with the given id and mask, appends
- * to the list and wakes up the user-space for notification.  This can be
- * called in the atomic context.
+ * to the list and wakes up the user-space for notification.  A pending
+ * event for the same element is merged instead.  This can be called in
+ * the atomic context.
  */
 void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 		    struct snd_ctl_elem_id *id)
@@ -152,6 +204,7 @@ void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 	unsigned long flags;
 	struct snd_ctl_file *ctl;
 	struct snd_kctl_event *ev;
+	bool wake;
 
 	if (snd_BUG_ON(!card || !id))
 		return;
@@ -165,7 +218,7 @@ void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 		if (!ctl->subscribed)
 			continue;
 		spin_lock(&ctl->read_lock);
-		list_for_each_entry(ev, &ctl->events, list) {
+		hash_for_each_possible(ctl->events_hash, ev, hnode, id->numid) {
 			if (ev->id.numid == id->numid) {
 				ev->mask |= mask;
 				goto _found;
@@ -176,13 +229,17 @@ void snd_ctl_notify(struct snd_card *card, unsigned int mask,
 			ev->id = *id;
 			ev->mask = mask;
 			list_add_tail(&ev->list, &ctl->events);
+			hash_add(ctl->events_hash, &ev->hnode, id->numid);
 		} else {
 			dev_err(card->dev, "No memory available to allocate event\n");
 		}
 	_found:
-		wake_up(&ctl->change_sleep);
+		wake = snd_ctl_wakeup_due(ctl);
+		if (wake)
+			wake_up(&ctl->change_sleep);
 		spin_unlock(&ctl->read_lock);
-		snd_kill_fasync(ctl->fasync, SIGIO, POLL_IN);
+		if (wake)
+			snd_kill_fasync(ctl->fasync, SIGIO, POLL_IN);
 	}
 	read_unlock_irqrestore(&card->ctl_files_rwlock, flags);
 }
@@ -1193,8 +1250,9 @@ static int snd_ctl_elem_info_user(struct snd_ctl_file *ctl,
 	return result;
 }
 
-static int snd_ctl_elem_read(struct snd_card *card,
-			     struct snd_ctl_elem_value *control)
+/* call with card->controls_rwsem held */
+static int __snd_ctl_elem_read(struct snd_card *card,
+			       struct snd_ctl_elem_value *control)
 {
 	struct snd_kcontrol *kctl;
 	struct snd_kcontrol_volatile *vd;
@@ -1203,19 +1261,14 @@ static int snd_ctl_elem_read(struct snd_card *card,
 	const u32 pattern = 0xdeadbeef;
 	int ret;
 
-	down_read(&card->controls_rwsem);
 	kctl = snd_ctl_find_id(card, &control->id);
-	if (kctl == NULL) {
-		ret = -ENOENT;
-		goto unlock;
-	}
+	if (kctl == NULL)
+		return -ENOENT;
 
 	index_offset = snd_ctl_get_ioff(kctl, &control->id);
 	vd = &kctl->vd[index_offset];
-	if (!(vd->access & SNDRV_CTL_ELEM_ACCESS_READ) || kctl->get == NULL) {
-		ret = -EPERM;
-		goto unlock;
-	}
+	if (!(vd->access & SNDRV_CTL_ELEM_ACCESS_READ) || kctl->get == NULL)
+		return -EPERM;
 
 	snd_ctl_build_ioff(&control->id, kctl, index_offset);
 
@@ -1225,7 +1278,7 @@ static int snd_ctl_elem_read(struct snd_card *card,
 	info.id = control->id;
 	ret = __snd_ctl_elem_info(card, kctl, &info, NULL);
 	if (ret < 0)
-		goto unlock;
+		return ret;
 #endif
 
 	if (!snd_ctl_skip_validation(&info))
@@ -1235,7 +1288,7 @@ static int snd_ctl_elem_read(struct snd_card *card,
 		ret = kctl->get(kctl, control);
 	snd_power_unref(card);
 	if (ret < 0)
-		goto unlock;
+		return ret;
 	if (!snd_ctl_skip_validation(&info) &&
 	    sanity_check_elem_value(card, control, &info, pattern) < 0) {
 		dev_err(card->dev,
@@ -1243,10 +1296,18 @@ static int snd_ctl_elem_read(struct snd_card *card,
 			control->id.iface, control->id.device,
 			control->id.subdevice, control->id.name,
 			control->id.index);
-		ret = -EINVAL;
-		goto unlock;
+		return -EINVAL;
 	}
-unlock:
+	return ret;
+}
+
+static int snd_ctl_elem_read(struct snd_card *card,
+			     struct snd_ctl_elem_value *control)
+{
+	int ret;
+
+	down_read(&card->controls_rwsem);
+	ret = __snd_ctl_elem_read(card, control);
 	up_read(&card->controls_rwsem);
 	return ret;
 }
@@ -1272,28 +1333,31 @@ static int snd_ctl_elem_read_user(struct snd_card *card,
 	return result;
 }
 
-static int snd_ctl_elem_write(struct snd_card *card, struct snd_ctl_file *file,
-			      struct snd_ctl_elem_value *control)
+/*
+ * call with card->controls_rwsem held for writing
+ * returns > 0 and the changed element in @kctlp and @ioffp if the value
+ * was changed
+ */
+static int __snd_ctl_elem_write(struct snd_card *card,
+				struct snd_ctl_file *file,
+				struct snd_ctl_elem_value *control,
+				struct snd_kcontrol **kctlp,
+				unsigned int *ioffp)
 {
 	struct snd_kcontrol *kctl;
 	struct snd_kcontrol_volatile *vd;
 	unsigned int index_offset;
 	int result;
 
-	down_write(&card->controls_rwsem);
 	kctl = snd_ctl_find_id(card, &control->id);
-	if (kctl == NULL) {
-		up_write(&card->controls_rwsem);
+	if (kctl == NULL)
 		return -ENOENT;
-	}
 
 	index_offset = snd_ctl_get_ioff(kctl, &control->id);
 	vd = &kctl->vd[index_offset];
 	if (!(vd->access & SNDRV_CTL_ELEM_ACCESS_WRITE) || kctl->put == NULL ||
-	    (file && vd->owner && vd->owner != file)) {
-		up_write(&card->controls_rwsem);
+	    (file && vd->owner && vd->owner != file))
 		return -EPERM;
-	}
 
 	snd_ctl_build_ioff(&control->id, kctl, index_offset);
 	result = snd_power_ref_and_wait(card);
@@ -1311,6 +1375,21 @@ static int snd_ctl_elem_write(struct snd_card *card, struct snd_ctl_file *file,
 	if (!result)
 		result = kctl->put(kctl, control);
 	snd_power_unref(card);
+
+	*kctlp = kctl;
+	*ioffp = index_offset;
+	return result;
+}
+
+static int snd_ctl_elem_write(struct snd_card *card, struct snd_ctl_file *file,
+			      struct snd_ctl_elem_value *control)
+{
+	struct snd_kcontrol *kctl;
+	unsigned int index_offset;
+	int result;
+
+	down_write(&card->controls_rwsem);
+	result = __snd_ctl_elem_write(card, file, control, &kctl, &index_offset);
 	if (result < 0) {
 		up_write(&card->controls_rwsem);
 		return result;
@@ -1350,6 +1429,94 @@ static int snd_ctl_elem_write_user(struct snd_ctl_file *file,
 	return result;
 }
 
+/*
+ * Vectored read and write: the whole array is handled under a single
+ * acquisition of controls_rwsem; value change events of a write are only
+ * sent once all elements were written.
+ */
+static int snd_ctl_elem_rw_multi(struct snd_ctl_file *file,
+				 struct snd_ctl_elem_value *values,
+				 unsigned int count, unsigned int *done,
+				 bool write)
+{
+	struct snd_card *card = file->card;
+	struct snd_kcontrol *kctl;
+	unsigned int i, index_offset;
+	unsigned long *changed;
+	int err = 0;
+
+	if (!write) {
+		down_read(&card->controls_rwsem);
+		for (i = 0; i < count; i++) {
+			err = __snd_ctl_elem_read(card, &values[i]);
+			if (err < 0)
+				break;
+		}
+		up_read(&card->controls_rwsem);
+		*done = i;
+		return err;
+	}
+
+	changed = bitmap_zalloc(count, GFP_KERNEL);
+	if (!changed)
+		return -ENOMEM;
+
+	down_write(&card->controls_rwsem);
+	for (i = 0; i < count; i++) {
+		err = __snd_ctl_elem_write(card, file, &values[i], &kctl,
+					   &index_offset);
+		if (err < 0)
+			break;
+		if (err > 0)
+			__set_bit(i, changed);
+	}
+	*done = i;
+
+	downgrade_write(&card->controls_rwsem);
+	for_each_set_bit(i, changed, count) {
+		kctl = snd_ctl_find_id(card, &values[i].id);
+		if (kctl)
+			snd_ctl_notify_one(card, SNDRV_CTL_EVENT_MASK_VALUE, kctl,
+					   snd_ctl_get_ioff(kctl, &values[i].id));
+	}
+	up_read(&card->controls_rwsem);
+
+	bitmap_free(changed);
+	return err < 0 ? err : 0;
+}
+
+static int snd_ctl_elem_multi_user(struct snd_ctl_file *file,
+				   struct snd_ctl_elem_value_multi __user *_multi,
+				   bool write)
+{
+	struct snd_ctl_elem_value_multi multi;
+	struct snd_ctl_elem_value *values;
+	void __user *uvalues;
+	unsigned int done = 0;
+	int err;
+
+	if (copy_from_user(&multi, _multi, sizeof(multi)))
+		return -EFAULT;
+	if (multi.count > SNDRV_CTL_ELEM_MULTI_MAX)
+		return -EINVAL;
+	if (!multi.count)
+		return put_user(0, &_multi->done) ? -EFAULT : 0;
+
+	uvalues = u64_to_user_ptr(multi.values);
+	values = vmemdup_user(uvalues, array_size(multi.count, sizeof(*values)));
+	if (IS_ERR(values))
+		return PTR_ERR(values);
+
+	err = snd_ctl_elem_rw_multi(file, values, multi.count, &done, write);
+
+	if (done && copy_to_user(uvalues, values, done * sizeof(*values)))
+		err = -EFAULT;
+	if (put_user(done, &_multi->done))
+		err = -EFAULT;
+	kvfree(values);
+	return err;
+}
+
 static int snd_ctl_elem_lock(struct snd_ctl_file *file,
 			     struct snd_ctl_elem_id __user *_id)
 {
@@ -1941,6 +2108,10 @@ static long snd_ctl_ioctl(struct file *file, unsigned int cmd, unsigned long arg
 		return snd_ctl_elem_read_user(card, argp);
 	case SNDRV_CTL_IOCTL_ELEM_WRITE:
 		return snd_ctl_elem_write_user(ctl, argp);
+	case SNDRV_CTL_IOCTL_ELEM_READ_MULTI:
+		return snd_ctl_elem_multi_user(ctl, argp, false);
+	case SNDRV_CTL_IOCTL_ELEM_WRITE_MULTI:
+		return snd_ctl_elem_multi_user(ctl, argp, true);
 	case SNDRV_CTL_IOCTL_ELEM_LOCK:
 		return snd_ctl_elem_lock(ctl, argp);
 	case SNDRV_CTL_IOCTL_ELEM_UNLOCK:
@@ -2026,6 +2197,7 @@ static ssize_t snd_ctl_read(struct file *file, char __user *buffer,
 		ev.type = SNDRV_CTL_EVENT_ELEM;
 		ev.data.elem.mask = kev->mask;
 		ev.data.elem.id = kev->id;
+		hash_del(&kev->hnode);
 		list_del(&kev->list);
 		spin_unlock_irq(&ctl->read_lock);
 		kfree(kev);
@@ -347,6 +347,39 @@ static int snd_ctl_elem_write_user_compat(struct snd_ctl_file *file,
 	return ctl_elem_write_user(file, data32, &data32->value);
 }
 
+/*
+ * The 32bit value layout depends on the element type, so the elements of
+ * a vectored access are converted and handled one by one.
+ */
+static int snd_ctl_elem_multi_compat(struct snd_ctl_file *file,
+				     struct snd_ctl_elem_value_multi __user *_multi,
+				     bool write)
+{
+	struct snd_ctl_elem_value_multi multi;
+	struct snd_ctl_elem_value32 __user *data32;
+	unsigned int i;
+	int err = 0;
+
+	if (copy_from_user(&multi, _multi, sizeof(multi)))
+		return -EFAULT;
+	if (multi.count > SNDRV_CTL_ELEM_MULTI_MAX)
+		return -EINVAL;
+
+	data32 = compat_ptr((compat_uptr_t)multi.values);
+	for (i = 0; i < multi.count; i++, data32++) {
+		if (write)
+			err = ctl_elem_write_user(file, data32, &data32->value);
+		else
+			err = ctl_elem_read_user(file->card, data32,
+						 &data32->value);
+		if (err < 0)
+			break;
+	}
+	if (put_user(i, &_multi->done))
+		return -EFAULT;
+	return err;
+}
+
 #ifdef CONFIG_X86_X32_ABI
 static int snd_ctl_elem_read_user_x32(struct snd_card *card,
 				      struct snd_ctl_elem_value_x32 __user *data32)
@@ -456,6 +489,10 @@ static inline long snd_ctl_ioctl_compat(struct file *file, unsigned int cmd, uns
 		return snd_ctl_elem_read_user_compat(ctl->card, argp);
 	case SNDRV_CTL_IOCTL_ELEM_WRITE32:
 		return snd_ctl_elem_write_user_compat(ctl, argp);
+	case SNDRV_CTL_IOCTL_ELEM_READ_MULTI:
+		return snd_ctl_elem_multi_compat(ctl, argp, false);
+	case SNDRV_CTL_IOCTL_ELEM_WRITE_MULTI:
+		return snd_ctl_elem_multi_compat(ctl, argp, true);
 	case SNDRV_CTL_IOCTL_ELEM_ADD32:
 		return snd_ctl_elem_add_compat(ctl, argp, 0);
 	case SNDRV_CTL_IOCTL_ELEM_REPLACE32:
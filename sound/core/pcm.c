@@ -5,6 +5,7 @@
  */
 
 #include <linux/init.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/time.h>
@@ -440,6 +441,33 @@ static void snd_pcm_substream_proc_sw_params_read(struct snd_info_entry *entry,
 	mutex_unlock(&substream->pcm->open_mutex);
 }
 
+/*
+ * The rate of the stream against the system clock since it was started, in
+ * ppm. Streams driven by the same clock show the same drift, whichever card
+ * they are on, so the difference between two of them is the drift between
+ * their clock domains.
+ */
+static s64 snd_pcm_substream_drift_ppm(struct snd_pcm_runtime *runtime,
+				       const struct snd_pcm_status64 *status)
+{
+	struct timespec64 now = {
+		.tv_sec = status->tstamp_sec,
+		.tv_nsec = status->tstamp_nsec,
+	};
+	s64 elapsed, frames, expected;
+
+	elapsed = timespec64_to_ns(&now) -
+		  timespec64_to_ns(&runtime->drift_base_tstamp);
+	/* too early for the period granularity of hw_ptr not to dominate */
+	if (elapsed < NSEC_PER_SEC || !runtime->rate)
+		return 0;
+
+	frames = runtime->hw_ptr_wrap + runtime->status->hw_ptr -
+		 runtime->drift_base_frames;
+	expected = mul_u64_u32_div(elapsed, runtime->rate, NSEC_PER_SEC);
+	return div64_s64((frames - expected) * 1000000, expected);
+}
+
 static void snd_pcm_substream_proc_status_read(struct snd_info_entry *entry,
 					       struct snd_info_buffer *buffer)
 {
@@ -469,6 +497,9 @@ static void snd_pcm_substream_proc_status_read(struct snd_info_entry *entry,
 	snd_iprintf(buffer, "delay       : %ld\n", status.delay);
 	snd_iprintf(buffer, "avail       : %ld\n", status.avail);
 	snd_iprintf(buffer, "avail_max   : %ld\n", status.avail_max);
+	if (status.state == SNDRV_PCM_STATE_RUNNING)
+		snd_iprintf(buffer, "drift_ppm   : %lld\n",
+			    snd_pcm_substream_drift_ppm(runtime, &status));
 	snd_iprintf(buffer, "-----\n");
 	snd_iprintf(buffer, "hw_ptr      : %ld\n", runtime->status->hw_ptr);
 	snd_iprintf(buffer, "appl_ptr    : %ld\n", runtime->control->appl_ptr);
@@ -476,6 +507,80 @@ static void snd_pcm_substream_proc_status_read(struct snd_info_entry *entry,
 	mutex_unlock(&substream->pcm->open_mutex);
 }
 
+#ifdef CONFIG_SND_PCM_LATENCY_STATS
+static const char * const snd_pcm_xrun_cause_names[SND_PCM_XRUN_CAUSES] = {
+	[SND_PCM_XRUN_AVAIL] = "avail",
+	[SND_PCM_XRUN_POINTER] = "pointer",
+	[SND_PCM_XRUN_ACK] = "ack",
+	[SND_PCM_XRUN_DRIVER] = "driver",
+	[SND_PCM_XRUN_USER] = "user",
+};
+
+static void snd_pcm_lat_hist_read(struct snd_info_buffer *buffer,
+				  const char *name,
+				  const struct snd_pcm_lat_hist *hist)
+{
+	int i;
+
+	snd_iprintf(buffer, "%-12s:", name);
+	for (i = 0; i < SND_PCM_LAT_BUCKETS; i++)
+		snd_iprintf(buffer, " %u", hist->count[i]);
+	snd_iprintf(buffer, "\n%-12s: %llu\n", "  max_ns", hist->max_ns);
+}
+
+static void snd_pcm_substream_proc_latency_read(struct snd_info_entry *entry,
+						struct snd_info_buffer *buffer)
+{
+	struct snd_pcm_substream *substream = entry->private_data;
+	struct snd_pcm_latency_stats lat;
+	int i;
+
+	mutex_lock(&substream->pcm->open_mutex);
+	if (!substream->runtime) {
+		snd_iprintf(buffer, "closed\n");
+		goto unlock;
+	}
+	snd_pcm_stream_lock_irq(substream);
+	lat = substream->runtime->lat;
+	snd_pcm_stream_unlock_irq(substream);
+
+	snd_iprintf(buffer, "%-12s:", "usecs <");
+	for (i = 0; i < SND_PCM_LAT_BUCKETS - 1; i++)
+		snd_iprintf(buffer, " %u", 1U << i);
+	snd_iprintf(buffer, " inf\n");
+	snd_pcm_lat_hist_read(buffer, "wakeup", &lat.wakeup);
+	snd_pcm_lat_hist_read(buffer, "jitter", &lat.jitter);
+	snd_pcm_lat_hist_read(buffer, "poll", &lat.poll);
+	snd_iprintf(buffer, "-----\n");
+	for (i = 0; i < SND_PCM_XRUN_CAUSES; i++)
+		snd_iprintf(buffer, "xrun_%-7s: %u\n",
+			    snd_pcm_xrun_cause_names[i], lat.xruns[i]);
+	snd_iprintf(buffer, "xrun_appl_age_ns: %llu\n", lat.xrun_appl_age_ns);
+ unlock:
+	mutex_unlock(&substream->pcm->open_mutex);
+}
+
+static void snd_pcm_substream_proc_latency_write(struct snd_info_entry *entry,
+						 struct snd_info_buffer *buffer)
+{
+	struct snd_pcm_substream *substream = entry->private_data;
+	struct snd_pcm_latency_stats *lat;
+
+	mutex_lock(&substream->pcm->open_mutex);
+	if (substream->runtime) {
+		lat = &substream->runtime->lat;
+		snd_pcm_stream_lock_irq(substream);
+		memset(&lat->wakeup, 0, sizeof(lat->wakeup));
+		memset(&lat->jitter, 0, sizeof(lat->jitter));
+		memset(&lat->poll, 0, sizeof(lat->poll));
+		memset(lat->xruns, 0, sizeof(lat->xruns));
+		lat->xrun_appl_age_ns = 0;
+		snd_pcm_stream_unlock_irq(substream);
+	}
+	mutex_unlock(&substream->pcm->open_mutex);
+}
+#endif /* CONFIG_SND_PCM_LATENCY_STATS */
+
 #ifdef CONFIG_SND_PCM_XRUN_DEBUG
 static void snd_pcm_xrun_injection_write(struct snd_info_entry *entry,
 					 struct snd_info_buffer *buffer)
@@ -578,6 +683,15 @@ static int snd_pcm_substream_proc_init(struct snd_pcm_substream *substream)
 	create_substream_info_entry(substream, "status",
 				    snd_pcm_substream_proc_status_read);
 
+#ifdef CONFIG_SND_PCM_LATENCY_STATS
+	entry = create_substream_info_entry(substream, "latency",
+					    snd_pcm_substream_proc_latency_read);
+	if (entry) {
+		entry->c.text.write = snd_pcm_substream_proc_latency_write;
+		entry->mode |= 0200;
+	}
+#endif /* CONFIG_SND_PCM_LATENCY_STATS */
+
 #ifdef CONFIG_SND_PCM_XRUN_DEBUG
 	entry = create_substream_info_entry(substream, "xrun_injection", NULL);
 	if (entry) {
@@ -967,6 +1081,18 @@ int snd_pcm_attach_substream(struct snd_pcm *pcm, int stream,
 	}
 	memset(runtime->control, 0, size);
 
+	size = PAGE_ALIGN(sizeof(struct snd_pcm_mmap_status_ext));
+	runtime->status_ext = alloc_pages_exact(size, GFP_KERNEL);
+	if (runtime->status_ext == NULL) {
+		free_pages_exact(runtime->control,
+			       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control)));
+		free_pages_exact(runtime->status,
+			       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_status)));
+		kfree(runtime);
+		return -ENOMEM;
+	}
+	memset(runtime->status_ext, 0, size);
+
 	init_waitqueue_head(&runtime->sleep);
 	init_waitqueue_head(&runtime->tsleep);
 
@@ -997,6 +1123,8 @@ void snd_pcm_detach_substream(struct snd_pcm_substream *substream)
 		       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_status)));
 	free_pages_exact(runtime->control,
 		       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control)));
+	free_pages_exact(runtime->status_ext,
+		       PAGE_ALIGN(sizeof(struct snd_pcm_mmap_status_ext)));
 	kfree(runtime->hw_constraints.rules);
 	/* Avoid concurrent access to runtime via PCM timer interface */
 	if (substream->timer) {
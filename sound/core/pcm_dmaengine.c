@@ -421,6 +421,9 @@ int snd_dmaengine_pcm_refine_runtime_hwparams(
 			hw->info |= SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME;
 		if (dma_caps.residue_granularity <= DMA_RESIDUE_GRANULARITY_SEGMENT)
 			hw->info |= SNDRV_PCM_INFO_BATCH;
+		if (dma_caps.residue_granularity == DMA_RESIDUE_GRANULARITY_BURST &&
+		    (dma_data->flags & SND_DMAENGINE_PCM_DAI_FLAG_NO_PERIOD_WAKEUP))
+			hw->info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
 
 		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
 			addr_widths = dma_caps.dst_addr_widths;
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ *  DSD sample conversion helpers
+ *
+ *  The DSD bit reversal and DoP (DSD over PCM) encoding done per byte by
+ *  drivers feeding DSD to the hardware. On arm64 the bulk of a buffer is
+ *  handled with NEON, inside a single kernel_neon_begin()/end() section
+ *  per call so that the FPSIMD state save is paid once per buffer.
+ */
+
+#include <linux/bitrev.h>
+#include <linux/export.h>
+#include <linux/kernel.h>
+#include <sound/core.h>
+#include <sound/pcm.h>
+
+#ifdef CONFIG_SND_PCM_DSD_NEON
+#include <asm/neon.h>
+#include <asm/simd.h>
+#endif
+
+#include "pcm_local.h"
+
+/* below this, the FPSIMD state save costs more than NEON saves */
+#define SND_PCM_DSD_NEON_MIN_BYTES	128
+
+static bool snd_pcm_dsd_use_neon(size_t bytes)
+{
+#ifdef CONFIG_SND_PCM_DSD_NEON
+	return bytes >= SND_PCM_DSD_NEON_MIN_BYTES && may_use_simd();
+#else
+	return false;
+#endif
+}
+
+/**
+ * snd_pcm_dsd_bitrev - copy DSD bytes with their bit order reversed
+ * @dst: the destination buffer
+ * @src: the source buffer
+ * @bytes: the number of bytes to copy
+ *
+ * Converts between MSB first and LSB first DSD bit streams.
+ */
+void snd_pcm_dsd_bitrev(u8 *dst, const u8 *src, size_t bytes)
+{
+	size_t done = 0;
+
+#ifdef CONFIG_SND_PCM_DSD_NEON
+	if (snd_pcm_dsd_use_neon(bytes)) {
+		kernel_neon_begin();
+		done = snd_pcm_dsd_bitrev_neon(dst, src, bytes);
+		kernel_neon_end();
+	}
+#endif
+
+	for (; done < bytes; done++)
+		dst[done] = bitrev8(src[done]);
+}
+EXPORT_SYMBOL(snd_pcm_dsd_bitrev);
+
+/**
+ * snd_pcm_dsd_dop_encode - pack DSD_U16_LE frames into DoP frames
+ * @dst: the destination buffer, 3 bytes per sample
+ * @src: the source buffer, 2 bytes per sample
+ * @frames: the number of frames to pack
+ * @channels: the number of channels per frame
+ * @marker: the DoP marker of the first frame, 0x05 or 0xfa
+ * @bitrev: reverse the bit order of the DSD bytes too
+ *
+ * Each sample is stored LSB first as the two DSD bytes followed by the
+ * marker byte, which alternates between 0x05 and 0xfa from frame to
+ * frame.
+ *
+ * Return: the marker of the frame following the last one packed.
+ */
+u8 snd_pcm_dsd_dop_encode(u8 *dst, const u8 *src, unsigned int frames,
+			  unsigned int channels, u8 marker, bool bitrev)
+{
+	unsigned int done = 0, ch;
+
+#ifdef CONFIG_SND_PCM_DSD_NEON
+	if (snd_pcm_dsd_use_neon(frames * channels * 2)) {
+		kernel_neon_begin();
+		done = snd_pcm_dsd_dop_encode_neon(dst, src, frames, channels,
+						   marker, bitrev);
+		kernel_neon_end();
+
+		src += done * channels * 2;
+		dst += done * channels * 3;
+		if (done & 1)
+			marker ^= 0xff;
+	}
+#endif
+
+	for (; done < frames; done++) {
+		for (ch = 0; ch < channels; ch++) {
+			dst[0] = bitrev ? bitrev8(src[0]) : src[0];
+			dst[1] = bitrev ? bitrev8(src[1]) : src[1];
+			dst[2] = marker;
+			dst += 3;
+			src += 2;
+		}
+		/* 0x05 <-> 0xfa */
+		marker ^= 0xff;
+	}
+
+	return marker;
+}
+EXPORT_SYMBOL(snd_pcm_dsd_dop_encode);
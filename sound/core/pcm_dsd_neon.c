@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ *  NEON kernels for the DSD sample conversion helpers
+ *
+ *  Called between kernel_neon_begin() and kernel_neon_end() by
+ *  pcm_dsd.c, and only handle whole vectors; the callers finish the
+ *  tail of a buffer.
+ */
+
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <asm/neon-intrinsics.h>
+
+#include "pcm_local.h"
+
+size_t snd_pcm_dsd_bitrev_neon(u8 *dst, const u8 *src, size_t bytes)
+{
+	size_t done;
+
+	for (done = 0; done + 16 <= bytes; done += 16)
+		vst1q_u8(dst + done, vrbitq_u8(vld1q_u8(src + done)));
+
+	return done;
+}
+
+unsigned int snd_pcm_dsd_dop_encode_neon(u8 *dst, const u8 *src,
+					 unsigned int frames,
+					 unsigned int channels, u8 marker,
+					 bool bitrev)
+{
+	unsigned int block_frames, done, i;
+	u8 markers[16];
+	uint8x16x2_t in;
+	uint8x16x3_t out;
+
+	/*
+	 * A vector holds 16 samples. With 1, 2, 4 or 8 channels that is
+	 * an even number of frames, so every vector starts on the same
+	 * marker and one marker pattern serves the whole buffer.
+	 */
+	if (channels > 8 || !is_power_of_2(channels))
+		return 0;
+
+	block_frames = 16 / channels;
+	for (i = 0; i < 16; i++)
+		markers[i] = (i / channels) & 1 ? marker ^ 0xff : marker;
+	out.val[2] = vld1q_u8(markers);
+
+	for (done = 0; done + block_frames <= frames; done += block_frames) {
+		/* split the two DSD bytes of 16 samples */
+		in = vld2q_u8(src);
+		if (bitrev) {
+			in.val[0] = vrbitq_u8(in.val[0]);
+			in.val[1] = vrbitq_u8(in.val[1]);
+		}
+		out.val[0] = in.val[0];
+		out.val[1] = in.val[1];
+		vst3q_u8(dst, out);
+
+		src += 32;
+		dst += 48;
+	}
+
+	return done;
+}
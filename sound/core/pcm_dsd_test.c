@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ *  KUnit tests for the DSD sample conversion helpers
+ */
+
+#include <kunit/test.h>
+#include <linux/bitrev.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <sound/pcm.h>
+
+/* odd, so that every vectorised path also leaves a tail */
+#define DSD_TEST_FRAMES		1031
+#define DSD_TEST_MAX_CHANNELS	8
+#define DSD_BENCH_BYTES		(64 * 1024)
+#define DSD_BENCH_LOOPS		64
+
+static void dsd_ref_dop(u8 *dst, const u8 *src, unsigned int frames,
+			unsigned int channels, u8 marker, bool bitrev)
+{
+	unsigned int i, ch;
+
+	for (i = 0; i < frames; i++, marker ^= 0xff) {
+		for (ch = 0; ch < channels; ch++, src += 2, dst += 3) {
+			dst[0] = bitrev ? bitrev8(src[0]) : src[0];
+			dst[1] = bitrev ? bitrev8(src[1]) : src[1];
+			dst[2] = marker;
+		}
+	}
+}
+
+static void dsd_test_bitrev(struct kunit *test)
+{
+	size_t len = DSD_TEST_FRAMES * 2, i, n;
+	u8 *src, *dst;
+
+	src = kunit_kzalloc(test, len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, src);
+	dst = kunit_kzalloc(test, len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dst);
+
+	get_random_bytes(src, len);
+
+	/* lengths around the vector size and the NEON threshold */
+	for (n = 0; n <= len; n = n < 300 ? n + 1 : n * 2) {
+		memset(dst, 0, len);
+		snd_pcm_dsd_bitrev(dst, src, n);
+		for (i = 0; i < n; i++)
+			KUNIT_ASSERT_EQ_MSG(test, dst[i], bitrev8(src[i]),
+					    "len %zu byte %zu", n, i);
+		for (; i < len; i++)
+			KUNIT_ASSERT_EQ(test, dst[i], 0);
+	}
+}
+
+static void dsd_check_dop(struct kunit *test, u8 *dst, u8 *ref,
+			  const u8 *src, unsigned int frames,
+			  unsigned int channels, u8 marker, bool bitrev)
+{
+	size_t len = frames * channels * 3;
+	u8 next;
+
+	memset(dst, 0, len + 1);
+	dsd_ref_dop(ref, src, frames, channels, marker, bitrev);
+	next = snd_pcm_dsd_dop_encode(dst, src, frames, channels, marker,
+				      bitrev);
+
+	KUNIT_ASSERT_EQ_MSG(test, next, frames & 1 ? marker ^ 0xff : marker,
+			    "channels %u frames %u", channels, frames);
+	KUNIT_ASSERT_TRUE_MSG(test, !memcmp(dst, ref, len),
+			      "channels %u frames %u marker %#x bitrev %d",
+			      channels, frames, marker, bitrev);
+	KUNIT_ASSERT_EQ(test, dst[len], 0);
+}
+
+static void dsd_test_dop(struct kunit *test)
+{
+	size_t src_len = DSD_TEST_FRAMES * DSD_TEST_MAX_CHANNELS * 2;
+	size_t dst_len = DSD_TEST_FRAMES * DSD_TEST_MAX_CHANNELS * 3 + 1;
+	unsigned int channels, frames;
+	u8 *src, *dst, *ref;
+
+	src = kunit_kzalloc(test, src_len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, src);
+	dst = kunit_kzalloc(test, dst_len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dst);
+	ref = kunit_kzalloc(test, dst_len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ref);
+
+	get_random_bytes(src, src_len);
+
+	for (channels = 1; channels <= DSD_TEST_MAX_CHANNELS; channels++) {
+		for (frames = 1; frames <= DSD_TEST_FRAMES;
+		     frames = frames * 3 + 1) {
+			dsd_check_dop(test, dst, ref, src, frames, channels,
+				      0x05, false);
+			dsd_check_dop(test, dst, ref, src, frames, channels,
+				      0xfa, false);
+			dsd_check_dop(test, dst, ref, src, frames, channels,
+				      0xfa, true);
+		}
+	}
+}
+
+/* not a pass/fail test, logs the throughput for comparing kernels */
+static void dsd_test_bench(struct kunit *test)
+{
+	unsigned int frames = DSD_BENCH_BYTES / (2 * 2);
+	u8 *src, *dst;
+	ktime_t start;
+	s64 ns;
+	int i;
+
+	src = kunit_kzalloc(test, DSD_BENCH_BYTES, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, src);
+	dst = kunit_kzalloc(test, frames * 2 * 3, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dst);
+
+	get_random_bytes(src, DSD_BENCH_BYTES);
+
+	start = ktime_get();
+	for (i = 0; i < DSD_BENCH_LOOPS; i++)
+		snd_pcm_dsd_bitrev(dst, src, DSD_BENCH_BYTES);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	kunit_info(test, "bitrev: %lld ns per %u bytes\n",
+		   div_s64(ns, DSD_BENCH_LOOPS), DSD_BENCH_BYTES);
+
+	start = ktime_get();
+	for (i = 0; i < DSD_BENCH_LOOPS; i++)
+		snd_pcm_dsd_dop_encode(dst, src, frames, 2, 0x05, true);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	kunit_info(test, "stereo DoP: %lld ns per %u frames\n",
+		   div_s64(ns, DSD_BENCH_LOOPS), frames);
+}
+
+static struct kunit_case pcm_dsd_test_cases[] = {
+	KUNIT_CASE(dsd_test_bitrev),
+	KUNIT_CASE(dsd_test_dop),
+	KUNIT_CASE(dsd_test_bench),
+	{}
+};
+
+static struct kunit_suite pcm_dsd_test_suite = {
+	.name = "snd-pcm-dsd",
+	.test_cases = pcm_dsd_test_cases,
+};
+
+kunit_test_suites(&pcm_dsd_test_suite);
+
+MODULE_DESCRIPTION("ALSA PCM DSD conversion helpers kunit test");
+MODULE_LICENSE("GPL");
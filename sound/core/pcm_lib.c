@@ -10,6 +10,7 @@
 #include <linux/time.h>
 #include <linux/math64.h>
 #include <linux/export.h>
+#include <linux/pstore.h>
 #include <sound/core.h>
 #include <sound/control.h>
 #include <sound/tlv.h>
@@ -139,12 +140,92 @@ EXPORT_SYMBOL(snd_pcm_debug_name);
 			dump_stack();				\
 	} while (0)
 
+#ifdef CONFIG_SND_PCM_LATENCY_STATS
+static void lat_hist_add(struct snd_pcm_lat_hist *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int bucket = us ? fls64(us) : 0;
+
+	hist->count[min(bucket, SND_PCM_LAT_BUCKETS - 1)]++;
+	if (ns > hist->max_ns)
+		hist->max_ns = ns;
+}
+
+/* period interrupt, called within the stream lock */
+static void snd_pcm_lat_period(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_latency_stats *lat = &runtime->lat;
+	u64 now = ktime_get_ns();
+	u64 period_ns, interval;
+
+	if (lat->irq_ns) {
+		period_ns = div_u64((u64)runtime->period_size * NSEC_PER_SEC,
+				    runtime->rate);
+		interval = now - lat->irq_ns;
+		lat_hist_add(&lat->jitter, interval > period_ns ?
+			     interval - period_ns : period_ns - interval);
+	}
+	lat->irq_ns = now;
+	lat->wakeup_pending = true;
+}
+
+/* application moved appl_ptr, called within the stream lock */
+static void snd_pcm_lat_appl(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_latency_stats *lat = &substream->runtime->lat;
+	u64 now = ktime_get_ns();
+
+	if (lat->wakeup_pending) {
+		lat_hist_add(&lat->wakeup, now - lat->irq_ns);
+		lat->wakeup_pending = false;
+	}
+	lat->appl_ns = now;
+}
+
+/* poll() evaluated the stream, called within the stream lock */
+void snd_pcm_lat_poll(struct snd_pcm_substream *substream, bool ready)
+{
+	struct snd_pcm_latency_stats *lat = &substream->runtime->lat;
+
+	if (!ready) {
+		if (!lat->poll_ns)
+			lat->poll_ns = ktime_get_ns();
+	} else if (lat->poll_ns) {
+		lat_hist_add(&lat->poll, ktime_get_ns() - lat->poll_ns);
+		lat->poll_ns = 0;
+	}
+}
+
+static void snd_pcm_lat_xrun(struct snd_pcm_substream *substream,
+			     unsigned int cause)
+{
+	struct snd_pcm_latency_stats *lat = &substream->runtime->lat;
+
+	lat->xruns[cause]++;
+	lat->xrun_appl_age_ns = lat->appl_ns ? ktime_get_ns() - lat->appl_ns : 0;
+}
+#else
+static inline void snd_pcm_lat_period(struct snd_pcm_substream *substream) {}
+static inline void snd_pcm_lat_appl(struct snd_pcm_substream *substream) {}
+static inline void snd_pcm_lat_xrun(struct snd_pcm_substream *substream,
+				    unsigned int cause) {}
+#endif
+
 /* call with stream lock held */
-void __snd_pcm_xrun(struct snd_pcm_substream *substream)
+void __snd_pcm_xrun(struct snd_pcm_substream *substream, unsigned int cause)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 
 	trace_xrun(substream);
+	snd_pcm_lat_xrun(substream, cause);
+	pstore_rtevent(PSTORE_RTEVENT_PCM_XRUN,
+		       substream->pcm->card->number << 24 |
+		       substream->pcm->device << 16 |
+		       substream->number << 8 | substream->stream,
+		       cause);
+	runtime->xrun_count++;
+	WRITE_ONCE(runtime->status_ext->xruns, runtime->xrun_count);
 	if (runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE) {
 		struct timespec64 tstamp;
 
@@ -193,7 +274,7 @@ int snd_pcm_update_state(struct snd_pcm_substream *substream,
 		}
 	} else {
 		if (avail >= runtime->stop_threshold) {
-			__snd_pcm_xrun(substream);
+			__snd_pcm_xrun(substream, SND_PCM_XRUN_AVAIL);
 			return -EPIPE;
 		}
 	}
@@ -255,6 +336,49 @@ static void update_audio_tstamp(struct snd_pcm_substream *substream,
 	runtime->driver_tstamp = driver_tstamp;
 }
 
+/*
+ * Refresh the extended status page; called within the stream lock.
+ * The tstamp and audio_tstamp are valid only in SNDRV_PCM_TSTAMP_ENABLE
+ * mode, otherwise they are taken here.
+ */
+static void update_status_ext(struct snd_pcm_substream *substream,
+			      snd_pcm_uframes_t pos,
+			      const struct timespec64 *curr_tstamp)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_mmap_status_ext *ext = runtime->status_ext;
+	struct timespec64 tstamp, audio_tstamp;
+	u64 frames = runtime->hw_ptr_wrap + runtime->status->hw_ptr;
+
+	if (!runtime->status_ext_mapped)
+		return;
+	if (runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE) {
+		tstamp = *curr_tstamp;
+		audio_tstamp.tv_sec = runtime->status->audio_tstamp.tv_sec;
+		audio_tstamp.tv_nsec = runtime->status->audio_tstamp.tv_nsec;
+	} else {
+		snd_pcm_gettime(runtime, &tstamp);
+		audio_tstamp = ns_to_timespec64(mul_u64_u32_div(frames,
+							NSEC_PER_SEC,
+							runtime->rate));
+	}
+
+	WRITE_ONCE(ext->seq, ext->seq + 1);
+	smp_wmb();
+	ext->state = runtime->state;
+	ext->hw_ptr = frames;
+	ext->dma_pos = pos;
+	ext->xruns = runtime->xrun_count;
+	ext->period_irqs = runtime->period_irq_count;
+	ext->delay = runtime->delay;
+	ext->tstamp_sec = tstamp.tv_sec;
+	ext->tstamp_nsec = tstamp.tv_nsec;
+	ext->audio_tstamp_sec = audio_tstamp.tv_sec;
+	ext->audio_tstamp_nsec = audio_tstamp.tv_nsec;
+	smp_wmb();
+	WRITE_ONCE(ext->seq, ext->seq + 1);
+}
+
 static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 				  unsigned int in_interrupt)
 {
@@ -294,7 +418,7 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	}
 
 	if (pos == SNDRV_PCM_POS_XRUN) {
-		__snd_pcm_xrun(substream);
+		__snd_pcm_xrun(substream, SND_PCM_XRUN_POINTER);
 		return -EPIPE;
 	}
 	if (pos >= runtime->buffer_size) {
@@ -433,9 +557,15 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	}
 
  no_delta_check:
+	if (in_interrupt) {
+		runtime->period_irq_count++;
+		snd_pcm_lat_period(substream);
+	}
+
 	if (runtime->status->hw_ptr == new_hw_ptr) {
 		runtime->hw_ptr_jiffies = curr_jiffies;
 		update_audio_tstamp(substream, &curr_tstamp, &audio_tstamp);
+		update_status_ext(substream, pos, &curr_tstamp);
 		return 0;
 	}
 
@@ -461,6 +591,7 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	}
 
 	update_audio_tstamp(substream, &curr_tstamp, &audio_tstamp);
+	update_status_ext(substream, pos, &curr_tstamp);
 
 	return snd_pcm_update_state(substream, runtime);
 }
@@ -2156,11 +2287,12 @@ int pcm_lib_apply_appl_ptr(struct snd_pcm_substream *substream,
 		if (ret < 0) {
 			runtime->control->appl_ptr = old_appl_ptr;
 			if (ret == -EPIPE)
-				__snd_pcm_xrun(substream);
+				__snd_pcm_xrun(substream, SND_PCM_XRUN_ACK);
 			return ret;
 		}
 	}
 
+	snd_pcm_lat_appl(substream);
 	trace_applptr(substream, old_appl_ptr, appl_ptr);
 
 	return 0;
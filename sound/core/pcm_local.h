@@ -32,6 +32,14 @@ int snd_pcm_update_hw_ptr(struct snd_pcm_substream *substream);
 void snd_pcm_playback_silence(struct snd_pcm_substream *substream,
 			      snd_pcm_uframes_t new_hw_ptr);
 
+#ifdef CONFIG_SND_PCM_DSD_NEON
+size_t snd_pcm_dsd_bitrev_neon(u8 *dst, const u8 *src, size_t bytes);
+unsigned int snd_pcm_dsd_dop_encode_neon(u8 *dst, const u8 *src,
+					 unsigned int frames,
+					 unsigned int channels, u8 marker,
+					 bool bitrev);
+#endif
+
 static inline snd_pcm_uframes_t
 snd_pcm_avail(struct snd_pcm_substream *substream)
 {
@@ -61,10 +69,24 @@ static inline void snd_pcm_timer_init(struct snd_pcm_substream *substream) {}
 static inline void snd_pcm_timer_done(struct snd_pcm_substream *substream) {}
 #endif
 
-void __snd_pcm_xrun(struct snd_pcm_substream *substream);
+void __snd_pcm_xrun(struct snd_pcm_substream *substream, unsigned int cause);
 void snd_pcm_group_init(struct snd_pcm_group *group);
 void snd_pcm_sync_stop(struct snd_pcm_substream *substream, bool sync_irq);
 
+#ifdef CONFIG_SND_PCM_LATENCY_STATS
+void snd_pcm_lat_poll(struct snd_pcm_substream *substream, bool ready);
+
+static inline void snd_pcm_lat_start(struct snd_pcm_substream *substream)
+{
+	substream->runtime->lat.irq_ns = 0;
+	substream->runtime->lat.wakeup_pending = false;
+}
+#else
+static inline void
+snd_pcm_lat_poll(struct snd_pcm_substream *substream, bool ready) {}
+static inline void snd_pcm_lat_start(struct snd_pcm_substream *substream) {}
+#endif
+
 #define PCM_RUNTIME_CHECK(sub) snd_BUG_ON(!(sub) || !(sub)->runtime)
 
 /* loop over all PCM substreams */
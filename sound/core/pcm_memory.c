@@ -25,6 +25,10 @@ static int maximum_substreams = 4;
 module_param(maximum_substreams, int, 0444);
 MODULE_PARM_DESC(maximum_substreams, "Maximum substreams with preallocated DMA memory.");
 
+static bool keep_buffers;
+module_param(keep_buffers, bool, 0644);
+MODULE_PARM_DESC(keep_buffers, "Keep the DMA buffers allocated at hw_params for reuse.");
+
 static const size_t snd_minimum_buffer = 16384;
 
 static unsigned long max_alloc_per_card = 32UL * 1024UL * 1024UL;
@@ -177,6 +181,18 @@ static void snd_pcm_lib_preallocate_max_proc_read(struct snd_info_entry *entry,
 	snd_iprintf(buffer, "%lu\n", (unsigned long) substream->dma_max / 1024);
 }
 
+/*
+ * read callback for prealloc_misses proc file
+ *
+ * prints how many times hw_params had to allocate a buffer.
+ */
+static void snd_pcm_lib_preallocate_misses_proc_read(struct snd_info_entry *entry,
+						     struct snd_info_buffer *buffer)
+{
+	struct snd_pcm_substream *substream = entry->private_data;
+	snd_iprintf(buffer, "%lu\n", substream->dma_alloc_misses);
+}
+
 /*
  * write callback for prealloc proc file
  *
@@ -227,6 +243,7 @@ static void snd_pcm_lib_preallocate_proc_write(struct snd_info_entry *entry,
 		if (substream->dma_buffer.area)
 			do_free_pages(card, &substream->dma_buffer);
 		substream->dma_buffer = new_dmab;
+		substream->dma_buffer_kept = 0;
 	} else {
 		buffer->error = -EINVAL;
 	}
@@ -251,6 +268,11 @@ static inline void preallocate_info_init(struct snd_pcm_substream *substream)
 	if (entry)
 		snd_info_set_text_ops(entry, substream,
 				      snd_pcm_lib_preallocate_max_proc_read);
+	entry = snd_info_create_card_entry(substream->pcm->card, "prealloc_misses",
+					   substream->proc_root);
+	if (entry)
+		snd_info_set_text_ops(entry, substream,
+				      snd_pcm_lib_preallocate_misses_proc_read);
 }
 
 #else /* !CONFIG_SND_VERBOSE_PROCFS */
@@ -449,9 +471,15 @@ int snd_pcm_lib_malloc_pages(struct snd_pcm_substream *substream, size_t size)
 	    substream->dma_buffer.bytes >= size) {
 		dmab = &substream->dma_buffer; /* use the pre-allocated buffer */
 	} else {
+		/* a kept buffer is too small, replace it */
+		if (substream->dma_buffer_kept) {
+			do_free_pages(card, &substream->dma_buffer);
+			substream->dma_buffer_kept = 0;
+		}
 		/* dma_max=0 means the fixed size preallocation */
 		if (substream->dma_buffer.area && !substream->dma_max)
 			return -ENOMEM;
+		substream->dma_alloc_misses++;
 		dmab = kzalloc(sizeof(*dmab), GFP_KERNEL);
 		if (! dmab)
 			return -ENOMEM;
@@ -495,8 +523,14 @@ int snd_pcm_lib_free_pages(struct snd_pcm_substream *substream)
 	if (runtime->dma_buffer_p != &substream->dma_buffer) {
 		struct snd_card *card = substream->pcm->card;
 
-		/* it's a newly allocated buffer.  release it now. */
-		do_free_pages(card, runtime->dma_buffer_p);
+		if (keep_buffers && !substream->dma_buffer.area) {
+			/* keep it as the pre-allocated buffer for next time */
+			substream->dma_buffer = *runtime->dma_buffer_p;
+			substream->dma_buffer_kept = 1;
+		} else {
+			/* it's a newly allocated buffer.  release it now. */
+			do_free_pages(card, runtime->dma_buffer_p);
+		}
 		kfree(runtime->dma_buffer_p);
 	}
 	snd_pcm_set_runtime_buffer(substream, NULL);
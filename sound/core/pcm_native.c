@@ -1438,14 +1438,24 @@ static void snd_pcm_undo_start(struct snd_pcm_substream *substream,
 	}
 }
 
+/* The frame count and time the drift against the system clock is taken from */
+static void snd_pcm_drift_start(struct snd_pcm_runtime *runtime)
+{
+	runtime->drift_base_frames = runtime->hw_ptr_wrap +
+				     runtime->status->hw_ptr;
+	runtime->drift_base_tstamp = runtime->trigger_tstamp;
+}
+
 static void snd_pcm_post_start(struct snd_pcm_substream *substream,
 			       snd_pcm_state_t state)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	snd_pcm_trigger_tstamp(substream);
+	snd_pcm_drift_start(runtime);
 	runtime->hw_ptr_jiffies = jiffies;
 	runtime->hw_ptr_buffer_jiffies = (runtime->buffer_size * HZ) / 
 							    runtime->rate;
+	snd_pcm_lat_start(substream);
 	__snd_pcm_set_state(runtime, state);
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
 	    runtime->silence_size > 0)
@@ -1568,7 +1578,7 @@ int snd_pcm_stop_xrun(struct snd_pcm_substream *substream)
 
 	snd_pcm_stream_lock_irqsave(substream, flags);
 	if (substream->runtime && snd_pcm_running(substream))
-		__snd_pcm_xrun(substream);
+		__snd_pcm_xrun(substream, SND_PCM_XRUN_DRIVER);
 	snd_pcm_stream_unlock_irqrestore(substream, flags);
 	return 0;
 }
@@ -1635,6 +1645,7 @@ static void snd_pcm_post_pause(struct snd_pcm_substream *substream,
 		wake_up(&runtime->sleep);
 		wake_up(&runtime->tsleep);
 	} else {
+		snd_pcm_drift_start(runtime);
 		__snd_pcm_set_state(runtime, SNDRV_PCM_STATE_RUNNING);
 		snd_pcm_timer_notify(substream, SNDRV_TIMER_EVENT_MCONTINUE);
 	}
@@ -1856,7 +1867,7 @@ static int snd_pcm_xrun(struct snd_pcm_substream *substream)
 		result = 0;	/* already there */
 		break;
 	case SNDRV_PCM_STATE_RUNNING:
-		__snd_pcm_xrun(substream);
+		__snd_pcm_xrun(substream, SND_PCM_XRUN_USER);
 		result = 0;
 		break;
 	default:
@@ -3506,6 +3517,93 @@ static ssize_t snd_pcm_write(struct file *file, const char __user *buf,
 	return result;
 }
 
+/* the bounce buffer size for the interleaved transfers of kernel iterators */
+#define SND_PCM_ITER_CHUNK	(16 * 1024)
+
+/*
+ * Interleaved read or write through an iov_iter.  A single user buffer is
+ * transferred directly, like read() and write() do.  Anything else, such
+ * as the bvec of an io_uring registered buffer, goes through a bounce
+ * buffer, so frames may cross the segments of the iterator.
+ */
+static ssize_t snd_pcm_iter_xfer(struct snd_pcm_substream *substream,
+				 struct iov_iter *iter)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	bool is_playback = substream->stream == SNDRV_PCM_STREAM_PLAYBACK;
+	size_t frame_bytes = frames_to_bytes(runtime, 1);
+	size_t count = iov_iter_count(iter);
+	snd_pcm_sframes_t result = 0;
+	void __user *ubuf = NULL;
+	ssize_t done = 0;
+	size_t chunk;
+	void *buf;
+
+	if (!frame_aligned(runtime, count))
+		return -EINVAL;
+
+	if (iter_is_ubuf(iter))
+		ubuf = iter->ubuf + iter->iov_offset;
+	else if (iter_is_iovec(iter) && iter->nr_segs == 1)
+		ubuf = iter->iov->iov_base + iter->iov_offset;
+
+	if (ubuf) {
+		snd_pcm_uframes_t frames = bytes_to_frames(runtime, count);
+
+		if (is_playback)
+			result = snd_pcm_lib_write(substream, ubuf, frames);
+		else
+			result = snd_pcm_lib_read(substream, ubuf, frames);
+		if (result <= 0)
+			return result;
+		iov_iter_advance(iter, frames_to_bytes(runtime, result));
+		return frames_to_bytes(runtime, result);
+	}
+
+	/* the driver must be able to copy from a kernel buffer */
+	if (substream->ops->copy_user && !substream->ops->copy_kernel)
+		return -EINVAL;
+
+	chunk = max(rounddown(min_t(size_t, count, SND_PCM_ITER_CHUNK),
+			      frame_bytes), frame_bytes);
+	buf = kmalloc(chunk, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	while (count) {
+		size_t bytes = min(count, chunk);
+		snd_pcm_uframes_t frames = bytes_to_frames(runtime, bytes);
+		size_t xfered;
+
+		if (is_playback) {
+			if (!copy_from_iter_full(buf, bytes, iter)) {
+				result = -EFAULT;
+				break;
+			}
+			result = snd_pcm_kernel_write(substream, buf, frames);
+		} else {
+			result = snd_pcm_kernel_read(substream, buf, frames);
+		}
+
+		xfered = result > 0 ? frames_to_bytes(runtime, result) : 0;
+		if (is_playback)
+			/* give back what the stream did not take */
+			iov_iter_revert(iter, bytes - xfered);
+		else if (copy_to_iter(buf, xfered, iter) != xfered)
+			result = -EFAULT;
+		if (result <= 0)
+			break;
+
+		done += xfered;
+		count -= xfered;
+		if (result < frames)
+			break;
+	}
+
+	kfree(buf);
+	return done ? done : result;
+}
+
 static ssize_t snd_pcm_readv(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct snd_pcm_file *pcm_file;
@@ -3524,6 +3622,8 @@ static ssize_t snd_pcm_readv(struct kiocb *iocb, struct iov_iter *to)
 	if (runtime->state == SNDRV_PCM_STATE_OPEN ||
 	    runtime->state == SNDRV_PCM_STATE_DISCONNECTED)
 		return -EBADFD;
+	if (runtime->access == SNDRV_PCM_ACCESS_RW_INTERLEAVED)
+		return snd_pcm_iter_xfer(substream, to);
 	if (!iter_is_iovec(to))
 		return -EINVAL;
 	if (to->nr_segs > 1024 || to->nr_segs != runtime->channels)
@@ -3561,6 +3661,8 @@ static ssize_t snd_pcm_writev(struct kiocb *iocb, struct iov_iter *from)
 	if (runtime->state == SNDRV_PCM_STATE_OPEN ||
 	    runtime->state == SNDRV_PCM_STATE_DISCONNECTED)
 		return -EBADFD;
+	if (runtime->access == SNDRV_PCM_ACCESS_RW_INTERLEAVED)
+		return snd_pcm_iter_xfer(substream, from);
 	if (!iter_is_iovec(from))
 		return -EINVAL;
 	if (from->nr_segs > 128 || from->nr_segs != runtime->channels ||
@@ -3624,6 +3726,7 @@ static __poll_t snd_pcm_poll(struct file *file, poll_table *wait)
 		mask = ok | EPOLLERR;
 		break;
 	}
+	snd_pcm_lat_poll(substream, !!mask);
 	snd_pcm_stream_unlock_irq(substream);
 	return mask;
 }
@@ -3763,6 +3866,62 @@ static int snd_pcm_mmap_control(struct snd_pcm_substream *substream, struct file
 }
 #endif /* coherent mmap */
 
+/*
+ * The extended status record is read-only for user-space and only
+ * written by the kernel, so it's also fine on the non-aliasing caches of
+ * ARMv7 and ARM64.
+ */
+#if defined(CONFIG_X86) || defined(CONFIG_PPC) || defined(CONFIG_ALPHA) || \
+	defined(CONFIG_ARM64) || (defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 7)
+static vm_fault_t snd_pcm_mmap_status_ext_fault(struct vm_fault *vmf)
+{
+	struct snd_pcm_substream *substream = vmf->vma->vm_private_data;
+	struct snd_pcm_runtime *runtime;
+
+	if (substream == NULL)
+		return VM_FAULT_SIGBUS;
+	runtime = substream->runtime;
+	vmf->page = virt_to_page(runtime->status_ext);
+	get_page(vmf->page);
+	return 0;
+}
+
+static const struct vm_operations_struct snd_pcm_vm_ops_status_ext =
+{
+	.fault =	snd_pcm_mmap_status_ext_fault,
+};
+
+static int snd_pcm_mmap_status_ext(struct snd_pcm_substream *substream,
+				   struct file *file,
+				   struct vm_area_struct *area)
+{
+	long size;
+
+	if (!(area->vm_flags & VM_READ))
+		return -EINVAL;
+	if (substream->runtime->hw.info & SNDRV_PCM_INFO_EXPLICIT_SYNC)
+		return -ENXIO;
+	size = area->vm_end - area->vm_start;
+	if (size != PAGE_ALIGN(sizeof(struct snd_pcm_mmap_status_ext)))
+		return -EINVAL;
+	area->vm_ops = &snd_pcm_vm_ops_status_ext;
+	area->vm_private_data = substream;
+	area->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	area->vm_flags &= ~(VM_WRITE | VM_MAYWRITE);
+	snd_pcm_stream_lock_irq(substream);
+	substream->runtime->status_ext_mapped = true;
+	snd_pcm_stream_unlock_irq(substream);
+	return 0;
+}
+#else
+static int snd_pcm_mmap_status_ext(struct snd_pcm_substream *substream,
+				   struct file *file,
+				   struct vm_area_struct *area)
+{
+	return -ENXIO;
+}
+#endif
+
 /*
  * fault callback for mmapping a RAM page
  */
@@ -3936,6 +4095,8 @@ static int snd_pcm_mmap(struct file *file, struct vm_area_struct *area)
 		if (!pcm_control_mmap_allowed(pcm_file))
 			return -ENXIO;
 		return snd_pcm_mmap_control(substream, file, area);
+	case SNDRV_PCM_MMAP_OFFSET_STATUS_EXT:
+		return snd_pcm_mmap_status_ext(substream, file, area);
 	default:
 		return snd_pcm_mmap_data(substream, file, area);
 	}
@@ -4098,6 +4259,9 @@ static unsigned long snd_pcm_get_unmapped_area(struct file *file,
 		return (unsigned long)runtime->status;
 	case SNDRV_PCM_MMAP_OFFSET_CONTROL_NEW:
 		return (unsigned long)runtime->control;
+	case SNDRV_PCM_MMAP_OFFSET_STATUS_EXT:
+		runtime->status_ext_mapped = true;
+		return (unsigned long)runtime->status_ext;
 	default:
 		return (unsigned long)runtime->dma_area + offset;
 	}
@@ -15,7 +15,10 @@
 #include <linux/module.h>
 #include <linux/delay.h>
 #include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include <linux/nospec.h>
+#include <linux/uio.h>
 #include <sound/rawmidi.h>
 #include <sound/info.h>
 #include <sound/control.h>
@@ -100,13 +103,27 @@ static inline bool __snd_rawmidi_ready(struct snd_rawmidi_runtime *runtime)
 	return runtime->avail >= runtime->avail_min;
 }
 
+static void snd_rawmidi_mmap_sync_appl(struct snd_rawmidi_runtime *runtime);
+
+/* free space of the scheduled output queue in bytes */
+static inline size_t snd_rawmidi_sched_room(struct snd_rawmidi_runtime *runtime)
+{
+	return (runtime->sched_size - runtime->sched_count) *
+		sizeof(struct snd_rawmidi_framing_tstamp);
+}
+
 static bool snd_rawmidi_ready(struct snd_rawmidi_substream *substream)
 {
 	unsigned long flags;
 	bool ready;
 
 	spin_lock_irqsave(&substream->lock, flags);
-	ready = __snd_rawmidi_ready(substream->runtime);
+	snd_rawmidi_mmap_sync_appl(substream->runtime);
+	if (substream->runtime->sched_queue)
+		ready = snd_rawmidi_sched_room(substream->runtime) >=
+			substream->runtime->avail_min;
+	else
+		ready = __snd_rawmidi_ready(substream->runtime);
 	spin_unlock_irqrestore(&substream->lock, flags);
 	return ready;
 }
@@ -140,6 +157,132 @@ static inline void snd_rawmidi_buffer_unref(struct snd_rawmidi_runtime *runtime)
 	runtime->buffer_ref--;
 }
 
+/*
+ * mmap mode helpers: call with substream->lock held
+ *
+ * In mmap mode user-space advances appl_ptr in the shared status page
+ * without entering the kernel.  Pick up the new position and account
+ * it as if the bytes had been passed via read() or write().
+ */
+static void snd_rawmidi_mmap_sync_appl(struct snd_rawmidi_runtime *runtime)
+{
+	u32 appl, delta;
+
+	if (!runtime->mmap)
+		return;
+	appl = smp_load_acquire(&runtime->mmap_status->appl_ptr);
+	delta = appl - runtime->mmap_appl_ptr;
+	/* don't trust user-space beyond the valid area */
+	if (delta > runtime->avail)
+		delta = runtime->avail;
+	runtime->appl_ptr = (runtime->appl_ptr + delta) & (runtime->buffer_size - 1);
+	runtime->avail -= delta;
+	runtime->mmap_appl_ptr += delta;
+}
+
+static void snd_rawmidi_mmap_advance_hw(struct snd_rawmidi_runtime *runtime,
+					size_t count)
+{
+	if (!runtime->mmap || !count)
+		return;
+	runtime->mmap_hw_ptr += count;
+	smp_store_release(&runtime->mmap_status->hw_ptr, runtime->mmap_hw_ptr);
+}
+
+static inline void snd_rawmidi_output_trigger(struct snd_rawmidi_substream *substream, int up);
+
+/*
+ * scheduled output helpers: call with substream->lock held
+ *
+ * The frames written by the application are kept in a separate queue and
+ * moved into the byte ring that the driver consumes when they are due.
+ */
+static ktime_t snd_rawmidi_sched_now(struct snd_rawmidi_substream *substream)
+{
+	if (substream->clock_type == SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW)
+		return ktime_get_raw();
+	return ktime_get();
+}
+
+static void snd_rawmidi_sched_arm(struct snd_rawmidi_substream *substream,
+				  ktime_t now, ktime_t when)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+
+	/* there's no hrtimer base for the raw clock, convert the distance */
+	if (substream->clock_type == SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW)
+		when = ktime_add(ktime_get(), ktime_sub(when, now));
+	hrtimer_start(&runtime->sched_timer, when, HRTIMER_MODE_ABS_SOFT);
+}
+
+/* move the due frames into the output buffer; returns true if any */
+static bool snd_rawmidi_sched_release(struct snd_rawmidi_substream *substream)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	struct snd_rawmidi_framing_tstamp *frame;
+	ktime_t now, when;
+	size_t count1;
+	bool released = false;
+
+	if (!runtime->sched_count)
+		return false;
+	now = snd_rawmidi_sched_now(substream);
+	while (runtime->sched_count) {
+		frame = &runtime->sched_queue[runtime->sched_head];
+		when = ktime_set(frame->tv_sec, frame->tv_nsec);
+		if (ktime_after(when, now)) {
+			snd_rawmidi_sched_arm(substream, now, when);
+			break;
+		}
+		/* no room; retried from snd_rawmidi_transmit_ack() */
+		if (frame->length > runtime->avail)
+			break;
+		count1 = min_t(size_t, frame->length,
+			       runtime->buffer_size - runtime->appl_ptr);
+		memcpy(runtime->buffer + runtime->appl_ptr, frame->data, count1);
+		memcpy(runtime->buffer, frame->data + count1,
+		       frame->length - count1);
+		runtime->appl_ptr += frame->length;
+		runtime->appl_ptr %= runtime->buffer_size;
+		runtime->avail -= frame->length;
+		runtime->sched_head = (runtime->sched_head + 1) % runtime->sched_size;
+		runtime->sched_count--;
+		released = true;
+	}
+	if (released)
+		wake_up(&runtime->sleep);
+	return released;
+}
+
+static enum hrtimer_restart snd_rawmidi_sched_timer(struct hrtimer *timer)
+{
+	struct snd_rawmidi_runtime *runtime =
+		container_of(timer, struct snd_rawmidi_runtime, sched_timer);
+	struct snd_rawmidi_substream *substream = runtime->substream;
+	unsigned long flags;
+	bool released;
+
+	spin_lock_irqsave(&substream->lock, flags);
+	released = snd_rawmidi_sched_release(substream);
+	spin_unlock_irqrestore(&substream->lock, flags);
+	if (released)
+		snd_rawmidi_output_trigger(substream, 1);
+	return HRTIMER_NORESTART;
+}
+
+static void snd_rawmidi_sched_flush(struct snd_rawmidi_substream *substream)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+
+	if (!runtime)
+		return;
+	hrtimer_cancel(&runtime->sched_timer);
+	spin_lock_irq(&substream->lock);
+	runtime->sched_head = runtime->sched_count = 0;
+	spin_unlock_irq(&substream->lock);
+	wake_up(&runtime->sleep);
+}
+
 static void snd_rawmidi_buffer_ref_sync(struct snd_rawmidi_substream *substream)
 {
 	int loop = HZ;
@@ -167,6 +310,8 @@ static int snd_rawmidi_runtime_create(struct snd_rawmidi_substream *substream)
 	runtime->substream = substream;
 	init_waitqueue_head(&runtime->sleep);
 	INIT_WORK(&runtime->event_work, snd_rawmidi_input_event_work);
+	hrtimer_init(&runtime->sched_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_SOFT);
+	runtime->sched_timer.function = snd_rawmidi_sched_timer;
 	runtime->event = NULL;
 	runtime->buffer_size = PAGE_SIZE;
 	runtime->avail_min = 1;
@@ -188,7 +333,10 @@ static int snd_rawmidi_runtime_free(struct snd_rawmidi_substream *substream)
 {
 	struct snd_rawmidi_runtime *runtime = substream->runtime;
 
+	hrtimer_cancel(&runtime->sched_timer);
+	kvfree(runtime->sched_queue);
 	kvfree(runtime->buffer);
+	vfree(runtime->mmap_status);
 	kfree(runtime);
 	substream->runtime = NULL;
 	return 0;
@@ -216,6 +364,14 @@ static void __reset_runtime_ptrs(struct snd_rawmidi_runtime *runtime,
 	runtime->drain = 0;
 	runtime->appl_ptr = runtime->hw_ptr = 0;
 	runtime->avail = is_input ? 0 : runtime->buffer_size;
+	if (runtime->mmap) {
+		runtime->mmap_hw_ptr = runtime->mmap_appl_ptr = 0;
+		WRITE_ONCE(runtime->mmap_status->hw_ptr, 0);
+		WRITE_ONCE(runtime->mmap_status->appl_ptr, 0);
+		WRITE_ONCE(runtime->mmap_status->xruns, 0);
+		WRITE_ONCE(runtime->mmap_status->state,
+			   SNDRV_RAWMIDI_MMAP_STATE_IDLE);
+	}
 }
 
 static void reset_runtime_ptrs(struct snd_rawmidi_substream *substream,
@@ -232,6 +388,7 @@ static void reset_runtime_ptrs(struct snd_rawmidi_substream *substream,
 int snd_rawmidi_drop_output(struct snd_rawmidi_substream *substream)
 {
 	snd_rawmidi_output_trigger(substream, 0);
+	snd_rawmidi_sched_flush(substream);
 	reset_runtime_ptrs(substream, false);
 	return 0;
 }
@@ -256,13 +413,15 @@ int snd_rawmidi_drain_output(struct snd_rawmidi_substream *substream)
 		return err;
 
 	timeout = wait_event_interruptible_timeout(runtime->sleep,
-				(runtime->avail >= runtime->buffer_size),
+				(runtime->avail >= runtime->buffer_size &&
+				 !runtime->sched_count),
 				10*HZ);
 
 	spin_lock_irq(&substream->lock);
 	if (signal_pending(current))
 		err = -ERESTARTSYS;
-	if (runtime->avail < runtime->buffer_size && !timeout) {
+	if ((runtime->avail < runtime->buffer_size || runtime->sched_count) &&
+	    !timeout) {
 		rmidi_warn(substream->rmidi,
 			   "rawmidi drain error (avail = %li, buffer_size = %li)\n",
 			   (long)runtime->avail, (long)runtime->buffer_size);
@@ -524,6 +683,9 @@ static int snd_rawmidi_open(struct inode *inode, struct file *file)
 		rawmidi_file->output->runtime->oss = (maj == SOUND_MAJOR);
 #endif
 	file->private_data = rawmidi_file;
+	/* io_uring may try the transfers without blocking, then poll */
+	if (!(file->f_flags & O_DSYNC))
+		file->f_mode |= FMODE_NOWAIT;
 	mutex_unlock(&rmidi->open_mutex);
 	snd_card_unref(rmidi->card);
 	return 0;
@@ -548,7 +710,7 @@ static void close_substream(struct snd_rawmidi *rmidi,
 		if (substream->stream == SNDRV_RAWMIDI_STREAM_INPUT)
 			snd_rawmidi_input_trigger(substream, 0);
 		else {
-			if (substream->active_sensing) {
+			if (substream->active_sensing && !substream->runtime->mmap) {
 				unsigned char buf = 0xfe;
 				/* sending single active sensing message
 				 * to shut the device up
@@ -723,6 +885,7 @@ static int resize_runtime_buffer(struct snd_rawmidi_substream *substream,
 	struct snd_rawmidi_runtime *runtime = substream->runtime;
 	char *newbuf, *oldbuf;
 	unsigned int framing = params->mode & SNDRV_RAWMIDI_MODE_FRAMING_MASK;
+	bool mmap = params->mode & SNDRV_RAWMIDI_MODE_MMAP;
 
 	if (params->buffer_size < 32 || params->buffer_size > 1024L * 1024L)
 		return -EINVAL;
@@ -730,8 +893,28 @@ static int resize_runtime_buffer(struct snd_rawmidi_substream *substream,
 		return -EINVAL;
 	if (params->avail_min < 1 || params->avail_min > params->buffer_size)
 		return -EINVAL;
-	if (params->buffer_size != runtime->buffer_size) {
-		newbuf = kvzalloc(params->buffer_size, GFP_KERNEL);
+	if (mmap) {
+		/* the ring is indexed with a mask and mapped page-wise */
+		if (!is_power_of_2(params->buffer_size) ||
+		    !PAGE_ALIGNED(params->buffer_size))
+			return -EINVAL;
+		/* a shared output can't be handed to a single mapping */
+		if (substream->append)
+			return -EBUSY;
+		if (!runtime->mmap_status) {
+			runtime->mmap_status = vmalloc_user(PAGE_SIZE);
+			if (!runtime->mmap_status)
+				return -ENOMEM;
+		}
+	}
+	if (params->buffer_size != runtime->buffer_size ||
+	    mmap != runtime->mmap) {
+		if (atomic_read(&runtime->mmap_count))
+			return -EBUSY;
+		if (mmap)
+			newbuf = vmalloc_user(params->buffer_size);
+		else
+			newbuf = kvzalloc(params->buffer_size, GFP_KERNEL);
 		if (!newbuf)
 			return -ENOMEM;
 		spin_lock_irq(&substream->lock);
@@ -743,6 +926,9 @@ static int resize_runtime_buffer(struct snd_rawmidi_substream *substream,
 		oldbuf = runtime->buffer;
 		runtime->buffer = newbuf;
 		runtime->buffer_size = params->buffer_size;
+		runtime->mmap = mmap;
+		if (mmap)
+			runtime->mmap_status->buffer_size = params->buffer_size;
 		__reset_runtime_ptrs(runtime, is_input);
 		spin_unlock_irq(&substream->lock);
 		kvfree(oldbuf);
@@ -751,20 +937,63 @@ static int resize_runtime_buffer(struct snd_rawmidi_substream *substream,
 	return 0;
 }
 
+/* set up the frame queue for the scheduled output */
+static int resize_sched_queue(struct snd_rawmidi_substream *substream,
+			      bool sched)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	struct snd_rawmidi_framing_tstamp *newq = NULL, *oldq;
+	unsigned int size = 0;
+
+	if (sched) {
+		size = runtime->buffer_size / sizeof(*newq);
+		newq = kvcalloc(size, sizeof(*newq), GFP_KERNEL);
+		if (!newq)
+			return -ENOMEM;
+	}
+	hrtimer_cancel(&runtime->sched_timer);
+	spin_lock_irq(&substream->lock);
+	oldq = runtime->sched_queue;
+	runtime->sched_queue = newq;
+	runtime->sched_size = size;
+	runtime->sched_head = runtime->sched_count = 0;
+	spin_unlock_irq(&substream->lock);
+	kvfree(oldq);
+	return 0;
+}
+
 int snd_rawmidi_output_params(struct snd_rawmidi_substream *substream,
 			      struct snd_rawmidi_params *params)
 {
+	unsigned int framing = params->mode & SNDRV_RAWMIDI_MODE_FRAMING_MASK;
+	unsigned int clock_type = params->mode & SNDRV_RAWMIDI_MODE_CLOCK_MASK;
+	bool sched = framing == SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP;
 	int err;
 
+	if (sched) {
+		if (clock_type != SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC &&
+		    clock_type != SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW)
+			return -EINVAL;
+		if (params->mode & SNDRV_RAWMIDI_MODE_MMAP)
+			return -EINVAL;
+	}
+
 	snd_rawmidi_drain_output(substream);
 	mutex_lock(&substream->rmidi->open_mutex);
 	if (substream->append && substream->use_count > 1)
 		err = -EBUSY;
+	else if (sched && substream->append)
+		err = -EBUSY;
 	else
 		err = resize_runtime_buffer(substream, params, false);
+	if (!err && (sched || substream->runtime->sched_queue))
+		err = resize_sched_queue(substream, sched);
 
-	if (!err)
+	if (!err) {
 		substream->active_sensing = !params->no_active_sensing;
+		substream->framing = sched ? framing : SNDRV_RAWMIDI_MODE_FRAMING_NONE;
+		substream->clock_type = sched ? clock_type : SNDRV_RAWMIDI_MODE_CLOCK_NONE;
+	}
 	mutex_unlock(&substream->rmidi->open_mutex);
 	return err;
 }
@@ -793,7 +1022,7 @@ int snd_rawmidi_input_params(struct snd_rawmidi_substream *substream,
 		substream->clock_type = clock_type;
 	}
 	mutex_unlock(&substream->rmidi->open_mutex);
-	return 0;
+	return err;
 }
 EXPORT_SYMBOL(snd_rawmidi_input_params);
 
@@ -805,7 +1034,11 @@ static int snd_rawmidi_output_status(struct snd_rawmidi_substream *substream,
 	memset(status, 0, sizeof(*status));
 	status->stream = SNDRV_RAWMIDI_STREAM_OUTPUT;
 	spin_lock_irq(&substream->lock);
-	status->avail = runtime->avail;
+	snd_rawmidi_mmap_sync_appl(runtime);
+	if (runtime->sched_queue)
+		status->avail = snd_rawmidi_sched_room(runtime);
+	else
+		status->avail = runtime->avail;
 	spin_unlock_irq(&substream->lock);
 	return 0;
 }
@@ -818,6 +1051,7 @@ static int snd_rawmidi_input_status(struct snd_rawmidi_substream *substream,
 	memset(status, 0, sizeof(*status));
 	status->stream = SNDRV_RAWMIDI_STREAM_INPUT;
 	spin_lock_irq(&substream->lock);
+	snd_rawmidi_mmap_sync_appl(runtime);
 	status->avail = runtime->avail;
 	status->xruns = runtime->xruns;
 	runtime->xruns = 0;
@@ -899,6 +1133,40 @@ static int snd_rawmidi_ioctl_status64(struct snd_rawmidi_file *rfile,
 	return 0;
 }
 
+static int snd_rawmidi_mmap_sync_output(struct snd_rawmidi_substream *substream)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	bool pending;
+
+	spin_lock_irq(&substream->lock);
+	if (!runtime->mmap) {
+		spin_unlock_irq(&substream->lock);
+		return -EBADFD;
+	}
+	snd_rawmidi_mmap_sync_appl(runtime);
+	pending = runtime->avail < runtime->buffer_size;
+	if (pending)
+		WRITE_ONCE(runtime->mmap_status->state,
+			   SNDRV_RAWMIDI_MMAP_STATE_RUNNING);
+	spin_unlock_irq(&substream->lock);
+	if (pending)
+		snd_rawmidi_output_trigger(substream, 1);
+	return 0;
+}
+
+static int snd_rawmidi_mmap_sync_input(struct snd_rawmidi_substream *substream)
+{
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+
+	if (!runtime->mmap)
+		return -EBADFD;
+	snd_rawmidi_input_trigger(substream, 1);
+	spin_lock_irq(&substream->lock);
+	snd_rawmidi_mmap_sync_appl(runtime);
+	spin_unlock_irq(&substream->lock);
+	return 0;
+}
+
 static long snd_rawmidi_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct snd_rawmidi_file *rfile;
@@ -992,6 +1260,25 @@ static long snd_rawmidi_ioctl(struct file *file, unsigned int cmd, unsigned long
 			return -EINVAL;
 		}
 	}
+	case SNDRV_RAWMIDI_IOCTL_MMAP_SYNC:
+	{
+		int val;
+
+		if (get_user(val, (int __user *) argp))
+			return -EFAULT;
+		switch (val) {
+		case SNDRV_RAWMIDI_STREAM_OUTPUT:
+			if (rfile->output == NULL)
+				return -EINVAL;
+			return snd_rawmidi_mmap_sync_output(rfile->output);
+		case SNDRV_RAWMIDI_STREAM_INPUT:
+			if (rfile->input == NULL)
+				return -EINVAL;
+			return snd_rawmidi_mmap_sync_input(rfile->input);
+		default:
+			return -EINVAL;
+		}
+	}
 	default:
 		rmidi_dbg(rfile->rmidi,
 			  "rawmidi: unknown command = 0x%x\n", cmd);
@@ -1100,23 +1387,14 @@ static struct timespec64 get_framing_tstamp(struct snd_rawmidi_substream *substr
 	return ts64;
 }
 
-/**
- * snd_rawmidi_receive - receive the input data from the device
- * @substream: the rawmidi substream
- * @buffer: the buffer pointer
- * @count: the data size to read
- *
- * Reads the data from the internal buffer.
- *
- * Return: The size of read data, or a negative error code on failure.
- */
-int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
-			const unsigned char *buffer, int count)
+static int __snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
+				 const unsigned char *buffer, int count,
+				 const struct timespec64 *ts64)
 {
 	unsigned long flags;
-	struct timespec64 ts64 = get_framing_tstamp(substream);
 	int result = 0, count1;
 	struct snd_rawmidi_runtime *runtime;
+	size_t old_avail;
 
 	spin_lock_irqsave(&substream->lock, flags);
 	if (!substream->opened) {
@@ -1131,8 +1409,10 @@ int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 		goto unlock;
 	}
 
+	snd_rawmidi_mmap_sync_appl(runtime);
+	old_avail = runtime->avail;
 	if (substream->framing == SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP) {
-		result = receive_with_tstamp_framing(substream, buffer, count, &ts64);
+		result = receive_with_tstamp_framing(substream, buffer, count, ts64);
 	} else if (count == 1) {	/* special case, faster code */
 		substream->bytes++;
 		if (runtime->avail < runtime->buffer_size) {
@@ -1171,6 +1451,10 @@ int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 			}
 		}
 	}
+	if (runtime->mmap) {
+		snd_rawmidi_mmap_advance_hw(runtime, runtime->avail - old_avail);
+		WRITE_ONCE(runtime->mmap_status->xruns, runtime->xruns);
+	}
 	if (result > 0) {
 		if (runtime->event)
 			schedule_work(&runtime->event_work);
@@ -1181,8 +1465,57 @@ int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
 	spin_unlock_irqrestore(&substream->lock, flags);
 	return result;
 }
+
+/**
+ * snd_rawmidi_receive - receive the input data from the device
+ * @substream: the rawmidi substream
+ * @buffer: the buffer pointer
+ * @count: the data size to read
+ *
+ * Reads the data from the internal buffer.
+ *
+ * Return: The size of read data, or a negative error code on failure.
+ */
+int snd_rawmidi_receive(struct snd_rawmidi_substream *substream,
+			const unsigned char *buffer, int count)
+{
+	struct timespec64 ts64 = get_framing_tstamp(substream);
+
+	return __snd_rawmidi_receive(substream, buffer, count, &ts64);
+}
 EXPORT_SYMBOL(snd_rawmidi_receive);
 
+/**
+ * snd_rawmidi_receive_tstamp - receive the input data with its arrival time
+ * @substream: the rawmidi substream
+ * @buffer: the buffer pointer
+ * @count: the data size to read
+ * @tstamp: the time the data arrived at the hardware, in CLOCK_MONOTONIC
+ *
+ * Like snd_rawmidi_receive(), but for drivers that know when the data
+ * actually arrived (e.g. from a bus frame counter).  In the tstamp framing
+ * mode the frames are stamped with @tstamp, converted to the clock that
+ * was selected for the substream, instead of the time of this call.
+ *
+ * Return: The size of read data, or a negative error code on failure.
+ */
+int snd_rawmidi_receive_tstamp(struct snd_rawmidi_substream *substream,
+			       const unsigned char *buffer, int count,
+			       ktime_t tstamp)
+{
+	struct timespec64 ts64 = get_framing_tstamp(substream);
+	s64 age;
+
+	if (substream->framing == SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP &&
+	    substream->clock_type != SNDRV_RAWMIDI_MODE_CLOCK_NONE) {
+		age = ktime_to_ns(ktime_sub(ktime_get(), tstamp));
+		if (age > 0)
+			ts64 = timespec64_sub(ts64, ns_to_timespec64(age));
+	}
+	return __snd_rawmidi_receive(substream, buffer, count, &ts64);
+}
+EXPORT_SYMBOL(snd_rawmidi_receive_tstamp);
+
 static long snd_rawmidi_kernel_read1(struct snd_rawmidi_substream *substream,
 				     unsigned char __user *userbuf,
 				     unsigned char *kernelbuf, long count)
@@ -1236,8 +1569,8 @@ long snd_rawmidi_kernel_read(struct snd_rawmidi_substream *substream,
 }
 EXPORT_SYMBOL(snd_rawmidi_kernel_read);
 
-static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t count,
-				loff_t *offset)
+static ssize_t snd_rawmidi_do_read(struct file *file, char __user *buf,
+				   size_t count, bool nonblock)
 {
 	long result;
 	int count1;
@@ -1250,6 +1583,8 @@ static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t coun
 	if (substream == NULL)
 		return -EIO;
 	runtime = substream->runtime;
+	if (runtime->mmap)
+		return -EBADFD;
 	snd_rawmidi_input_trigger(substream, 1);
 	result = 0;
 	while (count > 0) {
@@ -1257,7 +1592,7 @@ static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t coun
 		while (!__snd_rawmidi_ready(runtime)) {
 			wait_queue_entry_t wait;
 
-			if ((file->f_flags & O_NONBLOCK) != 0 || result > 0) {
+			if (nonblock || result > 0) {
 				spin_unlock_irq(&substream->lock);
 				return result > 0 ? result : -EAGAIN;
 			}
@@ -1291,6 +1626,53 @@ static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t coun
 	return result;
 }
 
+static ssize_t snd_rawmidi_read(struct file *file, char __user *buf, size_t count,
+				loff_t *offset)
+{
+	return snd_rawmidi_do_read(file, buf, count, file->f_flags & O_NONBLOCK);
+}
+
+/* the user buffer of the current segment of a user-backed iov_iter */
+static int snd_rawmidi_iter_seg(struct iov_iter *iter, struct iovec *iov)
+{
+	if (iter_is_ubuf(iter)) {
+		iov->iov_base = iter->ubuf + iter->iov_offset;
+		iov->iov_len = iov_iter_count(iter);
+	} else if (iter_is_iovec(iter)) {
+		*iov = iov_iter_iovec(iter);
+	} else {
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static bool snd_rawmidi_iocb_nonblock(struct kiocb *iocb)
+{
+	return (iocb->ki_filp->f_flags & O_NONBLOCK) ||
+		(iocb->ki_flags & IOCB_NOWAIT);
+}
+
+static ssize_t snd_rawmidi_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	bool nonblock = snd_rawmidi_iocb_nonblock(iocb);
+	ssize_t result = 0, count;
+	struct iovec iov;
+
+	while (iov_iter_count(to)) {
+		if (snd_rawmidi_iter_seg(to, &iov))
+			return result > 0 ? result : -EINVAL;
+		count = snd_rawmidi_do_read(iocb->ki_filp, iov.iov_base,
+					    iov.iov_len, nonblock || result > 0);
+		if (count <= 0)
+			return result > 0 ? result : count;
+		iov_iter_advance(to, count);
+		result += count;
+		if (count < iov.iov_len)
+			break;
+	}
+	return result;
+}
+
 /**
  * snd_rawmidi_transmit_empty - check whether the output buffer is empty
  * @substream: the rawmidi substream
@@ -1310,6 +1692,7 @@ int snd_rawmidi_transmit_empty(struct snd_rawmidi_substream *substream)
 			  "snd_rawmidi_transmit_empty: output is not active!!!\n");
 		result = 1;
 	} else {
+		snd_rawmidi_mmap_sync_appl(runtime);
 		result = runtime->avail >= runtime->buffer_size;
 	}
 	spin_unlock_irqrestore(&substream->lock, flags);
@@ -1337,6 +1720,19 @@ static int __snd_rawmidi_transmit_peek(struct snd_rawmidi_substream *substream,
 		return -EINVAL;
 	}
 	result = 0;
+	snd_rawmidi_mmap_sync_appl(runtime);
+	if (runtime->avail >= runtime->buffer_size && runtime->mmap) {
+		/* tell user-space that the next update needs a kick, then
+		 * re-check so that a racing appl_ptr update isn't lost
+		 */
+		WRITE_ONCE(runtime->mmap_status->state,
+			   SNDRV_RAWMIDI_MMAP_STATE_IDLE);
+		smp_mb();
+		snd_rawmidi_mmap_sync_appl(runtime);
+		if (runtime->avail < runtime->buffer_size)
+			WRITE_ONCE(runtime->mmap_status->state,
+				   SNDRV_RAWMIDI_MMAP_STATE_RUNNING);
+	}
 	if (runtime->avail >= runtime->buffer_size) {
 		/* warning: lowlevel layer MUST trigger down the hardware */
 		goto __skip;
@@ -1416,6 +1812,10 @@ static int __snd_rawmidi_transmit_ack(struct snd_rawmidi_substream *substream,
 	runtime->hw_ptr %= runtime->buffer_size;
 	runtime->avail += count;
 	substream->bytes += count;
+	snd_rawmidi_mmap_advance_hw(runtime, count);
+	/* due frames may have waited for room in the buffer */
+	if (runtime->sched_count)
+		snd_rawmidi_sched_release(substream);
 	if (count > 0) {
 		if (runtime->drain || __snd_rawmidi_ready(runtime))
 			wake_up(&runtime->sleep);
@@ -1494,6 +1894,8 @@ int snd_rawmidi_proceed(struct snd_rawmidi_substream *substream)
 
 	spin_lock_irqsave(&substream->lock, flags);
 	runtime = substream->runtime;
+	if (substream->opened && runtime)
+		snd_rawmidi_mmap_sync_appl(runtime);
 	if (substream->opened && runtime &&
 	    runtime->avail < runtime->buffer_size) {
 		count = runtime->buffer_size - runtime->avail;
@@ -1573,8 +1975,62 @@ long snd_rawmidi_kernel_write(struct snd_rawmidi_substream *substream,
 }
 EXPORT_SYMBOL(snd_rawmidi_kernel_write);
 
-static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
-				 size_t count, loff_t *offset)
+static ssize_t snd_rawmidi_sched_write(struct snd_rawmidi_file *rfile,
+				       const char __user *buf, size_t count,
+				       bool nonblock)
+{
+	struct snd_rawmidi_substream *substream = rfile->output;
+	struct snd_rawmidi_runtime *runtime = substream->runtime;
+	struct snd_rawmidi_framing_tstamp frame;
+	unsigned int tail;
+	ssize_t result = 0;
+	bool released;
+	int err;
+
+	if (count % sizeof(frame))
+		return -EINVAL;
+	while (count > 0) {
+		if (copy_from_user(&frame, buf, sizeof(frame)))
+			return result > 0 ? result : -EFAULT;
+		if (frame.length > SNDRV_RAWMIDI_FRAMING_DATA_LENGTH ||
+		    frame.tv_nsec >= NSEC_PER_SEC)
+			return result > 0 ? result : -EINVAL;
+
+		spin_lock_irq(&substream->lock);
+		while (runtime->sched_count >= runtime->sched_size) {
+			spin_unlock_irq(&substream->lock);
+			if (nonblock)
+				return result > 0 ? result : -EAGAIN;
+			err = wait_event_interruptible(runtime->sleep,
+				runtime->sched_count < runtime->sched_size ||
+				rfile->rmidi->card->shutdown);
+			if (rfile->rmidi->card->shutdown)
+				return -ENODEV;
+			if (err < 0)
+				return result > 0 ? result : err;
+			spin_lock_irq(&substream->lock);
+		}
+		tail = (runtime->sched_head + runtime->sched_count) %
+			runtime->sched_size;
+		runtime->sched_queue[tail] = frame;
+		runtime->sched_count++;
+		released = false;
+		/* a new head needs the timer to be (re)armed */
+		if (runtime->sched_count == 1)
+			released = snd_rawmidi_sched_release(substream);
+		spin_unlock_irq(&substream->lock);
+		if (released)
+			snd_rawmidi_output_trigger(substream, 1);
+
+		result += sizeof(frame);
+		buf += sizeof(frame);
+		count -= sizeof(frame);
+	}
+	return result;
+}
+
+static ssize_t snd_rawmidi_do_write(struct file *file, const char __user *buf,
+				    size_t count, bool nonblock)
 {
 	long result, timeout;
 	int count1;
@@ -1585,6 +2041,10 @@ static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
 	rfile = file->private_data;
 	substream = rfile->output;
 	runtime = substream->runtime;
+	if (runtime->mmap)
+		return -EBADFD;
+	if (runtime->sched_queue)
+		return snd_rawmidi_sched_write(rfile, buf, count, nonblock);
 	/* we cannot put an atomic message to our buffer */
 	if (substream->append && count > runtime->buffer_size)
 		return -EIO;
@@ -1594,7 +2054,7 @@ static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
 		while (!snd_rawmidi_ready_append(substream, count)) {
 			wait_queue_entry_t wait;
 
-			if (file->f_flags & O_NONBLOCK) {
+			if (nonblock) {
 				spin_unlock_irq(&substream->lock);
 				return result > 0 ? result : -EAGAIN;
 			}
@@ -1620,7 +2080,7 @@ static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
 			return result > 0 ? result : count1;
 		result += count1;
 		buf += count1;
-		if ((size_t)count1 < count && (file->f_flags & O_NONBLOCK))
+		if ((size_t)count1 < count && nonblock)
 			break;
 		count -= count1;
 	}
@@ -1647,6 +2107,35 @@ static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
 	return result;
 }
 
+static ssize_t snd_rawmidi_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *offset)
+{
+	return snd_rawmidi_do_write(file, buf, count,
+				    file->f_flags & O_NONBLOCK);
+}
+
+static ssize_t snd_rawmidi_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	bool nonblock = snd_rawmidi_iocb_nonblock(iocb);
+	ssize_t result = 0, count;
+	struct iovec iov;
+
+	while (iov_iter_count(from)) {
+		if (snd_rawmidi_iter_seg(from, &iov))
+			return result > 0 ? result : -EINVAL;
+		count = snd_rawmidi_do_write(iocb->ki_filp, iov.iov_base,
+					     iov.iov_len,
+					     nonblock || result > 0);
+		if (count <= 0)
+			return result > 0 ? result : count;
+		iov_iter_advance(from, count);
+		result += count;
+		if (count < iov.iov_len)
+			break;
+	}
+	return result;
+}
+
 static __poll_t snd_rawmidi_poll(struct file *file, poll_table *wait)
 {
 	struct snd_rawmidi_file *rfile;
@@ -1675,6 +2164,78 @@ static __poll_t snd_rawmidi_poll(struct file *file, poll_table *wait)
 	return mask;
 }
 
+/*
+ * mmap support
+ */
+static void snd_rawmidi_vm_open(struct vm_area_struct *area)
+{
+	struct snd_rawmidi_runtime *runtime = area->vm_private_data;
+
+	atomic_inc(&runtime->mmap_count);
+}
+
+static void snd_rawmidi_vm_close(struct vm_area_struct *area)
+{
+	struct snd_rawmidi_runtime *runtime = area->vm_private_data;
+
+	atomic_dec(&runtime->mmap_count);
+}
+
+static const struct vm_operations_struct snd_rawmidi_vm_ops = {
+	.open =		snd_rawmidi_vm_open,
+	.close =	snd_rawmidi_vm_close,
+};
+
+static int snd_rawmidi_mmap(struct file *file, struct vm_area_struct *area)
+{
+	struct snd_rawmidi_file *rfile = file->private_data;
+	struct snd_rawmidi_substream *substream;
+	struct snd_rawmidi_runtime *runtime;
+	unsigned long offset = area->vm_pgoff << PAGE_SHIFT;
+	unsigned long size = area->vm_end - area->vm_start;
+	bool status;
+	int err;
+
+	switch (offset) {
+	case SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_DATA:
+	case SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_STATUS:
+		substream = rfile->input;
+		break;
+	case SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_DATA:
+	case SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_STATUS:
+		substream = rfile->output;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (!substream)
+		return -ENXIO;
+	status = offset == SNDRV_RAWMIDI_MMAP_OFFSET_INPUT_STATUS ||
+		 offset == SNDRV_RAWMIDI_MMAP_OFFSET_OUTPUT_STATUS;
+
+	/* serialize against resize_runtime_buffer() */
+	mutex_lock(&substream->rmidi->open_mutex);
+	runtime = substream->runtime;
+	if (!runtime->mmap) {
+		err = -EBADFD;
+		goto unlock;
+	}
+	if (size > (status ? PAGE_SIZE : runtime->buffer_size)) {
+		err = -EINVAL;
+		goto unlock;
+	}
+	err = remap_vmalloc_range(area, status ? (void *)runtime->mmap_status :
+				  runtime->buffer, 0);
+	if (err < 0)
+		goto unlock;
+	area->vm_private_data = runtime;
+	area->vm_ops = &snd_rawmidi_vm_ops;
+	snd_rawmidi_vm_open(area);
+ unlock:
+	mutex_unlock(&substream->rmidi->open_mutex);
+	return err;
+}
+
 /*
  */
 #ifdef CONFIG_COMPAT
@@ -1721,7 +2282,9 @@ static void snd_rawmidi_proc_info_read(struct snd_info_entry *entry,
 				    "  Mode         : %s\n"
 				    "  Buffer size  : %lu\n"
 				    "  Avail        : %lu\n",
-				    runtime->oss ? "OSS compatible" : "native",
+				    runtime->oss ? "OSS compatible" :
+				    runtime->mmap ? "mmap" :
+				    runtime->sched_queue ? "scheduled" : "native",
 				    buffer_size, avail);
 			}
 		}
@@ -1771,11 +2334,14 @@ static void snd_rawmidi_proc_info_read(struct snd_info_entry *entry,
 static const struct file_operations snd_rawmidi_f_ops = {
 	.owner =	THIS_MODULE,
 	.read =		snd_rawmidi_read,
+	.read_iter =	snd_rawmidi_read_iter,
 	.write =	snd_rawmidi_write,
+	.write_iter =	snd_rawmidi_write_iter,
 	.open =		snd_rawmidi_open,
 	.release =	snd_rawmidi_release,
 	.llseek =	no_llseek,
 	.poll =		snd_rawmidi_poll,
+	.mmap =		snd_rawmidi_mmap,
 	.unlocked_ioctl =	snd_rawmidi_ioctl,
 	.compat_ioctl =	snd_rawmidi_ioctl_compat,
 };
@@ -15,6 +15,7 @@
  *  Copyright (c) Jaroslav Kysela <perex@perex.cz>
  */
 
+#include <linux/hrtimer.h>
 #include <linux/init.h>
 #include <linux/jiffies.h>
 #include <linux/slab.h>
@@ -42,6 +43,8 @@ static bool enable[SNDRV_CARDS] = {1, [1 ... (SNDRV_CARDS - 1)] = 0};
 static int pcm_substreams[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 8};
 static int pcm_notify[SNDRV_CARDS];
 static char *timer_source[SNDRV_CARDS];
+static bool resample[SNDRV_CARDS];
+static int period_wakeups[SNDRV_CARDS] = {[0 ... (SNDRV_CARDS - 1)] = 1};
 
 module_param_array(index, int, NULL, 0444);
 MODULE_PARM_DESC(index, "Index value for loopback soundcard.");
@@ -54,9 +57,14 @@ MODULE_PARM_DESC(pcm_substreams, "PCM substreams # (1-8) for loopback driver.");
 module_param_array(pcm_notify, int, NULL, 0444);
 MODULE_PARM_DESC(pcm_notify, "Break capture when PCM format/rate/channels changes.");
 module_param_array(timer_source, charp, NULL, 0444);
-MODULE_PARM_DESC(timer_source, "Sound card name or number and device/subdevice number of timer to be used. Empty string for jiffies timer [default].");
+MODULE_PARM_DESC(timer_source, "Sound card name or number and device/subdevice number of timer to be used. \"hrtimer\" for a high resolution timer. Empty string for jiffies timer [default].");
+module_param_array(resample, bool, NULL, 0444);
+MODULE_PARM_DESC(resample, "Allow different rates on both ends of a cable and convert them in the driver (S16/S32, jiffies or hrtimer only).");
+module_param_array(period_wakeups, int, NULL, 0444);
+MODULE_PARM_DESC(period_wakeups, "Wakeups per period (1-16) with the hrtimer timer source.");
 
 #define NO_PITCH 100000
+#define MAX_PERIOD_WAKEUPS 16
 
 #define CABLE_VALID_PLAYBACK	BIT(SNDRV_PCM_STREAM_PLAYBACK)
 #define CABLE_VALID_CAPTURE	BIT(SNDRV_PCM_STREAM_CAPTURE)
@@ -105,6 +113,14 @@ struct loopback_cable {
 	unsigned int pause;
 	/* timer specific */
 	const struct loopback_ops *ops;
+	/* rate adaptation between both ends */
+	unsigned int resample:1;
+	struct {
+		u64 step_base;	/* playback frames per capture frame, 32.32 */
+		s64 step_adj;	/* drift correction of step_base */
+		s64 step;	/* current step */
+		s64 offset;	/* read head relative to the playback position */
+	} rs;
 	/* If sound timer is used */
 	struct {
 		int stream;
@@ -133,6 +149,8 @@ struct loopback {
 	struct snd_pcm *pcm[2];
 	struct loopback_setup setup[MAX_PCM_SUBSTREAMS][2];
 	const char *timer_source;
+	bool resample;
+	unsigned int period_wakeups;
 };
 
 struct loopback_pcm {
@@ -158,6 +176,12 @@ struct loopback_pcm {
 	unsigned long last_jiffies;
 	/* If jiffies timer is used */
 	struct timer_list timer;
+	/* If hrtimer is used */
+	struct hrtimer hrtimer;
+	ktime_t last_time;
+	ktime_t wakeup_interval;
+	u64 time_frac;		/* elapsed ns * rate not yet counted as frames */
+	unsigned int period_pos;	/* bytes since the last period boundary */
 };
 
 static struct platform_device *devices[SNDRV_CARDS];
@@ -317,6 +341,14 @@ static int loopback_snd_timer_close_cable(struct loopback_pcm *dpcm)
 	return 0;
 }
 
+/* only plain native-endian integer samples are converted */
+static bool loopback_can_resample(struct loopback_cable *cable,
+				  snd_pcm_format_t format)
+{
+	return cable->resample &&
+	       (format == SNDRV_PCM_FORMAT_S16 || format == SNDRV_PCM_FORMAT_S32);
+}
+
 static int loopback_check_format(struct loopback_cable *cable, int stream)
 {
 	struct snd_pcm_runtime *runtime, *cruntime;
@@ -334,7 +366,8 @@ static int loopback_check_format(struct loopback_cable *cable, int stream)
 	cruntime = cable->streams[SNDRV_PCM_STREAM_CAPTURE]->
 							substream->runtime;
 	check = runtime->format != cruntime->format ||
-		runtime->rate != cruntime->rate ||
+		(runtime->rate != cruntime->rate &&
+		 !loopback_can_resample(cable, runtime->format)) ||
 		runtime->channels != cruntime->channels;
 	if (!check)
 		return 0;
@@ -390,6 +423,7 @@ static int loopback_trigger(struct snd_pcm_substream *substream, int cmd)
 		dpcm->pcm_rate_shift = 0;
 		dpcm->last_drift = 0;
 		spin_lock(&cable->lock);	
+		cable->rs.step_base = 0;
 		cable->running |= stream;
 		cable->pause &= ~stream;
 		err = cable->ops->start(dpcm);
@@ -438,8 +472,13 @@ static void params_change(struct snd_pcm_substream *substream)
 	struct loopback_cable *cable = dpcm->cable;
 
 	cable->hw.formats = pcm_format_to_bits(runtime->format);
-	cable->hw.rate_min = runtime->rate;
-	cable->hw.rate_max = runtime->rate;
+	if (!loopback_can_resample(cable, runtime->format)) {
+		cable->hw.rate_min = runtime->rate;
+		cable->hw.rate_max = runtime->rate;
+	} else {
+		cable->hw.rate_min = loopback_pcm_hardware.rate_min;
+		cable->hw.rate_max = loopback_pcm_hardware.rate_max;
+	}
 	cable->hw.channels_min = runtime->channels;
 	cable->hw.channels_max = runtime->channels;
 
@@ -480,6 +519,8 @@ static int loopback_prepare(struct snd_pcm_substream *substream)
 	}
 
 	dpcm->irq_pos = 0;
+	dpcm->time_frac = 0;
+	dpcm->period_pos = 0;
 	dpcm->period_update_pending = 0;
 	dpcm->pcm_bps = bps;
 	dpcm->pcm_salign = salign;
@@ -571,6 +612,121 @@ static void copy_play_buf(struct loopback_pcm *play,
 	}
 }
 
+/*
+ * Rate adaptation for resample cables
+ *
+ * The capture data is interpolated linearly from the playback buffer at
+ * a 32.32 read head.  step is the number of playback frames consumed per
+ * capture frame; it starts at the ratio of both rates and then follows
+ * the drift between both ends, e.g. from different rate shift settings.
+ * The phase error is the distance of the read head from the playback
+ * position, fed back with a proportional and an integral term.
+ */
+#define RS_P_SHIFT	3
+#define RS_I_SHIFT	7
+
+static inline s32 rs_get(const void *buf, snd_pcm_format_t format,
+			 unsigned int idx)
+{
+	if (format == SNDRV_PCM_FORMAT_S16)
+		return ((const s16 *)buf)[idx];
+	return ((const s32 *)buf)[idx];
+}
+
+static inline void rs_put(void *buf, snd_pcm_format_t format,
+			  unsigned int idx, s32 val)
+{
+	if (format == SNDRV_PCM_FORMAT_S16)
+		((s16 *)buf)[idx] = val;
+	else
+		((s32 *)buf)[idx] = val;
+}
+
+static void resample_play_buf(struct loopback_cable *cable,
+			      struct loopback_pcm *play,
+			      struct loopback_pcm *capt,
+			      unsigned int in_bytes,
+			      unsigned int out_bytes)
+{
+	struct snd_pcm_runtime *runtime = play->substream->runtime;
+	struct snd_pcm_runtime *cruntime = capt->substream->runtime;
+	snd_pcm_format_t format = runtime->format;
+	unsigned int channels = runtime->channels;
+	unsigned int in_size = runtime->buffer_size;
+	unsigned int out_size = cruntime->buffer_size;
+	unsigned int in_frames = in_bytes / play->pcm_salign;
+	unsigned int out_frames = out_bytes / capt->pcm_salign;
+	unsigned int in_pos = play->buf_pos / play->pcm_salign;
+	unsigned int out_pos = capt->buf_pos / capt->pcm_salign;
+	unsigned int valid = out_frames;
+	unsigned int i, ch, s0, s1, d;
+	s64 p, err;
+	s32 a, b;
+	u32 frac;
+
+	if (!cable->rs.step_base) {
+		cable->rs.step_base = div_u64((u64)runtime->rate << 32,
+					      cruntime->rate);
+		cable->rs.step_adj = 0;
+		cable->rs.step = cable->rs.step_base;
+		cable->rs.offset = 0;
+	}
+
+	/* don't read past the end of a draining playback */
+	if (runtime->state == SNDRV_PCM_STATE_DRAINING &&
+	    snd_pcm_playback_hw_avail(runtime) < runtime->buffer_size) {
+		snd_pcm_uframes_t appl_ptr, appl_ptr1;
+
+		appl_ptr = appl_ptr1 = runtime->control->appl_ptr;
+		appl_ptr1 -= appl_ptr1 % runtime->buffer_size;
+		appl_ptr1 += in_pos;
+		if (appl_ptr < appl_ptr1)
+			appl_ptr1 -= runtime->buffer_size;
+		if (appl_ptr - appl_ptr1 < in_frames)
+			valid = div_u64((u64)out_frames * (appl_ptr - appl_ptr1),
+					in_frames);
+	}
+
+	for (i = 0; i < out_frames; i++) {
+		d = ((out_pos + i) % out_size) * channels;
+		if (i >= valid) {
+			for (ch = 0; ch < channels; ch++)
+				rs_put(cruntime->dma_area, format, d + ch, 0);
+			continue;
+		}
+		p = cable->rs.offset + (s64)i * cable->rs.step;
+		frac = (u32)p >> 16;
+		/* the read head stays well within one buffer of in_pos */
+		s0 = (in_pos + in_size + (int)(p >> 32)) % in_size;
+		s1 = (s0 + 1) % in_size;
+		for (ch = 0; ch < channels; ch++) {
+			a = rs_get(runtime->dma_area, format, s0 * channels + ch);
+			b = rs_get(runtime->dma_area, format, s1 * channels + ch);
+			rs_put(cruntime->dma_area, format, d + ch,
+			       a + ((((s64)b - a) * frac) >> 16));
+		}
+	}
+	if (out_frames)
+		capt->silent_size = 0;
+
+	/* the playback position moves on by in_frames, track it */
+	err = cable->rs.offset + (s64)out_frames * cable->rs.step -
+		((s64)in_frames << 32);
+	if (abs(err) > ((s64)runtime->period_size << 32)) {
+		/* lost track, e.g. after a pause; start over */
+		cable->rs.step_adj = 0;
+		cable->rs.step = cable->rs.step_base;
+		cable->rs.offset = 0;
+		return;
+	}
+	cable->rs.offset = err;
+	if (!out_frames)
+		return;
+	cable->rs.step_adj -= div_s64(err, (s64)out_frames << RS_I_SHIFT);
+	cable->rs.step = cable->rs.step_base + cable->rs.step_adj -
+		div_s64(err, (s64)out_frames << RS_P_SHIFT);
+}
+
 static inline unsigned int bytepos_delta(struct loopback_pcm *dpcm,
 					 unsigned int jiffies_delta)
 {
@@ -597,6 +753,36 @@ static inline void bytepos_finish(struct loopback_pcm *dpcm,
 	dpcm->buf_pos %= dpcm->pcm_buffer_size;
 }
 
+/*
+ * move both running ends of a cable over the same time interval
+ * call in cable->lock
+ */
+static void loopback_copy_both(struct loopback_cable *cable,
+			       unsigned int count1, unsigned int count2)
+{
+	struct loopback_pcm *dpcm_play =
+			cable->streams[SNDRV_PCM_STREAM_PLAYBACK];
+	struct loopback_pcm *dpcm_capt =
+			cable->streams[SNDRV_PCM_STREAM_CAPTURE];
+
+	if (dpcm_play->substream->runtime->rate !=
+	    dpcm_capt->substream->runtime->rate) {
+		resample_play_buf(cable, dpcm_play, dpcm_capt, count1, count2);
+		bytepos_finish(dpcm_play, count1);
+		bytepos_finish(dpcm_capt, count2);
+		return;
+	}
+	if (count1 < count2) {
+		dpcm_capt->last_drift = count2 - count1;
+		count1 = count2;
+	} else if (count1 > count2) {
+		dpcm_play->last_drift = count1 - count2;
+	}
+	copy_play_buf(dpcm_play, dpcm_capt, count1);
+	bytepos_finish(dpcm_play, count1);
+	bytepos_finish(dpcm_capt, count1);
+}
+
 /* call in cable->lock */
 static unsigned int loopback_jiffies_timer_pos_update
 		(struct loopback_cable *cable)
@@ -640,15 +826,7 @@ static unsigned int loopback_jiffies_timer_pos_update
 	/* note delta_capt == delta_play at this moment */
 	count1 = bytepos_delta(dpcm_play, delta_play);
 	count2 = bytepos_delta(dpcm_capt, delta_capt);
-	if (count1 < count2) {
-		dpcm_capt->last_drift = count2 - count1;
-		count1 = count2;
-	} else if (count1 > count2) {
-		dpcm_play->last_drift = count1 - count2;
-	}
-	copy_play_buf(dpcm_play, dpcm_capt, count1);
-	bytepos_finish(dpcm_play, count1);
-	bytepos_finish(dpcm_capt, count1);
+	loopback_copy_both(cable, count1, count2);
  unlock:
 	return running;
 }
@@ -673,6 +851,155 @@ static void loopback_jiffies_timer_function(struct timer_list *t)
 	spin_unlock_irqrestore(&dpcm->cable->lock, flags);
 }
 
+/*
+ * hrtimer source
+ *
+ * The positions are derived from the monotonic clock in nanoseconds, so
+ * they are exact whenever they are read; the timer only decides when the
+ * application is woken up.  This is once per period by default, or
+ * period_wakeups times per period so that an avail_min smaller than a
+ * period is honoured.  Streams with NO_PERIOD_WAKEUP don't run the timer
+ * at all and are only moved on by the pointer callback.
+ */
+
+/* call in cable->lock */
+static unsigned int loopback_hrtimer_bytes(struct loopback_pcm *dpcm,
+					   u64 delta_ns)
+{
+	struct snd_pcm_runtime *runtime = dpcm->substream->runtime;
+	unsigned int delta;
+	u32 rem;
+
+	if (dpcm->pcm_rate_shift != NO_PITCH)
+		delta_ns = div_u64(delta_ns * NO_PITCH, dpcm->pcm_rate_shift);
+	dpcm->time_frac += delta_ns * runtime->rate;
+	delta = div_u64_rem(dpcm->time_frac, NSEC_PER_SEC, &rem) *
+		dpcm->pcm_salign;
+	dpcm->time_frac = rem;
+	if (delta >= dpcm->last_drift)
+		delta -= dpcm->last_drift;
+	dpcm->last_drift = 0;
+	dpcm->period_pos += delta;
+	if (dpcm->period_pos >= dpcm->pcm_period_size) {
+		dpcm->period_pos %= dpcm->pcm_period_size;
+		dpcm->period_update_pending = 1;
+	}
+	return delta;
+}
+
+/* call in cable->lock */
+static unsigned int loopback_hrtimer_pos_update(struct loopback_cable *cable)
+{
+	struct loopback_pcm *dpcm_play =
+			cable->streams[SNDRV_PCM_STREAM_PLAYBACK];
+	struct loopback_pcm *dpcm_capt =
+			cable->streams[SNDRV_PCM_STREAM_CAPTURE];
+	u64 delta_play = 0, delta_capt = 0;
+	unsigned int running, count1, count2;
+	ktime_t now;
+
+	now = ktime_get();
+	running = cable->running ^ cable->pause;
+	if (running & (1 << SNDRV_PCM_STREAM_PLAYBACK)) {
+		delta_play = ktime_to_ns(ktime_sub(now, dpcm_play->last_time));
+		dpcm_play->last_time = now;
+	}
+
+	if (running & (1 << SNDRV_PCM_STREAM_CAPTURE)) {
+		delta_capt = ktime_to_ns(ktime_sub(now, dpcm_capt->last_time));
+		dpcm_capt->last_time = now;
+	}
+
+	if (delta_play > delta_capt) {
+		count1 = loopback_hrtimer_bytes(dpcm_play,
+						delta_play - delta_capt);
+		bytepos_finish(dpcm_play, count1);
+		delta_play = delta_capt;
+	} else if (delta_play < delta_capt) {
+		count1 = loopback_hrtimer_bytes(dpcm_capt,
+						delta_capt - delta_play);
+		clear_capture_buf(dpcm_capt, count1);
+		bytepos_finish(dpcm_capt, count1);
+		delta_capt = delta_play;
+	}
+
+	if (delta_play == 0 && delta_capt == 0)
+		return running;
+
+	/* note delta_capt == delta_play at this moment */
+	count1 = loopback_hrtimer_bytes(dpcm_play, delta_play);
+	count2 = loopback_hrtimer_bytes(dpcm_capt, delta_capt);
+	loopback_copy_both(cable, count1, count2);
+	return running;
+}
+
+/* call in cable->lock */
+static void loopback_hrtimer_set_interval(struct loopback_pcm *dpcm)
+{
+	struct snd_pcm_runtime *runtime = dpcm->substream->runtime;
+	u64 period_ns;
+
+	dpcm->pcm_rate_shift = get_rate_shift(dpcm);
+	period_ns = div_u64((u64)runtime->period_size * NSEC_PER_SEC,
+			    runtime->rate);
+	period_ns = div_u64(period_ns * dpcm->pcm_rate_shift, NO_PITCH);
+	dpcm->wakeup_interval =
+		ns_to_ktime(div_u64(period_ns, dpcm->loopback->period_wakeups));
+}
+
+/* call in cable->lock */
+static int loopback_hrtimer_start(struct loopback_pcm *dpcm)
+{
+	dpcm->last_time = ktime_get();
+	loopback_hrtimer_set_interval(dpcm);
+	if (!dpcm->substream->runtime->no_period_wakeup)
+		hrtimer_start(&dpcm->hrtimer, dpcm->wakeup_interval,
+			      HRTIMER_MODE_REL_SOFT);
+	return 0;
+}
+
+/* call in cable->lock */
+static int loopback_hrtimer_stop(struct loopback_pcm *dpcm)
+{
+	/* a callback waiting for cable->lock won't restart the timer */
+	hrtimer_try_to_cancel(&dpcm->hrtimer);
+	return 0;
+}
+
+static int loopback_hrtimer_stop_sync(struct loopback_pcm *dpcm)
+{
+	hrtimer_cancel(&dpcm->hrtimer);
+	return 0;
+}
+
+static enum hrtimer_restart loopback_hrtimer_function(struct hrtimer *timer)
+{
+	struct loopback_pcm *dpcm = container_of(timer, struct loopback_pcm,
+						 hrtimer);
+	unsigned long flags;
+	bool wakeup;
+
+	spin_lock_irqsave(&dpcm->cable->lock, flags);
+	if (!(loopback_hrtimer_pos_update(dpcm->cable) &
+			(1 << dpcm->substream->stream))) {
+		spin_unlock_irqrestore(&dpcm->cable->lock, flags);
+		return HRTIMER_NORESTART;
+	}
+	wakeup = dpcm->period_update_pending ||
+		 dpcm->loopback->period_wakeups > 1;
+	dpcm->period_update_pending = 0;
+	/* pick up rate shift changes, the position is up to date now */
+	if (get_rate_shift(dpcm) != dpcm->pcm_rate_shift)
+		loopback_hrtimer_set_interval(dpcm);
+	hrtimer_forward_now(timer, dpcm->wakeup_interval);
+	spin_unlock_irqrestore(&dpcm->cable->lock, flags);
+
+	/* need to unlock before calling below */
+	if (wakeup)
+		snd_pcm_period_elapsed(dpcm->substream);
+	return HRTIMER_RESTART;
+}
+
 /* call in cable->lock */
 static int loopback_snd_timer_check_resolution(struct snd_pcm_runtime *runtime,
 					       unsigned long resolution)
@@ -846,6 +1173,18 @@ static void loopback_jiffies_timer_dpcm_info(struct loopback_pcm *dpcm,
 	snd_iprintf(buffer, "    timer_expires:\t%lu\n", dpcm->timer.expires);
 }
 
+static void loopback_hrtimer_dpcm_info(struct loopback_pcm *dpcm,
+				       struct snd_info_buffer *buffer)
+{
+	snd_iprintf(buffer, "    update_pending:\t%u\n",
+		    dpcm->period_update_pending);
+	snd_iprintf(buffer, "    period_pos:\t\t%u\n", dpcm->period_pos);
+	snd_iprintf(buffer, "    wakeup_interval:\t%lld ns\n",
+		    ktime_to_ns(dpcm->wakeup_interval));
+	snd_iprintf(buffer, "    last_time:\t\t%lld (%llu)\n",
+		    ktime_to_ns(dpcm->last_time), ktime_get_ns());
+}
+
 static void loopback_snd_timer_dpcm_info(struct loopback_pcm *dpcm,
 					 struct snd_info_buffer *buffer)
 {
@@ -1031,6 +1370,24 @@ static const struct loopback_ops loopback_jiffies_timer_ops = {
 	.dpcm_info = loopback_jiffies_timer_dpcm_info,
 };
 
+static int loopback_hrtimer_open(struct loopback_pcm *dpcm)
+{
+	hrtimer_init(&dpcm->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	dpcm->hrtimer.function = loopback_hrtimer_function;
+
+	return 0;
+}
+
+static const struct loopback_ops loopback_hrtimer_ops = {
+	.open = loopback_hrtimer_open,
+	.start = loopback_hrtimer_start,
+	.stop = loopback_hrtimer_stop,
+	.stop_sync = loopback_hrtimer_stop_sync,
+	.close_substream = loopback_hrtimer_stop_sync,
+	.pos_update = loopback_hrtimer_pos_update,
+	.dpcm_info = loopback_hrtimer_dpcm_info,
+};
+
 static int loopback_parse_timer_id(const char *str,
 				   struct snd_timer_id *tid)
 {
@@ -1207,10 +1564,16 @@ static int loopback_open(struct snd_pcm_substream *substream)
 		}
 		spin_lock_init(&cable->lock);
 		cable->hw = loopback_pcm_hardware;
-		if (loopback->timer_source)
+		if (loopback->timer_source &&
+		    !strcmp(loopback->timer_source, "hrtimer")) {
+			cable->ops = &loopback_hrtimer_ops;
+			cable->resample = loopback->resample;
+		} else if (loopback->timer_source) {
 			cable->ops = &loopback_snd_timer_ops;
-		else
+		} else {
 			cable->ops = &loopback_jiffies_timer_ops;
+			cable->resample = loopback->resample;
+		}
 		loopback->cables[substream->number][dev] = cable;
 	}
 	dpcm->cable = cable;
@@ -1267,6 +1630,8 @@ static int loopback_open(struct snd_pcm_substream *substream)
 		runtime->hw = loopback_pcm_hardware;
 	else
 		runtime->hw = cable->hw;
+	if (cable->ops == &loopback_hrtimer_ops)
+		runtime->hw.info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
 
 	spin_lock_irq(&cable->lock);
 	cable->streams[substream->stream] = dpcm;
@@ -1637,6 +2002,8 @@ static void print_substream_info(struct snd_info_buffer *buffer,
 	snd_iprintf(buffer, "  valid: %u\n", cable->valid);
 	snd_iprintf(buffer, "  running: %u\n", cable->running);
 	snd_iprintf(buffer, "  pause: %u\n", cable->pause);
+	if (cable->resample)
+		snd_iprintf(buffer, "  resample_step: %lld\n", cable->rs.step);
 	print_dpcm_info(buffer, cable->streams[0], "Playback");
 	print_dpcm_info(buffer, cable->streams[1], "Capture");
 }
@@ -1726,6 +2093,9 @@ static int loopback_probe(struct platform_device *devptr)
 	
 	loopback->card = card;
 	loopback_set_timer_source(loopback, timer_source[dev]);
+	loopback->resample = resample[dev];
+	loopback->period_wakeups = clamp(period_wakeups[dev], 1,
+					 MAX_PERIOD_WAKEUPS);
 
 	mutex_init(&loopback->cable_lock);
 
@@ -14,6 +14,7 @@
 #include <linux/hrtimer.h>
 #include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/random.h>
 #include <sound/core.h>
 #include <sound/control.h>
 #include <sound/tlv.h>
@@ -56,6 +57,7 @@ static int mixer_volume_level_min = USE_MIXER_VOLUME_LEVEL_MIN;
 static int mixer_volume_level_max = USE_MIXER_VOLUME_LEVEL_MAX;
 #ifdef CONFIG_HIGH_RES_TIMERS
 static bool hrtimer = 1;
+static unsigned int hrtimer_jitter_us;
 #endif
 static bool fake_buffer = 1;
 
@@ -82,6 +84,8 @@ MODULE_PARM_DESC(fake_buffer, "Fake buffer allocations.");
 #ifdef CONFIG_HIGH_RES_TIMERS
 module_param(hrtimer, bool, 0644);
 MODULE_PARM_DESC(hrtimer, "Use hrtimer as the timer source.");
+module_param(hrtimer_jitter_us, uint, 0644);
+MODULE_PARM_DESC(hrtimer_jitter_us, "Random delay of up to this many us for each hrtimer period interrupt.");
 #endif
 
 static struct platform_device *devices[SNDRV_CARDS];
@@ -366,6 +370,7 @@ struct dummy_hrtimer_pcm {
 	const struct dummy_timer_ops *timer_ops;
 	ktime_t base_time;
 	ktime_t period_time;
+	ktime_t next_time;		/* next interrupt, before the jitter */
 	atomic_t running;
 	struct hrtimer timer;
 	struct snd_pcm_substream *substream;
@@ -374,6 +379,8 @@ struct dummy_hrtimer_pcm {
 static enum hrtimer_restart dummy_hrtimer_callback(struct hrtimer *timer)
 {
 	struct dummy_hrtimer_pcm *dpcm;
+	unsigned int jitter_us;
+	ktime_t now, expires;
 
 	dpcm = container_of(timer, struct dummy_hrtimer_pcm, timer);
 	if (!atomic_read(&dpcm->running))
@@ -386,7 +393,21 @@ static enum hrtimer_restart dummy_hrtimer_callback(struct hrtimer *timer)
 	if (!atomic_read(&dpcm->running))
 		return HRTIMER_NORESTART;
 
-	hrtimer_forward_now(timer, dpcm->period_time);
+	/*
+	 * The jitter only delays the interrupts, like the interrupt latency
+	 * of real hardware, so it doesn't add up over the periods and the
+	 * pointer keeps its pace.
+	 */
+	now = hrtimer_cb_get_time(timer);
+	do {
+		dpcm->next_time = ktime_add(dpcm->next_time, dpcm->period_time);
+	} while (!ktime_after(dpcm->next_time, now));
+	expires = dpcm->next_time;
+	jitter_us = READ_ONCE(hrtimer_jitter_us);
+	if (jitter_us)
+		expires = ktime_add_us(expires,
+				       get_random_u32_below(jitter_us + 1));
+	hrtimer_set_expires(timer, expires);
 	return HRTIMER_RESTART;
 }
 
@@ -395,6 +416,7 @@ static int dummy_hrtimer_start(struct snd_pcm_substream *substream)
 	struct dummy_hrtimer_pcm *dpcm = substream->runtime->private_data;
 
 	dpcm->base_time = hrtimer_cb_get_time(&dpcm->timer);
+	dpcm->next_time = ktime_add(dpcm->base_time, dpcm->period_time);
 	hrtimer_start(&dpcm->timer, dpcm->period_time, HRTIMER_MODE_REL_SOFT);
 	atomic_set(&dpcm->running, 1);
 	return 0;
@@ -440,6 +462,9 @@ static int dummy_hrtimer_prepare(struct snd_pcm_substream *substream)
 
 	dummy_hrtimer_sync(dpcm);
 	period = runtime->period_size;
+	/* only the pointer updates for the xrun and drain checks are needed */
+	if (runtime->no_period_wakeup)
+		period = max(runtime->buffer_size / 2, runtime->period_size);
 	rate = runtime->rate;
 	sec = period / rate;
 	period %= rate;
@@ -559,6 +584,10 @@ static int dummy_pcm_open(struct snd_pcm_substream *substream)
 	get_dummy_ops(substream) = ops;
 
 	runtime->hw = dummy->pcm_hw;
+#ifdef CONFIG_HIGH_RES_TIMERS
+	if (ops == &dummy_hrtimer_ops)
+		runtime->hw.info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+#endif
 	if (substream->pcm->device & 1) {
 		runtime->hw.info &= ~SNDRV_PCM_INFO_INTERLEAVED;
 		runtime->hw.info |= SNDRV_PCM_INFO_NONINTERLEAVED;
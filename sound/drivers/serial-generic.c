@@ -10,6 +10,7 @@
  * Generic serial MIDI driver using the serdev serial bus API for hardware interaction
  */
 
+#include <linux/bits.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
@@ -20,8 +21,10 @@
 #include <linux/serdev.h>
 #include <linux/serial_reg.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/dev_printk.h>
 
+#include <sound/control.h>
 #include <sound/core.h>
 #include <sound/rawmidi.h>
 #include <sound/initval.h>
@@ -33,6 +36,10 @@ MODULE_LICENSE("GPL");
 #define SERIAL_MODE_OUTPUT_OPEN	2
 #define SERIAL_MODE_INPUT_TRIGGERED	3
 #define SERIAL_MODE_OUTPUT_TRIGGERED	4
+#define SERIAL_MODE_THRU		5
+
+#define SERIAL_THRU_PORTS	32
+#define SERIAL_THRU_CHANNELS	16
 
 #define SERIAL_TX_STATE_ACTIVE	1
 #define SERIAL_TX_STATE_WAKEUP	2
@@ -51,14 +58,92 @@ struct snd_serial_generic {
 	struct work_struct tx_work;
 	unsigned long tx_state;
 
+	/* MIDI thru: routes are by serial controller number */
+	struct list_head thru_list;
+	u32 thru_routes;
+	u16 thru_channels;
+	spinlock_t tx_lock;		/* serdev writes and the state below */
+	u8 out_status;			/* running status on the wire */
+	u8 app_status;			/* running status of the application */
+	u8 app_left;			/* data bytes its message still needs */
+	bool app_sysex;
+	u8 thru_len;			/* thru held back for the application */
+	u8 thru_buf[32];
+	u8 in_status;			/* running status of the input */
+	u8 in_len;
+	u8 in_pos;
+	u8 in_buf[3];
+	bool in_sysex;
 };
 
+/*
+ * Ports that can take part in MIDI thru. The mutex serialises route changes
+ * and the serdev opens they cause; the spinlock protects the list and the
+ * routes against the receive path.
+ */
+static LIST_HEAD(snd_serial_generic_thru_devs);
+static DEFINE_MUTEX(snd_serial_generic_thru_mutex);
+static DEFINE_SPINLOCK(snd_serial_generic_thru_lock);
+
 static void snd_serial_generic_tx_wakeup(struct snd_serial_generic *drvdata)
 {
 	if (test_and_set_bit(SERIAL_TX_STATE_ACTIVE, &drvdata->tx_state))
 		set_bit(SERIAL_TX_STATE_WAKEUP, &drvdata->tx_state);
 
-	schedule_work(&drvdata->tx_work);
+	/* Don't let MIDI output queue up behind the other system work */
+	queue_work(system_highpri_wq, &drvdata->tx_work);
+}
+
+static int snd_serial_generic_msg_len(u8 status);
+
+/* Thru can only go out between the application's messages */
+static bool snd_serial_generic_app_busy(struct snd_serial_generic *drvdata)
+{
+	return drvdata->app_left || drvdata->app_sysex;
+}
+
+/* Follows the messages written by the application, no matter their split */
+static void snd_serial_generic_app_parse(struct snd_serial_generic *drvdata,
+					 const u8 *buf, int len)
+{
+	int i, n;
+
+	for (i = 0; i < len; i++) {
+		u8 c = buf[i];
+
+		if (c >= 0xf8)
+			continue;
+
+		if (c & 0x80) {
+			n = snd_serial_generic_msg_len(c);
+			drvdata->app_sysex = c == 0xf0;
+			drvdata->app_status = c < 0xf0 ? c : 0;
+			drvdata->app_left = n ? n - 1 : 0;
+			drvdata->out_status = drvdata->app_status;
+		} else if (drvdata->app_sysex) {
+			continue;
+		} else if (drvdata->app_left) {
+			drvdata->app_left--;
+		} else if (drvdata->app_status) {
+			/* running status, this byte started a new message */
+			n = snd_serial_generic_msg_len(drvdata->app_status);
+			drvdata->app_left = n - 2;
+		}
+	}
+}
+
+/* Sends the thru messages held back, or drops them if they don't fit */
+static void snd_serial_generic_thru_flush(struct snd_serial_generic *drvdata)
+{
+	if (!drvdata->thru_len)
+		return;
+
+	if (serdev_device_write_room(drvdata->serdev) >= drvdata->thru_len)
+		serdev_device_write_buf(drvdata->serdev, drvdata->thru_buf,
+					drvdata->thru_len);
+	drvdata->thru_len = 0;
+	/* The application's next data byte gets its status back */
+	drvdata->out_status = 0;
 }
 
 #define INTERNAL_BUF_SIZE 256
@@ -70,6 +155,7 @@ static void snd_serial_generic_tx_work(struct work_struct *work)
 	struct snd_serial_generic *drvdata = container_of(work, struct snd_serial_generic,
 						   tx_work);
 	struct snd_rawmidi_substream *substream = drvdata->midi_output;
+	unsigned long flags;
 
 	clear_bit(SERIAL_TX_STATE_WAKEUP, &drvdata->tx_state);
 
@@ -78,8 +164,26 @@ static void snd_serial_generic_tx_work(struct work_struct *work)
 		if (!test_bit(SERIAL_MODE_OUTPUT_OPEN, &drvdata->filemode))
 			break;
 
+		spin_lock_irqsave(&drvdata->tx_lock, flags);
 		num_bytes = snd_rawmidi_transmit_peek(substream, buf, INTERNAL_BUF_SIZE);
-		num_bytes = serdev_device_write_buf(drvdata->serdev, buf, num_bytes);
+		/* Thru may have changed the running status on the wire */
+		if (num_bytes && buf[0] < 0x80 &&
+		    !snd_serial_generic_app_busy(drvdata) &&
+		    drvdata->app_status &&
+		    drvdata->app_status != drvdata->out_status) {
+			if (serdev_device_write_buf(drvdata->serdev,
+						    &drvdata->app_status, 1))
+				drvdata->out_status = drvdata->app_status;
+			else
+				num_bytes = 0;
+		}
+		if (num_bytes)
+			num_bytes = serdev_device_write_buf(drvdata->serdev, buf,
+							    num_bytes);
+		snd_serial_generic_app_parse(drvdata, buf, num_bytes);
+		if (!snd_serial_generic_app_busy(drvdata))
+			snd_serial_generic_thru_flush(drvdata);
+		spin_unlock_irqrestore(&drvdata->tx_lock, flags);
 
 		if (!num_bytes)
 			break;
@@ -100,17 +204,168 @@ static void snd_serial_generic_write_wakeup(struct serdev_device *serdev)
 	snd_serial_generic_tx_wakeup(drvdata);
 }
 
+/* Controllers past the last route can't be a destination */
+static u32 snd_serial_generic_thru_bit(struct snd_serial_generic *drvdata)
+{
+	int nr = drvdata->serdev->ctrl->nr;
+
+	return nr < SERIAL_THRU_PORTS ? BIT(nr) : 0;
+}
+
+/*
+ * Sends a whole message, or drops it if it doesn't fit. While the
+ * application is in the middle of a message, anything but realtime
+ * messages is held back until the application's message is complete.
+ */
+static void snd_serial_generic_thru_write(struct snd_serial_generic *drvdata,
+					  const u8 *msg, int len)
+{
+	u8 status = msg[0];
+
+	spin_lock(&drvdata->tx_lock);
+	if (!test_bit(SERIAL_MODE_THRU, &drvdata->filemode))
+		goto unlock;
+
+	if (status < 0xf8 && snd_serial_generic_app_busy(drvdata)) {
+		if (drvdata->thru_len + len <= sizeof(drvdata->thru_buf)) {
+			memcpy(drvdata->thru_buf + drvdata->thru_len, msg, len);
+			drvdata->thru_len += len;
+		}
+		goto unlock;
+	}
+	snd_serial_generic_thru_flush(drvdata);
+
+	if (status >= 0x80 && status < 0xf0 && status == drvdata->out_status) {
+		msg++;
+		len--;
+	}
+	if (serdev_device_write_room(drvdata->serdev) < len)
+		goto unlock;
+	serdev_device_write_buf(drvdata->serdev, msg, len);
+
+	/* Realtime messages leave the running status alone */
+	if (status >= 0x80 && status < 0xf8)
+		drvdata->out_status = status < 0xf0 ? status : 0;
+unlock:
+	spin_unlock(&drvdata->tx_lock);
+}
+
+static void snd_serial_generic_thru_send(struct snd_serial_generic *src,
+					 const u8 *msg, int len)
+{
+	struct snd_serial_generic *dst;
+	unsigned long flags;
+
+	if (msg[0] >= 0x80 && msg[0] < 0xf0 &&
+	    !(READ_ONCE(src->thru_channels) & BIT(msg[0] & 0x0f)))
+		return;
+
+	spin_lock_irqsave(&snd_serial_generic_thru_lock, flags);
+	list_for_each_entry(dst, &snd_serial_generic_thru_devs, thru_list) {
+		if (src->thru_routes & snd_serial_generic_thru_bit(dst))
+			snd_serial_generic_thru_write(dst, msg, len);
+	}
+	spin_unlock_irqrestore(&snd_serial_generic_thru_lock, flags);
+}
+
+static int snd_serial_generic_msg_len(u8 status)
+{
+	switch (status & 0xf0) {
+	case 0xc0:
+	case 0xd0:
+		return 2;
+	case 0xf0:
+		break;
+	default:
+		return 3;
+	}
+
+	switch (status) {
+	case 0xf1:
+	case 0xf3:
+		return 2;
+	case 0xf2:
+		return 3;
+	case 0xf6:
+		return 1;
+	default:
+		return 0;	/* undefined, dropped with its data */
+	}
+}
+
+/*
+ * Splits the input into messages, so that the ports merging into an output
+ * don't break up each other's messages there. SysEx is passed on as it
+ * arrives and isn't filtered by channel.
+ */
+static void snd_serial_generic_thru_receive(struct snd_serial_generic *drvdata,
+					    const u8 *buf, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		u8 c = buf[i];
+
+		if (c >= 0xf8) {
+			snd_serial_generic_thru_send(drvdata, &c, 1);
+			continue;
+		}
+
+		if (c & 0x80) {
+			if (c == 0xf7 && !drvdata->in_sysex)
+				continue;
+			drvdata->in_sysex = c == 0xf0;
+			if (c == 0xf0 || c == 0xf7) {
+				drvdata->in_status = 0;
+				snd_serial_generic_thru_send(drvdata, &c, 1);
+				continue;
+			}
+
+			drvdata->in_status = c;
+			drvdata->in_len = snd_serial_generic_msg_len(c);
+			drvdata->in_pos = 1;
+			drvdata->in_buf[0] = c;
+		} else if (drvdata->in_sysex) {
+			snd_serial_generic_thru_send(drvdata, &c, 1);
+			continue;
+		} else if (drvdata->in_status) {
+			drvdata->in_buf[drvdata->in_pos++] = c;
+		} else {
+			continue;
+		}
+
+		if (drvdata->in_pos < drvdata->in_len)
+			continue;
+
+		if (drvdata->in_len)
+			snd_serial_generic_thru_send(drvdata, drvdata->in_buf,
+						     drvdata->in_len);
+		/* Only channel messages have running status */
+		drvdata->in_pos = 1;
+		if (drvdata->in_status >= 0xf0)
+			drvdata->in_status = 0;
+	}
+}
+
 static int snd_serial_generic_receive_buf(struct serdev_device *serdev,
 				const unsigned char *buf, size_t count)
 {
-	int ret;
+	int ret = 0;
 	struct snd_serial_generic *drvdata = serdev_device_get_drvdata(serdev);
 
-	if (!test_bit(SERIAL_MODE_INPUT_OPEN, &drvdata->filemode))
-		return 0;
+	if (test_bit(SERIAL_MODE_INPUT_OPEN, &drvdata->filemode)) {
+		ret = snd_rawmidi_receive(drvdata->midi_input, buf, count);
+		if (ret < 0)
+			ret = 0;
+	}
+
+	/* Thru doesn't wait for a slow reader */
+	if (test_bit(SERIAL_MODE_THRU, &drvdata->filemode)) {
+		snd_serial_generic_thru_receive(drvdata, buf, count);
+		ret = count;
+	}
 
-	ret = snd_rawmidi_receive(drvdata->midi_input, buf, count);
-	return ret < 0 ? 0 : ret;
+	return ret;
 }
 
 static const struct serdev_device_ops snd_serial_generic_serdev_device_ops = {
@@ -208,12 +463,24 @@ static int snd_serial_generic_output_open(struct snd_rawmidi_substream *substrea
 static int snd_serial_generic_output_close(struct snd_rawmidi_substream *substream)
 {
 	struct snd_serial_generic *drvdata = substream->rmidi->card->private_data;
+	unsigned long flags;
 
 	dev_dbg(drvdata->card->dev, "Closing output for card %s\n",
 		drvdata->card->shortname);
 
 	clear_bit(SERIAL_MODE_OUTPUT_OPEN, &drvdata->filemode);
 	clear_bit(SERIAL_MODE_OUTPUT_TRIGGERED, &drvdata->filemode);
+	cancel_work_sync(&drvdata->tx_work);
+
+	/* Whatever message the application left unfinished, thru goes on */
+	spin_lock_irqsave(&drvdata->tx_lock, flags);
+	drvdata->app_status = 0;
+	drvdata->app_left = 0;
+	drvdata->app_sysex = false;
+	if (test_bit(SERIAL_MODE_THRU, &drvdata->filemode))
+		snd_serial_generic_thru_flush(drvdata);
+	drvdata->thru_len = 0;
+	spin_unlock_irqrestore(&drvdata->tx_lock, flags);
 
 	if (!drvdata->filemode)
 		serdev_device_close(drvdata->serdev);
@@ -259,6 +526,194 @@ static const struct snd_rawmidi_ops snd_serial_generic_input = {
 	.trigger =	snd_serial_generic_input_trigger,
 };
 
+/*
+ * Keeps the serdev open for the ports that are the source or destination
+ * of a route, whether or not their rawmidi substreams are open.
+ */
+static void snd_serial_generic_thru_update(void)
+{
+	struct snd_serial_generic *drvdata, *src;
+	unsigned long flags;
+	bool used;
+	u32 bit;
+	int err;
+
+	lockdep_assert_held(&snd_serial_generic_thru_mutex);
+
+	list_for_each_entry(drvdata, &snd_serial_generic_thru_devs, thru_list) {
+		bit = snd_serial_generic_thru_bit(drvdata);
+		used = drvdata->thru_routes;
+		list_for_each_entry(src, &snd_serial_generic_thru_devs, thru_list)
+			used |= src->thru_routes & bit;
+
+		if (used == test_bit(SERIAL_MODE_THRU, &drvdata->filemode))
+			continue;
+
+		mutex_lock(&drvdata->rmidi->open_mutex);
+		if (used) {
+			err = snd_serial_generic_ensure_serdev_open(drvdata);
+			if (err < 0)
+				dev_warn(drvdata->card->dev,
+					 "MIDI thru can't open the serial port of card %s: %d\n",
+					 drvdata->card->shortname, err);
+			else
+				set_bit(SERIAL_MODE_THRU, &drvdata->filemode);
+		} else {
+			spin_lock_irqsave(&drvdata->tx_lock, flags);
+			clear_bit(SERIAL_MODE_THRU, &drvdata->filemode);
+			spin_unlock_irqrestore(&drvdata->tx_lock, flags);
+			if (!drvdata->filemode)
+				serdev_device_close(drvdata->serdev);
+		}
+		mutex_unlock(&drvdata->rmidi->open_mutex);
+	}
+}
+
+static int snd_serial_generic_thru_info(struct snd_kcontrol *kcontrol,
+					struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_BOOLEAN;
+	uinfo->count = kcontrol->private_value;
+	uinfo->value.integer.min = 0;
+	uinfo->value.integer.max = 1;
+	return 0;
+}
+
+static int snd_serial_generic_thru_route_get(struct snd_kcontrol *kcontrol,
+					     struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_serial_generic *drvdata = snd_kcontrol_chip(kcontrol);
+	int i;
+
+	for (i = 0; i < SERIAL_THRU_PORTS; i++)
+		ucontrol->value.integer.value[i] =
+			!!(drvdata->thru_routes & BIT(i));
+	return 0;
+}
+
+static int snd_serial_generic_thru_route_put(struct snd_kcontrol *kcontrol,
+					     struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_serial_generic *drvdata = snd_kcontrol_chip(kcontrol);
+	unsigned long flags;
+	u32 routes = 0;
+	int i, changed;
+
+	for (i = 0; i < SERIAL_THRU_PORTS; i++)
+		if (ucontrol->value.integer.value[i])
+			routes |= BIT(i);
+
+	mutex_lock(&snd_serial_generic_thru_mutex);
+	changed = routes != drvdata->thru_routes;
+	if (changed) {
+		spin_lock_irqsave(&snd_serial_generic_thru_lock, flags);
+		drvdata->thru_routes = routes;
+		spin_unlock_irqrestore(&snd_serial_generic_thru_lock, flags);
+		snd_serial_generic_thru_update();
+	}
+	mutex_unlock(&snd_serial_generic_thru_mutex);
+
+	return changed;
+}
+
+static int snd_serial_generic_thru_channel_get(struct snd_kcontrol *kcontrol,
+					       struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_serial_generic *drvdata = snd_kcontrol_chip(kcontrol);
+	int i;
+
+	for (i = 0; i < SERIAL_THRU_CHANNELS; i++)
+		ucontrol->value.integer.value[i] =
+			!!(drvdata->thru_channels & BIT(i));
+	return 0;
+}
+
+static int snd_serial_generic_thru_channel_put(struct snd_kcontrol *kcontrol,
+					       struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_serial_generic *drvdata = snd_kcontrol_chip(kcontrol);
+	u16 channels = 0;
+	int i;
+
+	for (i = 0; i < SERIAL_THRU_CHANNELS; i++)
+		if (ucontrol->value.integer.value[i])
+			channels |= BIT(i);
+
+	if (channels == drvdata->thru_channels)
+		return 0;
+	WRITE_ONCE(drvdata->thru_channels, channels);
+	return 1;
+}
+
+static const struct snd_kcontrol_new snd_serial_generic_thru_controls[] = {
+	{
+		.iface = SNDRV_CTL_ELEM_IFACE_RAWMIDI,
+		.name = "MIDI Thru Route",
+		.info = snd_serial_generic_thru_info,
+		.get = snd_serial_generic_thru_route_get,
+		.put = snd_serial_generic_thru_route_put,
+		.private_value = SERIAL_THRU_PORTS,
+	},
+	{
+		.iface = SNDRV_CTL_ELEM_IFACE_RAWMIDI,
+		.name = "MIDI Thru Channel Switch",
+		.info = snd_serial_generic_thru_info,
+		.get = snd_serial_generic_thru_channel_get,
+		.put = snd_serial_generic_thru_channel_put,
+		.private_value = SERIAL_THRU_CHANNELS,
+	},
+};
+
+static void snd_serial_generic_thru_remove(void *data)
+{
+	struct snd_serial_generic *drvdata = data;
+	unsigned long flags;
+	bool closing;
+
+	mutex_lock(&snd_serial_generic_thru_mutex);
+	spin_lock_irqsave(&snd_serial_generic_thru_lock, flags);
+	list_del(&drvdata->thru_list);
+	drvdata->thru_routes = 0;
+	spin_unlock_irqrestore(&snd_serial_generic_thru_lock, flags);
+	snd_serial_generic_thru_update();
+
+	/* No longer on the list, so not closed by the update */
+	mutex_lock(&drvdata->rmidi->open_mutex);
+	spin_lock_irqsave(&drvdata->tx_lock, flags);
+	closing = test_and_clear_bit(SERIAL_MODE_THRU, &drvdata->filemode);
+	spin_unlock_irqrestore(&drvdata->tx_lock, flags);
+	if (closing && !drvdata->filemode)
+		serdev_device_close(drvdata->serdev);
+	mutex_unlock(&drvdata->rmidi->open_mutex);
+	mutex_unlock(&snd_serial_generic_thru_mutex);
+}
+
+static int snd_serial_generic_thru_init(struct snd_serial_generic *drvdata)
+{
+	unsigned long flags;
+	int i, err;
+
+	spin_lock_init(&drvdata->tx_lock);
+	drvdata->thru_channels = GENMASK(SERIAL_THRU_CHANNELS - 1, 0);
+
+	for (i = 0; i < ARRAY_SIZE(snd_serial_generic_thru_controls); i++) {
+		err = snd_ctl_add(drvdata->card,
+				  snd_ctl_new1(&snd_serial_generic_thru_controls[i],
+					       drvdata));
+		if (err < 0)
+			return err;
+	}
+
+	mutex_lock(&snd_serial_generic_thru_mutex);
+	spin_lock_irqsave(&snd_serial_generic_thru_lock, flags);
+	list_add_tail(&drvdata->thru_list, &snd_serial_generic_thru_devs);
+	spin_unlock_irqrestore(&snd_serial_generic_thru_lock, flags);
+	mutex_unlock(&snd_serial_generic_thru_mutex);
+
+	return devm_add_action_or_reset(&drvdata->serdev->dev,
+					snd_serial_generic_thru_remove, drvdata);
+}
+
 static void snd_serial_generic_parse_dt(struct serdev_device *serdev,
 				struct snd_serial_generic *drvdata)
 {
@@ -349,6 +804,10 @@ static int snd_serial_generic_probe(struct serdev_device *serdev)
 	serdev_device_set_client_ops(serdev, &snd_serial_generic_serdev_device_ops);
 	serdev_device_set_drvdata(drvdata->serdev, drvdata);
 
+	err = snd_serial_generic_thru_init(drvdata);
+	if (err < 0)
+		return err;
+
 	err = snd_card_register(card);
 	if (err < 0)
 		return err;
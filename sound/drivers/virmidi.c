@@ -8,7 +8,7 @@
 /*
  * VIRTUAL RAW MIDI DEVICE CARDS
  *
- * This dummy card contains up to 4 virtual rawmidi devices.
+ * This dummy card contains up to 8 virtual rawmidi devices.
  * They are not real rawmidi devices but just associated with sequencer
  * clients, so that any input/output sources can be connected as a raw
  * MIDI device arbitrary.
@@ -33,6 +33,7 @@
 #include <linux/platform_device.h>
 #include <linux/module.h>
 #include <sound/core.h>
+#include <sound/rawmidi.h>
 #include <sound/seq_kernel.h>
 #include <sound/seq_virmidi.h>
 #include <sound/initval.h>
@@ -44,7 +45,7 @@ MODULE_AUTHOR("Takashi Iwai <tiwai@suse.de>");
 MODULE_DESCRIPTION("Dummy soundcard for virtual rawmidi devices");
 MODULE_LICENSE("GPL");
 
-#define MAX_MIDI_DEVICES	4
+#define MAX_MIDI_DEVICES	SNDRV_RAWMIDI_DEVICES
 
 static int index[SNDRV_CARDS] = SNDRV_DEFAULT_IDX;	/* Index 0-MAX */
 static char *id[SNDRV_CARDS] = SNDRV_DEFAULT_STR;	/* ID for this card */
@@ -58,7 +59,7 @@ MODULE_PARM_DESC(id, "ID string for virmidi soundcard.");
 module_param_array(enable, bool, NULL, 0444);
 MODULE_PARM_DESC(enable, "Enable this soundcard.");
 module_param_array(midi_devs, int, NULL, 0444);
-MODULE_PARM_DESC(midi_devs, "MIDI devices # (1-4)");
+MODULE_PARM_DESC(midi_devs, "MIDI devices # (1-8)");
 
 struct snd_card_virmidi {
 	struct snd_card *card;
@@ -944,6 +944,7 @@ static struct snd_soc_card snd_allo_piano_dac = {
 	.num_links = ARRAY_SIZE(snd_allo_piano_dac_dai),
 	.controls = allo_piano_controls,
 	.num_controls = ARRAY_SIZE(allo_piano_controls),
+	.parallel_dapm = 1,
 };
 
 static int snd_allo_piano_dac_probe(struct platform_device *pdev)
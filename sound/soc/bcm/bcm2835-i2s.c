@@ -29,6 +29,7 @@
 #include <linux/device.h>
 #include <linux/init.h>
 #include <linux/io.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/slab.h>
 
@@ -107,6 +108,9 @@
 /* Frame length register is 10 bit, maximum length 1024 */
 #define BCM2835_I2S_MAX_FRAME_LENGTH	1024
 
+/* Range of the bit clock trim, in ppm */
+#define BCM2835_I2S_MAX_CLK_TRIM	1000
+
 /* General device struct */
 struct bcm2835_i2s_dev {
 	struct device				*dev;
@@ -122,8 +126,19 @@ struct bcm2835_i2s_dev {
 	struct clk				*clk;
 	bool					clk_prepared;
 	int					clk_rate;
+	int					clk_trim_ppm;
+
+	struct snd_pcm_substream		*substream[2];
+	uint32_t				start_pending;
 };
 
+/* Nominal bit clock rate adjusted by the trim set from userspace */
+static unsigned long bcm2835_i2s_trimmed_rate(struct bcm2835_i2s_dev *dev,
+					      int rate)
+{
+	return rate + div_s64((s64)rate * dev->clk_trim_ppm, 1000000);
+}
+
 static void bcm2835_i2s_start_clock(struct bcm2835_i2s_dev *dev)
 {
 	unsigned int provider = dev->fmt & SND_SOC_DAIFMT_CLOCK_PROVIDER_MASK;
@@ -260,12 +275,19 @@ static int bcm2835_i2s_set_dai_tdm_slot(struct snd_soc_dai *dai,
 		tx_mask &= GENMASK(slots - 1, 0);
 
 		/*
-		 * The driver is limited to 2-channel setups.
-		 * Check that exactly 2 bits are set in the masks.
+		 * The PCM block has exactly two channel position
+		 * registers per direction, so only two slots of a
+		 * TDM frame can be transferred. The DMA only feeds
+		 * the FIFO and can't change the positions within a
+		 * frame. Check that exactly 2 bits are set in the masks.
 		 */
 		if (hweight_long((unsigned long) rx_mask) != 2
-		    || hweight_long((unsigned long) tx_mask) != 2)
+		    || hweight_long((unsigned long) tx_mask) != 2) {
+			dev_err(dev->dev,
+				"Only 2 TDM slots can be used per direction (rx 0x%x tx 0x%x)\n",
+				rx_mask, tx_mask);
 			return -EINVAL;
+		}
 
 		if (slots * width > BCM2835_I2S_MAX_FRAME_LENGTH)
 			return -EINVAL;
@@ -417,7 +439,9 @@ static int bcm2835_i2s_hw_params(struct snd_pcm_substream *substream,
 			bcm2835_i2s_stop_clock(dev);
 
 		if (dev->clk_rate != bclk_rate) {
-			ret = clk_set_rate(dev->clk, bclk_rate);
+			ret = clk_set_rate(dev->clk,
+					   bcm2835_i2s_trimmed_rate(dev,
+								    bclk_rate));
 			if (ret)
 				return ret;
 			dev->clk_rate = bclk_rate;
@@ -650,12 +674,53 @@ static void bcm2835_i2s_stop(struct bcm2835_i2s_dev *dev,
 
 	regmap_update_bits(dev->i2s_regmap,
 			BCM2835_I2S_CS_A_REG, mask, 0);
+	dev->start_pending &= ~mask;
 
 	/* Stop also the clock when not SND_SOC_DAIFMT_CONT */
 	if (!snd_soc_dai_active(dai) && !(dev->fmt & SND_SOC_DAIFMT_CONT))
 		bcm2835_i2s_stop_clock(dev);
 }
 
+/*
+ * If playback and capture are linked with snd_pcm_link() they are started
+ * by the same trigger action, one after the other. Hold back the first
+ * one and switch on both directions with a single register write when
+ * the second one arrives, so the offset between them is always the same.
+ */
+static bool bcm2835_i2s_defer_start(struct bcm2835_i2s_dev *dev,
+				    struct snd_pcm_substream *substream,
+				    uint32_t mask)
+{
+	struct snd_pcm_substream *other = dev->substream[substream->stream ^ 1];
+
+	if (dev->start_pending || !other || !snd_pcm_stream_linked(substream))
+		return false;
+
+	if (other->group != substream->group ||
+	    other->runtime->state != SNDRV_PCM_STATE_PREPARED)
+		return false;
+
+	dev->start_pending = mask;
+
+	return true;
+}
+
+static void bcm2835_i2s_wait_tx_fill(struct bcm2835_i2s_dev *dev)
+{
+	int timeout = 1000;
+	uint32_t csreg;
+
+	/* Give the DMA a chance to fill the FIFO above the threshold */
+	while (--timeout) {
+		regmap_read(dev->i2s_regmap, BCM2835_I2S_CS_A_REG, &csreg);
+		if (!(csreg & BCM2835_I2S_TXW))
+			break;
+	}
+
+	if (!timeout)
+		dev_dbg(dev->dev, "TX FIFO not filled before linked start\n");
+}
+
 static int bcm2835_i2s_trigger(struct snd_pcm_substream *substream, int cmd,
 			       struct snd_soc_dai *dai)
 {
@@ -673,6 +738,17 @@ static int bcm2835_i2s_trigger(struct snd_pcm_substream *substream, int cmd,
 		else
 			mask = BCM2835_I2S_TXON;
 
+		if (cmd == SNDRV_PCM_TRIGGER_START) {
+			if (bcm2835_i2s_defer_start(dev, substream, mask))
+				break;
+
+			if (dev->start_pending) {
+				mask |= dev->start_pending;
+				dev->start_pending = 0;
+				bcm2835_i2s_wait_tx_fill(dev);
+			}
+		}
+
 		regmap_update_bits(dev->i2s_regmap,
 				BCM2835_I2S_CS_A_REG, mask, mask);
 		break;
@@ -694,6 +770,8 @@ static int bcm2835_i2s_startup(struct snd_pcm_substream *substream,
 {
 	struct bcm2835_i2s_dev *dev = snd_soc_dai_get_drvdata(dai);
 
+	dev->substream[substream->stream] = substream;
+
 	if (snd_soc_dai_active(dai))
 		return 0;
 
@@ -720,6 +798,7 @@ static void bcm2835_i2s_shutdown(struct snd_pcm_substream *substream,
 	struct bcm2835_i2s_dev *dev = snd_soc_dai_get_drvdata(dai);
 
 	bcm2835_i2s_stop(dev, substream, dai);
+	dev->substream[substream->stream] = NULL;
 
 	/* If both streams are stopped, disable module and clock */
 	if (snd_soc_dai_active(dai))
@@ -819,8 +898,72 @@ static const struct regmap_config bcm2835_regmap_config = {
 	.cache_type = REGCACHE_RBTREE,
 };
 
+static int bcm2835_i2s_clk_trim_info(struct snd_kcontrol *kcontrol,
+				     struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+	uinfo->value.integer.min = -BCM2835_I2S_MAX_CLK_TRIM;
+	uinfo->value.integer.max = BCM2835_I2S_MAX_CLK_TRIM;
+	return 0;
+}
+
+static int bcm2835_i2s_clk_trim_get(struct snd_kcontrol *kcontrol,
+				    struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct bcm2835_i2s_dev *dev = snd_soc_component_get_drvdata(component);
+
+	ucontrol->value.integer.value[0] = dev->clk_trim_ppm;
+	return 0;
+}
+
+/*
+ * Trim the bit clock by a few ppm, e.g. to follow an external clock.
+ * Small changes only move the clock's fractional divider, which is
+ * applied while the clock keeps running, so there is no audible glitch.
+ */
+static int bcm2835_i2s_clk_trim_put(struct snd_kcontrol *kcontrol,
+				    struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct bcm2835_i2s_dev *dev = snd_soc_component_get_drvdata(component);
+	long ppm = ucontrol->value.integer.value[0];
+	int ret;
+
+	if (ppm < -BCM2835_I2S_MAX_CLK_TRIM || ppm > BCM2835_I2S_MAX_CLK_TRIM)
+		return -EINVAL;
+	if (ppm == dev->clk_trim_ppm)
+		return 0;
+
+	dev->clk_trim_ppm = ppm;
+
+	if (dev->clk_rate) {
+		ret = clk_set_rate(dev->clk,
+				   bcm2835_i2s_trimmed_rate(dev, dev->clk_rate));
+		if (ret)
+			return ret;
+	}
+
+	return 1;
+}
+
+static const struct snd_kcontrol_new bcm2835_i2s_controls[] = {
+	{
+		.iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name = "I2S Clock Trim PPM",
+		.info = bcm2835_i2s_clk_trim_info,
+		.get = bcm2835_i2s_clk_trim_get,
+		.put = bcm2835_i2s_clk_trim_put,
+	},
+};
+
 static const struct snd_soc_component_driver bcm2835_i2s_component = {
 	.name			= "bcm2835-i2s-comp",
+	.controls		= bcm2835_i2s_controls,
+	.num_controls		= ARRAY_SIZE(bcm2835_i2s_controls),
 	.legacy_dai_naming	= 1,
 };
 
@@ -871,12 +1014,16 @@ static int bcm2835_i2s_probe(struct platform_device *pdev)
 
 	/*
 	 * Set the PACK flag to enable S16_LE support (2 S16_LE values
-	 * packed into 32-bit transfers).
+	 * packed into 32-bit transfers). The DMA controller reads back
+	 * its position at any time, so the stream can also run without
+	 * period interrupts.
 	 */
 	dev->dma_data[SNDRV_PCM_STREAM_PLAYBACK].flags =
-		SND_DMAENGINE_PCM_DAI_FLAG_PACK;
+		SND_DMAENGINE_PCM_DAI_FLAG_PACK |
+		SND_DMAENGINE_PCM_DAI_FLAG_NO_PERIOD_WAKEUP;
 	dev->dma_data[SNDRV_PCM_STREAM_CAPTURE].flags =
-		SND_DMAENGINE_PCM_DAI_FLAG_PACK;
+		SND_DMAENGINE_PCM_DAI_FLAG_PACK |
+		SND_DMAENGINE_PCM_DAI_FLAG_NO_PERIOD_WAKEUP;
 
 	/* Store the pdev */
 	dev->dev = &pdev->dev;
@@ -29,6 +29,7 @@
 #include <linux/interrupt.h>
 #include <linux/kfifo.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
 
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -243,7 +244,16 @@ static struct work_struct pisnd_work_process;
 
 static void pisnd_work_handler(struct work_struct *work);
 
+/* The MCU exchanges 2 words per chip select. */
+enum { TRANSFER_SIZE = 4 };
+/* Frames sent in one SPI message. */
+enum { TRANSFER_BATCH = 8 };
+enum { PISOUND_OUTPUT_BUFFER_SIZE_MILLIBYTES = 127 * 1000 };
+enum { MIDI_MILLIBYTES_PER_MSEC = 3125 };
+
 static void spi_transfer(const uint8_t *txbuf, uint8_t *rxbuf, int len);
+static void spi_transfer_frames(const uint8_t *txbuf, uint8_t *rxbuf,
+	int frames);
 static uint16_t spi_transfer16(uint16_t val);
 
 static int pisnd_init_workqueues(void)
@@ -345,6 +355,43 @@ static void spi_transfer(const uint8_t *txbuf, uint8_t *rxbuf, int len)
 	printd("hasMore %d\n", pisnd_spi_has_more());
 }
 
+/* Sends several frames, each still framed by its own chip select, with a
+ * single message, so the dispatch cost is paid once.
+ */
+static void spi_transfer_frames(const uint8_t *txbuf, uint8_t *rxbuf,
+	int frames)
+{
+	int err, i;
+	struct spi_transfer transfers[TRANSFER_BATCH];
+	struct spi_message msg;
+
+	memset(rxbuf, 0, frames * TRANSFER_SIZE);
+
+	if (!pisnd_spi_device) {
+		printe("pisnd_spi_device null, returning\n");
+		return;
+	}
+
+	memset(transfers, 0, sizeof(transfers));
+
+	for (i = 0; i < frames; ++i) {
+		transfers[i].tx_buf = txbuf + i * TRANSFER_SIZE;
+		transfers[i].rx_buf = rxbuf + i * TRANSFER_SIZE;
+		transfers[i].len = TRANSFER_SIZE;
+		transfers[i].speed_hz = 150000;
+		transfers[i].delay.value = 10;
+		transfers[i].delay.unit = SPI_DELAY_UNIT_USECS;
+		transfers[i].cs_change = i + 1 < frames;
+	}
+
+	spi_message_init_with_transfers(&msg, transfers, frames);
+
+	err = spi_sync(pisnd_spi_device, &msg);
+
+	if (err < 0)
+		printe("spi_sync error %d\n", err);
+}
+
 static int spi_read_bytes(char *dst, size_t length, uint8_t *bytesRead)
 {
 	uint16_t rx;
@@ -405,21 +452,47 @@ static struct spi_device *pisnd_spi_find_device(void)
 		return NULL;
 }
 
+/* Estimated use of the Pisound's MIDI output buffer, kept across runs */
+static int pisnd_out_buffer_used_millibytes;
+static ktime_t pisnd_out_buffer_updated_at;
+
+/* Space in the buffer becomes available at the UART MIDI byte rate. */
+static void pisnd_update_out_buffer_used(void)
+{
+	ktime_t now = ktime_get();
+	s64 drained;
+
+	drained = ktime_us_delta(now, pisnd_out_buffer_updated_at) *
+		MIDI_MILLIBYTES_PER_MSEC / USEC_PER_MSEC;
+	pisnd_out_buffer_updated_at = now;
+
+	if (drained >= pisnd_out_buffer_used_millibytes)
+		pisnd_out_buffer_used_millibytes = 0;
+	else
+		pisnd_out_buffer_used_millibytes -= drained;
+}
+
+static bool pisnd_out_buffer_full(void)
+{
+	return pisnd_out_buffer_used_millibytes + 1000 >=
+		PISOUND_OUTPUT_BUFFER_SIZE_MILLIBYTES;
+}
+
+static bool pisnd_midi_output_pending(void)
+{
+	return !kfifo_is_empty(&spi_fifo_out) ||
+		(g_midi_output_substream &&
+		!snd_rawmidi_transmit_empty(g_midi_output_substream));
+}
+
 static void pisnd_work_handler(struct work_struct *work)
 {
-	enum { TRANSFER_SIZE = 4 };
-	enum { PISOUND_OUTPUT_BUFFER_SIZE_MILLIBYTES = 127 * 1000 };
-	enum { MIDI_MILLIBYTES_PER_JIFFIE = (3125 * 1000) / HZ };
-	int out_buffer_used_millibytes = 0;
-	unsigned long now;
 	uint8_t val;
-	uint8_t txbuf[TRANSFER_SIZE];
-	uint8_t rxbuf[TRANSFER_SIZE];
-	uint8_t midibuf[TRANSFER_SIZE];
-	int i, n;
-	bool had_data;
-
-	unsigned long last_transfer_at = jiffies;
+	uint8_t txbuf[TRANSFER_BATCH * TRANSFER_SIZE];
+	uint8_t rxbuf[TRANSFER_BATCH * TRANSFER_SIZE];
+	uint8_t midibuf[TRANSFER_BATCH * TRANSFER_SIZE / 2];
+	int i, n, frames;
+	bool had_data = false;
 
 	if (work == &pisnd_work_process) {
 		if (pisnd_spi_device == NULL)
@@ -447,11 +520,30 @@ static void pisnd_work_handler(struct work_struct *work)
 				}
 			}
 
+			pisnd_update_out_buffer_used();
+
+			/* Waiting for the output to drain needs no transfers. */
+			if (pisnd_out_buffer_full() &&
+				!g_ledFlashDurationChanged &&
+				!pisnd_spi_has_more()) {
+				usleep_range(USEC_PER_SEC / 3125,
+					2 * USEC_PER_SEC / 3125);
+				continue;
+			}
+
+			/* Enough frames for what's queued, at least 2 for a
+			 * 3 byte message when the MCU has data for us.
+			 */
+			frames = DIV_ROUND_UP(kfifo_len(&spi_fifo_out) +
+				g_ledFlashDurationChanged, 2);
+			if (pisnd_spi_has_more())
+				frames = max(frames, 2);
+			frames = clamp(frames, 1, (int)TRANSFER_BATCH);
+
 			had_data = false;
 			memset(txbuf, 0, sizeof(txbuf));
-			for (i = 0; i < sizeof(txbuf) &&
-				((out_buffer_used_millibytes+1000 <
-				PISOUND_OUTPUT_BUFFER_SIZE_MILLIBYTES) ||
+			for (i = 0; i < frames * TRANSFER_SIZE &&
+				(!pisnd_out_buffer_full() ||
 				g_ledFlashDurationChanged);
 				i += 2) {
 
@@ -465,40 +557,29 @@ static void pisnd_work_handler(struct work_struct *work)
 				} else if (kfifo_get(&spi_fifo_out, &val)) {
 					txbuf[i+0] = 0x0f;
 					txbuf[i+1] = val;
-					out_buffer_used_millibytes += 1000;
+					pisnd_out_buffer_used_millibytes +=
+						1000;
 				}
 			}
 
-			spi_transfer(txbuf, rxbuf, sizeof(txbuf));
-			/* Estimate the Pisound's MIDI output buffer usage, so
-			 * that we don't overflow it. Space in the buffer should
-			 * be becoming available at the UART MIDI byte transfer
-			 * rate.
-			 */
-			now = jiffies;
-			if (now != last_transfer_at) {
-				out_buffer_used_millibytes -=
-					(now - last_transfer_at) *
-					MIDI_MILLIBYTES_PER_JIFFIE;
-				if (out_buffer_used_millibytes < 0)
-					out_buffer_used_millibytes = 0;
-				last_transfer_at = now;
-			}
+			spi_transfer_frames(txbuf, rxbuf, frames);
 
-			for (i = 0; i < sizeof(rxbuf); i += 2) {
+			for (i = 0; i < frames * TRANSFER_SIZE; i += 2) {
 				if (rxbuf[i]) {
 					kfifo_put(&spi_fifo_in, rxbuf[i+1]);
-					if (kfifo_len(&spi_fifo_in) > 16 &&
-						g_recvCallback)
-						g_recvCallback(g_recvData);
 					had_data = true;
 				}
 			}
+
+			/* Hand the input over as soon as it's in, so that its
+			 * rawmidi timestamps are those of this transfer.
+			 */
+			if (had_data && g_recvCallback)
+				g_recvCallback(g_recvData);
 		} while (had_data
-			|| !kfifo_is_empty(&spi_fifo_out)
+			|| pisnd_midi_output_pending()
 			|| pisnd_spi_has_more()
 			|| g_ledFlashDurationChanged
-			|| out_buffer_used_millibytes != 0
 			);
 
 		if (!kfifo_is_empty(&spi_fifo_in) && g_recvCallback)
@@ -716,6 +716,7 @@ static const struct snd_soc_component_driver pcm3168a_driver = {
 	.num_dapm_routes	= ARRAY_SIZE(pcm3168a_dapm_routes),
 	.use_pmdown_time	= 1,
 	.endianness		= 1,
+	.defer_control_writes	= 1,
 };
 
 int pcm3168a_probe(struct device *dev, struct regmap *regmap)
@@ -1512,6 +1512,7 @@ static const struct snd_soc_component_driver pcm512x_component_driver = {
 	.num_dapm_routes	= ARRAY_SIZE(pcm512x_dapm_routes),
 	.use_pmdown_time	= 1,
 	.endianness		= 1,
+	.defer_control_writes	= 1,
 };
 
 static const struct regmap_range_cfg pcm512x_range = {
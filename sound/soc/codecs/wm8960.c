@@ -1378,6 +1378,7 @@ static const struct snd_soc_component_driver soc_component_dev_wm8960 = {
 	.idle_bias_on		= 1,
 	.use_pmdown_time	= 1,
 	.endianness		= 1,
+	.defer_control_writes	= 1,
 };
 
 static const struct regmap_config wm8960_regmap = {
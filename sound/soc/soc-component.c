@@ -9,10 +9,17 @@
 // Kuninori Morimoto <kuninori.morimoto.gx@renesas.com>
 //
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/pm_runtime.h>
+#include <linux/slab.h>
 #include <sound/soc.h>
 #include <linux/bitops.h>
 
+static unsigned int deferred_write_ms = 20;
+module_param(deferred_write_ms, uint, 0644);
+MODULE_PARM_DESC(deferred_write_ms,
+		 "Minimum interval in ms between batched control writes (0 = write immediately)");
+
 #define soc_component_ret(dai, ret) _soc_component_ret(dai, __func__, ret, -1)
 #define soc_component_ret_reg_rw(dai, ret, reg) _soc_component_ret(dai, __func__, ret, reg)
 static inline int _soc_component_ret(struct snd_soc_component *component,
@@ -676,13 +683,96 @@ int snd_soc_component_compr_get_metadata(struct snd_compr_stream *cstream,
 }
 EXPORT_SYMBOL_GPL(snd_soc_component_compr_get_metadata);
 
+static struct reg_sequence *soc_component_find_deferred(
+	struct snd_soc_component *component,
+	unsigned int reg)
+{
+	int i;
+
+	for (i = 0; i < component->num_deferred; i++)
+		if (component->deferred[i].reg == reg)
+			return &component->deferred[i];
+
+	return NULL;
+}
+
+static int soc_component_flush_deferred_no_lock(
+	struct snd_soc_component *component)
+{
+	int ret;
+
+	if (!component->num_deferred)
+		return 0;
+
+	ret = regmap_multi_reg_write(component->regmap, component->deferred,
+				     component->num_deferred);
+	component->num_deferred = 0;
+	component->deferred_flush_time = jiffies;
+
+	return soc_component_ret(component, ret);
+}
+
+static void soc_component_flush_deferred_work(struct work_struct *work)
+{
+	struct snd_soc_component *component =
+		container_of(work, struct snd_soc_component,
+			     deferred_work.work);
+
+	mutex_lock(&component->io_mutex);
+	soc_component_flush_deferred_no_lock(component);
+	mutex_unlock(&component->io_mutex);
+}
+
+/**
+ * snd_soc_component_flush_deferred() - Write out deferred control updates
+ * @component: Component to flush
+ *
+ * Writes all register updates queued by
+ * snd_soc_component_update_bits_deferred() to the device in one batch.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int snd_soc_component_flush_deferred(struct snd_soc_component *component)
+{
+	int ret;
+
+	if (!READ_ONCE(component->num_deferred))
+		return 0;
+
+	mutex_lock(&component->io_mutex);
+	ret = soc_component_flush_deferred_no_lock(component);
+	mutex_unlock(&component->io_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(snd_soc_component_flush_deferred);
+
+void snd_soc_component_init_deferred(struct snd_soc_component *component)
+{
+	INIT_DELAYED_WORK(&component->deferred_work,
+			  soc_component_flush_deferred_work);
+}
+
+void snd_soc_component_cleanup_deferred(struct snd_soc_component *component)
+{
+	cancel_delayed_work_sync(&component->deferred_work);
+	snd_soc_component_flush_deferred(component);
+	kfree(component->deferred);
+	component->deferred = NULL;
+}
+
 static unsigned int soc_component_read_no_lock(
 	struct snd_soc_component *component,
 	unsigned int reg)
 {
+	struct reg_sequence *deferred;
 	int ret;
 	unsigned int val = 0;
 
+	deferred = soc_component_find_deferred(component, reg);
+	if (deferred)
+		return deferred->def;
+
 	if (component->regmap)
 		ret = regmap_read(component->regmap, reg, &val);
 	else if (component->driver->read) {
@@ -746,7 +836,9 @@ int snd_soc_component_write(struct snd_soc_component *component,
 	int ret;
 
 	mutex_lock(&component->io_mutex);
-	ret = soc_component_write_no_lock(component, reg, val);
+	ret = soc_component_flush_deferred_no_lock(component);
+	if (ret >= 0)
+		ret = soc_component_write_no_lock(component, reg, val);
 	mutex_unlock(&component->io_mutex);
 
 	return ret;
@@ -791,6 +883,10 @@ int snd_soc_component_update_bits(struct snd_soc_component *component,
 	bool change;
 	int ret;
 
+	ret = snd_soc_component_flush_deferred(component);
+	if (ret < 0)
+		return ret;
+
 	if (component->regmap)
 		ret = regmap_update_bits_check(component->regmap, reg, mask,
 					       val, &change);
@@ -827,6 +923,10 @@ int snd_soc_component_update_bits_async(struct snd_soc_component *component,
 	bool change;
 	int ret;
 
+	ret = snd_soc_component_flush_deferred(component);
+	if (ret < 0)
+		return ret;
+
 	if (component->regmap)
 		ret = regmap_update_bits_check_async(component->regmap, reg,
 						     mask, val, &change);
@@ -840,6 +940,82 @@ int snd_soc_component_update_bits_async(struct snd_soc_component *component,
 }
 EXPORT_SYMBOL_GPL(snd_soc_component_update_bits_async);
 
+/**
+ * snd_soc_component_update_bits_deferred() - Queue a read/modify/write cycle
+ * @component: Component to update
+ * @reg: Register to update
+ * @mask: Mask that specifies which bits to update
+ * @val: New value for the bits specified by mask
+ *
+ * This function is similar to snd_soc_component_update_bits(), but for
+ * components that set defer_control_writes the new value is only cached and
+ * written out together with other pending updates, at most once every
+ * deferred_write_ms.  Reads see the pending value, and any immediate write,
+ * update or stream prepare flushes the queue first so ordering is kept.
+ * Use it for user controls only; sequences that rely on each write reaching
+ * the device must use snd_soc_component_update_bits().
+ *
+ * Return: 1 if the operation was successful and the value of the register
+ * changed, 0 if the operation was successful, but the value did not change.
+ * Returns a negative error code otherwise.
+ */
+int snd_soc_component_update_bits_deferred(struct snd_soc_component *component,
+					   unsigned int reg, unsigned int mask,
+					   unsigned int val)
+{
+	unsigned int interval = READ_ONCE(deferred_write_ms);
+	struct reg_sequence *deferred;
+	unsigned int old, new;
+	unsigned long delay = 0, next;
+	int ret = 0;
+
+	if (!component->regmap || !component->driver->defer_control_writes ||
+	    !interval)
+		return snd_soc_component_update_bits(component, reg, mask, val);
+
+	mutex_lock(&component->io_mutex);
+
+	if (!component->deferred) {
+		component->deferred = kcalloc(SND_SOC_COMPONENT_MAX_DEFERRED,
+					      sizeof(*component->deferred),
+					      GFP_KERNEL);
+		if (!component->deferred) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	old = soc_component_read_no_lock(component, reg);
+	new = (old & ~mask) | (val & mask);
+	if (old == new)
+		goto out;
+
+	deferred = soc_component_find_deferred(component, reg);
+	if (!deferred) {
+		if (component->num_deferred == SND_SOC_COMPONENT_MAX_DEFERRED) {
+			ret = soc_component_flush_deferred_no_lock(component);
+			if (ret < 0)
+				goto out;
+		}
+		deferred = &component->deferred[component->num_deferred++];
+		deferred->reg = reg;
+		deferred->delay_us = 0;
+	}
+	deferred->def = new;
+	ret = 1;
+
+	next = component->deferred_flush_time + msecs_to_jiffies(interval);
+	delay = time_after(next, jiffies) ? next - jiffies : 0;
+out:
+	mutex_unlock(&component->io_mutex);
+
+	if (ret > 0)
+		schedule_delayed_work(&component->deferred_work, delay);
+
+	return soc_component_ret_reg_rw(component, ret, reg);
+}
+EXPORT_SYMBOL_GPL(snd_soc_component_update_bits_deferred);
+
 /**
  * snd_soc_component_read_field() - Read register field value
  * @component: Component to read from
@@ -1106,6 +1282,11 @@ int snd_soc_pcm_component_prepare(struct snd_pcm_substream *substream)
 	int i, ret;
 
 	for_each_rtd_components(rtd, i, component) {
+		/* the stream must start with the current control settings */
+		ret = snd_soc_component_flush_deferred(component);
+		if (ret < 0)
+			return ret;
+
 		if (component->driver->prepare) {
 			ret = component->driver->prepare(component, substream);
 			if (ret < 0)
@@ -2569,6 +2569,8 @@ static void snd_soc_del_component_unlocked(struct snd_soc_component *component)
 	if (card)
 		snd_soc_unbind_card(card, false);
 
+	snd_soc_component_cleanup_deferred(component);
+
 	list_del(&component->list);
 }
 
@@ -2581,6 +2583,7 @@ int snd_soc_component_initialize(struct snd_soc_component *component,
 	INIT_LIST_HEAD(&component->card_list);
 	INIT_LIST_HEAD(&component->list);
 	mutex_init(&component->io_mutex);
+	snd_soc_component_init_deferred(component);
 
 	component->name = fmt_single_name(dev, &component->id);
 	if (!component->name) {
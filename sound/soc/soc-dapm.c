@@ -1636,6 +1636,31 @@ static void dapm_seq_run_coalesced(struct snd_soc_card *card,
 	}
 }
 
+/* Run the stream events of a card level pre or post widget */
+static void dapm_seq_run_pre_post(struct snd_soc_dapm_widget *w, int event)
+{
+	int ret = 0;
+
+	if (!w->event)
+		return;
+
+	if (w->id == snd_soc_dapm_pre) {
+		if (event == SND_SOC_DAPM_STREAM_START)
+			ret = w->event(w, NULL, SND_SOC_DAPM_PRE_PMU);
+		else if (event == SND_SOC_DAPM_STREAM_STOP)
+			ret = w->event(w, NULL, SND_SOC_DAPM_PRE_PMD);
+	} else {
+		if (event == SND_SOC_DAPM_STREAM_START)
+			ret = w->event(w, NULL, SND_SOC_DAPM_POST_PMU);
+		else if (event == SND_SOC_DAPM_STREAM_STOP)
+			ret = w->event(w, NULL, SND_SOC_DAPM_POST_PMD);
+	}
+
+	if (ret < 0)
+		dev_err(w->dapm->dev,
+			"ASoC: Failed to apply widget power: %d\n", ret);
+}
+
 /* Apply a DAPM power sequence.
  *
  * We walk over a pre-sorted list of widgets to apply power to.  In
@@ -1663,8 +1688,6 @@ static void dapm_seq_run(struct snd_soc_card *card,
 		sort = dapm_down_seq;
 
 	list_for_each_entry_safe(w, n, list, power_list) {
-		int ret = 0;
-
 		/* Do we need to apply any queued changes? */
 		if (sort[w->id] != cur_sort || w->reg != cur_reg ||
 		    w->dapm != cur_dapm || w->subseq != cur_subseq) {
@@ -1691,27 +1714,8 @@ static void dapm_seq_run(struct snd_soc_card *card,
 
 		switch (w->id) {
 		case snd_soc_dapm_pre:
-			if (!w->event)
-				continue;
-
-			if (event == SND_SOC_DAPM_STREAM_START)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_PRE_PMU);
-			else if (event == SND_SOC_DAPM_STREAM_STOP)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_PRE_PMD);
-			break;
-
 		case snd_soc_dapm_post:
-			if (!w->event)
-				continue;
-
-			if (event == SND_SOC_DAPM_STREAM_START)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_POST_PMU);
-			else if (event == SND_SOC_DAPM_STREAM_STOP)
-				ret = w->event(w,
-					       NULL, SND_SOC_DAPM_POST_PMD);
+			dapm_seq_run_pre_post(w, event);
 			break;
 
 		default:
@@ -1723,10 +1727,6 @@ static void dapm_seq_run(struct snd_soc_card *card,
 			list_move(&w->power_list, &pending);
 			break;
 		}
-
-		if (ret < 0)
-			dev_err(w->dapm->dev,
-				"ASoC: Failed to apply widget power: %d\n", ret);
 	}
 
 	if (!list_empty(&pending))
@@ -1744,6 +1744,114 @@ static void dapm_seq_run(struct snd_soc_card *card,
 		soc_dapm_async_complete(d);
 }
 
+/* Async callback applying one sequence step of a single context */
+static void dapm_seq_run_step_async(void *data, async_cookie_t cookie)
+{
+	struct snd_soc_dapm_context *d = data;
+	struct snd_soc_dapm_widget *w, *n;
+	LIST_HEAD(pending);
+	int i;
+
+	/* the step is sorted by register, coalesce writes as usual */
+	list_for_each_entry_safe(w, n, &d->seq_pending, power_list) {
+		if (!list_empty(&pending) &&
+		    list_first_entry(&pending, struct snd_soc_dapm_widget,
+				     power_list)->reg != w->reg) {
+			dapm_seq_run_coalesced(d->card, &pending);
+			INIT_LIST_HEAD(&pending);
+		}
+		list_move_tail(&w->power_list, &pending);
+	}
+
+	if (!list_empty(&pending))
+		dapm_seq_run_coalesced(d->card, &pending);
+
+	if (d->component) {
+		for (i = 0; i < ARRAY_SIZE(dapm_up_seq); i++)
+			if (d->seq_order[i] == d->seq_sort)
+				snd_soc_component_seq_notifier(d->component, i,
+							       d->seq_subseq);
+	}
+
+	soc_dapm_async_complete(d);
+}
+
+/* Apply the queued step on every context, in parallel if more than one */
+static void dapm_seq_run_step(struct snd_soc_card *card,
+			      struct async_domain *domain)
+{
+	struct snd_soc_dapm_context *d;
+	int n = 0;
+
+	for_each_card_dapms(card, d)
+		if (!list_empty(&d->seq_pending))
+			n++;
+
+	if (n == 1) {
+		for_each_card_dapms(card, d)
+			if (!list_empty(&d->seq_pending))
+				dapm_seq_run_step_async(d, 0);
+		return;
+	}
+
+	for_each_card_dapms(card, d)
+		if (!list_empty(&d->seq_pending))
+			async_schedule_domain(dapm_seq_run_step_async, d,
+					      domain);
+	async_synchronize_full_domain(domain);
+}
+
+/* Apply a DAPM power sequence, spreading every step across contexts.
+ *
+ * Widgets sharing a sequence step (sort order and subsequence) do not
+ * depend on each other, only on the steps before them, so the writes
+ * for different components - usually separate devices, often on
+ * separate buses - are issued concurrently and the step completes once
+ * every component is done.  Within a component writes are coalesced
+ * and ordered as in dapm_seq_run().
+ */
+static void dapm_seq_run_parallel(struct snd_soc_card *card,
+				  struct list_head *list, int event,
+				  bool power_up)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	struct snd_soc_dapm_widget *w, *n;
+	int cur_sort = -1;
+	int cur_subseq = INT_MIN;
+	int *sort;
+
+	if (power_up)
+		sort = dapm_up_seq;
+	else
+		sort = dapm_down_seq;
+
+	list_for_each_entry_safe(w, n, list, power_list) {
+		if (sort[w->id] != cur_sort || w->subseq != cur_subseq) {
+			dapm_seq_run_step(card, &async_domain);
+			cur_sort = sort[w->id];
+			cur_subseq = w->subseq;
+		}
+
+		switch (w->id) {
+		case snd_soc_dapm_pre:
+		case snd_soc_dapm_post:
+			dapm_seq_run_pre_post(w, event);
+			break;
+
+		default:
+			if (list_empty(&w->dapm->seq_pending)) {
+				w->dapm->seq_order = sort;
+				w->dapm->seq_sort = cur_sort;
+				w->dapm->seq_subseq = cur_subseq;
+			}
+			list_move_tail(&w->power_list, &w->dapm->seq_pending);
+			break;
+		}
+	}
+
+	dapm_seq_run_step(card, &async_domain);
+}
+
 static void dapm_widget_update(struct snd_soc_card *card)
 {
 	struct snd_soc_dapm_update *update = card->update;
@@ -2064,12 +2172,18 @@ static int dapm_power_widgets(struct snd_soc_card *card, int event)
 	}
 
 	/* Power down widgets first; try to avoid amplifying pops. */
-	dapm_seq_run(card, &down_list, event, false);
+	if (card->parallel_dapm && !card->pop_time)
+		dapm_seq_run_parallel(card, &down_list, event, false);
+	else
+		dapm_seq_run(card, &down_list, event, false);
 
 	dapm_widget_update(card);
 
 	/* Now power up. */
-	dapm_seq_run(card, &up_list, event, true);
+	if (card->parallel_dapm && !card->pop_time)
+		dapm_seq_run_parallel(card, &up_list, event, true);
+	else
+		dapm_seq_run(card, &up_list, event, true);
 
 	/* Run all the bias changes in parallel */
 	for_each_card_dapms(card, d) {
@@ -4820,6 +4934,7 @@ void snd_soc_dapm_init(struct snd_soc_dapm_context *dapm,
 	}
 
 	INIT_LIST_HEAD(&dapm->list);
+	INIT_LIST_HEAD(&dapm->seq_pending);
 	/* see for_each_card_dapms */
 	list_add(&dapm->list, &card->dapm_list);
 }
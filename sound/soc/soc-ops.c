@@ -106,7 +106,8 @@ int snd_soc_put_enum_double(struct snd_kcontrol *kcontrol,
 		mask |= e->mask << e->shift_r;
 	}
 
-	return snd_soc_component_update_bits(component, e->reg, mask, val);
+	return snd_soc_component_update_bits_deferred(component, e->reg,
+						      mask, val);
 }
 EXPORT_SYMBOL_GPL(snd_soc_put_enum_double);
 
@@ -364,14 +365,15 @@ int snd_soc_put_volsw(struct snd_kcontrol *kcontrol,
 			type_2r = true;
 		}
 	}
-	err = snd_soc_component_update_bits(component, reg, val_mask, val);
+	err = snd_soc_component_update_bits_deferred(component, reg, val_mask,
+						     val);
 	if (err < 0)
 		return err;
 	ret = err;
 
 	if (type_2r) {
-		err = snd_soc_component_update_bits(component, reg2, val_mask,
-						    val2);
+		err = snd_soc_component_update_bits_deferred(component, reg2,
+							     val_mask, val2);
 		/* Don't discard any error code or drop change flag */
 		if (ret == 0 || err < 0) {
 			ret = err;
@@ -458,7 +460,8 @@ int snd_soc_put_volsw_sx(struct snd_kcontrol *kcontrol,
 	val = (val + min) & mask;
 	val = val << shift;
 
-	err = snd_soc_component_update_bits(component, reg, val_mask, val);
+	err = snd_soc_component_update_bits_deferred(component, reg, val_mask,
+						     val);
 	if (err < 0)
 		return err;
 	ret = err;
@@ -475,8 +478,8 @@ int snd_soc_put_volsw_sx(struct snd_kcontrol *kcontrol,
 		val2 = (val2 + min) & mask;
 		val2 = val2 << rshift;
 
-		err = snd_soc_component_update_bits(component, reg2, val_mask,
-			val2);
+		err = snd_soc_component_update_bits_deferred(component, reg2,
+			val_mask, val2);
 
 		/* Don't discard any error code or drop change flag */
 		if (ret == 0 || err < 0) {
@@ -558,7 +561,8 @@ int snd_soc_put_volsw_range(struct snd_kcontrol *kcontrol,
 	val_mask = mask << shift;
 	val = val << shift;
 
-	err = snd_soc_component_update_bits(component, reg, val_mask, val);
+	err = snd_soc_component_update_bits_deferred(component, reg, val_mask,
+						     val);
 	if (err < 0)
 		return err;
 	ret = err;
@@ -579,8 +583,8 @@ int snd_soc_put_volsw_range(struct snd_kcontrol *kcontrol,
 		val_mask = mask << shift;
 		val = val << shift;
 
-		err = snd_soc_component_update_bits(component, rreg, val_mask,
-			val);
+		err = snd_soc_component_update_bits_deferred(component, rreg,
+			val_mask, val);
 		/* Don't discard any error code or drop change flag */
 		if (ret == 0 || err < 0) {
 			ret = err;
@@ -944,8 +948,8 @@ int snd_soc_put_xr_sx(struct snd_kcontrol *kcontrol,
 	for (i = 0; i < regcount; i++) {
 		unsigned int regval = (val >> (regwshift*(regcount-i-1))) & regwmask;
 		unsigned int regmask = (mask >> (regwshift*(regcount-i-1))) & regwmask;
-		int err = snd_soc_component_update_bits(component, regbase+i,
-							regmask, regval);
+		int err = snd_soc_component_update_bits_deferred(component,
+							regbase+i, regmask, regval);
 		if (err < 0)
 			return err;
 		if (err > 0)
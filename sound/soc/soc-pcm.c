@@ -172,6 +172,10 @@ static ssize_t dpcm_show_state(struct snd_soc_pcm_runtime *fe,
 					   snd_pcm_format_name(params_format(params)),
 					   params_channels(params),
 					   params_rate(params));
+
+		offset += scnprintf(buf + offset, size - offset,
+				   "   Reused Hardware Params: %u\n",
+				   be->dpcm[stream].hw_params_reused);
 	}
 out:
 	return offset;
@@ -1978,6 +1982,7 @@ int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 	struct snd_soc_pcm_runtime *be;
 	struct snd_pcm_substream *be_substream;
 	struct snd_soc_dpcm *dpcm;
+	bool configured;
 	int ret;
 
 	for_each_dpcm_be(fe, stream, dpcm) {
@@ -1997,6 +2002,11 @@ int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 		if (ret < 0)
 			goto unwind;
 
+		/* is the BE already set up with exactly these params ? */
+		configured = be->dpcm[stream].state == SND_SOC_DPCM_STATE_HW_PARAMS &&
+			!memcmp(&be->dpcm[stream].hw_params, &dpcm->hw_params,
+				sizeof(struct snd_pcm_hw_params));
+
 		/* copy the fixed-up hw params for BE dai */
 		memcpy(&be->dpcm[stream].hw_params, &dpcm->hw_params,
 		       sizeof(struct snd_pcm_hw_params));
@@ -2010,6 +2020,13 @@ int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 		    (be->dpcm[stream].state != SND_SOC_DPCM_STATE_HW_FREE))
 			continue;
 
+		if (configured) {
+			dev_dbg(be->dev, "ASoC: reuse hw_params BE %s\n",
+				be->dai_link->name);
+			be->dpcm[stream].hw_params_reused++;
+			continue;
+		}
+
 		dev_dbg(be->dev, "ASoC: hw_params BE %s\n",
 			be->dai_link->name);
 
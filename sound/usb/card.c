@@ -69,6 +69,8 @@ static int device_setup[SNDRV_CARDS]; /* device parameter for this card */
 static bool ignore_ctl_error;
 static bool autoclock = true;
 static bool lowlatency = true;
+static bool period_urbs;
+static bool fb_pll;
 static char *quirk_alias[SNDRV_CARDS];
 static char *delayed_register[SNDRV_CARDS];
 static bool implicit_fb[SNDRV_CARDS];
@@ -76,6 +78,7 @@ static unsigned int quirk_flags[SNDRV_CARDS];
 
 bool snd_usb_use_vmalloc = true;
 bool snd_usb_skip_validation;
+bool snd_usb_zero_copy;
 
 module_param_array(index, int, NULL, 0444);
 MODULE_PARM_DESC(index, "Index value for the USB audio adapter.");
@@ -96,6 +99,10 @@ module_param(autoclock, bool, 0444);
 MODULE_PARM_DESC(autoclock, "Enable auto-clock selection for UAC2 devices (default: yes).");
 module_param(lowlatency, bool, 0444);
 MODULE_PARM_DESC(lowlatency, "Enable low latency playback (default: yes).");
+module_param(period_urbs, bool, 0444);
+MODULE_PARM_DESC(period_urbs, "Size capture and implicit feedback URBs to one period, and estimate the delay from the time since the last URB (default: no).");
+module_param(fb_pll, bool, 0444);
+MODULE_PARM_DESC(fb_pll, "Track the device rate of feedback endpoints with a software PLL (default: no).");
 module_param_array(quirk_alias, charp, NULL, 0444);
 MODULE_PARM_DESC(quirk_alias, "Quirk aliases, e.g. 0123abcd:5678beef.");
 module_param_array(delayed_register, charp, NULL, 0444);
@@ -108,6 +115,8 @@ module_param_named(use_vmalloc, snd_usb_use_vmalloc, bool, 0444);
 MODULE_PARM_DESC(use_vmalloc, "Use vmalloc for PCM intermediate buffers (default: yes).");
 module_param_named(skip_validation, snd_usb_skip_validation, bool, 0444);
 MODULE_PARM_DESC(skip_validation, "Skip unit descriptor validation (default: no).");
+module_param_named(zero_copy, snd_usb_zero_copy, bool, 0444);
+MODULE_PARM_DESC(zero_copy, "Let playback URBs transfer directly from the PCM buffer (default: no).");
 
 /*
  * we keep the snd_usb_audio_t instances by ourselves for merging
@@ -635,6 +644,8 @@ static int snd_usb_audio_create(struct usb_interface *intf,
 	chip->generic_implicit_fb = implicit_fb[idx];
 	chip->autoclock = autoclock;
 	chip->lowlatency = lowlatency;
+	chip->period_urbs = period_urbs;
+	chip->fb_pll = fb_pll;
 	atomic_set(&chip->active, 1); /* avoid autopm during probing */
 	atomic_set(&chip->usage_count, 0);
 	atomic_set(&chip->shutdown, 0);
@@ -51,6 +51,8 @@ struct snd_usb_power_domain;
 struct snd_urb_ctx {
 	struct urb *urb;
 	unsigned int buffer_size;	/* size of data buffer, if data URB */
+	void *buffer;			/* own data buffer, if data URB */
+	dma_addr_t buffer_dma;		/* DMA address of the own buffer */
 	struct snd_usb_substream *subs;
 	struct snd_usb_endpoint *ep;
 	int index;	/* index for urb array */
@@ -113,6 +115,8 @@ struct snd_usb_endpoint {
 	int	   freqshift;		/* how much to shift the feedback value to get Q16.16 */
 	unsigned int freqmax;		/* maximum sampling rate, used for buffer management */
 	unsigned int phase;		/* phase accumulator */
+	unsigned int pll_freq;		/* estimated device rate in Q16.16 format */
+	int	   pll_phase;		/* PLL phase error in frames, Q16.16 */
 	unsigned int maxpacksize;	/* max packet size in bytes */
 	unsigned int maxframesize;      /* max packet size in frames */
 	unsigned int max_urb_frames;	/* max URB size in frames */
@@ -128,6 +132,7 @@ struct snd_usb_endpoint {
 	int skip_packets;		/* quirks for devices to ignore the first n packets
 					   in a stream */
 	bool implicit_fb_sync;		/* syncs with implicit feedback */
+	bool fb_pll;			/* feedback goes through the software PLL */
 	bool lowlatency_playback;	/* low-latency playback mode */
 	bool need_setup;		/* (re-)need for hw_params? */
 	bool need_prepare;		/* (re-)need for prepare? */
@@ -171,6 +176,7 @@ struct snd_usb_substream {
 	unsigned int inflight_bytes;	/* in-flight data bytes on buffer (for playback) */
 	unsigned int hwptr_done;	/* processed byte position in the buffer */
 	unsigned int transfer_done;	/* processed frames since last period update */
+	unsigned int zero_copy_done;	/* retired bytes since last period update (zero-copy) */
 	unsigned int frame_limit;	/* limits number of packets in URB */
 
 	/* data and sync endpoints for this stream */
@@ -186,15 +192,15 @@ struct snd_usb_substream {
 	spinlock_t lock;
 
 	unsigned int last_frame_number;	/* stored frame number */
+	ktime_t last_frame_time;	/* time of storing last_frame_number */
 
 	struct {
-		int marker;
-		int channel;
-		int byte_idx;
+		u8 marker;		/* of the next frame */
 	} dsd_dop;
 
 	bool trigger_tstamp_pending_update; /* trigger timestamp being updated from initial estimate */
 	bool lowlatency_playback;	/* low-latency playback mode */
+	bool zero_copy_playback;	/* URBs transfer from the PCM buffer */
 	struct media_ctl *media_ctl;
 };
 
@@ -98,10 +98,10 @@ static void release_urb_ctx(struct snd_urb_ctx *u)
 {
 	if (u->urb && u->buffer_size)
 		usb_free_coherent(u->ep->chip->dev, u->buffer_size,
-				  u->urb->transfer_buffer,
-				  u->urb->transfer_dma);
+				  u->buffer, u->buffer_dma);
 	usb_free_urb(u->urb);
 	u->urb = NULL;
+	u->buffer = NULL;
 	u->buffer_size = 0;
 }
 
@@ -146,11 +146,12 @@ static inline bool ep_state_update(struct snd_usb_endpoint *ep, int old, int new
  * @ep: The snd_usb_endpoint
  *
  * Determine whether an endpoint is driven by an implicit feedback
- * data endpoint source.
+ * data endpoint source.  An endpoint whose rate is recovered by the
+ * software PLL schedules its own packets and doesn't count as such.
  */
 int snd_usb_endpoint_implicit_feedback_sink(struct snd_usb_endpoint *ep)
 {
-	return  ep->implicit_fb_sync && usb_pipeout(ep->pipe);
+	return  ep->implicit_fb_sync && !ep->fb_pll && usb_pipeout(ep->pipe);
 }
 
 /*
@@ -331,6 +332,9 @@ static int prepare_outbound_urb(struct snd_usb_endpoint *ep,
 
 	switch (ep->type) {
 	case SND_USB_ENDPOINT_TYPE_DATA:
+		/* a zero-copy submission may have pointed it into the PCM buffer */
+		urb->transfer_buffer = ctx->buffer;
+		urb->transfer_dma = ctx->buffer_dma;
 		data_subs = READ_ONCE(ep->data_subs);
 		if (data_subs && ep->prepare_data_urb)
 			return ep->prepare_data_urb(data_subs, urb, in_stream_lock);
@@ -830,6 +834,7 @@ snd_usb_endpoint_open(struct snd_usb_audio *chip,
 			endpoint_set_syncinterval(chip, ep);
 
 		ep->implicit_fb_sync = fp->implicit_fb;
+		ep->fb_pll = chip->fb_pll;
 		ep->need_setup = true;
 		ep->need_prepare = true;
 		ep->fixed_rate = fixed_rate;
@@ -1177,7 +1182,20 @@ static int data_ep_set_params(struct snd_usb_endpoint *ep)
 	 * Playback endpoints with implicit sync much use the same parameters
 	 * as their corresponding capture endpoint.
 	 */
-	if (usb_pipein(ep->pipe) || ep->implicit_fb_sync) {
+	if ((usb_pipein(ep->pipe) || ep->implicit_fb_sync) && chip->period_urbs) {
+		/*
+		 * period_urbs: as many packets per URB as carry one period
+		 * at the nominal rate (freqn is in frames per packet
+		 * interval, Q16.16).  Rounded down, so that a URB doesn't end
+		 * after its period, and limited by max_packs_per_urb.  Each
+		 * URB is only one period, so all MAX_URBS are queued.
+		 */
+		urb_packs = div_u64((u64)ep->cur_period_frames << 16,
+				    ep->freqn << ep->datainterval);
+		urb_packs = clamp(urb_packs, 1u, max_packs_per_urb);
+		ep->nurbs = MAX_URBS;
+
+	} else if (usb_pipein(ep->pipe) || ep->implicit_fb_sync) {
 
 		urb_packs = packs_per_ms;
 		/*
@@ -1247,11 +1265,12 @@ static int data_ep_set_params(struct snd_usb_endpoint *ep)
 		if (!u->urb)
 			goto out_of_memory;
 
-		u->urb->transfer_buffer =
-			usb_alloc_coherent(chip->dev, u->buffer_size,
-					   GFP_KERNEL, &u->urb->transfer_dma);
-		if (!u->urb->transfer_buffer)
+		u->buffer = usb_alloc_coherent(chip->dev, u->buffer_size,
+					       GFP_KERNEL, &u->buffer_dma);
+		if (!u->buffer)
 			goto out_of_memory;
+		u->urb->transfer_buffer = u->buffer;
+		u->urb->transfer_dma = u->buffer_dma;
 		u->urb->pipe = ep->pipe;
 		u->urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
 		u->urb->interval = 1 << ep->datainterval;
@@ -1375,6 +1394,8 @@ int snd_usb_endpoint_set_params(struct snd_usb_audio *chip,
 	/* calculate the frequency in 16.16 format */
 	ep->freqm = ep->freqn;
 	ep->freqshift = INT_MIN;
+	ep->pll_freq = ep->freqn;
+	ep->pll_phase = 0;
 
 	ep->phase = 0;
 
@@ -1576,6 +1597,7 @@ int snd_usb_endpoint_start(struct snd_usb_endpoint *ep)
 	ep->unlink_mask = 0;
 	ep->phase = 0;
 	ep->sample_accum = 0;
+	ep->pll_phase = 0;
 
 	snd_usb_endpoint_start_quirk(ep);
 
@@ -1728,6 +1750,68 @@ void snd_usb_endpoint_free_all(struct snd_usb_audio *chip)
 		kfree(cp);
 }
 
+/*
+ * Software PLL for the feedback rate
+ *
+ * Instead of mirroring the layout of each capture URB, an implicit
+ * feedback sink counts the frames the device delivered and steers freqm
+ * towards the device rate; slave_next_packet_size() then sizes the
+ * playback packets just like for an explicit feedback endpoint.  A late
+ * capture completion now only shows up as a phase error that is spread
+ * over the following URBs instead of a burst of short or long packets.
+ *
+ * pll_phase is the number of frames the device got ahead of freqm;
+ * it is fed back with a proportional term and integrated into pll_freq,
+ * the rate estimate proper.  The gains give a damping of about 0.7.
+ * Explicit feedback values are already a rate and are only smoothed.
+ */
+#define FB_PLL_P_SHIFT	3
+#define FB_PLL_I_SHIFT	7
+
+static unsigned int fb_pll_clamp(struct snd_usb_endpoint *ep, s64 f)
+{
+	return clamp_t(s64, f, ep->freqn - ep->freqn / 8, ep->freqmax);
+}
+
+static void fb_pll_update(struct snd_usb_endpoint *ep,
+			  struct snd_usb_endpoint *sender,
+			  const struct urb *urb)
+{
+	struct snd_urb_ctx *in_ctx = urb->context;
+	unsigned int frames = 0, ticks;
+	unsigned long flags;
+	s64 phase;
+	int i;
+
+	for (i = 0; i < in_ctx->packets; i++) {
+		/* a lost packet would read as a rate drop, skip the URB */
+		if (urb->iso_frame_desc[i].status != 0)
+			return;
+		frames += urb->iso_frame_desc[i].actual_length / sender->stride;
+	}
+
+	/* the device didn't start streaming yet */
+	if (!frames)
+		return;
+
+	/* (micro)frames covered by this URB, the unit of freqm */
+	ticks = in_ctx->packets << sender->datainterval;
+
+	spin_lock_irqsave(&ep->lock, flags);
+	phase = ep->pll_phase + ((s64)frames << 16) - (s64)ep->freqm * ticks;
+	if (abs(phase) > (s64)ep->freqmax * ticks) {
+		/* lost lock; start over from the nominal rate */
+		ep->pll_freq = ep->freqn;
+		phase = 0;
+	}
+	ep->pll_phase = phase;
+	ep->pll_freq = fb_pll_clamp(ep, ep->pll_freq +
+				    div_s64(phase, ticks << FB_PLL_I_SHIFT));
+	ep->freqm = fb_pll_clamp(ep, ep->pll_freq +
+				 div_s64(phase, ticks << FB_PLL_P_SHIFT));
+	spin_unlock_irqrestore(&ep->lock, flags);
+}
+
 /*
  * snd_usb_handle_sync_urb: parse an USB sync packet
  *
@@ -1748,6 +1832,13 @@ static void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 
 	snd_BUG_ON(ep == sender);
 
+	/* implicit feedback with the rate recovered by the PLL */
+	if (ep->fb_pll && ep->implicit_fb_sync && usb_pipeout(ep->pipe)) {
+		if (atomic_read(&ep->running))
+			fb_pll_update(ep, sender, urb);
+		return;
+	}
+
 	/*
 	 * In case the endpoint is operating in implicit feedback mode, prepare
 	 * a new outbound URB that has the same layout as the received packet
@@ -1879,6 +1970,10 @@ static void snd_usb_handle_sync_urb(struct snd_usb_endpoint *ep,
 		 * This value is referred to in prepare_playback_urb().
 		 */
 		spin_lock_irqsave(&ep->lock, flags);
+		if (ep->fb_pll) {
+			f = ep->freqm + ((int)(f - ep->freqm) >> FB_PLL_P_SHIFT);
+			ep->pll_freq = f;
+		}
 		ep->freqm = f;
 		spin_unlock_irqrestore(&ep->lock, flags);
 	} else {
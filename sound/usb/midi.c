@@ -44,6 +44,7 @@
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
 #include <linux/usb.h>
 #include <linux/wait.h>
 #include <linux/usb/audio.h>
@@ -73,11 +74,25 @@
 #define OUTPUT_URBS 7
 #define INPUT_URBS 7
 
+/*
+ * After this long without input, the frame clock is restarted from the
+ * current time.  The window is shorter than one full turn of the 10-bit
+ * frame counter, even when it counts 125 us microframes.
+ */
+#define FRAME_CLOCK_WINDOW_NS	(100 * NSEC_PER_MSEC)
+
 
 MODULE_AUTHOR("Clemens Ladisch <clemens@ladisch.de>");
 MODULE_DESCRIPTION("USB Audio/MIDI helper module");
 MODULE_LICENSE("Dual BSD/GPL");
 
+static unsigned int out_batch;
+module_param(out_batch, uint, 0644);
+MODULE_PARM_DESC(out_batch, "Max. USB MIDI events per output URB (0 = fill the URB).");
+static unsigned int out_hold_us;
+module_param(out_hold_us, uint, 0644);
+MODULE_PARM_DESC(out_hold_us, "Max. time in us to hold a partially filled output URB while others are in flight (0 = send at once).");
+
 struct snd_usb_midi_in_endpoint;
 struct snd_usb_midi_out_endpoint;
 struct snd_usb_midi_endpoint;
@@ -130,6 +145,14 @@ struct snd_usb_midi_out_endpoint {
 	unsigned int next_urb;
 	spinlock_t buffer_lock;
 
+	/* output coalescing, standard protocol only */
+	int urb_limit;			/* bytes filled per urb */
+	u64 hold_ns;			/* max. time to hold a partial urb */
+	int held_urb;			/* index of the held urb, or -1 */
+	bool hold_expired;
+	struct hrtimer hold_timer;
+	unsigned int next_port;		/* round-robin start port */
+
 	struct usbmidi_out_port {
 		struct snd_usb_midi_out_endpoint *ep;
 		struct snd_rawmidi_substream *substream;
@@ -162,6 +185,16 @@ struct snd_usb_midi_in_endpoint {
 	u8 last_cin;
 	u8 error_resubmit;
 	int current_port;
+
+	/* timestamp for the data of the URB being processed */
+	ktime_t rx_tstamp;
+	struct usbmidi_frame_clock {
+		ktime_t anchor;		/* estimated start of frame 'frame' */
+		int frame;
+		unsigned int period_ns;	/* 1 ms; 125 us once the counter is
+					 * seen to advance faster */
+		bool valid;
+	} clock;
 };
 
 static void snd_usbmidi_do_output(struct snd_usb_midi_out_endpoint *ep);
@@ -218,7 +251,62 @@ static void snd_usbmidi_input_data(struct snd_usb_midi_in_endpoint *ep,
 	}
 	if (!test_bit(port->substream->number, &ep->umidi->input_triggered))
 		return;
-	snd_rawmidi_receive(port->substream, data, length);
+	snd_rawmidi_receive_tstamp(port->substream, data, length,
+				   ep->rx_tstamp);
+}
+
+/*
+ * Returns the estimated start time of the bus frame that is current when
+ * the completion handler runs.
+ *
+ * Stamping with the frame start rather than with ktime_get() removes the
+ * part of the interrupt and giveback delay that falls within one frame.
+ * A giveback that is delayed past a frame boundary still moves the
+ * timestamp by whole frames.
+ *
+ * The start of the current frame is the anchor plus the number of frames
+ * since then.  That value is capped at the current time, because a frame
+ * can't start after the moment its number was read.  Each call also adds
+ * 1/8192 of the time since the previous call, so that the estimate can
+ * move later again when the USB clock runs slow against the system clock.
+ */
+static ktime_t snd_usbmidi_frame_tstamp(struct snd_usb_midi_in_endpoint *ep)
+{
+	struct usbmidi_frame_clock *clock = &ep->clock;
+	ktime_t now = ktime_get();
+	int frame = usb_get_current_frame_number(ep->umidi->dev);
+	s64 elapsed;
+	ktime_t start;
+	unsigned int df;
+
+	if (frame < 0)
+		return now;
+	elapsed = ktime_to_ns(ktime_sub(now, clock->anchor));
+	if (!clock->valid || elapsed < 0 || elapsed > FRAME_CLOCK_WINDOW_NS) {
+		if (!clock->period_ns)
+			clock->period_ns = NSEC_PER_MSEC;
+		clock->anchor = now;
+		clock->frame = frame;
+		clock->valid = true;
+		return now;
+	}
+
+	/* all counters wrap at a multiple of 1024 */
+	df = (frame - clock->frame) & 0x3ff;
+	if (clock->period_ns == NSEC_PER_MSEC &&
+	    (s64)df * NSEC_PER_MSEC > elapsed + NSEC_PER_MSEC)
+		clock->period_ns = NSEC_PER_MSEC / 8;
+
+	start = ktime_add_ns(clock->anchor, (u64)df * clock->period_ns);
+	if (ktime_after(start, now))
+		start = now;
+	else
+		start = ktime_add_ns(start, elapsed >> 13);
+	if (ktime_after(start, now))
+		start = now;
+	clock->anchor = start;
+	clock->frame = frame;
+	return start;
 }
 
 #ifdef DUMP_PACKETS
@@ -242,6 +330,7 @@ static void snd_usbmidi_in_urb_complete(struct urb *urb)
 
 	if (urb->status == 0) {
 		dump_urb("received", urb->transfer_buffer, urb->actual_length);
+		ep->rx_tstamp = snd_usbmidi_frame_tstamp(ep);
 		ep->umidi->usb_protocol_ops->input(ep, urb->transfer_buffer,
 						   urb->actual_length);
 	} else {
@@ -287,6 +376,33 @@ static void snd_usbmidi_out_urb_complete(struct urb *urb)
 	snd_usbmidi_do_output(ep);
 }
 
+/*
+ * Decides whether a partially filled URB should wait for more data.
+ *
+ * As long as other URBs are in flight, the data would have to wait for
+ * those anyway, so it's cheaper to coalesce it into fewer, fuller URBs.
+ * The hold is limited by ep->hold_ns.  Called with buffer_lock held.
+ */
+static bool snd_usbmidi_hold_urb(struct snd_usb_midi_out_endpoint *ep,
+				 unsigned int urb_index)
+{
+	struct urb *urb = ep->urbs[urb_index].urb;
+
+	if (!ep->hold_ns || !ep->active_urbs ||
+	    urb->transfer_buffer_length + 4 > ep->urb_limit)
+		return false;
+	if (ep->hold_expired) {
+		ep->hold_expired = false;
+		return false;
+	}
+	if (ep->held_urb != urb_index) {
+		ep->held_urb = urb_index;
+		hrtimer_start(&ep->hold_timer, ns_to_ktime(ep->hold_ns),
+			      HRTIMER_MODE_REL_SOFT);
+	}
+	return true;
+}
+
 /*
  * This is called when some data should be transferred to the device
  * (from one or more substreams).
@@ -307,10 +423,19 @@ static void snd_usbmidi_do_output(struct snd_usb_midi_out_endpoint *ep)
 	for (;;) {
 		if (!(ep->active_urbs & (1 << urb_index))) {
 			urb = ep->urbs[urb_index].urb;
-			urb->transfer_buffer_length = 0;
+			/* a held urb keeps its data and gets topped up */
+			if (ep->held_urb != urb_index)
+				urb->transfer_buffer_length = 0;
 			ep->umidi->usb_protocol_ops->output(ep, urb);
 			if (urb->transfer_buffer_length == 0)
 				break;
+			if (snd_usbmidi_hold_urb(ep, urb_index))
+				break;
+			if (ep->held_urb == urb_index) {
+				ep->held_urb = -1;
+				ep->hold_expired = false;
+				hrtimer_try_to_cancel(&ep->hold_timer);
+			}
 
 			dump_urb("sending", urb->transfer_buffer,
 				 urb->transfer_buffer_length);
@@ -336,6 +461,30 @@ static void snd_usbmidi_out_work(struct work_struct *work)
 	snd_usbmidi_do_output(ep);
 }
 
+/* sends a held URB even if earlier URBs are still in flight */
+static void snd_usbmidi_flush_held(struct snd_usb_midi_out_endpoint *ep)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ep->buffer_lock, flags);
+	if (ep->held_urb < 0) {
+		spin_unlock_irqrestore(&ep->buffer_lock, flags);
+		return;
+	}
+	ep->hold_expired = true;
+	spin_unlock_irqrestore(&ep->buffer_lock, flags);
+	snd_usbmidi_do_output(ep);
+}
+
+static enum hrtimer_restart snd_usbmidi_hold_timer(struct hrtimer *timer)
+{
+	struct snd_usb_midi_out_endpoint *ep =
+		container_of(timer, struct snd_usb_midi_out_endpoint, hold_timer);
+
+	snd_usbmidi_flush_held(ep);
+	return HRTIMER_NORESTART;
+}
+
 /* called after transfers had been interrupted due to some USB error */
 static void snd_usbmidi_error_timer(struct timer_list *t)
 {
@@ -635,25 +784,43 @@ static void snd_usbmidi_transmit_byte(struct usbmidi_out_port *port,
 	}
 }
 
+/*
+ * Serves the ports round-robin, one USB MIDI packet per port and turn,
+ * so that a busy port can't starve the others.
+ */
 static void snd_usbmidi_standard_output(struct snd_usb_midi_out_endpoint *ep,
 					struct urb *urb)
 {
-	int p;
+	unsigned int p, i;
+	bool busy;
 
-	/* FIXME: lower-numbered ports can starve higher-numbered ports */
-	for (p = 0; p < 0x10; ++p) {
-		struct usbmidi_out_port *port = &ep->ports[p];
-		if (!port->active)
-			continue;
-		while (urb->transfer_buffer_length + 3 < ep->max_transfer) {
-			uint8_t b;
-			if (snd_rawmidi_transmit(port->substream, &b, 1) != 1) {
-				port->active = 0;
-				break;
+	p = ep->next_port;
+	do {
+		busy = false;
+		for (i = 0; i < 0x10; ++i, p = (p + 1) & 0x0f) {
+			struct usbmidi_out_port *port = &ep->ports[p];
+			int len = urb->transfer_buffer_length;
+
+			if (!port->active)
+				continue;
+			while (urb->transfer_buffer_length == len) {
+				uint8_t b;
+
+				if (urb->transfer_buffer_length + 3 >= ep->urb_limit) {
+					ep->next_port = p;
+					return;
+				}
+				if (snd_rawmidi_transmit(port->substream, &b, 1) != 1) {
+					port->active = 0;
+					break;
+				}
+				snd_usbmidi_transmit_byte(port, b, urb);
 			}
-			snd_usbmidi_transmit_byte(port, b, urb);
+			if (port->active)
+				busy = true;
 		}
-	}
+	} while (busy);
+	ep->next_port = p;
 }
 
 static const struct usb_protocol_ops snd_usbmidi_standard_ops = {
@@ -1177,6 +1344,7 @@ static void snd_usbmidi_output_drain(struct snd_rawmidi_substream *substream)
 
 	if (ep->umidi->disconnected)
 		return;
+	snd_usbmidi_flush_held(ep);
 	/*
 	 * The substream buffer is empty, but some data might still be in the
 	 * currently active URBs, so we have to wait for those to complete.
@@ -1339,6 +1507,7 @@ static void snd_usbmidi_out_endpoint_clear(struct snd_usb_midi_out_endpoint *ep)
 
 static void snd_usbmidi_out_endpoint_delete(struct snd_usb_midi_out_endpoint *ep)
 {
+	hrtimer_cancel(&ep->hold_timer);
 	snd_usbmidi_out_endpoint_clear(ep);
 	kfree(ep);
 }
@@ -1361,6 +1530,9 @@ static int snd_usbmidi_out_endpoint_create(struct snd_usb_midi *umidi,
 	if (!ep)
 		return -ENOMEM;
 	ep->umidi = umidi;
+	ep->held_urb = -1;
+	hrtimer_init(&ep->hold_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	ep->hold_timer.function = snd_usbmidi_hold_timer;
 
 	for (i = 0; i < OUTPUT_URBS; ++i) {
 		ep->urbs[i].urb = usb_alloc_urb(0, GFP_KERNEL);
@@ -1426,6 +1598,14 @@ static int snd_usbmidi_out_endpoint_create(struct snd_usb_midi *umidi,
 		ep->urbs[i].urb->transfer_flags = URB_NO_TRANSFER_DMA_MAP;
 	}
 
+	ep->urb_limit = ep->max_transfer;
+	if (umidi->usb_protocol_ops->output == snd_usbmidi_standard_output) {
+		if (out_batch)
+			ep->urb_limit = min_t(int, ep->max_transfer,
+					      out_batch * 4);
+		ep->hold_ns = (u64)out_hold_us * NSEC_PER_USEC;
+	}
+
 	spin_lock_init(&ep->buffer_lock);
 	INIT_WORK(&ep->work, snd_usbmidi_out_work);
 	init_waitqueue_head(&ep->drain_wait);
@@ -1489,8 +1669,10 @@ void snd_usbmidi_disconnect(struct list_head *p)
 
 	for (i = 0; i < MIDI_MAX_ENDPOINTS; ++i) {
 		struct snd_usb_midi_endpoint *ep = &umidi->endpoints[i];
-		if (ep->out)
+		if (ep->out) {
 			cancel_work_sync(&ep->out->work);
+			hrtimer_cancel(&ep->out->hold_timer);
+		}
 		if (ep->out) {
 			for (j = 0; j < OUTPUT_URBS; ++j)
 				usb_kill_urb(ep->out->urbs[j].urb);
@@ -1352,8 +1352,10 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 		}
 	}
 
-	/* initialize all elements */
-	if (!cval->cmask) {
+	/* initialize all elements, unless they're read on first access */
+	if (cval->head.mixer->chip->quirk_flags & QUIRK_FLAG_MIXER_LAZY_INIT) {
+		/* nothing */
+	} else if (!cval->cmask) {
 		init_cur_mix_raw(cval, 0, 0);
 	} else {
 		idx = 0;
@@ -1370,6 +1372,33 @@ static int get_min_max_with_quirks(struct usb_mixer_elem_info *cval,
 
 #define get_min_max(cval, def)	get_min_max_with_quirks(cval, def, NULL)
 
+/* retry getting the min/max values, if that failed or was deferred */
+static void mixer_ctl_feature_init(struct snd_kcontrol *kcontrol)
+{
+	struct usb_mixer_elem_info *cval = kcontrol->private_data;
+	struct usb_mixer_interface *mixer = cval->head.mixer;
+	unsigned int access = kcontrol->vd[0].access;
+
+	if (cval->initialized)
+		return;
+
+	get_min_max_with_quirks(cval, 0, kcontrol);
+	if (!cval->initialized)
+		return;
+
+	if (cval->dBmin >= cval->dBmax)
+		kcontrol->vd[0].access &=
+			~(SNDRV_CTL_ELEM_ACCESS_TLV_READ |
+			  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK);
+	/* the quirks look at the range, so a lazy mixer applies them now */
+	if (mixer->chip->quirk_flags & QUIRK_FLAG_MIXER_LAZY_INIT)
+		snd_usb_mixer_fu_apply_quirk(mixer, cval, cval->head.id,
+					     kcontrol);
+	if (kcontrol->vd[0].access != access)
+		snd_ctl_notify(mixer->chip->card, SNDRV_CTL_EVENT_MASK_INFO,
+			       &kcontrol->id);
+}
+
 /* get a feature/mixer unit info */
 static int mixer_ctl_feature_info(struct snd_kcontrol *kcontrol,
 				  struct snd_ctl_elem_info *uinfo)
@@ -1387,17 +1416,7 @@ static int mixer_ctl_feature_info(struct snd_kcontrol *kcontrol,
 		uinfo->value.integer.min = 0;
 		uinfo->value.integer.max = 1;
 	} else {
-		if (!cval->initialized) {
-			get_min_max_with_quirks(cval, 0, kcontrol);
-			if (cval->initialized && cval->dBmin >= cval->dBmax) {
-				kcontrol->vd[0].access &= 
-					~(SNDRV_CTL_ELEM_ACCESS_TLV_READ |
-					  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK);
-				snd_ctl_notify(cval->head.mixer->chip->card,
-					       SNDRV_CTL_EVENT_MASK_INFO,
-					       &kcontrol->id);
-			}
-		}
+		mixer_ctl_feature_init(kcontrol);
 		uinfo->value.integer.min = 0;
 		uinfo->value.integer.max =
 			DIV_ROUND_UP(cval->max - cval->min, cval->res);
@@ -1412,6 +1431,7 @@ static int mixer_ctl_feature_get(struct snd_kcontrol *kcontrol,
 	struct usb_mixer_elem_info *cval = kcontrol->private_data;
 	int c, cnt, val, err;
 
+	mixer_ctl_feature_init(kcontrol);
 	ucontrol->value.integer.value[0] = cval->min;
 	if (cval->cmask) {
 		cnt = 0;
@@ -1445,6 +1465,7 @@ static int mixer_ctl_feature_put(struct snd_kcontrol *kcontrol,
 	int c, cnt, val, oval, err;
 	int changed = 0;
 
+	mixer_ctl_feature_init(kcontrol);
 	if (cval->cmask) {
 		cnt = 0;
 		for (c = 0; c < MAX_CHANNELS; c++) {
@@ -1666,6 +1687,7 @@ static void __build_feature_ctl(struct usb_mixer_interface *mixer,
 	struct usb_mixer_elem_info *cval;
 	const struct usbmix_name_map *map;
 	unsigned int range;
+	bool lazy;
 
 	if (control == UAC_FU_GRAPHIC_EQUALIZER) {
 		/* FIXME: not supported yet */
@@ -1778,11 +1800,19 @@ static void __build_feature_ctl(struct usb_mixer_interface *mixer,
 		break;
 	}
 
-	/* get min/max values */
-	get_min_max_with_quirks(cval, 0, kctl);
+	/*
+	 * get min/max values; for a lazy mixer they're left to the first
+	 * access, unless there's nothing to fetch
+	 */
+	lazy = (mixer->chip->quirk_flags & QUIRK_FLAG_MIXER_LAZY_INIT) &&
+	       cval->val_type != USB_MIXER_BOOLEAN &&
+	       cval->val_type != USB_MIXER_INV_BOOLEAN &&
+	       !(map && map->dB);
+	if (!lazy)
+		get_min_max_with_quirks(cval, 0, kctl);
 
 	/* skip a bogus volume range */
-	if (cval->max <= cval->min) {
+	if (!lazy && cval->max <= cval->min) {
 		usb_audio_dbg(mixer->chip,
 			      "[%d] FU [%s] skipped due to invalid volume\n",
 			      cval->head.id, kctl->id.name);
@@ -1801,6 +1831,13 @@ static void __build_feature_ctl(struct usb_mixer_interface *mixer,
 		}
 	}
 
+	if (lazy) {
+		usb_audio_dbg(mixer->chip, "[%d] FU [%s] ch = %d, deferred\n",
+			      cval->head.id, kctl->id.name, cval->channels);
+		snd_usb_mixer_add_control(&cval->head, kctl);
+		return;
+	}
+
 	snd_usb_mixer_fu_apply_quirk(mixer, cval, unitid, kctl);
 
 	range = (cval->max - cval->min) / cval->res;
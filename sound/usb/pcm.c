@@ -4,11 +4,11 @@
 
 #include <linux/init.h>
 #include <linux/slab.h>
-#include <linux/bitrev.h>
 #include <linux/ratelimit.h>
 #include <linux/usb.h>
 #include <linux/usb/audio.h>
 #include <linux/usb/audio-v2.h>
+#include <linux/usb/hcd.h>
 
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -45,17 +45,30 @@ static snd_pcm_uframes_t snd_usb_pcm_delay(struct snd_usb_substream *subs,
 		return 0;
 	}
 
-	current_frame_number = usb_get_current_frame_number(subs->dev);
-	/*
-	 * HCD implementations use different widths, use lower 8 bits.
-	 * The delay will be managed up to 256ms, which is more than
-	 * enough
-	 */
-	frame_diff = (current_frame_number - subs->last_frame_number) & 0xff;
+	if (subs->stream->chip->period_urbs) {
+		/*
+		 * The frame counter only counts whole milliseconds, which is
+		 * as long as a 48 frame period.  Use the time since the last
+		 * URB was retired or prepared instead, capped at 256 ms like
+		 * the frame counter variant.
+		 */
+		s64 elapsed = ktime_us_delta(ktime_get(), subs->last_frame_time);
 
-	/* Approximation based on number of samples per USB frame (ms),
-	   some truncation for 44.1 but the estimate is good enough */
-	est_delay = frame_diff * runtime->rate / 1000;
+		elapsed = clamp_t(s64, elapsed, 0, 256 * USEC_PER_MSEC);
+		est_delay = div_u64((u64)elapsed * runtime->rate, USEC_PER_SEC);
+	} else {
+		current_frame_number = usb_get_current_frame_number(subs->dev);
+		/*
+		 * HCD implementations use different widths, use lower 8 bits.
+		 * The delay will be managed up to 256ms, which is more than
+		 * enough
+		 */
+		frame_diff = (current_frame_number - subs->last_frame_number) & 0xff;
+
+		/* Approximation based on number of samples per USB frame (ms),
+		   some truncation for 44.1 but the estimate is good enough */
+		est_delay = frame_diff * runtime->rate / 1000;
+	}
 
 	if (subs->direction == SNDRV_PCM_STREAM_PLAYBACK) {
 		est_delay = queued - est_delay;
@@ -79,7 +92,18 @@ static snd_pcm_uframes_t snd_usb_pcm_pointer(struct snd_pcm_substream *substream
 		return SNDRV_PCM_POS_XRUN;
 	spin_lock(&subs->lock);
 	hwptr_done = subs->hwptr_done;
-	runtime->delay = snd_usb_pcm_delay(subs, runtime);
+	if (subs->zero_copy_playback) {
+		/*
+		 * The in-flight URBs still read from the buffer, so don't
+		 * report that area as free before they are retired.
+		 */
+		if (hwptr_done < subs->inflight_bytes)
+			hwptr_done += subs->buffer_bytes;
+		hwptr_done -= subs->inflight_bytes;
+		runtime->delay = 0;
+	} else {
+		runtime->delay = snd_usb_pcm_delay(subs, runtime);
+	}
 	spin_unlock(&subs->lock);
 	return bytes_to_frames(runtime, hwptr_done);
 }
@@ -629,6 +653,32 @@ static int lowlatency_playback_available(struct snd_pcm_runtime *runtime,
 	return true;
 }
 
+/*
+ * check whether playback URBs can point directly into the PCM buffer;
+ * this needs a coherent buffer of the host controller and no per-packet
+ * conversion of the data
+ */
+static bool zero_copy_playback_available(struct snd_pcm_runtime *runtime,
+					 struct snd_usb_substream *subs)
+{
+	struct usb_hcd *hcd = bus_to_hcd(subs->dev->bus);
+
+	if (!snd_usb_zero_copy)
+		return false;
+	if (subs->direction == SNDRV_PCM_STREAM_CAPTURE)
+		return false;
+	if (!runtime->dma_buffer_p ||
+	    runtime->dma_buffer_p->dev.type != SNDRV_DMA_TYPE_DEV)
+		return false;
+	if (!hcd_uses_dma(hcd) || hcd->localmem_pool)
+		return false;
+	if (subs->tx_length_quirk)
+		return false;
+	if (subs->cur_audiofmt->dsd_dop || subs->cur_audiofmt->dsd_bitrev)
+		return false;
+	return true;
+}
+
 /*
  * prepare callback
  *
@@ -673,10 +723,13 @@ static int snd_usb_pcm_prepare(struct snd_pcm_substream *substream)
 	subs->inflight_bytes = 0;
 	subs->hwptr_done = 0;
 	subs->transfer_done = 0;
+	subs->zero_copy_done = 0;
 	subs->last_frame_number = 0;
+	subs->last_frame_time = 0;
 	subs->period_elapsed_pending = 0;
 	runtime->delay = 0;
 
+	subs->zero_copy_playback = zero_copy_playback_available(runtime, subs);
 	subs->lowlatency_playback = lowlatency_playback_available(runtime, subs);
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
 	    !subs->lowlatency_playback) {
@@ -1176,9 +1229,7 @@ static int snd_usb_pcm_open(struct snd_pcm_substream *substream)
 	/* runtime PM is also done there */
 
 	/* initialize DSD/DOP context */
-	subs->dsd_dop.byte_idx = 0;
-	subs->dsd_dop.channel = 0;
-	subs->dsd_dop.marker = 1;
+	subs->dsd_dop.marker = 0xfa;
 
 	ret = setup_hw_info(runtime, subs);
 	if (ret < 0)
@@ -1273,6 +1324,7 @@ static void retire_capture_urb(struct snd_usb_substream *subs,
 
 		/* realign last_frame_number */
 		subs->last_frame_number = current_frame_number;
+		subs->last_frame_time = ktime_get();
 
 		spin_unlock_irqrestore(&subs->lock, flags);
 		/* copy a data chunk */
@@ -1306,12 +1358,12 @@ static inline void fill_playback_urb_dsd_dop(struct snd_usb_substream *subs,
 					     struct urb *urb, unsigned int bytes)
 {
 	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
-	unsigned int dst_idx = 0;
+	unsigned int channels = runtime->channels;
 	unsigned int src_idx = subs->hwptr_done;
 	unsigned int wrap = subs->buffer_bytes;
+	unsigned int frames = bytes / (channels * 3);
 	u8 *dst = urb->transfer_buffer;
 	u8 *src = runtime->dma_area;
-	static const u8 marker[] = { 0x05, 0xfa };
 	unsigned int queued = 0;
 
 	/*
@@ -1328,31 +1380,26 @@ static inline void fill_playback_urb_dsd_dop(struct snd_usb_substream *subs,
 	 *   L5 L6 0x05   R5 R6 0x05   L7 L8 0xfa  R7 R8 0xfa
 	 *   .....
 	 *
+	 * URBs always carry whole frames, and the PCM buffer holds whole
+	 * frames, so the buffer wraps on a frame boundary.
 	 */
 
-	while (bytes--) {
-		if (++subs->dsd_dop.byte_idx == 3) {
-			/* frame boundary? */
-			dst[dst_idx++] = marker[subs->dsd_dop.marker];
-			src_idx += 2;
-			subs->dsd_dop.byte_idx = 0;
-
-			if (++subs->dsd_dop.channel % runtime->channels == 0) {
-				/* alternate the marker */
-				subs->dsd_dop.marker++;
-				subs->dsd_dop.marker %= ARRAY_SIZE(marker);
-				subs->dsd_dop.channel = 0;
-			}
-		} else {
-			/* stuff the DSD payload */
-			int idx = (src_idx + subs->dsd_dop.byte_idx - 1) % wrap;
-
-			if (subs->cur_audiofmt->dsd_bitrev)
-				dst[dst_idx++] = bitrev8(src[idx]);
-			else
-				dst[dst_idx++] = src[idx];
-			queued++;
-		}
+	while (frames) {
+		unsigned int n = min(frames, (wrap - src_idx) / (channels * 2));
+
+		if (WARN_ON_ONCE(!n))
+			break;
+		subs->dsd_dop.marker =
+			snd_pcm_dsd_dop_encode(dst, src + src_idx, n, channels,
+					       subs->dsd_dop.marker,
+					       subs->cur_audiofmt->dsd_bitrev);
+
+		dst += n * channels * 3;
+		src_idx += n * channels * 2;
+		if (src_idx >= wrap)
+			src_idx = 0;
+		queued += n * channels * 2;
+		frames -= n;
 	}
 
 	urb_ctx_queue_advance(subs, urb, queued);
@@ -1365,12 +1412,17 @@ static void fill_playback_urb_dsd_bitrev(struct snd_usb_substream *subs,
 	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
 	const u8 *src = runtime->dma_area;
 	u8 *buf = urb->transfer_buffer;
-	int i, ofs = subs->hwptr_done;
-
-	for (i = 0; i < bytes; i++) {
-		*buf++ = bitrev8(src[ofs]);
-		if (++ofs >= subs->buffer_bytes)
+	unsigned int ofs = subs->hwptr_done;
+	unsigned int n, left = bytes;
+
+	while (left) {
+		n = min(left, subs->buffer_bytes - ofs);
+		snd_pcm_dsd_bitrev(buf, src + ofs, n);
+		buf += n;
+		ofs += n;
+		if (ofs >= subs->buffer_bytes)
 			ofs = 0;
+		left -= n;
 	}
 
 	urb_ctx_queue_advance(subs, urb, bytes);
@@ -1397,6 +1449,24 @@ static void copy_to_urb(struct snd_usb_substream *subs, struct urb *urb,
 	urb_ctx_queue_advance(subs, urb, bytes);
 }
 
+/*
+ * let the URB transfer straight from the PCM buffer; returns false if
+ * the data wraps around the buffer end and has to be copied instead
+ */
+static bool map_to_urb(struct snd_usb_substream *subs, struct urb *urb,
+		       unsigned int bytes)
+{
+	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
+
+	if (subs->hwptr_done + bytes > subs->buffer_bytes)
+		return false;
+
+	urb->transfer_buffer = runtime->dma_area + subs->hwptr_done;
+	urb->transfer_dma = runtime->dma_addr + subs->hwptr_done;
+	urb_ctx_queue_advance(subs, urb, bytes);
+	return true;
+}
+
 static unsigned int copy_to_urb_quirk(struct snd_usb_substream *subs,
 				      struct urb *urb, int stride,
 				      unsigned int bytes)
@@ -1515,6 +1585,8 @@ static int prepare_playback_urb(struct snd_usb_substream *subs,
 	} else if (unlikely(ep->cur_format == SNDRV_PCM_FORMAT_DSD_U8 &&
 			   subs->cur_audiofmt->dsd_bitrev)) {
 		fill_playback_urb_dsd_bitrev(subs, urb, bytes);
+	} else if (subs->zero_copy_playback && map_to_urb(subs, urb, bytes)) {
+		/* the URB transfers straight from the PCM buffer */
 	} else {
 		/* usual PCM */
 		if (!subs->tx_length_quirk)
@@ -1525,6 +1597,7 @@ static int prepare_playback_urb(struct snd_usb_substream *subs,
 	}
 
 	subs->last_frame_number = usb_get_current_frame_number(subs->dev);
+	subs->last_frame_time = ktime_get();
 
 	if (subs->trigger_tstamp_pending_update) {
 		/* this is the first actual URB submitted,
@@ -1534,6 +1607,10 @@ static int prepare_playback_urb(struct snd_usb_substream *subs,
 		subs->trigger_tstamp_pending_update = false;
 	}
 
+	/* the pointer moves only when the URBs are retired */
+	if (subs->zero_copy_playback)
+		period_elapsed = 0;
+
 	if (period_elapsed && !subs->running && subs->lowlatency_playback) {
 		subs->period_elapsed_pending = 1;
 		period_elapsed = 0;
@@ -1562,7 +1639,9 @@ static void retire_playback_urb(struct snd_usb_substream *subs,
 {
 	unsigned long flags;
 	struct snd_urb_ctx *ctx = urb->context;
+	struct snd_pcm_runtime *runtime = subs->pcm_substream->runtime;
 	bool period_elapsed = false;
+	unsigned int period_bytes;
 
 	spin_lock_irqsave(&subs->lock, flags);
 	if (ctx->queued) {
@@ -1570,11 +1649,22 @@ static void retire_playback_urb(struct snd_usb_substream *subs,
 			subs->inflight_bytes -= ctx->queued;
 		else
 			subs->inflight_bytes = 0;
+
+		if (subs->zero_copy_playback) {
+			period_bytes = frames_to_bytes(runtime,
+						       runtime->period_size);
+			subs->zero_copy_done += ctx->queued;
+			if (subs->zero_copy_done >= period_bytes) {
+				subs->zero_copy_done %= period_bytes;
+				period_elapsed = true;
+			}
+		}
 	}
 
 	subs->last_frame_number = usb_get_current_frame_number(subs->dev);
-	if (subs->running) {
-		period_elapsed = subs->period_elapsed_pending;
+	subs->last_frame_time = ktime_get();
+	if (subs->running && subs->period_elapsed_pending) {
+		period_elapsed = true;
 		subs->period_elapsed_pending = 0;
 	}
 	spin_unlock_irqrestore(&subs->lock, flags);
@@ -1677,6 +1767,7 @@ static int snd_usb_substream_capture_trigger(struct snd_pcm_substream *substream
 					      NULL, retire_capture_urb,
 					      subs);
 		subs->last_frame_number = usb_get_current_frame_number(subs->dev);
+		subs->last_frame_time = ktime_get();
 		subs->running = 1;
 		dev_dbg(&subs->dev->dev, "%d:%d Start Capture PCM\n",
 			subs->cur_audiofmt->iface,
@@ -1737,7 +1828,11 @@ void snd_usb_preallocate_buffer(struct snd_usb_substream *subs)
 	struct snd_pcm_substream *s = pcm->streams[subs->direction].substream;
 	struct device *dev = subs->dev->bus->sysdev;
 
-	if (snd_usb_use_vmalloc)
+	/* zero-copy playback needs a buffer the host controller can read */
+	if (snd_usb_zero_copy && subs->direction == SNDRV_PCM_STREAM_PLAYBACK)
+		snd_pcm_set_managed_buffer(s, SNDRV_DMA_TYPE_DEV,
+					   dev, 64*1024, 512*1024);
+	else if (snd_usb_use_vmalloc)
 		snd_pcm_set_managed_buffer(s, SNDRV_DMA_TYPE_VMALLOC,
 					   NULL, 0, 0);
 	else
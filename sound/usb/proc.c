@@ -177,11 +177,20 @@ static void proc_dump_ep_status(struct snd_usb_substream *subs,
 	if (!data_ep)
 		return;
 	snd_iprintf(buffer, "    Packet Size = %d\n", data_ep->curpacksize);
+	snd_iprintf(buffer, "    URBs = %d x %d packets\n",
+		    data_ep->nurbs, data_ep->urb[0].packets);
 	snd_iprintf(buffer, "    Momentary freq = %u Hz (%#x.%04x)\n",
 		    subs->speed == USB_SPEED_FULL
 		    ? get_full_speed_hz(data_ep->freqm)
 		    : get_high_speed_hz(data_ep->freqm),
 		    data_ep->freqm >> 16, data_ep->freqm & 0xffff);
+	if (sync_ep && data_ep->fb_pll)
+		snd_iprintf(buffer, "    Estimated freq = %u Hz (%+lld ppm)\n",
+			    subs->speed == USB_SPEED_FULL
+			    ? get_full_speed_hz(data_ep->pll_freq)
+			    : get_high_speed_hz(data_ep->pll_freq),
+			    div_s64(((s64)data_ep->pll_freq - data_ep->freqn) * 1000000,
+				    data_ep->freqn));
 	if (sync_ep && data_ep->freqshift != INT_MIN) {
 		int res = 16 - data_ep->freqshift;
 		snd_iprintf(buffer, "    Feedback Format = %d.%d\n",
@@ -58,6 +58,8 @@ struct snd_usb_audio {
 	bool autoclock;			/* from the 'autoclock' module param */
 
 	bool lowlatency;		/* from the 'lowlatency' module param */
+	bool period_urbs;		/* from the 'period_urbs' module param */
+	bool fb_pll;			/* from the 'fb_pll' module param */
 	struct usb_host_interface *ctrl_intf;	/* the audio control interface */
 	struct media_device *media_dev;
 	struct media_intf_devnode *ctl_intf_media_devnode;
@@ -125,6 +127,7 @@ void snd_usb_unlock_shutdown(struct snd_usb_audio *chip);
 
 extern bool snd_usb_use_vmalloc;
 extern bool snd_usb_skip_validation;
+extern bool snd_usb_zero_copy;
 
 /*
  * Driver behavior quirk flags, stored in chip->quirk_flags
@@ -178,6 +181,9 @@ extern bool snd_usb_skip_validation;
  * QUIRK_FLAG_FIXED_RATE
  *  Do not set PCM rate (frequency) when only one rate is available
  *  for the given endpoint.
+ * QUIRK_FLAG_MIXER_LAZY_INIT
+ *  Don't query the mixer ranges and current values at probe, but when a
+ *  control is first accessed; speeds up probing devices with many controls
  */
 
 #define QUIRK_FLAG_GET_SAMPLE_RATE	(1U << 0)
@@ -202,5 +208,6 @@ extern bool snd_usb_skip_validation;
 #define QUIRK_FLAG_IFACE_SKIP_CLOSE	(1U << 19)
 #define QUIRK_FLAG_FORCE_IFACE_RESET	(1U << 20)
 #define QUIRK_FLAG_FIXED_RATE		(1U << 21)
+#define QUIRK_FLAG_MIXER_LAZY_INIT	(1U << 22)
 
 #endif /* __USBAUDIO_H */
@@ -1222,7 +1222,7 @@ enum {
  * BPF_MAP_TYPE_LRU_[PERCPU_]HASH map, use a percpu LRU list
  * which can scale and perform better.
  * Note, the LRU nodes (including free nodes) cannot be moved
- * across different LRU lists.
+ * across different LRU lists, unless BPF_F_LRU_SHARE_FREE is set.
  */
 	BPF_F_NO_COMMON_LRU	= (1U << 1),
 /* Specify numa node during map creation */
@@ -1253,6 +1253,18 @@ enum {
 
 /* Create a map that is suitable to be an inner map with dynamic max entries */
 	BPF_F_INNER_MAP		= (1U << 12),
+
+/* Ring buffer overwriting its oldest records when full, read in snapshots.
+ * The producer page holds producer_pos, overwrite_pos and snapshot_pos, in
+ * that order. User-space releases a snapshot by moving consumer_pos to
+ * snapshot_pos.
+ */
+	BPF_F_RB_OVERWRITE	= (1U << 13),
+
+/* With BPF_F_NO_COMMON_LRU, a CPU whose LRU list has no free node left
+ * takes some from the other CPUs' lists before it evicts its own.
+ */
+	BPF_F_LRU_SHARE_FREE	= (1U << 14),
 };
 
 /* Flags for BPF_PROG_QUERY. */
@@ -1324,6 +1336,10 @@ union bpf_attr {
 		 * BPF_MAP_TYPE_BLOOM_FILTER - the lowest 4 bits indicate the
 		 * number of hash functions (if 0, the bloom filter will default
 		 * to using 5 hash functions).
+		 *
+		 * BPF_MAP_TYPE_RINGBUF - adaptive notifications are only sent
+		 * once more than this many bytes are pending (if 0, as soon as
+		 * there is data).
 		 */
 		__u64	map_extra;
 	};
@@ -4231,7 +4247,14 @@ union bpf_attr {
  * 		An adaptive notification is a notification sent whenever the user-space
  * 		process has caught up and consumed all available payloads. In case the user-space
  * 		process is still processing a previous payload, then no notification is needed
- * 		as it will process the newly added payload automatically.
+ * 		as it will process the newly added payload automatically. If the
+ * 		ring buffer was created with a non-zero *map_extra*, the user-space
+ * 		process is notified once more than *map_extra* bytes are pending instead.
+ *
+ * 		With a **BPF_F_RB_OVERWRITE** ring buffer, there are no adaptive
+ * 		notifications: if **BPF_RB_SNAPSHOT** is specified in *flags*, the
+ * 		records now in the ring buffer are kept until user-space releases
+ * 		them, and it gets notified.
  * 	Return
  * 		0 on success, or a negative error in case of failure.
  *
@@ -4280,6 +4303,8 @@ union bpf_attr {
  *		* **BPF_RB_RING_SIZE**: The size of ring buffer.
  *		* **BPF_RB_CONS_POS**: Consumer position (can wrap around).
  *		* **BPF_RB_PROD_POS**: Producer(s) position (can wrap around).
+ *		* **BPF_RB_OVERWRITE_POS**: Position of the oldest record of a
+ *		  **BPF_F_RB_OVERWRITE** ring buffer (can wrap around).
  *
  *		Data returned is just a momentary snapshot of actual values
  *		and could be inaccurate, so this facility should be used to
@@ -5789,6 +5814,7 @@ enum {
 enum {
 	BPF_RB_NO_WAKEUP		= (1ULL << 0),
 	BPF_RB_FORCE_WAKEUP		= (1ULL << 1),
+	BPF_RB_SNAPSHOT			= (1ULL << 2),
 };
 
 /* BPF_FUNC_bpf_ringbuf_query flags */
@@ -5797,6 +5823,7 @@ enum {
 	BPF_RB_RING_SIZE = 1,
 	BPF_RB_CONS_POS = 2,
 	BPF_RB_PROD_POS = 3,
+	BPF_RB_OVERWRITE_POS = 4,
 };
 
 /* BPF ring buffer constants */
@@ -0,0 +1,554 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// kselftest benchmark for ALSA PCM latency
+//
+// This test will iterate over all PCM devices detected in the system and
+// run each of them with a range of period sizes, two periods per buffer,
+// recording the period wakeup jitter, the xruns and the CPU time spent per
+// period.  The smallest period size that runs without an xrun is reported
+// as the xrun threshold, and the test fails if none of them does.
+//
+// When PCM_LATENCY_PLAYBACK and PCM_LATENCY_CAPTURE name two PCMs joined
+// by a loopback cable (e.g. "hw:0,0"), the round trip latency between them
+// is measured too, by playing a pulse and looking for it in the capture.
+//
+// Results are printed as "# RESULT <test> key=value ..." lines so that
+// runs on different kernels can be compared by a script.  As it opens every
+// PCM it finds it is best run on a system with a minimal active userspace.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <alsa/asoundlib.h>
+
+#include "../kselftest.h"
+
+#define TEST_RATE		48000
+#define TEST_PERIODS		2
+#define TEST_DURATION_MS	1000
+#define TEST_FORMAT		SND_PCM_FORMAT_S16_LE
+
+#define RT_PERIOD_FRAMES	256
+#define RT_PERIODS		4
+#define RT_PULSE_AT		(TEST_RATE / 4)
+#define RT_PULSE_FRAMES		16
+#define RT_THRESHOLD		8192
+#define RT_TIMEOUT_MS		2000
+
+static const snd_pcm_uframes_t period_sizes[] = {
+	32, 64, 128, 256, 512, 1024,
+};
+
+struct pcm_data {
+	int card;
+	int device;
+	snd_pcm_stream_t stream;
+	struct pcm_data *next;
+};
+
+struct run_stats {
+	snd_pcm_uframes_t period_size;
+	unsigned int rate;
+	unsigned int wakeups;
+	unsigned int xruns;
+	unsigned long long jitter_max_us;
+	unsigned long long jitter_sum_us;
+	unsigned long long cpu_us;
+	unsigned long long frames;
+};
+
+static int num_pcms;
+static struct pcm_data *pcm_list;
+
+static void find_pcms(void)
+{
+	char name[32];
+	int card, device, err;
+	snd_ctl_t *handle;
+	snd_pcm_info_t *info;
+	snd_pcm_stream_t stream;
+	struct pcm_data *pcm_data;
+
+	snd_pcm_info_alloca(&info);
+
+	card = -1;
+	if (snd_card_next(&card) < 0 || card < 0)
+		return;
+
+	while (card >= 0) {
+		sprintf(name, "hw:%d", card);
+
+		err = snd_ctl_open(&handle, name, 0);
+		if (err < 0) {
+			ksft_print_msg("Failed to get control for card %d: %s\n",
+				       card, snd_strerror(err));
+			goto next_card;
+		}
+
+		device = -1;
+		while (snd_ctl_pcm_next_device(handle, &device) >= 0 &&
+		       device >= 0) {
+			for (stream = SND_PCM_STREAM_PLAYBACK;
+			     stream <= SND_PCM_STREAM_CAPTURE; stream++) {
+				snd_pcm_info_set_device(info, device);
+				snd_pcm_info_set_subdevice(info, 0);
+				snd_pcm_info_set_stream(info, stream);
+				if (snd_ctl_pcm_info(handle, info) < 0)
+					continue;
+
+				pcm_data = calloc(1, sizeof(*pcm_data));
+				if (!pcm_data)
+					ksft_exit_fail_msg("Out of memory\n");
+
+				pcm_data->card = card;
+				pcm_data->device = device;
+				pcm_data->stream = stream;
+				pcm_data->next = pcm_list;
+				pcm_list = pcm_data;
+				num_pcms++;
+			}
+		}
+
+		snd_ctl_close(handle);
+
+	next_card:
+		if (snd_card_next(&card) < 0) {
+			ksft_print_msg("snd_card_next");
+			break;
+		}
+	}
+}
+
+static int setup_pcm(snd_pcm_t *handle, snd_pcm_uframes_t *period_size,
+		     unsigned int periods, snd_pcm_uframes_t *buffer_size,
+		     unsigned int *rate, unsigned int *channels)
+{
+	snd_pcm_hw_params_t *hw_params;
+	snd_pcm_sw_params_t *sw_params;
+	int err;
+
+	snd_pcm_hw_params_alloca(&hw_params);
+	snd_pcm_sw_params_alloca(&sw_params);
+
+	*rate = TEST_RATE;
+
+	err = snd_pcm_hw_params_any(handle, hw_params);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_rate_resample(handle, hw_params, 0);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_access(handle, hw_params,
+					   SND_PCM_ACCESS_RW_INTERLEAVED);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_format(handle, hw_params, TEST_FORMAT);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_channels_first(handle, hw_params,
+						   channels);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_rate_near(handle, hw_params, rate, NULL);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_period_size(handle, hw_params,
+						*period_size, 0);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_periods(handle, hw_params, periods, 0);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params(handle, hw_params);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_get_buffer_size(hw_params, buffer_size);
+	if (err < 0)
+		return err;
+
+	err = snd_pcm_sw_params_current(handle, sw_params);
+	if (err < 0)
+		return err;
+	/* start explicitly, wake up once per period */
+	err = snd_pcm_sw_params_set_start_threshold(handle, sw_params,
+						    *buffer_size * 2);
+	if (err < 0)
+		return err;
+	err = snd_pcm_sw_params_set_avail_min(handle, sw_params, *period_size);
+	if (err < 0)
+		return err;
+
+	return snd_pcm_sw_params(handle, sw_params);
+}
+
+static unsigned long long now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+static unsigned long long cpu_us(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+		usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static snd_pcm_sframes_t transfer(snd_pcm_t *handle, snd_pcm_stream_t stream,
+				  void *buf, snd_pcm_uframes_t frames)
+{
+	if (stream == SND_PCM_STREAM_PLAYBACK)
+		return snd_pcm_writei(handle, buf, frames);
+	return snd_pcm_readi(handle, buf, frames);
+}
+
+/* Restarts the stream after an xrun, with a full buffer for playback */
+static int recover(snd_pcm_t *handle, snd_pcm_stream_t stream, void *buf,
+		   snd_pcm_uframes_t buffer_size)
+{
+	snd_pcm_sframes_t done;
+	int err;
+
+	err = snd_pcm_prepare(handle);
+	if (err < 0)
+		return err;
+
+	if (stream == SND_PCM_STREAM_PLAYBACK) {
+		done = snd_pcm_writei(handle, buf, buffer_size);
+		if (done < 0)
+			return done;
+	}
+
+	return snd_pcm_start(handle);
+}
+
+static int run_pcm(const char *name, snd_pcm_stream_t stream,
+		   snd_pcm_uframes_t period_size, struct run_stats *stats)
+{
+	unsigned long long start, last, now, period_us, jitter, cpu_start;
+	snd_pcm_uframes_t buffer_size;
+	unsigned int rate, channels;
+	snd_pcm_sframes_t avail, done;
+	snd_pcm_t *handle;
+	void *buf = NULL;
+	int err;
+
+	memset(stats, 0, sizeof(*stats));
+
+	err = snd_pcm_open(&handle, name, stream, 0);
+	if (err < 0)
+		return err;
+
+	err = setup_pcm(handle, &period_size, TEST_PERIODS, &buffer_size,
+			&rate, &channels);
+	if (err < 0)
+		goto out;
+
+	buf = calloc(buffer_size, snd_pcm_format_physical_width(TEST_FORMAT) /
+		     8 * channels);
+	if (!buf)
+		ksft_exit_fail_msg("Out of memory\n");
+
+	err = recover(handle, stream, buf, buffer_size);
+	if (err < 0)
+		goto out;
+
+	stats->period_size = period_size;
+	stats->rate = rate;
+	period_us = period_size * 1000000ULL / rate;
+	cpu_start = cpu_us();
+	start = last = now_us();
+
+	while (last - start < TEST_DURATION_MS * 1000ULL) {
+		err = snd_pcm_wait(handle, 1000);
+		now = now_us();
+		if (err == 0) {
+			err = -ETIMEDOUT;
+			goto out;
+		}
+
+		avail = err < 0 ? err : snd_pcm_avail_update(handle);
+		if (avail == -EPIPE || avail == -ESTRPIPE) {
+			stats->xruns++;
+			err = recover(handle, stream, buf, buffer_size);
+			if (err < 0)
+				goto out;
+			last = now_us();
+			continue;
+		}
+		if (avail < 0) {
+			err = avail;
+			goto out;
+		}
+
+		jitter = now - last > period_us ? now - last - period_us :
+						  period_us - (now - last);
+		if (jitter > stats->jitter_max_us)
+			stats->jitter_max_us = jitter;
+		stats->jitter_sum_us += jitter;
+		stats->wakeups++;
+		last = now;
+
+		done = transfer(handle, stream, buf, avail);
+		if (done == -EPIPE) {
+			stats->xruns++;
+			err = recover(handle, stream, buf, buffer_size);
+			if (err < 0)
+				goto out;
+			last = now_us();
+			continue;
+		}
+		if (done < 0) {
+			err = done;
+			goto out;
+		}
+		stats->frames += done;
+	}
+
+	stats->cpu_us = cpu_us() - cpu_start;
+	err = 0;
+
+	snd_pcm_drop(handle);
+out:
+	free(buf);
+	snd_pcm_close(handle);
+	return err;
+}
+
+static void test_pcm_latency(struct pcm_data *pcm)
+{
+	const char *dir = pcm->stream == SND_PCM_STREAM_PLAYBACK ?
+		"playback" : "capture";
+	snd_pcm_uframes_t threshold = 0;
+	struct run_stats stats;
+	unsigned int i, runs = 0;
+	char name[32];
+	int err;
+
+	sprintf(name, "hw:%d,%d", pcm->card, pcm->device);
+
+	for (i = 0; i < ARRAY_SIZE(period_sizes); i++) {
+		err = run_pcm(name, pcm->stream, period_sizes[i], &stats);
+		if (err == -EINVAL)
+			continue;	/* period size not supported */
+		if (err < 0) {
+			ksft_print_msg("%s.%s: period %lu failed: %s\n",
+				       name, dir, period_sizes[i],
+				       snd_strerror(err));
+			continue;
+		}
+		runs++;
+
+		ksft_print_msg("RESULT pcm_latency.%d.%d.%s period=%lu rate=%u wakeups=%u xruns=%u jitter_max_us=%llu jitter_avg_us=%llu cpu_us_per_period=%llu\n",
+			       pcm->card, pcm->device, dir,
+			       stats.period_size, stats.rate, stats.wakeups,
+			       stats.xruns, stats.jitter_max_us,
+			       stats.wakeups ?
+			       stats.jitter_sum_us / stats.wakeups : 0,
+			       stats.frames ? stats.cpu_us *
+			       stats.period_size / stats.frames : 0);
+
+		if (!stats.xruns && !threshold)
+			threshold = stats.period_size;
+	}
+
+	if (!runs) {
+		ksft_test_result_skip("pcm_latency.%d.%d.%s\n",
+				      pcm->card, pcm->device, dir);
+		return;
+	}
+
+	ksft_print_msg("RESULT pcm_latency.%d.%d.%s xrun_threshold=%lu\n",
+		       pcm->card, pcm->device, dir, threshold);
+	ksft_test_result(threshold, "pcm_latency.%d.%d.%s\n",
+			 pcm->card, pcm->device, dir);
+}
+
+/* Returns the first frame with a sample above the threshold, or -1 */
+static long find_pulse(const short *buf, snd_pcm_uframes_t frames,
+		       unsigned int channels)
+{
+	snd_pcm_uframes_t i;
+
+	for (i = 0; i < frames * channels; i++)
+		if (abs(buf[i]) >= RT_THRESHOLD)
+			return i / channels;
+
+	return -1;
+}
+
+static int round_trip(const char *play_name, const char *cap_name,
+		      unsigned int *rate, long *latency)
+{
+	snd_pcm_uframes_t period_size = RT_PERIOD_FRAMES, cap_period;
+	snd_pcm_uframes_t buffer_size, cap_buffer_size, i;
+	unsigned long long played = 0, captured = 0, skip, start;
+	unsigned int play_channels, cap_channels, cap_rate;
+	short *play_buf = NULL, *cap_buf = NULL;
+	snd_pcm_t *play, *cap = NULL;
+	snd_pcm_sframes_t avail, done;
+	long pulse;
+	int err;
+
+	*latency = -1;
+
+	err = snd_pcm_open(&play, play_name, SND_PCM_STREAM_PLAYBACK,
+			   SND_PCM_NONBLOCK);
+	if (err < 0)
+		return err;
+	err = snd_pcm_open(&cap, cap_name, SND_PCM_STREAM_CAPTURE,
+			   SND_PCM_NONBLOCK);
+	if (err < 0)
+		goto out;
+
+	err = setup_pcm(play, &period_size, RT_PERIODS, &buffer_size,
+			rate, &play_channels);
+	if (err < 0)
+		goto out;
+	cap_period = period_size;
+	err = setup_pcm(cap, &cap_period, RT_PERIODS, &cap_buffer_size,
+			&cap_rate, &cap_channels);
+	if (err < 0)
+		goto out;
+	if (cap_rate != *rate) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	play_buf = calloc(period_size, play_channels * sizeof(short));
+	cap_buf = calloc(cap_buffer_size, cap_channels * sizeof(short));
+	if (!play_buf || !cap_buf)
+		ksft_exit_fail_msg("Out of memory\n");
+
+	/* start both at the same frame */
+	err = snd_pcm_link(play, cap);
+	if (err < 0)
+		goto out;
+
+	while (played < buffer_size) {
+		done = snd_pcm_writei(play, play_buf, period_size);
+		if (done < 0) {
+			err = done;
+			goto out;
+		}
+		played += done;
+	}
+
+	err = snd_pcm_start(play);
+	if (err < 0)
+		goto out;
+
+	start = now_us();
+	while (now_us() - start < RT_TIMEOUT_MS * 1000ULL) {
+		snd_pcm_wait(play, 100);
+
+		avail = snd_pcm_avail_update(play);
+		if (avail < 0) {
+			err = avail;
+			goto out;
+		}
+		while (avail >= (snd_pcm_sframes_t)period_size) {
+			memset(play_buf, 0,
+			       period_size * play_channels * sizeof(short));
+			for (i = 0; i < period_size; i++)
+				if (played + i >= RT_PULSE_AT &&
+				    played + i < RT_PULSE_AT + RT_PULSE_FRAMES)
+					play_buf[i * play_channels] = 0x7fff;
+			done = snd_pcm_writei(play, play_buf, period_size);
+			if (done < 0) {
+				err = done;
+				goto out;
+			}
+			played += done;
+			avail -= done;
+		}
+
+		done = snd_pcm_readi(cap, cap_buf, cap_buffer_size);
+		if (done == -EAGAIN)
+			continue;
+		if (done < 0) {
+			err = done;
+			goto out;
+		}
+
+		/* nothing before the pulse was played can be the pulse */
+		skip = captured < RT_PULSE_AT ? RT_PULSE_AT - captured : 0;
+		if (skip < (unsigned long long)done) {
+			pulse = find_pulse(cap_buf + skip * cap_channels,
+					   done - skip, cap_channels);
+			if (pulse >= 0) {
+				*latency = captured + skip + pulse - RT_PULSE_AT;
+				break;
+			}
+		}
+		captured += done;
+	}
+
+	err = *latency < 0 ? -ETIMEDOUT : 0;
+	snd_pcm_drop(play);
+out:
+	free(play_buf);
+	free(cap_buf);
+	if (cap)
+		snd_pcm_close(cap);
+	snd_pcm_close(play);
+	return err;
+}
+
+static void test_round_trip(void)
+{
+	const char *play_name = getenv("PCM_LATENCY_PLAYBACK");
+	const char *cap_name = getenv("PCM_LATENCY_CAPTURE");
+	unsigned int rate;
+	long latency;
+	int err;
+
+	if (!play_name || !cap_name) {
+		ksft_print_msg("PCM_LATENCY_PLAYBACK and PCM_LATENCY_CAPTURE not set, no loopback\n");
+		ksft_test_result_skip("round_trip\n");
+		return;
+	}
+
+	err = round_trip(play_name, cap_name, &rate, &latency);
+	if (err < 0) {
+		ksft_print_msg("%s -> %s: %s\n", play_name, cap_name,
+			       snd_strerror(err));
+		ksft_test_result_fail("round_trip\n");
+		return;
+	}
+
+	ksft_print_msg("RESULT round_trip playback=%s capture=%s period=%d periods=%d rate=%u latency_frames=%ld latency_us=%llu\n",
+		       play_name, cap_name, RT_PERIOD_FRAMES, RT_PERIODS, rate,
+		       latency, latency * 1000000ULL / rate);
+	ksft_test_result_pass("round_trip\n");
+}
+
+int main(void)
+{
+	struct pcm_data *pcm;
+
+	ksft_print_header();
+
+	find_pcms();
+
+	ksft_set_plan(num_pcms + 1);
+
+	for (pcm = pcm_list; pcm != NULL; pcm = pcm->next)
+		test_pcm_latency(pcm);
+
+	test_round_trip();
+
+	ksft_exit_pass();
+
+	return 0;
+}
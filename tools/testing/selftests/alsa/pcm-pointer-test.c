@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// kselftest for the ALSA PCM hardware pointer
+//
+// This test will iterate over all PCM devices detected in the system,
+// run each of them with small periods and sample the hardware position
+// much more often than the period interrupts happen.  The position must
+// never move backwards or skip ahead by more than a buffer, which is
+// what a timer driven application relies on.  As it opens every PCM it
+// finds it is best run on a system with a minimal active userspace.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <alsa/asoundlib.h>
+
+#include "../kselftest.h"
+
+#define TEST_RATE		48000
+#define TEST_PERIOD_FRAMES	64
+#define TEST_PERIODS		4
+#define TEST_DURATION_MS	500
+#define TEST_SAMPLE_US		100
+
+struct pcm_data {
+	int card;
+	int device;
+	snd_pcm_stream_t stream;
+	struct pcm_data *next;
+};
+
+static int num_pcms;
+static struct pcm_data *pcm_list;
+
+static void find_pcms(void)
+{
+	char name[32];
+	int card, device, err;
+	snd_ctl_t *handle;
+	snd_pcm_info_t *info;
+	snd_pcm_stream_t stream;
+	struct pcm_data *pcm_data;
+
+	snd_pcm_info_alloca(&info);
+
+	card = -1;
+	if (snd_card_next(&card) < 0 || card < 0)
+		return;
+
+	while (card >= 0) {
+		sprintf(name, "hw:%d", card);
+
+		err = snd_ctl_open(&handle, name, 0);
+		if (err < 0) {
+			ksft_print_msg("Failed to get control for card %d: %s\n",
+				       card, snd_strerror(err));
+			goto next_card;
+		}
+
+		device = -1;
+		while (snd_ctl_pcm_next_device(handle, &device) >= 0 &&
+		       device >= 0) {
+			for (stream = SND_PCM_STREAM_PLAYBACK;
+			     stream <= SND_PCM_STREAM_CAPTURE; stream++) {
+				snd_pcm_info_set_device(info, device);
+				snd_pcm_info_set_subdevice(info, 0);
+				snd_pcm_info_set_stream(info, stream);
+				if (snd_ctl_pcm_info(handle, info) < 0)
+					continue;
+
+				pcm_data = calloc(1, sizeof(*pcm_data));
+				if (!pcm_data)
+					ksft_exit_fail_msg("Out of memory\n");
+
+				pcm_data->card = card;
+				pcm_data->device = device;
+				pcm_data->stream = stream;
+				pcm_data->next = pcm_list;
+				pcm_list = pcm_data;
+				num_pcms++;
+			}
+		}
+
+		snd_ctl_close(handle);
+
+	next_card:
+		if (snd_card_next(&card) < 0) {
+			ksft_print_msg("snd_card_next");
+			break;
+		}
+	}
+}
+
+static int setup_pcm(snd_pcm_t *handle, snd_pcm_uframes_t *buffer_size,
+		     unsigned int *frame_bytes)
+{
+	snd_pcm_hw_params_t *hw_params;
+	snd_pcm_sw_params_t *sw_params;
+	snd_pcm_uframes_t period_size = TEST_PERIOD_FRAMES;
+	unsigned int rate = TEST_RATE;
+	unsigned int channels;
+	snd_pcm_format_t format;
+	int err;
+
+	snd_pcm_hw_params_alloca(&hw_params);
+	snd_pcm_sw_params_alloca(&sw_params);
+
+	err = snd_pcm_hw_params_any(handle, hw_params);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_rate_resample(handle, hw_params, 0);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_access(handle, hw_params,
+					   SND_PCM_ACCESS_RW_INTERLEAVED);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_format_first(handle, hw_params, &format);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_channels_first(handle, hw_params,
+						   &channels);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_rate_near(handle, hw_params, &rate, NULL);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_period_size_near(handle, hw_params,
+						     &period_size, NULL);
+	if (err < 0)
+		return err;
+	*buffer_size = period_size * TEST_PERIODS;
+	err = snd_pcm_hw_params_set_buffer_size_near(handle, hw_params,
+						     buffer_size);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params(handle, hw_params);
+	if (err < 0)
+		return err;
+
+	err = snd_pcm_sw_params_current(handle, sw_params);
+	if (err < 0)
+		return err;
+	/* start explicitly, stop only on real xruns */
+	err = snd_pcm_sw_params_set_start_threshold(handle, sw_params,
+						    *buffer_size * 2);
+	if (err < 0)
+		return err;
+	err = snd_pcm_sw_params(handle, sw_params);
+	if (err < 0)
+		return err;
+
+	*frame_bytes = snd_pcm_format_physical_width(format) / 8 * channels;
+
+	return 0;
+}
+
+static unsigned long long elapsed_us(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000ULL +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void test_pcm_pointer(struct pcm_data *pcm)
+{
+	const char *dir = pcm->stream == SND_PCM_STREAM_PLAYBACK ?
+		"playback" : "capture";
+	const struct timespec sample = { 0, TEST_SAMPLE_US * 1000 };
+	snd_pcm_uframes_t buffer_size;
+	unsigned long long appl = 0, hw, last_hw = 0;
+	unsigned int frame_bytes, samples = 0;
+	bool fail = false, skip = false;
+	struct timespec start;
+	snd_pcm_sframes_t avail, done;
+	snd_pcm_t *handle;
+	char name[32];
+	void *buf;
+	int err;
+
+	sprintf(name, "hw:%d,%d", pcm->card, pcm->device);
+
+	err = snd_pcm_open(&handle, name, pcm->stream, SND_PCM_NONBLOCK);
+	if (err < 0) {
+		ksft_print_msg("%s.%s: unable to open: %s\n",
+			       name, dir, snd_strerror(err));
+		ksft_test_result_skip("pcm_pointer.%d.%d.%s\n",
+				      pcm->card, pcm->device, dir);
+		return;
+	}
+
+	err = setup_pcm(handle, &buffer_size, &frame_bytes);
+	if (err < 0) {
+		ksft_print_msg("%s.%s: unable to configure: %s\n",
+			       name, dir, snd_strerror(err));
+		skip = true;
+		goto out;
+	}
+
+	buf = calloc(buffer_size, frame_bytes);
+	if (!buf)
+		ksft_exit_fail_msg("Out of memory\n");
+
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
+		done = snd_pcm_writei(handle, buf, buffer_size);
+		if (done < 0) {
+			ksft_print_msg("%s.%s: prefill failed: %s\n",
+				       name, dir, snd_strerror(done));
+			fail = true;
+			goto out_free;
+		}
+		appl = done;
+	}
+
+	err = snd_pcm_start(handle);
+	if (err < 0) {
+		ksft_print_msg("%s.%s: unable to start: %s\n",
+			       name, dir, snd_strerror(err));
+		fail = true;
+		goto out_free;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (elapsed_us(&start) < TEST_DURATION_MS * 1000ULL) {
+		avail = snd_pcm_avail(handle);
+		if (avail < 0) {
+			ksft_print_msg("%s.%s: avail failed at %llu: %s\n",
+				       name, dir, appl, snd_strerror(avail));
+			fail = true;
+			break;
+		}
+
+		/* free-running hardware position derived from avail */
+		if (pcm->stream == SND_PCM_STREAM_PLAYBACK)
+			hw = appl + avail - buffer_size;
+		else
+			hw = appl + avail;
+
+		if (hw < last_hw) {
+			ksft_print_msg("%s.%s: pointer went back %llu -> %llu\n",
+				       name, dir, last_hw, hw);
+			fail = true;
+			break;
+		}
+		if (hw - last_hw > buffer_size) {
+			ksft_print_msg("%s.%s: pointer skipped %llu -> %llu\n",
+				       name, dir, last_hw, hw);
+			fail = true;
+			break;
+		}
+		last_hw = hw;
+		samples++;
+
+		/* keep the stream running, half a buffer at a time */
+		if (avail >= buffer_size / 2) {
+			if (pcm->stream == SND_PCM_STREAM_PLAYBACK)
+				done = snd_pcm_writei(handle, buf, avail);
+			else
+				done = snd_pcm_readi(handle, buf, avail);
+			if (done < 0) {
+				ksft_print_msg("%s.%s: transfer failed: %s\n",
+					       name, dir, snd_strerror(done));
+				fail = true;
+				break;
+			}
+			appl += done;
+		}
+
+		nanosleep(&sample, NULL);
+	}
+
+	if (!fail && !last_hw) {
+		ksft_print_msg("%s.%s: pointer did not move\n", name, dir);
+		fail = true;
+	}
+
+	if (!fail)
+		ksft_print_msg("%s.%s: %llu frames, %u samples\n",
+			       name, dir, last_hw, samples);
+
+	snd_pcm_drop(handle);
+out_free:
+	free(buf);
+out:
+	snd_pcm_close(handle);
+
+	if (skip)
+		ksft_test_result_skip("pcm_pointer.%d.%d.%s\n",
+				      pcm->card, pcm->device, dir);
+	else
+		ksft_test_result(!fail, "pcm_pointer.%d.%d.%s\n",
+				 pcm->card, pcm->device, dir);
+}
+
+int main(void)
+{
+	struct pcm_data *pcm;
+
+	ksft_print_header();
+
+	find_pcms();
+
+	ksft_set_plan(num_pcms);
+
+	for (pcm = pcm_list; pcm != NULL; pcm = pcm->next)
+		test_pcm_pointer(pcm);
+
+	ksft_exit_pass();
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0
+#define _GNU_SOURCE
+#include <test_progs.h>
+#include <sys/mman.h>
+#include "test_ringbuf_overwrite.skel.h"
+
+struct sample {
+	long seq;
+	char pad[24];
+};
+
+static void trigger_samples(int cnt)
+{
+	while (cnt--)
+		syscall(__NR_getpgid);
+}
+
+void test_ringbuf_overwrite(void)
+{
+	const size_t rec_sz = BPF_RINGBUF_HDR_SZ + sizeof(struct sample);
+	struct test_ringbuf_overwrite *skel;
+	int page_size = getpagesize();
+	/* enough records to wrap around the ring a few times */
+	int nr_samples = 4 * page_size / rec_sz;
+	unsigned long *cons_pos = MAP_FAILED;
+	unsigned long *prod_page = MAP_FAILED;
+	unsigned long snapshot_pos;
+	int err, rb_fd;
+
+	skel = test_ringbuf_overwrite__open();
+	if (!ASSERT_OK_PTR(skel, "skel_open"))
+		return;
+
+	err = bpf_map__set_max_entries(skel->maps.ringbuf, page_size);
+	if (!ASSERT_OK(err, "set_max_entries"))
+		goto cleanup;
+
+	err = test_ringbuf_overwrite__load(skel);
+	if (!ASSERT_OK(err, "skel_load"))
+		goto cleanup;
+
+	rb_fd = bpf_map__fd(skel->maps.ringbuf);
+	cons_pos = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			rb_fd, 0);
+	if (!ASSERT_OK_PTR(cons_pos, "mmap_cons_pos"))
+		goto cleanup;
+	prod_page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, rb_fd,
+			 page_size);
+	if (!ASSERT_OK_PTR(prod_page, "mmap_prod_page"))
+		goto cleanup;
+
+	skel->bss->pid = getpid();
+
+	err = test_ringbuf_overwrite__attach(skel);
+	if (!ASSERT_OK(err, "skel_attach"))
+		goto cleanup;
+
+	/* a full ring overwrites its oldest records instead of dropping */
+	trigger_samples(nr_samples);
+	ASSERT_EQ(skel->bss->total, nr_samples, "wrap_total");
+	ASSERT_EQ(skel->bss->dropped, 0, "wrap_dropped");
+	ASSERT_EQ(skel->bss->prod_pos, nr_samples * rec_sz, "wrap_prod_pos");
+	ASSERT_LE(skel->bss->prod_pos - skel->bss->over_pos, page_size,
+		  "wrap_over_pos");
+	ASSERT_EQ(prod_page[1], skel->bss->over_pos, "mmap_over_pos");
+
+	/* freeze the ring behind a snapshot */
+	skel->bss->flags = BPF_RB_SNAPSHOT;
+	trigger_samples(1);
+	skel->bss->flags = 0;
+	snapshot_pos = READ_ONCE(prod_page[2]);
+	ASSERT_EQ(snapshot_pos, prod_page[0], "snapshot_pos");
+
+	trigger_samples(1);
+	ASSERT_EQ(skel->bss->dropped, 1, "snapshot_dropped");
+
+	/* consuming up to the snapshot lets the producer go on */
+	WRITE_ONCE(*cons_pos, snapshot_pos);
+	trigger_samples(1);
+	ASSERT_EQ(skel->bss->dropped, 1, "released_dropped");
+	ASSERT_EQ(skel->bss->total, nr_samples + 2, "released_total");
+
+cleanup:
+	if (prod_page != MAP_FAILED)
+		munmap(prod_page, page_size);
+	if (cons_pos != MAP_FAILED)
+		munmap(cons_pos, page_size);
+	test_ringbuf_overwrite__destroy(skel);
+}
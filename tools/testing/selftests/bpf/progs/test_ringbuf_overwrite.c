@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+#include "bpf_misc.h"
+
+char _license[] SEC("license") = "GPL";
+
+struct sample {
+	long seq;
+	char pad[24];
+};
+
+struct {
+	__uint(type, BPF_MAP_TYPE_RINGBUF);
+	__uint(map_flags, BPF_F_RB_OVERWRITE);
+	/* libbpf will adjust to valid page size */
+	__uint(max_entries, 4096);
+} ringbuf SEC(".maps");
+
+/* inputs */
+int pid = 0;
+long flags = 0;
+
+/* outputs */
+long total = 0;
+long dropped = 0;
+
+long prod_pos = 0;
+long over_pos = 0;
+
+/* inner state */
+long seq = 0;
+
+SEC("fentry/" SYS_PREFIX "sys_getpgid")
+int test_ringbuf_overwrite(void *ctx)
+{
+	int cur_pid = bpf_get_current_pid_tgid() >> 32;
+	struct sample sample = {};
+
+	if (cur_pid != pid)
+		return 0;
+
+	sample.seq = seq++;
+	if (bpf_ringbuf_output(&ringbuf, &sample, sizeof(sample), flags)) {
+		__sync_fetch_and_add(&dropped, 1);
+		return 0;
+	}
+	__sync_fetch_and_add(&total, 1);
+
+	prod_pos = bpf_ringbuf_query(&ringbuf, BPF_RB_PROD_POS);
+	over_pos = bpf_ringbuf_query(&ringbuf, BPF_RB_OVERWRITE_POS);
+
+	return 0;
+}
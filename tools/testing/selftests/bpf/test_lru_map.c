@@ -846,6 +846,48 @@ static void test_lru_sanity8(int map_type, int map_flags)
 	printf("Pass\n");
 }
 
+/* Test that a BPF_F_LRU_SHARE_FREE map can be filled from a single CPU */
+static void test_lru_sanity9(int map_type, int map_flags)
+{
+	unsigned long long key, next_key, value[nr_cpus];
+	unsigned int map_size = 2 * nr_cpus;
+	unsigned int nr_keys = 0;
+	int lru_map_fd;
+	int next_cpu = 0;
+
+	printf("%s (map_type:%d map_flags:0x%X): ", __func__, map_type,
+	       map_flags);
+
+	assert(sched_next_online(0, &next_cpu) != -1);
+
+	lru_map_fd = create_map(map_type, map_flags, map_size);
+	assert(lru_map_fd != -1);
+
+	value[0] = 1234;
+
+	/* The free nodes of the other CPUs are used before evicting */
+	for (key = 1; key <= map_size; key++)
+		assert(!bpf_map_update_elem(lru_map_fd, &key, value,
+					    BPF_NOEXIST));
+
+	for (key = 1; key <= map_size; key++)
+		assert(!bpf_map_lookup_elem(lru_map_fd, &key, value));
+
+	/* Only then does the LRU remove an element */
+	assert(!bpf_map_update_elem(lru_map_fd, &key, value, BPF_NOEXIST));
+
+	key = 0;
+	while (!bpf_map_get_next_key(lru_map_fd, &key, &next_key)) {
+		nr_keys++;
+		key = next_key;
+	}
+	assert(nr_keys == map_size);
+
+	close(lru_map_fd);
+
+	printf("Pass\n");
+}
+
 int main(int argc, char **argv)
 {
 	int map_types[] = {BPF_MAP_TYPE_LRU_HASH,
@@ -881,5 +923,9 @@ int main(int argc, char **argv)
 		}
 	}
 
+	for (t = 0; t < ARRAY_SIZE(map_types); t++)
+		test_lru_sanity9(map_types[t],
+				 BPF_F_NO_COMMON_LRU | BPF_F_LRU_SHARE_FREE);
+
 	return 0;
 }
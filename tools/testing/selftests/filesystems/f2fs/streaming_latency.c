@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Write latency of an f2fs streaming writer
+ *
+ * A recorder writes a fixed size chunk at a fixed rate, as multitrack
+ * audio capture does, while another thread keeps creating and removing
+ * small files so that there is always garbage to collect and metadata to
+ * checkpoint.  This is done once as a plain writer and once registered
+ * with F2FS_IOC_SET_STREAMING, and the worst write() latency of the
+ * streaming run has to stay within the budget.
+ *
+ * The file system under test is the one holding the current directory,
+ * or the one given with -d; anything but f2fs is skipped.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <linux/f2fs.h>
+#include <linux/magic.h>
+
+#include "../../kselftest.h"
+
+#define CHUNK_SIZE	(64 * 1024)
+#define CHURN_FILES	256
+#define CHURN_SIZE	(16 * 1024)
+
+static const char *dir = ".";
+static unsigned int seconds = 20;
+/* 8 tracks of 24 bit audio at 48 kHz */
+static unsigned long rate = 8 * 3 * 48000;
+static unsigned long budget_ms = 100;
+static unsigned long prealloc_mb = 64;
+
+static volatile bool churn_stop;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Keeps the cleaner and the checkpoint busy */
+static void *churn(void *arg)
+{
+	static char buf[CHURN_SIZE];
+	char path[4096];
+	unsigned int i = 0;
+	int fd;
+
+	memset(buf, 0x5a, sizeof(buf));
+
+	while (!churn_stop) {
+		snprintf(path, sizeof(path), "%s/churn.%u", dir,
+			 i % CHURN_FILES);
+		unlink(path);
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd >= 0) {
+			if (write(fd, buf, sizeof(buf)) < 0)
+				break;
+			close(fd);
+		}
+		i++;
+	}
+
+	for (i = 0; i < CHURN_FILES; i++) {
+		snprintf(path, sizeof(path), "%s/churn.%u", dir, i);
+		unlink(path);
+	}
+
+	return NULL;
+}
+
+static int run(bool streaming, unsigned long long *worst,
+	       unsigned long long *p99)
+{
+	unsigned long long period_ns, *lat, start;
+	unsigned int i, count;
+	struct timespec next;
+	char path[4096];
+	pthread_t thread;
+	char *buf;
+	int fd, ret = 0;
+
+	period_ns = CHUNK_SIZE * 1000000000ULL / rate;
+	count = seconds * 1000000000ULL / period_ns;
+
+	lat = calloc(count, sizeof(*lat));
+	buf = malloc(CHUNK_SIZE);
+	if (!lat || !buf)
+		ksft_exit_fail_msg("Out of memory\n");
+	memset(buf, 0xa5, CHUNK_SIZE);
+
+	snprintf(path, sizeof(path), "%s/streaming_latency.dat", dir);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		ksft_exit_fail_msg("%s: %s\n", path, strerror(errno));
+
+	if (streaming) {
+		struct f2fs_streaming stream = {
+			.flags = F2FS_STREAMING_ON,
+			.prealloc_len = prealloc_mb << 20,
+		};
+
+		if (ioctl(fd, F2FS_IOC_SET_STREAMING, &stream)) {
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	churn_stop = false;
+	if (pthread_create(&thread, NULL, churn, NULL))
+		ksft_exit_fail_msg("pthread_create failed\n");
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	for (i = 0; i < count; i++) {
+		next.tv_nsec += period_ns;
+		while (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		start = now_ns();
+		if (write(fd, buf, CHUNK_SIZE) != CHUNK_SIZE) {
+			ret = errno ? -errno : -ENOSPC;
+			break;
+		}
+		lat[i] = now_ns() - start;
+	}
+
+	churn_stop = true;
+	pthread_join(thread, NULL);
+
+	if (!ret) {
+		qsort(lat, count, sizeof(*lat), cmp_ull);
+		*worst = lat[count - 1];
+		*p99 = lat[count * 99 / 100];
+	}
+out:
+	close(fd);
+	unlink(path);
+	free(buf);
+	free(lat);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long worst, p99;
+	struct statfs sfs;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "d:t:r:b:p:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			budget_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			prealloc_mb = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-d dir] [-t seconds] [-r bytes/s] [-b budget ms] [-p prealloc MiB]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	ksft_print_header();
+
+	if (statfs(dir, &sfs))
+		ksft_exit_fail_msg("%s: %s\n", dir, strerror(errno));
+	if (sfs.f_type != F2FS_SUPER_MAGIC)
+		ksft_exit_skip("%s is not on f2fs\n", dir);
+	if (!seconds || !rate || rate > CHUNK_SIZE * 1000000000ULL)
+		ksft_exit_fail_msg("Bad duration or rate\n");
+
+	ksft_set_plan(2);
+
+	ret = run(false, &worst, &p99);
+	if (ret)
+		ksft_exit_fail_msg("Plain writer: %s\n", strerror(-ret));
+	ksft_print_msg("plain writer: worst %llu us, 99%% %llu us\n",
+		       worst / 1000, p99 / 1000);
+	ksft_test_result_pass("plain writer\n");
+
+	ret = run(true, &worst, &p99);
+	if (ret == -ENOTTY)
+		ksft_exit_skip("F2FS_IOC_SET_STREAMING not supported\n");
+	if (ret)
+		ksft_exit_fail_msg("Streaming writer: %s\n", strerror(-ret));
+	ksft_print_msg("streaming writer: worst %llu us, 99%% %llu us\n",
+		       worst / 1000, p99 / 1000);
+	ksft_test_result(worst <= budget_ms * 1000000ULL,
+			 "streaming writer within %lu ms\n", budget_ms);
+
+	if (ksft_get_fail_cnt())
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
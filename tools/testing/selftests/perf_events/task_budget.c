@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Test for per-thread cycle budget accounting.
+ *
+ * A real-time thread can measure how much CPU a period of work really
+ * cost with a per-thread counter group of cycles and stall cycles: the
+ * counters are saved and restored on context switch, so time spent
+ * blocked or preempted by another thread is not charged to it. Check
+ * that this holds, which is what makes such a load meter trustworthy.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include "../kselftest_harness.h"
+
+#define BUSY_MS		50
+
+enum {
+	BUDGET_CYCLES,
+	BUDGET_STALL_FRONTEND,
+	BUDGET_STALL_BACKEND,
+	BUDGET_NR,
+};
+
+struct budget {
+	uint64_t nr;
+	uint64_t time_enabled;
+	uint64_t time_running;
+	uint64_t values[BUDGET_NR];
+};
+
+static const uint64_t budget_config[BUDGET_NR] = {
+	[BUDGET_CYCLES]		= PERF_COUNT_HW_CPU_CYCLES,
+	[BUDGET_STALL_FRONTEND]	= PERF_COUNT_HW_STALLED_CYCLES_FRONTEND,
+	[BUDGET_STALL_BACKEND]	= PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+};
+
+static int open_counter(uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr = {
+		.type		= PERF_TYPE_HARDWARE,
+		.size		= sizeof(attr),
+		.config		= config,
+		.read_format	= PERF_FORMAT_GROUP |
+				  PERF_FORMAT_TOTAL_TIME_ENABLED |
+				  PERF_FORMAT_TOTAL_TIME_RUNNING,
+		.exclude_hv	= 1,
+		.pinned		= group_fd < 0,
+	};
+
+	/* this thread only, on whichever CPU it runs */
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void busy(unsigned int ms)
+{
+	uint64_t end = now_ns() + ms * 1000000ull;
+
+	while (now_ns() < end)
+		;
+}
+
+static void *busy_thread(void *arg)
+{
+	busy(BUSY_MS);
+	return NULL;
+}
+
+FIXTURE(task_budget)
+{
+	int fds[BUDGET_NR];
+	int nr;
+};
+
+FIXTURE_SETUP(task_budget)
+{
+	int i;
+
+	self->nr = 0;
+	for (i = 0; i < BUDGET_NR; i++) {
+		self->fds[i] = open_counter(budget_config[i],
+					    i ? self->fds[0] : -1);
+		if (self->fds[i] < 0)
+			break;
+		self->nr++;
+	}
+
+	if (!self->nr)
+		SKIP(return, "no cycle counter: %s", strerror(errno));
+}
+
+FIXTURE_TEARDOWN(task_budget)
+{
+	int i;
+
+	for (i = 0; i < self->nr; i++)
+		close(self->fds[i]);
+}
+
+static void read_budget(struct __test_metadata *_metadata, int fd,
+			struct budget *b)
+{
+	memset(b, 0, sizeof(*b));
+	ASSERT_GT(read(fd, b, sizeof(*b)), 0);
+	/* a pinned group that lost its PMU would read as zero */
+	ASSERT_EQ(b->time_enabled, b->time_running);
+}
+
+TEST_F(task_budget, blocked_time_not_charged)
+{
+	struct budget b0, b1, b2;
+	uint64_t busy_cycles, idle_cycles;
+
+	read_budget(_metadata, self->fds[0], &b0);
+	busy(BUSY_MS);
+	read_budget(_metadata, self->fds[0], &b1);
+	usleep(BUSY_MS * 1000);
+	read_budget(_metadata, self->fds[0], &b2);
+
+	busy_cycles = b1.values[BUDGET_CYCLES] - b0.values[BUDGET_CYCLES];
+	idle_cycles = b2.values[BUDGET_CYCLES] - b1.values[BUDGET_CYCLES];
+
+	ASSERT_GT(busy_cycles, 0);
+	/* only the syscall entry and exit around the sleep is charged */
+	EXPECT_LT(idle_cycles * 20, busy_cycles);
+}
+
+TEST_F(task_budget, other_thread_not_charged)
+{
+	struct budget b0, b1, b2;
+	uint64_t own_cycles, other_cycles;
+	pthread_t thread;
+
+	read_budget(_metadata, self->fds[0], &b0);
+	busy(BUSY_MS);
+	read_budget(_metadata, self->fds[0], &b1);
+	ASSERT_EQ(pthread_create(&thread, NULL, busy_thread, NULL), 0);
+	ASSERT_EQ(pthread_join(thread, NULL), 0);
+	read_budget(_metadata, self->fds[0], &b2);
+
+	own_cycles = b1.values[BUDGET_CYCLES] - b0.values[BUDGET_CYCLES];
+	other_cycles = b2.values[BUDGET_CYCLES] - b1.values[BUDGET_CYCLES];
+
+	ASSERT_GT(own_cycles, 0);
+	/* the counter isn't inherited, the spinning thread isn't ours */
+	EXPECT_LT(other_cycles * 20, own_cycles);
+}
+
+TEST_F(task_budget, stalls_within_cycles)
+{
+	struct budget b0, b1;
+	uint64_t cycles;
+	int i;
+
+	if (self->nr < BUDGET_NR)
+		SKIP(return, "stall cycle events not supported");
+
+	read_budget(_metadata, self->fds[0], &b0);
+	busy(BUSY_MS);
+	read_budget(_metadata, self->fds[0], &b1);
+
+	ASSERT_EQ(b1.nr, BUDGET_NR);
+	cycles = b1.values[BUDGET_CYCLES] - b0.values[BUDGET_CYCLES];
+	for (i = BUDGET_STALL_FRONTEND; i < BUDGET_NR; i++)
+		EXPECT_LE(b1.values[i] - b0.values[i], cycles);
+}
+
+TEST_HARNESS_MAIN
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Audio load: a duplex stream through a loopback
+ *
+ * For each period captured a period is played, silence with a pulse every
+ * quarter second.  The capture wakeup lateness, how far past the period
+ * boundary the thread got to run, is the latency measured.  The time from
+ * writing a pulse to capturing it is reported as the round trip.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alsa/asoundlib.h>
+
+#include "syslat.h"
+
+#define AUDIO_RATE		48000
+#define AUDIO_CHANNELS		2
+#define AUDIO_PERIOD		128
+#define AUDIO_PERIODS		3
+#define AUDIO_BUFFER		(AUDIO_PERIOD * AUDIO_PERIODS)
+#define AUDIO_PULSE_EVERY	(AUDIO_RATE / 4)
+#define AUDIO_PULSE_FRAMES	16
+#define AUDIO_THRESHOLD		8192
+
+struct audio {
+	snd_pcm_t *out;
+	snd_pcm_t *in;
+	struct syslat_stats *wakeup;
+	struct syslat_stats *roundtrip;
+	int16_t buf[AUDIO_BUFFER * AUDIO_CHANNELS];
+	uint64_t captured;	/* frames captured */
+	uint64_t pulse_ref;	/* frames captured when the pulse was played */
+	uint64_t next_pulse;
+	bool pulse_pending;
+};
+
+static struct audio audio;
+
+static int audio_open(snd_pcm_t **pcm, const char *name,
+		      snd_pcm_stream_t stream)
+{
+	snd_pcm_hw_params_t *hw;
+	int err;
+
+	err = snd_pcm_open(pcm, name, stream, 0);
+	if (err < 0)
+		goto err;
+
+	snd_pcm_hw_params_alloca(&hw);
+	err = snd_pcm_hw_params_any(*pcm, hw);
+	if (!err)
+		err = snd_pcm_hw_params_set_access(*pcm, hw,
+				SND_PCM_ACCESS_RW_INTERLEAVED);
+	if (!err)
+		err = snd_pcm_hw_params_set_format(*pcm, hw,
+						   SND_PCM_FORMAT_S16_LE);
+	if (!err)
+		err = snd_pcm_hw_params_set_channels(*pcm, hw, AUDIO_CHANNELS);
+	if (!err)
+		err = snd_pcm_hw_params_set_rate(*pcm, hw, AUDIO_RATE, 0);
+	if (!err)
+		err = snd_pcm_hw_params_set_period_size(*pcm, hw, AUDIO_PERIOD,
+							0);
+	if (!err)
+		err = snd_pcm_hw_params_set_buffer_size(*pcm, hw, AUDIO_BUFFER);
+	if (!err)
+		err = snd_pcm_hw_params(*pcm, hw);
+	if (!err)
+		return 0;
+
+	snd_pcm_close(*pcm);
+	*pcm = NULL;
+err:
+	fprintf(stderr, "audio: %s: %s\n", name, snd_strerror(err));
+	return err;
+}
+
+static int audio_setup(struct syslat_load *load)
+{
+	struct audio *a = &audio;
+
+	if (audio_open(&a->out, load->arg, SND_PCM_STREAM_PLAYBACK) ||
+	    audio_open(&a->in, load->arg2, SND_PCM_STREAM_CAPTURE))
+		return -1;
+
+	a->wakeup = syslat_stats_new("audio", "xruns");
+	a->roundtrip = syslat_stats_new("audio_roundtrip", "lost");
+	if (!a->wakeup || !a->roundtrip)
+		return -1;
+
+	load->priv = a;
+	return 0;
+}
+
+/* Two periods of silence in the playback buffer, then run both streams */
+static int audio_start(struct audio *a)
+{
+	int err;
+
+	snd_pcm_drop(a->out);
+	snd_pcm_drop(a->in);
+	err = snd_pcm_prepare(a->out);
+	if (!err)
+		err = snd_pcm_prepare(a->in);
+	if (err < 0)
+		return err;
+
+	memset(a->buf, 0, sizeof(a->buf));
+	err = snd_pcm_writei(a->out, a->buf, AUDIO_PERIOD * 2);
+	if (err < 0)
+		return err;
+
+	err = snd_pcm_start(a->in);
+	if (!err)
+		err = snd_pcm_start(a->out);
+	a->pulse_pending = false;
+	a->next_pulse = a->captured + AUDIO_PULSE_EVERY;
+	return err;
+}
+
+static void audio_detect_pulse(struct audio *a, snd_pcm_uframes_t frames)
+{
+	snd_pcm_uframes_t i;
+
+	if (!a->pulse_pending)
+		return;
+
+	for (i = 0; i < frames; i++) {
+		if (abs(a->buf[i * AUDIO_CHANNELS]) < AUDIO_THRESHOLD)
+			continue;
+		syslat_record(a->roundtrip,
+			      (a->captured + i - a->pulse_ref) *
+			      NSEC_PER_SEC / AUDIO_RATE);
+		a->pulse_pending = false;
+		return;
+	}
+
+	/* a second without it, the loop isn't connected or dropped it */
+	if (a->captured + frames - a->pulse_ref > AUDIO_RATE) {
+		a->roundtrip->events++;
+		a->pulse_pending = false;
+	}
+}
+
+static void audio_run(struct syslat_load *load)
+{
+	struct audio *a = load->priv;
+	snd_pcm_sframes_t avail, frames;
+	int err, i;
+
+	err = audio_start(a);
+	while (!syslat_stopping) {
+		if (err < 0) {
+			a->wakeup->events++;
+			err = audio_start(a);
+			if (err < 0) {
+				fprintf(stderr, "audio: cannot restart: %s\n",
+					snd_strerror(err));
+				return;
+			}
+		}
+
+		err = snd_pcm_wait(a->in, 100);
+		if (err <= 0)
+			continue;
+
+		avail = snd_pcm_avail_update(a->in);
+		if (avail < 0) {
+			err = avail;
+			continue;
+		}
+		if (avail >= AUDIO_PERIOD)
+			syslat_record(a->wakeup, (avail - AUDIO_PERIOD) *
+				      NSEC_PER_SEC / AUDIO_RATE);
+
+		if (avail > AUDIO_BUFFER)
+			avail = AUDIO_BUFFER;
+		frames = snd_pcm_readi(a->in, a->buf, avail);
+		if (frames < 0) {
+			err = frames;
+			continue;
+		}
+		audio_detect_pulse(a, frames);
+		a->captured += frames;
+
+		memset(a->buf, 0, frames * AUDIO_CHANNELS * sizeof(int16_t));
+		if (!a->pulse_pending && a->captured >= a->next_pulse &&
+		    frames >= AUDIO_PULSE_FRAMES) {
+			for (i = 0; i < AUDIO_PULSE_FRAMES * AUDIO_CHANNELS; i++)
+				a->buf[i] = 0x7fff;
+			a->pulse_ref = a->captured;
+			a->pulse_pending = true;
+			a->next_pulse = a->captured + AUDIO_PULSE_EVERY;
+		}
+
+		frames = snd_pcm_writei(a->out, a->buf, frames);
+		if (frames < 0)
+			err = frames;
+	}
+
+	snd_pcm_drop(a->in);
+	snd_pcm_drop(a->out);
+}
+
+static void audio_cleanup(struct syslat_load *load)
+{
+	struct audio *a = load->priv;
+
+	snd_pcm_close(a->in);
+	snd_pcm_close(a->out);
+}
+
+struct syslat_load syslat_audio_load = {
+	.name		= "audio",
+	.setup		= audio_setup,
+	.run		= audio_run,
+	.cleanup	= audio_cleanup,
+};
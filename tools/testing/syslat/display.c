@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Display load: page flips on every vblank
+ *
+ * Flips between two dumb buffers on the first connected output, the
+ * device must not be in use by a compositor.  The time from a flip
+ * request to its completion event being read is the latency measured
+ * and vblanks passing without a flip are counted as missed.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "syslat.h"
+
+#define DISPLAY_TIMEOUT_MS	100
+
+struct display {
+	int fd;
+	uint32_t crtc_id;
+	uint32_t connector_id;
+	drmModeModeInfo mode;
+	drmModeCrtc *saved_crtc;
+	uint32_t fb[2];
+	uint32_t handle[2];
+	unsigned int last_seq;
+	bool flip_done;
+	struct syslat_stats *stats;
+};
+
+static struct display display;
+
+static int display_find_output(struct display *d)
+{
+	drmModeConnector *conn = NULL;
+	drmModeEncoder *enc;
+	drmModeRes *res;
+	int i, ret = -1;
+
+	res = drmModeGetResources(d->fd);
+	if (!res)
+		return -1;
+
+	for (i = 0; i < res->count_connectors; i++) {
+		conn = drmModeGetConnector(d->fd, res->connectors[i]);
+		if (conn && conn->connection == DRM_MODE_CONNECTED &&
+		    conn->count_modes)
+			break;
+		drmModeFreeConnector(conn);
+		conn = NULL;
+	}
+	if (!conn)
+		goto out;
+
+	d->connector_id = conn->connector_id;
+	d->mode = conn->modes[0];
+
+	/* keep the CRTC driving the output, else take the first usable */
+	enc = drmModeGetEncoder(d->fd, conn->encoder_id);
+	if (enc && enc->crtc_id) {
+		d->crtc_id = enc->crtc_id;
+		ret = 0;
+	} else {
+		for (i = 0; i < conn->count_encoders && ret; i++) {
+			int c;
+
+			drmModeFreeEncoder(enc);
+			enc = drmModeGetEncoder(d->fd, conn->encoders[i]);
+			for (c = 0; enc && c < res->count_crtcs; c++) {
+				if (enc->possible_crtcs & (1 << c)) {
+					d->crtc_id = res->crtcs[c];
+					ret = 0;
+					break;
+				}
+			}
+		}
+	}
+	drmModeFreeEncoder(enc);
+	drmModeFreeConnector(conn);
+out:
+	drmModeFreeResources(res);
+	return ret;
+}
+
+static int display_create_fb(struct display *d, int i)
+{
+	struct drm_mode_create_dumb create = {
+		.width = d->mode.hdisplay,
+		.height = d->mode.vdisplay,
+		.bpp = 32,
+	};
+
+	if (drmIoctl(d->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create))
+		return -errno;
+	d->handle[i] = create.handle;
+
+	return drmModeAddFB(d->fd, create.width, create.height, 24, 32,
+			    create.pitch, create.handle, &d->fb[i]);
+}
+
+static int display_setup(struct syslat_load *load)
+{
+	struct display *d = &display;
+	int err;
+
+	d->fd = open(load->arg, O_RDWR | O_CLOEXEC);
+	if (d->fd < 0) {
+		fprintf(stderr, "display: %s: %s\n", load->arg,
+			strerror(errno));
+		return -1;
+	}
+
+	if (display_find_output(d)) {
+		fprintf(stderr, "display: no connected output\n");
+		return -1;
+	}
+
+	err = display_create_fb(d, 0);
+	if (!err)
+		err = display_create_fb(d, 1);
+	if (err) {
+		fprintf(stderr, "display: cannot create buffers: %s\n",
+			strerror(-err));
+		return -1;
+	}
+
+	d->saved_crtc = drmModeGetCrtc(d->fd, d->crtc_id);
+	if (drmModeSetCrtc(d->fd, d->crtc_id, d->fb[0], 0, 0,
+			   &d->connector_id, 1, &d->mode)) {
+		fprintf(stderr, "display: cannot set mode: %s\n",
+			strerror(errno));
+		return -1;
+	}
+
+	d->stats = syslat_stats_new("display", "missed");
+	if (!d->stats)
+		return -1;
+	snprintf(d->stats->extra, sizeof(d->stats->extra), "refresh_hz=%u",
+		 d->mode.vrefresh);
+
+	load->priv = d;
+	return 0;
+}
+
+static void display_flip_handler(int fd, unsigned int seq,
+				 unsigned int tv_sec, unsigned int tv_usec,
+				 void *data)
+{
+	struct display *d = data;
+
+	if (d->last_seq && seq - d->last_seq > 1)
+		d->stats->events += seq - d->last_seq - 1;
+	d->last_seq = seq;
+	d->flip_done = true;
+}
+
+static void display_run(struct syslat_load *load)
+{
+	struct display *d = load->priv;
+	drmEventContext evctx = {
+		.version = 2,
+		.page_flip_handler = display_flip_handler,
+	};
+	struct pollfd pfd = { .fd = d->fd, .events = POLLIN };
+	unsigned int frame = 0;
+	uint64_t start;
+
+	while (!syslat_stopping) {
+		frame ^= 1;
+		start = syslat_now();
+		if (drmModePageFlip(d->fd, d->crtc_id, d->fb[frame],
+				    DRM_MODE_PAGE_FLIP_EVENT, d)) {
+			fprintf(stderr, "display: page flip: %s\n",
+				strerror(errno));
+			return;
+		}
+
+		d->flip_done = false;
+		while (!d->flip_done) {
+			if (poll(&pfd, 1, DISPLAY_TIMEOUT_MS) <= 0) {
+				fprintf(stderr, "display: flip timed out\n");
+				return;
+			}
+			drmHandleEvent(d->fd, &evctx);
+		}
+		syslat_record(d->stats, syslat_now() - start);
+	}
+}
+
+static void display_cleanup(struct syslat_load *load)
+{
+	struct display *d = load->priv;
+	struct drm_mode_destroy_dumb destroy = {};
+	int i;
+
+	if (d->saved_crtc && d->saved_crtc->mode_valid)
+		drmModeSetCrtc(d->fd, d->saved_crtc->crtc_id,
+			       d->saved_crtc->buffer_id, d->saved_crtc->x,
+			       d->saved_crtc->y, &d->connector_id, 1,
+			       &d->saved_crtc->mode);
+	else
+		drmModeSetCrtc(d->fd, d->crtc_id, 0, 0, 0, NULL, 0, NULL);
+	drmModeFreeCrtc(d->saved_crtc);
+
+	for (i = 0; i < 2; i++) {
+		drmModeRmFB(d->fd, d->fb[i]);
+		destroy.handle = d->handle[i];
+		drmIoctl(d->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+	}
+	close(d->fd);
+}
+
+struct syslat_load syslat_display_load = {
+	.name		= "display",
+	.setup		= display_setup,
+	.run		= display_run,
+	.cleanup	= display_cleanup,
+};
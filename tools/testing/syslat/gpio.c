@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * GPIO load: edge event echo
+ *
+ * An output line wired to an input line is toggled every 10 ms.  The
+ * edge event's timestamp, taken in the interrupt handler, gives the
+ * interrupt latency and the time until the event is read gives the
+ * latency seen by userspace.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "syslat.h"
+
+#define GPIO_INTERVAL_NS	(10 * NSEC_PER_MSEC)
+#define GPIO_TIMEOUT_MS		100
+
+struct gpio {
+	int out_fd;
+	int in_fd;
+	struct syslat_stats *echo;
+	struct syslat_stats *irq;
+};
+
+static struct gpio gpio;
+
+static int gpio_request(int chip_fd, unsigned int offset, uint64_t flags)
+{
+	struct gpio_v2_line_request req;
+
+	memset(&req, 0, sizeof(req));
+	req.offsets[0] = offset;
+	req.num_lines = 1;
+	req.config.flags = flags;
+	strcpy(req.consumer, "syslat");
+
+	if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		fprintf(stderr, "gpio: line %u: %s\n", offset, strerror(errno));
+		return -1;
+	}
+	return req.fd;
+}
+
+static int gpio_setup(struct syslat_load *load)
+{
+	struct gpio *g = &gpio;
+	unsigned int out, in;
+	char chip[32], path[64];
+	int fd;
+
+	if (sscanf(load->arg, "%31[^:]:%u:%u", chip, &out, &in) != 3) {
+		fprintf(stderr, "gpio: expected CHIP:OUT:IN, got %s\n",
+			load->arg);
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "/dev/%s", chip);
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "gpio: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	g->out_fd = gpio_request(fd, out, GPIO_V2_LINE_FLAG_OUTPUT);
+	g->in_fd = gpio_request(fd, in, GPIO_V2_LINE_FLAG_INPUT |
+				GPIO_V2_LINE_FLAG_EDGE_RISING |
+				GPIO_V2_LINE_FLAG_EDGE_FALLING);
+	close(fd);
+	if (g->out_fd < 0 || g->in_fd < 0)
+		return -1;
+
+	g->echo = syslat_stats_new("gpio", "lost");
+	g->irq = syslat_stats_new("gpio_irq", NULL);
+	if (!g->echo || !g->irq)
+		return -1;
+
+	load->priv = g;
+	return 0;
+}
+
+static void gpio_run(struct syslat_load *load)
+{
+	struct gpio *g = load->priv;
+	struct gpio_v2_line_values values = { .mask = 1 };
+	struct gpio_v2_line_event event;
+	struct pollfd pfd = { .fd = g->in_fd, .events = POLLIN };
+	uint64_t next = syslat_now(), start;
+	struct timespec ts;
+
+	while (!syslat_stopping) {
+		next += GPIO_INTERVAL_NS;
+		values.bits ^= 1;
+
+		/* drop events left over from a bouncing edge */
+		while (poll(&pfd, 1, 0) > 0 &&
+		       read(g->in_fd, &event, sizeof(event)) == sizeof(event))
+			;
+
+		start = syslat_now();
+		if (ioctl(g->out_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) ||
+		    poll(&pfd, 1, GPIO_TIMEOUT_MS) <= 0 ||
+		    read(g->in_fd, &event, sizeof(event)) != sizeof(event)) {
+			if (!syslat_stopping)
+				g->echo->events++;
+		} else {
+			syslat_record(g->echo, syslat_now() - start);
+			if (event.timestamp_ns > start)
+				syslat_record(g->irq,
+					      event.timestamp_ns - start);
+		}
+
+		if (next < syslat_now())
+			next = syslat_now();
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+}
+
+static void gpio_cleanup(struct syslat_load *load)
+{
+	struct gpio *g = load->priv;
+
+	close(g->in_fd);
+	close(g->out_fd);
+}
+
+struct syslat_load syslat_gpio_load = {
+	.name		= "gpio",
+	.setup		= gpio_setup,
+	.run		= gpio_run,
+	.cleanup	= gpio_cleanup,
+};
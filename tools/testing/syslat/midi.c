@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * MIDI load: rawmidi event echo
+ *
+ * A note on is sent every 10 ms on a rawmidi port whose output is wired
+ * back to its input, by a cable or a device echoing its input, and the
+ * time until it is read back is the latency measured.  The velocity
+ * carries a sequence number so that a late echo isn't taken for the
+ * next one.
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <time.h>
+#include <alsa/asoundlib.h>
+
+#include "syslat.h"
+
+#define MIDI_INTERVAL_NS	(10 * NSEC_PER_MSEC)
+#define MIDI_TIMEOUT_MS		100
+
+struct midi {
+	snd_rawmidi_t *in;
+	snd_rawmidi_t *out;
+	struct syslat_stats *stats;
+};
+
+static struct midi midi;
+
+static int midi_setup(struct syslat_load *load)
+{
+	struct midi *m = &midi;
+	int err;
+
+	err = snd_rawmidi_open(&m->in, &m->out, load->arg,
+			       SND_RAWMIDI_NONBLOCK);
+	if (err < 0) {
+		fprintf(stderr, "midi: %s: %s\n", load->arg, snd_strerror(err));
+		return err;
+	}
+	/* writes don't wait for room, they are only 3 bytes */
+	snd_rawmidi_nonblock(m->out, 0);
+
+	m->stats = syslat_stats_new("midi", "lost");
+	if (!m->stats)
+		return -1;
+
+	load->priv = m;
+	return 0;
+}
+
+/* Read until the note with this velocity, or time out */
+static bool midi_wait_echo(struct midi *m, unsigned char velocity)
+{
+	unsigned char buf[64];
+	struct pollfd pfd;
+	uint64_t deadline;
+	int state = 0, i, n;
+
+	snd_rawmidi_poll_descriptors(m->in, &pfd, 1);
+	deadline = syslat_now() + MIDI_TIMEOUT_MS * NSEC_PER_MSEC;
+
+	while (!syslat_stopping) {
+		int64_t left = deadline - syslat_now();
+
+		if (left <= 0 || poll(&pfd, 1, left / NSEC_PER_MSEC + 1) <= 0)
+			return false;
+
+		n = snd_rawmidi_read(m->in, buf, sizeof(buf));
+		if (n == -EAGAIN)
+			continue;
+		if (n < 0)
+			return false;
+
+		/* note on, note 60, then the velocity */
+		for (i = 0; i < n; i++) {
+			if (buf[i] == 0x90)
+				state = 1;
+			else if (state == 1 && buf[i] == 60)
+				state = 2;
+			else if (state == 2 && buf[i] == velocity)
+				return true;
+			else
+				state = 0;
+		}
+	}
+	return false;
+}
+
+static void midi_run(struct syslat_load *load)
+{
+	struct midi *m = load->priv;
+	unsigned char note[3] = { 0x90, 60, 0 };
+	unsigned char off[3] = { 0x80, 60, 0 };
+	uint64_t next = syslat_now(), start;
+	struct timespec ts;
+
+	snd_rawmidi_drop(m->in);
+	while (!syslat_stopping) {
+		next += MIDI_INTERVAL_NS;
+		/* velocity 0 is a note off */
+		note[2] = note[2] % 127 + 1;
+
+		start = syslat_now();
+		if (snd_rawmidi_write(m->out, note, sizeof(note)) ==
+		    sizeof(note) && midi_wait_echo(m, note[2]))
+			syslat_record(m->stats, syslat_now() - start);
+		else if (!syslat_stopping)
+			m->stats->events++;
+		snd_rawmidi_write(m->out, off, sizeof(off));
+
+		/* don't try to catch up after a lost echo */
+		if (next < syslat_now())
+			next = syslat_now();
+
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+}
+
+static void midi_cleanup(struct syslat_load *load)
+{
+	struct midi *m = load->priv;
+
+	snd_rawmidi_close(m->in);
+	snd_rawmidi_close(m->out);
+}
+
+struct syslat_load syslat_midi_load = {
+	.name		= "midi",
+	.setup		= midi_setup,
+	.run		= midi_run,
+	.cleanup	= midi_cleanup,
+};
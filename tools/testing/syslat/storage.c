@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Storage load: streaming reads
+ *
+ * Reads a file or block device from start to end in 256 KiB chunks, over
+ * and over, the way a disk streamer reads sample data.  The time each
+ * read takes is the latency measured.  O_DIRECT is used when supported,
+ * so that the page cache doesn't hide the device after the first pass.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "syslat.h"
+
+#define STORAGE_CHUNK	(256 * 1024)
+
+struct storage {
+	int fd;
+	bool direct;
+	void *buf;
+	struct syslat_stats *stats;
+};
+
+static struct storage storage;
+
+static int storage_setup(struct syslat_load *load)
+{
+	struct storage *s = &storage;
+
+	s->direct = true;
+	s->fd = open(load->arg, O_RDONLY | O_DIRECT | O_CLOEXEC);
+	if (s->fd < 0 && errno == EINVAL) {
+		s->direct = false;
+		s->fd = open(load->arg, O_RDONLY | O_CLOEXEC);
+	}
+	if (s->fd < 0) {
+		fprintf(stderr, "storage: %s: %s\n", load->arg,
+			strerror(errno));
+		return -1;
+	}
+
+	if (posix_memalign(&s->buf, 4096, STORAGE_CHUNK))
+		return -1;
+
+	s->stats = syslat_stats_new("storage", NULL);
+	if (!s->stats)
+		return -1;
+
+	load->priv = s;
+	return 0;
+}
+
+static void storage_run(struct syslat_load *load)
+{
+	struct storage *s = load->priv;
+	uint64_t begin = syslat_now(), bytes = 0, start, elapsed;
+	ssize_t n;
+
+	while (!syslat_stopping) {
+		start = syslat_now();
+		n = read(s->fd, s->buf, STORAGE_CHUNK);
+		if (n < 0) {
+			fprintf(stderr, "storage: %s\n", strerror(errno));
+			break;
+		}
+		if (!n) {
+			/* wrap, and don't let the cache serve the next pass */
+			if (!s->direct)
+				posix_fadvise(s->fd, 0, 0, POSIX_FADV_DONTNEED);
+			lseek(s->fd, 0, SEEK_SET);
+			continue;
+		}
+		syslat_record(s->stats, syslat_now() - start);
+		bytes += n;
+	}
+
+	elapsed = syslat_now() - begin;
+	snprintf(s->stats->extra, sizeof(s->stats->extra),
+		 "mb_per_s=%.1f direct=%d",
+		 elapsed ? (double)bytes * NSEC_PER_SEC / elapsed / 1e6 : 0,
+		 s->direct);
+}
+
+static void storage_cleanup(struct syslat_load *load)
+{
+	struct storage *s = load->priv;
+
+	free(s->buf);
+	close(s->fd);
+}
+
+struct syslat_load syslat_storage_load = {
+	.name		= "storage",
+	.setup		= storage_setup,
+	.run		= storage_run,
+	.cleanup	= storage_cleanup,
+};
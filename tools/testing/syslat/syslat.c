@@ -0,0 +1,412 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * syslat - whole system latency benchmark
+ *
+ * Runs audio, MIDI, GPIO, storage and display loads at the same time, each
+ * in its own thread, and reports the latency percentiles and the xruns or
+ * missed events of each of them.  The report can be saved and passed back
+ * with --baseline to check a new kernel against it.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "syslat.h"
+
+#define RESULT_PREFIX	"# RESULT syslat "
+#define MAX_KEYS	16
+
+volatile sig_atomic_t syslat_stopping;
+
+static struct syslat_load *loads[] = {
+	&syslat_audio_load,
+	&syslat_midi_load,
+	&syslat_gpio_load,
+	&syslat_storage_load,
+	&syslat_display_load,
+};
+
+#define NR_LOADS	(sizeof(loads) / sizeof(loads[0]))
+
+static struct syslat_stats *stats_list;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t start_barrier;
+static int rt_priority;
+
+uint64_t syslat_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+struct syslat_stats *syslat_stats_new(const char *name,
+				      const char *events_name)
+{
+	struct syslat_stats *stats, **p;
+
+	stats = calloc(1, sizeof(*stats));
+	if (!stats)
+		return NULL;
+	stats->name = name;
+	stats->events_name = events_name;
+
+	/* keep the report in registration order */
+	pthread_mutex_lock(&stats_lock);
+	for (p = &stats_list; *p; p = &(*p)->next)
+		;
+	*p = stats;
+	pthread_mutex_unlock(&stats_lock);
+
+	return stats;
+}
+
+void syslat_record(struct syslat_stats *stats, uint64_t ns)
+{
+	if (stats->nr == stats->alloc) {
+		size_t alloc = stats->alloc ? stats->alloc * 2 : 4096;
+		uint64_t *samples;
+
+		samples = realloc(stats->samples, alloc * sizeof(*samples));
+		if (!samples)
+			return;
+		stats->samples = samples;
+		stats->alloc = alloc;
+	}
+	stats->samples[stats->nr++] = ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const struct syslat_stats *stats, double pct)
+{
+	size_t i = (size_t)(stats->nr * pct / 100.0);
+
+	if (i >= stats->nr)
+		i = stats->nr - 1;
+	return (double)stats->samples[i] / NSEC_PER_USEC;
+}
+
+static void format_result(const struct syslat_stats *stats, char *buf,
+			  size_t size)
+{
+	int len;
+
+	len = snprintf(buf, size, "%s samples=%zu", stats->name, stats->nr);
+	if (stats->nr)
+		len += snprintf(buf + len, size - len,
+				" p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f",
+				percentile_us(stats, 50),
+				percentile_us(stats, 99),
+				percentile_us(stats, 99.9),
+				percentile_us(stats, 100));
+	if (stats->events_name)
+		len += snprintf(buf + len, size - len, " %s=%lu",
+				stats->events_name, stats->events);
+	if (stats->extra[0])
+		snprintf(buf + len, size - len, " %s", stats->extra);
+}
+
+struct result {
+	char name[32];
+	int nr_keys;
+	char keys[MAX_KEYS][32];
+	double values[MAX_KEYS];
+};
+
+static int parse_result(const char *line, struct result *res)
+{
+	const char *p = line;
+	int n;
+
+	memset(res, 0, sizeof(*res));
+	if (sscanf(p, "%31s%n", res->name, &n) != 1)
+		return -EINVAL;
+	p += n;
+
+	while (res->nr_keys < MAX_KEYS &&
+	       sscanf(p, " %31[^= ]=%lf%n", res->keys[res->nr_keys],
+		      &res->values[res->nr_keys], &n) == 2) {
+		res->nr_keys++;
+		p += n;
+	}
+	return 0;
+}
+
+static bool result_get(const struct result *res, const char *key,
+		       double *value)
+{
+	int i;
+
+	for (i = 0; i < res->nr_keys; i++) {
+		if (!strcmp(res->keys[i], key)) {
+			*value = res->values[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * A latency regresses when it exceeds the baseline by more than the
+ * tolerance, plus a few us so that a quiet baseline isn't too strict.
+ * Any increase of a counted event, xruns above all, is a regression.
+ */
+static int compare_result(const struct result *base, const struct result *cur,
+			  double tolerance)
+{
+	static const char * const latencies[] = { "p99_us", "p999_us", "max_us" };
+	double b, c;
+	int i, regressions = 0;
+
+	for (i = 0; i < 3; i++) {
+		if (!result_get(base, latencies[i], &b) ||
+		    !result_get(cur, latencies[i], &c))
+			continue;
+		if (c > b * (1 + tolerance / 100) + 10) {
+			printf("# REGRESSION %s %s %.1f -> %.1f\n", cur->name,
+			       latencies[i], b, c);
+			regressions++;
+		}
+	}
+
+	for (i = 0; i < cur->nr_keys; i++) {
+		const char *key = cur->keys[i];
+
+		if (strcmp(key, "xruns") && strcmp(key, "lost") &&
+		    strcmp(key, "missed"))
+			continue;
+		if (result_get(base, key, &b) && cur->values[i] > b) {
+			printf("# REGRESSION %s %s %.0f -> %.0f\n", cur->name,
+			       key, b, cur->values[i]);
+			regressions++;
+		}
+	}
+
+	return regressions;
+}
+
+static int compare_baseline(const char *path, double tolerance)
+{
+	struct syslat_stats *stats;
+	struct result base, cur;
+	char line[512], buf[512];
+	int regressions = 0;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "cannot open baseline %s: %s\n", path,
+			strerror(errno));
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (strncmp(line, RESULT_PREFIX, strlen(RESULT_PREFIX)) ||
+		    parse_result(line + strlen(RESULT_PREFIX), &base))
+			continue;
+
+		for (stats = stats_list; stats; stats = stats->next) {
+			if (strcmp(stats->name, base.name))
+				continue;
+			format_result(stats, buf, sizeof(buf));
+			parse_result(buf, &cur);
+			regressions += compare_result(&base, &cur, tolerance);
+		}
+	}
+	fclose(f);
+
+	printf("# %d regressions against %s\n", regressions, path);
+	return regressions;
+}
+
+static void report(void)
+{
+	struct syslat_stats *stats;
+	char buf[512];
+
+	for (stats = stats_list; stats; stats = stats->next) {
+		qsort(stats->samples, stats->nr, sizeof(*stats->samples),
+		      cmp_u64);
+		format_result(stats, buf, sizeof(buf));
+		printf(RESULT_PREFIX "%s\n", buf);
+	}
+}
+
+static void *load_thread(void *arg)
+{
+	struct syslat_load *load = arg;
+
+	if (rt_priority) {
+		struct sched_param param = { .sched_priority = rt_priority };
+
+		if (sched_setscheduler(0, SCHED_FIFO, &param))
+			fprintf(stderr, "%s: cannot set SCHED_FIFO: %s\n",
+				load->name, strerror(errno));
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	load->run(load);
+	return NULL;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"\n"
+		"Loads, each enabled by its option:\n"
+		"  -a, --audio-out PCM      playback PCM of the audio round trip\n"
+		"  -A, --audio-in PCM       capture PCM looped back from it\n"
+		"  -m, --midi DEV           rawmidi device looped back to itself\n"
+		"  -g, --gpio CHIP:OUT:IN   GPIO output line wired to an input\n"
+		"  -s, --storage FILE       file or block device to stream from\n"
+		"  -d, --display CARD       DRM device to page flip on\n"
+		"\n"
+		"Options:\n"
+		"  -t, --duration SEC       run time, default 60\n"
+		"  -p, --priority PRIO      SCHED_FIFO priority of the loads\n"
+		"  -b, --baseline FILE      compare against a previous report\n"
+		"  -T, --tolerance PCT      latency tolerance, default 20\n"
+		"  -h, --help               this help\n"
+		"\n"
+		"For snd-aloop use -a hw:Loopback,0,0 -A hw:Loopback,1,0.\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] = {
+		{ "audio-out",	required_argument, NULL, 'a' },
+		{ "audio-in",	required_argument, NULL, 'A' },
+		{ "midi",	required_argument, NULL, 'm' },
+		{ "gpio",	required_argument, NULL, 'g' },
+		{ "storage",	required_argument, NULL, 's' },
+		{ "display",	required_argument, NULL, 'd' },
+		{ "duration",	required_argument, NULL, 't' },
+		{ "priority",	required_argument, NULL, 'p' },
+		{ "baseline",	required_argument, NULL, 'b' },
+		{ "tolerance",	required_argument, NULL, 'T' },
+		{ "help",	no_argument,	   NULL, 'h' },
+		{}
+	};
+	unsigned int duration = 60, nr_threads = 0, i;
+	pthread_t threads[NR_LOADS];
+	const char *baseline = NULL;
+	double tolerance = 20;
+	bool enabled[NR_LOADS] = {};
+	struct utsname uts;
+	int opt, ret = 0;
+
+	while ((opt = getopt_long(argc, argv, "a:A:m:g:s:d:t:p:b:T:h",
+				  options, NULL)) != -1) {
+		switch (opt) {
+		case 'a':
+			syslat_audio_load.arg = optarg;
+			break;
+		case 'A':
+			syslat_audio_load.arg2 = optarg;
+			break;
+		case 'm':
+			syslat_midi_load.arg = optarg;
+			break;
+		case 'g':
+			syslat_gpio_load.arg = optarg;
+			break;
+		case 's':
+			syslat_storage_load.arg = optarg;
+			break;
+		case 'd':
+			syslat_display_load.arg = optarg;
+			break;
+		case 't':
+			duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			rt_priority = strtol(optarg, NULL, 0);
+			break;
+		case 'b':
+			baseline = optarg;
+			break;
+		case 'T':
+			tolerance = strtod(optarg, NULL);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+
+	if (!syslat_audio_load.arg != !syslat_audio_load.arg2) {
+		fprintf(stderr, "audio needs both --audio-out and --audio-in\n");
+		return 2;
+	}
+
+	for (i = 0; i < NR_LOADS; i++) {
+		if (!loads[i]->arg)
+			continue;
+		if (loads[i]->setup(loads[i])) {
+			fprintf(stderr, "%s: setup failed\n", loads[i]->name);
+			ret = 1;
+			goto cleanup;
+		}
+		enabled[i] = true;
+		nr_threads++;
+	}
+
+	if (!nr_threads) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	uname(&uts);
+	printf("# syslat %s %s, %u s, %u loads\n", uts.release, uts.machine,
+	       duration, nr_threads);
+	fflush(stdout);
+
+	pthread_barrier_init(&start_barrier, NULL, nr_threads + 1);
+	for (i = 0; i < NR_LOADS; i++) {
+		if (!enabled[i])
+			continue;
+		ret = pthread_create(&threads[i], NULL, load_thread, loads[i]);
+		if (ret) {
+			/* the barrier can't complete, nothing to unwind to */
+			fprintf(stderr, "%s: %s\n", loads[i]->name,
+				strerror(ret));
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	sleep(duration);
+	syslat_stopping = 1;
+
+	for (i = 0; i < NR_LOADS; i++)
+		if (enabled[i])
+			pthread_join(threads[i], NULL);
+
+	report();
+	if (baseline)
+		ret = compare_baseline(baseline, tolerance) ? 1 : 0;
+
+cleanup:
+	for (i = 0; i < NR_LOADS; i++)
+		if (enabled[i] && loads[i]->cleanup)
+			loads[i]->cleanup(loads[i]);
+
+	return ret;
+}
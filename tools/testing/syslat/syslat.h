@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef SYSLAT_H
+#define SYSLAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+
+#define NSEC_PER_USEC	1000ULL
+#define NSEC_PER_MSEC	1000000ULL
+#define NSEC_PER_SEC	1000000000ULL
+
+/* Latency samples of one measurement, owned by the thread filling it */
+struct syslat_stats {
+	const char *name;
+	uint64_t *samples;		/* in ns */
+	size_t nr;
+	size_t alloc;
+	const char *events_name;	/* e.g. "xruns", NULL if none */
+	unsigned long events;
+	char extra[64];			/* further key=value pairs */
+	struct syslat_stats *next;
+};
+
+/* One kind of load, running in its own thread for the whole benchmark */
+struct syslat_load {
+	const char *name;
+	const char *arg;		/* from the command line, NULL if off */
+	const char *arg2;
+	int (*setup)(struct syslat_load *load);
+	void (*run)(struct syslat_load *load);
+	void (*cleanup)(struct syslat_load *load);
+	void *priv;
+};
+
+/* Set when the loads should return from their run() callback */
+extern volatile sig_atomic_t syslat_stopping;
+
+uint64_t syslat_now(void);
+struct syslat_stats *syslat_stats_new(const char *name,
+				      const char *events_name);
+void syslat_record(struct syslat_stats *stats, uint64_t ns);
+
+extern struct syslat_load syslat_audio_load;
+extern struct syslat_load syslat_midi_load;
+extern struct syslat_load syslat_gpio_load;
+extern struct syslat_load syslat_storage_load;
+extern struct syslat_load syslat_display_load;
+
+#endif /* SYSLAT_H */